@@ -31,6 +31,13 @@
 #include "vorbis/vorbisenc.h"
 #include "vorbis/vorbisfile.h"
 
+#include <memmap.h>
+#if defined(HAVE_MMAN) && !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#define FLUID_SAMPLE_MMAP
+#endif
+
 struct VorbisData {
     int pos;          // current position in audio->data()
     char* data;
@@ -282,6 +289,8 @@ fluid_defsfont_t* new_fluid_defsfont()
   sfont->samplesize = 0;
   sfont->sample = NULL;
   sfont->sampledata = NULL;
+  sfont->mapping = NULL;
+  sfont->mappingsize = 0;
   sfont->preset = NULL;
 
   return sfont;
@@ -316,6 +325,11 @@ int delete_fluid_defsfont(fluid_defsfont_t* sfont)
     delete_fluid_list(sfont->sample);
   }
 
+#ifdef FLUID_SAMPLE_MMAP
+  if (sfont->mapping != NULL) {
+    munmap(sfont->mapping, sfont->mappingsize);
+  } else
+#endif
   if (sfont->sampledata != NULL) {
     FLUID_FREE(sfont->sampledata);
   }
@@ -386,8 +400,9 @@ int fluid_defsfont_load(fluid_defsfont_t* sfont, const char* file)
     if (fluid_sample_import_sfont(sample, sfsample, sfont) != FLUID_OK)
       goto err_exit;
 
+    /* fluid_voice_init scans the sample's loop when it is first played,
+       so samples no song uses are never read */
     fluid_defsfont_add_sample(sfont, sample);
-    fluid_voice_optimize_sample(sample);
     p = fluid_list_next(p);
   }
 
@@ -466,6 +481,33 @@ fluid_defsfont_load_sampledata(fluid_defsfont_t* sfont)
 {
   fluid_file fd;
   unsigned short endian;
+
+  /* I'm not sure this endian test is waterproof...  */
+  endian = 0x0100;
+
+#ifdef FLUID_SAMPLE_MMAP
+  /* On a little endian machine the samples can be used as they are in
+     the file, so map it rather than read the whole chunk: only the pages
+     of samples that get played are read in, and the OS is free to drop
+     them again under memory pressure. */
+  if (!((char *) &endian)[0] && !(sfont->samplepos & 1)) {
+    int fdn = open(sfont->filename, O_RDONLY);
+
+    if (fdn >= 0) {
+      size_t size = (size_t) sfont->samplepos + sfont->samplesize;
+      void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fdn, 0);
+
+      close(fdn);  /* the mapping keeps the file */
+      if (data != MAP_FAILED) {
+        sfont->mapping = data;
+        sfont->mappingsize = size;
+        sfont->sampledata = (short*) ((char*) data + sfont->samplepos);
+        return FLUID_OK;
+      }
+    }
+  }
+#endif
+
   fd = FLUID_FOPEN(sfont->filename, "rb");
   if (fd == NULL) {
     FLUID_LOG(FLUID_ERR, "Can't open soundfont file");
@@ -490,9 +532,6 @@ fluid_defsfont_load_sampledata(fluid_defsfont_t* sfont)
   }
   FLUID_FCLOSE(fd);
 
-  /* I'm not sure this endian test is waterproof...  */
-  endian = 0x0100;
-
   /* If this machine is big endian, the sample have to byte swapped  */
   if (((char *) &endian)[0]) {
     unsigned char* cbuf;
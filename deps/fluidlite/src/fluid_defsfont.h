@@ -482,7 +482,9 @@ struct _fluid_defsfont_t
   char* filename;           /* the filename of this soundfont */
   unsigned int samplepos;   /* the position in the file at which the sample data starts */
   unsigned int samplesize;  /* the size of the sample data */
-  short* sampledata;        /* the sample data, loaded in ram */
+  short* sampledata;        /* the sample data, loaded in ram or mapped */
+  void* mapping;            /* the file mapping sampledata points into, or NULL */
+  size_t mappingsize;       /* the size of that mapping */
   fluid_list_t* sample;      /* the samples in this soundfont */
   fluid_defpreset_t* preset; /* the presets of this soundfont */
 
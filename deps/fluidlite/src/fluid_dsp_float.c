@@ -46,6 +46,7 @@
 #include "fluidsynth_priv.h"
 #include "fluid_synth.h"
 #include "fluid_voice.h"
+#include "fluid_simd.h"
 
 
 /* Interpolation (find a value between two samples of the original waveform) */
@@ -56,6 +57,60 @@ static fluid_real_t interp_coeff_linear[FLUID_INTERP_MAX][2];
 /* 4th order (cubic) interpolation table (4 coefficients centered on 2nd) */
 static fluid_real_t interp_coeff[FLUID_INTERP_MAX][4];
 
+#ifdef FLUID_SIMD
+/* Four points of the 4th order interpolation at once: point k uses the
+ * coefficient row rows[k] and the samples data[index[k]-1 .. index[k]+2].
+ * The four products of each point are transposed into lanes and summed
+ * in the order the scalar loops use, ((c0*s0 + c1*s1) + c2*s2) + c3*s3,
+ * so without fused multiply-adds the result matches them exactly. */
+static void
+fluid_dsp_float_interpolate_4th_order_x4(fluid_real_t *out, const short int *data,
+                                         const unsigned int *index,
+                                         fluid_real_t * const *rows,
+                                         const fluid_real_t *amp)
+{
+#if defined(FLUID_SIMD_SSE2)
+  __m128 p0, p1, p2, p3;
+
+#define FLUID_POINT_PRODUCTS(k) \
+  _mm_mul_ps(_mm_loadu_ps(rows[k]), _mm_cvtepi32_ps(_mm_srai_epi32( \
+    _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *) (data + index[k] - 1)), \
+                       _mm_loadl_epi64((const __m128i *) (data + index[k] - 1))), 16)))
+
+  p0 = FLUID_POINT_PRODUCTS(0);
+  p1 = FLUID_POINT_PRODUCTS(1);
+  p2 = FLUID_POINT_PRODUCTS(2);
+  p3 = FLUID_POINT_PRODUCTS(3);
+#undef FLUID_POINT_PRODUCTS
+
+  _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+  _mm_storeu_ps(out, _mm_mul_ps(_mm_loadu_ps(amp),
+                                _mm_add_ps(_mm_add_ps(_mm_add_ps(p0, p1), p2), p3)));
+#else
+  float32x4_t p0, p1, p2, p3;
+  float32x4x2_t t01, t23;
+
+#define FLUID_POINT_PRODUCTS(k) \
+  vmulq_f32(vld1q_f32(rows[k]), vcvtq_f32_s32(vmovl_s16(vld1_s16(data + index[k] - 1))))
+
+  p0 = FLUID_POINT_PRODUCTS(0);
+  p1 = FLUID_POINT_PRODUCTS(1);
+  p2 = FLUID_POINT_PRODUCTS(2);
+  p3 = FLUID_POINT_PRODUCTS(3);
+#undef FLUID_POINT_PRODUCTS
+
+  t01 = vtrnq_f32(p0, p1);
+  t23 = vtrnq_f32(p2, p3);
+  p0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+  p1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+  p2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+  p3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+  vst1q_f32(out, vmulq_f32(vld1q_f32(amp),
+                           vaddq_f32(vaddq_f32(vaddq_f32(p0, p1), p2), p3)));
+#endif
+}
+#endif
+
 /* 7th order interpolation (7 coefficients centered on 3rd) */
 static fluid_real_t sinc_table7[FLUID_INTERP_MAX][7];
 
@@ -347,6 +402,42 @@ fluid_dsp_float_interpolate_4th_order (fluid_voice_t *voice)
       dsp_amp += dsp_amp_incr;
     }
 
+#ifdef FLUID_SIMD
+    /* interpolate the sequence four points at a time while all four of
+       them are in it; the scalar loop below finishes off */
+    while (dsp_i + 4 <= FLUID_BUFSIZE)
+    {
+      fluid_phase_t phase[4];
+      unsigned int index[4];
+      fluid_real_t *rows[4];
+      fluid_real_t amp[4];
+      int k;
+
+      phase[0] = dsp_phase;
+      for (k = 1; k < 4; k++)
+      {
+        phase[k] = phase[k-1];
+        fluid_phase_incr (phase[k], dsp_phase_incr);
+      }
+      if (fluid_phase_index (phase[3]) > end_index) break;
+
+      for (k = 0; k < 4; k++)
+      {
+        index[k] = fluid_phase_index (phase[k]);
+        rows[k] = interp_coeff[fluid_phase_fract_to_tablerow (phase[k])];
+        amp[k] = dsp_amp;
+        dsp_amp += dsp_amp_incr;
+      }
+      fluid_dsp_float_interpolate_4th_order_x4 (dsp_buf + dsp_i, dsp_data,
+                                                index, rows, amp);
+
+      dsp_phase = phase[3];
+      fluid_phase_incr (dsp_phase, dsp_phase_incr);
+      dsp_phase_index = fluid_phase_index (dsp_phase);
+      dsp_i += 4;
+    }
+#endif
+
     /* interpolate the sequence of sample points */
     for ( ; dsp_i < FLUID_BUFSIZE && dsp_phase_index <= end_index; dsp_i++)
     {
@@ -0,0 +1,48 @@
+/* FluidSynth - A Software Synthesizer
+ *
+ * Copyright (C) 2003  Peter Hanappe and others.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public License
+ * as published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307, USA
+ */
+
+
+#ifndef _FLUID_SIMD_H
+#define _FLUID_SIMD_H
+
+#include "fluid_config.h"
+
+/*
+ * Compile time selection of the vector instructions used by the voice
+ * DSP loops: FLUID_SIMD_SSE2 or FLUID_SIMD_NEON, and FLUID_SIMD for
+ * either. Only the float build has vector paths; with doubles, or
+ * without either instruction set, the plain C loops are used.
+ */
+
+#if defined(WITH_FLOAT)
+#if defined(__SSE2__)
+#define FLUID_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(HAVE_NEON) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define FLUID_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+#if defined(FLUID_SIMD_SSE2) || defined(FLUID_SIMD_NEON)
+#define FLUID_SIMD
+#endif
+
+#endif /* _FLUID_SIMD_H */
@@ -26,6 +26,7 @@
 #include "fluid_synth.h"
 #include "fluid_sys.h"
 #include "fluid_sfont.h"
+#include "fluid_simd.h"
 
 /* used for filter turn off optimization - if filter cutoff is above the
    specified value and filter q is below the other value, turn filter off */
@@ -51,6 +52,35 @@ static void fluid_voice_effects (fluid_voice_t *voice, int count,
 				        fluid_real_t* dsp_right_buf,
 				        fluid_real_t* dsp_reverb_buf,
 				        fluid_real_t* dsp_chorus_buf);
+/*
+ * fluid_voice_mix
+ *
+ * Adds gain * in to out, count samples; the pan, reverb and chorus
+ * sends of fluid_voice_effects all come down to this.
+ */
+static void
+fluid_voice_mix (fluid_real_t* out, const fluid_real_t* in,
+		 fluid_real_t gain, int count)
+{
+  int i = 0;
+
+#if defined(FLUID_SIMD_SSE2)
+  __m128 g = _mm_set1_ps(gain);
+
+  for ( ; i + 4 <= count; i += 4)
+    _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i),
+				      _mm_mul_ps(g, _mm_loadu_ps(in + i))));
+#elif defined(FLUID_SIMD_NEON)
+  float32x4_t g = vdupq_n_f32(gain);
+
+  for ( ; i + 4 <= count; i += 4)
+    vst1q_f32(out + i, vaddq_f32(vld1q_f32(out + i),
+				 vmulq_f32(g, vld1q_f32(in + i))));
+#endif
+  for ( ; i < count; i++)
+    out[i] += gain * in[i];
+}
+
 /*
  * new_fluid_voice
  */
@@ -138,6 +168,7 @@ fluid_voice_init(fluid_voice_t* voice, fluid_sample_t* sample,
   voice->channel = channel;
   voice->mod_count = 0;
   voice->sample = sample;
+  fluid_voice_optimize_sample(sample); /* only scans on the sample's first note */
   voice->start_time = start_time;
   voice->ticks = 0;
   voice->debug = 0;
@@ -656,7 +687,6 @@ fluid_voice_effects (fluid_voice_t *voice, int count,
 
   fluid_real_t dsp_centernode;
   int dsp_i;
-  float v;
 
   /* filter (implement the voice filter according to SoundFont standard) */
 
@@ -707,41 +737,25 @@ fluid_voice_effects (fluid_voice_t *voice, int count,
   if ((-0.5 < voice->pan) && (voice->pan < 0.5))
   {
     /* The voice is centered. Use voice->amp_left twice. */
-    for (dsp_i = 0; dsp_i < count; dsp_i++)
-    {
-      v = voice->amp_left * dsp_buf[dsp_i];
-      dsp_left_buf[dsp_i] += v;
-      dsp_right_buf[dsp_i] += v;
-    }
+    fluid_voice_mix (dsp_left_buf, dsp_buf, voice->amp_left, count);
+    fluid_voice_mix (dsp_right_buf, dsp_buf, voice->amp_left, count);
   }
   else	/* The voice is not centered. Stereo samples have one side zero. */
   {
     if (voice->amp_left != 0.0)
-    {
-      for (dsp_i = 0; dsp_i < count; dsp_i++)
-	dsp_left_buf[dsp_i] += voice->amp_left * dsp_buf[dsp_i];
-    }
+      fluid_voice_mix (dsp_left_buf, dsp_buf, voice->amp_left, count);
 
     if (voice->amp_right != 0.0)
-    {
-      for (dsp_i = 0; dsp_i < count; dsp_i++)
-	dsp_right_buf[dsp_i] += voice->amp_right * dsp_buf[dsp_i];
-    }
+      fluid_voice_mix (dsp_right_buf, dsp_buf, voice->amp_right, count);
   }
 
   /* reverb send. Buffer may be NULL. */
   if ((dsp_reverb_buf != NULL) && (voice->amp_reverb != 0.0))
-  {
-    for (dsp_i = 0; dsp_i < count; dsp_i++)
-      dsp_reverb_buf[dsp_i] += voice->amp_reverb * dsp_buf[dsp_i];
-  }
+    fluid_voice_mix (dsp_reverb_buf, dsp_buf, voice->amp_reverb, count);
 
   /* chorus send. Buffer may be NULL. */
   if ((dsp_chorus_buf != NULL) && (voice->amp_chorus != 0))
-  {
-    for (dsp_i = 0; dsp_i < count; dsp_i++)
-      dsp_chorus_buf[dsp_i] += voice->amp_chorus * dsp_buf[dsp_i];
-  }
+    fluid_voice_mix (dsp_chorus_buf, dsp_buf, voice->amp_chorus, count);
 
   voice->hist1 = dsp_hist1;
   voice->hist2 = dsp_hist2;
@@ -12,6 +12,7 @@
 #include <streams/file_stream.h>
 #include <array/rbuf.h>
 #include <compat/strl.h>
+#include <vfs/vfs_implementation.h>
 
 #if _MSC_VER
 #include <compat/msvc.h>
@@ -24,6 +25,7 @@
 #endif
 
 #include "libretro_core_options.h"
+#include "libretro_profile.h"
 
 /* prboom includes */
 
@@ -32,11 +34,16 @@
 #include "../src/m_argv.h"
 #include "../src/i_system.h"
 #include "../src/i_sound.h"
+#include "../src/i_jobs.h"
+#include "../src/i_thread.h"
+#include "../src/cacheplayer.h"
+#include "../src/flplayer.h"
 #include "../src/v_video.h"
 #include "../src/st_stuff.h"
 #include "../src/w_wad.h"
 #include "../src/r_draw.h"
 #include "../src/r_fps.h"
+#include "../src/r_main.h"
 #include "../src/lprintf.h"
 #include "../src/doomstat.h"
 #include "../src/m_cheat.h"
@@ -44,6 +51,9 @@
 #include "../src/wi_stuff.h"
 #include "../src/p_tick.h"
 #include "../src/z_zone.h"
+#include "../src/d_bench.h"
+#include "../src/d_net.h"
+#include "../src/m_bbox.h"
 
 /* Don't include file_stream_transforms.h but instead
 just forward declare the prototype */
@@ -77,13 +87,21 @@ void M_QuitDOOM(int choice);
 void D_DoomDeinit(void);
 void I_SetRes(void);
 void I_UpdateSound(void);
+void I_InitAudioCallbacks(retro_environment_t environ_cb, dbool use_callback);
+dbool I_AudioCallbackActive(void);
 void M_EndGame(int choice);
 
 retro_log_printf_t log_cb;
+// lprintf keeps messages back for I_FlushLog while retro_run runs
+static bool logdeferred;
+static i_mutex_t *logmutex;  // from retro_init to retro_deinit
+static void I_FlushLog(bool all);
+
 static retro_video_refresh_t video_cb;
 static retro_audio_sample_t audio_cb;
 retro_audio_sample_batch_t audio_batch_cb;
 static retro_environment_t environ_cb;
+static struct retro_perf_callback perf_cb;
 static retro_input_poll_t input_poll_cb;
 static retro_input_state_t input_state_cb;
 
@@ -270,6 +288,108 @@ void retro_set_rumble_touch(unsigned intensity, float duration)
    rumble_touch_strength = strength;
 }
 
+/* Directory listings FindFileInDir checks names against, each read once
+ * per loaded game instead of probing the disk for every candidate name.
+ * The IWAD search alone tries a dozen names in up to a dozen directories,
+ * and every music change repeats the search for its replacement files. */
+typedef struct dirindex_s {
+   struct dirindex_s *next;
+   char *dir;
+   char **names;  /* sorted with strcasecmp */
+   int numnames;
+   bool listed;   /* false if the directory couldn't be listed */
+} dirindex_t;
+
+static dirindex_t *dirindexes;
+
+static int DirIndexCmp(const void *a, const void *b)
+{
+   return strcasecmp(*(char *const *)a, *(char *const *)b);
+}
+
+static dirindex_t *GetDirIndex(const char *dir)
+{
+   dirindex_t *di;
+   libretro_vfs_implementation_dir *ds;
+   int maxnames = 0;
+
+   for (di = dirindexes; di; di = di->next)
+      if (!strcmp(di->dir, dir))
+         return di;
+
+   di           = calloc(1, sizeof(*di));
+   di->dir      = strdup(dir);
+   di->next     = dirindexes;
+   dirindexes   = di;
+
+   if (!(ds = retro_vfs_opendir_impl(dir, true)))
+      return di;
+
+   while (retro_vfs_readdir_impl(ds))
+   {
+      const char *name = retro_vfs_dirent_get_name_impl(ds);
+      if (!name)
+         continue;
+      if (di->numnames == maxnames)
+      {
+         maxnames  = maxnames ? maxnames * 2 : 64;
+         di->names = realloc(di->names, maxnames * sizeof(*di->names));
+      }
+      di->names[di->numnames++] = strdup(name);
+   }
+   retro_vfs_closedir_impl(ds);
+
+   qsort(di->names, di->numnames, sizeof(*di->names), DirIndexCmp);
+   di->listed = true;
+   return di;
+}
+
+static void FreeDirIndexes(void)
+{
+   while (dirindexes)
+   {
+      dirindex_t *di = dirindexes;
+      int i;
+      dirindexes = di->next;
+      for (i = 0; i < di->numnames; i++)
+         free(di->names[i]);
+      free(di->names);
+      free(di->dir);
+      free(di);
+   }
+}
+
+/* Whether path p, which is name in directory dir, exists. An exact match
+ * in the listing settles it without touching the disk, and no match in
+ * any case settles it the other way. A match in another case only exists
+ * on case-insensitive filesystems, so there it's left to the stat. */
+static bool DirIndexHas(const char *dir, const char *name, const char *p)
+{
+   dirindex_t *di;
+   char **hit;
+   int i, lo, hi;
+
+   if (!dir || strchr(name, '/') || strchr(name, '\\'))
+      return path_is_valid(p);
+
+   di = GetDirIndex(dir);
+   if (!di->listed)
+      return path_is_valid(p);
+
+   if (!(hit = bsearch(&name, di->names, di->numnames, sizeof(*di->names),
+               DirIndexCmp)))
+      return false;
+
+   for (lo = hi = hit - di->names;
+         lo > 0 && !strcasecmp(di->names[lo-1], name); lo--);
+   for (; hi < di->numnames-1 && !strcasecmp(di->names[hi+1], name); hi++);
+   for (i = lo; i <= hi; i++)
+      if (!strcmp(di->names[i], name))
+         return true;
+
+   return path_is_valid(p);
+}
+
 /**
  * FindFileInDir
  **
@@ -298,7 +418,7 @@ static char *FindFileInDir(const char* dir, const char* wfname, const char* ext)
    if (ext && ext[0] != '\0')
       strcat(p, ext);
 
-   if (path_is_valid(p))
+   if (DirIndexHas(dir, dir ? p + strlen(dir) + 1 : p, p))
    {
       if (log_cb)
          log_cb(RETRO_LOG_DEBUG, "FindFileInDir: found %s\n", p);
@@ -313,33 +433,126 @@ static char *FindFileInDir(const char* dir, const char* wfname, const char* ext)
 
 
 static bool libretro_supports_bitmasks = false;
+static bool libretro_can_dupe = false;
+// 0, or time the demo that's loaded: 1 drawing it, 2 not
+static int libretro_timedemo = 0;
+static int libretro_autotune = 0;  // 1 on the first launch, 2 on every one
+
+#if defined(PRBOOM_THREADS)
+// -1 for "auto": what -autotune picked, which is only known once
+// D_DoomMainSetup has loaded the config
+static int render_threads_option = 1, job_threads_option = 0;
+
+static void apply_thread_options(void)
+{
+   R_SetRenderThreads(render_threads_option >= 0 ? render_threads_option
+         : autotune_render_threads > 0 ? autotune_render_threads : 1);
+   I_SetJobThreads(job_threads_option >= 0 ? job_threads_option
+         : autotune_job_threads > 0 ? autotune_job_threads : 0);
+}
+#endif
+static bool libretro_audio_callback = false;
+
+//
+// Measured frame pacing
+//
+// With prboom-frame_time, the time the frontend reports for each frame
+// sets tic_vars.frac_step and sample_step for it, instead of 1/fps, so a
+// display whose refresh varies gets the view interpolated to when each
+// frame is shown. A frame is never taken for more than a tic; making up
+// a longer one is left to tic_catchup.
+//
+
+static bool frame_time_pacing = false;
+static retro_usec_t frame_time;         // last reported, 0 for none yet
+static retro_usec_t frame_time_reference;
+static unsigned frame_sample_rate;
+static int64_t frame_sample_rest;       // samples owed, times 1000000
+
+static void RETRO_CALLCONV I_FrameTime(retro_usec_t usec)
+{
+   frame_time = usec;
+}
+
+static void I_SetFrameTimeCallback(void)
+{
+   struct retro_frame_time_callback frame_cb;
+
+   frame_cb.callback  = I_FrameTime;
+   frame_cb.reference = 1000000 / tic_vars.fps;
+   if (frame_cb.reference != frame_time_reference &&
+       environ_cb(RETRO_ENVIRONMENT_SET_FRAME_TIME_CALLBACK, &frame_cb))
+      frame_time_reference = frame_cb.reference;
+}
+
+static void I_PaceFrame(void)
+{
+   int64_t usec = frame_time, samples;
+
+   if (!frame_time_pacing || !movement_smooth || usec <= 0 ||
+       !frame_time_reference)
+   {
+      tic_vars.frac_step = FRACUNIT * TICRATE / tic_vars.fps;
+      tic_vars.sample_step = frame_sample_rate / tic_vars.fps;
+      frame_sample_rest = 0;
+      return;
+   }
+
+   if (usec > 1000000 / TICRATE)
+      usec = 1000000 / TICRATE;
+   tic_vars.frac_step = (fixed_t)(usec * TICRATE * FRACUNIT / 1000000);
+
+   samples = usec * frame_sample_rate + frame_sample_rest;
+   tic_vars.sample_step = (fixed_t)(samples / 1000000);
+   frame_sample_rest = samples % 1000000;
+}
+
+/* savestate sizing, see retro_serialize_size */
+static bool serialize_variable = false;
+static size_t serialize_size = 0;
+static int serialize_level = -1;
 
 void retro_init(void)
 {
    unsigned level = 4;
-   enum retro_pixel_format rgb565;
+   enum retro_pixel_format pixfmt;
    struct retro_log_callback log;
 
    Z_Init(); /* 1/18/98 killough: start up memory stuff first */
+   logmutex = I_MutexCreate();
 
    if(environ_cb(RETRO_ENVIRONMENT_GET_LOG_INTERFACE, &log))
       log_cb = log.log;
    else
       log_cb = NULL;
 
-   rgb565 = RETRO_PIXEL_FORMAT_RGB565;
-   if(environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &rgb565) && log_cb)
+#ifdef PRBOOM_32BPP
+   // the screens are drawn in XRGB8888, so there is nothing to fall back to
+   pixfmt = RETRO_PIXEL_FORMAT_XRGB8888;
+   if(!environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &pixfmt) && log_cb)
+      log_cb(RETRO_LOG_ERROR, "Frontend does not support XRGB8888.\n");
+#else
+   pixfmt = RETRO_PIXEL_FORMAT_RGB565;
+   if(environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &pixfmt) && log_cb)
       log_cb(RETRO_LOG_DEBUG, "Frontend supports RGB565 - will use that instead of XRGB1555.\n");
+#endif
 
    if (environ_cb(RETRO_ENVIRONMENT_GET_INPUT_BITMASKS, NULL))
       libretro_supports_bitmasks = true;
 
+   if (!environ_cb(RETRO_ENVIRONMENT_GET_PERF_INTERFACE, &perf_cb))
+      perf_cb.get_time_usec = NULL;
+
+   if (!environ_cb(RETRO_ENVIRONMENT_GET_CAN_DUPE, &libretro_can_dupe))
+      libretro_can_dupe = false;
+
    environ_cb(RETRO_ENVIRONMENT_SET_PERFORMANCE_LEVEL, &level);
 }
 
 void retro_deinit(void)
 {
    libretro_supports_bitmasks = false;
+   libretro_can_dupe = false;
 
    retro_set_rumble_damage(0, 0.0f);
    retro_set_rumble_touch(0, 0.0f);
@@ -351,11 +564,18 @@ void retro_deinit(void)
    rumble_touch_strength  = 0;
    rumble_touch_counter   = -1;
 
+#ifdef RENDER_PROFILE
+   if (perf_cb.perf_log)
+      perf_cb.perf_log();
+#endif
+
    /* Z_Close() must be the very last
     * function that is called, since
     * z_zone.h overrides malloc()/free()/etc.
     * (i.e. anything that calls free()
     * after Z_Close() will likely segfault) */
+   I_MutexDestroy(logmutex);
+   logmutex = NULL;
    Z_Close();
 }
 
@@ -373,7 +593,7 @@ void retro_get_system_info(struct retro_system_info *info)
 #endif
    info->library_version  = "v2.5.0" GIT_VERSION;
    info->need_fullpath    = true;
-   info->valid_extensions = "wad|iwad|pwad|lmp";
+   info->valid_extensions = "wad|iwad|pwad|pk3|lmp";
    info->block_extract    = false;
 }
 
@@ -436,7 +656,7 @@ void retro_get_system_av_info(struct retro_system_av_info *info)
       info->timing.fps = TICRATE;
       break;
   }
-  info->timing.sample_rate    = 44100.0;
+  info->timing.sample_rate    = snd_outputrate;
   info->geometry.base_width   = SCREENWIDTH;
   info->geometry.base_height  = SCREENHEIGHT;
   info->geometry.max_width    = SCREENWIDTH;
@@ -531,6 +751,7 @@ void retro_set_video_refresh(retro_video_refresh_t cb)
 void retro_reset(void)
 {
    M_EndGame(0);
+   screen_dirty = TRUE;
 }
 
 extern dbool   quit_pressed;
@@ -563,6 +784,43 @@ static void update_variables(bool startup)
          SCREENWIDTH = 320;
          SCREENHEIGHT = 200;
       }
+
+      var.key = "prboom-audio_rate";
+      var.value = NULL;
+      snd_outputrate = 44100;
+      if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      {
+         int rate = atoi(var.value);
+         if (rate == 32000 || rate == 44100 || rate == 48000)
+            snd_outputrate = rate;
+      }
+
+      var.key = "prboom-audio_callback";
+      var.value = NULL;
+      libretro_audio_callback = environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value
+         && !strcmp(var.value, "enabled");
+
+      var.key = "prboom-timedemo";
+      var.value = NULL;
+      libretro_timedemo = 0;
+      if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      {
+         if (!strcmp(var.value, "enabled"))
+            libretro_timedemo = 1;
+         else if (!strcmp(var.value, "nodraw"))
+            libretro_timedemo = 2;
+      }
+
+      var.key = "prboom-autotune";
+      var.value = NULL;
+      libretro_autotune = 0;
+      if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      {
+         if (!strcmp(var.value, "first launch"))
+            libretro_autotune = 1;
+         else if (!strcmp(var.value, "every launch"))
+            libretro_autotune = 2;
+      }
    }
 
    var.key = "prboom-mouse_on";
@@ -604,6 +862,79 @@ static void update_variables(bool startup)
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
       analog_deadzone = (int)(atoi(var.value) * 0.01f * ANALOG_RANGE);
 
+   var.key = "prboom-music_cache";
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      mus_cache = !strcmp(var.value, "enabled");
+
+#if defined(HAVE_LIBFLUIDSYNTH)
+   var.key = "prboom-fluidsynth_budget";
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      mus_fluidsynth_budget = !strcmp(var.value, "enabled");
+#endif
+
+#if defined(PRBOOM_THREADS)
+   var.key = "prboom-render_threads";
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      render_threads_option = strcmp(var.value, "auto") ? atoi(var.value) : -1;
+
+   var.key = "prboom-job_threads";
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      job_threads_option = strcmp(var.value, "auto") ? atoi(var.value) : -1;
+
+   apply_thread_options();
+
+   var.key = "prboom-music_thread";
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      I_SetMusicThread(!strcmp(var.value, "enabled"));
+#endif
+
+   var.key = "prboom-dynamic_resolution";
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      R_SetDynamicResolution(atoi(var.value) * 1000);
+
+   var.key = "prboom-late_input";
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      late_input = !strcmp(var.value, "enabled");
+
+   var.key = "prboom-frame_time";
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      frame_time_pacing = !strcmp(var.value, "enabled");
+
+   var.key = "prboom-fast_forward";
+   var.value = NULL;
+   fastforward = 1;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value
+       && strcmp(var.value, "disabled"))
+      fastforward = atoi(var.value);
+
+   var.key = "prboom-demo_insurance";
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      G_SetDemoInsurance(!strcmp(var.value, "enabled"));
+
+   var.key = "prboom-thinker_batching";
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      P_SetThinkerBatching(!strcmp(var.value, "enabled"));
+
+   var.key = "prboom-frame_stats";
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      framestats = !strcmp(var.value, "enabled");
+
+   var.key = "prboom-battery_saver";
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      battery_saver = !strcmp(var.value, "enabled");
+
 #if defined(MEMORY_LOW)
    var.key = "prboom-purge_limit";
    var.value = NULL;
@@ -620,8 +951,14 @@ void I_SafeExit(int rc);
 void retro_run(void)
 {
    bool updated = false;
+
+   retro_profile_enter();
+   logdeferred = true;
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE, &updated) && updated)
+   {
       update_variables(false);
+      screen_dirty = TRUE;
+   }
 
    /* Check for pending cheats */
    if (cheats_pending && (gamestate == GS_LEVEL) && !demoplayback)
@@ -647,10 +984,21 @@ void retro_run(void)
    {
       environ_cb(RETRO_ENVIRONMENT_SHUTDOWN, NULL);
       I_SafeExit(1);
+      I_FlushLog(true);
+      logdeferred = false;
+      retro_profile_leave();
       return;
    }
+   D_StartFrameStats();
+   I_PaceFrame();
    D_DoomLoop();
-   I_UpdateSound();
+   I_UpdateMusic();
+   if (!I_AudioCallbackActive())
+   {
+      int64_t start = D_StageStart();
+      I_UpdateSound();
+      D_StageStop(BENCH_SOUND, start);
+   }
 
    if (rumble_damage_counter > -1)
    {
@@ -667,6 +1015,11 @@ void retro_run(void)
       if (rumble_touch_counter == 0)
          retro_set_rumble_touch(0, 0.0f);
    }
+
+   D_EndFrameStats();
+   I_FlushLog(false);
+   logdeferred = false;
+   retro_profile_leave();
 }
 
 static void extract_basename(char *buf, const char *path, size_t size)
@@ -753,6 +1106,19 @@ bool retro_load_game(const struct retro_game_info *info)
 
    update_variables(true);
 
+   // only taken at load: drawing a frame a tic needs less of the device
+   if (battery_saver)
+   {
+      unsigned level = 2;
+      environ_cb(RETRO_ENVIRONMENT_SET_PERFORMANCE_LEVEL, &level);
+   }
+
+   {
+      uint64_t quirks = RETRO_SERIALIZATION_QUIRK_CORE_VARIABLE_SIZE;
+      serialize_variable = environ_cb(RETRO_ENVIRONMENT_SET_SERIALIZATION_QUIRKS, &quirks)
+         && (quirks & RETRO_SERIALIZATION_QUIRK_FRONT_VARIABLE_SIZE);
+   }
+
    argv[argc++] = strdup("prboom");
 
    if(info->path)
@@ -771,8 +1137,10 @@ bool retro_load_game(const struct retro_game_info *info)
       if(strcasecmp(extension,"lmp") == 0)
       {
         // Play as a demo file lump
-        argv[argc++] = strdup("-playdemo");
+        argv[argc++] = strdup(libretro_timedemo ? "-timedemo" : "-playdemo");
         argv[argc++] = strdup(info->path);
+        if (libretro_timedemo == 2)
+           argv[argc++] = strdup("-nodraw");
       }
       else
       {
@@ -788,7 +1156,8 @@ bool retro_load_game(const struct retro_game_info *info)
             argv[argc++] = strdup("-iwad");
             argv[argc++] = strdup(g_basename);
          }
-         else if(!strncmp(header.identification, "PWAD", 4))
+         else if(!strncmp(header.identification, "PWAD", 4)
+               || !strncmp(header.identification, "PK\3\4", 4)) // a .pk3
          {
             argv[argc++] = strdup("-file");
             argv[argc++] = strdup(info->path);
@@ -835,6 +1204,13 @@ bool retro_load_game(const struct retro_game_info *info)
           strlcpy(g_save_dir, g_wad_dir, sizeof(g_save_dir));
    }
 
+   if (libretro_autotune)
+   {
+      argv[argc++] = "-autotune";
+      if (libretro_autotune == 1)
+         argv[argc++] = "once";
+   }
+
 #if DEBUG
    argv[argc++] = "-dehout";
    argv[argc++] = "-";
@@ -851,6 +1227,14 @@ bool retro_load_game(const struct retro_game_info *info)
    if (!D_DoomMainSetup())
       goto failed;
 
+#if defined(PRBOOM_THREADS)
+   // an "auto" thread count now has the config, and -autotune's
+   // trials are over
+   apply_thread_options();
+#endif
+
+   I_InitAudioCallbacks(environ_cb, libretro_audio_callback);
+
    // Run few cycles to finish init.
    for (i = 0; i < 3; i++)
      D_DoomLoop();
@@ -859,6 +1243,7 @@ bool retro_load_game(const struct retro_game_info *info)
    cheats_pending      = false;
    cheats_pending_list = NULL;
 
+   retro_profile_start();
    return true;
 
 failed:
@@ -883,7 +1268,11 @@ failed:
 
 void retro_unload_game(void)
 {
+   retro_profile_report(I_DoomExeDir());
+   R_SetRenderThreads(1);
+   I_SetJobThreads(0);
    D_DoomDeinit();
+   I_FlushLog(true);  // the counts of warnings still held back
 
    cheats_enabled = false;
    cheats_pending = false;
@@ -905,6 +1294,12 @@ void retro_unload_game(void)
 
    myargc     = 0;
    myargv     = NULL;
+
+   serialize_size  = 0;
+   serialize_level = -1;
+
+   /* The next game may come with files this one's search didn't see */
+   FreeDirIndexes();
 }
 
 unsigned retro_get_region(void)
@@ -979,7 +1374,7 @@ static menu_t *menus[] = {
 
 #define NUMKEYS 512
 extern dbool   gamekeydown[NUMKEYS];
-static bool old_input[MAX_BUTTON_BINDS];
+static uint32_t old_input;      // one bit a button, as last posted
 
 struct extra_serialize {
   uint32_t extra_size;
@@ -1007,9 +1402,35 @@ struct extra_serialize {
   uint8_t  gamekeydown[NUMKEYS];
 };
 
+/* Savestates are sized from the level being played. Frontends that take
+ * a size that changes within a session get what the level needs plus
+ * headroom, worked out again on entering a level or when the level
+ * outgrows it. Others, and rollback netplay, where the peers have to
+ * agree, keep the first size handed out, as libretro.h has it never
+ * grow, with the old fixed size as a floor.
+ */
+#define SERIALIZE_MIN_SIZE       (sizeof(struct extra_serialize) + 0x30000)
+#define SERIALIZE_HEADROOM(size) ((size)/4 + 0x4000)
+
 size_t retro_serialize_size(void)
 {
-  return sizeof(struct extra_serialize) + 0x30000;
+  size_t need = sizeof(struct extra_serialize) + G_SaveGameSize();
+  int level = gamestate == GS_LEVEL ? (gameepisode << 8) | gamemap : -1;
+  int context = RETRO_SAVESTATE_CONTEXT_NORMAL;
+
+  environ_cb(RETRO_ENVIRONMENT_GET_SAVESTATE_CONTEXT, &context);
+
+  if (serialize_variable && context != RETRO_SAVESTATE_CONTEXT_ROLLBACK_NETPLAY)
+  {
+    if (level != serialize_level || need > serialize_size)
+    {
+      serialize_size = need + SERIALIZE_HEADROOM(need);
+      serialize_level = level;
+    }
+  }
+  else if (!serialize_size)
+    serialize_size = MAX(need + SERIALIZE_HEADROOM(need), SERIALIZE_MIN_SIZE);
+  return serialize_size;
 }
 
 bool retro_serialize(void *data_, size_t size)
@@ -1054,7 +1475,7 @@ bool retro_serialize(void *data_, size_t size)
   for (i = 0; i < NUMKEYS; i++)
     extra->gamekeydown[i] = gamekeydown[i];
   for (i = 0; i < MAX_BUTTON_BINDS; i++)
-	extra->old_input[i] = old_input[i];
+	extra->old_input[i] = (old_input >> i) & 1;
   WI_Save(&extra->wi_state);
   return true;
 }
@@ -1099,12 +1520,15 @@ bool retro_unserialize(const void *data_, size_t size)
      set_menu_itemon = extra->set_menu_itemon;
      for (i = 0; i < NUMKEYS; i++)
         gamekeydown[i] = extra->gamekeydown[i];
+     old_input = 0;
      for (i = 0; i < MAX_BUTTON_BINDS; i++)
-        old_input[i] = extra->old_input[i];
+        if (extra->old_input[i])
+           old_input |= 1u << i;
      menuactive = extra->menuactive;
      tic_vars.frac = extra->gameticfrac;
   }
 
+  screen_dirty = TRUE;
   return true;
 }
 
@@ -1304,32 +1728,40 @@ static bool synthetic_pwm(int amplitude, int* modulation_state)
    return true;
 }
 
-static void process_gamepad_buttons(int16_t ret, unsigned num_buttons, action_lut_t action_lut[])
+static INLINE unsigned lowest_bit(uint32_t bits)
 {
-   unsigned i;
-   bool new_input[MAX_BUTTON_BINDS];
-
-   for (i = 0; i < num_buttons; i++)
+#if defined(__GNUC__)
+   return __builtin_ctz(bits);
+#else
+   unsigned n = 0;
+   while (!(bits & 1))
    {
-      event_t event = {0};
-      new_input[i]  = ret & (1 << i);
+      bits >>= 1;
+      n++;
+   }
+   return n;
+#endif
+}
 
-      if(new_input[i] && !old_input[i])
-      {
-         event.type = ev_keydown;
-         event.data1 = *((menuactive)? action_lut[i].menukey : action_lut[i].gamekey);
-      }
+// Diffs the buttons against those last posted a word at a time, and only
+// walks the ones that changed. ret is widened as it always was, so a
+// seventeenth button follows the sixteenth.
+static void process_gamepad_buttons(int16_t ret, unsigned num_buttons, action_lut_t action_lut[])
+{
+   uint32_t mask      = num_buttons < 32 ? (1u << num_buttons) - 1 : ~0u;
+   uint32_t new_input = (uint32_t)(int32_t)ret & mask;
+   uint32_t changed   = (new_input ^ old_input) & mask;
 
-      if(!new_input[i] && old_input[i])
-      {
-         event.type = ev_keyup;
-         event.data1 = *((menuactive)? action_lut[i].menukey : action_lut[i].gamekey);
-      }
+   old_input = (old_input & ~mask) | new_input;
 
-      if(event.type == ev_keydown || event.type == ev_keyup)
-         D_PostEvent(&event);
+   for (; changed; changed &= changed - 1)
+   {
+      unsigned i = lowest_bit(changed);
+      event_t event = {0};
 
-      old_input[i] = new_input[i];
+      event.type  = (new_input & (1u << i)) ? ev_keydown : ev_keyup;
+      event.data1 = *((menuactive)? action_lut[i].menukey : action_lut[i].gamekey);
+      D_PostEvent(&event);
    }
 }
 
@@ -1589,6 +2021,32 @@ void I_StartTic(void)
    process_input();
 }
 
+void I_LateInput(void)
+{
+   event_t event_mouse = {0};
+   int mx, my;
+
+   // only the mouse: the stick and keys give so much a poll, and would
+   // turn twice as fast read twice a frame
+   if (!input_poll_cb || !(mouse_on || doom_devices[0] == RETRO_DEVICE_KEYBOARD))
+      return;
+   input_poll_cb();
+
+   mx = input_state_cb(0, RETRO_DEVICE_MOUSE, 0, RETRO_DEVICE_ID_MOUSE_X);
+   my = input_state_cb(0, RETRO_DEVICE_MOUSE, 0, RETRO_DEVICE_ID_MOUSE_Y);
+   if (!mx && !my)
+      return;
+
+   event_mouse.type = ev_mouse;
+   event_mouse.data2 = mx * 4;
+   event_mouse.data3 = my * 4;
+   if (input_state_cb(0, RETRO_DEVICE_MOUSE, 0, RETRO_DEVICE_ID_MOUSE_LEFT))
+      event_mouse.data1 |= 1;
+   if (input_state_cb(0, RETRO_DEVICE_MOUSE, 0, RETRO_DEVICE_ID_MOUSE_RIGHT))
+      event_mouse.data1 |= 2;
+   D_PostEvent(&event_mouse);
+}
+
 static void I_UpdateVideoMode(void)
 {
    V_InitMode();
@@ -1603,13 +2061,21 @@ static void I_UpdateVideoMode(void)
    V_AllocScreens();
 
    R_InitBuffer(SCREENWIDTH, SCREENHEIGHT);
+   screen_dirty = TRUE;
 }
 
 void I_FinishUpdate (void)
 {
    if (!video_cb)
      return;
-   video_cb(screen_buf, SCREENWIDTH, SCREENHEIGHT, SCREENPITCH);
+
+   // nothing drew anything different, let the frontend show the last frame
+   if (!screen_dirty && dirtybox[BOXTOP] < dirtybox[BOXBOTTOM] && libretro_can_dupe)
+     video_cb(NULL, SCREENWIDTH, SCREENHEIGHT, SCREENPITCH);
+   else
+     video_cb(screen_buf, SCREENWIDTH, SCREENHEIGHT, SCREENPITCH);
+   screen_dirty = FALSE;
+   M_ClearBox(dirtybox);
 }
 
 void I_SetPalette(int pal) { }
@@ -1656,6 +2122,42 @@ void I_EndDisplay(void)
    InDisplay = false;
 }
 
+/*
+* I_GetTimeUS
+*
+* From the frontend's perf interface, when it has one
+*/
+int64_t I_GetTimeUS(void)
+{
+   return perf_cb.get_time_usec ? perf_cb.get_time_usec() : 0;
+}
+
+#ifdef RENDER_PROFILE
+#define MAX_PERF_COUNTERS 16
+
+static struct retro_perf_counter perf_counters[MAX_PERF_COUNTERS];
+
+void I_PerfStart(int counter, const char *name)
+{
+   struct retro_perf_counter *c = &perf_counters[counter];
+
+   if (!perf_cb.perf_register || counter >= MAX_PERF_COUNTERS)
+      return;
+   if (!c->registered)
+   {
+      c->ident = name;
+      perf_cb.perf_register(c);
+   }
+   perf_cb.perf_start(c);
+}
+
+void I_PerfStop(int counter)
+{
+   if (perf_cb.perf_stop && counter < MAX_PERF_COUNTERS && perf_counters[counter].registered)
+      perf_cb.perf_stop(&perf_counters[counter]);
+}
+#endif
+
 /*
 * I_GetRandomTimeSeed
 *
@@ -1752,10 +2254,18 @@ void I_Init(void)
    int i;
 
    if (!nosfxparm)
+   {
+      int phase = D_StartupBegin("I_InitSound");
       I_InitSound();
+      D_StartupEnd(phase);
+   }
 
    if (!nomusicparm)
+   {
+     int phase = D_StartupBegin("I_InitMusic");
      I_InitMusic();
+     D_StartupEnd(phase);
+   }
 
    for (i = 0; i < MAX_PADS; i++)
       doom_devices[i] = RETRO_DEVICE_JOYPAD;
@@ -1776,6 +2286,8 @@ void R_InitInterpolation(void)
      tic_vars.fps = info.timing.fps;
      tic_vars.frac_step = FRACUNIT * TICRATE / tic_vars.fps;
      tic_vars.sample_step = info.timing.sample_rate / tic_vars.fps;
+     frame_sample_rate = info.timing.sample_rate;
+     I_SetFrameTimeCallback();
 
      if (log_cb)
         log_cb(RETRO_LOG_DEBUG, "R_InitInterpolation: Framerate set to %.2f FPS\n", info.timing.fps);
@@ -1783,14 +2295,160 @@ void R_InitInterpolation(void)
   tic_vars.frac = FRACUNIT;
 }
 
+/* lprintf
+ *
+ * While retro_run runs, messages are copied into a buffer and handed to
+ * log_cb once the frame is done (I_FlushLog), as some frontends write
+ * each one to disk there and then. The lock is held only for the copy;
+ * a message that doesn't fit is counted and dropped. Errors, and any
+ * message outside retro_run, still go straight to log_cb.
+ *
+ * A warning that keeps firing (a short REJECT, a bad DEHACKED state) gets
+ * through LOG_BURST times a LOG_WINDOW frames; the rest of it is counted,
+ * and the count logged once the window has closed.
+ */
+
+#define LOG_BUFFER  (64*1024)
+#define LOG_BURST   8
+#define LOG_WINDOW  (4*TICRATE)
+#define LOG_SOURCES 64   // warnings told apart by their format string
+
+static char logbuf[2][LOG_BUFFER];  // a level byte, then the message
+static size_t logused;
+static int logfill;                 // which logbuf lprintf fills
+static unsigned logdropped;
+
+static void I_LogLock(void)
+{
+   if (logmutex)
+      I_MutexLock(logmutex);
+}
+
+static void I_LogUnlock(void)
+{
+   if (logmutex)
+      I_MutexUnlock(logmutex);
+}
+
+static struct {
+   const char *fmt;
+   unsigned frame, count;  // since the window opened
+} logsources[LOG_SOURCES];
+static unsigned logframe;
+static unsigned logsuppressed;  // of warnings that lost their slot
+
+// Whether a warning with this format may go out; under logmutex
+static bool I_LogAllowed(const char *fmt)
+{
+   unsigned slot = (unsigned)(((uintptr_t)fmt >> 3) % LOG_SOURCES);
+
+   if (logsources[slot].fmt != fmt)
+   {
+      if (logsources[slot].count > LOG_BURST)
+         logsuppressed += logsources[slot].count - LOG_BURST;
+      logsources[slot].fmt = fmt;
+      logsources[slot].frame = logframe;
+      logsources[slot].count = 0;
+   }
+   else if (logframe - logsources[slot].frame >= LOG_WINDOW &&
+         logsources[slot].count <= LOG_BURST)
+   {
+      logsources[slot].frame = logframe;
+      logsources[slot].count = 0;
+   }
+   return ++logsources[slot].count <= LOG_BURST;
+}
+
+/* I_FlushLog
+ *
+ * Hands what lprintf kept back to log_cb, and the counts of what it held
+ * back for good. Called from retro_run only.
+ */
+static void I_FlushLog(bool all)
+{
+   const char *p, *end;
+   unsigned dropped, suppressed, numrepeats = 0;
+   struct { const char *fmt; unsigned count; } repeats[LOG_SOURCES];
+   int i;
+
+   if (!log_cb)
+      return;
+
+   I_LogLock();
+   p = logbuf[logfill];
+   end = p + logused;
+   logfill ^= 1;
+   logused = 0;
+   dropped = logdropped;
+   logdropped = 0;
+   logframe++;
+   for (i = 0; i < LOG_SOURCES; i++)
+      if (logsources[i].count > LOG_BURST &&
+            (all || logframe - logsources[i].frame >= LOG_WINDOW))
+      {
+         repeats[numrepeats].fmt = logsources[i].fmt;
+         repeats[numrepeats++].count = logsources[i].count - LOG_BURST;
+         logsources[i].frame = logframe;
+         logsources[i].count = 0;
+      }
+   suppressed = logsuppressed;
+   logsuppressed = 0;
+   I_LogUnlock();
+
+   for (; p < end; p += strlen(p) + 1)
+   {
+      enum retro_log_level lvl = (enum retro_log_level)*p++;
+      log_cb(lvl, "%s", p);
+   }
+   if (dropped)
+      log_cb(RETRO_LOG_WARN, "lprintf: %u messages dropped\n", dropped);
+   for (i = 0; i < (int)numrepeats; i++)
+      log_cb(RETRO_LOG_WARN, "lprintf: %u more like \"%.*s\"\n", repeats[i].count,
+            (int)strcspn(repeats[i].fmt, "\n"), repeats[i].fmt);
+   if (suppressed)
+      log_cb(RETRO_LOG_WARN, "lprintf: %u more repeated warnings\n", suppressed);
+}
+
 int lprintf(OutputLevels pri, const char *s, ...)
 {
   va_list v;
   char msg[MAX_LOG_MESSAGE_SIZE];
+  enum retro_log_level lvl;
+  size_t len;
 
   if (!log_cb)
      return 0;
 
+  switch(pri)
+  {
+     case LO_DEBUG:
+        lvl = RETRO_LOG_DEBUG;
+        break;
+     case LO_CONFIRM:
+     case LO_INFO:
+        lvl = RETRO_LOG_INFO;
+        break;
+     case LO_WARN:
+        lvl = RETRO_LOG_WARN;
+        break;
+     case LO_ERROR:
+     case LO_FATAL:
+     default:
+        lvl = RETRO_LOG_ERROR;
+        break;
+  }
+
+  if (lvl == RETRO_LOG_WARN)
+  {
+     bool allowed;
+
+     I_LogLock();
+     allowed = I_LogAllowed(s);
+     I_LogUnlock();
+     if (!allowed)
+        return 0;
+  }
+
   va_start(v,s);
 #ifdef HAVE_VSNPRINTF
   vsnprintf(msg,sizeof(msg),s,v);
@@ -1799,30 +2457,25 @@ int lprintf(OutputLevels pri, const char *s, ...)
 #endif
   va_end(v);
 
-  if (log_cb)
+  if (!logdeferred || lvl == RETRO_LOG_ERROR)
   {
-     enum retro_log_level lvl;
-     switch(pri)
-     {
-        case LO_DEBUG:   
-           lvl = RETRO_LOG_DEBUG;
-           break;
-        case LO_CONFIRM:
-        case LO_INFO:
-           lvl = RETRO_LOG_INFO;
-           break;
-        case LO_WARN:
-           lvl = RETRO_LOG_WARN;
-           break;
-        case LO_ERROR:
-        case LO_FATAL:
-        default:
-           lvl = RETRO_LOG_ERROR;
-           break;
-     }
-
      log_cb(lvl, "%s", msg);
+     return 0;
+  }
+
+  len = strlen(msg) + 1;
+  I_LogLock();
+  if (logused + 1 + len <= LOG_BUFFER)
+  {
+     char *p = logbuf[logfill] + logused;
+
+     *p = (char)lvl;
+     memcpy(p + 1, msg, len);
+     logused += 1 + len;
   }
+  else
+     logdropped++;
+  I_LogUnlock();
 
   return 0;
 }
@@ -56,6 +56,21 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "320x200"
    },
+   {
+      "prboom-audio_rate",
+      "Audio Output Rate (Restart)",
+      NULL,
+      "Rate the sound effects and music are mixed at. Matching it to the frontend's audio device, usually 48000 Hz, saves the frontend resampling the sound again every frame.",
+      NULL,
+      NULL,
+      {
+         { "32000", "32000 Hz" },
+         { "44100", "44100 Hz" },
+         { "48000", "48000 Hz" },
+         { NULL, NULL },
+      },
+      "44100"
+   },
    {
       "prboom-mouse_on",
       "Mouse Active When Using Gamepad",
@@ -117,6 +132,255 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "15"
    },
+   {
+      "prboom-music_cache",
+      "Pre-rendered Music",
+      NULL,
+      "Renders each MIDI or MUS song once, when it is first played, and keeps it in the save directory to stream back with next to no CPU. For systems too slow to synthesize music live; the first play of each song waits while it renders.",
+      NULL,
+      NULL,
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+#if defined(HAVE_LIBFLUIDSYNTH)
+   {
+      "prboom-fluidsynth_budget",
+      "FluidSynth CPU Budget",
+      NULL,
+      "Watches how long FluidSynth takes to render music and, when a heavy passage falls behind, drops voices, then chorus and reverb, then interpolation quality. Quality comes back once the load eases.",
+      NULL,
+      NULL,
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+#endif
+#if defined(PRBOOM_THREADS)
+   {
+      "prboom-render_threads",
+      "Render Threads",
+      NULL,
+      "Splits the 3D view into vertical bands drawn in parallel by this many threads. Helps at high resolutions on multi-core systems.",
+      NULL,
+      NULL,
+      {
+         { "1", NULL },
+         { "2", NULL },
+         { "3", NULL },
+         { "4", NULL },
+         { "6", NULL },
+         { "8", NULL },
+         { "auto", "Auto (From Tuning)" },
+         { NULL, NULL },
+      },
+      "1"
+   },
+   {
+      "prboom-job_threads",
+      "Job Threads",
+      NULL,
+      "Threads shared by work the core can split into independent jobs. 0 runs every job on the main thread.",
+      NULL,
+      NULL,
+      {
+         { "0", NULL },
+         { "2", NULL },
+         { "3", NULL },
+         { "4", NULL },
+         { "6", NULL },
+         { "8", NULL },
+         { "auto", "Auto (From Tuning)" },
+         { NULL, NULL },
+      },
+      "0"
+   },
+   {
+      "prboom-music_thread",
+      "Threaded Music",
+      NULL,
+      "Renders music a few frames ahead on a separate thread, so slow synthesis (large FluidSynth soundfonts) doesn't cause frame drops. Adds a little latency to music starting and stopping.",
+      NULL,
+      NULL,
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+   {
+      "prboom-audio_callback",
+      "Audio Mixing (Restart)",
+      NULL,
+      "Mixes sound when the frontend asks for it rather than once every frame, so audio latency is no longer tied to frame pacing.",
+      NULL,
+      NULL,
+      {
+         { "disabled", "Per Frame" },
+         { "enabled",  "Frontend Callback" },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+#endif
+   {
+      "prboom-dynamic_resolution",
+      "Dynamic Resolution",
+      NULL,
+      "Draws the 3D view at a lower resolution, scaled up to fill the screen, while it takes longer than this to render. The status bar, HUD and menus keep the full resolution. Needs a frontend that provides a performance timer.",
+      NULL,
+      NULL,
+      {
+         { "disabled", NULL },
+         { "4",  "4 ms" },
+         { "6",  "6 ms" },
+         { "8",  "8 ms" },
+         { "10", "10 ms" },
+         { "12", "12 ms" },
+         { "16", "16 ms" },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+   {
+      "prboom-timedemo",
+      "Time Demos (Restart)",
+      NULL,
+      "Plays a loaded .lmp demo a tic a frame, as fast as the frontend runs the core, then quits. Totals for the game logic, the 3D view and the sound mixer go to the log and to timedemo.json in the system directory. Needs a frontend that provides a performance timer.",
+      NULL,
+      NULL,
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { "nodraw",   "Enabled, No Rendering" },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+   {
+      "prboom-autotune",
+      "Tune Render Settings (Restart)",
+      NULL,
+      "Times the 3D view from a few spots on the first map with each mix of wall and floor filtering and of render and job threads, and keeps the best looking filtering that fits the frame rate, with the fastest thread counts for it. Render Threads and Job Threads set to Auto use those counts. Every timing goes to autotune.json in the system directory. Takes some seconds as the core starts.",
+      NULL,
+      NULL,
+      {
+         { "disabled",     NULL },
+         { "first launch", "Once, on First Launch" },
+         { "every launch", "On Every Launch" },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+   {
+      "prboom-late_input",
+      "Late Mouse Input",
+      NULL,
+      "Reads the mouse again just before the 3D view is drawn, and points the view where the turning and looking done since the last game tic will take the player, instead of waiting for that tic to run. Cuts the view's lag behind the mouse by up to a tic. The game itself gets the same input as before.",
+      NULL,
+      NULL,
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+   {
+      "prboom-frame_time",
+      "Measured Frame Pacing",
+      NULL,
+      "Moves the game on, and mixes sound, by the time the frontend reports each frame took rather than by the fixed framerate, so interpolated frames on a variable refresh display land where they are shown. Only applies with a framerate above 35.",
+      NULL,
+      NULL,
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+   {
+      "prboom-fast_forward",
+      "Fast Forward",
+      NULL,
+      "Runs several tics of a level each frame, drawing and playing the sounds of only the last, to get quickly through demos and long stretches of a game. The tics are the same as at normal speed, so demos being recorded and saved games are unaffected. Menus, intermissions and netgames run at normal speed.",
+      NULL,
+      NULL,
+      {
+         { "disabled", NULL },
+         { "2",  "2x" },
+         { "4",  "4x" },
+         { "8",  "8x" },
+         { "16", "16x" },
+         { "32", "32x" },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+   {
+      "prboom-demo_insurance",
+      "Demo Sync Insurance",
+      NULL,
+      "Gives each kind of random event its own random number sequence, as demo_insurance 1 in prboom.cfg does, so that one kind no longer shifts the numbers another gets. Needed by 'Batch Light Thinkers'. Takes effect from the next new game; a saved game keeps the setting it was saved with.",
+      NULL,
+      NULL,
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+   {
+      "prboom-thinker_batching",
+      "Batch Light Thinkers",
+      NULL,
+      "Runs the flickering, flashing and glowing sector lights together after the rest of the game logic each tic, instead of one by one among the monsters and movers. Takes effect from the next level or saved game. Does nothing unless 'Demo Sync Insurance' is on (or demo_insurance is 1 in prboom.cfg), and never applies while playing a demo or in a netgame.",
+      NULL,
+      NULL,
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+   {
+      "prboom-frame_stats",
+      "Frame Time Statistics",
+      NULL,
+      "Keeps a histogram of frame times, split into game logic, rendering and sound, for each map played. When the map ends, the slowest 1% and 0.1% of frames and the count of frames over the frame budget are logged and added to framestats.csv.",
+      NULL,
+      NULL,
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+   {
+      "prboom-battery_saver",
+      "Battery Saver",
+      NULL,
+      "Draws a frame only when the game has moved on a tic, 35 times a second, showing the tic as it is, and has the frontend repeat it in between, whatever the frame rate. Saves power on handhelds at the cost of smooth motion. The log shows how many frames of each map were drawn, and Frame Time Statistics what they cost.",
+      NULL,
+      NULL,
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
 #if defined(MEMORY_LOW)
    {
       "prboom-purge_limit",
@@ -0,0 +1,367 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Job system on top of i_thread.h. Each thread owns a queue; it
+ *      takes its own newest job first and, with its queue empty, steals
+ *      the oldest job from another's. Jobs queued by threads outside
+ *      the pool go to the first queue, which the caller of I_JobWait
+ *      drains alongside the workers.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#include <stddef.h>
+
+#include "doomtype.h"
+#include "i_jobs.h"
+#include "i_thread.h"
+#include "lprintf.h"
+
+#ifdef PRBOOM_THREADS
+
+#define JOB_QUEUE_SIZE 256 // power of two
+
+typedef struct
+{
+   void (*func)(void *);
+   void *arg;
+   i_jobgroup_t *group;
+} job_t;
+
+typedef struct
+{
+   i_mutex_t *lock;
+   job_t jobs[JOB_QUEUE_SIZE];
+   unsigned head, tail;   // stolen from the head, taken by the owner from the tail
+   i_thread_t *thread;
+   int num;
+} jobqueue_t;
+
+static jobqueue_t jobqueues[MAX_JOB_THREADS];
+static int numjobthreads = 1;
+
+// Guards group counts, jobsqueued and jobsquit
+static i_mutex_t *jobslock;
+static i_cond_t *jobswake;   // jobs were queued, or the workers must quit
+static i_cond_t *jobsdone;   // a group finished
+static int jobsqueued;
+static int jobsquit;
+
+// This thread's queue; 0 on threads outside the pool
+static THREAD_LOCAL int jobself;
+
+static dbool I_JobTake(jobqueue_t *queue, job_t *job, dbool steal)
+{
+   dbool found = false;
+
+   I_MutexLock(queue->lock);
+   if (queue->head != queue->tail)
+   {
+      if (steal)
+         *job = queue->jobs[queue->head++ & (JOB_QUEUE_SIZE - 1)];
+      else
+         *job = queue->jobs[--queue->tail & (JOB_QUEUE_SIZE - 1)];
+      found = true;
+   }
+   I_MutexUnlock(queue->lock);
+   return found;
+}
+
+// Runs one queued job, if there is one; own queue first, then the others
+static dbool I_JobRunOne(int self)
+{
+   job_t job;
+   int i;
+
+   dbool found = I_JobTake(&jobqueues[self], &job, false);
+
+   for (i = 1; !found && i < numjobthreads; i++)
+      found = I_JobTake(&jobqueues[(self + i) % numjobthreads], &job, true);
+   if (!found)
+      return false;
+
+   I_MutexLock(jobslock);
+   jobsqueued--;
+   I_MutexUnlock(jobslock);
+
+   job.func(job.arg);
+
+   I_MutexLock(jobslock);
+   if (!--job.group->pending)
+      I_CondBroadcast(jobsdone);
+   I_MutexUnlock(jobslock);
+   return true;
+}
+
+static void I_JobWorker(void *arg)
+{
+   jobqueue_t *queue = arg;
+
+   jobself = queue->num;
+
+   for (;;)
+   {
+      I_MutexLock(jobslock);
+      while (!jobsquit && !jobsqueued)
+         I_CondWait(jobswake, jobslock);
+      if (jobsquit)
+      {
+         I_MutexUnlock(jobslock);
+         return;
+      }
+      I_MutexUnlock(jobslock);
+
+      I_JobRunOne(queue->num);
+   }
+}
+
+static void I_StopJobThreads(void)
+{
+   int i;
+
+   if (numjobthreads <= 1)
+      return;
+
+   I_MutexLock(jobslock);
+   jobsquit = true;
+   I_CondBroadcast(jobswake);
+   I_MutexUnlock(jobslock);
+
+   for (i = 1; i < numjobthreads; i++)
+   {
+      I_ThreadJoin(jobqueues[i].thread);
+      jobqueues[i].thread = NULL;
+   }
+
+   numjobthreads = 1;
+   jobsquit = false;
+}
+
+void I_SetJobThreads(int count)
+{
+   int i;
+
+   if (count < 1)
+      count = 1;
+   if (count > MAX_JOB_THREADS)
+      count = MAX_JOB_THREADS;
+   if (count == numjobthreads)
+      return;
+
+   I_StopJobThreads();
+
+   if (count == 1)
+      return;
+
+   if (!jobslock)
+   {
+      jobslock = I_MutexCreate();
+      jobswake = I_CondCreate();
+      jobsdone = I_CondCreate();
+      for (i = 0; i < MAX_JOB_THREADS; i++)
+      {
+         jobqueues[i].num = i;
+         jobqueues[i].lock = I_MutexCreate();
+         if (!jobqueues[i].lock)
+            break;
+      }
+      if (!jobslock || !jobswake || !jobsdone || i < MAX_JOB_THREADS)
+      {
+         lprintf(LO_WARN, "I_SetJobThreads: threads unavailable\n");
+         jobslock = NULL;
+         return;
+      }
+   }
+
+   // The pool grows one thread at a time, so a worker never steals
+   // from a queue that isn't there yet
+   for (i = 1; i < count; i++)
+   {
+      if (!(jobqueues[i].thread = I_ThreadCreate(I_JobWorker, &jobqueues[i])))
+         break;
+      I_MutexLock(jobslock);
+      numjobthreads = i + 1;
+      I_MutexUnlock(jobslock);
+   }
+
+   if (numjobthreads != count)
+      lprintf(LO_WARN, "I_SetJobThreads: only %d of %d threads started\n",
+            numjobthreads, count);
+}
+
+int I_JobThreads(void)
+{
+   return numjobthreads;
+}
+
+void I_JobGroupInit(i_jobgroup_t *group)
+{
+   group->pending = 0;
+}
+
+void I_JobRun(i_jobgroup_t *group, void (*func)(void *), void *arg)
+{
+   jobqueue_t *queue = &jobqueues[jobself];
+   dbool queued = false;
+
+   if (numjobthreads <= 1)
+   {
+      func(arg);
+      return;
+   }
+
+   // Counted before it can be taken, so a job queuing more on its own
+   // group never lets the count reach zero early
+   I_MutexLock(jobslock);
+   group->pending++;
+   I_MutexUnlock(jobslock);
+
+   I_MutexLock(queue->lock);
+   if (queue->tail - queue->head < JOB_QUEUE_SIZE)
+   {
+      job_t *job = &queue->jobs[queue->tail++ & (JOB_QUEUE_SIZE - 1)];
+
+      job->func = func;
+      job->arg = arg;
+      job->group = group;
+      queued = true;
+   }
+   I_MutexUnlock(queue->lock);
+
+   I_MutexLock(jobslock);
+   if (queued)
+   {
+      jobsqueued++;
+      I_CondSignal(jobswake);
+   }
+   else
+      group->pending--;
+   I_MutexUnlock(jobslock);
+
+   // A full queue runs the job right here
+   if (!queued)
+      func(arg);
+}
+
+void I_JobWait(i_jobgroup_t *group)
+{
+   if (numjobthreads <= 1)
+      return;
+
+   for (;;)
+   {
+      int pending;
+
+      I_MutexLock(jobslock);
+      pending = group->pending;
+      I_MutexUnlock(jobslock);
+
+      if (!pending)
+         return;
+
+      // Help out while there's anything to take, then sleep until the
+      // jobs still running elsewhere are done
+      if (!I_JobRunOne(jobself))
+      {
+         I_MutexLock(jobslock);
+         while (group->pending && !jobsqueued)
+            I_CondWait(jobsdone, jobslock);
+         I_MutexUnlock(jobslock);
+      }
+   }
+}
+
+#else /* !PRBOOM_THREADS */
+
+void I_SetJobThreads(int count) {}
+int I_JobThreads(void) { return 1; }
+void I_JobGroupInit(i_jobgroup_t *group) { group->pending = 0; }
+void I_JobRun(i_jobgroup_t *group, void (*func)(void *), void *arg) { func(arg); }
+void I_JobWait(i_jobgroup_t *group) {}
+
+#endif
+
+typedef struct
+{
+   void (*func)(void *, int);
+   void *arg;
+   int next, count;
+} jobfor_t;
+
+static int I_JobForNext(jobfor_t *jf)
+{
+   int i;
+
+#ifdef PRBOOM_THREADS
+   I_MutexLock(jobslock);
+#endif
+   i = jf->next < jf->count ? jf->next++ : -1;
+#ifdef PRBOOM_THREADS
+   I_MutexUnlock(jobslock);
+#endif
+   return i;
+}
+
+static void I_JobForWorker(void *arg)
+{
+   jobfor_t *jf = arg;
+   int i;
+
+   while ((i = I_JobForNext(jf)) >= 0)
+      jf->func(jf->arg, i);
+}
+
+void I_JobParallelFor(int count, void (*func)(void *, int), void *arg)
+{
+   i_jobgroup_t group;
+   jobfor_t jf;
+   int i, helpers;
+
+   if (I_JobThreads() <= 1 || count <= 1)
+   {
+      for (i = 0; i < count; i++)
+         func(arg, i);
+      return;
+   }
+
+   jf.func = func;
+   jf.arg = arg;
+   jf.next = 0;
+   jf.count = count;
+
+   // Indices are handed out one at a time to whichever thread is free
+   helpers = I_JobThreads() - 1;
+   if (helpers > count - 1)
+      helpers = count - 1;
+
+   I_JobGroupInit(&group);
+   for (i = 0; i < helpers; i++)
+      I_JobRun(&group, I_JobForWorker, &jf);
+   I_JobForWorker(&jf);
+   I_JobWait(&group);
+}
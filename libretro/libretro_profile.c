@@ -0,0 +1,370 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Sampling profiler for the libretro port (see libretro_profile.h).
+ *
+ *      The samples are program counters, symbolized at report time from
+ *      the core's own ELF symbol table, so static functions get their
+ *      names too; addresses outside the core go through dladdr. Built
+ *      with _GNU_SOURCE (see the Makefile) for dladdr and the register
+ *      names in ucontext_t.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#include "libretro_profile.h"
+
+#if defined(SAMPLE_PROFILE) && defined(__linux__)
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <dlfcn.h>
+#include <link.h>
+#include <ucontext.h>
+#include <sys/time.h>
+
+#include <libretro.h>
+#include <retro_miscellaneous.h>
+#include <streams/file_stream.h>
+
+extern retro_log_printf_t log_cb;
+
+// Samples a second of the thread's CPU time, and how many are kept
+#define PROFILE_HZ         1000
+#define PROFILE_MAXSAMPLES (1<<18)
+// Lines of the report that also go to the log
+#define PROFILE_LOGLINES   20
+
+static uintptr_t samples[PROFILE_MAXSAMPLES];
+static volatile int numsamples;
+static volatile sig_atomic_t sampling, overflowed;
+static pthread_t runthread;
+static bool started;
+
+static uintptr_t retro_profile_pc(const ucontext_t *uc)
+{
+#if defined(__x86_64__)
+   return uc->uc_mcontext.gregs[REG_RIP];
+#elif defined(__i386__)
+   return uc->uc_mcontext.gregs[REG_EIP];
+#elif defined(__aarch64__)
+   return uc->uc_mcontext.pc;
+#elif defined(__arm__)
+   return uc->uc_mcontext.arm_pc;
+#else
+   (void)uc;
+   return 0;
+#endif
+}
+
+static void retro_profile_signal(int sig, siginfo_t *info, void *context)
+{
+   uintptr_t pc;
+
+   (void)sig;
+   (void)info;
+   if (!sampling || !pthread_equal(pthread_self(), runthread))
+      return;
+   if (numsamples == PROFILE_MAXSAMPLES)
+   {
+      overflowed = 1;
+      return;
+   }
+   if ((pc = retro_profile_pc(context)))
+      samples[numsamples++] = pc;
+}
+
+void retro_profile_start(void)
+{
+   struct sigaction sa;
+   struct itimerval it;
+
+   if (started)
+      return;
+
+   memset(&sa, 0, sizeof(sa));
+   sa.sa_sigaction = retro_profile_signal;
+   sa.sa_flags     = SA_SIGINFO | SA_RESTART;
+   sigemptyset(&sa.sa_mask);
+   if (sigaction(SIGPROF, &sa, NULL))
+      return;
+
+   it.it_interval.tv_sec  = 0;
+   it.it_interval.tv_usec = 1000000 / PROFILE_HZ;
+   it.it_value            = it.it_interval;
+   if (setitimer(ITIMER_PROF, &it, NULL))
+      return;
+
+   started = true;
+}
+
+void retro_profile_enter(void)
+{
+   runthread = pthread_self();
+   sampling  = 1;
+}
+
+void retro_profile_leave(void)
+{
+   sampling = 0;
+}
+
+typedef struct {
+   uintptr_t addr, size;
+   const char *name;
+   int count;
+} profilefunc_t;
+
+static int retro_profile_addrcmp(const void *a, const void *b)
+{
+   const profilefunc_t *fa = a, *fb = b;
+   return fa->addr < fb->addr ? -1 : fa->addr > fb->addr;
+}
+
+static int retro_profile_countcmp(const void *a, const void *b)
+{
+   const profilefunc_t *fa = a, *fb = b;
+   return fb->count - fa->count;
+}
+
+// The functions in the ELF file image's symbol table (the dynamic one if
+// it's been stripped), sorted by address. ELF32_ST_TYPE serves both
+// classes.
+static profilefunc_t *retro_profile_symbols(const uint8_t *image, int64_t len,
+                                            int *numfuncs)
+{
+   const ElfW(Ehdr) *eh = (const ElfW(Ehdr) *)image;
+   const ElfW(Shdr) *sh, *symsec = NULL;
+   profilefunc_t *funcs;
+   int i, n, max;
+
+   *numfuncs = 0;
+   if (len < (int64_t)sizeof(*eh) || memcmp(eh->e_ident, ELFMAG, SELFMAG) ||
+       eh->e_shentsize != sizeof(*sh) ||
+       eh->e_shoff + (int64_t)eh->e_shnum * sizeof(*sh) > (uint64_t)len)
+      return NULL;
+
+   sh = (const ElfW(Shdr) *)(image + eh->e_shoff);
+   for (i = 0; i < eh->e_shnum; i++)
+      if (sh[i].sh_type == SHT_SYMTAB ||
+          (sh[i].sh_type == SHT_DYNSYM && !symsec))
+         symsec = &sh[i];
+   if (!symsec || symsec->sh_link >= eh->e_shnum ||
+       symsec->sh_offset + symsec->sh_size > (uint64_t)len ||
+       sh[symsec->sh_link].sh_offset + sh[symsec->sh_link].sh_size > (uint64_t)len)
+      return NULL;
+
+   {
+      const ElfW(Sym) *sym = (const ElfW(Sym) *)(image + symsec->sh_offset);
+      const char *strtab = (const char *)image + sh[symsec->sh_link].sh_offset;
+      const size_t strsize = sh[symsec->sh_link].sh_size;
+
+      max   = symsec->sh_size / sizeof(*sym);
+      funcs = malloc((max + 1) * sizeof(*funcs));
+      for (i = n = 0; i < max; i++)
+         if (ELF32_ST_TYPE(sym[i].st_info) == STT_FUNC && sym[i].st_value &&
+             sym[i].st_size && sym[i].st_name < strsize)
+         {
+            funcs[n].addr  = sym[i].st_value;
+            funcs[n].size  = sym[i].st_size;
+            funcs[n].name  = strtab + sym[i].st_name;
+            funcs[n].count = 0;
+            n++;
+         }
+   }
+
+   qsort(funcs, n, sizeof(*funcs), retro_profile_addrcmp);
+   *numfuncs = n;
+   return funcs;
+}
+
+static profilefunc_t *retro_profile_find(profilefunc_t *funcs, int numfuncs,
+                                         uintptr_t addr)
+{
+   int lo = 0, hi = numfuncs - 1;
+
+   while (lo <= hi)
+   {
+      int mid = (lo + hi) / 2;
+
+      if (addr < funcs[mid].addr)
+         hi = mid - 1;
+      else if (addr >= funcs[mid].addr + funcs[mid].size)
+         lo = mid + 1;
+      else
+         return &funcs[mid];
+   }
+   return NULL;
+}
+
+// Name up to and including its first underscore: "R_", "P_", "mad_"...
+static int retro_profile_prefix(const char *name)
+{
+   const char *u = strchr(name, '_');
+   return u && u - name < 8 ? (int)(u - name) + 1 : (int)strlen(name);
+}
+
+void retro_profile_report(const char *dir)
+{
+   // Samples outside the core, by what dladdr makes of them
+   enum { MAXOTHERS = 64 };
+   profilefunc_t others[MAXOTHERS + 1], groups[64];
+   struct itimerval it;
+   profilefunc_t *funcs, *f;
+   int numfuncs, numothers = 0, numgroups = 0, total = numsamples;
+   char path[PATH_MAX_LENGTH];
+   uint8_t *image = NULL;
+   int64_t len = 0;
+   Dl_info self;
+   RFILE *out;
+   int i, j;
+
+   sampling = 0;
+   if (started)
+   {
+      memset(&it, 0, sizeof(it));
+      setitimer(ITIMER_PROF, &it, NULL);
+      started = false;
+   }
+   if (!total)
+      return;
+
+   if (!dladdr((void *)retro_profile_report, &self) ||
+       !filestream_read_file(self.dli_fname, (void **)&image, &len))
+   {
+      if (log_cb)
+         log_cb(RETRO_LOG_WARN, "retro_profile_report: can't read the core's symbols\n");
+      image = NULL;
+      len   = 0;
+   }
+   funcs = image ? retro_profile_symbols(image, len, &numfuncs) : NULL;
+   if (!funcs)
+      numfuncs = 0;
+
+   others[MAXOTHERS].name  = "[elsewhere]";
+   others[MAXOTHERS].count = 0;
+   for (i = 0; i < total; i++)
+   {
+      Dl_info info;
+      const char *name;
+
+      if ((f = retro_profile_find(funcs, numfuncs, samples[i] - (uintptr_t)self.dli_fbase)))
+      {
+         f->count++;
+         continue;
+      }
+      name = dladdr((void *)samples[i], &info) && info.dli_sname ?
+         info.dli_sname : "[elsewhere]";
+      for (j = 0; j < numothers && strcmp(others[j].name, name); j++);
+      if (j == numothers)
+      {
+         if (numothers == MAXOTHERS)
+            j = MAXOTHERS;
+         else
+         {
+            others[j].name  = name;
+            others[j].count = 0;
+            numothers++;
+         }
+      }
+      others[j].count++;
+   }
+
+   // Fold everything into funcs, then total it up by name prefix
+   funcs = realloc(funcs, (numfuncs + numothers + 1) * sizeof(*funcs));
+   memcpy(funcs + numfuncs, others, numothers * sizeof(*funcs));
+   numfuncs += numothers;
+   funcs[numfuncs++] = others[MAXOTHERS];
+   qsort(funcs, numfuncs, sizeof(*funcs), retro_profile_countcmp);
+   while (numfuncs && !funcs[numfuncs-1].count)
+      numfuncs--;
+
+   for (i = 0; i < numfuncs; i++)
+   {
+      int plen = retro_profile_prefix(funcs[i].name);
+
+      for (j = 0; j < numgroups; j++)
+         if ((int)groups[j].size == plen && !strncmp(groups[j].name, funcs[i].name, plen))
+            break;
+      if (j == numgroups)
+      {
+         if (numgroups == (int)(sizeof(groups) / sizeof(*groups)))
+            continue;
+         groups[j].name  = funcs[i].name;
+         groups[j].size  = plen;
+         groups[j].count = 0;
+         numgroups++;
+      }
+      groups[j].count += funcs[i].count;
+   }
+   qsort(groups, numgroups, sizeof(*groups), retro_profile_countcmp);
+
+   if (log_cb)
+   {
+      log_cb(RETRO_LOG_INFO, "retro_profile_report: %d samples%s\n", total,
+            overflowed ? " (buffer filled, later ones dropped)" : "");
+      for (i = 0; i < numfuncs && i < PROFILE_LOGLINES; i++)
+         log_cb(RETRO_LOG_INFO, "  %5.1f%%  %s\n",
+               funcs[i].count * 100.0 / total, funcs[i].name);
+   }
+
+   snprintf(path, sizeof(path), "%s%cprofile.txt", dir,
+#ifdef _WIN32
+         '\\'
+#else
+         '/'
+#endif
+         );
+   if ((out = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      filestream_printf(out, "%d samples at %d Hz%s\n\nBy prefix:\n", total,
+            PROFILE_HZ, overflowed ? ", buffer filled and later ones dropped" : "");
+      for (i = 0; i < numgroups; i++)
+         filestream_printf(out, "%8d %5.1f%%  %.*s\n", groups[i].count,
+               groups[i].count * 100.0 / total, (int)groups[i].size, groups[i].name);
+      filestream_printf(out, "\nBy function:\n");
+      for (i = 0; i < numfuncs; i++)
+         filestream_printf(out, "%8d %5.1f%%  %s\n", funcs[i].count,
+               funcs[i].count * 100.0 / total, funcs[i].name);
+      filestream_close(out);
+   }
+   else if (log_cb)
+      log_cb(RETRO_LOG_WARN, "retro_profile_report: couldn't write %s\n", path);
+
+   free(funcs);
+   free(image);
+   numsamples = 0;
+   overflowed = 0;
+}
+
+#endif
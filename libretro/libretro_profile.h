@@ -0,0 +1,61 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Sampling profiler for the libretro port, in WANT_SAMPLE_PROFILE
+ *      builds on Linux and Android: a SIGPROF timer notes where retro_run's
+ *      thread is, and the samples are written out per function to
+ *      profile.txt when the game is unloaded. For devices that can't run
+ *      an external profiler. Compiles to nothing otherwise.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#ifndef __LIBRETRO_PROFILE__
+#define __LIBRETRO_PROFILE__
+
+#if defined(SAMPLE_PROFILE) && defined(__linux__)
+
+// Starts the timer; samples are only kept between enter and leave, on the
+// thread that called enter
+void retro_profile_start(void);
+void retro_profile_enter(void);
+void retro_profile_leave(void);
+
+// Stops the timer, writes dir/profile.txt and forgets the samples
+void retro_profile_report(const char *dir);
+
+#else
+
+#define retro_profile_start()
+#define retro_profile_enter()
+#define retro_profile_leave()
+#define retro_profile_report(dir)
+
+#endif
+
+#endif
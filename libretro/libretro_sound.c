@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #ifdef _WIN32
@@ -15,6 +16,8 @@
 #include "../src/flplayer.h"
 #include "../src/oplplayer.h"
 #include "../src/madplayer.h"
+#include "../src/vbplayer.h"
+#include "../src/cacheplayer.h"
 
 #include "../src/lprintf.h"
 #include "../src/doomdef.h"
@@ -25,13 +28,25 @@
 #include "../src/z_zone.h"
 
 #include "../src/mus2mid.h"
-
-#define SAMPLERATE    		(4 * 11025)
-#define SAMPLECOUNT_35		(SAMPLERATE / 35)
+#include "../src/r_simd.h"
+#include "../src/i_thread.h"
+
+// The mixer and every music player run at snd_outputrate, which the
+// frontend is told in retro_get_system_av_info, so the stream needs no
+// resampling past the sound effects' own to it
+#define MAXOUTPUTRATE		48000
+#define SAMPLECOUNT_35		(snd_outputrate / 35)
+#define MAXSAMPLECOUNT_35	(MAXOUTPUTRATE / 35)
 #define NUM_CHANNELS		32
+
+// Handles carry their channel in the low bits, so finding a handle's
+// channel is a lookup; the rest is a serial number so stale handles miss
+#define HANDLE_CHANNEL(handle) ((handle) & (NUM_CHANNELS - 1))
+
 #define BUFMUL           4
-#define MIXBUFFERSIZE   (SAMPLECOUNT_35*BUFMUL)
+#define MIXBUFFERSIZE   (MAXSAMPLECOUNT_35*BUFMUL)
 #define MAX_CHANNELS    32
+#define MAXMIXFRAMES    (MIXBUFFERSIZE/2)
 
 static const void *music_handle;
 static void *song_data;
@@ -46,6 +61,7 @@ int lengths[NUMSFX];
 int snd_card = 1;
 int mus_card = 0;
 int snd_samplerate= 11025;
+int snd_outputrate = 44100;
 
 typedef struct
 {
@@ -89,6 +105,9 @@ static const music_player_t *music_players[] =
   &fl_player, // flplayer.h
 #endif
   &opl_synth_player, // oplplayer.h
+#if defined(HAVE_LIBVORBIS) || defined(HAVE_LIBTREMOR)
+  &vb_player, // vbplayer.h
+#endif
 #ifdef HAVE_LIBMAD
   &mp_player, // madplayer.h
 #endif
@@ -103,56 +122,70 @@ static channel_t channels[NUM_CHANNELS];
 
 int vol_lookup[128*256];
 
-static double R_ceil(double x)
+/* i_sound */
+
+/* Sound effects are resampled to the output rate the first time they
+ * are started, into chunks that are only freed all together by
+ * I_ShutdownSound. */
+#define SFXPOOL_CHUNK (256*1024)
+
+typedef struct sfxpool_s
 {
-   if (x > LONG_MAX)
-      return x; /* big floats are all ints */
-   return ((long)(x+(0.99999999999999997)));
-}
+   struct sfxpool_s *next;
+   size_t used, size;  // used counts from the chunk's own start
+} sfxpool_t;
 
+static sfxpool_t *sfxpool;
 
-static double R_floor(double x)
+static uint8_t *I_SfxPoolAlloc(size_t size)
 {
-   double y;
-   static const double twoTo52 = 4.50359962737049600e15;              /* 0x1p52 */
-   union {double f; uint64_t i;} u = {x};
-   int e = u.i >> 52 & 0x7ff;
+   uint8_t *p;
 
-   if (e >= 0x3ff+52 || x == 0)
-      return x;
-   /* y = int(x) - x, where int(x) is an integer neighbor of x */
-   if (u.i >> 63)
-      y = (double)(x - twoTo52) + twoTo52 - x;
-   else
-      y = (double)(x + twoTo52) - twoTo52 - x;
-   /* special case because of non-nearest rounding modes */
-   if (e <= 0x3ff-1)
-      return u.i >> 63 ? -1 : 0;
-   if (y > 0)
-      return x + y - 1;
-   return x + y;
+   if (!sfxpool || sfxpool->size - sfxpool->used < size)
+   {
+      size_t chunksize = sizeof(sfxpool_t) + size;
+      sfxpool_t *chunk;
+
+      if (chunksize < SFXPOOL_CHUNK)
+         chunksize = SFXPOOL_CHUNK;
+      chunk = malloc(chunksize);
+      chunk->next = sfxpool;
+      chunk->used = sizeof(sfxpool_t);
+      chunk->size = chunksize;
+      sfxpool = chunk;
+   }
+   p = (uint8_t*)sfxpool + sfxpool->used;
+   sfxpool->used += size;
+   return p;
 }
 
-/* i_sound */
+static void I_FreeSfxPool(void)
+{
+   while (sfxpool)
+   {
+      sfxpool_t *next = sfxpool->next;
+      free(sfxpool);
+      sfxpool = next;
+   }
+}
 
 /* This function loads the sound data from the WAD lump
- * for a single sound effect. */
+ * for a single sound effect, resampled to snd_outputrate. */
 static void* I_SndLoadSample(const char* sfxname, int* len)
 {
-    int i, x, padded_sfx_len, sfxlump_num, sfxlump_len;
+    int i, out_len, sfxlump_num, sfxlump_len;
     char sfxlump_name[20];
     const uint8_t *sfxlump_data, *sfxlump_sound;
-    uint8_t *padded_sfx_data;
+    uint8_t *out;
     uint16_t orig_rate;
-    float times;
+    uint32_t step, pos;
 
     sprintf (sfxlump_name, "DS%s", sfxname);
 
     // check if the sound lump exists
-    if (W_CheckNumForName(sfxlump_name) == -1)
+    if ((sfxlump_num = W_CheckNumForName(sfxlump_name)) == -1)
         return 0;
 
-    sfxlump_num = W_GetNumForName (sfxlump_name);
     sfxlump_len = W_LumpLength (sfxlump_num);
 
     // if it's not at least 9 bytes (8 byte header + at least 1 sample), it's
@@ -168,26 +201,45 @@ static void* I_SndLoadSample(const char* sfxname, int* len)
     /* get original sample rate from DMX header */
     memcpy(&orig_rate, sfxlump_data+2, 2);
     orig_rate       = SHORT (orig_rate);
+    if (!orig_rate)
+       orig_rate = 11025;
 
-    times           = 48000.0f / (float)orig_rate;
-
-    padded_sfx_len  = ((sfxlump_len * R_ceil(times) + (SAMPLECOUNT_35-1)) / SAMPLECOUNT_35) * SAMPLECOUNT_35;
-    padded_sfx_data = (uint8_t*)malloc(padded_sfx_len);
+    /* each output sample repeats the input sample it falls in, stepping
+     * through the input in 16.16 fixed point */
+    step    = ((uint32_t)orig_rate << 16) / snd_outputrate;
+    out_len = (int)(((int64_t)sfxlump_len * snd_outputrate + orig_rate - 1) / orig_rate);
+    out     = I_SfxPoolAlloc(out_len);
 
-    for (i = 0; i < padded_sfx_len; i++)
+    for (i = 0, pos = 0; i < out_len; i++, pos += step)
     {
-        x = R_floor ((float)i/times);
+        uint32_t x = pos >> 16;
 
-        if (x < sfxlump_len) // 8 was already subtracted
-            padded_sfx_data[i] = sfxlump_sound[x];
-        else
-            padded_sfx_data[i] = 128; // fill the rest with silence
+        out[i] = sfxlump_sound[x < (uint32_t)sfxlump_len ? x : (uint32_t)sfxlump_len - 1];
     }
 
-    Z_Free ((void*) sfxlump_data); //  free original lump
+    W_UnlockLumpNum (sfxlump_num);
 
-    *len = padded_sfx_len;
-    return (void *)(padded_sfx_data);
+    *len = out_len;
+    return (void *)out;
+}
+
+/* Resamples an effect, or the one it is linked to, the first time it is
+ * started. Effects that can't be loaded are remembered by a length of -1. */
+static dbool I_CacheSfx(int id)
+{
+   sfxinfo_t *sfx = &S_sfx[id];
+   sfxinfo_t *base = sfx->link ? sfx->link : sfx;
+   int baseid = base - S_sfx;
+
+   if (!base->data && lengths[baseid] >= 0)
+   {
+      base->data = I_SndLoadSample(base->name, &lengths[baseid]);
+      if (!base->data)
+         lengths[baseid] = -1;
+   }
+   sfx->data = base->data;
+   lengths[id] = lengths[baseid];
+   return sfx->data != NULL;
 }
 
 //
@@ -228,16 +280,6 @@ void I_SetSfxVolume(int volume)
    snd_SfxVolume = volume;
 }
 
-void I_SetMusicVolume(int volume)
-{
-   snd_MusicVolume = volume;
-
-#ifdef MUSIC_SUPPORT
-   if (current_player)
-      current_player->setvolume(volume);
-#endif
-}
-
 /* Retrieve the raw data lump index
  * for a given SFX name. */
 int I_GetSfxLumpNum(sfxinfo_t* sfx)
@@ -247,18 +289,40 @@ int I_GetSfxLumpNum(sfxinfo_t* sfx)
     return W_GetNumForName(namebuf);
 }
 
+//
+// With the frontend's audio callback, I_UpdateSound runs on whichever
+//  thread the frontend calls it from, so it and everything that touches
+//  the channels or the music players take soundlock. It is only created
+//  once the callback has been set, and without it these are no-ops.
+//
+
+#ifdef PRBOOM_THREADS
+static i_mutex_t *soundlock;
+
+static void I_LockSound(void)
+{
+   if (soundlock)
+      I_MutexLock(soundlock);
+}
+
+static void I_UnlockSound(void)
+{
+   if (soundlock)
+      I_MutexUnlock(soundlock);
+}
+#else
+static void I_LockSound(void) {}
+static void I_UnlockSound(void) {}
+#endif
+
 void I_StopSound (int handle)
 {
-    int i;
+    channel_t *channel = &channels[HANDLE_CHANNEL(handle)];
 
-    for (i = 0; i < NUM_CHANNELS; i++)
-    {
-        if (channels[i].handle == handle)
-        {
-            memset(&channels[i], 0, sizeof(channel_t));
-            return;
-        }
-    }
+    I_LockSound();
+    if (handle > 0 && channel->handle == handle)
+        memset(channel, 0, sizeof(channel_t));
+    I_UnlockSound();
 }
 
 //
@@ -275,13 +339,13 @@ void I_StopSound (int handle)
 //
 static int currenthandle = 0;
 
-int I_StartSound (int id, int channel, int vol, int sep, int pitch, int priority)
+static int I_AddSound (int id, int vol, int sep)
 {
     unsigned int i, oldestslot, oldesttics;
     int slot, rightvol, leftvol;
 
-    // this effect was not loaded.
-    if (!S_sfx[id].data)
+    // this effect could not be loaded.
+    if (!S_sfx[id].data && !I_CacheSfx(id))
         return -1;
 
     // Loop all channels to find a free slot.
@@ -308,7 +372,11 @@ int I_StartSound (int id, int channel, int vol, int sep, int pitch, int priority
     if (slot == -1)
         slot = oldestslot;
 
-    channels[slot].handle = ++currenthandle;
+    // never serial 0, which could collide with a free channel's handle
+    currenthandle = (currenthandle + 1) & (INT_MAX / NUM_CHANNELS);
+    if (!currenthandle)
+       currenthandle = 1;
+    channels[slot].handle = currenthandle * NUM_CHANNELS + slot;
 
     // Set pointers to raw sound data start & end.
     channels[slot].snd_start_ptr = (uint8_t*)S_sfx[id].data;
@@ -342,149 +410,397 @@ int I_StartSound (int id, int channel, int vol, int sep, int pitch, int priority
     //  e.g. for avoiding duplicates of chainsaw.
     channels[slot].sfxid = id;
 
-    return currenthandle;
+    return channels[slot].handle;
+}
+
+int I_StartSound (int id, int channel, int vol, int sep, int pitch, int priority)
+{
+    int handle;
+
+    I_LockSound();
+    handle = I_AddSound(id, vol, sep);
+    I_UnlockSound();
+    return handle;
 }
 
 dbool   I_SoundIsPlaying (int handle)
 {
-    int i;
+    return handle > 0 && channels[HANDLE_CHANNEL(handle)].handle == handle;
+}
 
-    for (i = 0; i < NUM_CHANNELS; i++)
-    {
-        if (channels[i].handle==handle)
-            return 1;
-    }
+//
+// I_MixChannel
+// Adds frames samples of a channel to the accumulator, left and right
+// alternating, and frees the channel once its sound has run out.
+//
+
+static void I_MixChannel(channel_t *channel, int32_t *accum, int frames)
+{
+   const uint8_t *src = channel->snd_start_ptr;
+   const int *leftvol = channel->leftvol;
+   const int *rightvol = channel->rightvol;
+   int i;
+
+   if (frames > channel->snd_end_ptr - src)
+      frames = channel->snd_end_ptr - src;
 
-    return 0;
+   for (i = 0; i < frames; i++)
+   {
+      uint8_t sample = src[i];
+
+      accum[i*2 + 0] += leftvol[sample];
+      accum[i*2 + 1] += rightvol[sample];
+   }
+
+   channel->snd_start_ptr += frames;
+   if (!(channel->snd_start_ptr < channel->snd_end_ptr))
+      memset(channel, 0, sizeof(channel_t));
 }
 
 //
-// This function loops all active (internal) sound
-//  channels, retrieves a given number of samples
-//  from the raw sound data, modifies it according
-//  to the current (internal) channel parameters,
-//  mixes the per channel samples into the global
-//  mixbuffer, clamping it to the allowed range,
-//  and sets up everything for transferring the
-//  contents of the mixbuffer to the (two)
-//  hardware channels (left and right, that is).
+// I_PackMix
+// Clamps the accumulated samples to 16 bits, as saturating packs do.
 //
-// This function currently supports only 16bit.
+
+static void I_PackMix(int16_t *out, const int32_t *accum, int count)
+{
+   int i = 0;
+
+#if defined(R_SIMD_SSE2)
+   for (; i + 8 <= count; i += 8)
+      _mm_storeu_si128((__m128i *)(out + i),
+            _mm_packs_epi32(_mm_loadu_si128((const __m128i *)(accum + i)),
+                            _mm_loadu_si128((const __m128i *)(accum + i + 4))));
+#elif defined(R_SIMD_NEON)
+   for (; i + 8 <= count; i += 8)
+      vst1q_s16(out + i, vcombine_s16(vqmovn_s32(vld1q_s32(accum + i)),
+                                      vqmovn_s32(vld1q_s32(accum + i + 4))));
+#endif
+
+   for (; i < count; i++)
+   {
+      int32_t d = accum[i];
+
+      if (d > 0x7fff)
+         out[i] = 0x7fff;
+      else if (d < -0x8000)
+         out[i] = -0x8000;
+      else
+         out[i] = d;
+   }
+}
+
+//
+// Music can be rendered ahead by a thread of its own, so a slow synth
+//  (FluidSynth with a big soundfont) doesn't hold up the frame: it fills
+//  a ring of a few tics' worth of samples, a tic at a time, that
+//  I_UpdateSound only copies out of. musiclock serialises the players
+//  between the thread's render and the music API below, which empties
+//  the ring (bar volume changes) so stops and song changes are heard
+//  at once;
+//  ringlock only covers the ring positions, so the mixer never waits
+//  on a render.
 //
 
-void I_UpdateSound(void)
+#if defined(MUSIC_SUPPORT) && defined(PRBOOM_THREADS)
+
+#define MUSICRING_FRAMES (SAMPLECOUNT_35 * 4)
+
+static int16_t musicring[MAXSAMPLECOUNT_35 * 4 * 2];
+static int ringread, ringwrite, ringcount;
+
+static i_thread_t *musicthread;
+static i_mutex_t *musiclock, *ringlock;
+static i_cond_t  *ringwake;
+static dbool     musicquit;
+
+static void I_MusicWorker(void *arg)
 {
-   // Mix current sound data. Data, from raw sound, for right and left.
-   uint8_t sample;
-   int dl, dr, frames, out_frames, step, chan;
-   int16_t mad_audio_buf[SAMPLECOUNT_35 * 2] = { 0 }; // initialize all zero
+   I_MutexLock(ringlock);
+   for (;;)
+   {
+      while (!musicquit && ringcount > MUSICRING_FRAMES - SAMPLECOUNT_35)
+         I_CondWait(ringwake, ringlock);
+      if (musicquit)
+         break;
+      I_MutexUnlock(ringlock);
+
+      // the ring can only be emptied under musiclock, so the space
+      //  found here is still free when the tic is published
+      I_MutexLock(musiclock);
+      I_MutexLock(ringlock);
+      if (ringcount <= MUSICRING_FRAMES - SAMPLECOUNT_35)
+      {
+         int16_t *out = musicring + ringwrite * 2;
 
-   // Pointers in global mixbuffer, left, right, end.
-   int16_t *leftend;
+         I_MutexUnlock(ringlock);
+         memset(out, 0, SAMPLECOUNT_35 * 4);
+         if (music_handle && current_player)
+            current_player->render(out, SAMPLECOUNT_35);
+         I_MutexLock(ringlock);
 
-   // Left and right channel are in global mixbuffer, alternating.
-   int16_t *leftout  = mixbuffer;
-   int16_t *rightout = mixbuffer+1;
-   step       = 2;
-   frames     = 0;
+         ringwrite = (ringwrite + SAMPLECOUNT_35) % MUSICRING_FRAMES;
+         ringcount += SAMPLECOUNT_35;
+      }
+      I_MutexUnlock(ringlock);
+      I_MutexUnlock(musiclock);
 
-   out_frames = (tic_vars.sample_step)? tic_vars.sample_step : SAMPLECOUNT_35;
+      I_MutexLock(ringlock);
+   }
+   I_MutexUnlock(ringlock);
+}
 
-#ifdef MUSIC_SUPPORT
-   if (music_handle && current_player)
-     current_player->render(mad_audio_buf, out_frames);
-   else
-#endif
-      memset(mad_audio_buf, 0, out_frames * 4);
+static void I_StopMusicThread(void)
+{
+   if (!musicthread)
+      return;
 
-   // Determine end, for left channel only (right channel is implicit).
-   leftend = mixbuffer + out_frames * step;
+   I_MutexLock(ringlock);
+   musicquit = TRUE;
+   I_CondSignal(ringwake);
+   I_MutexUnlock(ringlock);
 
-   // Mix sounds into the mixing buffer.
-   // Loop over step*SAMPLECOUNT, that is 512 values for two channels.
+   I_ThreadJoin(musicthread);
+   musicthread = NULL;
+   musicquit = FALSE;
+}
 
-   while (leftout <= leftend)
+void I_SetMusicThread(dbool on)
+{
+   if (!on)
    {
-      // Reset left/right value.
-      dl = mad_audio_buf[frames * 2 + 0];
-      dr = mad_audio_buf[frames * 2 + 1];
+      I_StopMusicThread();
+      return;
+   }
+   if (musicthread)
+      return;
+
+   if (!musiclock)
+   {
+      musiclock = I_MutexCreate();
+      ringlock  = I_MutexCreate();
+      ringwake  = I_CondCreate();
+   }
+   ringread = ringwrite = ringcount = 0;
+   if (!musiclock || !ringlock || !ringwake ||
+       !(musicthread = I_ThreadCreate(I_MusicWorker, NULL)))
+      lprintf(LO_WARN, "I_SetMusicThread: threads unavailable\n");
+}
 
-      for (chan=0; chan<NUM_CHANNELS; chan++)
+static void I_LockMusic(void)
+{
+   I_LockSound();
+   if (musicthread)
+      I_MutexLock(musiclock);
+}
+
+static void I_UnlockMusic(dbool flush)
+{
+   if (musicthread)
+   {
+      if (flush)
       {
-         // Check channel, if active.
-         if (channels[chan].snd_start_ptr)
-         {
-            // Get the raw data from the channel.
-            sample = *channels[chan].snd_start_ptr;
-
-            // Add left and right part for this channel (sound) to the
-            // current data. Adjust volume accordingly.
-            dl += channels[chan].leftvol[sample];
-            dr += channels[chan].rightvol[sample];
-
-            channels[chan].snd_start_ptr++;
-
-            if (!(channels[chan].snd_start_ptr < channels[chan].snd_end_ptr))
-               memset(&channels[chan], 0, sizeof(channel_t));
-         }
+         I_MutexLock(ringlock);
+         ringread = ringwrite = ringcount = 0;
+         I_CondSignal(ringwake);
+         I_MutexUnlock(ringlock);
       }
+      I_MutexUnlock(musiclock);
+   }
+   I_UnlockSound();
+}
 
-      // Clamp to range. Left hardware channel.
-      // Has been char instead of short.
-      // if (dl > 127) *leftout = 127;
-      // else if (dl < -128) *leftout = -128;
-      // else *leftout = dl;
+// Copies what the thread has rendered into the mix, silence past it
+static void I_ReadMusicRing(int32_t *accum, int frames)
+{
+   int i, pos, count;
 
-      if (dl > 0x7fff)
-         *leftout = 0x7fff;
-      else if (dl < -0x8000)
-         *leftout = -0x8000;
-      else
-         *leftout = dl;
+   I_MutexLock(ringlock);
+   pos = ringread;
+   count = ringcount < frames ? ringcount : frames;
+   I_MutexUnlock(ringlock);
 
-      // Same for right hardware channel.
-      if (dr > 0x7fff)
-         *rightout = 0x7fff;
-      else if (dr < -0x8000)
-         *rightout = -0x8000;
-      else
-         *rightout = dr;
+   for (i = 0; i < count; i++)
+   {
+      accum[i * 2]     = musicring[pos * 2];
+      accum[i * 2 + 1] = musicring[pos * 2 + 1];
+      if (++pos == MUSICRING_FRAMES)
+         pos = 0;
+   }
+   memset(accum + count * 2, 0, (frames - count) * 2 * sizeof(*accum));
+
+   I_MutexLock(ringlock);
+   ringread = pos;
+   ringcount -= count;
+   I_CondSignal(ringwake);
+   I_MutexUnlock(ringlock);
+}
+
+#else
+
+void I_SetMusicThread(dbool on) {}
+static void I_LockMusic(void) { I_LockSound(); }
+static void I_UnlockMusic(dbool flush) { I_UnlockSound(); }
+
+#endif
+
+//
+// What the frontend last reported of its audio buffer, if it does.
+//  Each block is normally the samples of a frame, but a buffer running
+//  low gets half as many again, to catch up in one batch rather than
+//  underrun, and one running full a quarter fewer, to bring latency
+//  back down.
+//
+
+static dbool    audiostatus, audiounderrun;
+static unsigned audiooccupancy;
+static dbool    audiocallback;
+
+static void RETRO_CALLCONV I_AudioBufferStatus(bool active, unsigned occupancy,
+      bool underrun_likely)
+{
+   audiostatus    = active;
+   audiooccupancy = occupancy;
+   audiounderrun  = underrun_likely;
+}
+
+static int I_MixFrames(void)
+{
+   int frames = (tic_vars.sample_step)? tic_vars.sample_step : SAMPLECOUNT_35;
 
-      // Increment current pointers in mixbuffer.
-      leftout += step;
-      rightout += step;
-      frames++;
+   if (audiostatus)
+   {
+      if (audiounderrun || audiooccupancy < 25)
+         frames += frames / 2;
+      else if (audiooccupancy > 75)
+         frames -= frames / 4;
+   }
+   return frames < MAXMIXFRAMES ? frames : MAXMIXFRAMES;
+}
+
+//
+// This function mixes all active (internal) sound
+//  channels into the global mixbuffer, on top of
+//  the music, a channel at a time over the whole
+//  block: each retrieves the samples it has left
+//  and adds them, scaled by its volume lookups,
+//  into a 32 bit accumulator, which is clamped to
+//  the allowed range and packed once at the end.
+//  Idle channels are passed over once a block.
+//
+// This function currently supports only 16bit.
+//
+
+void I_UpdateSound(void)
+{
+   static int32_t mixaccum[MAXMIXFRAMES * 2];
+   int frames, out_frames, chan;
+
+   I_LockSound();
+   out_frames = I_MixFrames();
+
+#ifdef MUSIC_SUPPORT
+#ifdef PRBOOM_THREADS
+   if (musicthread)
+      I_ReadMusicRing(mixaccum, out_frames);
+   else
+#endif
+   if (music_handle && current_player)
+   {
+     int16_t mad_audio_buf[MAXMIXFRAMES * 2];
+     int i;
+
+     memset(mad_audio_buf, 0, out_frames * 4);
+     current_player->render(mad_audio_buf, out_frames);
+     for (i = 0; i < out_frames * 2; i++)
+        mixaccum[i] = mad_audio_buf[i];
    }
+   else
+#endif
+      memset(mixaccum, 0, out_frames * 2 * sizeof(*mixaccum));
+
+   for (chan = 0; chan < NUM_CHANNELS; chan++)
+      if (channels[chan].snd_start_ptr)
+         I_MixChannel(&channels[chan], mixaccum, out_frames);
+
+   I_PackMix(mixbuffer, mixaccum, out_frames * 2);
+   I_UnlockSound();
 
    for (frames = 0; frames < out_frames; )
       frames += audio_batch_cb(mixbuffer + (frames << 1), out_frames - frames);
 }
 
-void I_UpdateSoundParams (int handle, int vol, int sep, int pitch)
+#ifdef PRBOOM_THREADS
+static void RETRO_CALLCONV I_AudioCallback(void)
 {
-   int rightvol, leftvol, i;
+   I_UpdateSound();
+}
 
-   for (i = 0; i < NUM_CHANNELS; i++)
+static void RETRO_CALLCONV I_AudioSetState(bool enabled)
+{
+   audiocallback = enabled;
+}
+#endif
+
+//
+// Asks for the frontend's buffer status and, if wanted and threads are
+//  built in, for it to call for audio itself rather than having a block
+//  mixed every frame.
+//
+
+void I_InitAudioCallbacks(retro_environment_t environ_cb, dbool use_callback)
+{
+   struct retro_audio_buffer_status_callback status_cb = { I_AudioBufferStatus };
+
+   environ_cb(RETRO_ENVIRONMENT_SET_AUDIO_BUFFER_STATUS_CALLBACK, &status_cb);
+
+#ifdef PRBOOM_THREADS
+   if (use_callback && !soundlock)
    {
-      if (channels[i].handle==handle)
+      struct retro_audio_callback audio_cb = { I_AudioCallback, I_AudioSetState };
+
+      if ((soundlock = I_MutexCreate()) &&
+          !environ_cb(RETRO_ENVIRONMENT_SET_AUDIO_CALLBACK, &audio_cb))
       {
-         sep     += 1;
+         I_MutexDestroy(soundlock);
+         soundlock = NULL;
+      }
+      if (!soundlock)
+         lprintf(LO_WARN, "I_InitAudioCallbacks: audio callback unavailable\n");
+   }
+#endif
+}
 
-         leftvol  = vol - ((vol*sep*sep) >> 16); ///(256*256);
-         sep     -= 257;
-         rightvol = vol - ((vol*sep*sep) >> 16);
+// Whether the frontend is calling for audio, so retro_run needn't mix
+dbool I_AudioCallbackActive(void)
+{
+   return audiocallback;
+}
+
+void I_UpdateSoundParams (int handle, int vol, int sep, int pitch)
+{
+   int rightvol, leftvol;
+   channel_t *channel = &channels[HANDLE_CHANNEL(handle)];
+
+   I_LockSound();
+   if (handle > 0 && channel->handle == handle)
+   {
+      sep     += 1;
 
-         if (rightvol < 0 || rightvol > 127)
-            I_Error("I_UpdateSoundParams: rightvol out of bounds.");
+      leftvol  = vol - ((vol*sep*sep) >> 16); ///(256*256);
+      sep     -= 257;
+      rightvol = vol - ((vol*sep*sep) >> 16);
 
-         if (leftvol < 0 || leftvol > 127)
-            I_Error("I_UpdateSoundParams: leftvol out of bounds.");
+      if (rightvol < 0 || rightvol > 127)
+         I_Error("I_UpdateSoundParams: rightvol out of bounds.");
 
-         channels[i].leftvol = &vol_lookup[leftvol*256];
-         channels[i].rightvol = &vol_lookup[rightvol*256];
-         return;
-      }
+      if (leftvol < 0 || leftvol > 127)
+         I_Error("I_UpdateSoundParams: leftvol out of bounds.");
+
+      channel->leftvol = &vol_lookup[leftvol*256];
+      channel->rightvol = &vol_lookup[rightvol*256];
    }
+   I_UnlockSound();
 }
 
 
@@ -492,34 +808,24 @@ void I_ShutdownSound(void)
 {
    int i;
 
+   I_LockSound();
+   for (i = 0; i < NUM_CHANNELS; i++)
+      memset(&channels[i], 0, sizeof(channel_t));
+
    for(i = 0; i < NUMSFX; i++)
    {
-      if (!S_sfx[i].link)
-      {
-         free(S_sfx[i].data);
-         S_sfx[i].data = NULL;
-      }
+      S_sfx[i].data = NULL;
+      lengths[i] = 0;
    }
+   I_FreeSfxPool();
+   I_UnlockSound();
 }
 
 void I_InitSound(void)
 {
-  int i;
-
   memset(&lengths, 0, sizeof(int)*NUMSFX);
 
-  for (i = 1; i < NUMSFX; i++)
-  {
-     // Alias? Example is the chaingun sound linked to pistol.
-     if (!S_sfx[i].link) // Load data from WAD file.
-        S_sfx[i].data = I_SndLoadSample( S_sfx[i].name, &lengths[i] );
-     else // Previously loaded already?
-     {
-        S_sfx[i].data = S_sfx[i].link->data;
-        lengths[i]    = lengths[(S_sfx[i].link - S_sfx)/sizeof(sfxinfo_t)];
-     }
-  }
-
+  // the effects themselves are loaded as they are first started
   I_SetChannels();
 
   if (log_cb)
@@ -542,33 +848,51 @@ dbool I_AnySoundStillPlaying(void)
 static int	looping=0;
 static int	musicdies=-1;
 
+void I_SetMusicVolume(int volume)
+{
+   snd_MusicVolume = volume;
+
+#ifdef MUSIC_SUPPORT
+   I_LockMusic();
+   if (current_player)
+      current_player->setvolume(volume);
+   I_UnlockMusic(FALSE);
+#endif
+}
+
 void I_PlaySong(int handle, int looping)
 {
   (void)handle;
   musicdies = gametic + TICRATE * 30;
 
 #ifdef MUSIC_SUPPORT
+  I_LockMusic();
   if (current_player)
   {
      current_player->play(music_handle, looping);
      current_player->setvolume(snd_MusicVolume);
   }
+  I_UnlockMusic(TRUE);
 #endif
 }
 
 void I_PauseSong (int handle)
 {
    (void)handle;
+   I_LockMusic();
    if (current_player)
       current_player->pause();
+   I_UnlockMusic(TRUE);
 }
 
 void I_ResumeSong (int handle)
 {
    (void)handle;
 #ifdef MUSIC_SUPPORT
+   I_LockMusic();
    if (current_player)
       current_player->resume();
+   I_UnlockMusic(TRUE);
 #endif
 }
 
@@ -579,8 +903,22 @@ void I_StopSong(int handle)
    looping   = 0;
    musicdies = 0;
 
+   I_LockMusic();
    if (current_player)
       current_player->stop();
+   I_UnlockMusic(TRUE);
+}
+
+// Lets the cache player write out what it has kept, once a frame
+void I_UpdateMusic(void)
+{
+#ifdef MUSIC_SUPPORT
+   if (current_player != &cache_player)
+      return;
+   I_LockMusic();
+   MC_Update();
+   I_UnlockMusic(FALSE);
+#endif
 }
 
 void I_UnRegisterSong(int handle)
@@ -588,17 +926,127 @@ void I_UnRegisterSong(int handle)
    (void)handle;
 
 #ifdef MUSIC_SUPPORT
+  I_LockMusic();
   if (current_player)
     current_player->stop();
+  if (current_player && music_handle)
+    current_player->unregistersong(music_handle);
 
    free(song_data);
    music_handle = NULL;
    song_data    = NULL;
+   I_UnlockMusic(TRUE);
 #endif
 }
 
+#ifdef MUSIC_SUPPORT
+// Songs come back around between maps and on every savestate load, so
+// the last few MUS -> MIDI conversions are kept, keyed on the MUS data
+#define MUSCONV_CACHE 8
+
+typedef struct
+{
+  void   *mus;
+  size_t  muslen;
+  void   *mid;
+  size_t  midlen;
+} musconv_t;
+
+static musconv_t musconv[MUSCONV_CACHE];
+static int       musconv_next;
+
+static void I_FreeMusConv(void)
+{
+  int i;
+
+  for (i = 0; i < MUSCONV_CACHE; i++)
+  {
+    free(musconv[i].mus);
+    free(musconv[i].mid);
+  }
+  memset(musconv, 0, sizeof(musconv));
+  musconv_next = 0;
+}
+
+// Returns the song converted to MIDI, or NULL if it isn't MUS
+static const musconv_t *I_ConvertMus(const void *data, size_t len)
+{
+  musconv_t *conv;
+  MEMFILE   *instream, *outstream;
+  int        i, result;
+
+  for (i = 0; i < MUSCONV_CACHE; i++)
+    if (musconv[i].mus && musconv[i].muslen == len &&
+        !memcmp(musconv[i].mus, data, len))
+      return &musconv[i];
+
+  instream  = mem_fopen_read(data, len);
+  outstream = mem_fopen_write();
+
+  // e6y: from chocolate-doom
+  // New mus -> mid conversion code thanks to Ben Ryves <benryves@benryves.com>
+  // This plays back a lot of music closer to Vanilla Doom - eg. tnt.wad map02
+  result = mus2mid(instream, outstream);
+
+  if (result != 0)
+  {
+     size_t muslen = len;
+     const unsigned char *musptr = data;
+
+     // haleyjd 04/04/10: scan forward for a MUS header. Evidently DMX was
+     // capable of doing this, and would skip over any intervening data. That,
+     // or DMX doesn't use the MUS header at all somehow.
+     while (musptr < (const unsigned char*)data + len - sizeof(musheader))
+     {
+        // if we found a likely header start, reset the mus pointer to that location,
+        // otherwise just leave it alone and pray.
+        musptr = memchr(musptr, 'M', (const unsigned char*)data + len - sizeof(musheader) - musptr);
+        if (!musptr)
+           break;
+        muslen = len - (musptr - (const unsigned char*)data);
+
+        if (!strncmp((const char*)musptr, "MUS\x1a", 4))
+        {
+           mem_fclose(instream);
+           instream = mem_fopen_read(musptr, muslen);
+           result   = mus2mid(instream, outstream);
+           break;
+        }
+
+        musptr++;
+     }
+  }
+
+  conv = NULL;
+  if (result == 0)
+  {
+     void *outbuf;
+     size_t outbuf_len;
+
+     conv = &musconv[musconv_next];
+     musconv_next = (musconv_next + 1) % MUSCONV_CACHE;
+     free(conv->mus);
+     free(conv->mid);
+
+     mem_get_buf(outstream, &outbuf, &outbuf_len);
+     conv->mus    = malloc(len);
+     conv->muslen = len;
+     conv->mid    = malloc(outbuf_len);
+     conv->midlen = outbuf_len;
+     memcpy(conv->mus, data, len);
+     memcpy(conv->mid, outbuf, outbuf_len);
+  }
+
+  mem_fclose(instream);
+  mem_fclose(outstream);
+
+  return conv;
+}
+#endif
+
 int I_RegisterSong(const void* data, size_t len)
 {
+  I_LockMusic();
   music_handle = NULL;
 
 #if defined(MUSIC_SUPPORT)
@@ -622,62 +1070,47 @@ int I_RegisterSong(const void* data, size_t len)
      }
   }
 
+  // The OPL player reads MUS lumps itself, no MIDI conversion needed
+  if (!music_handle && len > 4 && memcmp(data, "MUS", 3) == 0)
+  {
+     music_handle = opl_synth_player.registersong(data, len);
+     if (music_handle)
+        current_player = (music_player_t*)&opl_synth_player;
+  }
+
   // e6y: from Chocolate-Doom
   // Assume a MUS file and try to convert
   if (!music_handle)
   {
-     int result;
-     MEMFILE *instream  = mem_fopen_read(data, len);
-     MEMFILE *outstream = mem_fopen_write();
-
-     // e6y: from chocolate-doom
-     // New mus -> mid conversion code thanks to Ben Ryves <benryves@benryves.com>
-     // This plays back a lot of music closer to Vanilla Doom - eg. tnt.wad map02
-     result = mus2mid(instream, outstream);
-
-     if (result != 0)
-     {
-        size_t muslen = len;
-        const unsigned char *musptr = data;
-
-        // haleyjd 04/04/10: scan forward for a MUS header. Evidently DMX was
-        // capable of doing this, and would skip over any intervening data. That,
-        // or DMX doesn't use the MUS header at all somehow.
-        while (musptr < (const unsigned char*)data + len - sizeof(musheader))
-        {
-           // if we found a likely header start, reset the mus pointer to that location,
-           // otherwise just leave it alone and pray.
-           if (!strncmp((const char*)musptr, "MUS\x1a", 4))
-           {
-              mem_fclose(instream);
-              instream = mem_fopen_read(musptr, muslen);
-              result   = mus2mid(instream, outstream);
-              break;
-           }
-
-           musptr++;
-           muslen--;
-        }
-     }
+     const musconv_t *conv = I_ConvertMus(data, len);
 
-     if (result == 0)
+     if (conv)
      {
-        void *outbuf;
-        size_t outbuf_len;
-        mem_get_buf(outstream, &outbuf, &outbuf_len);
-        music_handle = opl_synth_player.registersong(outbuf, outbuf_len);
+        music_handle = opl_synth_player.registersong(conv->mid, conv->midlen);
         if(music_handle)
            current_player = (music_player_t*)&opl_synth_player;
      }
+  }
+
+  // Swap in the song's pre-rendering where wanted, streamed songs excepted
+  if (music_handle && mus_cache && current_player != &mp_player
+      && current_player != &vb_player)
+  {
+     const void *cached = MC_CacheSong(current_player, music_handle, data, len, snd_outputrate);
 
-     mem_fclose(instream);
-     mem_fclose(outstream);
+     if (cached)
+     {
+        // the live handle now belongs to the cache player
+        music_handle   = cached;
+        current_player = (music_player_t*)&cache_player;
+     }
   }
 
   /* Failed to load */
   if (!music_handle)
      lprintf(LO_ERROR, "I_RegisterSong: couldn't load music song.\n");
 #endif
+  I_UnlockMusic(TRUE);
 
   return !!music_handle;
 }
@@ -760,12 +1193,18 @@ void I_InitMusic(void)
 {
    int i;
    for (i = 0; music_players[i]; i++)
-      music_players[i]->init (SAMPLERATE);
+      music_players[i]->init (snd_outputrate);
 }
 
 void I_ShutdownMusic(void)
 {
    int i;
+   I_SetMusicThread(FALSE);
+   I_LockSound();
    for (i = 0; music_players[i]; i++)
       music_players[i]->shutdown ();
+#ifdef MUSIC_SUPPORT
+   I_FreeMusConv();
+#endif
+   I_UnlockSound();
 }
@@ -0,0 +1,268 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Thread interface for the libretro port (pthreads or Win32).
+ *
+ *      The handles are allocated with the system allocator rather than
+ *      the zone, since the zone itself uses a mutex from here.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+
+#ifdef PRBOOM_THREADS
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#endif
+
+#include "i_thread.h"
+
+#ifdef PRBOOM_THREADS
+
+struct i_thread_s
+{
+#if defined(_WIN32)
+   HANDLE handle;
+#else
+   pthread_t handle;
+#endif
+   void (*func)(void *);
+   void *arg;
+};
+
+struct i_mutex_s
+{
+#if defined(_WIN32)
+   CRITICAL_SECTION cs;
+#else
+   pthread_mutex_t mutex;
+#endif
+};
+
+struct i_cond_s
+{
+#if defined(_WIN32)
+   CONDITION_VARIABLE cv;
+#else
+   pthread_cond_t cond;
+#endif
+};
+
+#if defined(_WIN32)
+static DWORD WINAPI I_ThreadEntry(LPVOID data)
+#else
+static void *I_ThreadEntry(void *data)
+#endif
+{
+   i_thread_t *thread = data;
+   thread->func(thread->arg);
+   return 0;
+}
+
+i_thread_t *I_ThreadCreate(void (*func)(void *), void *arg)
+{
+   i_thread_t *thread = (malloc)(sizeof(*thread));
+
+   if (!thread)
+      return NULL;
+
+   thread->func = func;
+   thread->arg  = arg;
+
+#if defined(_WIN32)
+   thread->handle = CreateThread(NULL, 0, I_ThreadEntry, thread, 0, NULL);
+   if (thread->handle)
+      return thread;
+#else
+   if (pthread_create(&thread->handle, NULL, I_ThreadEntry, thread) == 0)
+      return thread;
+#endif
+
+   (free)(thread);
+   return NULL;
+}
+
+void I_ThreadJoin(i_thread_t *thread)
+{
+   if (!thread)
+      return;
+
+#if defined(_WIN32)
+   WaitForSingleObject(thread->handle, INFINITE);
+   CloseHandle(thread->handle);
+#else
+   pthread_join(thread->handle, NULL);
+#endif
+   (free)(thread);
+}
+
+i_mutex_t *I_MutexCreate(void)
+{
+   i_mutex_t *mutex = (malloc)(sizeof(*mutex));
+
+   if (!mutex)
+      return NULL;
+
+#if defined(_WIN32)
+   InitializeCriticalSection(&mutex->cs);
+#else
+   if (pthread_mutex_init(&mutex->mutex, NULL) != 0)
+   {
+      (free)(mutex);
+      return NULL;
+   }
+#endif
+   return mutex;
+}
+
+void I_MutexDestroy(i_mutex_t *mutex)
+{
+   if (!mutex)
+      return;
+
+#if defined(_WIN32)
+   DeleteCriticalSection(&mutex->cs);
+#else
+   pthread_mutex_destroy(&mutex->mutex);
+#endif
+   (free)(mutex);
+}
+
+void I_MutexLock(i_mutex_t *mutex)
+{
+#if defined(_WIN32)
+   EnterCriticalSection(&mutex->cs);
+#else
+   pthread_mutex_lock(&mutex->mutex);
+#endif
+}
+
+void I_MutexUnlock(i_mutex_t *mutex)
+{
+#if defined(_WIN32)
+   LeaveCriticalSection(&mutex->cs);
+#else
+   pthread_mutex_unlock(&mutex->mutex);
+#endif
+}
+
+i_cond_t *I_CondCreate(void)
+{
+   i_cond_t *cond = (malloc)(sizeof(*cond));
+
+   if (!cond)
+      return NULL;
+
+#if defined(_WIN32)
+   InitializeConditionVariable(&cond->cv);
+#else
+   if (pthread_cond_init(&cond->cond, NULL) != 0)
+   {
+      (free)(cond);
+      return NULL;
+   }
+#endif
+   return cond;
+}
+
+void I_CondDestroy(i_cond_t *cond)
+{
+   if (!cond)
+      return;
+
+#if !defined(_WIN32)
+   pthread_cond_destroy(&cond->cond);
+#endif
+   (free)(cond);
+}
+
+void I_CondWait(i_cond_t *cond, i_mutex_t *mutex)
+{
+#if defined(_WIN32)
+   SleepConditionVariableCS(&cond->cv, &mutex->cs, INFINITE);
+#else
+   pthread_cond_wait(&cond->cond, &mutex->mutex);
+#endif
+}
+
+void I_CondSignal(i_cond_t *cond)
+{
+#if defined(_WIN32)
+   WakeConditionVariable(&cond->cv);
+#else
+   pthread_cond_signal(&cond->cond);
+#endif
+}
+
+void I_CondBroadcast(i_cond_t *cond)
+{
+#if defined(_WIN32)
+   WakeAllConditionVariable(&cond->cv);
+#else
+   pthread_cond_broadcast(&cond->cond);
+#endif
+}
+
+int I_NumCPUs(void)
+{
+#if defined(_WIN32)
+   SYSTEM_INFO info;
+   GetSystemInfo(&info);
+   return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#elif defined(_SC_NPROCESSORS_ONLN)
+   long n = sysconf(_SC_NPROCESSORS_ONLN);
+   return n > 0 ? (int)n : 1;
+#else
+   return 1;
+#endif
+}
+
+#else /* !PRBOOM_THREADS */
+
+i_thread_t *I_ThreadCreate(void (*func)(void *), void *arg) { return NULL; }
+void I_ThreadJoin(i_thread_t *thread) {}
+
+i_mutex_t *I_MutexCreate(void) { return NULL; }
+void I_MutexDestroy(i_mutex_t *mutex) {}
+void I_MutexLock(i_mutex_t *mutex) {}
+void I_MutexUnlock(i_mutex_t *mutex) {}
+
+i_cond_t *I_CondCreate(void) { return NULL; }
+void I_CondDestroy(i_cond_t *cond) {}
+void I_CondWait(i_cond_t *cond, i_mutex_t *mutex) {}
+void I_CondSignal(i_cond_t *cond) {}
+void I_CondBroadcast(i_cond_t *cond) {}
+
+int I_NumCPUs(void) { return 1; }
+
+#endif
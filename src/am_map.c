@@ -248,6 +248,15 @@ int markpointnum_max = 0;       // killough 2/22/98
 
 static dbool   stopped = TRUE;
 
+// map vertexes shifted (and rotated) for this frame, one per vertex
+static mpoint_t *am_vertexes;
+static int am_numvertexes;
+
+// clipped lines waiting to be drawn, in the order they were clipped
+static fline_t *am_flines;
+static int *am_flinecolors;
+static int am_numflines, am_maxflines;
+
 //
 // AM_activateNewScale()
 //
@@ -986,7 +995,37 @@ static void AM_drawMline
     color=0;
 
   if (AM_clipMline(ml, &fl))
-    V_DrawLine(&fl, color); // draws it on frame buffer using fb coords
+  {
+    if (am_numflines == am_maxflines)
+    {
+      am_maxflines = am_maxflines ? am_maxflines * 2 : 1024;
+      am_flines = realloc(am_flines, am_maxflines * sizeof(*am_flines));
+      am_flinecolors = realloc(am_flinecolors, am_maxflines * sizeof(*am_flinecolors));
+    }
+    am_flines[am_numflines] = fl;
+    am_flinecolors[am_numflines++] = color;
+  }
+}
+
+//
+// AM_flushMlines()
+//
+// Draws the lines clipped since the last flush on the frame buffer, as
+// runs of one colour, in the order they came.
+//
+// Passed nothing, returns nothing
+//
+static void AM_flushMlines(void)
+{
+  int i, j;
+
+  for (i = 0; i < am_numflines; i = j)
+  {
+    for (j = i + 1; j < am_numflines && am_flinecolors[j] == am_flinecolors[i]; j++)
+      ;
+    V_DrawLines(&am_flines[i], j - i, am_flinecolors[i]);
+  }
+  am_numflines = 0;
 }
 
 //
@@ -1099,18 +1138,30 @@ static void AM_drawWalls(void)
   int i;
   static mline_t l;
 
+  // each vertex is moved into map coords once, not once per line using it
+  if (am_numvertexes < numvertexes)
+  {
+    am_numvertexes = numvertexes;
+    am_vertexes = realloc(am_vertexes, am_numvertexes * sizeof(*am_vertexes));
+  }
+  for (i=0;i<numvertexes;i++)
+  {
+    am_vertexes[i].x = vertexes[i].x >> FRACTOMAPBITS;//e6y
+    am_vertexes[i].y = vertexes[i].y >> FRACTOMAPBITS;//e6y
+    if (automapmode & am_rotate)
+      AM_rotate(&am_vertexes[i].x, &am_vertexes[i].y, ANG90-plr->mo->angle, plr->mo->x, plr->mo->y);
+  }
+
   // draw the unclipped visible portions of all lines
   for (i=0;i<numlines;i++)
   {
-    l.a.x = lines[i].v1->x >> FRACTOMAPBITS;//e6y
-    l.a.y = lines[i].v1->y >> FRACTOMAPBITS;//e6y
-    l.b.x = lines[i].v2->x >> FRACTOMAPBITS;//e6y
-    l.b.y = lines[i].v2->y >> FRACTOMAPBITS;//e6y
-
-    if (automapmode & am_rotate) {
-      AM_rotate(&l.a.x, &l.a.y, ANG90-plr->mo->angle, plr->mo->x, plr->mo->y);
-      AM_rotate(&l.b.x, &l.b.y, ANG90-plr->mo->angle, plr->mo->x, plr->mo->y);
-    }
+    l.a = am_vertexes[lines[i].v1 - vertexes];
+    l.b = am_vertexes[lines[i].v2 - vertexes];
+
+    // off the window altogether; AM_clipMline would reject it anyway
+    if ((l.a.y > m_y2 && l.b.y > m_y2) || (l.a.y < m_y && l.b.y < m_y) ||
+        (l.a.x > m_x2 && l.b.x > m_x2) || (l.a.x < m_x && l.b.x < m_x))
+      continue;
 
     // if line has been seen or IDDT has been used
     if (ddt_cheating || (lines[i].flags & ML_MAPPED))
@@ -1582,6 +1633,7 @@ void AM_Drawer (void)
   AM_drawPlayers();
   if (ddt_cheating==2)
     AM_drawThings(); //jff 1/5/98 default double IDDT sprite
+  AM_flushMlines();
   AM_drawCrosshair(mapcolor_hair);   //jff 1/7/98 default crosshair color
 
   AM_drawMarks();
@@ -0,0 +1,754 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Pre-rendered music. The first time a song is heard it is played
+ *      through once, unlooped, by the player that would have played it
+ *      live, and kept as it goes; the end of that pass is the loop point,
+ *      and the file is written out from memory after it, away from the
+ *      audio thread. The file is named
+ *      by an MD5 of the song, the player, its soundfont and the rate, so
+ *      anything that would change the sound makes a new one.
+ *
+ *      Samples are IMA ADPCM, 4 bits each, in blocks of MC_BLOCK frames
+ *      that each start with both channels' predictor and step index, so
+ *      playback only ever decodes a block at a time from the file.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#include "config.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomtype.h"
+#include "m_fixed.h"
+#include "i_system.h"
+#include "i_thread.h"
+#include "lprintf.h"
+#include "md5.h"
+#include "cacheplayer.h"
+#ifdef HAVE_LIBFLUIDSYNTH
+#include "flplayer.h"
+#endif
+
+#include <streams/file_stream.h>
+
+#define MC_BLOCK      1024                  // frames per block
+#define MC_BLOCKBYTES (8 + MC_BLOCK)        // both headers, a byte a frame
+#define MC_HEADER     16                    // magic, rate, frames
+#define MC_MAXSECONDS (20 * 60)             // give up on songs that never end
+#define MC_CHUNK      64                    // blocks kept per allocation
+
+static const char mc_magic[8] = "PRBMUS01";
+
+int mus_cache;
+
+#ifdef HAVE_LIBFLUIDSYNTH
+extern const char *snd_soundfont;
+#endif
+extern int mus_opl_gain;
+
+static const int mc_indexadjust[16] = {
+  -1, -1, -1, -1, 2, 4, 6, 8,
+  -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static const int mc_steps[89] = {
+  7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41,
+  45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209,
+  230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876,
+  963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749,
+  3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630,
+  9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385,
+  24623, 27086, 29794, 32767
+};
+
+typedef struct {
+  int pred;
+  int index;
+} mcchannel_t;
+
+// What a nibble does to a channel, the same for encoding and decoding
+static int MC_Step(mcchannel_t *ch, int nibble)
+{
+  int step = mc_steps[ch->index];
+  int delta = step >> 3;
+
+  if (nibble & 4)
+    delta += step;
+  if (nibble & 2)
+    delta += step >> 1;
+  if (nibble & 1)
+    delta += step >> 2;
+  ch->pred += (nibble & 8) ? -delta : delta;
+  if (ch->pred > 32767)
+    ch->pred = 32767;
+  else if (ch->pred < -32768)
+    ch->pred = -32768;
+  ch->index += mc_indexadjust[nibble];
+  if (ch->index < 0)
+    ch->index = 0;
+  else if (ch->index > 88)
+    ch->index = 88;
+  return ch->pred;
+}
+
+static int MC_Encode(mcchannel_t *ch, int sample)
+{
+  int step = mc_steps[ch->index];
+  int diff = sample - ch->pred;
+  int nibble = 0;
+
+  if (diff < 0)
+  {
+    nibble = 8;
+    diff = -diff;
+  }
+  if (diff >= step)
+  {
+    nibble |= 4;
+    diff -= step;
+  }
+  if (diff >= step >> 1)
+  {
+    nibble |= 2;
+    diff -= step >> 1;
+  }
+  if (diff >= step >> 2)
+    nibble |= 1;
+  MC_Step(ch, nibble);
+  return nibble;
+}
+
+static void MC_PutLong(unsigned char *p, uint32_t v)
+{
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+static uint32_t MC_GetLong(const unsigned char *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// A block's header holds the state each channel starts it in
+static void MC_PutState(unsigned char *p, const mcchannel_t *ch)
+{
+  p[0] = ch->pred & 0xff;
+  p[1] = (ch->pred >> 8) & 0xff;
+  p[2] = ch->index;
+  p[3] = 0;
+}
+
+static void MC_GetState(const unsigned char *p, mcchannel_t *ch)
+{
+  ch->pred = (int16_t)(p[0] | (p[1] << 8));
+  ch->index = p[2] <= 88 ? p[2] : 88;
+}
+
+static void MC_CachePath(char *path, size_t size, const music_player_t *player,
+    const void *data, size_t len, int samplerate)
+{
+#ifdef _WIN32
+  char slash = '\\';
+#else
+  char slash = '/';
+#endif
+  struct MD5Context md5;
+  unsigned char digest[16], rate[4];
+  char hex[33];
+  const char *name = player->name();
+  int i;
+
+  MD5Init(&md5);
+  MD5Update(&md5, data, len);
+  MD5Update(&md5, (const md5byte *)name, strlen(name));
+#ifdef HAVE_LIBFLUIDSYNTH
+  if (player == &fl_player && snd_soundfont)
+    MD5Update(&md5, (const md5byte *)snd_soundfont, strlen(snd_soundfont));
+#endif
+  MC_PutLong(rate, samplerate);
+  MD5Update(&md5, rate, 4);
+  MC_PutLong(rate, mus_opl_gain);
+  MD5Update(&md5, rate, 4);
+  MD5Final(digest, &md5);
+
+  for (i = 0; i < 16; i++)
+    sprintf(hex + i*2, "%02x", digest[i]);
+  snprintf(path, size, "%s%cprboom_mus_%s.pcm", I_DoomExeDir(), slash, hex);
+}
+
+// The number of frames in a finished cache file, MC_UNCACHEABLE for a
+// song marked as one, 0 if it is neither
+static unsigned MC_ReadHeader(RFILE *f, int samplerate)
+{
+  unsigned char header[MC_HEADER];
+
+  if (filestream_read(f, header, MC_HEADER) != MC_HEADER ||
+      memcmp(header, mc_magic, 8) ||
+      MC_GetLong(header + 8) != (uint32_t)samplerate)
+    return 0;
+  return MC_GetLong(header + 12);
+}
+
+// A header whose frame count is this marks a song that can't be cached
+// (it ran past MC_MAXSECONDS), so it is played live without trying again
+#define MC_UNCACHEABLE 0xffffffffu
+
+// Where the first pass of a song is; all but MC_TEE_NONE have chunks
+typedef enum {
+  MC_TEE_NONE,                     // not being kept
+  MC_TEE_RUNNING,                  // played live and kept
+  MC_TEE_DONE,                     // kept whole, for MC_Update to write
+  MC_TEE_WRITTEN,                  // written, or being written
+  MC_TEE_TOOLONG,                  // ran past MC_MAXSECONDS
+  MC_TEE_FAILED                    // ran out of memory
+} mctee_t;
+
+typedef struct {
+  char path[PATH_MAX+1];
+  int samplerate;
+  unsigned frames;                 // 0 until the song is whole
+  const music_player_t *live;      // plays it until then, else NULL
+  const void *livehandle;
+  mctee_t tee;
+  unsigned char **chunks;          // the blocks kept, MC_CHUNK to each
+  unsigned numblocks, maxchunks;
+} mcsong_t;
+
+// Songs whose file couldn't be written this session, not tried again
+#define MC_MAXFAILED 32
+
+static char *mc_failed[MC_MAXFAILED];
+static int mc_numfailed;
+
+static dbool MC_Failed(const char *path)
+{
+  int i;
+
+  for (i = 0; i < mc_numfailed; i++)
+    if (!strcmp(mc_failed[i], path))
+      return TRUE;
+  return FALSE;
+}
+
+static void MC_SetFailed(const char *path)
+{
+  if (mc_numfailed < MC_MAXFAILED && !MC_Failed(path))
+    mc_failed[mc_numfailed++] = strdup(path);
+}
+
+const void *MC_CacheSong(const music_player_t *player, const void *handle,
+    const void *data, size_t len, int samplerate)
+{
+  mcsong_t *song;
+  unsigned frames = 0;
+  RFILE *f;
+
+  if (!player->playing)
+    return NULL;
+
+  song = malloc(sizeof(*song));
+  MC_CachePath(song->path, sizeof(song->path), player, data, len, samplerate);
+
+  if ((f = filestream_open(song->path, RETRO_VFS_FILE_ACCESS_READ,
+          RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+  {
+    frames = MC_ReadHeader(f, samplerate);
+    filestream_close(f);
+  }
+
+  if (frames == MC_UNCACHEABLE || MC_Failed(song->path))
+  {
+    free(song);
+    return NULL;
+  }
+
+  song->samplerate = samplerate;
+  song->frames = frames;
+  song->live = NULL;
+  song->livehandle = NULL;
+  song->tee = MC_TEE_NONE;
+  song->chunks = NULL;
+  song->numblocks = song->maxchunks = 0;
+  if (frames)
+    player->unregistersong(handle);
+  else
+  {
+    // the first time through is played live and kept as it goes
+    song->live = player;
+    song->livehandle = handle;
+  }
+  return song;
+}
+
+//
+// Writing cache files
+//
+// The first pass of a song is kept in memory, so the audio thread never
+// waits on a file. Once it is whole, MC_Update writes it out on a thread
+// of its own like a savegame, or at once without threads; a song that
+// ran too long gets a file saying so instead. The writer only reads the
+// song, which is not freed until the write is over.
+//
+
+static struct {
+  i_thread_t *thread;     // NULL when it ran on the calling thread
+  i_mutex_t *lock;        // for done
+  mcsong_t *song;         // the song being written, NULL if none
+  unsigned frames;        // the count for the header
+  dbool done, ok;
+} mc_write;
+
+static unsigned char *MC_Block(const mcsong_t *song, unsigned block)
+{
+  return song->chunks[block / MC_CHUNK] + (block % MC_CHUNK) * MC_BLOCKBYTES;
+}
+
+static void MC_FreeBlocks(mcsong_t *song)
+{
+  unsigned i;
+
+  if (song->chunks)
+    for (i = 0; i < song->maxchunks; i++)
+      free(song->chunks[i]);
+  free(song->chunks);
+  song->chunks = NULL;
+  song->numblocks = song->maxchunks = 0;
+}
+
+static void MC_WriteSong(void *arg)
+{
+  const mcsong_t *song = mc_write.song;
+  unsigned blocks = mc_write.frames == MC_UNCACHEABLE ? 0 : song->numblocks;
+  unsigned char header[MC_HEADER];
+  RFILE *f;
+  dbool ok = FALSE;
+  unsigned i;
+
+  if ((f = filestream_open(song->path, RETRO_VFS_FILE_ACCESS_WRITE,
+          RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+  {
+    memcpy(header, mc_magic, 8);
+    MC_PutLong(header + 8, song->samplerate);
+    MC_PutLong(header + 12, mc_write.frames);
+    ok = filestream_write(f, header, MC_HEADER) == MC_HEADER;
+    for (i = 0; ok && i < blocks; i++)
+      ok = filestream_write(f, MC_Block(song, i), MC_BLOCKBYTES) == MC_BLOCKBYTES;
+    filestream_close(f);
+    if (!ok)
+      filestream_delete(song->path);
+  }
+
+  I_MutexLock(mc_write.lock);
+  mc_write.ok = ok;
+  mc_write.done = TRUE;
+  I_MutexUnlock(mc_write.lock);
+}
+
+// Reports how the last write went once it is over, waiting for it if
+// asked
+static void MC_FinishWrite(dbool wait)
+{
+  mcsong_t *song = mc_write.song;
+
+  if (!song)
+    return;
+  if (mc_write.thread)
+  {
+    dbool done;
+
+    I_MutexLock(mc_write.lock);
+    done = mc_write.done;
+    I_MutexUnlock(mc_write.lock);
+    if (!done && !wait)
+      return;
+    I_ThreadJoin(mc_write.thread);
+    mc_write.thread = NULL;
+  }
+
+  if (!mc_write.ok)
+  {
+    lprintf(LO_WARN, "MC_CacheSong: couldn't write %s\n", song->path);
+    MC_SetFailed(song->path);
+  }
+  else if (mc_write.frames == MC_UNCACHEABLE)
+    lprintf(LO_WARN, "MC_CacheSong: song runs past %d seconds, playing it live\n",
+        MC_MAXSECONDS);
+  else
+    lprintf(LO_INFO, "MC_CacheSong: cached %u frames\n", mc_write.frames);
+  mc_write.song = NULL;
+}
+
+static void MC_StartWrite(mcsong_t *song, unsigned frames)
+{
+  MC_FinishWrite(TRUE);  // one at a time
+
+  mc_write.song = song;
+  mc_write.frames = frames;
+  mc_write.done = mc_write.ok = FALSE;
+  if (!mc_write.lock)
+    mc_write.lock = I_MutexCreate();
+  if (!(mc_write.thread = I_ThreadCreate(MC_WriteSong, NULL)))
+  {
+    MC_WriteSong(NULL);
+    MC_FinishWrite(TRUE);
+  }
+}
+
+// Acts on how a song's first pass ended, if it has
+static void MC_SettleTee(mcsong_t *song)
+{
+  switch (song->tee)
+  {
+    case MC_TEE_DONE:
+      song->tee = MC_TEE_WRITTEN;  // the blocks stay to play from
+      MC_StartWrite(song, song->frames);
+      break;
+    case MC_TEE_TOOLONG:
+      song->tee = MC_TEE_NONE;
+      MC_FreeBlocks(song);
+      MC_StartWrite(song, MC_UNCACHEABLE);
+      break;
+    case MC_TEE_FAILED:
+      lprintf(LO_WARN, "MC_CacheSong: no memory to keep %s\n", song->path);
+      MC_SetFailed(song->path);
+      song->tee = MC_TEE_NONE;
+      MC_FreeBlocks(song);
+      break;
+    default:
+      break;
+  }
+}
+
+//
+// The cache player
+//
+// A finished song is decoded from its file a block at a time, or from
+// memory if this session kept it. One not cached yet is played by its
+// own player, unlooped, a block at a time too, each block kept as it is
+// played; the end of that pass makes the song whole, and playback
+// carries on from memory while MC_Update writes the file. Stopped before
+// then, what was kept is dropped and the next play starts over.
+//
+
+static mcsong_t *mc_song;
+static RFILE *mc_file;
+static unsigned mc_pos;          // frames into the song
+static int16_t mc_pcm[MC_BLOCK * 2];
+static unsigned mc_pcmpos, mc_pcmlen;
+static int mc_playing, mc_paused, mc_looping;
+static int mc_volume = 15;
+
+static mcchannel_t mc_teech[2];
+static int mc_livelooping;       // the live player was started looped
+
+static const char *mc_name(void)
+{
+  return "pre-rendered music";
+}
+
+static int mc_init(int samplerate)
+{
+  return 1;
+}
+
+static void mc_stop(void)
+{
+  if (mc_song && mc_song->live)
+    mc_song->live->stop();
+  if (mc_song && mc_song->tee == MC_TEE_RUNNING)
+  {
+    mc_song->tee = MC_TEE_NONE;  // cut short
+    MC_FreeBlocks(mc_song);
+  }
+  if (mc_file)
+    filestream_close(mc_file);
+  mc_file = NULL;
+  mc_song = NULL;
+  mc_playing = 0;
+}
+
+static void mc_shutdown(void)
+{
+  mc_stop();
+  MC_FinishWrite(TRUE);
+}
+
+static void mc_setvolume(int v)
+{
+  mc_volume = v;
+}
+
+static void mc_pause(void)
+{
+  mc_paused = 1;
+}
+
+static void mc_resume(void)
+{
+  mc_paused = 0;
+}
+
+static const void *mc_registersong(const void *data, unsigned len)
+{
+  return NULL;
+}
+
+static void mc_unregistersong(const void *handle)
+{
+  mcsong_t *song = (mcsong_t *)handle;
+
+  if (handle == mc_song)
+    mc_stop();
+  MC_SettleTee(song);  // a finished pass is still written
+  if (mc_write.song == song)
+    MC_FinishWrite(TRUE);
+  if (song->live)
+    song->live->unregistersong(song->livehandle);
+  MC_FreeBlocks(song);
+  free(song);
+}
+
+static void mc_rewind(void)
+{
+  if (mc_file)
+    filestream_seek(mc_file, MC_HEADER, RETRO_VFS_SEEK_POSITION_START);
+  mc_pos = mc_pcmpos = mc_pcmlen = 0;
+}
+
+// Starts the live pass, kept in memory unless it can't be cached
+static void MC_StartTee(int looping)
+{
+  unsigned maxblocks = (uint32_t)MC_MAXSECONDS * mc_song->samplerate / MC_BLOCK;
+
+  MC_SettleTee(mc_song);  // a pass given up on but not yet dealt with
+  if (!MC_Failed(mc_song->path))
+  {
+    mc_song->maxchunks = maxblocks / MC_CHUNK + 1;
+    if ((mc_song->chunks = calloc(mc_song->maxchunks, sizeof(*mc_song->chunks))))
+      mc_song->tee = MC_TEE_RUNNING;
+    else
+      mc_song->maxchunks = 0;
+  }
+  memset(mc_teech, 0, sizeof(mc_teech));
+
+  // unlooped while kept, so the end of the pass is the loop point
+  mc_livelooping = mc_song->tee != MC_TEE_RUNNING && looping;
+  mc_song->live->setvolume(15);
+  mc_song->live->play(mc_song->livehandle, mc_livelooping);
+}
+
+static void mc_play(const void *handle, int looping)
+{
+  mc_stop();
+  mc_song = (mcsong_t *)handle;
+  mc_looping = looping;
+  mc_paused = 0;
+  mc_pos = mc_pcmpos = mc_pcmlen = 0;
+  if (!mc_song->frames)
+  {
+    MC_StartTee(looping);
+    mc_playing = 1;
+    return;
+  }
+  if (!mc_song->chunks)
+  {
+    mc_file = filestream_open(mc_song->path, RETRO_VFS_FILE_ACCESS_READ,
+        RETRO_VFS_FILE_ACCESS_HINT_NONE);
+    if (!mc_file)
+    {
+      lprintf(LO_WARN, "mc_play: couldn't open %s\n", mc_song->path);
+      return;
+    }
+  }
+  mc_rewind();
+  mc_playing = 1;
+}
+
+// The live pass has come to its end: the song is whole, and plays on
+// from memory
+static int MC_FinishTee(void)
+{
+  mc_song->frames = mc_pos;
+  mc_song->tee = MC_TEE_DONE;
+  mc_song->live->unregistersong(mc_song->livehandle);
+  mc_song->live = NULL;
+  mc_song->livehandle = NULL;
+
+  if (!mc_looping)
+    return 0;
+  mc_rewind();
+  return 1;
+}
+
+// Plays the next block live, keeping it while the pass is kept; FALSE
+// at the end of the song
+static int mc_liveblock(void)
+{
+  const music_player_t *live = mc_song->live;
+  unsigned i;
+
+  if (!live->playing())
+  {
+    if (mc_song->tee == MC_TEE_RUNNING)
+      return mc_pos && MC_FinishTee();
+    if (!mc_livelooping)
+      return 0;
+    live->play(mc_song->livehandle, 1);  // the cache was given up on
+  }
+
+  memset(mc_pcm, 0, sizeof(mc_pcm));
+  live->render(mc_pcm, MC_BLOCK);
+  mc_pcmpos = 0;
+  mc_pcmlen = MC_BLOCK;
+
+  if (mc_song->tee == MC_TEE_RUNNING)
+  {
+    unsigned n = mc_song->numblocks;
+
+    if (n / MC_CHUNK >= mc_song->maxchunks)
+      mc_song->tee = MC_TEE_TOOLONG;
+    else if (!mc_song->chunks[n / MC_CHUNK] &&
+        !(mc_song->chunks[n / MC_CHUNK] = malloc(MC_CHUNK * MC_BLOCKBYTES)))
+      mc_song->tee = MC_TEE_FAILED;
+    else
+    {
+      unsigned char *block = MC_Block(mc_song, n);
+
+      MC_PutState(block, &mc_teech[0]);
+      MC_PutState(block + 4, &mc_teech[1]);
+      for (i = 0; i < MC_BLOCK; i++)
+        block[8 + i] = MC_Encode(&mc_teech[0], mc_pcm[i*2]) |
+          (MC_Encode(&mc_teech[1], mc_pcm[i*2 + 1]) << 4);
+      mc_song->numblocks++;
+    }
+    if (mc_song->tee != MC_TEE_RUNNING)
+      mc_livelooping = mc_looping;  // play on live, looping as asked
+  }
+  return 1;
+}
+
+// Decodes the next block, FALSE at the end of the song
+static int mc_readblock(void)
+{
+  unsigned char buffer[MC_BLOCKBYTES];
+  const unsigned char *block = buffer;
+  mcchannel_t ch[2];
+  unsigned i;
+
+  if (mc_song->live)
+    return mc_liveblock();
+  if (mc_pos >= mc_song->frames)
+    return 0;
+  if (mc_song->chunks)
+    block = MC_Block(mc_song, mc_pos / MC_BLOCK);
+  else if (!mc_file ||
+      filestream_read(mc_file, buffer, MC_BLOCKBYTES) != MC_BLOCKBYTES)
+    return 0;
+  MC_GetState(block, &ch[0]);
+  MC_GetState(block + 4, &ch[1]);
+  for (i = 0; i < MC_BLOCK; i++)
+  {
+    mc_pcm[i*2]     = MC_Step(&ch[0], block[8 + i] & 15);
+    mc_pcm[i*2 + 1] = MC_Step(&ch[1], block[8 + i] >> 4);
+  }
+  mc_pcmpos = 0;
+  mc_pcmlen = MC_BLOCK;
+  if (mc_pcmlen > mc_song->frames - mc_pos)
+    mc_pcmlen = mc_song->frames - mc_pos;
+  return 1;
+}
+
+static void mc_render(void *dest, unsigned nsamp)
+{
+  int16_t *out = dest;
+
+  while (nsamp)
+  {
+    unsigned i, n;
+
+    if (!mc_playing || mc_paused)
+    {
+      memset(out, 0, nsamp * 4);
+      return;
+    }
+    if (mc_pcmpos == mc_pcmlen && !mc_readblock())
+    {
+      if (mc_looping && mc_pos && (mc_file || mc_song->chunks) &&
+          !mc_song->live)
+        mc_rewind();
+      else
+        mc_playing = 0;
+      continue;
+    }
+
+    n = mc_pcmlen - mc_pcmpos;
+    if (n > nsamp)
+      n = nsamp;
+    for (i = 0; i < n * 2; i++)
+      out[i] = mc_pcm[mc_pcmpos*2 + i] * mc_volume / 15;
+    out += n * 2;
+    nsamp -= n;
+    mc_pcmpos += n;
+    mc_pos += n;
+  }
+}
+
+void MC_Update(void)
+{
+  MC_FinishWrite(FALSE);
+  if (mc_song)
+    MC_SettleTee(mc_song);
+}
+
+static int mc_isplaying(void)
+{
+  return mc_playing;
+}
+
+const music_player_t cache_player =
+{
+  mc_name,
+  mc_init,
+  mc_shutdown,
+  mc_setvolume,
+  mc_pause,
+  mc_resume,
+  mc_registersong,
+  mc_unregistersong,
+  mc_play,
+  mc_stop,
+  mc_render,
+  mc_isplaying
+};
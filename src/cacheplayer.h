@@ -0,0 +1,64 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Songs pre-rendered once by the player that would play them, kept
+ *      as IMA ADPCM in the save directory and streamed back from there,
+ *      for targets too slow to synthesize music live.
+ *
+ *-----------------------------------------------------------------------------*/
+
+
+#ifndef CACHEPLAYER_H
+#define CACHEPLAYER_H
+
+#include <stddef.h>
+
+#include "musicplayer.h"
+
+// Set to pre-render songs instead of playing them live
+extern int mus_cache;
+
+// Plays what MC_CacheSong returns; it can't register songs itself
+extern const music_player_t cache_player;
+
+// Finds the rendering of the song in data by player, whose handle for it
+// is handle. If there is none yet, the first play of the returned song
+// goes through player live and keeps the rendering as it goes, for
+// MC_Update to write out, so nothing is rendered up front. Returns a handle for cache_player, which
+// then owns handle, or NULL if the song can't be cached (it never ends,
+// or its file couldn't be written before), in which case it is left to
+// the player as it was.
+const void *MC_CacheSong(const music_player_t *player, const void *handle,
+    const void *data, size_t len, int samplerate);
+
+// Writes out a song whose first pass has ended, away from the audio
+// thread. Call from the main thread with the music locked.
+void MC_Update(void);
+
+#endif
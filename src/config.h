@@ -10,7 +10,12 @@
 #include <compat/msvc.h>
 #endif
 
+// Bytes per pixel_t: XRGB8888 with PRBOOM_32BPP, otherwise RGB565
+#ifdef PRBOOM_32BPP
+#define SURFACE_PIXEL_DEPTH 4
+#else
 #define SURFACE_PIXEL_DEPTH 2
+#endif
 extern int SCREENWIDTH;
 extern int SCREENHEIGHT;
 #define SCREENPITCH (SCREENWIDTH*SURFACE_PIXEL_DEPTH)
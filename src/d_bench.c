@@ -0,0 +1,1293 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Timed demos: -timedemo plays a demo a tic a frame, timing the game
+ *      logic, the view and the sound mixer, and reports the totals to the
+ *      log and to timedemo.json when it ends. Each tic's game state is
+ *      hashed into timedemo.sync, which -synccheck compares a later run
+ *      against.
+ *      Startup phases are timed every launch, and reported to the log
+ *      and to startup.json.
+ *      -fixedcheck checks and times the fixed point arithmetic.
+ *      -drawbench checks and times the column and span drawers.
+ *      -memsweep plays and views every map in turn, noting what memory
+ *      each took in memsweep.csv.
+ *      Frame statistics keep a histogram of frame times for each map
+ *      played, and add their percentiles to framestats.csv.
+ *
+ *-----------------------------------------------------------------------------*/
+
+
+#include <stdio.h>
+
+#include "z_zone.h"
+#include "doomstat.h"
+#include "d_bench.h"
+#include "i_system.h"
+#include "lprintf.h"
+#include "m_argv.h"
+#include "m_misc.h"
+#include "i_jobs.h"
+#include "m_fixed.h"
+#include "g_game.h"
+#include "p_maputl.h"
+#include "p_mobj.h"
+#include "p_tick.h"
+#include "r_fps.h"
+#include "r_arena.h"
+#include "r_draw.h"
+#include "r_main.h"
+#include "r_mipmap.h"
+#include "r_patch.h"
+#include "r_state.h"
+#include "v_video.h"
+#include "w_wad.h"
+
+#include <streams/file_stream.h>
+
+dbool timingdemo, nodrawers, synclog;
+
+int64_t benchtime[NUMBENCHSTAGES];
+int benchframes;
+
+static const char *const benchstagenames[NUMBENCHSTAGES] = {
+  "P_Ticker", "R_RenderPlayerView", "I_UpdateSound", "P_SortIntercepts",
+  "P_RunThinkers", "P_UpdateSpecials", "P_CheckSight", "P_PathTraverse",
+  "P_TryMove"
+};
+
+static const char *benchdemo;
+static int64_t benchstarttime;
+static int benchstarttic;
+
+// P_StateChecksum after each tic, this run's and the -synccheck run's
+static uint32_t *synchashes, *refhashes;
+static int numsynchashes, maxsynchashes, numrefhashes;
+static int firstdesync;
+
+// Mobjs and live monsters counted each tic, to see how the times scale
+static int peakmobjs, peakmonsters;
+static int64_t summobjs, summonsters;
+
+void D_StartTimingDemo(const char *name)
+{
+  int p;
+
+  benchdemo = name;
+  memset(benchtime, 0, sizeof benchtime);
+  benchframes = 0;
+  benchstarttic = gametic;
+
+  numsynchashes = numrefhashes = 0;
+  firstdesync = -1;
+  peakmobjs = peakmonsters = 0;
+  summobjs = summonsters = 0;
+  free(refhashes);
+  refhashes = NULL;
+  if ((p = M_CheckParm("-synccheck")) && ++p < myargc)
+  {
+    void *buf;
+    int64_t len;
+
+    if (filestream_read_file(myargv[p], &buf, &len))
+    {
+      const uint8_t *b = buf;
+      int i;
+
+      numrefhashes = len / 4;
+      refhashes = malloc(numrefhashes * sizeof *refhashes + 1);
+      for (i = 0; i < numrefhashes; i++, b += 4)
+        refhashes[i] = b[0] | b[1] << 8 | b[2] << 16 | (uint32_t)b[3] << 24;
+      free(buf);
+    }
+    else
+      lprintf(LO_WARN, "D_StartTimingDemo: couldn't read %s\n", myargv[p]);
+  }
+
+  benchstarttime = I_GetTimeUS();
+
+  if (!benchstarttime)
+    lprintf(LO_WARN, "D_StartTimingDemo: no performance timer, times will read 0\n");
+}
+
+// JSON string, with the demo's path escaped
+static void D_WriteJSONString(RFILE *f, const char *s)
+{
+  filestream_putc(f, '"');
+  for (; *s; s++)
+  {
+    if (*s == '"' || *s == '\\')
+      filestream_putc(f, '\\');
+    filestream_putc(f, *s);
+  }
+  filestream_putc(f, '"');
+}
+
+//
+// D_BenchTic
+//
+
+void D_BenchTic(uint32_t checksum)
+{
+  thinker_t *th = NULL;
+  int mobjs = 0, monsters = 0;
+
+  while ((th = P_NextThinker(th, th_all)) != NULL)
+    if (th->function == P_MobjThinker)
+    {
+      const mobj_t *mo = (const mobj_t *)th;
+
+      mobjs++;
+      monsters += (mo->flags & MF_COUNTKILL) && mo->health > 0;
+    }
+
+  if (mobjs > peakmobjs)
+    peakmobjs = mobjs;
+  if (monsters > peakmonsters)
+    peakmonsters = monsters;
+  summobjs += mobjs;
+  summonsters += monsters;
+
+  if (firstdesync < 0 && refhashes && numsynchashes < numrefhashes &&
+      refhashes[numsynchashes] != checksum)
+  {
+    firstdesync = numsynchashes;
+    lprintf(LO_WARN, "D_BenchTic: out of sync with -synccheck from tic %d\n",
+        firstdesync);
+  }
+
+  if (numsynchashes == maxsynchashes)
+  {
+    maxsynchashes = maxsynchashes ? maxsynchashes * 2 : 4096;
+    synchashes = realloc(synchashes, maxsynchashes * sizeof *synchashes);
+  }
+  synchashes[numsynchashes++] = checksum;
+}
+
+static void D_WriteSyncHashes(const char *path)
+{
+  RFILE *f = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+      RETRO_VFS_FILE_ACCESS_HINT_NONE);
+  int i;
+
+  if (!f)
+  {
+    lprintf(LO_WARN, "D_FinishTimingDemo: couldn't write %s\n", path);
+    return;
+  }
+  for (i = 0; i < numsynchashes; i++)
+  {
+    uint8_t b[4];
+
+    b[0] = synchashes[i];
+    b[1] = synchashes[i] >> 8;
+    b[2] = synchashes[i] >> 16;
+    b[3] = synchashes[i] >> 24;
+    filestream_write(f, b, 4);
+  }
+  filestream_close(f);
+}
+
+void D_FinishTimingDemo(void)
+{
+  char path[PATH_MAX+1];
+#ifdef _WIN32
+  char slash = '\\';
+#else
+  char slash = '/';
+#endif
+  int64_t walltime = I_GetTimeUS() - benchstarttime;
+  int tics = gametic - benchstarttic;
+  // a tic a frame, so without drawing it's tics that count
+  int frames = nodrawers ? tics : benchframes;
+  double fps = walltime > 0 ? frames * 1000000.0 / walltime : 0;
+  RFILE *f;
+  int i;
+
+  timingdemo = FALSE;
+
+  lprintf(LO_INFO, "D_FinishTimingDemo: %d tics, %d frames in %.3f s = %.1f fps\n",
+      tics, frames, walltime / 1000000.0, fps);
+  for (i = 0; i < NUMBENCHSTAGES; i++)
+    lprintf(LO_INFO, "  %-20s %10.1f ms\n", benchstagenames[i], benchtime[i] / 1000.0);
+  lprintf(LO_INFO, "  %d level tics, mobjs %.1f mean %d peak, monsters %.1f mean %d peak\n",
+      numsynchashes, numsynchashes ? (double)summobjs / numsynchashes : 0, peakmobjs,
+      numsynchashes ? (double)summonsters / numsynchashes : 0, peakmonsters);
+  if (refhashes)
+  {
+    if (firstdesync < 0 && numsynchashes != numrefhashes)
+      lprintf(LO_WARN, "  -synccheck ran %d level tics, this run %d\n",
+          numrefhashes, numsynchashes);
+    else if (firstdesync < 0)
+      lprintf(LO_INFO, "  in sync with -synccheck\n");
+  }
+
+  snprintf(path, sizeof path, "%s%ctimedemo.sync", I_DoomExeDir(), slash);
+  D_WriteSyncHashes(path);
+
+  snprintf(path, sizeof path, "%s%ctimedemo.json", I_DoomExeDir(), slash);
+  f = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+      RETRO_VFS_FILE_ACCESS_HINT_NONE);
+  if (!f)
+  {
+    lprintf(LO_WARN, "D_FinishTimingDemo: couldn't write %s\n", path);
+    return;
+  }
+
+  filestream_printf(f, "{\n  \"demo\": ");
+  D_WriteJSONString(f, benchdemo ? benchdemo : "");
+  filestream_printf(f, ",\n  \"width\": %d,\n  \"height\": %d,\n  \"drawn\": %s,\n",
+      SCREENWIDTH, SCREENHEIGHT, nodrawers ? "false" : "true");
+  filestream_printf(f, "  \"tics\": %d,\n  \"frames\": %d,\n  \"wall_ms\": %.1f,\n  \"fps\": %.2f,\n",
+      tics, frames, walltime / 1000.0, fps);
+  filestream_printf(f, "  \"tics_per_s\": %.2f,\n",
+      walltime > 0 ? tics * 1000000.0 / walltime : 0);
+  filestream_printf(f, "  \"level_tics\": %d,\n", numsynchashes);
+  filestream_printf(f, "  \"mobjs\": { \"mean\": %.1f, \"peak\": %d },\n",
+      numsynchashes ? (double)summobjs / numsynchashes : 0, peakmobjs);
+  filestream_printf(f, "  \"monsters\": { \"mean\": %.1f, \"peak\": %d },\n",
+      numsynchashes ? (double)summonsters / numsynchashes : 0, peakmonsters);
+  if (refhashes)
+    filestream_printf(f, "  \"first_desync\": %d,\n", firstdesync);
+  filestream_printf(f, "  \"ms\": {\n");
+  for (i = 0; i < NUMBENCHSTAGES; i++)
+    filestream_printf(f, "    \"%s\": %.1f%s\n", benchstagenames[i],
+        benchtime[i] / 1000.0, i < NUMBENCHSTAGES-1 ? "," : "");
+  filestream_printf(f, "  }\n}\n");
+  filestream_close(f);
+
+  lprintf(LO_INFO, "D_FinishTimingDemo: wrote %s\n", path);
+}
+
+//
+// Frame statistics
+//
+// A mean hides the frames that stutter, so the frame times of the map
+// being played are kept as histograms, one for the whole frame and one
+// for each of the stages of it D_StageStart times, from which the
+// slowest 1% and 0.1% of frames are read. Only frames that start and end
+// in the same level count; the one that loads it would swamp the rest.
+//
+
+#define FRAMEBUCKET_US  100  // histogram resolution
+#define NUMFRAMEBUCKETS 1000 // the last holds anything slower
+
+enum { FRAME_TOTAL = BENCH_SOUND+1, NUMFRAMEHISTS };
+
+static const char *const framehistnames[NUMFRAMEHISTS] = {
+  "sim", "render", "audio", "frame"
+};
+
+dbool framestats;
+int64_t framestagetime[BENCH_SOUND+1];
+
+static unsigned framehist[NUMFRAMEHISTS][NUMFRAMEBUCKETS];
+static int64_t framesum[NUMFRAMEHISTS], framemax[NUMFRAMEHISTS];
+static unsigned numframes, overbudget;
+static int frameepisode, framemap;
+
+static int64_t framestart;
+static int framestartlevel;  // leveltime as the frame started, -1 outside one
+
+void D_StartFrameStats(void)
+{
+  if (!framestats)
+    return;
+  // the map changed without G_DoCompleted: a loaded game, a warp
+  if (numframes && (gameepisode != frameepisode || gamemap != framemap))
+    D_ReportFrameStats();
+  memset(framestagetime, 0, sizeof framestagetime);
+  framestartlevel = gamestate == GS_LEVEL ? leveltime : -1;
+  framestart = I_GetTimeUS();
+}
+
+void D_EndFrameStats(void)
+{
+  int64_t times[NUMFRAMEHISTS];
+  int i;
+
+  if (!framestats || framestartlevel < 0 || gamestate != GS_LEVEL ||
+      leveltime < framestartlevel)
+    return;
+
+  memcpy(times, framestagetime, sizeof framestagetime);
+  times[FRAME_TOTAL] = I_GetTimeUS() - framestart;
+  if (times[FRAME_TOTAL] <= 0)
+    return;  // no performance timer
+
+  if (!numframes)
+  {
+    frameepisode = gameepisode;
+    framemap = gamemap;
+  }
+  numframes++;
+  if (tic_vars.fps && times[FRAME_TOTAL] > 1000000 / tic_vars.fps)
+    overbudget++;
+  for (i = 0; i < NUMFRAMEHISTS; i++)
+  {
+    int64_t bucket = times[i] / FRAMEBUCKET_US;
+
+    framehist[i][bucket < NUMFRAMEBUCKETS ? bucket : NUMFRAMEBUCKETS-1]++;
+    framesum[i] += times[i];
+    if (times[i] > framemax[i])
+      framemax[i] = times[i];
+  }
+}
+
+// How long, in ms, the slowest frame in every per takes at least
+static double D_FrameLow(const unsigned *hist, int per)
+{
+  unsigned slow = numframes / per, count = 0;
+  int i;
+
+  for (i = NUMFRAMEBUCKETS-1; i > 0; i--)
+    if ((count += hist[i]) > slow)
+      break;
+  return i * FRAMEBUCKET_US / 1000.0;
+}
+
+void D_ReportFrameStats(void)
+{
+  char path[PATH_MAX+1];
+#ifdef _WIN32
+  char slash = '\\';
+#else
+  char slash = '/';
+#endif
+  char map[9];
+  RFILE *f;
+  int i;
+
+  if (!numframes)
+    return;
+
+  if (gamemode == commercial)
+    snprintf(map, sizeof map, "MAP%02d", framemap);
+  else
+    snprintf(map, sizeof map, "E%dM%d", frameepisode, framemap);
+
+  lprintf(LO_INFO, "D_ReportFrameStats: %s, %u frames, %u over budget at %u fps\n",
+      map, numframes, overbudget, tic_vars.fps);
+  for (i = 0; i < NUMFRAMEHISTS; i++)
+    lprintf(LO_INFO, "  %-6s mean %6.2f ms, 1%% low %6.1f ms, 0.1%% low %6.1f ms, max %6.1f ms\n",
+        framehistnames[i], framesum[i] / 1000.0 / numframes,
+        D_FrameLow(framehist[i], 100), D_FrameLow(framehist[i], 1000),
+        framemax[i] / 1000.0);
+
+  snprintf(path, sizeof path, "%s%cframestats.csv", I_DoomExeDir(), slash);
+  f = filestream_open(path, RETRO_VFS_FILE_ACCESS_READ_WRITE |
+      RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+  if (!f)
+    f = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+        RETRO_VFS_FILE_ACCESS_HINT_NONE);
+  if (f)
+  {
+    filestream_seek(f, 0, RETRO_VFS_SEEK_POSITION_END);
+    if (!filestream_tell(f))
+    {
+      filestream_printf(f, "map,width,height,fps,frames,over_budget");
+      for (i = 0; i < NUMFRAMEHISTS; i++)
+        filestream_printf(f, ",%s_mean_ms,%s_low1_ms,%s_low01_ms,%s_max_ms",
+            framehistnames[i], framehistnames[i], framehistnames[i],
+            framehistnames[i]);
+      filestream_printf(f, "\n");
+    }
+    filestream_printf(f, "%s,%d,%d,%u,%u,%u", map, SCREENWIDTH, SCREENHEIGHT,
+        tic_vars.fps, numframes, overbudget);
+    for (i = 0; i < NUMFRAMEHISTS; i++)
+      filestream_printf(f, ",%.3f,%.1f,%.1f,%.1f",
+          framesum[i] / 1000.0 / numframes, D_FrameLow(framehist[i], 100),
+          D_FrameLow(framehist[i], 1000), framemax[i] / 1000.0);
+    filestream_printf(f, "\n");
+    filestream_close(f);
+  }
+  else
+    lprintf(LO_WARN, "D_ReportFrameStats: couldn't write %s\n", path);
+
+  memset(framehist, 0, sizeof framehist);
+  memset(framesum, 0, sizeof framesum);
+  memset(framemax, 0, sizeof framemax);
+  numframes = overbudget = 0;
+}
+
+//
+// Startup phases
+//
+// Which part of D_DoomMainSetup takes the time differs from one device to
+// the next (wad I/O, texture and sprite tables, the music players), so
+// each is timed on every launch. A phase's name must outlive the report.
+//
+
+#define MAXSTARTUPPHASES 48
+
+static struct {
+  const char *name;
+  int depth;
+  int64_t time;  // start while running, then how long it took
+} startupphases[MAXSTARTUPPHASES];
+
+static int numstartupphases, startupdepth;
+
+int D_StartupBegin(const char *name)
+{
+  if (!startupdepth)
+    numstartupphases = 0;
+  if (numstartupphases == MAXSTARTUPPHASES)
+  {
+    startupdepth++;
+    return -1;
+  }
+  startupphases[numstartupphases].name = name;
+  startupphases[numstartupphases].depth = startupdepth++;
+  startupphases[numstartupphases].time = I_GetTimeUS();
+  return numstartupphases++;
+}
+
+void D_StartupEnd(int phase)
+{
+  startupdepth--;
+  if (phase >= 0)
+    startupphases[phase].time = I_GetTimeUS() - startupphases[phase].time;
+}
+
+void D_ReportStartup(void)
+{
+  char path[PATH_MAX+1];
+#ifdef _WIN32
+  char slash = '\\';
+#else
+  char slash = '/';
+#endif
+  RFILE *f;
+  int i;
+
+  if (!numstartupphases || startupdepth)
+    return;
+
+  lprintf(LO_INFO, "D_ReportStartup:\n");
+  for (i = 0; i < numstartupphases; i++)
+    lprintf(LO_INFO, "  %*s%-*s %10.1f ms\n", startupphases[i].depth * 2, "",
+        24 - startupphases[i].depth * 2, startupphases[i].name,
+        startupphases[i].time / 1000.0);
+
+  snprintf(path, sizeof path, "%s%cstartup.json", I_DoomExeDir(), slash);
+  f = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+      RETRO_VFS_FILE_ACCESS_HINT_NONE);
+  if (!f)
+  {
+    lprintf(LO_WARN, "D_ReportStartup: couldn't write %s\n", path);
+    return;
+  }
+
+  filestream_printf(f, "{\n  \"phases\": [\n");
+  for (i = 0; i < numstartupphases; i++)
+  {
+    filestream_printf(f, "    { \"name\": ");
+    D_WriteJSONString(f, startupphases[i].name);
+    filestream_printf(f, ", \"depth\": %d, \"ms\": %.1f }%s\n",
+        startupphases[i].depth, startupphases[i].time / 1000.0,
+        i < numstartupphases-1 ? "," : "");
+  }
+  filestream_printf(f, "  ]\n}\n");
+  filestream_close(f);
+}
+
+//
+// D_CheckFixedMath
+//
+// FixedMul and FixedDiv may be built from per-architecture assembly; they
+// have to agree with FixedMul_C and FixedDiv_C bit for bit, or demos made
+// on one machine desync on another. Checks every pair of edge values and
+// a run of pseudo-random pairs spread over all magnitudes, as the callers'
+// arguments are, then times both versions over the same inputs.
+//
+
+#define FIXEDCHECKPAIRS 1000000
+
+static const int fixededges[] = {
+  0, 1, -1, 2, -2, 0x3fff, 0x4000, 0xffff, FRACUNIT, -FRACUNIT,
+  FRACUNIT+1, 0x7fff, 0x8000, -0x8000, 0x10001, 0x3fffffff, 0x40000000,
+  -0x40000000, INT_MAX, INT_MIN, INT_MIN+1
+};
+
+// Not P_Random: this mustn't disturb the game's random numbers
+static unsigned fixedseed;
+
+static int D_FixedArg(void)
+{
+  fixedseed = fixedseed * 1664525u + 1013904223u;
+  // shift the magnitude down by 0 to 31 bits, as the high bits pick
+  return (int) fixedseed >> (fixedseed >> 27);
+}
+
+void D_CheckFixedMath(void)
+{
+  static int args[2*FIXEDCHECKPAIRS];
+  const int numedges = sizeof fixededges / sizeof *fixededges;
+  int mulerrors = 0, diverrors = 0;
+  int64_t start, times[4];
+  volatile int sink = 0;
+  int i, j;
+
+  fixedseed = 1;
+  for (i = 0; i < 2*FIXEDCHECKPAIRS; i++)
+    args[i] = D_FixedArg();
+
+  for (i = 0; i < numedges; i++)
+    for (j = 0; j < numedges; j++)
+    {
+      int a = fixededges[i], b = fixededges[j];
+
+      mulerrors += FixedMul(a, b) != FixedMul_C(a, b);
+      diverrors += FixedDiv(a, b) != FixedDiv_C(a, b);
+    }
+  for (i = 0; i < 2*FIXEDCHECKPAIRS; i += 2)
+  {
+    mulerrors += FixedMul(args[i], args[i+1]) != FixedMul_C(args[i], args[i+1]);
+    diverrors += FixedDiv(args[i], args[i+1]) != FixedDiv_C(args[i], args[i+1]);
+  }
+
+  start = I_GetTimeUS();
+  for (i = 0; i < 2*FIXEDCHECKPAIRS; i += 2)
+    sink += FixedMul(args[i], args[i+1]);
+  times[0] = I_GetTimeUS() - start;
+  start = I_GetTimeUS();
+  for (i = 0; i < 2*FIXEDCHECKPAIRS; i += 2)
+    sink += FixedMul_C(args[i], args[i+1]);
+  times[1] = I_GetTimeUS() - start;
+  start = I_GetTimeUS();
+  for (i = 0; i < 2*FIXEDCHECKPAIRS; i += 2)
+    sink += FixedDiv(args[i], args[i+1]);
+  times[2] = I_GetTimeUS() - start;
+  start = I_GetTimeUS();
+  for (i = 0; i < 2*FIXEDCHECKPAIRS; i += 2)
+    sink += FixedDiv_C(args[i], args[i+1]);
+  times[3] = I_GetTimeUS() - start;
+
+  lprintf(mulerrors || diverrors ? LO_ERROR : LO_INFO,
+      "D_CheckFixedMath: %d FixedMul and %d FixedDiv mismatches in %d pairs\n",
+      mulerrors, diverrors, numedges*numedges + FIXEDCHECKPAIRS);
+  lprintf(LO_INFO, "  FixedMul %.1f ms (C %.1f ms), FixedDiv %.1f ms (C %.1f ms)\n",
+      times[0] / 1000.0, times[1] / 1000.0, times[2] / 1000.0, times[3] / 1000.0);
+}
+
+//
+// D_BenchDrawers
+//
+// Times every column and span drawer on made-up textures, over the 3D
+// view's columns a quarter, half and all of its height, and its rows a
+// quarter, half and all of its width. The point sampled drawers are
+// checked against a plain loop over the same texels; the rest report a
+// checksum of what they drew, to compare with another build's.
+//
+
+#define DRAWBENCHPIXELS (1<<23)
+#define DRAWBENCHTEXHEIGHT 128
+
+typedef struct {
+  const char *kind;
+  int pipeline, filter, filterz;
+  int size;
+  double mpixels;
+  unsigned checksum;
+  int mismatches; // -1 for drawers with no reference to check against
+} drawbench_t;
+
+static const char *const benchfilternames[RDRAW_FILTER_MAXFILTERS] = {
+  "none", "point", "linear", "rounded", "mipmap"
+};
+
+static const char *const benchpipelinenames[RDC_PIPELINE_MAXPIPELINES] = {
+  "standard", "translated", "fuzz"
+};
+
+static uint8_t benchcolumns[3*DRAWBENCHTEXHEIGHT];
+static uint8_t benchflat[FLAT_MIPSIZE];
+
+static INLINE pixel_t *D_BenchPixel(int x, int y)
+{
+  return drawvars.short_topleft + y * drawvars.short_pitch + x * drawvars.short_colpitch;
+}
+
+static void D_BenchClear(void)
+{
+  int x, y;
+
+  for (y = 0; y < viewheight; y++)
+    for (x = 0; x < viewwidth; x++)
+      *D_BenchPixel(x, y) = 0;
+}
+
+// FNV-1a over the view, row by row whatever the buffer's layout
+static unsigned D_BenchChecksum(void)
+{
+  unsigned h = 2166136261u;
+  int x, y;
+
+  for (y = 0; y < viewheight; y++)
+    for (x = 0; x < viewwidth; x++)
+    {
+      pixel_t p = *D_BenchPixel(x, y);
+      h = (h ^ (p & 0xff)) * 16777619u;
+      h = (h ^ (p >> 8)) * 16777619u;
+    }
+  return h;
+}
+
+static void D_BenchColumnVars(draw_column_vars_t *dcvars, int x, int height)
+{
+  R_SetDefaultDrawColumnVars(dcvars);
+  dcvars->x            = x;
+  dcvars->yl           = (viewheight - height) / 2;
+  dcvars->yh           = dcvars->yl + height - 1;
+  dcvars->iscale       = DRAWBENCHTEXHEIGHT * FRACUNIT / height;
+  dcvars->texturemid   = (centery - dcvars->yl) * dcvars->iscale + x * FRACUNIT;
+  dcvars->texheight    = DRAWBENCHTEXHEIGHT;
+  dcvars->texu         = x * 0x5555;
+  dcvars->z            = 0x80000;
+  dcvars->prevsource   = benchcolumns;
+  dcvars->source       = benchcolumns + DRAWBENCHTEXHEIGHT;
+  dcvars->nextsource   = benchcolumns + 2*DRAWBENCHTEXHEIGHT;
+  dcvars->colormap     = colormaps[0] + 8*256;
+  dcvars->nextcolormap = colormaps[0] + 9*256;
+  dcvars->translation  = translationtables;
+}
+
+static void D_BenchSpanVars(draw_span_vars_t *dsvars, int y, int length)
+{
+  dsvars->y            = y;
+  dsvars->x1           = (viewwidth - length) / 2;
+  dsvars->x2           = dsvars->x1 + length - 1;
+  dsvars->z            = 0x80000;
+  dsvars->xfrac        = y * 0x3333;
+  dsvars->yfrac        = y * FRACUNIT;
+  dsvars->xstep        = 4*64 * FRACUNIT / length;
+  dsvars->ystep        = 64 * FRACUNIT / length;
+  dsvars->source       = benchflat;
+  dsvars->rounded      = NULL;
+  dsvars->colormap     = colormaps[0] + 8*256;
+  dsvars->nextcolormap = colormaps[0] + 9*256;
+}
+
+static void D_BenchDrawColumns(R_DrawColumn_f func, int height)
+{
+  draw_column_vars_t dcvars;
+  int x;
+
+  for (x = 0; x < viewwidth; x++)
+  {
+    D_BenchColumnVars(&dcvars, x, height);
+    func(&dcvars);
+  }
+  R_ResetColumnBuffer();
+}
+
+static void D_BenchDrawSpans(R_DrawSpan_f func, int length)
+{
+  draw_span_vars_t dsvars;
+  int y;
+
+  for (y = 0; y < viewheight; y++)
+  {
+    D_BenchSpanVars(&dsvars, y, length);
+    func(&dsvars);
+  }
+}
+
+// What a point sampled column drawer should have drawn, pixel by pixel
+static int D_BenchCheckColumns(int pipeline, int filterz, int height)
+{
+  draw_column_vars_t dcvars;
+  int x, y, mismatches = 0;
+
+  for (x = 0; x < viewwidth; x++)
+  {
+    const pixel_t *colormap16;
+    fixed_t frac;
+
+    D_BenchColumnVars(&dcvars, x, height);
+    colormap16 = V_Colormap16(dcvars.colormap);
+    frac = dcvars.texturemid + (dcvars.yl - centery) * dcvars.iscale;
+    for (y = dcvars.yl; y <= dcvars.yh; y++, frac += dcvars.iscale)
+    {
+      int c = dcvars.source[(frac >> FRACBITS) & (DRAWBENCHTEXHEIGHT-1)];
+
+      if (pipeline == RDC_PIPELINE_TRANSLATED)
+        c = dcvars.translation[c];
+      mismatches += *D_BenchPixel(x, y) != (filterz == RDRAW_FILTER_NONE ?
+          VID_PAL16(c, VID_COLORWEIGHTMASK) : colormap16[c]);
+    }
+  }
+  return mismatches;
+}
+
+static int D_BenchCheckSpans(int length)
+{
+  draw_span_vars_t dsvars;
+  int x, y, mismatches = 0;
+
+  for (y = 0; y < viewheight; y++)
+  {
+    const pixel_t *colormap16;
+    fixed_t xfrac, yfrac;
+
+    D_BenchSpanVars(&dsvars, y, length);
+    colormap16 = V_Colormap16(dsvars.colormap);
+    xfrac = dsvars.xfrac;
+    yfrac = dsvars.yfrac;
+    for (x = dsvars.x1; x <= dsvars.x2; x++, xfrac += dsvars.xstep, yfrac += dsvars.ystep)
+      mismatches += *D_BenchPixel(x, y) !=
+        colormap16[dsvars.source[((xfrac >> 16) & 63) | ((yfrac >> 10) & 4032)]];
+  }
+  return mismatches;
+}
+
+static void D_BenchDrawer(drawbench_t *b, R_DrawColumn_f colfunc, R_DrawSpan_f spanfunc)
+{
+  const int passpixels = b->size * (colfunc ? viewwidth : viewheight);
+  const int passes = (DRAWBENCHPIXELS + passpixels - 1) / passpixels;
+  int64_t start, time;
+  int i;
+
+  D_BenchClear();
+  if (colfunc)
+    D_BenchDrawColumns(colfunc, b->size);
+  else
+    D_BenchDrawSpans(spanfunc, b->size);
+  b->checksum = D_BenchChecksum();
+
+  b->mismatches = -1;
+  if (colfunc && b->filter == RDRAW_FILTER_POINT &&
+      b->filterz != RDRAW_FILTER_LINEAR && b->pipeline != RDC_PIPELINE_FUZZ)
+    b->mismatches = D_BenchCheckColumns(b->pipeline, b->filterz, b->size);
+  else if (spanfunc && b->filter == RDRAW_FILTER_POINT && b->filterz == RDRAW_FILTER_POINT)
+    b->mismatches = D_BenchCheckSpans(b->size);
+
+  start = I_GetTimeUS();
+  for (i = 0; i < passes; i++)
+    if (colfunc)
+      D_BenchDrawColumns(colfunc, b->size);
+    else
+      D_BenchDrawSpans(spanfunc, b->size);
+  time = I_GetTimeUS() - start;
+
+  b->mpixels = time > 0 ? (double)passes * passpixels / time : 0;
+}
+
+void D_BenchDrawers(void)
+{
+  static const int filters[] = {
+    RDRAW_FILTER_POINT, RDRAW_FILTER_LINEAR, RDRAW_FILTER_ROUNDED, RDRAW_FILTER_MIPMAP
+  };
+  // columns have no mipmapped drawers of their own, spans no unlit ones
+  static const int columnfilterzs[] = {
+    RDRAW_FILTER_NONE, RDRAW_FILTER_POINT, RDRAW_FILTER_LINEAR
+  };
+  static const int spanfilterzs[] = { RDRAW_FILTER_POINT, RDRAW_FILTER_LINEAR };
+  drawbench_t *benches, *b;
+  int numbenches = 0, mismatches = 0;
+  char path[PATH_MAX+1];
+#ifdef _WIN32
+  char slash = '\\';
+#else
+  char slash = '/';
+#endif
+  unsigned seed = 1;
+  RFILE *f;
+  int i, p, fi, zi, s;
+
+  if (!screens[0].data || !colormaps || !translationtables)
+  {
+    lprintf(LO_WARN, "D_BenchDrawers: no screen to draw on\n");
+    return;
+  }
+  if (!viewheight)
+    R_ExecuteSetViewSize();
+  if (!V_Palette16)
+    V_SetPalette(0);
+  R_StartViewBuffer(-1);
+
+  // Not P_Random: this mustn't disturb the game's random numbers
+  for (i = 0; i < (int)sizeof benchcolumns; i++)
+    benchcolumns[i] = (seed = seed * 1664525u + 1013904223u) >> 24;
+  for (i = 0; i < (int)sizeof benchflat; i++)
+    benchflat[i] = (seed = seed * 1664525u + 1013904223u) >> 24;
+
+  benches = malloc((RDC_PIPELINE_MAXPIPELINES * 3 * 3 + 4 * 2) * 3 * sizeof *benches);
+
+  for (s = 1; s <= 4; s *= 2)
+  {
+    for (p = 0; p < RDC_PIPELINE_MAXPIPELINES; p++)
+      for (zi = 0; zi < 3; zi++)
+        for (fi = 0; fi < 3; fi++)
+        {
+          b = &benches[numbenches++];
+          b->kind     = "column";
+          b->pipeline = p;
+          b->filter   = filters[fi];
+          b->filterz  = columnfilterzs[zi];
+          b->size     = viewheight * s / 4;
+          D_BenchDrawer(b, R_GetDrawColumnFunc(p, b->filter, b->filterz), NULL);
+        }
+    for (zi = 0; zi < 2; zi++)
+      for (fi = 0; fi < 4; fi++)
+      {
+        b = &benches[numbenches++];
+        b->kind     = "span";
+        b->pipeline = RDC_PIPELINE_STANDARD;
+        b->filter   = filters[fi];
+        b->filterz  = spanfilterzs[zi];
+        b->size     = viewwidth * s / 4;
+        D_BenchDrawer(b, NULL, R_GetDrawSpanFunc(b->filter, b->filterz));
+      }
+  }
+
+  // leave the view as the next frame's drawing would find it
+  D_BenchClear();
+
+  lprintf(LO_INFO, "D_BenchDrawers: %dx%d view\n", viewwidth, viewheight);
+  for (i = 0; i < numbenches; i++)
+  {
+    b = &benches[i];
+    lprintf(b->mismatches > 0 ? LO_ERROR : LO_INFO,
+        "  %-6s %-10s %-7s %-6s %4d %8.1f Mpix/s  %08x%s\n",
+        b->kind, benchpipelinenames[b->pipeline], benchfilternames[b->filter],
+        benchfilternames[b->filterz], b->size, b->mpixels, b->checksum,
+        b->mismatches > 0 ? "  MISMATCHED" : "");
+    if (b->mismatches > 0)
+      mismatches += b->mismatches;
+  }
+  if (mismatches)
+    lprintf(LO_ERROR, "D_BenchDrawers: %d pixels differ from the reference\n", mismatches);
+
+  snprintf(path, sizeof path, "%s%cdrawbench.json", I_DoomExeDir(), slash);
+  f = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+      RETRO_VFS_FILE_ACCESS_HINT_NONE);
+  if (!f)
+  {
+    lprintf(LO_WARN, "D_BenchDrawers: couldn't write %s\n", path);
+    free(benches);
+    return;
+  }
+
+  filestream_printf(f, "{\n  \"width\": %d,\n  \"height\": %d,\n  \"drawers\": [\n",
+      viewwidth, viewheight);
+  for (i = 0; i < numbenches; i++)
+  {
+    b = &benches[i];
+    filestream_printf(f, "    { \"kind\": \"%s\", \"pipeline\": \"%s\", \"filter\": \"%s\", "
+        "\"filterz\": \"%s\", \"size\": %d, \"mpixels\": %.1f, \"checksum\": \"%08x\", "
+        "\"mismatches\": %d }%s\n",
+        b->kind, benchpipelinenames[b->pipeline], benchfilternames[b->filter],
+        benchfilternames[b->filterz], b->size, b->mpixels, b->checksum,
+        b->mismatches, i < numbenches-1 ? "," : "");
+  }
+  filestream_printf(f, "  ]\n}\n");
+  filestream_close(f);
+  free(benches);
+}
+
+//
+// D_MemorySweep
+//
+// Loads every map the wads have, in order, runs it for a few seconds
+// with nobody at the controls, then views it from a handful of things'
+// spots in eight directions each. Notes the zone's peak under each tag
+// since the map began to load, and what the lump, patch and render arena
+// caches have grown to, one line a map. The render arena's is the most
+// any map has needed so far, as it's never given back.
+//
+
+#define MEMSWEEPSPOTS  8
+#define MEMSWEEPANGLES 8
+
+static const char *const sweeptagnames[PU_MAX] = {
+  NULL, "static", "sound", "music", "level", "levspec", "cache"
+};
+
+// Puts the player where the spot'th thing on the list is
+static dbool D_SweepSpot(player_t *player, int spot)
+{
+  mobj_t *mo = player->mo;
+  thinker_t *th = NULL;
+  int i = 0;
+
+  while ((th = P_NextThinker(th, th_all)) != NULL)
+    if (th->function == P_MobjThinker && i++ == spot)
+      break;
+  if (!th)
+    return FALSE;
+
+  P_UnsetThingPosition(mo);
+  mo->x = ((mobj_t *)th)->x;
+  mo->y = ((mobj_t *)th)->y;
+  P_SetThingPosition(mo);
+  mo->z = mo->subsector->sector->floorheight;
+  mo->PrevX = mo->x;
+  mo->PrevY = mo->y;
+  mo->PrevZ = mo->z;
+  player->viewz = player->prev_viewz = mo->z + VIEWHEIGHT;
+  return TRUE;
+}
+
+static void D_SweepView(player_t *player, int spot)
+{
+  mobj_t *mo = player->mo;
+  int a;
+
+  if (!D_SweepSpot(player, spot))
+    return;
+
+  for (a = 0; a < MEMSWEEPANGLES; a++)
+  {
+    mo->angle = player->prev_viewangle = (angle_t)a * (ANG90 / (MEMSWEEPANGLES / 4));
+    player->prev_viewpitch = mo->pitch;
+    R_RenderPlayerView(player);
+  }
+}
+
+void D_MemorySweep(int tics)
+{
+  char path[PATH_MAX+1];
+#ifdef _WIN32
+  char slash = '\\';
+#else
+  char slash = '/';
+#endif
+  const dbool draw = screens[0].data && !nodrawers && !M_CheckParm("-nodraw");
+  int episodes = gamemode == commercial ? 1 : gamemode == shareware ? 1 :
+    gamemode == retail ? 4 : 3;
+  int maps = gamemode == commercial ? 99 : 9;
+  int ep, map, tag, i;
+  RFILE *f;
+
+  snprintf(path, sizeof path, "%s%cmemsweep.csv", I_DoomExeDir(), slash);
+  f = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+      RETRO_VFS_FILE_ACCESS_HINT_NONE);
+  if (!f)
+  {
+    lprintf(LO_WARN, "D_MemorySweep: couldn't write %s\n", path);
+    return;
+  }
+  filestream_printf(f, "map,tics,views,system_kb");
+  for (tag = PU_STATIC; tag < PU_MAX; tag++)
+    filestream_printf(f, ",%s_peak_kb", sweeptagnames[tag]);
+  filestream_printf(f, ",lumpcache_kb,patchcache_kb,renderarena_kb\n");
+
+  if (draw)
+  {
+    if (!viewheight)
+      R_ExecuteSetViewSize();
+    if (!V_Palette16)
+      V_SetPalette(0);
+  }
+
+  for (ep = 1; ep <= episodes; ep++)
+    for (map = 1; map <= maps; map++)
+    {
+      char name[9];
+      player_t *player = &players[consoleplayer];
+      int spots = 0, views = 0;
+      thinker_t *th = NULL;
+
+      if (gamemode == commercial)
+        snprintf(name, sizeof name, "MAP%02d", map);
+      else
+        snprintf(name, sizeof name, "E%dM%d", ep, map);
+      if (W_CheckNumForName(name) < 0)
+        continue;
+
+      G_InitNew(sk_medium, ep, map);
+      for (i = 0; i < tics; i++)
+      {
+        int j;
+
+        for (j = 0; j < MAXPLAYERS; j++)
+          memset(&players[j].cmd, 0, sizeof players[j].cmd);
+        P_Ticker();
+      }
+
+      if (draw && player->mo)
+      {
+        int numthings = 0;
+
+        while ((th = P_NextThinker(th, th_all)) != NULL)
+          numthings += th->function == P_MobjThinker;
+        spots = numthings < MEMSWEEPSPOTS ? numthings : MEMSWEEPSPOTS;
+        for (i = 0; i < spots; i++)
+          D_SweepView(player, i * numthings / spots);
+        views = spots * MEMSWEEPANGLES;
+      }
+
+      filestream_printf(f, "%s,%d,%d,%u", name, tics, views,
+          (unsigned)(Z_GetSystemBytes() >> 10));
+      for (tag = PU_STATIC; tag < PU_MAX; tag++)
+        filestream_printf(f, ",%u", (unsigned)(Z_GetTagStats(tag)->peak >> 10));
+      filestream_printf(f, ",%u,%u,%u\n", (unsigned)(W_CacheBytes() >> 10),
+          (unsigned)(R_PatchCacheBytes() >> 10), (unsigned)(R_RenderArenaBytes() >> 10));
+      lprintf(LO_INFO, "D_MemorySweep: %s, %u KB from the system\n", name,
+          (unsigned)(Z_GetSystemBytes() >> 10));
+    }
+
+  filestream_close(f);
+  lprintf(LO_INFO, "D_MemorySweep: wrote %s\n", path);
+}
+
+//
+// D_AutoTune
+//
+// Loads the first map the wads have and times the view from a fixed set
+// of things' spots, with each mix of wall and floor filtering and of
+// render and job threads. Keeps the best looking filtering that some
+// mix of thread counts draws within the render's share of a frame, with
+// the fastest such thread counts, and writes every timing to
+// autotune.json. The view is timed at the size it has; the screen's
+// resolution is only picked as the core starts, so when nothing fits the
+// log says so instead.
+//
+
+int autotune_render_threads = -1;
+int autotune_job_threads = -1;
+
+#define AUTOTUNESPOTS  4
+#define AUTOTUNEANGLES 4
+#define AUTOTUNEPASSES 2   // each view's fastest pass counts
+#define AUTOTUNESHARE  75  // percent of the frame the view may take
+
+typedef struct {
+  enum draw_filter_type_e wall, floor;
+} autotunefilter_t;
+
+// worst looking first
+static const autotunefilter_t autotunefilters[] = {
+  { RDRAW_FILTER_POINT,  RDRAW_FILTER_POINT  },
+  { RDRAW_FILTER_LINEAR, RDRAW_FILTER_POINT  },
+  { RDRAW_FILTER_LINEAR, RDRAW_FILTER_LINEAR },
+};
+#define AUTOTUNEFILTERS (int)(sizeof autotunefilters / sizeof *autotunefilters)
+
+#ifdef PRBOOM_THREADS
+static const int autotunerender[] = { 1, 2, 4 };
+static const int autotunejobs[] = { 0, 2, 4 };
+#else
+static const int autotunerender[] = { 1 };
+static const int autotunejobs[] = { 0 };
+#endif
+#define AUTOTUNERENDER (int)(sizeof autotunerender / sizeof *autotunerender)
+#define AUTOTUNEJOBS   (int)(sizeof autotunejobs / sizeof *autotunejobs)
+
+typedef struct {
+  int filter, renderthreads, jobthreads;
+  int64_t slowest, total;  // microseconds, each view's fastest pass
+} autotune_t;
+
+// Times one view from each of the spots in turn
+static void D_AutoTuneViews(player_t *player, int numthings, int64_t *times)
+{
+  int i;
+
+  for (i = 0; i < AUTOTUNESPOTS * AUTOTUNEANGLES; i++)
+  {
+    int a = i % AUTOTUNEANGLES;
+    mobj_t *mo = player->mo;
+    int64_t start;
+
+    if (a == 0)
+      D_SweepSpot(player, i / AUTOTUNEANGLES * numthings / AUTOTUNESPOTS);
+    start = I_GetTimeUS();
+    mo->angle = player->prev_viewangle = (angle_t)a * (ANG90 / (AUTOTUNEANGLES / 4));
+    player->prev_viewpitch = mo->pitch;
+    R_RenderPlayerView(player);
+    times[i] = I_GetTimeUS() - start;
+  }
+}
+
+void D_AutoTune(void)
+{
+  char path[PATH_MAX+1];
+#ifdef _WIN32
+  char slash = '\\';
+#else
+  char slash = '/';
+#endif
+  const int fps = tic_vars.fps ? tic_vars.fps : 60;
+  const int64_t budget = 1000000 * AUTOTUNESHARE / 100 / fps;
+  const int dynres = R_GetDynamicResolution();
+  int episodes = gamemode == commercial ? 1 : gamemode == shareware ? 1 :
+    gamemode == retail ? 4 : 3;
+  int maps = gamemode == commercial ? 99 : 9;
+  player_t *player = &players[consoleplayer];
+  int64_t times[AUTOTUNESPOTS * AUTOTUNEANGLES], best[AUTOTUNESPOTS * AUTOTUNEANGLES];
+  autotune_t tunes[AUTOTUNEFILTERS * AUTOTUNERENDER * AUTOTUNEJOBS], *t, *pick = NULL;
+  int numtunes = 0, numthings = 0;
+  int ep, map, f, r, j, i, pass;
+  thinker_t *th = NULL;
+  RFILE *out;
+
+  if (!screens[0].data || I_GetTimeUS() == 0)
+  {
+    lprintf(LO_WARN, "D_AutoTune: needs a screen and a clock\n");
+    return;
+  }
+
+  for (ep = 1; ep <= episodes; ep++)
+  {
+    for (map = 1; map <= maps; map++)
+    {
+      char name[9];
+
+      if (gamemode == commercial)
+        snprintf(name, sizeof name, "MAP%02d", map);
+      else
+        snprintf(name, sizeof name, "E%dM%d", ep, map);
+      if (W_CheckNumForName(name) >= 0)
+        break;
+    }
+    if (map <= maps)
+      break;
+  }
+  if (ep > episodes)
+  {
+    lprintf(LO_WARN, "D_AutoTune: no map to view\n");
+    return;
+  }
+
+  if (!viewheight)
+    R_ExecuteSetViewSize();
+  if (!V_Palette16)
+    V_SetPalette(0);
+
+  G_InitNew(sk_medium, ep, map);
+  while ((th = P_NextThinker(th, th_all)) != NULL)
+    numthings += th->function == P_MobjThinker;
+  if (!player->mo || numthings < AUTOTUNESPOTS)
+  {
+    lprintf(LO_WARN, "D_AutoTune: too few things on the map to view from\n");
+    return;
+  }
+
+  // the view has to stay the size being timed
+  R_SetDynamicResolution(0);
+
+  // once untimed, to load what the views need
+  D_AutoTuneViews(player, numthings, times);
+
+  for (f = 0; f < AUTOTUNEFILTERS; f++)
+    for (r = 0; r < AUTOTUNERENDER; r++)
+      for (j = 0; j < AUTOTUNEJOBS; j++)
+      {
+        t = &tunes[numtunes++];
+        t->filter = f;
+        t->renderthreads = autotunerender[r];
+        t->jobthreads = autotunejobs[j];
+        t->slowest = t->total = 0;
+
+        drawvars.filterwall = autotunefilters[f].wall;
+        drawvars.filterfloor = autotunefilters[f].floor;
+        R_SetRenderThreads(t->renderthreads);
+        I_SetJobThreads(t->jobthreads);
+
+        for (pass = 0; pass < AUTOTUNEPASSES; pass++)
+        {
+          D_AutoTuneViews(player, numthings, times);
+          for (i = 0; i < AUTOTUNESPOTS * AUTOTUNEANGLES; i++)
+            if (!pass || times[i] < best[i])
+              best[i] = times[i];
+        }
+        for (i = 0; i < AUTOTUNESPOTS * AUTOTUNEANGLES; i++)
+        {
+          t->total += best[i];
+          if (best[i] > t->slowest)
+            t->slowest = best[i];
+        }
+      }
+
+  // the best looking filtering with a fit, else the fastest of all
+  for (i = 0; i < numtunes; i++)
+  {
+    t = &tunes[i];
+    if (t->slowest <= budget && (!pick || pick->slowest > budget ||
+        t->filter > pick->filter ||
+        (t->filter == pick->filter && t->slowest < pick->slowest)))
+      pick = t;
+    else if (!pick || (pick->slowest > budget && t->slowest < pick->slowest))
+      pick = t;
+  }
+
+  drawvars.filterwall = autotunefilters[pick->filter].wall;
+  drawvars.filterfloor = autotunefilters[pick->filter].floor;
+  autotune_render_threads = pick->renderthreads;
+  autotune_job_threads = pick->jobthreads;
+  R_SetRenderThreads(pick->renderthreads);
+  I_SetJobThreads(pick->jobthreads);
+  R_SetDynamicResolution(dynres);
+  M_SaveDefaults();
+
+  lprintf(LO_INFO, "D_AutoTune: %dx%d view, %d fps, %d us budget\n",
+      viewwidth, viewheight, fps, (int)budget);
+  for (i = 0; i < numtunes; i++)
+  {
+    t = &tunes[i];
+    lprintf(LO_INFO, "  %-6s %-6s %d render %d job threads %6d us slowest %6d us mean%s\n",
+        benchfilternames[autotunefilters[t->filter].wall],
+        benchfilternames[autotunefilters[t->filter].floor],
+        t->renderthreads, t->jobthreads, (int)t->slowest,
+        (int)(t->total / (AUTOTUNESPOTS * AUTOTUNEANGLES)), t == pick ? "  PICKED" : "");
+  }
+  if (pick->slowest > budget)
+    lprintf(LO_WARN, "D_AutoTune: nothing fits %d fps at this resolution; "
+        "a lower resolution or dynamic resolution would\n", fps);
+
+  snprintf(path, sizeof path, "%s%cautotune.json", I_DoomExeDir(), slash);
+  out = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+      RETRO_VFS_FILE_ACCESS_HINT_NONE);
+  if (!out)
+  {
+    lprintf(LO_WARN, "D_AutoTune: couldn't write %s\n", path);
+    return;
+  }
+  filestream_printf(out, "{\n  \"width\": %d,\n  \"height\": %d,\n  \"fps\": %d,\n"
+      "  \"budget_us\": %d,\n  \"fits\": %s,\n  \"tunes\": [\n",
+      viewwidth, viewheight, fps, (int)budget, pick->slowest <= budget ? "true" : "false");
+  for (i = 0; i < numtunes; i++)
+  {
+    t = &tunes[i];
+    filestream_printf(out, "    { \"filter_wall\": \"%s\", \"filter_floor\": \"%s\", "
+        "\"render_threads\": %d, \"job_threads\": %d, \"slowest_us\": %d, "
+        "\"mean_us\": %d, \"picked\": %s }%s\n",
+        benchfilternames[autotunefilters[t->filter].wall],
+        benchfilternames[autotunefilters[t->filter].floor],
+        t->renderthreads, t->jobthreads, (int)t->slowest,
+        (int)(t->total / (AUTOTUNESPOTS * AUTOTUNEANGLES)),
+        t == pick ? "true" : "false", i < numtunes-1 ? "," : "");
+  }
+  filestream_printf(out, "  ]\n}\n");
+  filestream_close(out);
+  lprintf(LO_INFO, "D_AutoTune: wrote %s\n", path);
+}
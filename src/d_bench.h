@@ -0,0 +1,143 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Timed demos: -timedemo plays a demo a tic a frame, timing the game
+ *      logic, the view and the sound mixer, and reports the totals to the
+ *      log and to timedemo.json when it ends.
+ *      Startup phases are timed every launch, and reported to the log
+ *      and to startup.json.
+ *
+ *-----------------------------------------------------------------------------*/
+
+
+#ifndef __D_BENCH__
+#define __D_BENCH__
+
+#include <retro_inline.h>
+#include "doomtype.h"
+#include "i_system.h"
+
+// -timedemo: play the demo a tic a frame and time it
+extern dbool timingdemo;
+// -nodraw: and don't draw anything while doing so
+extern dbool nodrawers;
+// -synclog: log P_StateChecksum after every level tic
+extern dbool synclog;
+
+typedef enum {
+  BENCH_TICKER,   // P_Ticker
+  BENCH_RENDER,   // R_RenderPlayerView
+  BENCH_SOUND,    // I_UpdateSound
+  BENCH_INTERCEPTS, // P_SortIntercepts, part of P_Ticker
+  // The rest are parts of P_Ticker too, and may overlap one another
+  BENCH_THINKERS, // P_RunThinkers
+  BENCH_SPECIALS, // P_UpdateSpecials and P_RespawnSpecials
+  BENCH_SIGHT,    // P_CheckSight
+  BENCH_TRAVERSE, // P_PathTraverse
+  BENCH_TRYMOVE,  // P_TryMove
+  NUMBENCHSTAGES
+} benchstage_e;
+
+// Microseconds spent in each so far, and frames shown
+extern int64_t benchtime[NUMBENCHSTAGES];
+extern int benchframes;
+
+static INLINE int64_t D_BenchStart(void)
+{
+  return timingdemo ? I_GetTimeUS() : 0;
+}
+
+static INLINE void D_BenchStop(benchstage_e stage, int64_t start)
+{
+  if (timingdemo)
+    benchtime[stage] += I_GetTimeUS() - start;
+}
+
+// Frame statistics: each frame's time, and the game logic, view and
+// sound mixer parts of it, kept as histograms for the map being played
+// and reported when it ends
+extern dbool framestats;
+extern int64_t framestagetime[BENCH_SOUND+1];
+
+// For the three stages frame statistics split a frame into: timed for
+// a timed demo, for frame statistics, or both
+static INLINE int64_t D_StageStart(void)
+{
+  return timingdemo || framestats ? I_GetTimeUS() : 0;
+}
+
+static INLINE void D_StageStop(benchstage_e stage, int64_t start)
+{
+  if (timingdemo || framestats)
+  {
+    int64_t time = I_GetTimeUS() - start;
+
+    if (timingdemo)
+      benchtime[stage] += time;
+    framestagetime[stage] += time;
+  }
+}
+
+// Call at the start and end of each frame the frontend asks for
+void D_StartFrameStats(void);
+void D_EndFrameStats(void);
+// Logs the map's frame statistics, adds them to framestats.csv and
+// starts the next map afresh; nothing if no frame of it was counted
+void D_ReportFrameStats(void);
+
+// Call as the timed demo starts playing, and once it has run out
+void D_StartTimingDemo(const char *name);
+void D_FinishTimingDemo(void);
+// Call after each tic of a level the timed demo plays, with its
+// P_StateChecksum
+void D_BenchTic(uint32_t checksum);
+
+// Startup phases, which may nest: D_StartupBegin returns what to hand to
+// D_StartupEnd. A phase begun outside any other starts the list afresh.
+int D_StartupBegin(const char *name);
+void D_StartupEnd(int phase);
+// Once the outermost phase has ended
+void D_ReportStartup(void);
+
+// -fixedcheck: compare FixedMul/FixedDiv against the portable versions
+void D_CheckFixedMath(void);
+
+// -drawbench: time the column and span drawers, once the screen is set up
+void D_BenchDrawers(void);
+
+// -memsweep: run each map for tics tics, view it, and log what memory it took
+void D_MemorySweep(int tics);
+
+// -autotune: time the view with each filtering and thread count, keep the
+// best that fits a frame; -autotune once: only if that was never done.
+// The thread counts are kept for the frontend's "auto" settings.
+extern int autotune_render_threads, autotune_job_threads;
+void D_AutoTune(void);
+
+#endif
@@ -59,7 +59,10 @@
 #include "i_video.h"
 #include "m_argv.h"
 #include "r_fps.h"
+#include "i_thread.h"
 #include "lprintf.h"
+#include "d_bench.h"
+#include "v_video.h"
 
 ticcmd_t         netcmds[MAXPLAYERS][BACKUPTICS];
 static ticcmd_t* localcmds;
@@ -67,6 +70,280 @@ int maketic;
 int ticdup = 1;
 int              wanted_player_number;
 
+//
+// Pipelined tics
+//
+// With render_pipelined set, a plain level tic that falls due is held
+// back by TryRunTics and the frame is drawn from the state before it.
+// Once R_RenderPlayerView has recorded the view it calls
+// D_StartPendingTic, and G_Ticker runs on ticthread while the draw list
+// is filled in; D_Display waits for it before the automap, status bar
+// and messages, so only the 3D view sees the old state. When frames are
+// interpolated it is drawn at a frac of FRACUNIT, the point the frames
+// before were heading for, so the cost is a frame of latency.
+//
+
+int render_pipelined;
+
+static dbool     ticpending, ticstarted;
+static fixed_t   ticoverflow;
+
+#ifdef PRBOOM_THREADS
+static i_thread_t *ticthread;
+static i_mutex_t *ticlock;
+static i_cond_t  *ticstart, *ticdone;
+static dbool     ticrunning, ticquit;
+
+static void D_TicWorker(void *arg)
+{
+  I_MutexLock(ticlock);
+  for (;;)
+  {
+    while (!ticrunning && !ticquit)
+      I_CondWait(ticstart, ticlock);
+    if (ticquit)
+      break;
+    I_MutexUnlock(ticlock);
+
+    G_Ticker();
+
+    I_MutexLock(ticlock);
+    ticrunning = FALSE;
+    I_CondSignal(ticdone);
+  }
+  I_MutexUnlock(ticlock);
+}
+#endif
+
+// Nothing that can load a level, change the game state or wait on the
+// menu; those tics run in TryRunTics as always
+static dbool D_CanHoldTic(void)
+{
+  return render_pipelined && gamestate == GS_LEVEL && wipegamestate == GS_LEVEL &&
+    gametic != basetic && gameaction == ga_nothing &&
+    !paused && !menuactive && !advancedemo;
+}
+
+dbool D_TicPending(void)
+{
+  return ticpending && !ticstarted;
+}
+
+void D_StartPendingTic(void)
+{
+#ifdef PRBOOM_THREADS
+  if (!D_TicPending())
+    return;
+
+  if (!ticthread)
+  {
+    if (!ticlock)
+    {
+      ticlock  = I_MutexCreate();
+      ticstart = I_CondCreate();
+      ticdone  = I_CondCreate();
+    }
+    if (!ticlock || !ticstart || !ticdone ||
+        !(ticthread = I_ThreadCreate(D_TicWorker, NULL)))
+    {
+      lprintf(LO_WARN, "D_StartPendingTic: threads unavailable\n");
+      render_pipelined = 0;
+      return;
+    }
+  }
+
+  I_MutexLock(ticlock);
+  ticrunning = TRUE;
+  I_CondSignal(ticstart);
+  I_MutexUnlock(ticlock);
+  ticstarted = TRUE;
+#endif
+}
+
+void D_FinishPendingTic(void)
+{
+  if (!ticpending)
+    return;
+
+#ifdef PRBOOM_THREADS
+  if (ticstarted)
+  {
+    I_MutexLock(ticlock);
+    while (ticrunning)
+      I_CondWait(ticdone, ticlock);
+    I_MutexUnlock(ticlock);
+  }
+  else
+#endif
+    G_Ticker();
+
+  ticpending = ticstarted = FALSE;
+  tic_vars.frac = ticoverflow;
+  gametic++;
+}
+
+int D_PendingTurn(void)
+{
+  return maketic > gametic ? localcmds[(maketic-1) % BACKUPTICS].angleturn : 0;
+}
+
+// Only plain level tics, as for held back ones; anything else is left
+// to the frame's own tic
+dbool D_CanRunExtraTic(void)
+{
+  return gamestate == GS_LEVEL && wipegamestate == GS_LEVEL &&
+    gametic != basetic && gameaction == ga_nothing &&
+    !paused && !menuactive && !advancedemo && !ticpending && !netgame;
+}
+
+// The input isn't polled again: the tic gets the ticcmd built from what
+// came in last, which the demo being played replaces anyway
+void D_RunExtraTic(void)
+{
+  if (maketic <= gametic)
+  {
+    G_BuildTiccmd(&localcmds[maketic % BACKUPTICS]);
+    maketic++;
+  }
+  G_Ticker();
+  gametic++;
+}
+
+//
+// Tic catch-up
+//
+// The frontend asks for a frame every 1/fps seconds and each moves the
+// game on by frac_step. On a device that can't keep up the frames come
+// late, and the game slows down with them. With tic_catchup above 1 the
+// wall time between frames is measured, and the tics it owes beyond
+// frac_step are run as extra tics ahead of the frame's own, up to
+// tic_catchup tics a frame in all; whatever that can't make up is
+// dropped. With tic_skipframes, a frame that is still behind isn't drawn,
+// though never two in a row.
+//
+
+int tic_catchup = 1;
+int tic_skipframes;
+
+#define CATCHUP_PAUSE 250000    // us between frames taken for a pause
+
+static fixed_t  catchupdebt;    // tics owed, FRACUNIT each
+static int64_t  catchuplast;    // when the last frame started
+static int      catchuptic;     // gametic then
+static dbool    catchupbehind, catchupskipped;
+static unsigned catchupran, catchupdropped, catchupskips, catchuprepeats;
+
+void D_CatchUpTics(void)
+{
+  int64_t now = I_GetTimeUS(), elapsed = now - catchuplast;
+  int tics;
+
+  if (gametic == catchuptic)
+    catchuprepeats++;
+  catchuplast = now;
+  catchupbehind = FALSE;
+
+  if (tic_catchup <= 1 || timingdemo || fastforward > 1 || !tic_vars.fps ||
+      elapsed <= 0 || elapsed > CATCHUP_PAUSE || !D_CanRunExtraTic())
+  {
+    catchupdebt = 0;
+    catchuptic = gametic;
+    return;
+  }
+
+  catchupdebt += (fixed_t)(elapsed * TICRATE * FRACUNIT / 1000000) -
+    tic_vars.frac_step;
+  if (catchupdebt < 0)
+    catchupdebt = 0;
+
+  for (tics = 1; tics < tic_catchup && catchupdebt >= FRACUNIT &&
+         D_CanRunExtraTic(); tics++)
+  {
+    D_RunExtraTic();
+    catchupdebt -= FRACUNIT;
+    catchupran++;
+  }
+
+  if (catchupdebt >= FRACUNIT)
+  {
+    catchupbehind = TRUE;
+    catchupdropped += catchupdebt >> FRACBITS;
+    catchupdebt &= FRACUNIT - 1;
+  }
+  catchuptic = gametic;
+}
+
+dbool D_SkipFrame(void)
+{
+  if (tic_skipframes && catchupbehind && !catchupskipped &&
+      gamestate == wipegamestate)
+  {
+    catchupskipped = TRUE;
+    catchupskips++;
+    return TRUE;
+  }
+  catchupskipped = FALSE;
+  return FALSE;
+}
+
+//
+// Battery saver
+//
+// With battery_saver, a frame is only drawn when a tic has run since the
+// last one drawn or is pending to run during it, and then shows the tic
+// as it is, uninterpolated. The frames in between ask the frontend to
+// show the last one again. The display drops to the tic rate while the
+// frontend's frame rate, movement_smooth and the sound keep theirs.
+//
+
+int battery_saver;
+
+static int      batterytic = -1;  // gametic once the last frame was drawn
+static unsigned batterydrawn, batteryframes;
+
+dbool D_BatterySaverSkip(void)
+{
+  batteryframes++;
+  return battery_saver && !screen_dirty && gamestate == wipegamestate &&
+    gametic == batterytic && !D_TicPending();
+}
+
+void D_BatterySaverDrawn(void)
+{
+  batterydrawn++;
+  batterytic = gametic;
+}
+
+void D_ReportCatchUp(void)
+{
+  if (catchupran || catchupdropped || catchupskips)
+    lprintf(LO_INFO, "D_ReportCatchUp: %u tics caught up, %u dropped, "
+            "%u frames skipped, %u frames without a tic\n", catchupran,
+            catchupdropped, catchupskips, catchuprepeats);
+  if (battery_saver && batteryframes)
+    lprintf(LO_INFO, "D_ReportCatchUp: battery saver drew %u of %u frames\n",
+            batterydrawn, batteryframes);
+  catchupran = catchupdropped = catchupskips = catchuprepeats = 0;
+  batterydrawn = batteryframes = 0;
+}
+
+void D_StopTicThread(void)
+{
+#ifdef PRBOOM_THREADS
+  if (!ticthread)
+    return;
+
+  I_MutexLock(ticlock);
+  ticquit = TRUE;
+  I_CondSignal(ticstart);
+  I_MutexUnlock(ticlock);
+
+  I_ThreadJoin(ticthread);
+  ticthread = NULL;
+  ticquit = FALSE;
+#endif
+}
+
 #ifdef HAVE_NET
 static dbool     server;
 
@@ -533,8 +810,8 @@ void TryRunTics(void)
 {
   fixed_t overflow = 0;
 
-  // Increment tic fraction
-  tic_vars.frac += tic_vars.frac_step;
+  // Increment tic fraction; a timed demo runs a tic every frame
+  tic_vars.frac += timingdemo ? FRACUNIT : tic_vars.frac_step;
   if(tic_vars.frac > FRACUNIT) {
     overflow = tic_vars.frac - FRACUNIT;
     tic_vars.frac = FRACUNIT;
@@ -543,6 +820,11 @@ void TryRunTics(void)
   D_BuildNewTiccmds();
 
   if(tic_vars.frac == FRACUNIT) {
+    if (D_CanHoldTic()) {
+      ticoverflow = overflow;
+      ticpending = TRUE;
+      return;
+    }
     tic_vars.frac = overflow;
     if (!paused) {
       if (advancedemo)
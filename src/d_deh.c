@@ -1034,6 +1034,56 @@ static void deh_procBexSounds(DEHFILE *, FILE *, char *);
 static void deh_procBexMusic(DEHFILE *, FILE *, char *);
 static void deh_procBexSprites(DEHFILE *, FILE *, char *);
 
+// Case-blind hash indexes over the tables of names, so a big patch
+// doesn't scan whole tables for each of its lines. Each is made on
+// first use. A chain holds its entries in table order, so where names
+// repeat the first is still found first, as by the scans they replace.
+
+#define DEH_HASHSIZE 256
+
+typedef struct
+{
+  int head[DEH_HASHSIZE]; // first entry with each hash, -1 for none
+  int *next;              // the next entry with the same hash
+  int count;              // 0 until made, or to have it made again
+} deh_hash;
+
+// Up to len characters of s; a hash only, so folding more than the
+// letters does no harm
+static unsigned deh_HashName(const char *s, size_t len)
+{
+  unsigned h = 0;
+
+  while (len-- && *s)
+    h = h*31 + (*s++ | 0x20);
+  return h & (DEH_HASHSIZE-1);
+}
+
+static void deh_HashInit(deh_hash *hash, int count)
+{
+  int i;
+
+  for (i = 0; i < DEH_HASHSIZE; i++)
+    hash->head[i] = -1;
+  hash->next = realloc(hash->next, count * sizeof *hash->next);
+  hash->count = count;
+}
+
+// Add entries last to first, to keep the chains in table order
+static void deh_HashAdd(deh_hash *hash, int i, const char *name, size_t len)
+{
+  unsigned h = deh_HashName(name, len);
+
+  hash->next[i] = hash->head[h];
+  hash->head[h] = i;
+}
+
+// The first entry that may be the one named, with the rest in hash->next
+static int deh_HashFirst(const deh_hash *hash, const char *name, size_t len)
+{
+  return hash->head[deh_HashName(name, len)];
+}
+
 // Structure deh_block is used to hold the block names that can
 // be encountered, and the routines to use to decipher them
 
@@ -1201,13 +1251,13 @@ static const struct deh_mobjflags_s deh_mobjflags[] = {
 static const char *deh_state[] = // CPhipps - static const*
 {
   "Sprite number",    // .sprite (spritenum_t) // an enum
-  "Sprite subnumber", // .frame (long)
-  "Duration",         // .tics (long)
+  "Sprite subnumber", // .frame (int)
+  "Duration",         // .tics (int)
   "Next frame",       // .nextstate (statenum_t)
   // This is set in a separate "Pointer" block from Dehacked
   "Codep Frame",      // pointer to first use of action (actionf_t)
-  "Unknown 1",        // .misc1 (long)
-  "Unknown 2"         // .misc2 (long)
+  "Unknown 1",        // .misc1 (int)
+  "Unknown 2"         // .misc2 (int)
 };
 
 // SFXINFO_STRUCT - Dehacked block name = "Sounds"
@@ -1597,6 +1647,7 @@ static void deh_procBexCodePointers(DEHFILE *fpin, FILE* fpout, char *line)
   char mnemonic[DEH_MAXKEYLEN];  // to hold the codepointer mnemonic
   int i; // looper
   dbool   found; // know if we found this one during lookup or not
+  static deh_hash ptrhash;
 
   // Ty 05/16/98 - initialize it to something, dummy!
   strncpy(inbuffer,line,DEH_BUFFERMAX);
@@ -1629,20 +1680,27 @@ static void deh_procBexCodePointers(DEHFILE *fpin, FILE* fpout, char *line)
       strcpy(key,"A_");  // reusing the key area to prefix the mnemonic
       strcat(key,ptr_lstrip(mnemonic));
 
-      found = FALSE;
-      i= -1; // incremented to start at zero at the top of the loop
-      do  // Ty 05/16/98 - fix loop logic to look for null ending entry
+      if (!ptrhash.count)
         {
-          ++i;
-          if (!strcasecmp(key,deh_bexptrs[i].lookup))
-            {  // Ty 06/01/98  - add  to states[].action for new djgcc version
-              states[indexnum].action = deh_bexptrs[i].cptr; // assign
-              if (fpout) fprintf(fpout,
-                                 " - applied %s from codeptr[%d] to states[%d]\n",
-                                 deh_bexptrs[i].lookup,i,indexnum);
-              found = TRUE;
-            }
-        } while (!found && (deh_bexptrs[i].cptr != NULL));
+          // Ty 05/16/98 - the null ending entry is looked at too
+          for (i = 0; deh_bexptrs[i].cptr; i++)
+            ;
+          deh_HashInit(&ptrhash, i + 1);
+          for (; i >= 0; i--)
+            deh_HashAdd(&ptrhash, i, deh_bexptrs[i].lookup, SIZE_MAX);
+        }
+
+      found = FALSE;
+      for (i = deh_HashFirst(&ptrhash, key, SIZE_MAX); i >= 0; i = ptrhash.next[i])
+        if (!strcasecmp(key,deh_bexptrs[i].lookup))
+          {  // Ty 06/01/98  - add  to states[].action for new djgcc version
+            states[indexnum].action = deh_bexptrs[i].cptr; // assign
+            if (fpout) fprintf(fpout,
+                               " - applied %s from codeptr[%d] to states[%d]\n",
+                               deh_bexptrs[i].lookup,i,indexnum);
+            found = TRUE;
+            break;
+          }
 
       if (!found)
         if (fpout) fprintf(fpout,
@@ -1941,13 +1999,13 @@ static void deh_procFrame(DEHFILE *fpin, FILE* fpout, char *line)
         if (!strcasecmp(key,deh_state[1]))  // Sprite subnumber
           {
             if (fpout) fprintf(fpout," - frame = %"PRIu64"\n",(uint64_t)value);
-            states[indexnum].frame = (long)value; // long
+            states[indexnum].frame = (int)value;
           }
         else
           if (!strcasecmp(key,deh_state[2]))  // Duration
             {
               if (fpout) fprintf(fpout," - tics = %"PRIu64"\n",(uint64_t)value);
-              states[indexnum].tics = (long)value; // long
+              states[indexnum].tics = (int)value;
             }
           else
             if (!strcasecmp(key,deh_state[3]))  // Next frame
@@ -1965,13 +2023,13 @@ static void deh_procFrame(DEHFILE *fpin, FILE* fpout, char *line)
                 if (!strcasecmp(key,deh_state[5]))  // Unknown 1
                   {
                     if (fpout) fprintf(fpout," - misc1 = %"PRIu64"\n",(uint64_t)value);
-                    states[indexnum].misc1 = (long)value; // long
+                    states[indexnum].misc1 = (int)value;
                   }
                 else
                   if (!strcasecmp(key,deh_state[6]))  // Unknown 2
                     {
                       if (fpout) fprintf(fpout," - misc2 = %"PRIu64"\n",(uint64_t)value);
-                      states[indexnum].misc2 = (long)value; // long
+                      states[indexnum].misc2 = (int)value;
                     }
                   else
                     if (fpout) fprintf(fpout,"Invalid frame string index for '%s'\n",key);
@@ -2525,6 +2583,10 @@ static void deh_procMisc(DEHFILE *fpin, FILE* fpout, char *line) // done
 //          line  -- current line in file to process
 // Returns: void
 //
+// The sprite, sound and music names as they are now, for Text blocks.
+// BEX renames them without going through those, and has them made again.
+static deh_hash textsprites, textsounds, textmusic;
+
 static void deh_procText(DEHFILE *fpin, FILE* fpout, char *line)
 {
   char key[DEH_MAXKEYLEN];
@@ -2578,9 +2640,16 @@ static void deh_procText(DEHFILE *fpin, FILE* fpout, char *line)
   // Future: this will be from a separate [SPRITES] block.
   if (fromlen==4 && tolen==4)
     {
-      i=0;
-      while (sprnames[i])  // null terminated list in info.c //jff 3/19/98
-        {                                                      //check pointer
+      if (!textsprites.count)
+        {
+          for (i = 0; sprnames[i]; i++)  // null terminated list in info.c //jff 3/19/98
+            ;
+          deh_HashInit(&textsprites, i);
+          while (i--)
+            deh_HashAdd(&textsprites, i, sprnames[i], SIZE_MAX);
+        }
+      for (i = deh_HashFirst(&textsprites, inbuffer, fromlen); i >= 0; i = textsprites.next[i])
+        {
           if (!strncasecmp(sprnames[i],inbuffer,fromlen) && !sprnames_state[i])         //not first char
             {
               if (fpout) fprintf(fpout,
@@ -2603,7 +2672,6 @@ static void deh_procText(DEHFILE *fpin, FILE* fpout, char *line)
               found = TRUE;
               break;  // only one will match--quit early
             }
-          ++i;  // next array element
         }
     }
   else
@@ -2615,7 +2683,13 @@ static void deh_procText(DEHFILE *fpin, FILE* fpout, char *line)
                              "Warning: Mismatched lengths from=%d, to=%d, used %d\n",
                              fromlen, tolen, usedlen);
         // Try sound effects entries - see sounds.c
-        for (i=1; i<NUMSFX; i++)
+        if (!textsounds.count)
+          {
+            deh_HashInit(&textsounds, NUMSFX);
+            for (i=NUMSFX-1; i>0; i--)
+              deh_HashAdd(&textsounds, i, S_sfx[i].name, SIZE_MAX);
+          }
+        for (i = deh_HashFirst(&textsounds, inbuffer, fromlen); i >= 0; i = textsounds.next[i])
           {
             // avoid short prefix erroneous match
             if (strlen(S_sfx[i].name) != (size_t)fromlen) continue;
@@ -2637,7 +2711,13 @@ static void deh_procText(DEHFILE *fpin, FILE* fpout, char *line)
         if (!found)  // not yet
           {
             // Try music name entries - see sounds.c
-            for (i=1; i<NUMMUSIC; i++)
+            if (!textmusic.count)
+              {
+                deh_HashInit(&textmusic, NUMMUSIC);
+                for (i=NUMMUSIC-1; i>0; i--)
+                  deh_HashAdd(&textmusic, i, S_music[i].name, SIZE_MAX);
+              }
+            for (i = deh_HashFirst(&textmusic, inbuffer, fromlen); i >= 0; i = textmusic.next[i])
               {
                 // avoid short prefix erroneous match
                 if (strlen(S_music[i].name) != (size_t)fromlen) continue;
@@ -2776,13 +2856,24 @@ dbool   deh_procStringSub(char *key, char *lookfor, char *newstring, FILE *fpout
 {
   dbool   found; // loop exit flag
   int i;  // looper
+  static deh_hash keyhash, orighash;
+  const deh_hash *hash = lookfor ? &orighash : &keyhash;
 
-  found = FALSE;
-  for (i=0;i<deh_numstrlookup;i++)
+  if (!keyhash.count)
     {
-      if (deh_strlookup[i].orig == NULL)
-        deh_strlookup[i].orig = *deh_strlookup[i].ppstr;
+      deh_HashInit(&keyhash, deh_numstrlookup);
+      deh_HashInit(&orighash, deh_numstrlookup);
+      for (i=deh_numstrlookup-1;i>=0;i--)
+        {
+          deh_strlookup[i].orig = *deh_strlookup[i].ppstr;
+          deh_HashAdd(&keyhash, i, deh_strlookup[i].lookup, SIZE_MAX);
+          deh_HashAdd(&orighash, i, deh_strlookup[i].orig, SIZE_MAX);
+        }
+    }
 
+  found = FALSE;
+  for (i = deh_HashFirst(hash, lookfor ? lookfor : key, SIZE_MAX); i >= 0; i = hash->next[i])
+    {
       found = lookfor ?
         !strcasecmp(deh_strlookup[i].orig,lookfor) :
         !strcasecmp(deh_strlookup[i].lookup,key);
@@ -2885,6 +2976,7 @@ static void deh_procBexSprites(DEHFILE *fpin, FILE *fpout, char *line)
    char *strval;  // holds the string value of the line
    char candidate[5];
    int  rover;
+   static deh_hash spritehash;
 
    if(fpout)
       fprintf(fpout,"Processing sprite name substitution\n");
@@ -2917,8 +3009,14 @@ static void deh_procBexSprites(DEHFILE *fpin, FILE *fpout, char *line)
 	 continue;
       }
 
-      rover = 0;
-      while(deh_spritenames[rover])
+      if(!spritehash.count)
+      {
+	 deh_HashInit(&spritehash, NUMSPRITES);
+	 for(rover = NUMSPRITES - 1; rover >= 0; rover--)
+	    deh_HashAdd(&spritehash, rover, deh_spritenames[rover], SIZE_MAX);
+      }
+
+      for(rover = deh_HashFirst(&spritehash, key, 4); rover >= 0; rover = spritehash.next[rover])
       {
 	 if(!strncasecmp(deh_spritenames[rover], key, 4))
 	 {
@@ -2927,9 +3025,9 @@ static void deh_procBexSprites(DEHFILE *fpin, FILE *fpout, char *line)
 	               candidate, deh_spritenames[rover]);
 
 	    sprnames[rover] = strdup(candidate);
+	    textsprites.count = 0;
 	    break;
 	 }
-	 rover++;
       }
    }
 }
@@ -2943,6 +3041,7 @@ static void deh_procBexSounds(DEHFILE *fpin, FILE *fpout, char *line)
    char *strval;  // holds the string value of the line
    char candidate[7];
    int  rover, len;
+   static deh_hash namehash;
 
    if(fpout)
       fprintf(fpout,"Processing sound name substitution\n");
@@ -2976,8 +3075,14 @@ static void deh_procBexSounds(DEHFILE *fpin, FILE *fpout, char *line)
 	 continue;
       }
 
-      rover = 1;
-      while(deh_soundnames[rover])
+      if(!namehash.count)
+      {
+	 deh_HashInit(&namehash, NUMSFX);
+	 for(rover = NUMSFX - 1; rover > 0; rover--)
+	    deh_HashAdd(&namehash, rover, deh_soundnames[rover], SIZE_MAX);
+      }
+
+      for(rover = deh_HashFirst(&namehash, key, 6); rover >= 0; rover = namehash.next[rover])
       {
 	 if(!strncasecmp(deh_soundnames[rover], key, 6))
 	 {
@@ -2986,9 +3091,9 @@ static void deh_procBexSounds(DEHFILE *fpin, FILE *fpout, char *line)
 	               candidate, deh_soundnames[rover]);
 
 	    S_sfx[rover].name = strdup(candidate);
+	    textsounds.count = 0;
 	    break;
 	 }
-	 rover++;
       }
    }
 }
@@ -3002,6 +3107,7 @@ static void deh_procBexMusic(DEHFILE *fpin, FILE *fpout, char *line)
    char *strval;  // holds the string value of the line
    char candidate[7];
    int  rover, len;
+   static deh_hash namehash;
 
    if(fpout)
       fprintf(fpout,"Processing music name substitution\n");
@@ -3035,8 +3141,14 @@ static void deh_procBexMusic(DEHFILE *fpin, FILE *fpout, char *line)
 	 continue;
       }
 
-      rover = 1;
-      while(deh_musicnames[rover])
+      if(!namehash.count)
+      {
+	 deh_HashInit(&namehash, NUMMUSIC);
+	 for(rover = NUMMUSIC - 1; rover > 0; rover--)
+	    deh_HashAdd(&namehash, rover, deh_musicnames[rover], SIZE_MAX);
+      }
+
+      for(rover = deh_HashFirst(&namehash, key, 6); rover >= 0; rover = namehash.next[rover])
       {
 	 if(!strncasecmp(deh_musicnames[rover], key, 6))
 	 {
@@ -3045,9 +3157,9 @@ static void deh_procBexMusic(DEHFILE *fpin, FILE *fpout, char *line)
 	               candidate, deh_musicnames[rover]);
 
 	    S_music[rover].name = strdup(candidate);
+	    textmusic.count = 0;
 	    break;
 	 }
-	 rover++;
       }
    }
 }
@@ -61,6 +61,7 @@
 #include "sounds.h"
 #include "z_zone.h"
 #include "w_wad.h"
+#include "w_ident.h"
 #include "s_sound.h"
 #include "v_video.h"
 #include "f_finale.h"
@@ -81,11 +82,18 @@
 #include "r_draw.h"
 #include "r_main.h"
 #include "r_fps.h"
+#include "r_patchcache.h"
+#include "r_mipmap.h"
+#include "r_rounded.h"
+#include "r_segs.h"
+#include "r_arena.h"
+#include "d_bench.h"
 #include "d_main.h"
 #include "d_deh.h"  // Ty 04/08/98 - Externalizations
 #include "lprintf.h"  // jff 08/03/98 - declaration of lprintf
 #include "am_map.h"
 #include "u_mapinfo.h"
+#include "m_bbox.h"
 
 void GetFirstMap(int *ep, int *map); // Ty 08/29/98 - add "-warp x" functionality
 static void D_PageDrawer(void);
@@ -120,6 +128,8 @@ int     startepisode;
 int     startmap;
 dbool autostart;
 int ffmap;
+int fastforward = 1;
+dbool fastforwarding;
 
 dbool advancedemo;
 dbool singledemo;
@@ -159,6 +169,7 @@ void D_PostEvent(event_t *ev)
   /* cph - suppress all input events at game start
    * FIXME: This is a lousy kludge */
   if (gametic < 3) return;
+  screen_dirty = TRUE; // whoever takes it may well change what's on screen
   (void)(
     M_Responder(ev) ||
       (gamestate == GS_LEVEL && (
@@ -182,6 +193,7 @@ static dbool in_d_wipe;
 static void D_Wipe(void)
 {
    in_d_wipe = !wipe_ScreenWipe(1);
+   screen_dirty = TRUE;
    M_Drawer();                   // menu is drawn even on top of wipes
    I_FinishUpdate();             // page flip or blit buffer
 }
@@ -202,6 +214,9 @@ void D_Display (void)
   static dbool isborderstate        = FALSE;
   static dbool borderwillneedredraw = FALSE;
   static gamestate_t oldgamestate = -1;
+  static dbool oldfrozen = FALSE;
+  static int oldgametic = -1;
+  dbool frozen, ticked;
 
   // Reentrancy.
   if (in_d_wipe)
@@ -210,6 +225,8 @@ void D_Display (void)
      return;
   }
 
+  W_NameCacheFrame();
+
   if (!I_StartDisplay())
     return;
 
@@ -217,6 +234,15 @@ void D_Display (void)
   if ((wipe = gamestate != wipegamestate))
     wipe_StartScreen();
 
+  // The view stands still, uninterpolated, while the game is paused or
+  // held by the menu, and everything else on screen moves on tics
+  frozen = paused || (menuactive && !demoplayback && !netgame);
+  ticked = gametic != oldgametic;
+  if (gamestate != oldgamestate || frozen != oldfrozen)
+    screen_dirty = TRUE;
+  oldfrozen = frozen;
+  oldgametic = gametic;
+
   if (gamestate != GS_LEVEL) { // Not a level
     switch (oldgamestate) {
     case GS_UNDEFINED:
@@ -251,7 +277,7 @@ void D_Display (void)
 
     // Work out if the player view is visible, and if there is a border
     viewactive = (!(automapmode & am_active) || (automapmode & am_overlay)) && !inhelpscreens;
-    isborder = viewactive ? (viewheight != SCREENHEIGHT) : (!inhelpscreens && (automapmode & am_active));
+    isborder = viewactive ? (scaledviewheight != SCREENHEIGHT) : (!inhelpscreens && (automapmode & am_active));
 
     if (oldgamestate != GS_LEVEL) {
       redrawborderstuff = isborder;
@@ -267,13 +293,25 @@ void D_Display (void)
         : (!inhelpscreens && menuactive == mnact_full);
     }
 
+    // Held still, only the status bar, messages and the automap (which
+    // can be panned) change
+    if (!frozen || (ticked && (automapmode & am_active)))
+      screen_dirty = TRUE;
+
     // Now do the drawing
     if (viewactive)
+    {
+      int64_t start = D_StageStart();
+      if (late_input)
+        I_LateInput();
       R_RenderPlayerView (&players[displayplayer]);
+      D_StageStop(BENCH_RENDER, start);
+    }
+    D_FinishPendingTic();
     if (automapmode & am_active)
       AM_Drawer();
     ST_Drawer(
-        ((viewheight != SCREENHEIGHT)
+        ((scaledviewheight != SCREENHEIGHT)
          || ((automapmode & am_active) && !(automapmode & am_overlay))),
         redrawborderstuff,
         (menuactive == mnact_full));
@@ -350,6 +388,14 @@ void D_PageTicker(void)
 //
 static void D_PageDrawer(void)
 {
+  static const char *oldpagename;
+
+  if (pagename != oldpagename)
+  {
+    oldpagename = pagename;
+    screen_dirty = TRUE;
+  }
+
   // proff/nicolas 09/14/98 -- now stretchs bitmaps to fullscreen!
   // CPhipps - updated for new patch drawing
   // proff - added M_DrawCredits
@@ -520,6 +566,7 @@ void D_AddFile (const char *file, wad_source_t source)
   char *gwa_filename      = NULL;
 
   wadfiles = realloc(wadfiles, sizeof(*wadfiles)*(numwadfiles+1));
+  memset(&wadfiles[numwadfiles], 0, sizeof(*wadfiles));
   wadfiles[numwadfiles].name =
     AddDefaultExtension(strcpy(malloc(file_len + 5), file), ".wad");
   wadfiles[numwadfiles].src = source; // Ty 08/29/98
@@ -535,12 +582,36 @@ void D_AddFile (const char *file, wad_source_t source)
       char *ext = &gwa_filename[gwa_filename_len - 4];
       ext[1]    = 'g'; ext[2] = 'w'; ext[3] = 'a';
       wadfiles  = realloc(wadfiles, sizeof(*wadfiles)*(numwadfiles+1));
+      memset(&wadfiles[numwadfiles], 0, sizeof(*wadfiles));
       wadfiles[numwadfiles].name = gwa_filename;
       wadfiles[numwadfiles].src = source; // Ty 08/29/98
       numwadfiles++;
     }
 }
 
+#ifndef MEMORY_LOW
+#include "prboom_wad.h"
+
+//
+// D_AddBuiltinFile
+//
+// Adds a wad image linked into the binary. W_AddFile reads its directory
+// straight from the image and lumps are handed out from it in place, so
+// there is no file to find and nothing is copied.
+static void D_AddBuiltinFile(const char *name, const unsigned char *data,
+                             int length, wad_source_t source)
+{
+  wadfiles = realloc(wadfiles, sizeof(*wadfiles)*(numwadfiles+1));
+  memset(&wadfiles[numwadfiles], 0, sizeof(*wadfiles));
+  wadfiles[numwadfiles].name = strdup(name);
+  wadfiles[numwadfiles].src = source;
+  wadfiles[numwadfiles].data = (unsigned char *)data;
+  wadfiles[numwadfiles].length = length;
+  wadfiles[numwadfiles].builtin = TRUE;
+  numwadfiles++;
+}
+#endif
+
 // killough 10/98: support -dehout filename
 // cph - made const, don't cache results
 static const char *D_dehout(void)
@@ -567,6 +638,14 @@ static const char *D_dehout(void)
 static bool CheckIWAD(const char *iwadname,GameMode_t *gmode,dbool *hassec)
 {
   RFILE *fp     = NULL;
+  int cachedmode;
+
+  // unchanged since it was last looked at
+  if (W_CachedIWADMode(iwadname, &cachedmode, hassec))
+  {
+    *gmode = cachedmode;
+    return true;
+  }
 
   if ((fp = filestream_open(iwadname, 
 		  RETRO_VFS_FILE_ACCESS_READ,
@@ -647,6 +726,7 @@ static bool CheckIWAD(const char *iwadname,GameMode_t *gmode,dbool *hassec)
       *gmode = registered;
     else if (sw>=9)
       *gmode = shareware;
+    W_StoreIWADMode(iwadname, *gmode, *hassec);
   }
   else // error from access call
   {
@@ -930,7 +1010,9 @@ static void DoLooseFiles(void)
 
     // so now we must have a loose file.  Find out what kind and store it.
     j = strlen(myargv[i]);
-    if (!strcasecmp(&myargv[i][j-4],".wad"))
+    if (!strcasecmp(&myargv[i][j-4],".wad") ||
+        !strcasecmp(&myargv[i][j-4],".pk3") ||
+        !strcasecmp(&myargv[i][j-4],".zip"))
       wads[wadcount++] = strdup(myargv[i]);
     if (!strcasecmp(&myargv[i][j-4],".lmp"))
       lmps[lmpcount++] = strdup(myargv[i]);
@@ -1028,9 +1110,11 @@ const char *wad_files[MAXLOADFILES], *deh_files[MAXLOADFILES];
 
 bool D_DoomMainSetup(void)
 {
-  int p;
+  int p, phase, setupphase;
+  dbool identified;
 
   setbuf(stdout,NULL);
+  setupphase = D_StartupBegin("D_DoomMainSetup");
 
   // proff 04/05/2000: Added support for include response files
   /* proff 2001/7/1 - Moved up, so -config can be in response files */
@@ -1049,7 +1133,9 @@ bool D_DoomMainSetup(void)
   }
 
   lprintf(LO_INFO,"M_LoadDefaults: Load system defaults.\n");
+  phase = D_StartupBegin("M_LoadDefaults");
   M_LoadDefaults();              // load before initing other systems
+  D_StartupEnd(phase);
 
   // figgi 09/18/00-- added switch to force classic bsp nodes
   if (M_CheckParm ("-forceoldbsp"))
@@ -1060,18 +1146,27 @@ bool D_DoomMainSetup(void)
 
   D_BuildBEXTables(); // haleyjd
 
+  phase = D_StartupBegin("IdentifyVersion");
   DoLooseFiles();  // Ty 08/29/98 - handle "loose" files on command line
-  if (!IdentifyVersion())
+  identified = IdentifyVersion();
+  D_StartupEnd(phase);
+  if (!identified)
      goto failed;
 
-  // Load prboom.wad after IWAD but before everything else
+  // Load prboom.wad after IWAD but before everything else. A prboom.wad
+  // found on disk overrides the copy linked into the binary, which is
+  // used in place when there is none.
   {
     char *data_wad_path = I_FindFile(PACKAGE ".wad", NULL);
 
-    if (!data_wad_path)
-      lprintf(LO_INFO, PACKAGE ".wad not found - internal default data will be used\n");
-    else
+    if (data_wad_path)
       D_AddFile(data_wad_path, source_pre);
+    else
+#ifndef MEMORY_LOW
+      D_AddBuiltinFile(PACKAGE ".wad", prboom_wad, sizeof(prboom_wad), source_pre);
+#else
+      lprintf(LO_INFO, PACKAGE ".wad not found - internal default data will be used\n");
+#endif
     free(data_wad_path);
   }
 
@@ -1246,6 +1341,8 @@ bool D_DoomMainSetup(void)
   }
 
   p = M_CheckParm("-playdemo");
+  if (!p)
+    p = M_CheckParm("-timedemo");
   if (p && p < myargc-1)
   {
     char file[PATH_MAX+1];      // cph - localised
@@ -1259,6 +1356,11 @@ bool D_DoomMainSetup(void)
     }
   }
 
+  if (M_CheckParm("-fixedcheck"))
+    D_CheckFixedMath();
+
+  synclog = M_CheckParm("-synclog") != 0;
+
   // 1/18/98 killough: Z_Init() call moved to i_main.c
 
   // CPhipps - move up netgame init
@@ -1268,10 +1370,14 @@ bool D_DoomMainSetup(void)
 
   //jff 9/3/98 use logical output routine
   lprintf(LO_INFO,"W_Init: Init WADfiles.\n");
+  phase = D_StartupBegin("W_Init");
   W_Init(); // CPhipps - handling of wadfiles init changed
+  D_StartupEnd(phase);
 
   lprintf(LO_INFO,"\n");     // killough 3/6/98: add a newline, by popular demand :)
 
+  phase = D_StartupBegin("DEHACKED");
+
   // e6y
   // option to disable automatic loading of dehacked-in-wad lump
   if (!M_CheckParm ("-nodeh"))
@@ -1352,6 +1458,7 @@ bool D_DoomMainSetup(void)
       ProcessDehFile(file,D_dehout(),0);
     }
   }
+  D_StartupEnd(phase);
 
   V_InitColorTranslation(); //jff 4/24/98 load color translation lumps
 
@@ -1369,9 +1476,12 @@ bool D_DoomMainSetup(void)
 
   //jff 9/3/98 use logical output routine
   lprintf(LO_INFO,"M_Init: Init miscellaneous info.\n");
+  phase = D_StartupBegin("M_Init");
   M_Init();
+  D_StartupEnd(phase);
 
   // if not explicitly disabled, load UMAPINFO
+  phase = D_StartupBegin("UMAPINFO");
   if (!M_CheckParm("-nomapinfo"))
   {
     for (p = -1; (p = W_ListNumFromName("UMAPINFO", p)) >= 0; )
@@ -1382,6 +1492,7 @@ bool D_DoomMainSetup(void)
       U_ParseMapInfo(data, W_LumpLength(p));
     }
   }
+  D_StartupEnd(phase);
 
 
 #ifdef HAVE_NET
@@ -1391,35 +1502,68 @@ bool D_DoomMainSetup(void)
 
   //jff 9/3/98 use logical output routine
   lprintf(LO_INFO,"R_Init: Init DOOM refresh daemon - ");
+  phase = D_StartupBegin("R_Init");
   R_Init();
+  D_StartupEnd(phase);
 
   //jff 9/3/98 use logical output routine
   lprintf(LO_INFO,"\nP_Init: Init Playloop state.\n");
+  phase = D_StartupBegin("P_Init");
   P_Init();
+  D_StartupEnd(phase);
 
   //jff 9/3/98 use logical output routine
   lprintf(LO_INFO,"I_Init: Setting up machine state.\n");
+  phase = D_StartupBegin("I_Init");
   I_Init();
+  D_StartupEnd(phase);
 
   //jff 9/3/98 use logical output routine
   lprintf(LO_INFO,"S_Init: Setting up sound.\n");
+  phase = D_StartupBegin("S_Init");
   S_Init(snd_SfxVolume /* *8 */, snd_MusicVolume /* *8*/ );
+  D_StartupEnd(phase);
 
   //jff 9/3/98 use logical output routine
   lprintf(LO_INFO,"HU_Init: Setting up heads up display.\n");
+  phase = D_StartupBegin("HU_Init");
   HU_Init();
+  D_StartupEnd(phase);
 
   if (!(M_CheckParm("-nodraw") && M_CheckParm("-nosound")))
+  {
+    phase = D_StartupBegin("I_InitGraphics");
     I_InitGraphics();
+    D_StartupEnd(phase);
+  }
 
   //jff 9/3/98 use logical output routine
   lprintf(LO_INFO,"ST_Init: Init status bar.\n");
+  phase = D_StartupBegin("ST_Init");
   ST_Init();
+  D_StartupEnd(phase);
+
+  if (M_CheckParm("-drawbench"))
+    D_BenchDrawers();
+
+  if ((p = M_CheckParm("-memsweep")))
+    D_MemorySweep(p < myargc-1 && atoi(myargv[p+1]) > 0 ? atoi(myargv[p+1]) : 10*TICRATE);
+
+  if ((p = M_CheckParm("-autotune")) && (autotune_render_threads < 0 ||
+      p >= myargc-1 || strcasecmp(myargv[p+1], "once")))
+    D_AutoTune();
 
   idmusnum = -1; //jff 3/17/98 insure idmus number is blank
 
 
-  if ((p = M_CheckParm("-playdemo")) && ++p < myargc)
+  if ((p = M_CheckParm("-timedemo")) && ++p < myargc)
+  {
+    singledemo = TRUE;
+    timingdemo = TRUE;
+    nodrawers = M_CheckParm("-nodraw") != 0;
+    G_DeferedPlayDemo(myargv[p]);
+  }
+  else if ((p = M_CheckParm("-playdemo")) && ++p < myargc)
   {
 	singledemo = TRUE;
 	G_DeferedPlayDemo(myargv[p]);
@@ -1442,9 +1586,12 @@ bool D_DoomMainSetup(void)
     else
       D_StartTitle(); // start up intro loop
   }
+  D_StartupEnd(setupphase);
+  D_ReportStartup();
   return true;
 
 failed:
+  D_StartupEnd(setupphase);
   return false;
 }
 
@@ -1455,25 +1602,78 @@ failed:
 extern void D_QuitNetGame (void);
 #endif
 
+// Tics past the precache after which a level should not allocate
+#define STEADY_TICS (2*TICRATE)
+
 void D_DoomLoop(void)
 {
+   dbool drawn = FALSE;
+
    //Doom loop
    WasRenderedInTryRunTics = FALSE;
 
    if (ffmap == gamemap) ffmap = 0;
 
+   G_DoSeekDemo();
+
+   // Fast-forward: run the extra tics ahead of the frame's own, without
+   // drawing them or starting their sounds. They're the same tics, only
+   // sooner, so demos and saved games come out as they would have.
+   if (fastforward > 1)
+   {
+      int i;
+
+      fastforwarding = TRUE;
+      for (i = 1; i < fastforward && D_CanRunExtraTic(); i++)
+         D_RunExtraTic();
+      fastforwarding = FALSE;
+   }
+
+   D_CatchUpTics(); // a late frame runs the tics it owes
+
    TryRunTics (); // will run at least one tic
 
+   R_PrecacheStep(); // spread the level's graphics loading over its first tics
+   if (gamestate == GS_INTERMISSION)
+      W_PrefetchStep(precache_budget); // and read ahead for the next one
+
    // killough 3/16/98: change consoleplayer to displayplayer
    if (players[displayplayer].mo) // cph 2002/08/10
       S_UpdateSounds(players[displayplayer].mo);// move positional sounds
 
-   if (!movement_smooth || !WasRenderedInTryRunTics || gamestate != wipegamestate)
+   if (nodrawers || D_SkipFrame() || D_BatterySaverSkip())
+   {
+      // the frontend still wants a frame: the last one again
+      screen_dirty = FALSE;
+      M_ClearBox(dirtybox);
+      I_FinishUpdate();
+   }
+   else if (!movement_smooth || !WasRenderedInTryRunTics || gamestate != wipegamestate)
    {
+      // a battery saver frame shows the last tic where it left things;
+      // a tic pending to run meanwhile has its fraction whole already
+      const dbool whole = battery_saver && !D_TicPending();
+      const fixed_t frac = tic_vars.frac;
+
+      if (whole)
+         tic_vars.frac = FRACUNIT;
       // Update display, next frame, with current state.
       D_Display();
-      return;
+      if (whole)
+         tic_vars.frac = frac;
+      benchframes++;
+      drawn = TRUE;
    }
+
+   // in case D_Display returned early
+   D_FinishPendingTic();
+   if (drawn)
+      D_BatterySaverDrawn();
+   G_FinishSaveGame(FALSE);
+
+   // the level's graphics are in and its pools have grown to size by now
+   Z_EndFrame(gamestate == GS_LEVEL && !menuactive && gamestate == wipegamestate &&
+         leveltime > precache_tics + STEADY_TICS);
 }
 
 //foward decl
@@ -1488,7 +1688,20 @@ void D_DoomDeinit(void)
   D_QuitNetGame();
   I_ShutdownNetwork();
 #endif
+  D_StopTicThread();
+  G_FinishSaveGame(TRUE);
+  D_ReportCatchUp();
+  D_ReportFrameStats();
+  R_ReportVertexCache();
+  R_ReportRenderArena();
+  Z_ReportCacheStats();
+  W_ReportNameCache();
+  Z_ReportZoneStats();
   M_SaveDefaults ();
+  R_ClosePatchCache();
+  R_FreeMips();
+  R_FreeRounded();
+  V_FlushScaledPatches();
   W_Exit();
   //W_ReleaseAllWads();
   U_FreeMapInfo();
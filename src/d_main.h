@@ -50,6 +50,10 @@ extern dbool clfastparm; // checkparm of -fast
 extern dbool nosfxparm;
 extern dbool nomusicparm;
 extern int ffmap;
+// Tics run a frame while fast-forwarding, 1 for none, and set while the
+// ones that aren't drawn run
+extern int fastforward;
+extern dbool fastforwarding;
 
 // Called by IO functions when input is detected.
 void D_PostEvent(event_t* ev);
@@ -191,6 +191,40 @@ void D_BuildNewTiccmds(void);
 //? how many ticks to run?
 void TryRunTics (void);
 
+// Config: run the tic due on a frame while its view is filled
+extern int render_pipelined;
+// A tic is held back and the game state is still the one before it
+dbool D_TicPending(void);
+// Run the held back tic on the game thread; nothing may read the game
+// state until D_FinishPendingTic
+void D_StartPendingTic(void);
+// Wait for the held back tic, or run it here if it wasn't started
+void D_FinishPendingTic(void);
+void D_StopTicThread(void);
+
+// angleturn of the ticcmd built for the tic to run next, 0 if none is
+int D_PendingTurn(void);
+
+// Whether a tic can be run straight away, ahead of the frame's own, and
+// run it; for fast-forward, see D_DoomLoop
+dbool D_CanRunExtraTic(void);
+void D_RunExtraTic(void);
+
+// Config: most tics a frame runs to make up for frames coming late, 1 for
+// none, and whether a frame still behind after that is left undrawn
+extern int tic_catchup, tic_skipframes;
+// Run the extra tics the time since the last frame calls for; before
+// TryRunTics, see D_DoomLoop
+void D_CatchUpTics(void);
+// Whether to leave this frame undrawn, as the game is behind
+dbool D_SkipFrame(void);
+// Draw only frames that show a new tic, uninterpolated (see d_client.c):
+// whether to leave this frame undrawn, and call once one has been drawn
+extern int battery_saver;
+dbool D_BatterySaverSkip(void);
+void D_BatterySaverDrawn(void);
+void D_ReportCatchUp(void);
+
 // CPhipps - move to header file
 void D_InitNetGame (void); // This does the setup
 void D_CheckNetGame(void); // This waits for game start
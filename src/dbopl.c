@@ -656,6 +656,94 @@ static inline Bits Operator__GetSample(Operator *self, Bits modulation ) {
   }
 }
 
+/*
+  Block generation for the 2 operator modes. The envelope of each
+  operator only depends on itself, so both are stepped over a block up
+  front, without the per sample call through volHandler; the waves are
+  then made in one loop with everything the operators need held in
+  locals. Sample for sample the same as GetSample.
+*/
+
+#if( DBOPL_WAVE == WAVE_TABLEMUL )
+
+#define OPL_BLOCK 64
+
+static inline void Operator__BlockVolume(Operator *self, Bitu samples, Bit32u *vol) {
+  Bit32u level = self->currentLevel;
+  Bitu i = 0;
+  //The same steps as TemplateVolume, with the state kept in locals while
+  //it holds; attacks are short and left to it
+  while ( i < samples ) {
+    Bit32s v = self->volume;
+    Bit32u index = self->rateIndex;
+    Bit32u add;
+    switch ( self->state ) {
+    case OFF:
+      for ( ; i < samples; i++ )
+        vol[i] = level + ENV_MAX;
+      return;
+    case DECAY:
+      add = self->decayAdd;
+      for ( ; i < samples; i++ ) {
+        index += add;
+        v += index >> RATE_SH;
+        index &= RATE_MASK;
+        if ( GCC_UNLIKELY(v >= self->sustainLevel) )
+          break;
+        vol[i] = level + v;
+      }
+      if ( i < samples ) {
+        if ( v >= ENV_MAX ) {
+          self->volume = ENV_MAX;
+          self->rateIndex = index;
+          Operator__SetState( self, OFF );
+          vol[i++] = level + ENV_MAX;
+        } else {
+          self->volume = v;
+          self->rateIndex = 0;
+          Operator__SetState( self, SUSTAIN );
+          vol[i++] = level + v;
+        }
+        continue;
+      }
+      break;
+    case SUSTAIN:
+      if ( self->reg20 & MASK_SUSTAIN ) {
+        for ( ; i < samples; i++ )
+          vol[i] = level + v;
+        return;
+      }
+      // fall through
+    case RELEASE:
+      add = self->releaseAdd;
+      for ( ; i < samples; i++ ) {
+        index += add;
+        v += index >> RATE_SH;
+        index &= RATE_MASK;
+        if ( GCC_UNLIKELY(v >= ENV_MAX) )
+          break;
+        vol[i] = level + v;
+      }
+      if ( i < samples ) {
+        self->volume = ENV_MAX;
+        self->rateIndex = index;
+        Operator__SetState( self, OFF );
+        vol[i++] = level + ENV_MAX;
+        continue;
+      }
+      break;
+    default:
+      vol[i++] = Operator__ForwardVolume(self);
+      continue;
+    }
+    self->volume = v;
+    self->rateIndex = index;
+    return;
+  }
+}
+
+#endif
+
 static void Operator__Operator(Operator *self) {
   self->chanData = 0;
   self->freqMul = 0;
@@ -909,6 +997,60 @@ static inline void Channel__GeneratePercussion(Channel *self, Chip* chip,
   }
 }
 
+#if( DBOPL_WAVE == WAVE_TABLEMUL )
+//The 2 operator modes a block at a time, see Operator__BlockVolume
+static inline void Channel__Block2Op(Channel *self, Bitu samples, Bit32s* output,
+                              SynthMode mode ) {
+  Operator *mod = Channel__Op(self, 0);
+  Operator *car = Channel__Op(self, 1);
+  Bit32u modVol[OPL_BLOCK], carVol[OPL_BLOCK];
+  Bit32u mIndex = mod->waveIndex, mAdd = mod->waveCurrent;
+  Bit32u cIndex = car->waveIndex, cAdd = car->waveCurrent;
+  const Bit16s *mBase = mod->waveBase, *cBase = car->waveBase;
+  Bit32u mMask = mod->waveMask, cMask = car->waveMask;
+  Bit8u feedback = self->feedback;
+  Bit32s old0 = self->old[0], old1 = self->old[1];
+  Bit32s maskLeft = self->maskLeft, maskRight = self->maskRight;
+  Bitu i, done, todo;
+  int am = ( mode == sm2AM || mode == sm3AM );
+  int stereo = ( mode == sm3AM || mode == sm3FM );
+
+  for ( done = 0; done < samples; done += todo ) {
+    todo = samples - done;
+    if ( todo > OPL_BLOCK )
+      todo = OPL_BLOCK;
+
+    Operator__BlockVolume( mod, todo, modVol );
+    Operator__BlockVolume( car, todo, carVol );
+
+    for ( i = 0; i < todo; i++ ) {
+      Bit32s fb = (Bit32u)( old0 + old1 ) >> feedback;
+      Bit32u mv = modVol[i], cv = carVol[i];
+      Bit32s sample;
+      old0 = old1;
+      mIndex += mAdd;
+      old1 = ENV_SILENT( mv ) ? 0 :
+        ( mBase[ ( ( mIndex >> WAVE_SH ) + fb ) & mMask ] * MulTable[ mv >> ENV_EXTRA ] ) >> MUL_SH;
+      cIndex += cAdd;
+      sample = ENV_SILENT( cv ) ? 0 :
+        ( cBase[ ( ( cIndex >> WAVE_SH ) + ( am ? 0 : old0 ) ) & cMask ] * MulTable[ cv >> ENV_EXTRA ] ) >> MUL_SH;
+      if ( am )
+        sample += old0;
+      if ( !stereo )
+        output[ done + i ] += sample;
+      else {
+        output[ ( done + i ) * 2 + 0 ] += sample & maskLeft;
+        output[ ( done + i ) * 2 + 1 ] += sample & maskRight;
+      }
+    }
+  }
+  self->old[0] = old0;
+  self->old[1] = old1;
+  mod->waveIndex = mIndex;
+  car->waveIndex = cIndex;
+}
+#endif
+
 Channel* Channel__BlockTemplate(Channel *self, Chip* chip,
                                 Bit32u samples, Bit32s* output,
                                 SynthMode mode ) {
@@ -973,6 +1115,12 @@ Channel* Channel__BlockTemplate(Channel *self, Chip* chip,
                 Operator__Prepare( Channel__Op( self, 4 ), chip );
                 Operator__Prepare( Channel__Op( self, 5 ), chip );
   }
+#if( DBOPL_WAVE == WAVE_TABLEMUL )
+  if ( mode == sm2AM || mode == sm2FM || mode == sm3AM || mode == sm3FM ) {
+    Channel__Block2Op( self, samples, output, mode );
+    return( self + 1 );
+  }
+#endif
   for ( i = 0; i < samples; i++ ) {
     Bit32s mod, sample, out0;
     Bits next;
@@ -44,6 +44,14 @@
 
 #include <stdint.h>
 
+// A pixel of the screens and of the true colour palettes and colormaps.
+// The *16 drawers and tables are named for RGB565 but draw pixel_t.
+#ifdef PRBOOM_32BPP
+typedef uint32_t pixel_t;
+#else
+typedef uint16_t pixel_t;
+#endif
+
 #ifndef PRIu64
 #define PRIu64 "I64u"
 #define PRIX64 "I64X"
@@ -642,7 +642,7 @@ void F_CastDrawer (void)
 
   // erase the entire screen to a background
   // CPhipps - patch drawing updated
-  V_DrawNamePatch(0,0,0, bgcastcall, CR_DEFAULT, VPT_STRETCH); // Ty 03/30/98 bg texture extern
+  V_DrawNameBackground(bgcastcall); // Ty 03/30/98 bg texture extern
 
   F_CastPrint (*(castorder[castnum].name));
 
@@ -676,9 +676,9 @@ static void F_BunnyScroll (void)
   {
     int scrolled = 320 - (FinaleCount-230)/2;
     if (scrolled <= 0) {
-      V_DrawNamePatch(0, 0, 0, pfub2, CR_DEFAULT, VPT_STRETCH);
+      V_DrawNameBackground(pfub2);
     } else if (scrolled >= 320) {
-      V_DrawNamePatch(0, 0, 0, pfub1, CR_DEFAULT, VPT_STRETCH);
+      V_DrawNameBackground(pfub1);
     } else {
       V_DrawNamePatch(320-scrolled, 0, 0, pfub1, CR_DEFAULT, VPT_STRETCH);
       V_DrawNamePatch(-scrolled, 0, 0, pfub2, CR_DEFAULT, VPT_STRETCH);
@@ -715,6 +715,15 @@ static void F_BunnyScroll (void)
 */
 void F_Drawer (void)
 {
+  static int oldcount = -1;
+
+  // the text and the cast move on every F_Ticker
+  if (FinaleCount != oldcount)
+  {
+    oldcount = FinaleCount;
+    screen_dirty = TRUE;
+  }
+
   if (!FinaleStage)
     F_TextWrite ();
   else if (FinaleStage == 2)
@@ -729,7 +738,7 @@ void F_Drawer (void)
        F_BunnyScroll ();
     else
     {
-      V_DrawNamePatch(0, 0, 0, gamemapinfo->endpic, CR_DEFAULT, VPT_STRETCH);
+      V_DrawNameBackground(gamemapinfo->endpic);
       // e6y: wide-res
       //V_FillBorder(-1, 0);
     }
@@ -741,21 +750,21 @@ void F_Drawer (void)
       // CPhipps - patch drawing updated
       case 1:
         if ( gamemode == retail )
-          V_DrawNamePatch(0, 0, 0, "CREDIT", CR_DEFAULT, VPT_STRETCH);
+          V_DrawNameBackground("CREDIT");
         else
-          V_DrawNamePatch(0, 0, 0, "HELP2", CR_DEFAULT, VPT_STRETCH);
+          V_DrawNameBackground("HELP2");
         break;
       case 2:
-        V_DrawNamePatch(0, 0, 0, "VICTORY2", CR_DEFAULT, VPT_STRETCH);
+        V_DrawNameBackground("VICTORY2");
         break;
       case 3:
         F_BunnyScroll ();
         break;
       case 4:
-           V_DrawNamePatch(0, 0, 0, "ENDPIC", CR_DEFAULT, VPT_STRETCH);
+           V_DrawNameBackground("ENDPIC");
            break;
       case 5:
-           V_DrawNamePatch(0, 0, 0, "SIGILEND", CR_DEFAULT, VPT_STRETCH);
+           V_DrawNameBackground("SIGILEND");
            break;
     }
   }
@@ -40,6 +40,7 @@
 #include "i_video.h"
 #include "v_video.h"
 #include "m_random.h"
+#include "r_draw.h"
 #include "f_wipe.h"
 
 //
@@ -48,6 +49,11 @@
 
 // Parts re-written to support true-color video modes. Column-major
 // formatting removed. - POPE
+//
+// Each column of the melt is the top of the end screen down to its
+// y_lookup, then the start screen pushed down below it, so the start and
+// end screens are kept column-major while melting: a column is two block
+// copies and the moved columns are transposed back onto the screen.
 
 // CPhipps - macros for the source and destination screens
 #define SRC_SCR 2
@@ -59,8 +65,12 @@ static screeninfo_t wipe_scr;
 
 static int y_lookup[MAX_SCREENWIDTH];
 
+// column-major start, end and current screens, SCREENHEIGHT apart
+static pixel_t *melt_start, *melt_end, *melt_cols;
+
 static int wipe_initMelt(int ticks)
 {
+  size_t size = SCREENWIDTH * SCREENHEIGHT * sizeof(*melt_cols);
   int i;
 
   // copy start screen to main screen
@@ -69,6 +79,18 @@ static int wipe_initMelt(int ticks)
            wipe_scr_start.data+i * SURFACE_BYTE_PITCH,
            SCREENWIDTH * SURFACE_PIXEL_DEPTH);
 
+  // screen rows become melt columns
+  melt_start = malloc(size);
+  melt_end = malloc(size);
+  melt_cols = malloc(size);
+  R_TransposeRect16(melt_start, SCREENHEIGHT,
+                    (const pixel_t *)wipe_scr_start.data, SURFACE_SHORT_PITCH,
+                    SCREENHEIGHT, SCREENWIDTH);
+  R_TransposeRect16(melt_end, SCREENHEIGHT,
+                    (const pixel_t *)wipe_scr_end.data, SURFACE_SHORT_PITCH,
+                    SCREENHEIGHT, SCREENWIDTH);
+  memcpy(melt_cols, melt_start, size);
+
   // setup initial column positions (y<0 => not ready to scroll yet)
   y_lookup[0] = -(M_Random()%16);
   for (i=1;i<SCREENWIDTH;i++)
@@ -87,6 +109,7 @@ static int wipe_initMelt(int ticks)
 static int wipe_doMelt(int ticks)
 {
    dbool   done = TRUE;
+   int x1 = SCREENWIDTH, x2 = -1;
    int i;
 
    while (ticks--)
@@ -101,8 +124,7 @@ static int wipe_doMelt(int ticks)
          }
          if (y_lookup[i] < SCREENHEIGHT)
          {
-            uint8_t *s, *d;
-            int j, dy;
+            int dy;
 
             /* cph 2001/07/29 -
              *  The original melt rate was 8 pixels/sec, i.e. 25 frames to melt
@@ -113,31 +135,31 @@ static int wipe_doMelt(int ticks)
             if (y_lookup[i]+dy >= SCREENHEIGHT)
                dy = SCREENHEIGHT - y_lookup[i];
 
-            s = wipe_scr_end.data    + (y_lookup[i] * SURFACE_BYTE_PITCH +(i * SURFACE_PIXEL_DEPTH));
-            d = wipe_scr.data        + (y_lookup[i] * SURFACE_BYTE_PITCH +(i * SURFACE_PIXEL_DEPTH));
-            for (j=dy;j;j--) {
-
-               d[0] = s[0];
-               d[1] = s[1];
-
-               d += SURFACE_BYTE_PITCH;
-               s += SURFACE_BYTE_PITCH;
-            }
             y_lookup[i] += dy;
-            s = wipe_scr_start.data  + (i * SURFACE_PIXEL_DEPTH);
-            d = wipe_scr.data        + (y_lookup[i] *  SURFACE_BYTE_PITCH +(i * SURFACE_PIXEL_DEPTH));
-            for (j=SCREENHEIGHT-y_lookup[i];j;j--) {
-
-               d[0] = s[0];
-               d[1] = s[1];
-
-               d += SURFACE_BYTE_PITCH;
-               s += SURFACE_BYTE_PITCH;
-            }
+            if (i < x1)
+               x1 = i;
+            if (i > x2)
+               x2 = i;
             done = FALSE;
          }
       }
    }
+
+   if (x2 < x1)
+      return done;
+
+   // rebuild the columns that moved, and put them back on the screen
+   for (i = x1; i <= x2; i++)
+   {
+      pixel_t *col = melt_cols + i * SCREENHEIGHT;
+      int y = y_lookup[i] < 0 ? 0 : y_lookup[i];
+
+      memcpy(col, melt_end + i * SCREENHEIGHT, y * sizeof(*col));
+      memcpy(col + y, melt_start + i * SCREENHEIGHT, (SCREENHEIGHT - y) * sizeof(*col));
+   }
+   R_TransposeRect16((pixel_t *)wipe_scr.data + x1, SURFACE_SHORT_PITCH,
+                     melt_cols + x1 * SCREENHEIGHT, SCREENHEIGHT,
+                     x2 - x1 + 1, SCREENHEIGHT);
    return done;
 }
 
@@ -145,6 +167,10 @@ static int wipe_doMelt(int ticks)
 
 static int wipe_exitMelt(int ticks)
 {
+  free(melt_start);
+  free(melt_end);
+  free(melt_cols);
+  melt_start = melt_end = melt_cols = NULL;
   V_FreeScreen(&wipe_scr_start);
   wipe_scr_start.height = 0;
   V_FreeScreen(&wipe_scr_end);
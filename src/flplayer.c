@@ -31,6 +31,10 @@
 #include "config.h"
 
 #include "musicplayer.h"
+#include "flplayer.h"
+
+// Trade synthesis quality for time when rendering falls behind
+int mus_fluidsynth_budget;
 
 #ifndef HAVE_LIBFLUIDSYNTH
 #include <string.h>
@@ -58,6 +62,7 @@ const music_player_t fl_player =
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL
 };
 
@@ -113,6 +118,78 @@ static int mus_fluidsynth_gain   = 1; // NSM  fine tune fluidsynth output level
 static int mus_fluidsynth_chorus = 1;
 static int mus_fluidsynth_reverb = 1;
 
+// general midi spec says no more than 24 voices needed
+#define FL_POLYPHONY        24
+#define FL_POLYPHONY_BUDGET 12
+
+// Budget mode watches the time fl_render takes against the time the
+// audio it made lasts. Past FL_BUDGET_HIGH percent it steps down a level
+// at once; under FL_BUDGET_LOW percent for FL_BUDGET_RECOVER seconds of
+// audio it steps back up.
+#define FL_BUDGET_HIGH    30
+#define FL_BUDGET_LOW     10
+#define FL_BUDGET_RECOVER 4
+
+enum
+{
+  FL_LEVEL_FULL,        // as configured
+  FL_LEVEL_POLYPHONY,   // fewer voices
+  FL_LEVEL_NOEFFECTS,   // and no chorus or reverb
+  FL_LEVEL_LINEAR,      // and linear interpolation
+  FL_LEVEL_COUNT
+};
+
+static int f_level;
+static int f_load;      // smoothed render time, percent of real time
+static int f_recover;   // samples rendered under FL_BUDGET_LOW
+
+static void fl_setlevel (int level)
+{
+  f_level = level;
+  f_recover = 0;
+
+  fluid_synth_set_polyphony (f_syn, level >= FL_LEVEL_POLYPHONY ? FL_POLYPHONY_BUDGET : FL_POLYPHONY);
+  fluid_synth_set_chorus_on (f_syn, level >= FL_LEVEL_NOEFFECTS ? 0 : mus_fluidsynth_chorus);
+  fluid_synth_set_reverb_on (f_syn, level >= FL_LEVEL_NOEFFECTS ? 0 : mus_fluidsynth_reverb);
+  fluid_synth_set_interp_method (f_syn, -1, level >= FL_LEVEL_LINEAR ? FLUID_INTERP_LINEAR : FLUID_INTERP_4THORDER);
+}
+
+static void fl_budget (int64_t elapsed, unsigned length)
+{
+  int load;
+
+  if (!mus_fluidsynth_budget)
+  {
+    if (f_level != FL_LEVEL_FULL)
+      fl_setlevel (FL_LEVEL_FULL);
+    return;
+  }
+
+  if (!length)
+    return;
+
+  load = (int) (elapsed * f_soundrate / 10000 / length);
+  f_load = (f_load * 3 + load) / 4;
+
+  if (f_load > FL_BUDGET_HIGH && f_level < FL_LEVEL_COUNT - 1)
+  {
+    fl_setlevel (f_level + 1);
+    log_cb (RETRO_LOG_INFO, "fluidplayer: render at %i%% of real time, dropping to quality level %i\n", f_load, f_level);
+    f_load = FL_BUDGET_HIGH; // give the new level a chance to show
+  }
+  else if (f_load < FL_BUDGET_LOW && f_level > FL_LEVEL_FULL)
+  {
+    f_recover += length;
+    if (f_recover >= f_soundrate * FL_BUDGET_RECOVER)
+    {
+      fl_setlevel (f_level - 1);
+      log_cb (RETRO_LOG_INFO, "fluidplayer: render at %i%% of real time, raising to quality level %i\n", f_load, f_level);
+    }
+  }
+  else
+    f_recover = 0;
+}
+
 static int fl_init (int samplerate)
 {
   const char *filename;
@@ -155,8 +232,7 @@ static int fl_init (int samplerate)
   FSET (num, "synth.gain", mus_fluidsynth_gain / 100.0); // 0.0 - 0.2 - 10.0
   // behavior wrt bank select messages
   FSET (str, "synth-midi-bank-select", "gm"); // general midi mode
-  // general midi spec says no more than 24 voices needed
-  FSET (int, "synth-polyphony", 24);
+  FSET (int, "synth-polyphony", FL_POLYPHONY);
 
   // we're not using the builtin shell or builtin midiplayer,
   // and our own access to the synth is protected by mutex in i_sound.c
@@ -187,6 +263,9 @@ static int fl_init (int samplerate)
     return 0;
   }
 
+  f_load = 0;
+  fl_setlevel (FL_LEVEL_FULL);
+
   return 1;
 }
 
@@ -278,6 +357,8 @@ static void fl_play (const void *handle, int looping)
   f_delta = 0.0;
   fluid_synth_program_reset (f_syn);
   fluid_synth_system_reset (f_syn);
+  // the reset puts every channel back to the default interpolation
+  fl_setlevel (f_level);
 }
 
 static void fl_stop (void)
@@ -352,7 +433,7 @@ static void writesysex (unsigned char *data, int len)
   }
 }  
 
-static void fl_render (void *vdest, unsigned length)
+static void fl_render_events (void *vdest, unsigned length)
 {
   short *dest = vdest;
   
@@ -361,18 +442,6 @@ static void fl_render (void *vdest, unsigned length)
 
   midi_event_t *currevent;
 
-  log_cb(RETRO_LOG_INFO, "Test 1\n");
-
-  if (!f_playing || f_paused)
-  { 
-    // save CPU time and allow for seamless resume after pause
-    memset (vdest, 0, length * 4);
-    //fl_writesamples_ex (vdest, length);
-    return;
-  }
-
-  log_cb(RETRO_LOG_INFO, "Test 2\n");
-
 
   while (1)
   {
@@ -491,6 +560,28 @@ static void fl_render (void *vdest, unsigned length)
 }  
 
 
+static void fl_render (void *vdest, unsigned length)
+{
+  int64_t start;
+
+  if (!f_playing || f_paused)
+  { 
+    // save CPU time and allow for seamless resume after pause
+    memset (vdest, 0, length * 4);
+    //fl_writesamples_ex (vdest, length);
+    return;
+  }
+
+  start = I_GetTimeUS ();
+  fl_render_events (vdest, length);
+  fl_budget (I_GetTimeUS () - start, length);
+}
+
+static int fl_playing (void)
+{
+  return f_playing;
+}
+
 const music_player_t fl_player =
 {
   fl_name,
@@ -503,7 +594,8 @@ const music_player_t fl_player =
   fl_unregistersong,
   fl_play,
   fl_stop,
-  fl_render
+  fl_render,
+  fl_playing
 };
 
 
@@ -36,6 +36,10 @@
 
 extern const music_player_t fl_player;
 
+// Nonzero to let the player shed polyphony, effects and interpolation
+// quality while rendering falls behind
+extern int mus_fluidsynth_budget;
+
 
 
 
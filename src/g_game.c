@@ -82,6 +82,9 @@
 #include "i_system.h"
 #include "r_demo.h"
 #include "r_fps.h"
+#include "d_bench.h"
+#include "i_thread.h"
+#include "m_lz.h"
 
 #define SAVEGAMESIZE  0x20000
 #define SAVESTRINGSIZE  24
@@ -90,6 +93,13 @@ static size_t   savegamesize = SAVEGAMESIZE; // killough
 static dbool    netdemo;
 static const uint8_t *demobuffer;   /* cph - only used for playback */
 static int demolength; // check for overrun (missing DEMOMARKER)
+// A demo longer than the window is read into it a piece at a time as it
+// plays, from demoread on in its lump, instead of being cached whole
+#define DEMOWINDOW  0x10000
+static uint8_t *demowindow;
+static int demoread;
+static int demolumpnum = -1;
+static int demostarttic;   // gametic of the demo's first tic
 #if 0
 static FILE    *demofp; /* cph - record straight to file */
 #endif
@@ -124,6 +134,7 @@ int             demover;
 wbstartstruct_t wminfo;               // parms for world map / intermission
 dbool           haswolflevels = FALSE;// jff 4/18/98 wolf levels present
 static uint8_t     *savebuffer;          // CPhipps - static
+static uint8_t     *savebuffer_fixed;    // caller's buffer, written in place until it overflows
 int             autorun = FALSE;      // always running?          // phares
 int             totalleveltimes;      // CPhipps - total time for all completed levels
 int		longtics;
@@ -240,6 +251,9 @@ int    bodyqueslot, bodyquesize;        // killough 2/8/98
 mobj_t **bodyque = 0;                   // phares 8/10/98
 
 static void G_DoSaveGame (dbool   menu);
+static int G_UnpackSaveGame(uint8_t **buffer, int length);
+static void G_MakeDemoKey(void);
+static void G_FreeDemoKeys(void);
 static const uint8_t* G_ReadDemoHeader(const uint8_t* demo_p, size_t size, dbool   failonerror);
 static mapentry_t *G_LookupMapinfo(int episode, int map);
 
@@ -526,8 +540,6 @@ void G_RestartLevel(void)
   special_event = BT_SPECIAL | (BTS_RESTARTLEVEL & BT_SPECIALMASK);
 }
 
-#include "z_bmalloc.h"
-
 /*
 ==============
 =
@@ -606,12 +618,7 @@ static void G_DoLoadLevel (void)
   // by Z_FreeTags() when the previous level ended or player
   // died.
 
-  {
-    DECLARE_BLOCK_MEMORY_ALLOC_ZONE(secnodezone);
-    NULL_BLOCK_MEMORY_ALLOC_ZONE(secnodezone);
-    //extern msecnode_t *headsecnode; // phares 3/25/98
-    //headsecnode = NULL;
-  }
+  P_ClearSecnodes();
 
   P_SetupLevel (gameepisode, gamemap, 0, gameskill);
   if (!demoplayback) /* Don't switch views if playing a demo */
@@ -631,6 +638,22 @@ static void G_DoLoadLevel (void)
 }
 
 
+// The ticcmd being built up for the next tic, and the mouse motion that
+// hasn't gone into one yet, as G_BuildTiccmd and P_SetPitch will use it
+void G_PendingLook(angle_t *turn, angle_t *look)
+{
+  int angleturn = D_PendingTurn();
+
+  if (!gamekeydown[key_strafe] && !mousebuttons[mousebstrafe])
+    angleturn -= mousex;
+  *turn = (angle_t)angleturn << 16;
+
+  *look = mlooky;
+  if (movement_mouselook)
+    *look += movement_mouseinvert ? -mousey : mousey;
+  *look <<= 16;
+}
+
 //
 // G_Responder
 // Get info needed to make ticcmd_ts for the players.
@@ -685,6 +708,14 @@ dbool   G_Responder (event_t* ev)
     return TRUE;
   }
 
+      // the strafe keys move about in the demo being played
+      if (ev->type == ev_keydown && demoplayback && gamestate == GS_LEVEL &&
+          (ev->data1 == key_strafeleft || ev->data1 == key_straferight))
+  {
+    G_SeekDemo(ev->data1 == key_strafeleft ? -DEMOSEEKTICS : DEMOSEEKTICS);
+    return TRUE;
+  }
+
       // killough 10/98:
       // Don't pop up menu, if paused in middle
       // of demo playback, or if automap active.
@@ -800,6 +831,9 @@ void G_Ticker (void)
         }
     }
 
+  if (demoplayback && gamestate == GS_LEVEL && !(paused & 2))
+    G_MakeDemoKey();
+
   if (paused & 2 || (!demoplayback && menuactive && !netgame))
     basetic++;  // For revenant tracers and RNG -- we must maintain sync
   else {
@@ -917,7 +951,20 @@ void G_Ticker (void)
   switch (gamestate)
     {
     case GS_LEVEL:
-      P_Ticker ();
+      {
+        int64_t start = D_StageStart();
+        P_Ticker ();
+        D_StageStop(BENCH_TICKER, start);
+        if (timingdemo || synclog)
+        {
+          uint32_t checksum = P_StateChecksum();
+
+          if (synclog)
+            lprintf(LO_INFO, "G_Ticker: tic %d state %08x\n", gametic, checksum);
+          if (timingdemo)
+            D_BenchTic(checksum);
+        }
+      }
       ST_Ticker ();
       AM_Ticker ();
       HU_Ticker ();
@@ -1292,6 +1339,7 @@ void G_DoCompleted (void)
   int i;
 
   gameaction = ga_nothing;
+  D_ReportFrameStats();
 
   for (i=0; i<MAXPLAYERS; i++)
     if (playeringame[i])
@@ -1432,6 +1480,9 @@ frommapinfo:
   automapmode &= ~am_active;
 
   WI_Start (&wminfo);
+
+  // read the next map's lumps while the tally is up
+  P_PrefetchLevel(wminfo.nextep+1, wminfo.next+1);
 }
 
 //
@@ -1625,7 +1676,12 @@ static const struct {
   const char* ver_printf;
   int version;
 } version_headers[] = {
-  /* cph - we don't need a new version_header for prboom_3_comp/v2.1.1, since
+  /* 213 saves everything little-endian at fixed widths. It is what
+   *  G_DoSaveGameToSaveBuffer writes, so it comes first. */
+  { prboom_6_compatibility, "PrBoom %d", 213},
+  /* The earlier formats were copied from memory as it was laid out,
+   *  and are only read, by P_UnArchiveLegacyGame.
+   * cph - we don't need a new version_header for prboom_3_comp/v2.1.1, since
    *  the file format is unchanged. */
   { prboom_3_compatibility, "PrBoom %d", 210},
   { prboom_5_compatibility, "PrBoom %d", 211},
@@ -1642,6 +1698,7 @@ static int G_DoLoadGameFromSaveBuffer(int length)
   int isok;
   int  i;
   int savegame_compatibility = -1;
+  dbool legacy = FALSE;      // a 210-212 savegame, copied from memory
 
   gameaction = ga_nothing;
 
@@ -1655,6 +1712,7 @@ static int G_DoLoadGameFromSaveBuffer(int length)
 
     if (!strncmp((const char*)save_p, vcheck, VERSIONSIZE)) {
       savegame_compatibility = version_headers[i].comp_level;
+      legacy = version_headers[i].version < 213;
       i = num_version_headers;
     }
   }
@@ -1671,17 +1729,23 @@ static int G_DoLoadGameFromSaveBuffer(int length)
   // CPhipps - always check savegames even when forced,
   //  only print a warning if forced
   {  // killough 3/16/98: check lump name checksum (independent of order)
-    uint64_t checksum = 0;
+    uint64_t checksum = G_Signature();
+    uint64_t saved;
 
-    checksum = G_Signature();
+    if (legacy) {
+      memcpy(&saved, save_p, sizeof saved);
+      save_p += sizeof saved;
+    }
+    else
+      saved = P_LoadValue(sizeof saved);
 
-    if (memcmp(&checksum, save_p, sizeof checksum)) {
+    if (saved != checksum) {
       if (!forced_loadgame) {
+        save_p -= sizeof checksum; // G_DoLoadGame lists the wads past it
         return -3;
       } else
   lprintf(LO_WARN, "G_DoLoadGame: Incompatible savegame\n");
     }
-    save_p += sizeof checksum;
    }
 
   save_p += strlen((const char*)save_p)+1;
@@ -1713,29 +1777,46 @@ static int G_DoLoadGameFromSaveBuffer(int length)
   // load a base level
   G_InitNew (gameskill, gameepisode, gamemap);
 
-  /* get the times - killough 11/98: save entire word */
-  memcpy(&leveltime, save_p, sizeof leveltime);
-  save_p += sizeof leveltime;
+  if (legacy) {
+    /* get the times - killough 11/98: save entire word */
+    memcpy(&leveltime, save_p, sizeof leveltime);
+    save_p += sizeof leveltime;
 
-  /* cph - total episode time */
-  if (compatibility_level >= prboom_2_compatibility) {
-    memcpy(&totalleveltimes, save_p, sizeof totalleveltimes);
-    save_p += sizeof totalleveltimes;
-  }
-  else totalleveltimes = 0;
+    /* cph - total episode time */
+    if (compatibility_level >= prboom_2_compatibility) {
+      memcpy(&totalleveltimes, save_p, sizeof totalleveltimes);
+      save_p += sizeof totalleveltimes;
+    }
+    else totalleveltimes = 0;
 
-  // killough 11/98: load revenant tracer state
-  basetic = gametic - *save_p++;
+    // killough 11/98: load revenant tracer state
+    basetic = gametic - *save_p++;
 
-  // dearchive all the modifications
-  P_MapStart();
-  P_UnArchivePlayers ();
-  P_UnArchiveWorld ();
-  P_UnArchiveThinkers ();
-  P_UnArchiveSpecials ();
-  P_UnArchiveRNG ();    // killough 1/18/98: load RNG information
-  P_UnArchiveMap ();    // killough 1/22/98: load automap information
-  P_MapEnd();
+    P_MapStart();
+    P_UnArchiveLegacyGame ();
+    P_MapEnd();
+  } else {
+    /* get the times - killough 11/98: save entire word */
+    leveltime = P_LoadValue(4);
+
+    /* cph - total episode time */
+    if (compatibility_level >= prboom_2_compatibility)
+      totalleveltimes = P_LoadValue(4);
+    else totalleveltimes = 0;
+
+    // killough 11/98: load revenant tracer state
+    basetic = gametic - *save_p++;
+
+    // dearchive all the modifications
+    P_MapStart();
+    P_UnArchivePlayers ();
+    P_UnArchiveWorld ();
+    P_UnArchiveThinkers ();
+    P_UnArchiveSpecials ();
+    P_UnArchiveRNG ();    // killough 1/18/98: load RNG information
+    P_UnArchiveMap ();    // killough 1/22/98: load automap information
+    P_MapEnd();
+  }
   R_SmoothPlaying_Reset(NULL); // e6y
 
   isok = *save_p == 0xe6;
@@ -1755,9 +1836,24 @@ void G_DoLoadGame(void)
   // CPhipps - do savegame filename stuff here
   char name[PATH_MAX+1];     // killough 3/22/98
 
+  G_FinishSaveGame(TRUE);  // it may be the one just saved
   G_SaveGameName(name,sizeof(name),savegameslot, demoplayback);
 
   length = M_ReadFile(name, &savebuffer);
+  if (length > 0 && (length = G_UnpackSaveGame(&savebuffer, length)) < 0)
+  {
+    // Refused rather than fatal: a bad file shouldn't end the game
+    Z_Free(savebuffer);
+    savebuffer = NULL;
+    gameaction = ga_nothing;
+    doom_printf("Savegame %s is damaged", name);
+    if (command_loadgame)
+    {
+      D_StartTitle();
+      gamestate = GS_DEMOSCREEN;
+    }
+    return;
+  }
   if (length<=0)
     I_Error("Couldn't read file %s: %s", name, "(Unknown Error)");
 
@@ -1828,8 +1924,19 @@ void (CheckSaveGame)(size_t size, const char* file, int line)
 
   size += 1024;  // breathing room
   if (pos+size > savegamesize)
+  {
+    if (savebuffer == savebuffer_fixed)
+    { // out of room in the caller's buffer; carry on in one of our own
+      uint8_t *heap = malloc(savegamesize + ((size+1023) & ~1023));
+      memcpy(heap, savebuffer, pos);
+      savebuffer = heap;
+      savegamesize += (size+1023) & ~1023;
+      save_p = savebuffer + pos;
+      return;
+    }
     save_p = (savebuffer = realloc(savebuffer,
            savegamesize += (size+1023) & ~1023)) + pos;
+  }
 }
 
 /* killough 3/22/98: form savegame name in one location
@@ -1858,7 +1965,9 @@ static int G_DoSaveGameToSaveBuffer() {
 
   description = savedescription;
 
-  save_p = savebuffer = malloc(savegamesize);
+  if (!savebuffer_fixed)
+    savebuffer = malloc(savegamesize);
+  save_p = savebuffer;
 
   CheckSaveGame(SAVESTRINGSIZE+VERSIONSIZE+sizeof(uint64_t));
   memcpy (save_p, description, SAVESTRINGSIZE);
@@ -1877,9 +1986,7 @@ static int G_DoSaveGameToSaveBuffer() {
   save_p += VERSIONSIZE;
 
   { /* killough 3/16/98, 12/98: store lump name checksum */
-    uint64_t checksum = G_Signature();
-    memcpy(save_p, &checksum, sizeof checksum);
-    save_p += sizeof checksum;
+    P_SaveValue(G_Signature(), sizeof(uint64_t));
   }
 
   // killough 3/16/98: store pwad filenames in savegame
@@ -1915,16 +2022,12 @@ static int G_DoSaveGameToSaveBuffer() {
 
   save_p = G_WriteOptions(save_p);    // killough 3/1/98: save game options
 
-  /* cph - FIXME - endianness? */
   /* killough 11/98: save entire word */
-  memcpy(save_p, &leveltime, sizeof leveltime);
-  save_p += sizeof leveltime;
+  P_SaveValue(leveltime, 4);
 
   /* cph - total episode time */
-  if (compatibility_level >= prboom_2_compatibility) {
-    memcpy(save_p, &totalleveltimes, sizeof totalleveltimes);
-    save_p += sizeof totalleveltimes;
-  }
+  if (compatibility_level >= prboom_2_compatibility)
+    P_SaveValue(totalleveltimes, 4);
   else totalleveltimes = 0;
 
   // killough 11/98: save revenant tracer state
@@ -1957,30 +2060,170 @@ static int G_DoSaveGameToSaveBuffer() {
   return length;
 }
 
-static void G_DoSaveGame (dbool   menu)
-{
-  int length;
+//
+// Savegame files
+//
+// Past the description, which the menu reads as it is, a savegame file
+// holds SAVEMAGIC, the length of the rest of the game and the rest of it
+// compressed by M_LZCompress. Compressing and writing it happen on a
+// thread of their own, so a slow card doesn't hold up the game; without
+// threads, at once. Files from before this are read as they were.
+//
+
+#define SAVEMAGIC       "\x7fPRBLZ1"
+#define SAVEMAGICSIZE   8
+#define SAVEHEADERSIZE  (SAVESTRINGSIZE+SAVEMAGICSIZE+4)
+// Far past any real game; the length in the header is not trusted past it
+#define SAVEMAXREST     (64*1024*1024)
+// Most one compressed byte can stand for: a length byte of 255
+#define SAVEMAXRATIO    255
+
+static struct {
+  i_thread_t *thread;     // NULL when it ran on the game's thread
+  i_mutex_t *lock;        // for done
   char name[PATH_MAX+1];
+  uint8_t *game;          // the savebuffer, freed once it is written
+  int length;
+  dbool done, ok;
+} savewrite;
 
-  gameaction = ga_nothing; // cph - cancel savegame at top of this function,
-    // in case later problems cause a premature exit
+static void G_WriteSaveGame(void *arg)
+{
+  const uint8_t *game = savewrite.game;
+  size_t rest = savewrite.length - SAVESTRINGSIZE;
+  uint8_t *file = malloc(SAVEHEADERSIZE + M_LZBound(rest));
+  size_t length;
+  int i;
 
-  G_SaveGameName(name,sizeof(name),savegameslot, demoplayback && !menu);
+  if (!file)
+  {
+    I_MutexLock(savewrite.lock);
+    savewrite.done = TRUE;   // ok stays FALSE
+    I_MutexUnlock(savewrite.lock);
+    return;
+  }
 
-  length = G_DoSaveGameToSaveBuffer();
+  memcpy(file, game, SAVESTRINGSIZE);
+  memcpy(file + SAVESTRINGSIZE, SAVEMAGIC, SAVEMAGICSIZE);
+  for (i = 0; i < 4; i++)
+    file[SAVESTRINGSIZE + SAVEMAGICSIZE + i] = (uint8_t)(rest >> (i * 8));
+  length = SAVEHEADERSIZE + M_LZCompress(game + SAVESTRINGSIZE, rest,
+      file + SAVEHEADERSIZE);
 
-  doom_printf( "%s", M_WriteFile(name, savebuffer, length)
+  savewrite.ok = M_WriteFile(savewrite.name, file, length);
+  free(file);
+
+  I_MutexLock(savewrite.lock);
+  savewrite.done = TRUE;
+  I_MutexUnlock(savewrite.lock);
+}
+
+//
+// G_FinishSaveGame
+// Reports how the last savegame write went once it is over, waiting for
+// it if asked. Call before reading a savegame back.
+//
+
+void G_FinishSaveGame(dbool wait)
+{
+  if (!savewrite.game)
+    return;
+  if (savewrite.thread)
+  {
+    dbool done;
+
+    I_MutexLock(savewrite.lock);
+    done = savewrite.done;
+    I_MutexUnlock(savewrite.lock);
+    if (!done && !wait)
+      return;
+    I_ThreadJoin(savewrite.thread);
+    savewrite.thread = NULL;
+  }
+
+  doom_printf( "%s", savewrite.ok
          ? s_GGSAVED /* Ty - externalised */
          : "Game save failed!"); // CPhipps - not externalised
 
-  free(savebuffer);  // killough
+  free(savewrite.game);  // killough
+  savewrite.game = NULL;
+}
+
+// Swaps a compressed savegame for the game in it, and returns its length;
+// anything else is left as it is. -1 if it is damaged.
+static int G_UnpackSaveGame(uint8_t **buffer, int length)
+{
+  const uint8_t *file = *buffer;
+  uint8_t *game;
+  size_t rest = 0;
+  int i;
+
+  if (length < SAVEHEADERSIZE ||
+      memcmp(file + SAVESTRINGSIZE, SAVEMAGIC, SAVEMAGICSIZE))
+    return length;
+
+  for (i = 0; i < 4; i++)
+    rest |= (size_t)file[SAVESTRINGSIZE + SAVEMAGICSIZE + i] << (i * 8);
+  // The length comes from the file; past either bound it is damaged, and
+  // trusting it could wrap the size below on 32-bit hosts
+  if (rest > SAVEMAXREST ||
+      rest / SAVEMAXRATIO > (size_t)(length - SAVEHEADERSIZE))
+    return -1;
+  if (!(game = malloc(SAVESTRINGSIZE + rest + 1)))
+    return -1;
+  memcpy(game, file, SAVESTRINGSIZE);
+  if (M_LZDecompress(file + SAVEHEADERSIZE, length - SAVEHEADERSIZE,
+        game + SAVESTRINGSIZE, rest) != (long)rest)
+  {
+    free(game);
+    return -1;
+  }
+  free(*buffer);
+  *buffer = game;
+  return SAVESTRINGSIZE + rest;
+}
+
+static void G_DoSaveGame (dbool   menu)
+{
+  gameaction = ga_nothing; // cph - cancel savegame at top of this function,
+    // in case later problems cause a premature exit
+
+  G_FinishSaveGame(TRUE);  // one at a time
+
+  G_SaveGameName(savewrite.name,sizeof(savewrite.name),savegameslot, demoplayback && !menu);
+
+  savewrite.length = G_DoSaveGameToSaveBuffer();
+  savewrite.game = savebuffer;
   savebuffer = save_p = NULL;
+  savewrite.done = savewrite.ok = FALSE;
+
+  if (!savewrite.lock)
+    savewrite.lock = I_MutexCreate();
+  if (!(savewrite.thread = I_ThreadCreate(G_WriteSaveGame, NULL)))
+  {
+    G_WriteSaveGame(NULL);
+    G_FinishSaveGame(TRUE);
+  }
 
   savedescription[0] = 0;
 }
 
+// Room G_DoSaveGameToBuffer needs for the game as it stands: the
+// header written above plus P_ArchiveSize, as CheckSaveGame is asked
+size_t G_SaveGameSize(void) {
+  size_t size = SAVESTRINGSIZE+VERSIONSIZE+sizeof(uint64_t) + 1;
+  size_t i;
+
+  if (thinkercap.next == NULL)
+    return 0;
+  for (i = 0; i<numwadfiles; i++)
+    size += strlen(wadfiles[i].name)+2;
+  return size + GAME_OPTION_SIZE+MIN_MAXPLAYERS+14 + P_ArchiveSize() + 1;
+}
+
 bool G_DoSaveGameToBuffer(void *buf, size_t size) {
   int length, ok;
+  size_t old_savegamesize;
   char description_saved[SAVEDESCLEN];
   // If no game is loaded we can't save
   if (thinkercap.next == NULL)
@@ -1990,17 +2233,26 @@ bool G_DoSaveGameToBuffer(void *buf, size_t size) {
   memcpy(description_saved, savedescription, SAVEDESCLEN);
   strcpy(savedescription, "BUFFER");
 
+  // Archive straight into the caller's buffer; CheckSaveGame only moves
+  // to the heap if it runs out of room
+  old_savegamesize = savegamesize;
+  savebuffer = savebuffer_fixed = buf;
+  savegamesize = size;
+
   length = G_DoSaveGameToSaveBuffer();
 
   ok = (length > 0 && (size_t) length <= size);
 
   if (ok) {
-    memcpy(buf, savebuffer, length);
+    if (savebuffer != savebuffer_fixed)
+      memcpy(buf, savebuffer, length);
     memset(((char*)buf)+length, 0, size - length);
   }
 
-  free(savebuffer);  // killough
-  savebuffer = save_p = NULL;
+  if (savebuffer != savebuffer_fixed)
+    free(savebuffer);  // killough
+  savebuffer = save_p = savebuffer_fixed = NULL;
+  savegamesize = old_savegamesize;
   memcpy(savedescription, description_saved, SAVEDESCLEN);
 
   return ok;
@@ -2115,11 +2367,21 @@ void G_Compatibility(void)
     weapon_recoil = 0;
     player_bobbing = 1;
   }
+
+  P_SelectCompatPaths();
 }
 
 // killough 3/1/98: function to reload all the default parameter
 // settings before a new game begins
 
+// Set by the frontend; turns demo_insurance on whatever the config says
+static dbool force_demo_insurance;
+
+void G_SetDemoInsurance(dbool on)
+{
+  force_demo_insurance = on;
+}
+
 void G_ReloadDefaults(void)
 {
   // killough 3/1/98: Initialize options based on config file
@@ -2187,7 +2449,7 @@ void G_ReloadDefaults(void)
   G_Compatibility();
 
   // killough 3/31/98, 4/5/98: demo sync insurance
-  demo_insurance = default_demo_insurance == 1;
+  demo_insurance = default_demo_insurance == 1 || force_demo_insurance;
 
   rngseed += I_GetRandomTimeSeed() + gametic; // CPhipps
 }
@@ -2376,10 +2638,32 @@ void G_InitNew(skill_t skill, int episode, int map)
 
 #define DEMOMARKER    0x80
 
+// Move what's left of the window to its start and read in after it; the
+// byte after the last read is cleared, so running off the end of a demo
+// finds no DEMOMARKER there
+static void G_FillDemoWindow(void)
+{
+  int left = demobuffer + demolength - demo_p;
+  int size = W_LumpLength(demolumpnum) - demoread;
+
+  if (size > DEMOWINDOW - 1 - left)
+    size = DEMOWINDOW - 1 - left;
+  memmove(demowindow, demo_p, left);
+  if (!W_ReadLumpRange(demolumpnum, demowindow + left, demoread, size))
+    size = 0;
+  demoread += size;
+  demolength = left + size;
+  demowindow[demolength] = 0;
+  demobuffer = demo_p = demowindow;
+}
+
 void G_ReadDemoTiccmd (ticcmd_t* cmd)
 {
   unsigned char at = 0; // e6y: tasdoom stuff
 
+  if (demowindow && demo_p + 5 > demobuffer + demolength)
+    G_FillDemoWindow();
+
   if (*demo_p == DEMOMARKER)
     G_CheckDemoStatus();      // end of demo data stream
   else if (demoplayback && demo_p + (longtics?5:4) > demobuffer + demolength)
@@ -2587,8 +2871,6 @@ void G_DeferedPlayDemo (const char* name)
   gameaction = ga_playdemo;
 }
 
-static int demolumpnum = -1;
-
 static int G_GetOriginalDoomCompatLevel(int ver)
 {
   {
@@ -2863,8 +3145,18 @@ void G_DoPlayDemo(void)
 
   /* cph - store lump number for unlocking later */
   demolumpnum = W_GetNumForName(basename);
-  demobuffer = W_CacheLumpNum(demolumpnum);
   demolength = W_LumpLength(demolumpnum);
+  if (demolength >= DEMOWINDOW &&
+      W_ReadLumpRange(demolumpnum, NULL, 0, 0)) // not compressed
+  {
+    if (!demowindow)
+      demowindow = Z_Malloc(DEMOWINDOW, PU_STATIC, 0);
+    demoread = demolength = 0;
+    demobuffer = demo_p = demowindow;
+    G_FillDemoWindow(); // the header's well within the first window
+  }
+  else
+    demobuffer = W_CacheLumpNum(demolumpnum);
 
   demo_p = G_ReadDemoHeader(demobuffer, demolength, TRUE);
 
@@ -2872,7 +3164,157 @@ void G_DoPlayDemo(void)
   usergame = FALSE;
 
   demoplayback = TRUE;
+  demostarttic = gametic;
+  G_FreeDemoKeys();
   R_SmoothPlaying_Reset(NULL); // e6y
+
+  if (timingdemo)
+    D_StartTimingDemo(defdemoname);
+}
+
+//
+// Demo keyframes
+//
+// While a demo plays the game is saved every demokeytics into memory,
+// along with where in the demo it had got to, so G_SeekDemo can go back
+// to the last keyframe before a tic and play on from there instead of
+// from the start. Once MAXDEMOKEYS have been made every other one is
+// dropped and the interval doubled, which bounds the memory on the
+// longest demos.
+//
+
+#ifdef MEMORY_LOW
+#define MAXDEMOKEYS   16
+#else
+#define MAXDEMOKEYS   128
+#endif
+#define DEMOKEYTICS   (10*TICRATE)
+
+typedef struct {
+  int gametic;
+  int demopos;     // offset of the tic's ticcmds in the demo lump
+  int length;
+  uint8_t *state;  // as G_DoSaveGameToSaveBuffer writes it
+} demokey_t;
+
+static demokey_t demokeys[MAXDEMOKEYS];
+static int numdemokeys;
+static int demokeytics = DEMOKEYTICS;
+static int demoseek;       // tics to move by at the start of the next frame
+
+static int G_DemoPos(void)
+{
+  if (demowindow)
+    return demoread - (int)(demobuffer + demolength - demo_p);
+  return demo_p - demobuffer;
+}
+
+static void G_SetDemoPos(int pos)
+{
+  if (demowindow)
+  {
+    demoread = pos;
+    demolength = 0;
+    demobuffer = demo_p = demowindow;
+    G_FillDemoWindow();
+  }
+  else
+    demo_p = demobuffer + pos;
+}
+
+static void G_FreeDemoKeys(void)
+{
+  while (numdemokeys)
+    free(demokeys[--numdemokeys].state);
+  demokeytics = DEMOKEYTICS;
+  demoseek = 0;
+}
+
+static void G_MakeDemoKey(void)
+{
+  demokey_t *key;
+  int i, tic = gametic - demostarttic;
+
+  if (tic % demokeytics ||
+      (numdemokeys && demokeys[numdemokeys-1].gametic >= gametic))
+    return;
+
+  if (numdemokeys == MAXDEMOKEYS)
+  {
+    int n = 0;
+
+    demokeytics *= 2;
+    for (i = 0; i < numdemokeys; i++)
+      if ((demokeys[i].gametic - demostarttic) % demokeytics)
+        free(demokeys[i].state);
+      else
+        demokeys[n++] = demokeys[i];
+    numdemokeys = n;
+    if (tic % demokeytics)
+      return;
+  }
+
+  key = &demokeys[numdemokeys];
+  key->length = G_DoSaveGameToSaveBuffer();
+  key->state = realloc(savebuffer, key->length);  // only what it needs
+  savebuffer = save_p = NULL;
+  key->gametic = gametic;
+  key->demopos = G_DemoPos();
+  numdemokeys++;
+}
+
+void G_SeekDemo(int tics)
+{
+  if (demoplayback)
+    demoseek += tics;
+}
+
+// Run from D_DoomLoop between frames, when no tic is under way
+void G_DoSeekDemo(void)
+{
+  int target = gametic + demoseek, i;
+  const demokey_t *key = NULL;
+  int pause = paused & 2;
+
+  if (!demoseek)
+    return;
+  demoseek = 0;
+  if (!demoplayback || gamestate != GS_LEVEL || gameaction != ga_nothing)
+    return;
+  if (target < demostarttic)
+    target = demostarttic;
+
+  for (i = numdemokeys; i-- > 0; )
+    if (demokeys[i].gametic <= target)
+    {
+      key = &demokeys[i];
+      break;
+    }
+
+  // go back to the keyframe, or on to it if it's ahead of the game
+  if (key && (target < gametic || key->gametic > gametic))
+  {
+    gametic = maketic = key->gametic;
+    savebuffer = key->state;
+    G_DoLoadGameFromSaveBuffer(key->length);
+    savebuffer = save_p = NULL;
+    G_SetDemoPos(key->demopos);
+    usergame = FALSE;
+    paused |= pause;
+  }
+  else if (target < gametic)
+    return;
+
+  // and play on to the tic quietly, up to the end of the level
+  fastforwarding = TRUE;
+  while (gametic < target && demoplayback && gamestate == GS_LEVEL &&
+         gameaction == ga_nothing)
+    D_RunExtraTic();
+  fastforwarding = FALSE;
+  R_SmoothPlaying_Reset(NULL);
+
+  i = (gametic - demostarttic) / TICRATE;
+  doom_printf("%d:%02d", i / 60, i % 60);
 }
 
 /* G_CheckDemoStatus
@@ -2884,10 +3326,21 @@ dbool   G_CheckDemoStatus (void)
 {
   if (demoplayback)
   {
-    if (demolumpnum != -1) {
+    if (demowindow) {
+      Z_Free(demowindow);
+      demowindow = NULL;
+    }
+    else if (demolumpnum != -1) {
       // cph - unlock the demo lump
       W_UnlockLumpNum(demolumpnum);
-      demolumpnum = -1;
+    }
+    demolumpnum = -1;
+    G_FreeDemoKeys();
+    // like -timedemo always has, quit once the demo has been timed
+    if (timingdemo)
+    {
+      D_FinishTimingDemo();
+      quit_pressed = TRUE;
     }
     G_ReloadDefaults();    // killough 3/1/98
     netgame = FALSE;       // killough 3/29/98
@@ -35,6 +35,7 @@
 #include "doomdef.h"
 #include "d_event.h"
 #include "d_ticcmd.h"
+#include "tables.h"
 
 //
 // GAME
@@ -57,7 +58,10 @@ void G_ForcedLoadGame(void);           // killough 5/15/98: forced loadgames
 void G_DoLoadGame(void);
 bool G_DoLoadGameFromBuffer(void *data, size_t length);
 bool G_DoSaveGameToBuffer(void *buf, size_t size);
+size_t G_SaveGameSize(void);
 void G_SaveGame(int slot, char *description); // Called by M_Responder.
+// Reports the last savegame write once done; waits for it if wait is set
+void G_FinishSaveGame(dbool wait);
 void G_ExitLevel(void);
 void G_SecretExitLevel(void);
 void G_WorldDone(void);
@@ -66,12 +70,20 @@ void G_Ticker(void);
 void G_ReloadDefaults(void);     // killough 3/1/98: loads game defaults
 void G_SaveGameName(char *, size_t, int, dbool); /* killough 3/22/98: sets savegame filename */
 void G_SetFastParms(int);        // killough 4/10/98: sets -fast parameters
+void G_SetDemoInsurance(dbool on); // forces demo_insurance on from the next new game
 void G_ScaleMovementToFramerate (void);
 void G_DoNewGame(void);
 void G_DoReborn(int playernum);
 void G_DoPlayDemo(void);
 void G_DoCompleted(void);
 void G_ReadDemoTiccmd(ticcmd_t *cmd);
+// Turn and look the console player has asked for that no tic has run yet
+void G_PendingLook(angle_t *turn, angle_t *look);
+// Move the demo being played on or back by tics, from the next frame;
+// G_DoSeekDemo is run for it between frames
+#define DEMOSEEKTICS (10*TICRATE)
+void G_SeekDemo(int tics);
+void G_DoSeekDemo(void);
 void G_DoWorldDone(void);
 void G_Compatibility(void);
 const uint8_t *G_ReadOptions(const uint8_t *demo_p);   /* killough 3/1/98 - cph: const uint8_t* */
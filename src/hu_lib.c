@@ -197,6 +197,7 @@ void HUlib_drawTextLine
     }
   }
   l->cm = oc; //jff 2/17/98 restore original color
+  l->drawnlines = (y - l->y) / 8 + 1;
 
   // draw the cursor if requested
   if (drawcursor && x + l->f['_' - l->sc].width <= BASE_WIDTH)
@@ -218,7 +219,18 @@ void HUlib_drawTextLine
 //
 void HUlib_eraseTextLine(hu_textline_t* l)
 {
-  if (l->needsupdate) l->needsupdate--;
+  if (l->needsupdate)
+  {
+    // the old text was drawn over drawnlines rows, the new may take more
+    int i, lines = 1;
+
+    for (i = 0; i < l->len; i++)
+      if (l->l[i] == '\n')
+        lines++;
+    lines = MAX(lines, l->drawnlines);
+    V_MarkRect(0, l->y, BASE_WIDTH, (lines - 1) * 8 + l->f[0].height);
+    l->needsupdate--;
+  }
 }
 
 ////////////////////////////////////////////////////////
@@ -424,8 +436,9 @@ static void HUlib_addLineToMText(hu_mtext_t* m)
   if (m->nl<hud_msg_lines)
     m->nl++;
 
-  // needs updating
+  // needs updating, and every line moves down a row
   m->l[m->cl].needsupdate = 4;
+  V_MarkRect(m->x, m->y, m->w, m->h);
 }
 
 //
@@ -557,11 +570,17 @@ void HUlib_eraseMText(hu_mtext_t* m)
 {
   int i;
 
+  // the background goes with the widget
+  if (m->laston != *m->on && hud_list_bgon)
+    V_MarkRect(m->x, m->y, m->w, m->h);
+
   for (i=0 ; i< m->nl ; i++)
   {
-    m->l[i].needsupdate = 4;
+    if (m->laston != *m->on)
+      m->l[i].needsupdate = 4;
     HUlib_eraseTextLine(&m->l[i]);
   }
+  m->laston = *m->on;
 }
 
 ////////////////////////////////////////////////////////
@@ -81,6 +81,9 @@ typedef struct
   // whether this line needs to be udpated
   int   needsupdate;
 
+  // rows of text last drawn, so erasing can mark all of them dirty
+  int   drawnlines;
+
 } hu_textline_t;
 
 
@@ -44,6 +44,7 @@
 #include "d_deh.h"   /* Ty 03/27/98 - externalization of mapnamesx arrays */
 #include "g_game.h"
 #include "r_main.h"
+#include "r_profile.h"
 
 // global heads up display controls
 
@@ -77,6 +78,18 @@ dbool   hud_showweapons; /* show weapons HUD line */
 #define HU_COORDY_Y (2 + 1*hu_font['A'-HU_FONTSTART].height)
 #define HU_COORDZ_Y (3 + 2*hu_font['A'-HU_FONTSTART].height)
 
+// render profile overlay, in the upper left under the messages
+#define HU_PROFILEX 2
+#define HU_PROFILEY(i) (2 + ((i)+2)*hu_font['A'-HU_FONTSTART].height)
+
+// zone memory overlay, under the render profile when both are built
+#define NUMZONELINES (PU_MAX - PU_STATIC + 2)
+#ifdef RENDER_PROFILE
+#define HU_ZONEY(i) HU_PROFILEY(NUMPROFILELINES + (i))
+#else
+#define HU_ZONEY(i) HU_PROFILEY(i)
+#endif
+
 //jff 2/16/98 add ammo, health, armor widgets, 2/22/98 less gap
 #define HU_GAPY 8
 #define HU_HUDHEIGHT (6*HU_GAPY)
@@ -175,6 +188,12 @@ static hu_itext_t     w_inputbuffer[MAXPLAYERS];
 static hu_textline_t  w_coordx; //jff 2/16/98 new coord widget for automap
 static hu_textline_t  w_coordy; //jff 3/3/98 split coord widgets automap
 static hu_textline_t  w_coordz; //jff 3/3/98 split coord widgets automap
+#ifdef RENDER_PROFILE
+static hu_textline_t  w_profile[NUMPROFILELINES];
+#endif
+#ifdef ZONE_PROFILE
+static hu_textline_t  w_zone[NUMZONELINES];
+#endif
 static hu_textline_t  w_ammo;   //jff 2/16/98 new ammo widget for hud
 static hu_textline_t  w_health; //jff 2/16/98 new health widget for hud
 static hu_textline_t  w_armor;  //jff 2/16/98 new armor widget for hud
@@ -576,6 +595,32 @@ void HU_Start(void)
     hudcolor_xyco
   );
 
+#ifdef RENDER_PROFILE
+  for (i = 0; i < NUMPROFILELINES; i++)
+    HUlib_initTextLine
+    (
+      &w_profile[i],
+      HU_PROFILEX,
+      HU_PROFILEY(i),
+      hu_font,
+      HU_FONTSTART,
+      hudcolor_xyco
+    );
+#endif
+
+#ifdef ZONE_PROFILE
+  for (i = 0; i < NUMZONELINES; i++)
+    HUlib_initTextLine
+    (
+      &w_zone[i],
+      HU_PROFILEX,
+      HU_ZONEY(i),
+      hu_font,
+      HU_FONTSTART,
+      hudcolor_xyco
+    );
+#endif
+
   // initialize the automaps coordinate widget
   //jff 3/3/98 split coordstr widget into 3 parts
   if (map_point_coordinates)
@@ -763,13 +808,67 @@ void HU_Drawer(void)
     }
   }
 
+#ifdef RENDER_PROFILE
+  {
+    int i;
+
+    for (i = 0; i < NUMPROFILELINES; i++)
+    {
+      const char *p = R_ProfileLine(i);
+
+      HUlib_clearTextLine(&w_profile[i]);
+      while (*p)
+        HUlib_addCharToTextLine(&w_profile[i], *(p++));
+      HUlib_drawTextLine(&w_profile[i], FALSE);
+    }
+  }
+#endif
+
+#ifdef ZONE_PROFILE
+  {
+    static const char *const tagnames[NUMZONELINES-2] = {
+      "STATIC", "SOUND", "MUSIC", "LEVEL", "LEVSPEC", "CACHE"
+    };
+    char line[40];
+    int i;
+
+    for (i = 0; i < NUMZONELINES; i++)
+    {
+      const char *p = line;
+
+      if (i == NUMZONELINES-2)
+        sprintf(line, "ZONE %uK", (unsigned)(Z_GetSystemBytes() >> 10));
+      else if (i == NUMZONELINES-1)
+      {
+        const zframestats_t *frame = Z_GetFrameStats();
+
+        sprintf(line, "FRAME %u ALLOCS %uK", frame->allocs,
+                (unsigned)(frame->bytes >> 10));
+      }
+      else
+      {
+        const ztagstats_t *stats = Z_GetTagStats(PU_STATIC + i);
+
+        sprintf(line, "%-7s %6uK %5u PEAK %6uK", tagnames[i],
+                (unsigned)(stats->bytes >> 10), stats->blocks,
+                (unsigned)(stats->peak >> 10));
+      }
+
+      HUlib_clearTextLine(&w_zone[i]);
+      while (*p)
+        HUlib_addCharToTextLine(&w_zone[i], *(p++));
+      HUlib_drawTextLine(&w_zone[i], FALSE);
+    }
+  }
+#endif
+
   // draw the weapon/health/ammo/armor/kills/keys displays if optioned
   //jff 2/17/98 allow new hud stuff to be turned off
   // killough 2/21/98: really allow new hud stuff to be turned off COMPLETELY
   if
   (
     hud_mode!=hud_off &&             // hud on from fullscreen key
-    viewheight==SCREENHEIGHT &&      // fullscreen mode is active
+    scaledviewheight==SCREENHEIGHT && // fullscreen mode is active
     !(automapmode & am_active)       // automap is not active
   )
   {
@@ -1280,11 +1379,10 @@ void HU_Drawer(void)
 //
 void HU_Erase(void)
 {
-  // erase the message display or the message review display
-  if (!message_list)
-    HUlib_eraseSText(&w_message);
-  else
-    HUlib_eraseMText(&w_rtext);
+  // erase the message display and the message review display; either may
+  // have just been switched off
+  HUlib_eraseSText(&w_message);
+  HUlib_eraseMText(&w_rtext);
 
   // erase the interactive text buffer for chat entry
   HUlib_eraseIText(&w_chat);
@@ -1315,6 +1413,7 @@ void HU_Ticker(void)
     message_nottobefuckedwith = FALSE;
   }
   if (bsdown && bscounter++ > 9) {
+    screen_dirty = TRUE;
     HUlib_keyInIText(&w_chat, (unsigned char)key_backspace);
     bscounter = 8;
   }
@@ -1355,6 +1454,7 @@ void HU_Ticker(void)
       if (i != consoleplayer
           && (c = players[i].cmd.chatchar))
       {
+        screen_dirty = TRUE;
         if (c <= HU_BROADCAST)
           chat_dest[i] = c;
         else
@@ -0,0 +1,64 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Job system: a small pool of worker threads for work that can be
+ *      split into independent pieces. Jobs are queued on a task group
+ *      and I_JobWait returns once all of them have run, the waiting
+ *      thread running queued jobs itself meanwhile. With no workers
+ *      (the default, or without PRBOOM_THREADS) every job runs at once
+ *      on the thread queuing it, so results never depend on the pool.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#ifndef __I_JOBS__
+#define __I_JOBS__
+
+#define MAX_JOB_THREADS 8
+
+// Jobs queued since the group was initialised and not yet finished
+typedef struct
+{
+  int pending;
+} i_jobgroup_t;
+
+// Sets how many threads run jobs, the calling thread included; 0 or 1
+// runs everything on the calling thread. Only call it with no jobs
+// queued.
+void I_SetJobThreads(int count);
+int I_JobThreads(void);
+
+void I_JobGroupInit(i_jobgroup_t *group);
+void I_JobRun(i_jobgroup_t *group, void (*func)(void *), void *arg);
+void I_JobWait(i_jobgroup_t *group);
+
+// Calls func(arg, i) for every i below count, spread over the pool,
+// and returns when all calls are done
+void I_JobParallelFor(int count, void (*func)(void *, int), void *arg);
+
+#endif
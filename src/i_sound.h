@@ -88,6 +88,9 @@ void I_ShutdownMusic(void);
 
 void I_UpdateMusic(void);
 
+// Renders music ahead on a thread of its own, where threads are built in
+void I_SetMusicThread(dbool on);
+
 // Volume.
 void I_SetMusicVolume(int volume);
 
@@ -115,5 +118,8 @@ void I_UnRegisterSong(int handle);
 
 // CPhipps - put these in config file
 extern int snd_samplerate;
+// Rate the mixer and the music players output at; set before I_InitSound
+// and I_InitMusic, and not changed after
+extern int snd_outputrate;
 
 #endif
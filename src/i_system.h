@@ -43,6 +43,16 @@ fixed_t I_GetTimeFrac (void);
 #endif
 void I_GetTime_SaveMS(void);
 
+/* Microsecond clock for profiling; 0 if the platform has none */
+int64_t I_GetTimeUS(void);
+
+#ifdef RENDER_PROFILE
+/* The frontend's performance counters, by number. The name has to stay
+ * valid: the counter is registered under it when first started. */
+void I_PerfStart(int counter, const char *name);
+void I_PerfStop(int counter);
+#endif
+
 unsigned long I_GetRandomTimeSeed(void); /* cphipps */
 
 void I_uSleep(unsigned long usecs);
@@ -0,0 +1,73 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Minimal system thread interface: threads, mutexes and condition
+ *      variables. Only built with PRBOOM_THREADS; without it every call is
+ *      a no-op and I_ThreadCreate always fails, so callers fall back to
+ *      running everything on the calling thread.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#ifndef __I_THREAD__
+#define __I_THREAD__
+
+#include <boolean.h>
+
+/* Storage class for state that must be private to each renderer thread */
+#ifdef PRBOOM_THREADS
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+#else
+#define THREAD_LOCAL
+#endif
+
+typedef struct i_thread_s i_thread_t;
+typedef struct i_mutex_s  i_mutex_t;
+typedef struct i_cond_s   i_cond_t;
+
+i_thread_t *I_ThreadCreate(void (*func)(void *), void *arg);
+void I_ThreadJoin(i_thread_t *thread);
+
+i_mutex_t *I_MutexCreate(void);
+void I_MutexDestroy(i_mutex_t *mutex);
+void I_MutexLock(i_mutex_t *mutex);
+void I_MutexUnlock(i_mutex_t *mutex);
+
+i_cond_t *I_CondCreate(void);
+void I_CondDestroy(i_cond_t *cond);
+void I_CondWait(i_cond_t *cond, i_mutex_t *mutex);
+void I_CondSignal(i_cond_t *cond);
+void I_CondBroadcast(i_cond_t *cond);
+
+int I_NumCPUs(void);
+
+#endif
@@ -56,4 +56,11 @@ void I_FinishUpdate (void);
  */
 void I_StartTic (void);
 
+/* I_LateInput
+ * Called by D_Display just before the player view is drawn, with
+ * late_input set: reads the mouse again, so what it moved since
+ * I_StartTic turns this frame's view instead of the next one's.
+ */
+void I_LateInput (void);
+
 #endif
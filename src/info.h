@@ -1270,14 +1270,17 @@ typedef enum
  * Definition of the state (frames) structure                       *
  ********************************************************************/
 
+/* Every state change reads one of these. The fields are ints rather
+ * than longs, which took twice the room on 64-bit Unix for no more range
+ * than they had on Windows. */
 typedef struct
 {
   spritenum_t sprite;       /* sprite number to show                       */
-  long        frame;        /* which frame/subframe of the sprite is shown */
-  long        tics;         /* number of gametics this frame should last   */
+  int         frame;        /* which frame/subframe of the sprite is shown */
+  int         tics;         /* number of gametics this frame should last   */
   actionf_t   action;       /* code pointer to function for action if any  */
   statenum_t  nextstate;    /* linked list pointer to next state or zero   */
-  long        misc1, misc2; /* apparently never used in DOOM               */
+  int         misc1, misc2; /* apparently never used in DOOM               */
 } state_t;
 
 /* these are in info.c */
@@ -61,30 +61,85 @@ static INLINE int D_abs(int x)
 }
 
 /*
- * Fixed Point Multiplication
+ * Fixed Point Multiplication and Division
+ *
+ * FixedMul_C and FixedDiv_C are the portable reference versions; every
+ * FixedMul/FixedDiv below must give the same bits for every input, or
+ * demos desync. -fixedcheck compares them (see D_CheckFixedMath).
+ *
+ * x86-64, AArch64 and MIPS compilers already turn the 64-bit C forms into a
+ * single imul/smull/dmult and a 64-bit divide, so they use the C versions.
+ * 32-bit x86 gets the imull/shrdl and idivl forms, and 32-bit ARM an smull,
+ * where the C forms go through wider arithmetic or a libgcc call.
  */
 
+#if defined(__GNUC__) && defined(__i386__)
+#define FIXED_ASM_I386
+#elif defined(__GNUC__) && defined(__arm__) && !defined(__thumb__) || \
+      defined(__GNUC__) && defined(__thumb2__)
+#define FIXED_ASM_ARM
+#endif
+
 /* CPhipps - made __inline__ to inline, as specified in the gcc docs
  * Also made const */
 
-static INLINE int FixedMul(int a, int b)
+static INLINE int FixedMul_C(int a, int b)
 {
   return (int)((int64_t) a*b >> FRACBITS);
 }
 
-/*
- * Fixed Point Division
- */
+static INLINE int FixedMul(int a, int b)
+{
+#if defined(FIXED_ASM_I386)
+  int result;
+
+  __asm__ ("imull %2\n\t"
+           "shrdl $16,%%edx,%%eax"
+           : "=a" (result)
+           : "0" (a), "rm" (b)
+           : "%edx", "cc");
+  return result;
+#elif defined(FIXED_ASM_ARM)
+  int lo, hi;
+
+  __asm__ ("smull %0, %1, %2, %3"
+           : "=&r" (lo), "=&r" (hi)
+           : "r" (a), "r" (b));
+  return (int)(((unsigned) lo >> FRACBITS) | ((unsigned) hi << (32-FRACBITS)));
+#else
+  return FixedMul_C(a, b);
+#endif
+}
 
 /* CPhipps - made __inline__ to inline, as specified in the gcc docs
  * Also made const */
 
-static INLINE int FixedDiv(int a, int b)
+static INLINE int FixedDiv_C(int a, int b)
 {
   return (D_abs(a)>>14) >= D_abs(b) ? ((a^b)>>31) ^ INT_MAX :
     (int)(((int64_t) a << FRACBITS) / b);
 }
 
+static INLINE int FixedDiv(int a, int b)
+{
+#if defined(FIXED_ASM_I386)
+  /* Past the overflow test the quotient fits in 31 bits, so idivl can't
+   * trap; INT_MIN slips past it (D_abs(INT_MIN) < 0) and stays in C. */
+  if ((D_abs(a)>>14) < D_abs(b) && a != INT_MIN)
+  {
+    int result;
+
+    __asm__ ("idivl %3"
+             : "=a" (result)
+             : "0" ((int)((unsigned) a << FRACBITS)), "d" (a >> (32-FRACBITS)),
+               "rm" (b)
+             : "cc");
+    return result;
+  }
+#endif
+  return FixedDiv_C(a, b);
+}
+
 /* CPhipps -
  * FixedMod - returns a % b, guaranteeing 0<=a<b
  * (notice that the C standard for % does not guarantee this)
@@ -0,0 +1,185 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      LZ77 block codec. A block is a run of sequences, each a token byte
+ *      (literal count in the high nibble, match length less LZ_MINMATCH
+ *      in the low, 15 in either followed by bytes adding to it until one
+ *      is under 255), the literals, and a 16-bit little endian offset back
+ *      to the match. The last sequence has literals only. Matches are
+ *      found through a hash table of the last place each 4 bytes were
+ *      seen, which is quick rather than thorough.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "z_zone.h"
+#include "m_lz.h"
+
+#define LZ_MINMATCH  4
+#define LZ_HASHBITS  12
+#define LZ_MAXOFFSET 65535
+// Matches stop short of the end of the block, so what is left of it
+// goes out as the closing literals
+#define LZ_LASTLITERALS 5
+
+size_t M_LZBound(size_t len)
+{
+  return len + len / 255 + 16;
+}
+
+static uint32_t M_LZRead32(const uint8_t *p)
+{
+  uint32_t v;
+
+  memcpy(&v, p, sizeof v);
+  return v;
+}
+
+static unsigned M_LZHash(uint32_t v)
+{
+  return (v * 2654435761u) >> (32 - LZ_HASHBITS);
+}
+
+// The bytes carrying a count of 15 or more on from its nibble
+static uint8_t *M_LZWriteCount(uint8_t *op, size_t n)
+{
+  for (n -= 15; n >= 255; n -= 255)
+    *op++ = 255;
+  *op++ = (uint8_t)n;
+  return op;
+}
+
+static uint8_t *M_LZWriteLiterals(uint8_t *op, uint8_t *token,
+    const uint8_t *literals, size_t count)
+{
+  *token = (uint8_t)((count < 15 ? count : 15) << 4);
+  if (count >= 15)
+    op = M_LZWriteCount(op, count);
+  memcpy(op, literals, count);
+  return op + count;
+}
+
+size_t M_LZCompress(const uint8_t *src, size_t len, uint8_t *dst)
+{
+  uint32_t table[1 << LZ_HASHBITS];
+  const uint8_t *ip = src, *anchor = src, *end = src + len;
+  const uint8_t *limit = len > LZ_LASTLITERALS + LZ_MINMATCH ?
+    end - LZ_LASTLITERALS - LZ_MINMATCH : src;
+  uint8_t *op = dst, *token;
+
+  memset(table, 0, sizeof table);
+
+  while (ip < limit)
+  {
+    uint32_t seq = M_LZRead32(ip);
+    unsigned h = M_LZHash(seq);
+    const uint8_t *ref = src + table[h];
+
+    table[h] = (uint32_t)(ip - src);
+    if (ref < ip && ip - ref <= LZ_MAXOFFSET && M_LZRead32(ref) == seq)
+    {
+      size_t offset = ip - ref, match = LZ_MINMATCH;
+
+      while (ip + match < end - LZ_LASTLITERALS && ref[match] == ip[match])
+        match++;
+
+      token = op++;
+      op = M_LZWriteLiterals(op, token, anchor, ip - anchor);
+      *op++ = (uint8_t)offset;
+      *op++ = (uint8_t)(offset >> 8);
+      match -= LZ_MINMATCH;
+      *token |= match < 15 ? match : 15;
+      if (match >= 15)
+        op = M_LZWriteCount(op, match);
+
+      ip += match + LZ_MINMATCH;
+      anchor = ip;
+    }
+    else
+      ip++;
+  }
+
+  token = op++;
+  op = M_LZWriteLiterals(op, token, anchor, end - anchor);
+  return op - dst;
+}
+
+// Adds the bytes after a nibble of 15 to n; false if src runs out
+static int M_LZReadCount(const uint8_t **ip, const uint8_t *end, size_t *n)
+{
+  unsigned b;
+
+  do
+  {
+    if (*ip >= end)
+      return 0;
+    *n += b = *(*ip)++;
+  } while (b == 255);
+  return 1;
+}
+
+long M_LZDecompress(const uint8_t *src, size_t len, uint8_t *dst, size_t size)
+{
+  const uint8_t *ip = src, *end = src + len;
+  uint8_t *op = dst, *oend = dst + size;
+
+  while (ip < end)
+  {
+    unsigned token = *ip++;
+    size_t literals = token >> 4, match = (token & 15) + LZ_MINMATCH, offset;
+    const uint8_t *ref;
+
+    if (literals == 15 && !M_LZReadCount(&ip, end, &literals))
+      return -1;
+    if (literals > (size_t)(end - ip) || literals > (size_t)(oend - op))
+      return -1;
+    memcpy(op, ip, literals);
+    op += literals;
+    ip += literals;
+    if (ip == end)
+      break;  // the closing literals
+
+    if (end - ip < 2)
+      return -1;
+    offset = ip[0] | ip[1] << 8;
+    ip += 2;
+    if (!offset || offset > (size_t)(op - dst))
+      return -1;
+    if ((token & 15) == 15 && !M_LZReadCount(&ip, end, &match))
+      return -1;
+    if (match > (size_t)(oend - op))
+      return -1;
+
+    // byte by byte, as a match may overlap what it copies
+    for (ref = op - offset; match--; )
+      *op++ = *ref++;
+  }
+  return op - dst;
+}
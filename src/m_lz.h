@@ -0,0 +1,52 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      A small, fast LZ77 block codec in the manner of LZ4, for data the
+ *      port writes and reads back itself, such as savegames.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#ifndef __M_LZ__
+#define __M_LZ__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Most that M_LZCompress can write for len bytes
+size_t M_LZBound(size_t len);
+
+// Compresses len bytes of src into dst, which has room for M_LZBound(len),
+// and returns the compressed length
+size_t M_LZCompress(const uint8_t *src, size_t len, uint8_t *dst);
+
+// Decompresses into dst, which has room for size bytes, and returns the
+// length decompressed, or -1 if src is damaged or doesn't fit
+long M_LZDecompress(const uint8_t *src, size_t len, uint8_t *dst, size_t size);
+
+#endif
@@ -863,6 +863,8 @@ void M_ReadSaveStrings(void)
 {
   int i;
 
+  G_FinishSaveGame(TRUE); // not a file still being written
+
   for (i = 0 ; i < load_end ; i++) {
     char name[PATH_MAX+1];    // killough 3/22/98
     RFILE *fp;
@@ -2965,7 +2967,7 @@ enum {
 #define G_YC2 (G_YC+6)
 #define G_YC3 (G_YC2+6)
 
-static const char *renderfilters[] = {"none", "point", "linear", "rounded", NULL};
+static const char *renderfilters[] = {"none", "point", "linear", "rounded", "mipmap", NULL};
 static const char *edgetypes[] = {"jagged", "sloped", NULL};
 
 setup_menu_t gen_settings3[] = { // General Settings screen2
@@ -5069,8 +5071,18 @@ void M_StartControlPanel (void)
 
 void M_Drawer (void)
 {
+  static short oldskull = -1;
+
   inhelpscreens = FALSE;
 
+  // everything else on the menus changes with input; the skull (and the
+  // text blinking with it) changes on tics
+  if ((messageToPrint || menuactive) && whichSkull != oldskull)
+  {
+    oldskull = whichSkull;
+    screen_dirty = TRUE;
+  }
+
   // Horiz. & Vertically center string and print it.
   // killough 9/29/98: simplified code, removed 40-character width limit
   if (messageToPrint)
@@ -85,6 +85,9 @@ extern int warning_about_changes, print_warning_about_changes;
 extern dbool   menu_background;
 extern dbool   r_wiggle_fix;
 
+// Set to have the frontend shut the core down
+extern dbool   quit_pressed;
+
 /****************************
  *
  *  The following #defines are for the m_flags field of each item on every
@@ -64,10 +64,22 @@
 #include "sounds.h"
 #include "lprintf.h"
 #include "d_main.h"
+#include "d_net.h"
 #include "r_draw.h"
+#include "r_drawlist.h"
+#include "r_plane.h"
+#include "r_things.h"
+#include "r_profile.h"
+#include "r_patchcache.h"
+#include "r_pvs.h"
 #include "r_demo.h"
 #include "r_fps.h"
 #include "r_sky.h"
+#include "p_map.h"
+#include "p_tick.h"
+#include "d_bench.h"
+#include "i_jobs.h"
+#include "r_main.h"
 
 #ifdef _WIN32
    #define DIR_SLASH_STR "\\"
@@ -198,6 +210,20 @@ default_t defaults[] =
    def_int,ss_none, NULL, NULL}, // 1=take special steps ensuring demo sync, 2=only during recordings
   {"level_precache",{(int*)&precache, NULL},{0, NULL},0,1,
    def_bool,ss_none, NULL, NULL}, // precache level data?
+  {"blockmap_sight",{&blockmap_sight, NULL},{0, NULL},0,1,
+   def_bool,ss_none, NULL, NULL}, // sight checks walk the blockmap, not the BSP
+  {"sight_precompute",{&sight_precompute, NULL},{0, NULL},0,1,
+   def_bool,ss_none, NULL, NULL}, // trace monsters' sight checks on the job pool
+  {"autotune_render_threads",{&autotune_render_threads, NULL},{-1, NULL},-1,MAX_RENDER_THREADS,
+   def_int,ss_none, NULL, NULL}, // render threads -autotune picked, -1 if never run
+  {"autotune_job_threads",{&autotune_job_threads, NULL},{-1, NULL},-1,MAX_JOB_THREADS,
+   def_int,ss_none, NULL, NULL}, // job threads -autotune picked, -1 if never run
+  {"mobj_parking",{&mobj_parking, NULL},{1, NULL},0,1,
+   def_bool,ss_none, NULL, NULL}, // idle things skip their thinker until woken
+  {"level_precache_budget",{&precache_budget, NULL},{2000, NULL},0,100000,
+   def_int,ss_none, NULL, NULL}, // microseconds of each frame spent precaching
+  {"level_precache_tics",{&precache_tics, NULL},{35, NULL},0,35*60,
+   def_int,ss_none, NULL, NULL}, // tics before the rest is precached at once
   {"demo_smoothturns", {&demo_smoothturns, NULL},  {0, NULL},0,1,
    def_bool,ss_gen, NULL, NULL},
   {"demo_smoothturnsfactor", {&demo_smoothturnsfactor, NULL},  {6, NULL},1,SMOOTH_PLAYING_MAXFACTOR,
@@ -306,9 +332,9 @@ default_t defaults[] =
   {"uncapped_framerate", {&movement_smooth, NULL},  {3, NULL},0,16,
    def_int,ss_gen, NULL, NULL},
   {"filter_wall",{(int*)&drawvars.filterwall, NULL},{RDRAW_FILTER_POINT, NULL},
-   RDRAW_FILTER_POINT, RDRAW_FILTER_ROUNDED, def_int,ss_gen, NULL, NULL},
+   RDRAW_FILTER_POINT, RDRAW_FILTER_MIPMAP, def_int,ss_gen, NULL, NULL},
   {"filter_floor",{(int*)&drawvars.filterfloor, NULL},{RDRAW_FILTER_POINT, NULL},
-   RDRAW_FILTER_POINT, RDRAW_FILTER_ROUNDED, def_int,ss_gen, NULL, NULL},
+   RDRAW_FILTER_POINT, RDRAW_FILTER_MIPMAP, def_int,ss_gen, NULL, NULL},
   {"filter_sprite",{(int*)&drawvars.filtersprite, NULL},{RDRAW_FILTER_POINT, NULL},
    RDRAW_FILTER_POINT, RDRAW_FILTER_ROUNDED, def_int,ss_gen, NULL, NULL},
   {"filter_z",{(int*)&drawvars.filterz, NULL},{RDRAW_FILTER_POINT, NULL},
@@ -321,6 +347,30 @@ default_t defaults[] =
    RDRAW_MASKEDCOLUMNEDGE_SQUARE, RDRAW_MASKEDCOLUMNEDGE_SLOPED, def_int,ss_gen, NULL, NULL},
   {"patch_edges",{(int*)&drawvars.patch_edges, NULL},{RDRAW_MASKEDCOLUMNEDGE_SQUARE, NULL},
    RDRAW_MASKEDCOLUMNEDGE_SQUARE, RDRAW_MASKEDCOLUMNEDGE_SLOPED, def_int,ss_gen, NULL, NULL},
+  {"render_column_major",{&drawvars.column_major, NULL},{0, NULL},0,1,
+   def_bool,ss_gen, NULL, NULL}, // draw the view column by column, then transpose it
+  {"render_deferred",{&render_deferred, NULL},{0, NULL},0,1,
+   def_bool,ss_gen, NULL, NULL}, // find everything visible before drawing any of it
+  {"render_parallel_planes",{&render_parallel_planes, NULL},{0, NULL},0,1,
+   def_bool,ss_gen, NULL, NULL}, // draw floors and ceilings on the job threads
+  {"render_parallel_masked",{&render_parallel_masked, NULL},{0, NULL},0,1,
+   def_bool,ss_gen, NULL, NULL}, // draw sprites in column bands on the job threads
+  {"render_heatmap",{&render_heatmap, NULL},{0, NULL},0,1,
+   def_bool,ss_gen, NULL, NULL}, // show overdraw in place of the view (profile builds)
+  {"render_pipelined",{&render_pipelined, NULL},{0, NULL},0,1,
+   def_bool,ss_gen, NULL, NULL}, // run the next tic while the view is filled
+  {"tic_catchup",{&tic_catchup, NULL},{1, NULL},1,8,
+   def_int,ss_gen, NULL, NULL}, // most tics a late frame runs to keep game speed
+  {"tic_skipframes",{&tic_skipframes, NULL},{0, NULL},0,1,
+   def_bool,ss_gen, NULL, NULL}, // leave every other frame undrawn while behind
+  {"render_pvs",{&render_pvs, NULL},{0, NULL},0,1,
+   def_bool,ss_gen, NULL, NULL}, // skip sectors that can't be seen from the view sector
+  {"build_reject",{&build_reject, NULL},{0, NULL},0,1,
+   def_bool,ss_gen, NULL, NULL}, // fill an empty REJECT from the sector visibility sets
+  {"patch_cache",{&patch_cache, NULL},{0, NULL},0,1,
+   def_bool,ss_gen, NULL, NULL}, // keep converted patches in the save directory
+  {"wad_dir_cache",{&wad_dir_cache, NULL},{1, NULL},0,1,
+   def_bool,ss_gen, NULL, NULL}, // keep the sorted lump directory in the save directory
   {"render_stretchsky",{&r_stretchsky, NULL},{1, NULL},0,1,
    def_bool,ss_gen,NULL, NULL},
   {"r_wiggle_fix",{(int*)&r_wiggle_fix, NULL},{1, NULL},0,1,
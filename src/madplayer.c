@@ -60,6 +60,7 @@ const music_player_t mp_player =
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL
 };
 
@@ -90,9 +91,24 @@ static const void *mp_data;
 static int mp_len;
 
 
-static int mp_leftoversamps = 0; // number of extra samples
-                                 // left over in mad decoder
-static int mp_leftoversamppos = 0;
+// Decoded audio is resampled to the output rate into a ring as each MP3
+// frame comes out of mad, and rendering copies from there. The ring is
+// kept topped up a frame at a time, so the decode cost is spread evenly
+// instead of landing on whichever render call crosses a frame boundary.
+#define MP_AHEAD_MS 300                 // how far ahead to decode
+#define MP_MAXFRAME 1152                // largest MP3 frame, in samples
+
+static short   *mp_ring;
+static unsigned mp_ringsize;            // in stereo samples
+static unsigned mp_ringread;
+static unsigned mp_ringcount;
+static unsigned mp_ahead;               // top up to this many samples
+static int      mp_eof;                 // no more frames; drain the ring
+
+// resampler state, carried across frames
+static unsigned mp_step;                // input samples per output, 16.16
+static unsigned mp_frac;
+static short    mp_last[2];             // last input sample of the previous frame
 
 
 static const char *mp_name (void)
@@ -108,7 +124,13 @@ static int mp_init (int samplerate)
   mad_synth_init (&Synth);
   mad_header_init (&Header);
   mp_samplerate_target = samplerate;
-  return 1;
+
+  // room for the lookahead, one frame upsampled from as low as 8000hz,
+  // and a render call's worth of underrun
+  mp_ahead = samplerate * MP_AHEAD_MS / 1000;
+  mp_ringsize = mp_ahead + MP_MAXFRAME * samplerate / 8000 + samplerate / 10;
+  mp_ring = malloc (mp_ringsize * 4);
+  return mp_ring != NULL;
 }
 
 static void mp_shutdown (void)
@@ -118,6 +140,8 @@ static void mp_shutdown (void)
   mad_frame_finish (&Frame);
   mad_stream_finish (&Stream);
   mad_header_finish (&Header);
+  free (mp_ring);
+  mp_ring = NULL;
 }
 
 static const void *mp_registersong (const void *data, unsigned len)
@@ -200,8 +224,12 @@ static void mp_play (const void *handle, int looping)
 
   mp_playing = 1;
   mp_looping = looping;
-  mp_leftoversamps = 0;
-  mp_leftoversamppos = 0;
+  mp_ringread = 0;
+  mp_ringcount = 0;
+  mp_eof = 0;
+  mp_step = ((unsigned) Header.samplerate << 16) / (unsigned) mp_samplerate_target;
+  mp_frac = 0;
+  mp_last[0] = mp_last[1] = 0; // avoid pop when first starting stream
 }
 
 static void mp_stop (void)
@@ -215,106 +243,151 @@ static INLINE short mp_fixtoshort (mad_fixed_t f)
   // clip
   if (f < -MAD_F_ONE)
     f = -MAD_F_ONE;
-  if (f > MAD_F_ONE)
-    f = MAD_F_ONE;    
-  // apply volume before conversion to 16bit
-  f /= 15;
-  f *= mp_volume;
+  if (f >= MAD_F_ONE)
+    f = MAD_F_ONE - 1;
   f >>= (MAD_F_FRACBITS - 15);
 
   return (short) f;
 }
 
-static void mp_render_ex (void *dest, unsigned nsamp)
+// Decode the next good MP3 frame. Returns 0 at the end of the song or
+// on an error it can't get past
+static int mp_decodeframe (void)
 {
-  short *sout = (short *) dest;
-
   int localerrors = 0;
 
+  while (mad_frame_decode (&Frame, &Stream) != 0)
+  {
+    if (MAD_RECOVERABLE (Stream.error))
+    { // unspecified problem with one frame.
+      // try the next frame, but bail if we get a bunch of crap in a row;
+      // likely indicates a larger problem (and if we don't bail, we could
+      // spend arbitrarily long amounts of time looking for the next good
+      // packet)
+      localerrors++;
+      if (localerrors == 10)
+      {
+        lprintf (LO_WARN, "mad_frame_decode: Lots of errors.  Most recent %s\n", mad_stream_errorstr (&Stream));
+        return 0;
+      }
+    }  
+    else if (Stream.error == MAD_ERROR_BUFLEN)
+    { // EOF
+      // FIXME: in order to not drop the last frame, there must be at least MAD_BUFFER_GUARD
+      // of extra bytes (with value 0) at the end of the file.  current implementation
+      // drops last frame
+      if (!mp_looping)
+        return 0;
+      // rewind, then go again
+      mad_stream_buffer (&Stream, mp_data, mp_len);
+    }
+    else
+    { // oh well.
+      lprintf (LO_WARN, "mad_frame_decode: Unrecoverable error %s\n", mad_stream_errorstr (&Stream));
+      return 0;
+    }
+  }
+
+  mad_synth_frame (&Synth, &Frame);
+  return 1;
+}
+
+// Decode a frame and resample it onto the end of the ring
+static void mp_fillframe (void)
+{
+  const mad_fixed_t *left, *right;
+  unsigned length, pos, w;
+  short in[2][MP_MAXFRAME + 1];
+  unsigned i;
+
+  if (!mp_decodeframe ())
+  {
+    mp_eof = 1;
+    return;
+  }
+
+  // if mono, just duplicate the first channel again
+  left   = Synth.pcm.samples[0];
+  right  = Synth.pcm.channels == 2 ? Synth.pcm.samples[1] : left;
+  length = Synth.pcm.length;
+
+  // in[][0] is the previous frame's last sample, to interpolate across the seam
+  in[0][0] = mp_last[0];
+  in[1][0] = mp_last[1];
+  for (i = 0; i < length; i++)
+  {
+    in[0][i + 1] = mp_fixtoshort (left[i]);
+    in[1][i + 1] = mp_fixtoshort (right[i]);
+  }
+  mp_last[0] = in[0][length];
+  mp_last[1] = in[1][length];
+
+  w = (mp_ringread + mp_ringcount) % mp_ringsize;
+  for (pos = mp_frac; (pos >> 16) < length; pos += mp_step)
+  {
+    unsigned j = pos >> 16, f = pos & 0xffff;
+
+    mp_ring[w * 2 + 0] = (in[0][j] * (int) (0x10000 - f) + in[0][j + 1] * (int) f) >> 16;
+    mp_ring[w * 2 + 1] = (in[1][j] * (int) (0x10000 - f) + in[1][j + 1] * (int) f) >> 16;
+    if (++w == mp_ringsize)
+      w = 0;
+    mp_ringcount++;
+  }
+  mp_frac = pos - (length << 16);
+}
+
+static void mp_render (void *dest, unsigned nsamp)
+{
+  short *sout = (short *) dest;
+
   if (!mp_playing || mp_paused)
   {
     memset (dest, 0, nsamp * 4);
     return;
   }
 
-  while (1)
+  // keep each pass within what the ring holds
+  while (nsamp > mp_ahead)
   {
-    // write any leftover data from last MP3 frame
-    while (mp_leftoversamps > 0 && nsamp > 0)
-    {
-      short s = mp_fixtoshort (Synth.pcm.samples[0][mp_leftoversamppos]);
-      *sout++ = s;
-      if (Synth.pcm.channels == 2)
-        s = mp_fixtoshort (Synth.pcm.samples[1][mp_leftoversamppos]);
-      // if mono, just duplicate the first channel again
-      *sout++ = s;
-
-      mp_leftoversamps -= 1;
-      mp_leftoversamppos += 1;
-      nsamp -= 1;
-    }
-    if (nsamp == 0)
-      return; // done
-    
-    // decode next valid MP3 frame
-    while (mad_frame_decode (&Frame, &Stream) != 0)
-    {
-      if (MAD_RECOVERABLE (Stream.error))
-      { // unspecified problem with one frame.
-        // try the next frame, but bail if we get a bunch of crap in a row;
-        // likely indicates a larger problem (and if we don't bail, we could
-        // spend arbitrarily long amounts of time looking for the next good
-        // packet)
-        localerrors++;
-        if (localerrors == 10)
-        {
-          lprintf (LO_WARN, "mad_frame_decode: Lots of errors.  Most recent %s\n", mad_stream_errorstr (&Stream));
-          mp_playing = 0;
-          memset (sout, 0, nsamp * 4);
-          return;
-        }
-      }  
-      else if (Stream.error == MAD_ERROR_BUFLEN)
-      { // EOF
-        // FIXME: in order to not drop the last frame, there must be at least MAD_BUFFER_GUARD
-        // of extra bytes (with value 0) at the end of the file.  current implementation
-        // drops last frame
-        if (mp_looping)
-        { // rewind, then go again
-          mad_stream_buffer (&Stream, mp_data, mp_len);
-          continue;
-        }
-        else
-        { // stop
-          mp_playing = 0;
-          memset (sout, 0, nsamp * 4);
-          return;
-        }
-      }
-      else
-      { // oh well.
-        lprintf (LO_WARN, "mad_frame_decode: Unrecoverable error %s\n", mad_stream_errorstr (&Stream));
-        mp_playing = 0;
-        memset (sout, 0, nsamp * 4);
-        return;
-      }
-    }
+    mp_render (sout, mp_ahead);
+    sout += mp_ahead * 2;
+    nsamp -= mp_ahead;
+  }
 
-    // got a good frame, so synth it and dispatch it.
-    mad_synth_frame (&Synth, &Frame);
-    mp_leftoversamps = Synth.pcm.length;
-    mp_leftoversamppos = 0;
+  // only decode inline what this call can't do without
+  while (mp_ringcount < nsamp && !mp_eof)
+    mp_fillframe ();
 
+  while (nsamp > 0 && mp_ringcount > 0)
+  {
+    unsigned n = mp_ringsize - mp_ringread;
+    const short *src = mp_ring + mp_ringread * 2;
+    unsigned i;
+
+    if (n > mp_ringcount)
+      n = mp_ringcount;
+    if (n > nsamp)
+      n = nsamp;
+
+    // apply volume on the way out, so changes aren't held up by the lookahead
+    for (i = 0; i < n * 2; i++)
+      *sout++ = src[i] * mp_volume / 15;
+
+    mp_ringread = (mp_ringread + n) % mp_ringsize;
+    mp_ringcount -= n;
+    nsamp -= n;
   }
-  // NOT REACHED
-}
 
-void I_ResampleStream (void *dest, unsigned nsamp, void (*proc)(void *dest, unsigned nsamp),
-      unsigned sratein, unsigned srateout);
+  if (nsamp > 0)
+  { // song is over
+    mp_playing = 0;
+    memset (sout, 0, nsamp * 4);
+    return;
+  }
 
-static void mp_render (void *dest, unsigned nsamp)
-{ 
-  I_ResampleStream (dest, nsamp, mp_render_ex, Header.samplerate, mp_samplerate_target);
+  // then one more frame towards the lookahead
+  if (mp_ringcount < mp_ahead && !mp_eof)
+    mp_fillframe ();
 }
 
 
@@ -330,7 +403,8 @@ const music_player_t mp_player =
   mp_unregistersong,
   mp_play,
   mp_stop,
-  mp_render
+  mp_render,
+  NULL
 };
 
 #endif // HAVE_LIBMAD
@@ -105,9 +105,12 @@ struct midi_file_s
     midi_track_t *tracks;
     unsigned int num_tracks;
 
-    // Data buffer used to store data read for SysEx or meta events:
+    // Data buffer used to store data read for SysEx or meta events.
+    // It is sized to the whole file up front, so the events can point
+    // straight into it and nothing is allocated per event:
     unsigned char *buffer;
     unsigned int buffer_size;
+    unsigned int buffer_used;
 };
 
 
@@ -133,13 +136,11 @@ static dbool   ReadByte(unsigned char *result, midimem_t *mf)
 
 static dbool   ReadMultipleBytes (void *dest, size_t len, midimem_t *mf)
 {
-  unsigned char *cdest = (unsigned char *) dest;
-  unsigned i;
-  for (i = 0; i < len; i++)
-  {
-    if (!ReadByte (cdest + i, mf))
-      return false;
-  }
+  if (len > mf->len - mf->pos)
+    return false;
+
+  memcpy (dest, mf->data + mf->pos, len);
+  mf->pos += len;
   return true;
 }
 
@@ -173,34 +174,26 @@ static dbool   ReadVariableLength(unsigned int *result, midimem_t *mf)
 
 // Read a byte sequence into the data buffer.
 
-static void *ReadByteSequence(unsigned int num_bytes, midimem_t *mf)
+static void *ReadByteSequence(midi_file_t *file, unsigned int num_bytes,
+                              midimem_t *mf)
 {
-    unsigned int i;
     unsigned char *result;
 
-    // events can be length 0.  malloc(0) is not portable (can return NULL)
-    if (!num_bytes)
-      return malloc (4);
-
-    // Allocate a buffer:
-
-    result = malloc(num_bytes);
+    // The buffer holds as many bytes as the whole file, so it can't run
+    // out before the input does
 
-    if (result == NULL)
-        return NULL;
-
-    // Read the data:
-
-    for (i=0; i<num_bytes; ++i)
+    if (num_bytes > mf->len - mf->pos)
     {
-        if (!ReadByte(&result[i], mf))
-        {
-            lprintf (LO_WARN, "ReadByteSequence: Error while reading byte %u\n", i);
-            free(result);
-            return NULL;
-        }
+        lprintf (LO_WARN, "ReadByteSequence: Error while reading %u bytes\n",
+                          num_bytes);
+        return NULL;
     }
 
+    result = file->buffer + file->buffer_used;
+    memcpy(result, mf->data + mf->pos, num_bytes);
+    mf->pos += num_bytes;
+    file->buffer_used += num_bytes;
+
     return result;
 }
 
@@ -249,8 +242,8 @@ static dbool   ReadChannelEvent(midi_event_t *event,
 
 // Read sysex event:
 
-static dbool   ReadSysExEvent(midi_event_t *event, int event_type,
-                               midimem_t *mf)
+static dbool   ReadSysExEvent(midi_file_t *file, midi_event_t *event,
+                              int event_type, midimem_t *mf)
 {
     event->event_type = event_type;
 
@@ -263,7 +256,7 @@ static dbool   ReadSysExEvent(midi_event_t *event, int event_type,
 
     // Read the byte sequence:
 
-    event->data.sysex.data = ReadByteSequence(event->data.sysex.length, mf);
+    event->data.sysex.data = ReadByteSequence(file, event->data.sysex.length, mf);
 
     if (event->data.sysex.data == NULL)
     {
@@ -276,7 +269,8 @@ static dbool   ReadSysExEvent(midi_event_t *event, int event_type,
 
 // Read meta event:
 
-static dbool   ReadMetaEvent(midi_event_t *event, midimem_t *mf)
+static dbool   ReadMetaEvent(midi_file_t *file, midi_event_t *event,
+                             midimem_t *mf)
 {
     unsigned char b = 0;
 
@@ -303,7 +297,7 @@ static dbool   ReadMetaEvent(midi_event_t *event, midimem_t *mf)
 
     // Read the byte sequence:
 
-    event->data.meta.data = ReadByteSequence(event->data.meta.length, mf);
+    event->data.meta.data = ReadByteSequence(file, event->data.meta.length, mf);
 
     if (event->data.meta.data == NULL)
     {
@@ -314,8 +308,8 @@ static dbool   ReadMetaEvent(midi_event_t *event, midimem_t *mf)
     return true;
 }
 
-static dbool ReadEvent(midi_event_t *event, unsigned int *last_event_type,
-                          midimem_t *mf)
+static dbool ReadEvent(midi_file_t *file, midi_event_t *event,
+                       unsigned int *last_event_type, midimem_t *mf)
 {
     unsigned char event_type = 0;
 
@@ -375,10 +369,10 @@ static dbool ReadEvent(midi_event_t *event, unsigned int *last_event_type,
     {
         case MIDI_EVENT_SYSEX:
         case MIDI_EVENT_SYSEX_SPLIT:
-            return ReadSysExEvent(event, event_type, mf);
+            return ReadSysExEvent(file, event, event_type, mf);
 
         case MIDI_EVENT_META:
-            return ReadMetaEvent(event, mf);
+            return ReadMetaEvent(file, event, mf);
 
         default:
             break;
@@ -388,30 +382,6 @@ static dbool ReadEvent(midi_event_t *event, unsigned int *last_event_type,
     return false;
 }
 
-// Free an event:
-
-static void FreeEvent(midi_event_t *event)
-{
-    // Some event types have dynamically allocated buffers assigned
-    // to them that must be freed.
-
-    switch (event->event_type)
-    {
-        case MIDI_EVENT_SYSEX:
-        case MIDI_EVENT_SYSEX_SPLIT:
-            free(event->data.sysex.data);
-            break;
-
-        case MIDI_EVENT_META:
-            free(event->data.meta.data);
-            break;
-
-        default:
-            // Nothing to do.
-            break;
-    }
-}
-
 // Read and check the track chunk header
 
 static dbool ReadTrackHeader(midi_track_t *track, midimem_t *mf)
@@ -436,7 +406,7 @@ static dbool ReadTrackHeader(midi_track_t *track, midimem_t *mf)
     return true;
 }
 
-static dbool ReadTrack(midi_track_t *track, midimem_t *mf)
+static dbool ReadTrack(midi_file_t *file, midi_track_t *track, midimem_t *mf)
 {
     midi_event_t *new_events = NULL;
     midi_event_t *event;
@@ -467,21 +437,23 @@ static dbool ReadTrack(midi_track_t *track, midimem_t *mf)
         if (track->num_events == track->num_event_mem)
         { // depending on the state of the heap and the malloc implementation, realloc()
           // one more event at a time can be VERY slow.  10sec+ in MSVC
-          track->num_event_mem += 100; 
+          // Start from a guess of one event per four bytes and grow geometrically
+          track->num_event_mem = track->num_event_mem ? track->num_event_mem * 2
+                                                      : track->data_len / 4 + 16;
           new_events = realloc (track->events, sizeof (midi_event_t) * track->num_event_mem);
-        }
 
-        if (new_events == NULL)
-        {
-            return false;
-        }
+          if (new_events == NULL)
+          {
+              return false;
+          }
 
-        track->events = new_events;
+          track->events = new_events;
+        }
 
         // Read the next event:
 
         event = &track->events[track->num_events];
-        if (!ReadEvent(event, &last_event_type, mf))
+        if (!ReadEvent(file, event, &last_event_type, mf))
         {
             return false;
         }
@@ -497,6 +469,14 @@ static dbool ReadTrack(midi_track_t *track, midimem_t *mf)
         }
     }
 
+    // Give back the slack from growing
+    new_events = realloc (track->events, sizeof (midi_event_t) * track->num_events);
+    if (new_events != NULL)
+    {
+        track->events = new_events;
+        track->num_event_mem = track->num_events;
+    }
+
     return true;
 }
 
@@ -504,13 +484,7 @@ static dbool ReadTrack(midi_track_t *track, midimem_t *mf)
 
 static void FreeTrack(midi_track_t *track)
 {
-    unsigned i;
-
-    for (i=0; i<track->num_events; ++i)
-    {
-        FreeEvent(&track->events[i]);
-    }
-
+    // Event payloads live in the file's buffer
     free(track->events);
 }
 
@@ -533,7 +507,7 @@ static dbool ReadAllTracks(midi_file_t *file, midimem_t *mf)
 
     for (i=0; i<file->num_tracks; ++i)
     {
-        if (!ReadTrack(&file->tracks[i], mf))
+        if (!ReadTrack(file, &file->tracks[i], mf))
         {
             return false;
         }
@@ -596,6 +570,7 @@ void MIDI_FreeFile(midi_file_t *file)
         free(file->tracks);
     }
 
+    free(file->buffer);
     free(file);
 }
 
@@ -612,8 +587,15 @@ midi_file_t *MIDI_LoadFile (midimem_t *mf)
 
     file->tracks = NULL;
     file->num_tracks = 0;
-    file->buffer = NULL;
-    file->buffer_size = 0;
+    file->buffer_size = mf->len ? mf->len : 1;
+    file->buffer_used = 0;
+    file->buffer = malloc(file->buffer_size);
+
+    if (file->buffer == NULL)
+    {
+        MIDI_FreeFile(file);
+        return NULL;
+    }
 
     // Read MIDI file header
 
@@ -928,10 +910,15 @@ midi_file_t *MIDI_LoadFileSpecial (midimem_t *mf)
   double opi;
 
   int epos = 0;
+  unsigned i, totalevents = 0;
 
   if (!base)
     return NULL;
 
+  // the flattened track never holds more events than the source did
+  for (i = 0; i < base->num_tracks; i++)
+    totalevents += base->tracks[i].num_events;
+
   flatlist = MIDI_GenerateFlatList (base);
   if (!flatlist)
   {
@@ -946,12 +933,13 @@ midi_file_t *MIDI_LoadFileSpecial (midimem_t *mf)
   ret->header.time_division = 10000;
   ret->num_tracks = 1;
   ret->buffer_size = 0;
+  ret->buffer_used = 0;
   ret->buffer = NULL;
   ret->tracks = malloc (sizeof (midi_track_t));
 
   ret->tracks->num_events = 0;
-  ret->tracks->num_event_mem = 0;
-  ret->tracks->events = NULL;
+  ret->tracks->num_event_mem = totalevents;
+  ret->tracks->events = malloc (sizeof (midi_event_t) * totalevents);
 
   opi = MIDI_spmc (base, NULL, 20000);
 
@@ -961,12 +949,6 @@ midi_file_t *MIDI_LoadFileSpecial (midimem_t *mf)
     midi_event_t *oldev;
     midi_event_t *nextev;
 
-    if (ret->tracks->num_events == ret->tracks->num_event_mem)
-    { 
-      ret->tracks->num_event_mem += 100; 
-      ret->tracks->events = realloc (ret->tracks->events, sizeof (midi_event_t) * ret->tracks->num_event_mem);
-    }
-
     oldev = flatlist[epos];
     nextev = ret->tracks->events + ret->tracks->num_events;
 
@@ -991,7 +973,7 @@ midi_file_t *MIDI_LoadFileSpecial (midimem_t *mf)
         nextev->event_type = MIDI_EVENT_META;
         nextev->data.meta.type = MIDI_META_TEXT;
         nextev->data.meta.length = 0;
-        nextev->data.meta.data = malloc (4);
+        nextev->data.meta.data = NULL;
         epos++;
         ret->tracks->num_events++;
         continue;
@@ -1001,7 +983,7 @@ midi_file_t *MIDI_LoadFileSpecial (midimem_t *mf)
         nextev->event_type = MIDI_EVENT_META;
         nextev->data.meta.type = MIDI_META_END_OF_TRACK;
         nextev->data.meta.length = 0;
-        nextev->data.meta.data = malloc (4);
+        nextev->data.meta.data = NULL;
         epos++;
         ret->tracks->num_events++;
         break;
@@ -82,6 +82,10 @@ typedef struct
   // s16 stereo, with samplerate as specified in init.  player needs to be able to handle
   // just about anything for nsamp.  render can be called even during pause+stop.
   void (*render)(void *dest, unsigned nsamp);
+
+  // whether a song started without looping is still going.  may be NULL,
+  // and then the player's songs can't be pre-rendered (see cacheplayer.h)
+  int (*playing)(void);
 } music_player_t;
 
 
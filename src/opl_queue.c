@@ -19,8 +19,11 @@
 // 02111-1307, USA.
 //
 // DESCRIPTION:
-//     Queue of waiting callbacks, stored in a binary min heap, so that we
-//     can always get the first callback.
+//     Queue of waiting callbacks, stored in a timer wheel, so that we
+//     can always get the first callback.  Each slot of the wheel holds
+//     the callbacks due in a short run of samples, sorted by time;
+//     callbacks due at the same time are run in the order they were
+//     queued.
 //
 //-----------------------------------------------------------------------------
 
@@ -32,16 +35,38 @@
 
 #define MAX_OPL_QUEUE 64
 
-typedef struct
+// Each slot covers 1 << OPL_WHEEL_SHIFT samples; the wheel wraps
+// after OPL_WHEEL_SLOTS slots, about a third of a second at 44.1kHz.
+// Callbacks further ahead share a slot with earlier ones and wait
+// their turn there.
+
+#define OPL_WHEEL_SHIFT 6
+#define OPL_WHEEL_SLOTS 256
+#define OPL_WHEEL_SLOT(time) (((time) >> OPL_WHEEL_SHIFT) & (OPL_WHEEL_SLOTS - 1))
+
+typedef struct opl_queue_entry_s opl_queue_entry_t;
+
+struct opl_queue_entry_s
 {
     opl_callback_t callback;
     void *data;
     unsigned int time;
-} opl_queue_entry_t;
+    opl_queue_entry_t *next;
+};
 
 struct opl_callback_queue_s
 {
     opl_queue_entry_t entries[MAX_OPL_QUEUE];
+    opl_queue_entry_t *free_entries;
+    opl_queue_entry_t *slots[OPL_WHEEL_SLOTS];
+
+    // The first callback to invoke, or NULL if the queue is empty.
+
+    opl_queue_entry_t *first;
+
+    // No callback in the queue is due before this time.
+
+    unsigned int cursor;
     int num_entries;
 };
 
@@ -50,7 +75,8 @@ opl_callback_queue_t *OPL_Queue_Create(void)
     opl_callback_queue_t *queue;
 
     queue = malloc(sizeof(opl_callback_queue_t));
-    queue->num_entries = 0;
+    queue->cursor = 0;
+    OPL_Queue_Clear(queue);
 
     return queue;
 }
@@ -67,64 +93,116 @@ int OPL_Queue_IsEmpty(opl_callback_queue_t *queue)
 
 void OPL_Queue_Clear(opl_callback_queue_t *queue)
 {
+    int i;
+
+    memset(queue->slots, 0, sizeof(queue->slots));
+
+    queue->free_entries = NULL;
+
+    for (i = MAX_OPL_QUEUE - 1; i >= 0; --i)
+    {
+        queue->entries[i].next = queue->free_entries;
+        queue->free_entries = &queue->entries[i];
+    }
+
+    queue->first = NULL;
     queue->num_entries = 0;
 }
 
+// Find the first callback due, after the previous one has been popped.
+
+static opl_queue_entry_t *FindFirst(opl_callback_queue_t *queue)
+{
+    opl_queue_entry_t *entry;
+    opl_queue_entry_t *result;
+    unsigned int slot;
+    int i;
+
+    if (queue->num_entries == 0)
+    {
+        return NULL;
+    }
+
+    // Walk the wheel from the cursor.  Each slot is sorted, so the first
+    // slot whose head falls in this turn of the wheel holds the answer.
+
+    slot = queue->cursor >> OPL_WHEEL_SHIFT;
+
+    for (i = 0; i < OPL_WHEEL_SLOTS; ++i, ++slot)
+    {
+        entry = queue->slots[slot & (OPL_WHEEL_SLOTS - 1)];
+
+        if (entry != NULL && (entry->time >> OPL_WHEEL_SHIFT) == slot)
+        {
+            return entry;
+        }
+    }
+
+    // Everything is at least a turn of the wheel away.
+
+    result = NULL;
+
+    for (i = 0; i < OPL_WHEEL_SLOTS; ++i)
+    {
+        entry = queue->slots[i];
+
+        if (entry != NULL && (result == NULL || entry->time < result->time))
+        {
+            result = entry;
+        }
+    }
+
+    return result;
+}
+
 void OPL_Queue_Push(opl_callback_queue_t *queue,
                     opl_callback_t callback, void *data,
                     unsigned int time)
 {
-    int entry_id;
-    int parent_id;
+    opl_queue_entry_t *entry;
+    opl_queue_entry_t **link;
 
-    if (queue->num_entries >= MAX_OPL_QUEUE)
+    if (queue->free_entries == NULL)
     {
         lprintf (LO_WARN, "OPL_Queue_Push: Exceeded maximum callbacks\n");
         return;
     }
 
-    // Add to last queue entry.
-
-    entry_id = queue->num_entries;
+    entry = queue->free_entries;
+    queue->free_entries = entry->next;
     ++queue->num_entries;
 
-    // Shift existing entries down in the heap.
+    entry->callback = callback;
+    entry->data = data;
+    entry->time = time;
 
-    while (entry_id > 0)
+    if (time < queue->cursor)
     {
-        parent_id = (entry_id - 1) / 2;
-
-        // Is the heap condition satisfied?
-
-        if (time >= queue->entries[parent_id].time)
-        {
-            break;
-        }
-
-        // Move the existing entry down in the heap.
+        queue->cursor = time;
+    }
 
-        memcpy(&queue->entries[entry_id],
-               &queue->entries[parent_id],
-               sizeof(opl_queue_entry_t));
+    // Insert after any callbacks due at the same time.
 
-        // Advance to the parent.
+    link = &queue->slots[OPL_WHEEL_SLOT(time)];
 
-        entry_id = parent_id;
+    while (*link != NULL && (*link)->time <= time)
+    {
+        link = &(*link)->next;
     }
 
-    // Insert new callback data.
+    entry->next = *link;
+    *link = entry;
 
-    queue->entries[entry_id].callback = callback;
-    queue->entries[entry_id].data = data;
-    queue->entries[entry_id].time = time;
+    if (queue->first == NULL || time < queue->first->time)
+    {
+        queue->first = entry;
+    }
 }
 
 int OPL_Queue_Pop(opl_callback_queue_t *queue,
                   opl_callback_t *callback, void **data)
 {
     opl_queue_entry_t *entry;
-    int child1, child2;
-    int i, next_i;
 
     // Empty?
 
@@ -133,66 +211,20 @@ int OPL_Queue_Pop(opl_callback_queue_t *queue,
         return 0;
     }
 
-    // Store the result:
+    // The first callback is always at the head of its slot.
 
-    *callback = queue->entries[0].callback;
-    *data = queue->entries[0].data;
+    entry = queue->first;
+    queue->slots[OPL_WHEEL_SLOT(entry->time)] = entry->next;
 
-    // Decrease the heap size, and keep pointer to the last entry in
-    // the heap, which must now be percolated down from the top.
+    *callback = entry->callback;
+    *data = entry->data;
 
+    entry->next = queue->free_entries;
+    queue->free_entries = entry;
     --queue->num_entries;
-    entry = &queue->entries[queue->num_entries];
-
-    // Percolate down.
-
-    i = 0;
-
-    for (;;)
-    {
-        child1 = i * 2 + 1;
-        child2 = i * 2 + 2;
-
-        if (child1 < queue->num_entries
-         && queue->entries[child1].time < entry->time)
-        {
-            // Left child is less than entry.
-            // Use the minimum of left and right children.
-
-            if (child2 < queue->num_entries
-             && queue->entries[child2].time < queue->entries[child1].time)
-            {
-                next_i = child2;
-            }
-            else
-            {
-                next_i = child1;
-            }
-        }
-        else if (child2 < queue->num_entries
-              && queue->entries[child2].time < entry->time)
-        {
-            // Right child is less than entry.  Go down the right side.
-
-            next_i = child2;
-        }
-        else
-        {
-            // Finished percolating.
-            break;
-        }
-
-        // Percolate the next value up and advance.
-
-        memcpy(&queue->entries[i],
-               &queue->entries[next_i],
-               sizeof(opl_queue_entry_t));
-        i = next_i;
-    }
-
-    // Store the old last-entry at its new position.
 
-    memcpy(&queue->entries[i], entry, sizeof(opl_queue_entry_t));
+    queue->cursor = entry->time;
+    queue->first = FindFirst(queue);
 
     return 1;
 }
@@ -200,7 +232,7 @@ int OPL_Queue_Pop(opl_callback_queue_t *queue,
 unsigned int OPL_Queue_Peek(opl_callback_queue_t *queue)
 {
     if (queue->num_entries > 0)
-        return queue->entries[0].time;
+        return queue->first->time;
 
     return 0;
 }
@@ -112,6 +112,30 @@ typedef struct
     unsigned int ms_per_beat;
 } opl_track_data_t;
 
+// A run of MUS events that play together, and the wait after them.
+
+typedef struct
+{
+    const byte *events;
+    unsigned int ms;
+} opl_mus_group_t;
+
+// A registered song: either a MIDI file, or a MUS lump played
+// directly from the lump data without a MIDI conversion.
+
+typedef struct
+{
+    midi_file_t *midi;
+
+    opl_mus_group_t *groups;
+    unsigned int num_groups;
+
+    // MIDI channel used for each MUS channel, allocated the way
+    // mus2mid does it.
+
+    int channel_map[MIDI_CHANNELS_PER_TRACK];
+} opl_song_t;
+
 typedef struct opl_voice_s opl_voice_t;
 
 struct opl_voice_s
@@ -324,6 +348,12 @@ static unsigned int num_tracks = 0;
 static unsigned int running_tracks = 0;
 static dbool song_looping;
 
+// MUS playback state:
+
+static const opl_song_t *mus_song;
+static unsigned int mus_group;
+static byte mus_velocities[MIDI_CHANNELS_PER_TRACK];
+
 // Configuration file variable, containing the port number for the
 // adlib chip.
 
@@ -1053,6 +1083,7 @@ static void ProcessEvent(opl_track_data_t *track, midi_event_t *event)
 }
 
 static void ScheduleTrack(opl_track_data_t *track);
+static void StartMusGroups(opl_track_data_t *track);
 
 // Restart a song from the beginning.
 
@@ -1074,6 +1105,12 @@ static void RestartSong(void)
     }
 
 
+    if (mus_song != NULL)
+    {
+        StartMusGroups(&tracks[0]);
+        return;
+    }
+
     for (i=0; i<num_tracks; ++i)
     {
         MIDI_RestartIterator(tracks[i].iter);
@@ -1138,6 +1175,272 @@ static void ScheduleTrack(opl_track_data_t *track)
     OPL_SetCallback(ms, TrackTimerCallback, track);
 }
 
+// MUS controller numbers to MIDI controllers, as in mus2mid.c.
+
+static const byte mus_controller_map[] =
+{
+    0x00, 0x20, 0x01, 0x07, 0x0A, 0x0B, 0x5B, 0x5D,
+    0x40, 0x43, 0x78, 0x7B, 0x7E, 0x7F, 0x79
+};
+
+#define MUS_PERCUSSION_CHAN 15
+#define MUS_TICKS_PER_SECOND 140
+
+// Play one group of MUS events straight from the lump.  The events
+// were checked when the song was registered.  Returns false at the
+// end of the score.
+
+static dbool ProcessMusGroup(opl_track_data_t *track, const byte *p)
+{
+    midi_event_t event;
+    byte desc;
+    unsigned int channel;
+    unsigned int value;
+
+    event.delta_time = 0;
+
+    do
+    {
+        desc = *p++;
+        channel = mus_song->channel_map[desc & 0x0f];
+        event.data.channel.channel = channel;
+
+        switch (desc & 0x70)
+        {
+            case 0x00: // release key
+                event.event_type = MIDI_EVENT_NOTE_OFF;
+                event.data.channel.param1 = *p++ & 0x7f;
+                event.data.channel.param2 = 0;
+                break;
+
+            case 0x10: // press key
+                value = *p++;
+                if (value & 0x80)
+                {
+                    mus_velocities[channel] = *p++ & 0x7f;
+                }
+                event.event_type = MIDI_EVENT_NOTE_ON;
+                event.data.channel.param1 = value & 0x7f;
+                event.data.channel.param2 = mus_velocities[channel];
+                break;
+
+            case 0x20: // pitch wheel
+                value = *p++ * 64;
+                event.event_type = MIDI_EVENT_PITCH_BEND;
+                event.data.channel.param1 = value & 0x7f;
+                event.data.channel.param2 = (value >> 7) & 0x7f;
+                break;
+
+            case 0x30: // system event
+                event.event_type = MIDI_EVENT_CONTROLLER;
+                event.data.channel.param1 = mus_controller_map[*p++];
+                event.data.channel.param2 = 0;
+                break;
+
+            case 0x40: // change controller
+                value = *p++;
+                if (value == 0)
+                {
+                    event.event_type = MIDI_EVENT_PROGRAM_CHANGE;
+                    event.data.channel.param1 = *p++ & 0x7f;
+                }
+                else
+                {
+                    event.event_type = MIDI_EVENT_CONTROLLER;
+                    event.data.channel.param1 = mus_controller_map[value];
+                    event.data.channel.param2 = *p & 0x80 ? 0x7f : *p;
+                    p++;
+                }
+                break;
+
+            default: // score end
+                return false;
+        }
+
+        ProcessEvent(track, &event);
+    } while (!(desc & 0x80));
+
+    return true;
+}
+
+// Callback function invoked when the next group of MUS events is due.
+
+static void MusTimerCallback(void *arg)
+{
+    opl_track_data_t *track = arg;
+    const opl_mus_group_t *group = &mus_song->groups[mus_group++];
+
+    if (!ProcessMusGroup(track, group->events))
+    {
+        --running_tracks;
+
+        if (running_tracks <= 0 && song_looping)
+        {
+            RestartSong();
+        }
+
+        return;
+    }
+
+    OPL_SetCallback(group->ms, MusTimerCallback, track);
+}
+
+static void StartMusGroups(opl_track_data_t *track)
+{
+    unsigned int i;
+
+    mus_group = 0;
+
+    for (i=0; i<MIDI_CHANNELS_PER_TRACK; ++i)
+    {
+        mus_velocities[i] = 127;
+    }
+
+    OPL_SetCallback(0, MusTimerCallback, track);
+}
+
+// Split a MUS lump into groups of simultaneous events and work out
+// the wait after each group.  The waits are taken from the running
+// tick count so that rounding to milliseconds does not drift.
+
+static dbool LoadMusSong(opl_song_t *song, const byte *data, unsigned len)
+{
+    const byte *p, *end;
+    unsigned int max_groups;
+    unsigned int ticks, delay;
+    unsigned int ms, last_ms;
+    int next_channel;
+    dbool scoreend;
+    byte desc;
+    int i;
+
+    song->groups = NULL;
+    song->num_groups = 0;
+
+    p = data + (data[6] | (data[7] << 8));
+    end = data + len;
+
+    if (p >= end)
+    {
+        return false;
+    }
+
+    // Every group takes at least two bytes.
+
+    max_groups = (unsigned int)(end - p) / 2 + 1;
+    song->groups = malloc(max_groups * sizeof(*song->groups));
+
+    for (i=0; i<MIDI_CHANNELS_PER_TRACK; ++i)
+    {
+        song->channel_map[i] = -1;
+    }
+    song->channel_map[MUS_PERCUSSION_CHAN] = 9;
+    next_channel = 0;
+
+    ticks = 0;
+    last_ms = 0;
+    scoreend = false;
+
+    while (!scoreend)
+    {
+        opl_mus_group_t *group = &song->groups[song->num_groups++];
+
+        group->events = p;
+
+        do
+        {
+            if (p >= end)
+            {
+                return false;
+            }
+
+            desc = *p++;
+
+            // Allocate MIDI channels in order of first use, skipping
+            // the percussion channel.
+
+            if (song->channel_map[desc & 0x0f] < 0)
+            {
+                if (next_channel == 9)
+                {
+                    ++next_channel;
+                }
+                song->channel_map[desc & 0x0f] = next_channel++;
+            }
+
+            switch (desc & 0x70)
+            {
+                case 0x00:
+                case 0x20:
+                    p++;
+                    break;
+
+                case 0x10:
+                    if (p < end && (*p & 0x80))
+                    {
+                        p++;
+                    }
+                    p++;
+                    break;
+
+                case 0x30:
+                    if (p >= end || *p < 10 || *p > 14)
+                    {
+                        return false;
+                    }
+                    p++;
+                    break;
+
+                case 0x40:
+                    if (p >= end || *p > 9)
+                    {
+                        return false;
+                    }
+                    p += 2;
+                    break;
+
+                case 0x60:
+                    scoreend = true;
+                    break;
+
+                default:
+                    return false;
+            }
+
+            if (p > end)
+            {
+                return false;
+            }
+        } while (!scoreend && !(desc & 0x80));
+
+        group->ms = 0;
+
+        if (scoreend)
+        {
+            break;
+        }
+
+        delay = 0;
+
+        do
+        {
+            if (p >= end)
+            {
+                return false;
+            }
+
+            delay = delay * 128 + (*p & 0x7f);
+        } while (*p++ & 0x80);
+
+        ticks += delay;
+        ms = (unsigned int)(((uint64_t) ticks * 1000) / MUS_TICKS_PER_SECOND);
+        group->ms = ms - last_ms;
+        last_ms = ms;
+    }
+
+    return true;
+}
+
 // Initialize a channel.
 
 static void InitChannel(opl_track_data_t *track, opl_channel_data_t *channel)
@@ -1179,6 +1482,7 @@ static void StartTrack(const midi_file_t *file, unsigned int track_num)
 
 static void I_OPL_PlaySong(const void *handle, int looping)
 {
+    const opl_song_t *song = handle;
     const midi_file_t *file;
     unsigned int i;
 
@@ -1187,7 +1491,29 @@ static void I_OPL_PlaySong(const void *handle, int looping)
         return;
     }
 
-    file = handle;
+    song_looping = looping;
+
+    if (song->midi == NULL)
+    {
+        // A MUS lump has a single track.
+
+        tracks = malloc(sizeof(opl_track_data_t));
+        num_tracks = 1;
+        running_tracks = 1;
+        mus_song = song;
+
+        tracks[0].iter = NULL;
+
+        for (i=0; i<MIDI_CHANNELS_PER_TRACK; ++i)
+        {
+            InitChannel(&tracks[0], &tracks[0].channels[i]);
+        }
+
+        StartMusGroups(&tracks[0]);
+        return;
+    }
+
+    file = song->midi;
 
     // Allocate track data.
 
@@ -1195,7 +1521,6 @@ static void I_OPL_PlaySong(const void *handle, int looping)
 
     num_tracks = MIDI_NumTracks(file);
     running_tracks = num_tracks;
-    song_looping = looping;
 
     for (i=0; i<num_tracks; ++i)
     {
@@ -1268,26 +1593,38 @@ static void I_OPL_StopSong(void)
 
     for (i=0; i<num_tracks; ++i)
     {
-        MIDI_FreeIterator(tracks[i].iter);
+        if (tracks[i].iter != NULL)
+        {
+            MIDI_FreeIterator(tracks[i].iter);
+        }
     }
 
     free(tracks);
 
     tracks = NULL;
     num_tracks = 0;
+    mus_song = NULL;
 
 }
 
 static void I_OPL_UnRegisterSong(const void *handle)
 {
+    opl_song_t *song = (opl_song_t *) handle;
+
     if (!music_initialized)
     {
         return;
     }
 
-    if (handle != NULL)
+    if (song != NULL)
     {
-        MIDI_FreeFile((void *) handle);
+        if (song->midi != NULL)
+        {
+            MIDI_FreeFile(song->midi);
+        }
+
+        free(song->groups);
+        free(song);
     }
 }
 
@@ -1299,14 +1636,31 @@ static dbool IsMid(unsigned char *mem, int len)
 }
 */
 
-// now only takes files in MIDI format
+// takes files in MIDI format, or MUS lumps which are played without
+// converting them to MIDI first
 static const void *I_OPL_RegisterSong(const void *data, unsigned len)
 {
+    opl_song_t *song;
     midimem_t mf;
 
     if (!music_initialized)
         return NULL;
 
+    if (len > 16 && !memcmp(data, "MUS\x1a", 4))
+    {
+        song = malloc(sizeof(*song));
+        song->midi = NULL;
+
+        if (!LoadMusSong(song, data, len))
+        {
+            free(song->groups);
+            free(song);
+            return NULL;
+        }
+
+        return song;
+    }
+
     mf.len = len;
     mf.pos = 0;
     mf.data = data;
@@ -1320,7 +1674,18 @@ static const void *I_OPL_RegisterSong(const void *data, unsigned len)
     if (mf.len < 100)
         return NULL;
 
-    return MIDI_LoadFileSpecial (&mf);
+    song = malloc(sizeof(*song));
+    song->groups = NULL;
+    song->num_groups = 0;
+    song->midi = MIDI_LoadFileSpecial (&mf);
+
+    if (song->midi == NULL)
+    {
+        free(song);
+        return NULL;
+    }
+
+    return song;
 }
 
 
@@ -1377,6 +1742,11 @@ void I_OPL_RenderSamples (void *dest, unsigned nsamp)
     OPL_Render_Samples (dest, nsamp);
 }
 
+static int I_OPL_Playing(void)
+{
+    return tracks != NULL && running_tracks > 0;
+}
+
 const music_player_t opl_synth_player =
 {
   I_OPL_SynthName,
@@ -1389,5 +1759,6 @@ const music_player_t opl_synth_player =
   I_OPL_UnRegisterSong,
   I_OPL_PlaySong,
   I_OPL_StopSong,
-  I_OPL_RenderSamples
+  I_OPL_RenderSamples,
+  I_OPL_Playing
 };
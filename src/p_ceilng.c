@@ -34,6 +34,7 @@
 #include "doomstat.h"
 #include "r_main.h"
 #include "p_spec.h"
+#include "p_map.h"
 #include "p_tick.h"
 #include "s_sound.h"
 #include "sounds.h"
@@ -109,6 +110,7 @@ void T_MoveCeiling (ceiling_t* ceiling)
           case genCeilingChgT:
           case genCeilingChg0:
             ceiling->sector->special = ceiling->newspecial;
+            P_FrictionChanged();
             //jff 3/14/98 transfer old special field as well
             ceiling->sector->oldspecial = ceiling->oldspecial;
             // fall through
@@ -190,6 +192,7 @@ void T_MoveCeiling (ceiling_t* ceiling)
           case genCeilingChgT:
           case genCeilingChg0:
             ceiling->sector->special = ceiling->newspecial;
+            P_FrictionChanged();
             //jff add to fix bug in special transfers from changes
             ceiling->sector->oldspecial = ceiling->oldspecial;
             // fall through
@@ -284,7 +287,7 @@ int EV_DoCeiling
 
     // create a new ceiling thinker
     rtn = 1;
-    ceiling = Z_Malloc (sizeof(*ceiling), PU_LEVSPEC, 0);
+    ceiling = P_AllocThinker(TZ_CEILING);
     memset(ceiling, 0, sizeof(*ceiling));
     P_AddThinker (&ceiling->thinker);
     sec->ceilingdata = ceiling;               //jff 2/22/98
@@ -40,6 +40,7 @@
 #include "dstrings.h"
 #include "d_deh.h"  // Ty 03/27/98 - externalized
 #include "lprintf.h"
+#include "p_saveg.h"
 
 ///////////////////////////////////////////////////////////////
 //
@@ -371,7 +372,7 @@ int EV_DoDoor
 
     // new door thinker
     rtn = 1;
-    door = Z_Malloc (sizeof(*door), PU_LEVSPEC, 0);
+    door = P_AllocThinker(TZ_DOOR);
     memset(door, 0, sizeof(*door));
     P_AddThinker (&door->thinker);
     sec->ceilingdata = door; //jff 2/22/98
@@ -587,7 +588,7 @@ int EV_VerticalDoor
   }
 
   // new door thinker
-  door = Z_Malloc (sizeof(*door), PU_LEVSPEC, 0);
+  door = P_AllocThinker(TZ_DOOR);
   memset(door, 0, sizeof(*door));
   P_AddThinker (&door->thinker);
   sec->ceilingdata = door; //jff 2/22/98
@@ -617,6 +618,7 @@ int EV_VerticalDoor
     case 34:
       door->type = open;
       line->special = 0;
+      P_MarkLineDirty(line);
       break;
 
     case 117: // blazing door raise
@@ -626,6 +628,7 @@ int EV_VerticalDoor
     case 118: // blazing door open
       door->type = blazeOpen;
       line->special = 0;
+      P_MarkLineDirty(line);
       door->speed = VDOORSPEED*4;
       break;
 
@@ -659,13 +662,14 @@ void P_SpawnDoorCloseIn30 (sector_t* sec)
 {
   vldoor_t* door;
 
-  door = Z_Malloc ( sizeof(*door), PU_LEVSPEC, 0);
+  door = P_AllocThinker(TZ_DOOR);
 
   memset(door, 0, sizeof(*door));
   P_AddThinker (&door->thinker);
 
   sec->ceilingdata = door; //jff 2/22/98
   sec->special = 0;
+  P_MarkSectorDirty(sec);
 
   door->thinker.function = T_VerticalDoor;
   door->sector = sec;
@@ -691,13 +695,14 @@ void P_SpawnDoorRaiseIn5Mins
 {
   vldoor_t* door;
 
-  door = Z_Malloc ( sizeof(*door), PU_LEVSPEC, 0);
+  door = P_AllocThinker(TZ_DOOR);
 
   memset(door, 0, sizeof(*door));
   P_AddThinker (&door->thinker);
 
   sec->ceilingdata = door; //jff 2/22/98
   sec->special = 0;
+  P_MarkSectorDirty(sec);
 
   door->thinker.function = T_VerticalDoor;
   door->sector = sec;
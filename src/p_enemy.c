@@ -85,6 +85,100 @@ extern void retro_set_rumble_damage(int damage, float duration);
 //
 // killough 5/5/98: reformatted, cleaned up
 
+// Flood fills are cached by the sector they start from. A cached fill
+// holds every sector it reached with the soundtraversed it left there,
+// which is all P_RecursiveSound changes besides soundtarget. Its result
+// only depends on which two-sided lines are open, so the cache is kept
+// until soundgeneration changes, which P_CheckSoundLines does when a
+// moving plane opens or closes a line.
+
+#define SOUNDCACHESIZE 4
+
+typedef struct {
+  sector_t *sector;
+  int      traversed;
+} soundsector_t;
+
+typedef struct {
+  sector_t      *origin;
+  unsigned      generation;
+  soundsector_t *sectors;
+  int           count, max;
+} soundflood_t;
+
+static soundflood_t soundcache[SOUNDCACHESIZE];
+static int soundcachenext;
+static soundflood_t *soundrecord;  // fill being recorded, if any
+static unsigned soundgeneration;
+static long long soundlookups, soundhits;
+
+// Whether each line lets sound through, as of soundgeneration
+static uint8_t *soundlineopen;
+static int soundlinemax;
+
+static int P_SoundLineOpen(const line_t *line)
+{
+  const sector_t *front = line->frontsector, *back = line->backsector;
+
+  // as P_LineOpening works out openrange > 0
+  if (!(line->flags & ML_TWOSIDED) || line->sidenum[1] == NO_INDEX)
+    return 0;
+  return MIN(front->ceilingheight, back->ceilingheight) >
+    MAX(front->floorheight, back->floorheight);
+}
+
+//
+// P_CheckSoundLines
+// Call after moving a plane of sec, to drop the cached flood fills if
+// that opened or closed any of its lines.
+//
+
+void P_CheckSoundLines(const sector_t *sec)
+{
+  int i;
+
+  for (i = 0; i < sec->linecount; i++)
+    {
+      const line_t *line = sec->lines[i];
+      int open = P_SoundLineOpen(line);
+
+      if (soundlineopen[line - lines] != open)
+        {
+          soundlineopen[line - lines] = open;
+          soundgeneration++;
+        }
+    }
+}
+
+//
+// P_ResetSoundCache
+// Call once the lines and sector heights of a level are loaded or
+// restored.
+//
+
+void P_ResetSoundCache(void)
+{
+  int i;
+
+  if (numlines > soundlinemax)
+    {
+      soundlinemax = numlines;
+      soundlineopen = realloc(soundlineopen, soundlinemax);
+    }
+  for (i = 0; i < numlines; i++)
+    soundlineopen[i] = P_SoundLineOpen(&lines[i]);
+  soundgeneration++;
+}
+
+void P_ReportSoundCache(void)
+{
+  if (soundlookups)
+    lprintf(LO_INFO, "P_ReportSoundCache: %d%% of %lld noise alerts hit\n",
+        (int)(soundhits * 100 / soundlookups), soundlookups);
+  soundlookups = soundhits = 0;
+  soundgeneration++;
+}
+
 static void P_RecursiveSound(sector_t *sec, int soundblocks,
            mobj_t *soundtarget)
 {
@@ -94,6 +188,17 @@ static void P_RecursiveSound(sector_t *sec, int soundblocks,
   if (sec->validcount == validcount && sec->soundtraversed <= soundblocks+1)
     return;             // already flooded
 
+  if (soundrecord && sec->validcount != validcount)
+    {
+      if (soundrecord->count == soundrecord->max)
+        {
+          soundrecord->max = soundrecord->max ? soundrecord->max*2 : 64;
+          soundrecord->sectors = realloc(soundrecord->sectors,
+              soundrecord->max * sizeof(*soundrecord->sectors));
+        }
+      soundrecord->sectors[soundrecord->count++].sector = sec;
+    }
+
   sec->validcount = validcount;
   sec->soundtraversed = soundblocks+1;
   P_SetTarget(&sec->soundtarget, soundtarget);
@@ -128,8 +233,41 @@ static void P_RecursiveSound(sector_t *sec, int soundblocks,
 //
 void P_NoiseAlert(mobj_t *target, mobj_t *emitter)
 {
+  sector_t *origin = emitter->subsector->sector;
+  soundflood_t *flood;
+  int i;
+
   validcount++;
-  P_RecursiveSound(emitter->subsector->sector, 0, target);
+  soundlookups++;
+
+  for (i = 0; i < SOUNDCACHESIZE; i++)
+    {
+      flood = &soundcache[i];
+      if (flood->origin == origin && flood->generation == soundgeneration)
+        {
+          soundhits++;
+          for (i = 0; i < flood->count; i++)
+            {
+              sector_t *sec = flood->sectors[i].sector;
+
+              sec->validcount = validcount;
+              sec->soundtraversed = flood->sectors[i].traversed;
+              P_SetTarget(&sec->soundtarget, target);
+            }
+          return;
+        }
+    }
+
+  flood = soundrecord = &soundcache[soundcachenext];
+  soundcachenext = (soundcachenext + 1) % SOUNDCACHESIZE;
+  flood->count = 0;
+  P_RecursiveSound(origin, 0, target);
+  soundrecord = NULL;
+
+  for (i = 0; i < flood->count; i++)
+    flood->sectors[i].traversed = flood->sectors[i].sector->soundtraversed;
+  flood->origin = origin;
+  flood->generation = soundgeneration;
 }
 
 //
@@ -288,8 +426,8 @@ static int P_IsUnderDamage(mobj_t *actor)
   const struct msecnode_s *seclist;
   const ceiling_t *cl;             // Crushing ceiling
   int dir = 0;
-  for (seclist=actor->touching_sectorlist; seclist; seclist=seclist->m_tnext)
-    if ((cl = seclist->m_sector->ceilingdata) &&
+  for (seclist=actor->touching_sectorlist; seclist; seclist=SN_TNEXT(seclist))
+    if ((cl = SN_SECTOR(seclist)->ceilingdata) &&
   cl->thinker.function == T_MoveCeiling)
       dir |= cl->direction;
   return dir;
@@ -343,6 +481,7 @@ static dbool   P_Move(mobj_t *actor, dbool   dropoff) /* killough 9/12/98 */
     {
       actor->x = origx;
       actor->y = origy;
+      P_SyncBlockThing(actor);    // left in the cell it moved to
       movefactor *= FRACUNIT / ORIG_FRICTION_FACTOR / 4;
       actor->momx += FixedMul(deltax, movefactor);
       actor->momy += FixedMul(deltay, movefactor);
@@ -602,7 +741,7 @@ static fixed_t P_AvoidDropoff(mobj_t *actor)
   validcount++;
   for (bx=xl ; bx<=xh ; bx++)
     for (by=yl ; by<=yh ; by++)
-      P_BlockLinesIterator(bx, by, PIT_AvoidDropoff);  // all contacted lines
+      P_BlockLinesInBoxIterator(bx, by, tmbbox, PIT_AvoidDropoff);  // all contacted lines
 
   return dropoff_deltax | dropoff_deltay;   // Non-zero if movement prescribed
 }
@@ -747,6 +886,12 @@ static dbool   PIT_FindTarget(mobj_t *mo)
   return FALSE;
 }
 
+static dbool P_FindTargetInBlock(int x, int y, int side)
+{
+  return !P_TargetsInBlocks(x, y, x, y, side) ||
+    P_BlockThingsIterator(x, y, PIT_FindTarget);
+}
+
 //
 // P_LookForPlayers
 // If allaround is FALSE, only look 180 degrees in front.
@@ -881,30 +1026,36 @@ static dbool   P_LookForMonsters(mobj_t *actor, dbool   allaround)
     {
       int x = (actor->x - bmaporgx)>>MAPBLOCKSHIFT;
       int y = (actor->y - bmaporgy)>>MAPBLOCKSHIFT;
+      int side = actor->flags & MF_FRIEND ? TG_ENEMIES : TG_FRIENDS;
       int d;
 
       current_actor = actor;
       current_allaround = allaround;
 
       // Search first in the immediate vicinity.
+      // Blocks the target grid has no monsters of the wanted side in are
+      // passed over; PIT_FindTarget would reject all they hold anyway.
 
-      if (!P_BlockThingsIterator(x, y, PIT_FindTarget))
+      if (P_TargetsInBlocks(x-4, y-4, x+4, y+4, side))
+      {
+      if (!P_FindTargetInBlock(x, y, side))
   return TRUE;
 
       for (d=1; d<5; d++)
   {
     int i = 1 - d;
     do
-      if (!P_BlockThingsIterator(x+i, y-d, PIT_FindTarget) ||
-    !P_BlockThingsIterator(x+i, y+d, PIT_FindTarget))
+      if (!P_FindTargetInBlock(x+i, y-d, side) ||
+    !P_FindTargetInBlock(x+i, y+d, side))
         return TRUE;
     while (++i < d);
     do
-      if (!P_BlockThingsIterator(x-d, y+i, PIT_FindTarget) ||
-    !P_BlockThingsIterator(x+d, y+i, PIT_FindTarget))
+      if (!P_FindTargetInBlock(x-d, y+i, side) ||
+    !P_FindTargetInBlock(x+d, y+i, side))
         return TRUE;
     while (--i + d >= 0);
   }
+      }
 
       {   // Random number of monsters, to prevent patterns from forming
   int n = (P_Random(pr_friends) & 31) + 15;
@@ -1431,6 +1582,7 @@ void A_SkelMissile(mobj_t *actor)
 
   mo->x += mo->momx;
   mo->y += mo->momy;
+  P_SyncBlockThing(mo);
   P_SetTarget(&mo->tracer, actor->target);
 }
 
@@ -1597,9 +1749,11 @@ static dbool   PIT_VileCheck(mobj_t *thing)
         corpsehit->height = corpsehit->info->height;
         corpsehit->radius = corpsehit->info->radius;
         corpsehit->flags |= MF_SOLID;
+        P_SyncBlockThing(corpsehit);
         check = P_CheckPosition(corpsehit,corpsehit->x,corpsehit->y);
         corpsehit->height = height; // restore
         corpsehit->radius = radius; // restore                      //   ^
+        P_SyncBlockThing(corpsehit);
         corpsehit->flags &= ~MF_SOLID;
       }                                                             //   |
                                                                     // phares
@@ -1662,6 +1816,7 @@ void A_VileChase(mobj_t* actor)
                     {
                       corpsehit->height = info->height; // fix Ghost bug
                       corpsehit->radius = info->radius; // fix Ghost bug
+                      P_SyncBlockThing(corpsehit);
                     }                                               // phares
 
       /* killough 7/18/98:
@@ -1798,6 +1953,7 @@ void A_VileAttack(mobj_t *actor)
   // move the fire between the vile and the player
   fire->x = actor->target->x - FixedMul (STEPSIZE, finecosine[an]);
   fire->y = actor->target->y - FixedMul (STEPSIZE, finesine[an]);
+  P_SyncBlockThing(fire);
   P_RadiusAttack(fire, actor, 70);
 }
 
@@ -37,8 +37,12 @@
 #define __P_ENEMY__
 
 #include "p_mobj.h"
+#include "r_defs.h"
 
 void P_NoiseAlert (mobj_t *target, mobj_t *emmiter);
+void P_CheckSoundLines(const sector_t *sec);
+void P_ResetSoundCache(void);
+void P_ReportSoundCache(void);
 void P_SpawnBrainTargets(void); /* killough 3/26/98: spawn icon landings */
 
 extern struct brain_s {         /* killough 3/26/98: global state of boss brain */
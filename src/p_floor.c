@@ -35,10 +35,12 @@
 #include "doomstat.h"
 #include "r_main.h"
 #include "p_map.h"
+#include "p_enemy.h"
 #include "p_spec.h"
 #include "p_tick.h"
 #include "s_sound.h"
 #include "sounds.h"
+#include "p_saveg.h"
 
 ///////////////////////////////////////////////////////////////////////
 //
@@ -47,7 +49,7 @@
 ///////////////////////////////////////////////////////////////////////
 
 //
-// T_MovePlane()
+// P_MovePlane()
 //
 // Move a plane (floor or ceiling) and check for crushing. Called
 // every tick by all actions that move floors or ceilings.
@@ -62,7 +64,7 @@
 //  pastdest - plane moved normally and is now at destination height
 //  crushed - plane encountered an obstacle, is holding until removed
 //
-result_e T_MovePlane(sector_t *sector, fixed_t speed,
+static result_e P_MovePlane(sector_t *sector, fixed_t speed,
       fixed_t dest, dbool   crush, int floorOrCeiling, int direction)
 {
    dbool         flag;
@@ -70,6 +72,9 @@ result_e T_MovePlane(sector_t *sector, fixed_t speed,
    fixed_t       destheight; //jff 02/04/98 used to keep floors/ceilings
    // from moving thru each other
 
+   sightgeneration++;
+   P_MarkSectorDirty(sector);
+
    switch(floorOrCeiling)
    {
       case 0: /* Moving a floor */
@@ -213,6 +218,23 @@ result_e T_MovePlane(sector_t *sector, fixed_t speed,
    return RES_OK;
 }
 
+//
+// T_MovePlane()
+//
+// As P_MovePlane, then lets the noise alert cache know if the move
+// opened or closed a line.
+//
+
+result_e T_MovePlane(sector_t *sector, fixed_t speed,
+      fixed_t dest, dbool   crush, int floorOrCeiling, int direction)
+{
+   result_e res = P_MovePlane(sector, speed, dest, crush, floorOrCeiling,
+         direction);
+
+   P_CheckSoundLines(sector);
+   return res;
+}
+
 /*
  * T_MoveFloor()
  *
@@ -253,11 +275,13 @@ void T_MoveFloor(floormove_t* floor)
         {
            case FLEV_DONUTRAISE:
               floor->sector->special = floor->newspecial;
+              P_FrictionChanged();
               floor->sector->floorpic = floor->texture;
               break;
            case FLEV_GENFLOORCHGT:
            case FLEV_GENFLOORCHG0:
               floor->sector->special = floor->newspecial;
+              P_FrictionChanged();
               //jff add to fix bug in special transfers from changes
               floor->sector->oldspecial = floor->oldspecial;
               //fall thru
@@ -274,6 +298,7 @@ void T_MoveFloor(floormove_t* floor)
         {
            case FLEV_LOWERANDCHANGE:
               floor->sector->special = floor->newspecial;
+              P_FrictionChanged();
               //jff add to fix bug in special transfers from changes
               floor->sector->oldspecial = floor->oldspecial;
               floor->sector->floorpic = floor->texture;
@@ -281,6 +306,7 @@ void T_MoveFloor(floormove_t* floor)
            case FLEV_GENFLOORCHGT:
            case FLEV_GENFLOORCHG0:
               floor->sector->special = floor->newspecial;
+              P_FrictionChanged();
               //jff add to fix bug in special transfers from changes
               floor->sector->oldspecial = floor->oldspecial;
               //fall thru
@@ -437,7 +463,7 @@ int EV_DoFloor
 
       // new floor thinker
       rtn = 1;
-      floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+      floor = P_AllocThinker(TZ_FLOOR);
       memset(floor, 0, sizeof(*floor));
       P_AddThinker (&floor->thinker);
       sec->floordata = floor; //jff 2/22/98
@@ -552,8 +578,10 @@ int EV_DoFloor
             floor->floordestheight = floor->sector->floorheight + 24 * FRACUNIT;
             sec->floorpic = line->frontsector->floorpic;
             sec->special = line->frontsector->special;
+            P_FrictionChanged();
             //jff 3/14/98 transfer both old and new special
             sec->oldspecial = line->frontsector->oldspecial;
+            P_MarkSectorDirty(sec);
             break;
 
          case FLEV_RAISETOTEXTURE:
@@ -656,6 +684,7 @@ int EV_DoChange
     sec = &sectors[secnum];
 
     rtn = 1;
+    P_MarkSectorDirty(sec);
 
     // handle trigger or numeric change type
     switch(changetype)
@@ -663,6 +692,7 @@ int EV_DoChange
       case trigChangeOnly:
         sec->floorpic = line->frontsector->floorpic;
         sec->special = line->frontsector->special;
+        P_FrictionChanged();
         sec->oldspecial = line->frontsector->oldspecial;
         break;
       case numChangeOnly:
@@ -671,6 +701,7 @@ int EV_DoChange
         {
           sec->floorpic = secm->floorpic;
           sec->special = secm->special;
+          P_FrictionChanged();
           sec->oldspecial = secm->oldspecial;
         }
         break;
@@ -742,7 +773,7 @@ int EV_BuildStairs
 
     // create new floor thinker for first step
     rtn = 1;
-    floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+    floor = P_AllocThinker(TZ_FLOOR);
     memset(floor, 0, sizeof(*floor));
     P_AddThinker (&floor->thinker);
     sec->floordata = floor;
@@ -823,7 +854,7 @@ int EV_BuildStairs
         secnum = newsecnum;
 
         // create and initialize a thinker for the next step
-        floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+        floor = P_AllocThinker(TZ_FLOOR);
         memset(floor, 0, sizeof(*floor));
         P_AddThinker (&floor->thinker);
 
@@ -924,7 +955,7 @@ int EV_DoDonut(line_t*  line)
       s3 = s2->lines[i]->backsector;      // s3 is model sector for changes
 
       //  Spawn rising slime
-      floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+      floor = P_AllocThinker(TZ_FLOOR);
       memset(floor, 0, sizeof(*floor));
       P_AddThinker (&floor->thinker);
       s2->floordata = floor; //jff 2/22/98
@@ -939,7 +970,7 @@ int EV_DoDonut(line_t*  line)
       floor->floordestheight = s3->floorheight;
 
       //  Spawn lowering donut-hole pillar
-      floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+      floor = P_AllocThinker(TZ_FLOOR);
       memset(floor, 0, sizeof(*floor));
       P_AddThinker (&floor->thinker);
       s1->floordata = floor; //jff 2/22/98
@@ -987,7 +1018,7 @@ int EV_DoElevator
 
     // create and initialize new elevator thinker
     rtn = 1;
-    elevator = Z_Malloc (sizeof(*elevator), PU_LEVSPEC, 0);
+    elevator = P_AllocThinker(TZ_ELEVATOR);
     memset(elevator, 0, sizeof(*elevator));
     P_AddThinker (&elevator->thinker);
     sec->floordata = elevator; //jff 2/22/98
@@ -39,6 +39,7 @@
 #include "m_random.h"
 #include "s_sound.h"
 #include "sounds.h"
+#include "p_saveg.h"
 
 //////////////////////////////////////////////////////////
 //
@@ -61,6 +62,7 @@ int EV_DoGenFloor
 ( line_t*       line )
 {
   int                   secnum;
+  const int*            tagged;
   int                   rtn;
   dbool                 manual;
   sector_t*             sec;
@@ -90,9 +92,8 @@ int EV_DoGenFloor
     goto manual_floor;
   }
 
-  secnum = -1;
   // if not manual do all sectors tagged the same as the line
-  while ((secnum = P_FindSectorFromLineTag(line,secnum)) >= 0)
+  for (tagged = P_SectorsFromLineTag(line); (secnum = *tagged) >= 0; tagged++)
   {
     sec = &sectors[secnum];
 
@@ -108,7 +109,7 @@ manual_floor:
 
     // new floor thinker
     rtn = 1;
-    floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+    floor = P_AllocThinker(TZ_FLOOR);
     memset(floor, 0, sizeof(*floor));
     P_AddThinker (&floor->thinker);
     sec->floordata = floor;
@@ -264,6 +265,7 @@ int EV_DoGenCeiling
 ( line_t*       line )
 {
   int                   secnum;
+  const int*            tagged;
   int                   rtn;
   dbool                 manual;
   fixed_t               targheight;
@@ -294,9 +296,8 @@ int EV_DoGenCeiling
     goto manual_ceiling;
   }
 
-  secnum = -1;
   // if not manual do all sectors tagged the same as the line
-  while ((secnum = P_FindSectorFromLineTag(line,secnum)) >= 0)
+  for (tagged = P_SectorsFromLineTag(line); (secnum = *tagged) >= 0; tagged++)
   {
     sec = &sectors[secnum];
 
@@ -312,7 +313,7 @@ manual_ceiling:
 
     // new ceiling thinker
     rtn = 1;
-    ceiling = Z_Malloc (sizeof(*ceiling), PU_LEVSPEC, 0);
+    ceiling = P_AllocThinker(TZ_CEILING);
     memset(ceiling, 0, sizeof(*ceiling));
     P_AddThinker (&ceiling->thinker);
     sec->ceilingdata = ceiling; //jff 2/22/98
@@ -471,6 +472,7 @@ int EV_DoGenLift
 {
   plat_t*         plat;
   int             secnum;
+  const int*      tagged;
   int             rtn;
   dbool           manual;
   sector_t*       sec;
@@ -483,7 +485,6 @@ int EV_DoGenLift
   int Sped = (value & LiftSpeed) >> LiftSpeedShift;
   int Trig = (value & TriggerType) >> TriggerTypeShift;
 
-  secnum = -1;
   rtn = 0;
 
   // Activate all <type> plats that are in_stasis
@@ -503,7 +504,7 @@ int EV_DoGenLift
   }
 
   // if not manual do all sectors tagged the same as the line
-  while ((secnum = P_FindSectorFromLineTag(line,secnum)) >= 0)
+  for (tagged = P_SectorsFromLineTag(line); (secnum = *tagged) >= 0; tagged++)
   {
     sec = &sectors[secnum];
 
@@ -519,7 +520,7 @@ manual_lift:
 
     // Setup the plat thinker
     rtn = 1;
-    plat = Z_Malloc( sizeof(*plat), PU_LEVSPEC, 0);
+    plat = P_AllocThinker(TZ_PLAT);
     memset(plat, 0, sizeof(*plat));
     P_AddThinker(&plat->thinker);
 
@@ -620,6 +621,7 @@ int EV_DoGenStairs
 ( line_t*       line )
 {
   int                   secnum;
+  const int*            tagged;
   int                   osecnum; //jff 3/4/98 preserve loop index
   int                   height;
   int                   i;
@@ -660,9 +662,8 @@ int EV_DoGenStairs
     goto manual_stair;
   }
 
-  secnum = -1;
   // if not manual do all sectors tagged the same as the line
-  while ((secnum = P_FindSectorFromLineTag(line,secnum)) >= 0)
+  for (tagged = P_SectorsFromLineTag(line); (secnum = *tagged) >= 0; tagged++)
   {
     sec = &sectors[secnum];
 
@@ -680,7 +681,7 @@ manual_stair:
 
     // new floor thinker
     rtn = 1;
-    floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+    floor = P_AllocThinker(TZ_FLOOR);
     memset(floor, 0, sizeof(*floor));
     P_AddThinker (&floor->thinker);
     sec->floordata = floor;
@@ -781,7 +782,7 @@ manual_stair:
 
         sec = tsec;
         secnum = newsecnum;
-        floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+        floor = P_AllocThinker(TZ_FLOOR);
 
         memset(floor, 0, sizeof(*floor));
         P_AddThinker (&floor->thinker);
@@ -805,7 +806,10 @@ manual_stair:
   }
   // retriggerable generalized stairs build up or down alternately
   if (rtn)
+  {
     line->special ^= StairDirection; // alternate dir on succ activations
+    P_MarkLineDirty(line);
+  }
   return rtn;
 }
 
@@ -821,6 +825,7 @@ int EV_DoGenCrusher
 ( line_t*       line )
 {
   int                   secnum;
+  const int*            tagged;
   int                   rtn;
   dbool                 manual;
   sector_t*             sec;
@@ -848,9 +853,8 @@ int EV_DoGenCrusher
     goto manual_crusher;
   }
 
-  secnum = -1;
   // if not manual do all sectors tagged the same as the line
-  while ((secnum = P_FindSectorFromLineTag(line,secnum)) >= 0)
+  for (tagged = P_SectorsFromLineTag(line); (secnum = *tagged) >= 0; tagged++)
   {
     sec = &sectors[secnum];
 
@@ -866,7 +870,7 @@ manual_crusher:
 
     // new ceiling thinker
     rtn = 1;
-    ceiling = Z_Malloc (sizeof(*ceiling), PU_LEVSPEC, 0);
+    ceiling = P_AllocThinker(TZ_CEILING);
     memset(ceiling, 0, sizeof(*ceiling));
     P_AddThinker (&ceiling->thinker);
     sec->ceilingdata = ceiling; //jff 2/22/98
@@ -919,6 +923,7 @@ int EV_DoGenLockedDoor
 ( line_t* line )
 {
   int   secnum,rtn;
+  const int* tagged;
   sector_t* sec;
   vldoor_t* door;
   dbool   manual;
@@ -943,11 +948,10 @@ int EV_DoGenLockedDoor
     goto manual_locked;
   }
 
-  secnum = -1;
   rtn = 0;
 
   // if not manual do all sectors tagged the same as the line
-  while ((secnum = P_FindSectorFromLineTag(line,secnum)) >= 0)
+  for (tagged = P_SectorsFromLineTag(line); (secnum = *tagged) >= 0; tagged++)
   {
     sec = &sectors[secnum];
 manual_locked:
@@ -962,7 +966,7 @@ manual_locked:
 
     // new door thinker
     rtn = 1;
-    door = Z_Malloc (sizeof(*door), PU_LEVSPEC, 0);
+    door = P_AllocThinker(TZ_DOOR);
     memset(door, 0, sizeof(*door));
     P_AddThinker (&door->thinker);
     sec->ceilingdata = door; //jff 2/22/98
@@ -1027,6 +1031,7 @@ int EV_DoGenDoor
 ( line_t* line )
 {
   int   secnum,rtn;
+  const int* tagged;
   sector_t* sec;
   dbool     manual;
   vldoor_t* door;
@@ -1053,11 +1058,10 @@ int EV_DoGenDoor
   }
 
 
-  secnum = -1;
   rtn = 0;
 
   // if not manual do all sectors tagged the same as the line
-  while ((secnum = P_FindSectorFromLineTag(line,secnum)) >= 0)
+  for (tagged = P_SectorsFromLineTag(line); (secnum = *tagged) >= 0; tagged++)
   {
     sec = &sectors[secnum];
 manual_door:
@@ -1072,7 +1076,7 @@ manual_door:
 
     // new door thinker
     rtn = 1;
-    door = Z_Malloc (sizeof(*door), PU_LEVSPEC, 0);
+    door = P_AllocThinker(TZ_DOOR);
     memset(door, 0, sizeof(*door));
     P_AddThinker (&door->thinker);
     sec->ceilingdata = door; //jff 2/22/98
@@ -1162,3 +1166,73 @@ manual_door:
   }
   return rtn;
 }
+
+//
+// P_InitGenLineTypes()
+//
+// Decodes every generalized linedef type once, so the trigger dispatchers
+// find a type's class and monster permission with one table read instead
+// of a chain of range compares.
+//
+byte genlinetypes[GenEnd - GenCrusherBase];
+
+int (*const genlinefuncs[])(line_t *line) =
+{
+  NULL,
+  EV_DoGenCrusher,
+  EV_DoGenStairs,
+  EV_DoGenLift,
+  EV_DoGenLockedDoor,
+  EV_DoGenDoor,
+  EV_DoGenCeiling,
+  EV_DoGenFloor,
+};
+
+void P_InitGenLineTypes(void)
+{
+  unsigned special;
+
+  for (special = GenCrusherBase; special < GenEnd; special++)
+  {
+    int type;
+    dbool monsters;
+
+    if (special >= GenFloorBase)
+    { // FloorModel is "Allow Monsters" if FloorChange is 0
+      type = GenFloor;
+      monsters = !(special & FloorChange) && (special & FloorModel);
+    }
+    else if (special >= GenCeilingBase)
+    { // CeilingModel is "Allow Monsters" if CeilingChange is 0
+      type = GenCeiling;
+      monsters = !(special & CeilingChange) && (special & CeilingModel);
+    }
+    else if (special >= GenDoorBase)
+    {
+      type = GenDoor;
+      monsters = (special & DoorMonster) != 0;
+    }
+    else if (special >= GenLockedBase)
+    { // monsters disallowed from unlocking doors
+      type = GenLocked;
+      monsters = FALSE;
+    }
+    else if (special >= GenLiftBase)
+    {
+      type = GenLift;
+      monsters = (special & LiftMonster) != 0;
+    }
+    else if (special >= GenStairsBase)
+    {
+      type = GenStairs;
+      monsters = (special & StairMonster) != 0;
+    }
+    else
+    {
+      type = GenCrusher;
+      monsters = (special & CrusherMonster) != 0;
+    }
+    genlinetypes[special - GenCrusherBase] =
+      (byte)(type | (monsters ? GenLineMonsters : 0));
+  }
+}
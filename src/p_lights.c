@@ -33,12 +33,16 @@
  *
  *-----------------------------------------------------------------------------*/
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "doomstat.h" //jff 5/18/98
 #include "doomdef.h"
 #include "m_random.h"
 #include "r_main.h"
 #include "p_spec.h"
 #include "p_tick.h"
+#include "p_saveg.h"
 
 //////////////////////////////////////////////////////////
 //
@@ -62,6 +66,7 @@ void T_FireFlicker (fireflicker_t* flick)
     return;
 
   amount = (P_Random(pr_lights)&3)*16;
+  P_MarkSectorDirty(flick->sector);
 
   if (flick->sector->lightlevel - amount < flick->minlight)
     flick->sector->lightlevel = flick->minlight;
@@ -83,6 +88,7 @@ void T_LightFlash (lightflash_t* flash)
 {
   if (--flash->count)
     return;
+  P_MarkSectorDirty(flash->sector);
 
   if (flash->sector->lightlevel == flash->maxlight)
   {
@@ -109,6 +115,7 @@ void T_StrobeFlash (strobe_t*   flash)
 {
   if (--flash->count)
     return;
+  P_MarkSectorDirty(flash->sector);
 
   if (flash->sector->lightlevel == flash->minlight)
   {
@@ -133,6 +140,7 @@ void T_StrobeFlash (strobe_t*   flash)
 
 void T_Glow(glow_t* g)
 {
+  P_MarkSectorDirty(g->sector);
   switch(g->direction)
   {
     case -1:
@@ -157,6 +165,140 @@ void T_Glow(glow_t* g)
   }
 }
 
+//////////////////////////////////////////////////////////
+//
+// Batched light thinkers
+//
+// With thinker batching on (see P_RunThinkers), the light thinkers
+// are run from dense per-type arrays after the main thinker list
+// rather than one by one as the list reaches them. Flickers, flashes
+// and strobes only act when their countdown runs out, so their arrays
+// hold the countdowns themselves and a tic in which nothing changes
+// just walks an array of ints. While a thinker is batched its own
+// count is stale; P_SyncLightThinkers copies the array's back before
+// the thinkers are saved. Flickers and flashes draw on pr_lights, so
+// they share one array in spawn order and each still gets the random
+// numbers it got before; that only holds because P_InitThinkers turns
+// batching on with demo_insurance alone, when pr_lights has a seed of
+// its own. Without it the lights keep their place on the thinker list.
+//
+//////////////////////////////////////////////////////////
+
+typedef struct
+{
+  thinker_t **thinkers;
+  int *counts;              // countdowns; unused for glows
+  int num, max;
+} lightbatch_t;
+
+static lightbatch_t randomlights, strobelights, glowlights;
+
+static lightbatch_t *P_LightBatch(const thinker_t *th)
+{
+  if (th->function == T_FireFlicker || th->function == T_LightFlash)
+    return &randomlights;
+  if (th->function == T_StrobeFlash)
+    return &strobelights;
+  if (th->function == T_Glow)
+    return &glowlights;
+  return NULL;
+}
+
+static int *P_LightCount(thinker_t *th)
+{
+  if (th->function == T_FireFlicker)
+    return &((fireflicker_t *) th)->count;
+  if (th->function == T_LightFlash)
+    return &((lightflash_t *) th)->count;
+  return &((strobe_t *) th)->count;
+}
+
+dbool P_IsBatchedLight(const thinker_t *th)
+{
+  return P_LightBatch(th) != NULL;
+}
+
+void P_AddLightThinker(thinker_t *th)
+{
+  lightbatch_t *b = P_LightBatch(th);
+
+  if (b->num == b->max)
+  {
+    b->max = b->max ? b->max*2 : 128;
+    b->thinkers = realloc(b->thinkers, b->max * sizeof *b->thinkers);
+    b->counts = realloc(b->counts, b->max * sizeof *b->counts);
+  }
+  b->thinkers[b->num] = th;
+  b->counts[b->num] = b == &glowlights ? 0 : *P_LightCount(th);
+  b->num++;
+}
+
+void P_RemoveLightThinker(thinker_t *th)
+{
+  lightbatch_t *b = P_LightBatch(th);
+  int i;
+
+  for (i = 0; i < b->num; i++)
+    if (b->thinkers[i] == th)
+    {
+      if (b != &glowlights)
+        *P_LightCount(th) = b->counts[i];
+      b->num--;
+      memmove(b->thinkers + i, b->thinkers + i + 1,
+              (b->num - i) * sizeof *b->thinkers);
+      memmove(b->counts + i, b->counts + i + 1,
+              (b->num - i) * sizeof *b->counts);
+      return;
+    }
+}
+
+//
+// P_ExpireLight
+// Runs a light whose countdown has just run out. Its own count is set
+// so that the thinker takes it to zero and acts; the new countdown it
+// sets is returned.
+//
+
+static int P_ExpireLight(thinker_t *th)
+{
+  int *count = P_LightCount(th);
+
+  *count = 1;
+  th->function(th);
+  return *count;
+}
+
+void P_RunLightThinkers(void)
+{
+  int i;
+
+  for (i = 0; i < randomlights.num; i++)
+    if (!--randomlights.counts[i])
+      randomlights.counts[i] = P_ExpireLight(randomlights.thinkers[i]);
+
+  for (i = 0; i < strobelights.num; i++)
+    if (!--strobelights.counts[i])
+      strobelights.counts[i] = P_ExpireLight(strobelights.thinkers[i]);
+
+  for (i = 0; i < glowlights.num; i++)
+    T_Glow((glow_t *) glowlights.thinkers[i]);
+}
+
+void P_SyncLightThinkers(void)
+{
+  int i;
+
+  for (i = 0; i < randomlights.num; i++)
+    *P_LightCount(randomlights.thinkers[i]) = randomlights.counts[i];
+  for (i = 0; i < strobelights.num; i++)
+    *P_LightCount(strobelights.thinkers[i]) = strobelights.counts[i];
+}
+
+void P_ClearLightThinkers(void)
+{
+  randomlights.num = strobelights.num = glowlights.num = 0;
+}
+
 //////////////////////////////////////////////////////////
 //
 // Sector lighting type spawners
@@ -181,8 +323,9 @@ void P_SpawnFireFlicker (sector_t*  sector)
   // Note that we are resetting sector attributes.
   // Nothing special about it during gameplay.
   sector->special &= ~31; //jff 3/14/98 clear non-generalized sector type
+  P_MarkSectorDirty(sector);
 
-  flick = Z_Malloc ( sizeof(*flick), PU_LEVSPEC, 0);
+  flick = P_AllocThinker(TZ_LIGHT);
 
   memset(flick, 0, sizeof(*flick));
   P_AddThinker (&flick->thinker);
@@ -208,8 +351,9 @@ void P_SpawnLightFlash (sector_t* sector)
 
   // nothing special about it during gameplay
   sector->special &= ~31; //jff 3/14/98 clear non-generalized sector type
+  P_MarkSectorDirty(sector);
 
-  flash = Z_Malloc ( sizeof(*flash), PU_LEVSPEC, 0);
+  flash = P_AllocThinker(TZ_LIGHT);
 
   memset(flash, 0, sizeof(*flash));
   P_AddThinker (&flash->thinker);
@@ -241,7 +385,7 @@ void P_SpawnStrobeFlash
 {
   strobe_t* flash;
 
-  flash = Z_Malloc ( sizeof(*flash), PU_LEVSPEC, 0);
+  flash = P_AllocThinker(TZ_LIGHT);
 
   memset(flash, 0, sizeof(*flash));
   P_AddThinker (&flash->thinker);
@@ -258,6 +402,7 @@ void P_SpawnStrobeFlash
 
   // nothing special about it during gameplay
   sector->special &= ~31; //jff 3/14/98 clear non-generalized sector type
+  P_MarkSectorDirty(sector);
 
   if (!inSync)
     flash->count = (P_Random(pr_lights)&7)+1;
@@ -277,7 +422,7 @@ void P_SpawnGlowingLight(sector_t*  sector)
 {
   glow_t* g;
 
-  g = Z_Malloc( sizeof(*g), PU_LEVSPEC, 0);
+  g = P_AllocThinker(TZ_LIGHT);
 
   memset(g, 0, sizeof(*g));
   P_AddThinker(&g->thinker);
@@ -289,6 +434,7 @@ void P_SpawnGlowingLight(sector_t*  sector)
   g->direction = -1;
 
   sector->special &= ~31; //jff 3/14/98 clear non-generalized sector type
+  P_MarkSectorDirty(sector);
 }
 
 //////////////////////////////////////////////////////////
@@ -352,6 +498,7 @@ int EV_TurnTagLightsOff(line_t* line)
       tsec->lightlevel < min)
     min = tsec->lightlevel;
       sector->lightlevel = min;
+      P_MarkSectorDirty(sector);
     }
   return 1;
 }
@@ -390,6 +537,7 @@ int EV_LightTurnOn(line_t *line, int bright)
       }
 
       sector->lightlevel = tbright;
+      P_MarkSectorDirty(sector);
 
       //jff 5/17/98 unless compatibility optioned
       //then maximum near ANY tagged sector
@@ -438,6 +586,7 @@ int EV_LightTurnOnPartway(line_t *line, fixed_t level)
 
       sector->lightlevel =   // Set level in-between extremes
   (level * bright + (FRACUNIT-level) * min) >> FRACBITS;
+      P_MarkSectorDirty(sector);
     }
   return 1;
 }
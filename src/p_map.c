@@ -45,6 +45,7 @@
 #include "m_random.h"
 #include "m_bbox.h"
 #include "lprintf.h"
+#include "d_bench.h"
 
 static mobj_t    *tmthing;
 static fixed_t   tmx;
@@ -84,9 +85,32 @@ static int    tmunstuck;     /* killough 8/1/98: whether to allow unsticking */
 // 1/11/98 killough: removed limit on special lines crossed
 line_t **spechit;                // new code -- killough
 static int spechit_max;          // killough
+static int spechit_peak;         // most held at once this level
 
 int numspechit;
 
+//
+// P_InitSpechit
+// A check visits each line at most once, so room for every line of the
+// level means spechit never has to grow in the middle of a tic. It is
+// PU_LEVEL memory, gone with the level.
+//
+
+void P_InitSpechit(void)
+{
+  spechit_max = numlines > 8 ? numlines : 8;
+  spechit = Z_Malloc(spechit_max * sizeof *spechit, PU_LEVEL, 0);
+  numspechit = spechit_peak = 0;
+}
+
+void P_ReportSpechit(void)
+{
+  if (spechit_peak)
+    lprintf(LO_INFO, "P_ReportSpechit: at most %d of %d special lines hit\n",
+            spechit_peak, spechit_max);
+  spechit_peak = 0;
+}
+
 // Temporary holder for thing_sectorlist threads
 msecnode_t* sector_list = NULL;                             // phares 3/16/98
 
@@ -129,6 +153,17 @@ dbool PIT_StompThing (mobj_t* thing)
 }
 
 
+// Bumped whenever a sector's special changes in a way that can touch
+// FRICTION_MASK, to drop friction results cached in mobjs. Never 0, which
+// marks a thing's cache empty.
+static unsigned frictiongeneration = 1;
+
+void P_FrictionChanged(void)
+{
+  if (!++frictiongeneration)
+    frictiongeneration++;
+}
+
 /*
  * killough 8/28/98:
  *
@@ -137,7 +172,7 @@ dbool PIT_StompThing (mobj_t* thing)
  * Returns the friction associated with a particular mobj.
  */
 
-int P_GetFriction(const mobj_t *mo, int *frictionfactor)
+int P_GetFriction(mobj_t *mo, int *frictionfactor)
 {
   int friction = ORIG_FRICTION;
   int movefactor = ORIG_FRICTION_FACTOR;
@@ -151,19 +186,37 @@ int P_GetFriction(const mobj_t *mo, int *frictionfactor)
    * When the object is straddling sectors with the same
    * floorheight that have different frictions, use the lowest
    * friction value (muddy has precedence over icy).
+   *
+   * The walk's result only changes with the thing's sector list, its z,
+   * a floor height or a sector special, so it is kept in the mobj until
+   * one of those moves on.
    */
 
   if (!(mo->flags & (MF_NOCLIP|MF_NOGRAVITY))
       && (mbf_features || (mo->player && !compatibility)) &&
       variable_friction)
-    for (m = mo->touching_sectorlist; m; m = m->m_tnext)
-      if ((sec = m->m_sector)->special & FRICTION_MASK &&
-    (sec->friction < friction || friction == ORIG_FRICTION) &&
-    (mo->z <= sec->floorheight ||
-     (sec->heightsec != -1 &&
-      mo->z <= sectors[sec->heightsec].floorheight &&
-      mbf_features)))
-  friction = sec->friction, movefactor = sec->movefactor;
+  {
+    if (mo->frictiongen == frictiongeneration &&
+        mo->frictionsight == sightgeneration && mo->frictionz == mo->z)
+      friction = mo->cachedfriction, movefactor = mo->cachedmovefactor;
+    else
+    {
+      for (m = mo->touching_sectorlist; m; m = SN_TNEXT(m))
+        if ((sec = SN_SECTOR(m))->special & FRICTION_MASK &&
+      (sec->friction < friction || friction == ORIG_FRICTION) &&
+      (mo->z <= sec->floorheight ||
+       (sec->heightsec != -1 &&
+        mo->z <= sectors[sec->heightsec].floorheight &&
+        mbf_features)))
+    friction = sec->friction, movefactor = sec->movefactor;
+
+      mo->frictiongen = frictiongeneration;
+      mo->frictionsight = sightgeneration;
+      mo->frictionz = mo->z;
+      mo->cachedfriction = friction;
+      mo->cachedmovefactor = movefactor;
+    }
+  }
 
   if (frictionfactor)
     *frictionfactor = movefactor;
@@ -303,7 +356,7 @@ dbool P_TeleportMove (mobj_t* thing,fixed_t x,fixed_t y, dbool boss)
 
   for (bx=xl ; bx<=xh ; bx++)
     for (by=yl ; by<=yh ; by++)
-      if (!P_BlockThingsIterator(bx,by,PIT_StompThing))
+      if (!P_BlockThingsInRangeIterator(bx,by,tmx,tmy,tmthing->radius,PIT_StompThing))
         return FALSE;
 
   // the move is ok,
@@ -460,9 +513,11 @@ dbool PIT_CheckLine (line_t* ld)
       // 1/11/98 killough: remove limit on lines hit, by array doubling
       if (numspechit >= spechit_max) {
         spechit_max = spechit_max ? spechit_max*2 : 8;
-	spechit = realloc(spechit,sizeof *spechit*spechit_max); // killough
+	spechit = Z_Realloc(spechit,sizeof *spechit*spechit_max,PU_LEVEL,0); // killough
       }
       spechit[numspechit++] = ld;
+      if (numspechit > spechit_peak)
+        spechit_peak = numspechit;
       // e6y: Spechits overrun emulation code
       if (numspechit >= 8 && demo_compatibility)
         SpechitOverrun(ld);
@@ -753,7 +808,7 @@ dbool P_CheckPosition (mobj_t* thing,fixed_t x,fixed_t y)
 
   for (bx=xl ; bx<=xh ; bx++)
     for (by=yl ; by<=yh ; by++)
-      if (!P_BlockThingsIterator(bx,by,PIT_CheckThing))
+      if (!P_BlockThingsInRangeIterator(bx,by,tmx,tmy,tmthing->radius,PIT_CheckThing))
         return FALSE;
 
   // check lines
@@ -765,7 +820,7 @@ dbool P_CheckPosition (mobj_t* thing,fixed_t x,fixed_t y)
 
   for (bx=xl ; bx<=xh ; bx++)
     for (by=yl ; by<=yh ; by++)
-      if (!P_BlockLinesIterator (bx,by,PIT_CheckLine))
+      if (!P_BlockLinesInBoxIterator (bx,by,tmbbox,PIT_CheckLine))
         return FALSE; // doesn't fit
 
   return TRUE;
@@ -777,8 +832,9 @@ dbool P_CheckPosition (mobj_t* thing,fixed_t x,fixed_t y)
 // Attempt to move to a new position,
 // crossing special lines unless MF_TELEPORT is set.
 //
-dbool P_TryMove(mobj_t* thing,fixed_t x,fixed_t y,
-                  dbool dropoff) // killough 3/15/98: allow dropoff as option
+static INLINE dbool P_DoTryMoveAt(mobj_t* thing,fixed_t x,fixed_t y,
+                  dbool dropoff, // killough 3/15/98: allow dropoff as option
+                  const complevel_t compatibility_level)
   {
   fixed_t oldx;
   fixed_t oldy;
@@ -878,6 +934,48 @@ dbool P_TryMove(mobj_t* thing,fixed_t x,fixed_t y,
   return TRUE;
   }
 
+// Copies of P_DoTryMoveAt for the usual compatibility levels, as for
+// the movement code in p_mobj.c (see P_SelectCompatPaths)
+static dbool P_DoTryMoveDoom2(mobj_t *thing, fixed_t x, fixed_t y, dbool dropoff)
+{ return P_DoTryMoveAt(thing, x, y, dropoff, doom2_19_compatibility); }
+static dbool P_DoTryMoveBoom(mobj_t *thing, fixed_t x, fixed_t y, dbool dropoff)
+{ return P_DoTryMoveAt(thing, x, y, dropoff, boom_compatibility); }
+static dbool P_DoTryMoveMBF(mobj_t *thing, fixed_t x, fixed_t y, dbool dropoff)
+{ return P_DoTryMoveAt(thing, x, y, dropoff, mbf_compatibility); }
+static dbool P_DoTryMoveBest(mobj_t *thing, fixed_t x, fixed_t y, dbool dropoff)
+{ return P_DoTryMoveAt(thing, x, y, dropoff, best_compatibility); }
+static dbool P_DoTryMoveAny(mobj_t *thing, fixed_t x, fixed_t y, dbool dropoff)
+{ return P_DoTryMoveAt(thing, x, y, dropoff, compatibility_level); }
+
+static dbool (*P_DoTryMove)(mobj_t *thing, fixed_t x, fixed_t y, dbool dropoff) = P_DoTryMoveAny;
+static int trymovelevel = -1;
+
+void P_SelectTryMove(void)
+{
+  switch (compatibility_level)
+  {
+    case doom2_19_compatibility: P_DoTryMove = P_DoTryMoveDoom2; break;
+    case boom_compatibility:     P_DoTryMove = P_DoTryMoveBoom;  break;
+    case mbf_compatibility:      P_DoTryMove = P_DoTryMoveMBF;   break;
+    case best_compatibility:     P_DoTryMove = P_DoTryMoveBest;  break;
+    default:                     P_DoTryMove = P_DoTryMoveAny;   break;
+  }
+  trymovelevel = compatibility_level;
+}
+
+dbool P_TryMove(mobj_t* thing, fixed_t x, fixed_t y, dbool dropoff)
+{
+  int64_t start = D_BenchStart();
+  dbool moved;
+
+  if (trymovelevel != (int)compatibility_level)
+    P_SelectTryMove();
+  moved = P_DoTryMove(thing, x, y, dropoff);
+
+  D_BenchStop(BENCH_TRYMOVE, start);
+  return moved;
+}
+
 /*
  * killough 9/12/98:
  *
@@ -984,7 +1082,7 @@ void P_ApplyTorque(mobj_t *mo)
 
   for (bx = xl ; bx <= xh ; bx++)
     for (by = yl ; by <= yh ; by++)
-      P_BlockLinesIterator(bx, by, PIT_ApplyTorque);
+      P_BlockLinesInBoxIterator(bx, by, tmbbox, PIT_ApplyTorque);
 
   /* If any momentum, mark object as 'falling' using engine-internal flags */
   if (mo->momx | mo->momy)
@@ -1022,6 +1120,7 @@ dbool P_ThingHeightClip (mobj_t* thing)
 {
   dbool   onfloor;
 
+  P_WakeMobj(thing); // its floor or ceiling may be moving
   onfloor = (thing->z == thing->floorz);
 
   P_CheckPosition (thing, thing->x, thing->y);
@@ -1658,6 +1757,37 @@ void P_LineAttack
   }
 
 
+//
+// P_StartLineAttacks
+// Call before a burst of P_LineAttack calls from t1 at angles within
+// spread either side of angle, and P_EndLineAttacks after it, so that
+// the lines over the area they cover are gathered once for all of them.
+//
+
+void P_StartLineAttacks(mobj_t *t1, angle_t angle, angle_t spread,
+                        fixed_t distance)
+{
+  fixed_t bbox[4];
+  angle_t an[3];
+  int i;
+
+  an[0] = angle - spread;
+  an[1] = angle;
+  an[2] = angle + spread;
+  M_ClearBox(bbox);
+  M_AddToBox(bbox, t1->x, t1->y);
+  for (i = 0; i < 3; i++)
+    M_AddToBox(bbox,
+               t1->x + (distance>>FRACBITS)*finecosine[an[i]>>ANGLETOFINESHIFT],
+               t1->y + (distance>>FRACBITS)*finesine[an[i]>>ANGLETOFINESHIFT]);
+  P_StartTraceBatch(bbox);
+}
+
+void P_EndLineAttacks(void)
+{
+  P_EndTraceBatch();
+}
+
 //
 // USE LINES
 //
@@ -1843,7 +1973,8 @@ void P_RadiusAttack(mobj_t* spot,mobj_t* source,int damage)
 
   for (y=yl ; y<=yh ; y++)
     for (x=xl ; x<=xh ; x++)
-      P_BlockThingsIterator (x, y, PIT_RadiusAttack );
+      P_BlockThingsInRangeIterator (x, y, spot->x, spot->y, damage<<FRACBITS,
+                                    PIT_RadiusAttack );
 }
 
 
@@ -1864,6 +1995,11 @@ void P_RadiusAttack(mobj_t* spot,mobj_t* source,int damage)
 
 static dbool crushchange, nofit;
 
+// Bumped whenever a sector's touching_thinglist gains, loses or relinks a
+// node, or has its visited marks reset, so P_CheckSector can tell when a
+// thing it processed left the list as it was
+static unsigned int secnodechanges;
+
 //
 // PIT_ChangeSector
 //
@@ -1884,6 +2020,7 @@ dbool PIT_ChangeSector (mobj_t* thing)
     thing->flags &= ~MF_SOLID;
     thing->height = 0;
     thing->radius = 0;
+    P_SyncBlockThing(thing);
     return TRUE; // keep checking
     }
 
@@ -1942,6 +2079,7 @@ dbool P_ChangeSector(sector_t* sector,dbool crunch)
   int   x;
   int   y;
 
+  openinggeneration++;       // the planes of sector have just moved
   nofit = FALSE;
   crushchange = crunch;
 
@@ -1972,6 +2110,7 @@ dbool P_CheckSector(sector_t* sector,dbool crunch)
   if (comp[comp_floors]) /* use the old routine for old demos though */
     return P_ChangeSector(sector,crunch);
 
+  openinggeneration++;       // the planes of sector have just moved
   nofit = FALSE;
   crushchange = crunch;
 
@@ -1982,27 +2121,98 @@ dbool P_CheckSector(sector_t* sector,dbool crunch)
   // Things can arbitrarily be inserted and removed and it won't mess up.
   //
   // killough 4/7/98: simplified to avoid using complicated counter
+  //
+  // Restarting after every thing made big sectors quadratic. Everything up
+  // to the thing just processed is marked, so while the list is unchanged
+  // the first unmarked thing from the start is the next one along, and the
+  // scan carries on from there. Any change to the list starts it over.
 
   // Mark all things invalid
 
-  for (n=sector->touching_thinglist; n; n=n->m_snext)
+  secnodechanges++;
+  for (n=sector->touching_thinglist; n; n=SN_SNEXT(n))
     n->visited = FALSE;
 
-  do
-    for (n=sector->touching_thinglist; n; n=n->m_snext)  // go through list
-      if (!n->visited)               // unprocessed thing found
-        {
-        n->visited  = TRUE;          // mark thing as processed
-        if (!(n->m_thing->flags & MF_NOBLOCKMAP)) //jff 4/7/98 don't do these
-          PIT_ChangeSector(n->m_thing);    // process it
-        break;                 // exit and start over
-        }
-  while (n);  // repeat from scratch until all things left are marked valid
+  n = sector->touching_thinglist;
+  while (n)
+    if (n->visited)
+      n = SN_SNEXT(n);
+    else                             // unprocessed thing found
+      {
+      unsigned int changes = secnodechanges;
+
+      n->visited  = TRUE;            // mark thing as processed
+      if (!(n->m_thing->flags & MF_NOBLOCKMAP)) //jff 4/7/98 don't do these
+        PIT_ChangeSector(n->m_thing);    // process it
+      n = changes == secnodechanges ? SN_SNEXT(n) : sector->touching_thinglist;
+      }
 
   return nofit;
 }
 
 
+#ifdef SECNODE_INDEX_LINKS
+
+// Index links need every node to have a number, so nodes come from
+// chunks of PU_LEVEL memory numbered in order of allocation. Freed nodes
+// are threaded through m_tnext. Index 0 is never handed out, it is the
+// end of a thread.
+
+msecnode_t **secnodechunks;
+static unsigned int numsecnodechunks, maxsecnodechunks;
+static secnodelink_t secnodefree;  // head of the freelist
+static secnodelink_t secnodenext;  // first index never handed out
+
+// P_ClearSecnodes() forgets the chunks, which Z_FreeTags() has already
+// freed with the rest of the previous level.
+
+void P_ClearSecnodes(void)
+{
+  numsecnodechunks = 0;
+  secnodefree = 0;
+  secnodenext = 1;
+}
+
+static msecnode_t* P_GetSecnode(void)
+{
+  msecnode_t* node;
+
+  if (secnodefree)
+    {
+    node = SN_Node(secnodefree);
+    secnodefree = node->m_tnext;
+    return node;
+    }
+
+  if ((secnodenext >> SECNODE_CHUNKSHIFT) == numsecnodechunks)
+    {
+    if (secnodenext > 0x7fffffffu - SECNODE_CHUNKMASK)
+      I_Error("P_GetSecnode: out of sector nodes");
+    if (numsecnodechunks == maxsecnodechunks)
+      {
+      maxsecnodechunks = maxsecnodechunks ? maxsecnodechunks*2 : 64;
+      secnodechunks = realloc(secnodechunks,
+                              maxsecnodechunks*sizeof *secnodechunks);
+      }
+    secnodechunks[numsecnodechunks++] =
+      Z_Malloc(sizeof(msecnode_t) << SECNODE_CHUNKSHIFT, PU_LEVEL, 0);
+    }
+
+  node = SN_Node(secnodenext);
+  node->m_self = secnodenext++;
+  return node;
+}
+
+// P_PutSecnode() returns a node to the freelist.
+
+static INLINE void P_PutSecnode(msecnode_t* node)
+{
+  node->m_tnext = secnodefree;
+  secnodefree = node->m_self;
+}
+
+#else
+
 // CPhipps -
 // Use block memory allocator here
 
@@ -2010,6 +2220,11 @@ dbool P_CheckSector(sector_t* sector,dbool crunch)
 
 IMPLEMENT_BLOCK_MEMORY_ALLOC_ZONE(secnodezone, sizeof(msecnode_t), PU_LEVEL, 32, "SecNodes");
 
+void P_ClearSecnodes(void)
+{
+  NULL_BLOCK_MEMORY_ALLOC_ZONE(secnodezone);
+}
+
 static INLINE msecnode_t* P_GetSecnode(void)
 {
   return (msecnode_t*)Z_BMalloc(&secnodezone);
@@ -2022,6 +2237,8 @@ static INLINE void P_PutSecnode(msecnode_t* node)
   Z_BFree(&secnodezone, node);
 }
 
+#endif
+
 // phares 3/16/98
 //
 // P_AddSecnode() searches the current list to see if this sector is
@@ -2036,35 +2253,37 @@ msecnode_t* P_AddSecnode(sector_t* s, mobj_t* thing, msecnode_t* nextnode)
   node = nextnode;
   while (node)
     {
-    if (node->m_sector == s)   // Already have a node for this sector?
+    if (SN_SECTOR(node) == s)   // Already have a node for this sector?
       {
       node->m_thing = thing; // Yes. Setting m_thing says 'keep it'.
       return(nextnode);
       }
-    node = node->m_tnext;
+    node = SN_TNEXT(node);
     }
 
   // Couldn't find an existing node for this sector. Add one at the head
   // of the list.
 
   node = P_GetSecnode();
+  secnodechanges++;
+  thing->frictiongen = 0;   // its sector list changed
 
   // killough 4/4/98, 4/7/98: mark new nodes unvisited.
   node->visited = 0;
 
-  node->m_sector = s;       // sector
+  SN_SETSECTOR(node, s);    // sector
   node->m_thing  = thing;     // mobj
-  node->m_tprev  = NULL;    // prev node on Thing thread
-  node->m_tnext  = nextnode;  // next node on Thing thread
+  node->m_tprev  = 0;       // prev node on Thing thread
+  node->m_tnext  = SN_LINK(nextnode);  // next node on Thing thread
   if (nextnode)
-    nextnode->m_tprev = node; // set back link on Thing
+    nextnode->m_tprev = SN_LINK(node); // set back link on Thing
 
   // Add new node at head of sector thread starting at s->touching_thinglist
 
-  node->m_sprev  = NULL;    // prev node on sector thread
-  node->m_snext  = s->touching_thinglist; // next node on sector thread
+  node->m_sprev  = 0;       // prev node on sector thread
+  node->m_snext  = SN_LINK(s->touching_thinglist); // next node on sector thread
   if (s->touching_thinglist)
-    node->m_snext->m_sprev = node;
+    s->touching_thinglist->m_sprev = SN_LINK(node);
   s->touching_thinglist = node;
   return(node);
 }
@@ -2083,28 +2302,29 @@ msecnode_t* P_DelSecnode(msecnode_t* node)
 
   if (node)
     {
+    secnodechanges++;
 
     // Unlink from the Thing thread. The Thing thread begins at
     // sector_list and not from mobj_t->touching_sectorlist.
 
-    tp = node->m_tprev;
-    tn = node->m_tnext;
+    tp = SN_TPREV(node);
+    tn = SN_TNEXT(node);
     if (tp)
-      tp->m_tnext = tn;
+      tp->m_tnext = node->m_tnext;
     if (tn)
-      tn->m_tprev = tp;
+      tn->m_tprev = node->m_tprev;
 
     // Unlink from the sector thread. This thread begins at
     // sector_t->touching_thinglist.
 
-    sp = node->m_sprev;
-    sn = node->m_snext;
+    sp = SN_SPREV(node);
+    sn = SN_SNEXT(node);
     if (sp)
-      sp->m_snext = sn;
+      sp->m_snext = node->m_snext;
     else
-      node->m_sector->touching_thinglist = sn;
+      SN_SECTOR(node)->touching_thinglist = sn;
     if (sn)
-      sn->m_sprev = sp;
+      sn->m_sprev = node->m_sprev;
 
     // Return this node to the freelist
 
@@ -2168,6 +2388,34 @@ dbool PIT_GetSectors(line_t* ld)
 }
 
 
+/* cph -
+ * This is the strife we get into for using global variables. tmthing
+ *  is being used by several different functions calling
+ *  P_BlockThingIterator, including functions that can be called *from*
+ *  P_BlockThingIterator. Using a global tmthing is not reentrant.
+ * OTOH for Boom/MBF demos we have to preserve the buggy behavior.
+ *  Fun. We restore its previous value unless we're in a Boom/MBF demo.
+ */
+static void P_RestoreSecNodeGlobals(mobj_t* saved_tmthing,
+                                    fixed_t saved_tmx, fixed_t saved_tmy)
+{
+  if ((compatibility_level < boom_compatibility_compatibility) ||
+      (compatibility_level >= prboom_3_compatibility))
+    tmthing = saved_tmthing;
+  /* And, duh, the same for tmx/y - cph 2002/09/22
+   * And for tmbbox - cph 2003/08/10 */
+  if ((compatibility_level < boom_compatibility_compatibility) /* ||
+      (compatibility_level >= prboom_4_compatibility) */) {
+    tmx = saved_tmx, tmy = saved_tmy;
+    if (tmthing) {
+      tmbbox[BOXTOP]  = tmy + tmthing->radius;
+      tmbbox[BOXBOTTOM] = tmy - tmthing->radius;
+      tmbbox[BOXRIGHT]  = tmx + tmthing->radius;
+      tmbbox[BOXLEFT]   = tmx - tmthing->radius;
+    }
+  }
+}
+
 // phares 3/14/98
 //
 // P_CreateSecNodeList alters/creates the sector_list that shows what sectors
@@ -2182,9 +2430,39 @@ void P_CreateSecNodeList(mobj_t* thing,fixed_t x,fixed_t y)
   int bx;
   int by;
   msecnode_t* node;
-  mobj_t* saved_tmthing = tmthing; /* cph - see comment at func end */
+  const subsector_t *ss = thing->subsector;
+  mobj_t* saved_tmthing = tmthing; /* cph - see P_RestoreSecNodeGlobals */
   fixed_t saved_tmx = tmx, saved_tmy = tmy; /* ditto */
 
+  tmthing = thing;
+
+  tmx = x;
+  tmy = y;
+
+  tmbbox[BOXTOP]  = y + tmthing->radius;
+  tmbbox[BOXBOTTOM] = y - tmthing->radius;
+  tmbbox[BOXRIGHT]  = x + tmthing->radius;
+  tmbbox[BOXLEFT]   = x - tmthing->radius;
+
+  // A box inside its subsector's interior meets no line, so the thing
+  // touches just the sector it stands in; if that is all the old list
+  // holds, the list is already right.
+
+  if (sector_list && !sector_list->m_tnext &&
+      SN_SECTOR(sector_list) == ss->sector &&
+      ss->interior - tmthing->radius > 0)
+    {
+    const int64_t dx = (int64_t)x - ss->interiorx, dy = (int64_t)y - ss->interiory;
+    const int64_t room = ss->interior - tmthing->radius;
+
+    if (dx > -room && dx < room && dy > -room && dy < room)
+      {
+      sector_list->m_thing = thing;
+      P_RestoreSecNodeGlobals(saved_tmthing, saved_tmx, saved_tmy);
+      return;
+      }
+    }
+
   // First, clear out the existing m_thing fields. As each node is
   // added or verified as needed, m_thing will be set properly. When
   // finished, delete all nodes where m_thing is still NULL. These
@@ -2194,19 +2472,9 @@ void P_CreateSecNodeList(mobj_t* thing,fixed_t x,fixed_t y)
   while (node)
     {
     node->m_thing = NULL;
-    node = node->m_tnext;
+    node = SN_TNEXT(node);
     }
 
-  tmthing = thing;
-
-  tmx = x;
-  tmy = y;
-
-  tmbbox[BOXTOP]  = y + tmthing->radius;
-  tmbbox[BOXBOTTOM] = y - tmthing->radius;
-  tmbbox[BOXRIGHT]  = x + tmthing->radius;
-  tmbbox[BOXLEFT]   = x - tmthing->radius;
-
   validcount++; // used to make sure we only process a line once
 
   xl = (tmbbox[BOXLEFT] - bmaporgx)>>MAPBLOCKSHIFT;
@@ -2216,7 +2484,7 @@ void P_CreateSecNodeList(mobj_t* thing,fixed_t x,fixed_t y)
 
   for (bx=xl ; bx<=xh ; bx++)
     for (by=yl ; by<=yh ; by++)
-      P_BlockLinesIterator(bx,by,PIT_GetSectors);
+      P_BlockLinesInBoxIterator(bx,by,tmbbox,PIT_GetSectors);
 
   // Add the sector of the (x,y) point to sector_list.
 
@@ -2231,36 +2499,61 @@ void P_CreateSecNodeList(mobj_t* thing,fixed_t x,fixed_t y)
     if (node->m_thing == NULL)
       {
       if (node == sector_list)
-        sector_list = node->m_tnext;
+        sector_list = SN_TNEXT(node);
+      thing->frictiongen = 0;
       node = P_DelSecnode(node);
       }
     else
-      node = node->m_tnext;
+      node = SN_TNEXT(node);
     }
 
-  /* cph -
-   * This is the strife we get into for using global variables. tmthing
-   *  is being used by several different functions calling
-   *  P_BlockThingIterator, including functions that can be called *from*
-   *  P_BlockThingIterator. Using a global tmthing is not reentrant.
-   * OTOH for Boom/MBF demos we have to preserve the buggy behavior.
-   *  Fun. We restore its previous value unless we're in a Boom/MBF demo.
-   */
-  if ((compatibility_level < boom_compatibility_compatibility) ||
-      (compatibility_level >= prboom_3_compatibility))
-    tmthing = saved_tmthing;
-  /* And, duh, the same for tmx/y - cph 2002/09/22
-   * And for tmbbox - cph 2003/08/10 */
-  if ((compatibility_level < boom_compatibility_compatibility) /* ||
-      (compatibility_level >= prboom_4_compatibility) */) {
-    tmx = saved_tmx, tmy = saved_tmy;
-    if (tmthing) {
-      tmbbox[BOXTOP]  = tmy + tmthing->radius;
-      tmbbox[BOXBOTTOM] = tmy - tmthing->radius;
-      tmbbox[BOXRIGHT]  = tmx + tmthing->radius;
-      tmbbox[BOXLEFT]   = tmx - tmthing->radius;
+  P_RestoreSecNodeGlobals(saved_tmthing, saved_tmx, saved_tmy);
+}
+
+// P_RelinkSecNodeList puts a sector_list that P_CreateSecNodeList made
+// for the thing at x,y, starting from an empty sector_list, back into
+// sector threads that have since been emptied. The nodes go back at the
+// head of their sectors' threads in the order they were made, tail of
+// the thing thread first, so the threads and the globals come out as a
+// new P_CreateSecNodeList would leave them, bar validcount, which only
+// ever has to move on.
+
+void P_RelinkSecNodeList(mobj_t* thing,fixed_t x,fixed_t y)
+{
+  msecnode_t* node = sector_list;
+  mobj_t* saved_tmthing = tmthing;
+  fixed_t saved_tmx = tmx, saved_tmy = tmy;
+
+  tmthing = thing;
+
+  tmx = x;
+  tmy = y;
+
+  tmbbox[BOXTOP]  = y + tmthing->radius;
+  tmbbox[BOXBOTTOM] = y - tmthing->radius;
+  tmbbox[BOXRIGHT]  = x + tmthing->radius;
+  tmbbox[BOXLEFT]   = x - tmthing->radius;
+
+  if (node)
+    {
+    sector_t* s;
+
+    secnodechanges++;
+    while (node->m_tnext)
+      node = SN_TNEXT(node);
+    for ( ; node ; node = SN_TPREV(node))
+      {
+      s = SN_SECTOR(node);
+      node->visited = 0;
+      node->m_sprev = 0;
+      node->m_snext = SN_LINK(s->touching_thinglist);
+      if (s->touching_thinglist)
+        s->touching_thinglist->m_sprev = SN_LINK(node);
+      s->touching_thinglist = node;
+      }
     }
-  }
+
+  P_RestoreSecNodeGlobals(saved_tmthing, saved_tmx, saved_tmy);
 }
 
 /* cphipps 2004/08/30 - 
@@ -50,11 +50,23 @@
 
 // killough 3/15/98: add fourth argument to P_TryMove
 dbool P_TryMove(mobj_t *thing, fixed_t x, fixed_t y, dbool dropoff);
+void P_SelectTryMove(void);  // see P_SelectCompatPaths
 
 // killough 8/9/98: extra argument for telefragging
 dbool P_TeleportMove(mobj_t *thing, fixed_t x, fixed_t y,dbool boss);
 void    P_SlideMove(mobj_t *mo);
 dbool P_CheckSight(mobj_t *t1, mobj_t *t2);
+void    P_ReportSightCache(void);
+// Room in spechit for the level's lines, and what the level used of it
+void    P_InitSpechit(void);
+void    P_ReportSpechit(void);
+// Bumped whenever a floor or ceiling moves, to drop cached sight checks
+extern unsigned sightgeneration;
+// Walk the blockmap rather than the BSP tree for sight checks
+extern int blockmap_sight;
+// Trace likely sight checks on the job pool before the thinkers run
+extern int sight_precompute;
+void P_PrecomputeSight(void);
 void    P_UseLines(player_t *player);
 
 // killough 8/2/98: add 'mask' argument to prevent friends autoaiming at others
@@ -62,6 +74,9 @@ fixed_t P_AimLineAttack(mobj_t *t1,angle_t angle,fixed_t distance, uint64_t mask
 
 void    P_LineAttack(mobj_t *t1, angle_t angle, fixed_t distance,
                      fixed_t slope, int damage );
+void    P_StartLineAttacks(mobj_t *t1, angle_t angle, angle_t spread,
+                           fixed_t distance);
+void    P_EndLineAttacks(void);
 void    P_RadiusAttack(mobj_t *spot, mobj_t *source, int damage);
 dbool P_CheckPosition(mobj_t *thing, fixed_t x, fixed_t y);
 
@@ -69,11 +84,15 @@ dbool P_CheckPosition(mobj_t *thing, fixed_t x, fixed_t y);
 dbool P_ChangeSector(sector_t* sector,dbool crunch);
 dbool P_CheckSector(sector_t *sector, dbool crunch);
 void    P_DelSeclist(msecnode_t*);                          // phares 3/16/98
+void    P_ClearSecnodes(void);
 void    P_CreateSecNodeList(mobj_t*,fixed_t,fixed_t);       // phares 3/14/98
+void    P_RelinkSecNodeList(mobj_t*,fixed_t,fixed_t);
 dbool Check_Sides(mobj_t *, int, int);                    // phares
 
 int     P_GetMoveFactor(mobj_t *mo, int *friction);         // killough 8/28/98
-int     P_GetFriction(const mobj_t *mo, int *factor);       // killough 8/28/98
+int     P_GetFriction(mobj_t *mo, int *factor);             // killough 8/28/98
+// Drops cached friction after a sector special changes
+void    P_FrictionChanged(void);
 void    P_ApplyTorque(mobj_t *mo);                          // killough 9/12/98
 
 /* cphipps 2004/08/30 */
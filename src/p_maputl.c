@@ -40,6 +40,8 @@
 #include "p_maputl.h"
 #include "p_map.h"
 #include "p_setup.h"
+#include "lprintf.h"
+#include "d_bench.h"
 
 //
 // P_AproxDistance
@@ -166,7 +168,6 @@ fixed_t P_InterceptVector(const divline_t *v2, const divline_t *v1)
 // P_LineOpening
 // Sets opentop and openbottom to the window
 // through a two sided line.
-// OPTIMIZE: keep this precalculated
 //
 
 fixed_t opentop;
@@ -180,8 +181,21 @@ fixed_t lowfloor;
 sector_t *openfrontsector; // made global                    // phares
 sector_t *openbacksector;  // made global
 
+// Each line's opening as of openinggeneration, which goes up whenever a
+// sector's floor or ceiling may have moved
+typedef struct {
+  unsigned generation;
+  fixed_t top, bottom, range, lowfloor;
+} lineopening_t;
+
+unsigned openinggeneration;
+static lineopening_t *lineopenings;
+static int lineopeningmax;
+
 void P_LineOpening(const line_t *linedef)
 {
+  lineopening_t *lo;
+
   if (linedef->sidenum[1] == NO_INDEX)      // single sided line
     {
       openrange = 0;
@@ -191,28 +205,229 @@ void P_LineOpening(const line_t *linedef)
   openfrontsector = linedef->frontsector;
   openbacksector = linedef->backsector;
 
-  if (openfrontsector->ceilingheight < openbacksector->ceilingheight)
-    opentop = openfrontsector->ceilingheight;
-  else
-    opentop = openbacksector->ceilingheight;
-
-  if (openfrontsector->floorheight > openbacksector->floorheight)
+  lo = &lineopenings[linedef - lines];
+  if (lo->generation != openinggeneration)
     {
-      openbottom = openfrontsector->floorheight;
-      lowfloor = openbacksector->floorheight;
+      if (openfrontsector->ceilingheight < openbacksector->ceilingheight)
+        lo->top = openfrontsector->ceilingheight;
+      else
+        lo->top = openbacksector->ceilingheight;
+
+      if (openfrontsector->floorheight > openbacksector->floorheight)
+        {
+          lo->bottom = openfrontsector->floorheight;
+          lo->lowfloor = openbacksector->floorheight;
+        }
+      else
+        {
+          lo->bottom = openbacksector->floorheight;
+          lo->lowfloor = openfrontsector->floorheight;
+        }
+      lo->range = lo->top - lo->bottom;
+      lo->generation = openinggeneration;
     }
-  else
+
+  opentop = lo->top;
+  openbottom = lo->bottom;
+  openrange = lo->range;
+  lowfloor = lo->lowfloor;
+}
+
+//
+// P_ResetLineOpenings
+// Call once the lines of a level are loaded
+//
+
+void P_ResetLineOpenings(void)
+{
+  if (numlines > lineopeningmax)
     {
-      openbottom = openbacksector->floorheight;
-      lowfloor = openfrontsector->floorheight;
+      lineopeningmax = numlines;
+      lineopenings = realloc(lineopenings, lineopeningmax * sizeof(*lineopenings));
     }
-  openrange = opentop - openbottom;
+  memset(lineopenings, 0, numlines * sizeof(*lineopenings));
+  openinggeneration = 1;
 }
 
 //
 // THING POSITION SETTING
 //
 
+//
+// THINGS IN THE BLOCKMAP
+//
+// Each cell keeps its things in an array, oldest first, with the
+// position and radius of each alongside so the ranged iterator can pass
+// over things out of reach without touching their mobj_t. Removal keeps
+// the order, so the iterators visit things in the order the old linked
+// lists did: newest first.
+//
+// A thing can be unlinked from the cell being iterated by the iterator's
+// own function, as when a pickup is removed. Each running iterator keeps
+// a cursor that removals move down to stay on the same thing.
+//
+
+typedef struct blockcursor_s {
+  const blockthings_t *cell;
+  int index;
+  struct blockcursor_s *prev;
+} blockcursor_t;
+
+static blockcursor_t *blockcursors;
+
+// Bumped whenever a thing is linked, unlinked or synced, so that traces
+// can tell whether the things they gathered are still where they were
+static unsigned blockthinggeneration;
+
+//
+// The target grid counts the monsters in each group of mapblocks by the
+// side they are on, so that searches for targets can pass over blocks
+// with none of the side they want. A thing's side is taken when it is
+// linked and whenever P_UpdateTargetGrid is called after its flags
+// change in place; health is left out, so the counts only ever include
+// more things than a search would accept, never fewer.
+//
+
+static int P_TargetSide(const mobj_t *thing)
+{
+  if (!(thing->flags & MF_ISMONSTER))
+    return TG_NONE;
+  return thing->flags & MF_FRIEND ? TG_FRIENDS : TG_ENEMIES;
+}
+
+static int *P_TargetCount(const blockthings_t *bt, int side)
+{
+  int cell = bt - blockthings;
+  int gx = (cell % bmapwidth) >> TARGETGRIDSHIFT;
+  int gy = (cell / bmapwidth) >> TARGETGRIDSHIFT;
+
+  return &targetgrid[gy*targetgridwidth + gx][side];
+}
+
+static void P_AddBlockThing(mobj_t *thing, blockthings_t *bt)
+{
+  blockthing_t *entry;
+
+  if (bt->count == bt->max)
+    {
+      bt->max = bt->max ? bt->max*2 : 4;
+      bt->things = Z_Realloc(bt->things, bt->max * sizeof(*bt->things), PU_LEVEL, 0);
+    }
+  entry = &bt->things[bt->count++];
+  entry->mobj = thing;
+  entry->x = thing->x;
+  entry->y = thing->y;
+  entry->radius = thing->radius;
+  blockthinggeneration++;
+  if ((entry->side = P_TargetSide(thing)) != TG_NONE)
+    (*P_TargetCount(bt, entry->side))++;
+  thing->blockcell = bt;
+}
+
+static blockthing_t *P_FindBlockThing(const mobj_t *thing)
+{
+  blockthings_t *bt = thing->blockcell;
+  int i;
+
+  for (i = bt->count; --i >= 0; )
+    if (bt->things[i].mobj == thing)
+      return &bt->things[i];
+  I_Error("P_FindBlockThing: thing not in its blockmap cell");
+  return NULL;
+}
+
+static void P_RemoveBlockThing(mobj_t *thing)
+{
+  blockthings_t *bt = thing->blockcell;
+  blockthing_t *entry = P_FindBlockThing(thing);
+  blockcursor_t *cur;
+  int i;
+
+  thing->blockcell = NULL;
+  if (!entry)
+    return;
+  i = entry - bt->things;
+  blockthinggeneration++;
+  if (entry->side != TG_NONE)
+    (*P_TargetCount(bt, entry->side))--;
+  memmove(&bt->things[i], &bt->things[i+1], (--bt->count - i) * sizeof(*bt->things));
+  for (cur = blockcursors; cur; cur = cur->prev)
+    if (cur->cell == bt && cur->index > i)
+      cur->index--;
+}
+
+//
+// P_SyncBlockThing
+// Call after changing the position or radius of a thing that is left
+// linked where it was.
+//
+
+void P_SyncBlockThing(mobj_t *thing)
+{
+  blockthing_t *entry;
+
+  if (thing->blockcell && (entry = P_FindBlockThing(thing)))
+    {
+      entry->x = thing->x;
+      entry->y = thing->y;
+      entry->radius = thing->radius;
+      blockthinggeneration++;
+    }
+}
+
+//
+// P_UpdateTargetGrid
+// Call after changing the MF_FRIEND or MF_ISMONSTER flag of a thing that
+// is left linked where it was.
+//
+
+void P_UpdateTargetGrid(mobj_t *thing)
+{
+  blockthing_t *entry;
+  int side;
+
+  if (!thing->blockcell || !(entry = P_FindBlockThing(thing)))
+    return;
+  side = P_TargetSide(thing);
+  if (side == entry->side)
+    return;
+  if (entry->side != TG_NONE)
+    (*P_TargetCount(thing->blockcell, entry->side))--;
+  if ((entry->side = side) != TG_NONE)
+    (*P_TargetCount(thing->blockcell, side))++;
+}
+
+//
+// P_TargetsInBlocks
+// Returns whether the target grid has any monsters of the given side in
+// the groups of mapblocks covering x1..x2, y1..y2. Blocks off the map
+// have none.
+//
+
+dbool P_TargetsInBlocks(int x1, int y1, int x2, int y2, int side)
+{
+  int gx, gy;
+
+  if (x1 < 0)
+    x1 = 0;
+  if (y1 < 0)
+    y1 = 0;
+  if (x2 >= bmapwidth)
+    x2 = bmapwidth-1;
+  if (y2 >= bmapheight)
+    y2 = bmapheight-1;
+  if (x1 > x2 || y1 > y2)
+    return FALSE;
+  x1 >>= TARGETGRIDSHIFT;
+  x2 >>= TARGETGRIDSHIFT;
+  y2 >>= TARGETGRIDSHIFT;
+  for (gy = y1 >> TARGETGRIDSHIFT; gy <= y2; gy++)
+    for (gx = x1; gx <= x2; gx++)
+      if (targetgrid[gy*targetgridwidth + gx][side])
+        return TRUE;
+  return FALSE;
+}
+
 //
 // P_UnsetThingPosition
 // Unlinks a thing from block map and sectors.
@@ -254,22 +469,15 @@ void P_UnsetThingPosition (mobj_t *thing)
       thing->touching_sectorlist = NULL; //to be restored by P_SetThingPosition
     }
 
-  if (!(thing->flags & MF_NOBLOCKMAP))
+  if (!(thing->flags & MF_NOBLOCKMAP) && thing->blockcell)
     {
       /* inert things don't need to be in blockmap
        *
-       * killough 8/11/98: simpler scheme using pointers-to-pointers for prev
-       * pointers, allows head node pointers to be treated like everything else
-       *
-       * Also more robust, since it doesn't depend on current position for
-       * unlinking. Old method required computing head node based on position
-       * at time of unlinking, assuming it was the same position as during
-       * linking.
+       * Unlinking goes by the cell the thing was put in, not its current
+       * position, which needn't be the same
        */
 
-      mobj_t *bnext, **bprev = thing->bprev;
-      if (bprev && (*bprev = bnext = thing->bnext))  // unlink from block map
-        bnext->bprev = bprev;
+      P_RemoveBlockThing(thing);
     }
 }
 
@@ -280,10 +488,14 @@ void P_UnsetThingPosition (mobj_t *thing)
 // Sets thing->subsector properly
 //
 // killough 5/3/98: reformatted, cleaned up
+//
+// With relink, the thing keeps the touching_sectorlist it already has,
+// see P_RelinkThingPosition.
 
-void P_SetThingPosition(mobj_t *thing)
+static void P_LinkThingPosition(mobj_t *thing, dbool relink)
 {                                                      // link into subsector
   subsector_t *ss = thing->subsector = R_PointInSubsector(thing->x, thing->y);
+  P_WakeMobj(thing);
   if (!(thing->flags & MF_NOSECTOR))
     {
       // invisible things don't go into the sector links
@@ -311,7 +523,13 @@ void P_SetThingPosition(mobj_t *thing)
       // at sector_t->touching_thinglist) are broken. When a node is
       // added, new sector links are created.
 
-      P_CreateSecNodeList(thing,thing->x,thing->y);
+      if (relink)
+        {
+          sector_list = thing->touching_sectorlist;
+          P_RelinkSecNodeList(thing,thing->x,thing->y);
+        }
+      else
+        P_CreateSecNodeList(thing,thing->x,thing->y);
       thing->touching_sectorlist = sector_list; // Attach to Thing's mobj_t
       sector_list = NULL; // clear for next time
     }
@@ -323,22 +541,52 @@ void P_SetThingPosition(mobj_t *thing)
       int blockx = (thing->x - bmaporgx)>>MAPBLOCKSHIFT;
       int blocky = (thing->y - bmaporgy)>>MAPBLOCKSHIFT;
       if (blockx>=0 && blockx < bmapwidth && blocky>=0 && blocky < bmapheight)
-        {
-        // killough 8/11/98: simpler scheme using pointer-to-pointer prev
-        // pointers, allows head nodes to be treated like everything else
-
-        mobj_t **link = &blocklinks[blocky*bmapwidth+blockx];
-        mobj_t *bnext = *link;
-        if ((thing->bnext = bnext))
-          bnext->bprev = &thing->bnext;
-        thing->bprev = link;
-        *link = thing;
-      }
+        P_AddBlockThing(thing, &blockthings[blocky*bmapwidth+blockx]);
       else        // thing is off the map
-        thing->bnext = NULL, thing->bprev = NULL;
+        thing->blockcell = NULL;
     }
 }
 
+void P_SetThingPosition(mobj_t *thing)
+{
+  P_LinkThingPosition(thing, FALSE);
+}
+
+//
+// P_RelinkThingPosition
+// As P_SetThingPosition, after P_ClearThingLinks, for a thing still at
+// the x, y and radius that its touching_sectorlist was made for by
+// P_SetThingPosition. Its sector nodes are linked back in place of new
+// ones being made, with the same result.
+//
+
+void P_RelinkThingPosition(mobj_t *thing)
+{
+  P_LinkThingPosition(thing, TRUE);
+}
+
+//
+// P_ClearThingLinks
+// Empties the sector and blockmap links of every thing at once, for
+// when the whole level's things are being taken down together. The
+// things' own links are left stale for the caller to deal with.
+//
+
+void P_ClearThingLinks(void)
+{
+  int i;
+
+  for (i = 0; i < numsectors; i++)
+    {
+      sectors[i].thinglist = NULL;
+      sectors[i].touching_thinglist = NULL;
+    }
+  for (i = bmapwidth*bmapheight; --i >= 0; )
+    blockthings[i].count = 0;
+  memset(targetgrid, 0, (size_t) targetgridwidth*targetgridheight*sizeof(*targetgrid));
+  blockthinggeneration++;
+}
+
 //
 // BLOCK MAP ITERATORS
 // For each line/thing in the given mapblock,
@@ -359,25 +607,25 @@ void P_SetThingPosition(mobj_t *thing)
 
 dbool P_BlockLinesIterator(int x, int y, dbool func(line_t*))
 {
-  int        offset;
-  const long *list;   // killough 3/1/98: for removal of blockmap limit
+  int cell, i, end;
 
   if (x<0 || y<0 || x>=bmapwidth || y>=bmapheight)
     return TRUE;
-  offset = y*bmapwidth+x;
-  offset = *(blockmap+offset);
-  list = blockmaplump+offset;     // original was reading         // phares
-                                  // delmiting 0 as linedef 0     // phares
+  cell = y*bmapwidth+x;
+  i = blockcells[cell];
+  end = blockcells[cell+1];
 
   // killough 1/31/98: for compatibility we need to use the old method.
   // Most demos go out of sync, and maybe other problems happen, if we
   // don't consider linedef 0. For safety this should be qualified.
 
   if (!demo_compatibility) // killough 2/22/98: demo_compatibility check
-    list++;     // skip 0 starting delimiter                      // phares
-  for ( ; *list != -1 ; list++)                                   // phares
+    i++;        // skip 0 starting delimiter                      // phares
+  else if (blocklines[i] == -1)
+    return TRUE;
+  for ( ; i < end ; i++)
     {
-      line_t *ld = &lines[*list];
+      line_t *ld = &lines[blocklines[i]];
       if (ld->validcount == validcount)
         continue;       // line has already been checked
       ld->validcount = validcount;
@@ -387,6 +635,48 @@ dbool P_BlockLinesIterator(int x, int y, dbool func(line_t*))
   return TRUE;  // everything was checked
 }
 
+//
+// P_BlockLinesInBoxIterator
+// As P_BlockLinesIterator, but only calls func for lines whose
+// bounding boxes overlap bbox, tested on the packed boxes kept with
+// the cell before the line_t is touched. Only for functions that would
+// return TRUE straight away for a line outside bbox, with the same
+// strict test, as a skipped line isn't marked with validcount.
+//
+
+dbool P_BlockLinesInBoxIterator(int x, int y, const fixed_t *bbox,
+                                dbool func(line_t*))
+{
+  int cell, i, end;
+
+  if (x<0 || y<0 || x>=bmapwidth || y>=bmapheight)
+    return TRUE;
+  cell = y*bmapwidth+x;
+  i = blockcells[cell];
+  end = blockcells[cell+1];
+
+  if (!demo_compatibility)
+    i++;
+  else if (blocklines[i] == -1)
+    return TRUE;
+  for ( ; i < end ; i++)
+    {
+      const fixed_t *box = blocklinebox[i];
+      line_t *ld;
+
+      if (bbox[BOXRIGHT] <= box[BOXLEFT] || bbox[BOXLEFT] >= box[BOXRIGHT] ||
+          bbox[BOXTOP] <= box[BOXBOTTOM] || bbox[BOXBOTTOM] >= box[BOXTOP])
+        continue;
+      ld = &lines[blocklines[i]];
+      if (ld->validcount == validcount)
+        continue;
+      ld->validcount = validcount;
+      if (!func(ld))
+        return FALSE;
+    }
+  return TRUE;
+}
+
 //
 // P_BlockThingsIterator
 //
@@ -394,12 +684,58 @@ dbool P_BlockLinesIterator(int x, int y, dbool func(line_t*))
 
 dbool P_BlockThingsIterator(int x, int y, dbool func(mobj_t*))
 {
-  mobj_t *mobj;
-  if (!(x<0 || y<0 || x>=bmapwidth || y>=bmapheight))
-    for (mobj = blocklinks[y*bmapwidth+x]; mobj; mobj = mobj->bnext)
-      if (!func(mobj))
-        return FALSE;
-  return TRUE;
+  blockcursor_t cur;
+  dbool ret = TRUE;
+
+  if (x<0 || y<0 || x>=bmapwidth || y>=bmapheight)
+    return TRUE;
+  cur.cell = &blockthings[y*bmapwidth+x];
+  cur.prev = blockcursors;
+  blockcursors = &cur;
+  for (cur.index = cur.cell->count; --cur.index >= 0; )
+    if (!func(cur.cell->things[cur.index].mobj))
+      {
+        ret = FALSE;
+        break;
+      }
+  blockcursors = cur.prev;
+  return ret;
+}
+
+//
+// P_BlockThingsInRangeIterator
+// As P_BlockThingsIterator, but passes over things for which
+// D_abs(thing->x - x) or D_abs(thing->y - y) is at least
+// thing->radius + range, using the copies kept in the cell. Only for
+// functions that would return TRUE straight away for those things.
+//
+
+dbool P_BlockThingsInRangeIterator(int bx, int by, fixed_t x, fixed_t y,
+                                   fixed_t range, dbool func(mobj_t*))
+{
+  blockcursor_t cur;
+  dbool ret = TRUE;
+
+  if (bx<0 || by<0 || bx>=bmapwidth || by>=bmapheight)
+    return TRUE;
+  cur.cell = &blockthings[by*bmapwidth+bx];
+  cur.prev = blockcursors;
+  blockcursors = &cur;
+  for (cur.index = cur.cell->count; --cur.index >= 0; )
+    {
+      const blockthing_t *bt = &cur.cell->things[cur.index];
+      fixed_t dist = bt->radius + range;
+
+      if (D_abs(bt->x - x) >= dist || D_abs(bt->y - y) >= dist)
+        continue;
+      if (!func(bt->mobj))
+        {
+          ret = FALSE;
+          break;
+        }
+    }
+  blockcursors = cur.prev;
+  return ret;
 }
 
 //
@@ -409,19 +745,56 @@ dbool P_BlockThingsIterator(int x, int y, dbool func(mobj_t*))
 // 1/11/98 killough: Intercept limit removed
 static intercept_t *intercepts, *intercept_p;
 
+// Scratch space for P_SortIntercepts, as large as intercepts
+static intercept_t *sortintercepts;
+
+static size_t num_intercepts, intercepts_peak;
+
+//
+// P_InitIntercepts
+// Sizes intercepts for a level before it starts, out of PU_LEVEL memory,
+// so a trace only has to grow them when count wasn't enough.
+//
+
+void P_InitIntercepts(size_t count)
+{
+  num_intercepts = count > 128 ? count : 128;
+  intercepts = Z_Malloc(sizeof(*intercepts)*num_intercepts, PU_LEVEL, 0);
+  sortintercepts = Z_Malloc(sizeof(*sortintercepts)*num_intercepts, PU_LEVEL, 0);
+  intercept_p = intercepts;
+  intercepts_peak = 0;
+}
+
+void P_ReportIntercepts(void)
+{
+  if (intercepts_peak)
+    lprintf(LO_INFO, "P_ReportIntercepts: at most %u of %u intercepts\n",
+            (unsigned)intercepts_peak, (unsigned)num_intercepts);
+  intercepts_peak = 0;
+}
+
 // Check for limit and double size if necessary -- killough
-static void check_intercept(void)
+static void reserve_intercepts(size_t needed)
 {
-  static size_t num_intercepts;
   size_t offset = intercept_p - intercepts;
-  if (offset >= num_intercepts)
+  if (needed > intercepts_peak)
+    intercepts_peak = needed;
+  if (needed > num_intercepts)
     {
       num_intercepts = num_intercepts ? num_intercepts*2 : 128;
-      intercepts = realloc(intercepts, sizeof(*intercepts)*num_intercepts);
+      while (num_intercepts < needed)
+        num_intercepts *= 2;
+      intercepts = Z_Realloc(intercepts, sizeof(*intercepts)*num_intercepts, PU_LEVEL, 0);
+      sortintercepts = Z_Realloc(sortintercepts, sizeof(*sortintercepts)*num_intercepts, PU_LEVEL, 0);
       intercept_p = intercepts + offset;
     }
 }
 
+static void check_intercept(void)
+{
+  reserve_intercepts(intercept_p - intercepts + 1);
+}
+
 divline_t trace;
 
 // PIT_AddLineIntercepts.
@@ -529,33 +902,312 @@ dbool PIT_AddThingIntercepts(mobj_t *thing)
   return TRUE;          // keep going
 }
 
+//
+// P_SortIntercepts
+// Stable sort of the intercepts by frac, so that ties stay in the
+// order they were added in: the order the old selection scan in
+// P_TraverseIntercepts visited them, which demos depend on.
+// Intercepts come in block by block along the trace and are close to
+// sorted already, so runs are insertion sorted and then merged.
+//
+
+#define INTERCEPT_RUN 16
+
+static void P_SortIntercepts(void)
+{
+  int count = intercept_p - intercepts;
+  intercept_t *src = intercepts, *dst = sortintercepts;
+  int run, i;
+
+  for (run = 0; run < count; run += INTERCEPT_RUN)
+    {
+      int end = MIN(run + INTERCEPT_RUN, count);
+
+      for (i = run + 1; i < end; i++)
+        {
+          intercept_t in = intercepts[i];
+          int j = i;
+
+          for (; j > run && intercepts[j-1].frac > in.frac; j--)
+            intercepts[j] = intercepts[j-1];
+          intercepts[j] = in;
+        }
+    }
+
+  for (run = INTERCEPT_RUN; run < count; run *= 2)
+    {
+      intercept_t *t;
+      int lo;
+
+      for (lo = 0; lo < count; lo += 2*run)
+        {
+          int mid = MIN(lo + run, count), hi = MIN(lo + 2*run, count);
+          int a = lo, b = mid;
+
+          // take from the left run on ties to keep the sort stable
+          for (i = lo; i < hi; i++)
+            dst[i] = b >= hi || (a < mid && src[a].frac <= src[b].frac) ?
+              src[a++] : src[b++];
+        }
+      t = src, src = dst, dst = t;
+    }
+
+  if (src != intercepts)
+    memcpy(intercepts, src, count * sizeof(*intercepts));
+}
+
 //
 // P_TraverseIntercepts
+// Walks the sorted intercepts.
 // Returns TRUE if the traverser function returns TRUE
 // for all lines.
 //
 // killough 5/3/98: reformatted, cleaned up
 
-dbool P_TraverseIntercepts(traverser_t func, fixed_t maxfrac)
+static dbool P_TraverseIntercepts(traverser_t func, fixed_t maxfrac)
 {
-  intercept_t *in = NULL;
-  int count = intercept_p - intercepts;
-  while (count--)
+  int i;
+
+  // indexed rather than walked by pointer, as a traverser that starts
+  // another trace may move the intercepts
+  for (i = 0; intercepts + i < intercept_p; i++)
     {
-      fixed_t dist = INT_MAX;
-      intercept_t *scan;
-      for (scan = intercepts; scan < intercept_p; scan++)
-        if (scan->frac < dist)
-          dist = (in=scan)->frac;
-      if (dist > maxfrac)
+      if (intercepts[i].frac > maxfrac)
         return TRUE;    // checked everything in range
-      if (!func(in))
+      if (!func(&intercepts[i]))
         return FALSE;           // don't bother going farther
-      in->frac = INT_MAX;
     }
   return TRUE;                  // everything was traversed
 }
 
+//
+// The sorted intercepts of the last trace are kept, so a trace along the
+// same ray that follows it, as a melee attack follows its aim or a use
+// its check, walks them again without gathering. Lines never move, so
+// a trace gathering only lines stays good for the level; one with things
+// as well only until a thing is linked, unlinked or synced.
+//
+
+static struct {
+  fixed_t     x1, y1, x2, y2;
+  int         flags;
+  unsigned    generation;
+  dbool       valid;
+  intercept_t *intercepts;
+  int         count, max;
+} tracecache;
+
+void P_ClearTraceCache(void)
+{
+  tracecache.valid = FALSE;
+}
+
+static dbool P_TraceCached(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
+                           int flags)
+{
+  if (!tracecache.valid || tracecache.flags != flags ||
+      tracecache.x1 != x1 || tracecache.y1 != y1 ||
+      tracecache.x2 != x2 || tracecache.y2 != y2 ||
+      (flags & PT_ADDTHINGS && tracecache.generation != blockthinggeneration))
+    return FALSE;
+  reserve_intercepts(tracecache.count);
+  memcpy(intercepts, tracecache.intercepts,
+         tracecache.count * sizeof(*intercepts));
+  intercept_p = intercepts + tracecache.count;
+  return TRUE;
+}
+
+static void P_CacheTrace(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
+                         int flags)
+{
+  int count = intercept_p - intercepts;
+
+  if (count > tracecache.max)
+    {
+      tracecache.max = count;
+      tracecache.intercepts = realloc(tracecache.intercepts,
+                                      count * sizeof(*tracecache.intercepts));
+    }
+  memcpy(tracecache.intercepts, intercepts, count * sizeof(*intercepts));
+  tracecache.count = count;
+  tracecache.x1 = x1;
+  tracecache.y1 = y1;
+  tracecache.x2 = x2;
+  tracecache.y2 = y2;
+  tracecache.flags = flags;
+  tracecache.generation = blockthinggeneration;
+  tracecache.valid = TRUE;
+}
+
+//
+// Trace batches
+// A burst of traces over the same area, as the pellets of a shotgun,
+// can gather their lines from a batch built once over the mapblocks
+// the burst covers. The batch holds the lines of each covered block in
+// the order P_BlockLinesIterator gives them, with the vertex data
+// PIT_AddLineIntercepts needs packed alongside, so a trace tests them
+// without going through line_t or vertex_t. Things are still gathered
+// from the blockmap as each trace runs, as a pellet can kill something
+// or spawn a drop before the next. A trace that steps into a block
+// outside the batch is gathered again without it.
+//
+
+typedef struct {
+  line_t    *line;
+  divline_t dl;         // as P_MakeDivline
+  fixed_t   x2, y2;     // second vertex
+  unsigned  stamp;      // trace it was last tested for
+} batchline_t;
+
+static struct {
+  dbool       active;
+  int         x1, y1, x2, y2;   // blocks covered, inclusive
+  int         *cells;           // offsets into index, a block at a time
+  int         *index;           // into lines
+  batchline_t *lines;
+  int         numcells, numindex, numlines;
+  int         maxcells, maxindex, maxlines;
+  unsigned    stamp;
+  // batch line of each line_t, valid where linestamp is buildstamp
+  int         *linebatch;
+  unsigned    *linestamp, buildstamp;
+  int         maxmaplines;
+} tracebatch;
+
+void P_StartTraceBatch(const fixed_t *bbox)
+{
+  int x, y, x1, y1, x2, y2;
+
+  x1 = MAX((bbox[BOXLEFT] - bmaporgx) >> MAPBLOCKSHIFT, 0);
+  x2 = MIN((bbox[BOXRIGHT] - bmaporgx) >> MAPBLOCKSHIFT, bmapwidth-1);
+  y1 = MAX((bbox[BOXBOTTOM] - bmaporgy) >> MAPBLOCKSHIFT, 0);
+  y2 = MIN((bbox[BOXTOP] - bmaporgy) >> MAPBLOCKSHIFT, bmapheight-1);
+  if (x1 > x2 || y1 > y2)
+    return;
+
+  if (numlines > tracebatch.maxmaplines)
+    {
+      tracebatch.maxmaplines = numlines;
+      tracebatch.linebatch = realloc(tracebatch.linebatch,
+                                     numlines * sizeof(*tracebatch.linebatch));
+      free(tracebatch.linestamp);
+      tracebatch.linestamp = calloc(numlines, sizeof(*tracebatch.linestamp));
+      tracebatch.buildstamp = 0;
+    }
+  tracebatch.buildstamp++;
+
+  tracebatch.numcells = (x2-x1+1) * (y2-y1+1);
+  if (tracebatch.numcells + 1 > tracebatch.maxcells)
+    {
+      tracebatch.maxcells = tracebatch.numcells + 1;
+      tracebatch.cells = realloc(tracebatch.cells,
+                                 tracebatch.maxcells * sizeof(*tracebatch.cells));
+    }
+  tracebatch.numindex = tracebatch.numlines = 0;
+
+  for (y = y1; y <= y2; y++)
+    for (x = x1; x <= x2; x++)
+      {
+        int cell = y*bmapwidth+x;
+        int i = blockcells[cell], end = blockcells[cell+1];
+
+        tracebatch.cells[(y-y1)*(x2-x1+1) + (x-x1)] = tracebatch.numindex;
+
+        // the same entries as P_BlockLinesIterator
+        if (!demo_compatibility)
+          i++;
+        else if (blocklines[i] == -1)
+          continue;
+        for ( ; i < end; i++)
+          {
+            int ln = blocklines[i];
+
+            if (tracebatch.linestamp[ln] != tracebatch.buildstamp)
+              {
+                line_t *ld = &lines[ln];
+                batchline_t *bl;
+
+                if (tracebatch.numlines == tracebatch.maxlines)
+                  {
+                    tracebatch.maxlines = tracebatch.maxlines ? tracebatch.maxlines*2 : 256;
+                    tracebatch.lines = realloc(tracebatch.lines,
+                        tracebatch.maxlines * sizeof(*tracebatch.lines));
+                  }
+                bl = &tracebatch.lines[tracebatch.numlines];
+                bl->line = ld;
+                P_MakeDivline(ld, &bl->dl);
+                bl->x2 = ld->v2->x;
+                bl->y2 = ld->v2->y;
+                bl->stamp = tracebatch.stamp;
+                tracebatch.linestamp[ln] = tracebatch.buildstamp;
+                tracebatch.linebatch[ln] = tracebatch.numlines++;
+              }
+            if (tracebatch.numindex == tracebatch.maxindex)
+              {
+                tracebatch.maxindex = tracebatch.maxindex ? tracebatch.maxindex*2 : 1024;
+                tracebatch.index = realloc(tracebatch.index,
+                    tracebatch.maxindex * sizeof(*tracebatch.index));
+              }
+            tracebatch.index[tracebatch.numindex++] = tracebatch.linebatch[ln];
+          }
+      }
+  tracebatch.cells[tracebatch.numcells] = tracebatch.numindex;
+  tracebatch.x1 = x1;
+  tracebatch.y1 = y1;
+  tracebatch.x2 = x2;
+  tracebatch.y2 = y2;
+  tracebatch.active = TRUE;
+}
+
+void P_EndTraceBatch(void)
+{
+  tracebatch.active = FALSE;
+}
+
+//
+// P_BatchLineIntercepts
+// As P_BlockLinesIterator with PIT_AddLineIntercepts for a long trace,
+// from the batch. Returns FALSE if the block isn't in the batch.
+//
+
+static dbool P_BatchLineIntercepts(int x, int y)
+{
+  int i, end;
+
+  if (x<0 || y<0 || x>=bmapwidth || y>=bmapheight)
+    return TRUE;
+  if (x < tracebatch.x1 || x > tracebatch.x2 ||
+      y < tracebatch.y1 || y > tracebatch.y2)
+    return FALSE;
+  i = (y - tracebatch.y1) * (tracebatch.x2 - tracebatch.x1 + 1) +
+    (x - tracebatch.x1);
+  end = tracebatch.cells[i+1];
+  for (i = tracebatch.cells[i]; i < end; i++)
+    {
+      batchline_t *bl = &tracebatch.lines[tracebatch.index[i]];
+      fixed_t frac;
+
+      if (bl->stamp == tracebatch.stamp)
+        continue;
+      bl->stamp = tracebatch.stamp;
+
+      if (P_PointOnDivlineSide(bl->dl.x, bl->dl.y, &trace) ==
+          P_PointOnDivlineSide(bl->x2, bl->y2, &trace))
+        continue;       // line isn't crossed
+
+      frac = P_InterceptVector(&trace, &bl->dl);
+      if (frac < 0)
+        continue;       // behind source
+
+      check_intercept();
+      intercept_p->frac = frac;
+      intercept_p->isaline = TRUE;
+      intercept_p->d.line = bl->line;
+      intercept_p++;
+    }
+  return TRUE;
+}
+
 //
 // P_PathTraverse
 // Traces a line from x1,y1 to x2,y2,
@@ -565,8 +1217,8 @@ dbool P_TraverseIntercepts(traverser_t func, fixed_t maxfrac)
 //
 // killough 5/3/98: reformatted, cleaned up
 
-dbool P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
-                       int flags, dbool trav(intercept_t *))
+static dbool P_DoPathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
+                              int flags, dbool trav(intercept_t *))
 {
   fixed_t xt1, yt1;
   fixed_t xt2, yt2;
@@ -576,6 +1228,9 @@ dbool P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
   int     mapx, mapy;
   int     mapxstep, mapystep;
   int     count;
+  fixed_t tracex1, tracey1, tracex2, tracey2;
+  fixed_t xintercept1, yintercept1;
+  dbool   batched;
 
   validcount++;
   intercept_p = intercepts;
@@ -591,6 +1246,13 @@ dbool P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
   trace.dx = x2 - x1;
   trace.dy = y2 - y1;
 
+  if (P_TraceCached(x1, y1, x2, y2, flags))
+    return P_TraverseIntercepts(trav, FRACUNIT);
+  tracex1 = x1;
+  tracey1 = y1;
+  tracex2 = x2;
+  tracey2 = y2;
+
   x1 -= bmaporgx;
   y1 -= bmaporgy;
   xt1 = x1>>MAPBLOCKSHIFT;
@@ -649,12 +1311,35 @@ dbool P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
   // Count is present to prevent a round off error
   // from skipping the break.
 
+  // A batch only holds what PIT_AddLineIntercepts needs for long traces
+  batched = tracebatch.active && flags & PT_ADDLINES &&
+    (trace.dx >  FRACUNIT*16 || trace.dy >  FRACUNIT*16 ||
+     trace.dx < -FRACUNIT*16 || trace.dy < -FRACUNIT*16);
+  if (batched)
+    tracebatch.stamp++;
+  xintercept1 = xintercept;
+  yintercept1 = yintercept;
+
+ gather:
   mapx = xt1;
   mapy = yt1;
 
   for (count = 0; count < 64; count++)
     {
-      if (flags & PT_ADDLINES)
+      if (batched)
+        {
+          if (!P_BatchLineIntercepts(mapx, mapy))
+            {
+              // left the batch; start over the usual way
+              batched = FALSE;
+              validcount++;
+              intercept_p = intercepts;
+              xintercept = xintercept1;
+              yintercept = yintercept1;
+              goto gather;
+            }
+        }
+      else if (flags & PT_ADDLINES)
         if (!P_BlockLinesIterator(mapx, mapy,PIT_AddLineIntercepts))
           return FALSE; // early out
 
@@ -679,5 +1364,22 @@ dbool P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
     }
 
   // go through the sorted list
+  {
+    int64_t start = D_BenchStart();
+
+    P_SortIntercepts();
+    D_BenchStop(BENCH_INTERCEPTS, start);
+  }
+  P_CacheTrace(tracex1, tracey1, tracex2, tracey2, flags);
   return P_TraverseIntercepts(trav, FRACUNIT);
 }
+
+dbool P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
+                       int flags, dbool trav(intercept_t *))
+{
+  int64_t start = D_BenchStart();
+  dbool finished = P_DoPathTraverse(x1, y1, x2, y2, flags, trav);
+
+  D_BenchStop(BENCH_TRAVERSE, start);
+  return finished;
+}
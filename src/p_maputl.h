@@ -75,11 +75,31 @@ fixed_t P_InterceptVector2(const divline_t *v2, const divline_t *v1);
 void    P_LineOpening (const line_t *linedef);
 void    P_UnsetThingPosition(mobj_t *thing);
 void    P_SetThingPosition(mobj_t *thing);
+void    P_RelinkThingPosition(mobj_t *thing);
+void    P_ClearThingLinks(void);
 dbool P_BlockLinesIterator (int x, int y, dbool func(line_t *));
+dbool P_BlockLinesInBoxIterator(int x, int y, const fixed_t *bbox,
+                                dbool func(line_t *));
 dbool P_BlockThingsIterator(int x, int y, dbool func(mobj_t *));
+dbool P_BlockThingsInRangeIterator(int bx, int by, fixed_t x, fixed_t y,
+                                   fixed_t range, dbool func(mobj_t *));
+void    P_SyncBlockThing(mobj_t *thing);
+void    P_UpdateTargetGrid(mobj_t *thing);
+dbool P_TargetsInBlocks(int x1, int y1, int x2, int y2, int side);
+void    P_ClearTraceCache(void);
+// Room in intercepts for count before a level starts, and what it used
+void    P_InitIntercepts(size_t count);
+void    P_ReportIntercepts(void);
+void    P_StartTraceBatch(const fixed_t *bbox);
+void    P_EndTraceBatch(void);
 dbool P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
                        int flags, dbool trav(intercept_t *));
 
+// Bump after moving any sector's floor or ceiling, before anything can
+// call P_LineOpening
+extern unsigned openinggeneration;
+void    P_ResetLineOpenings(void);
+
 extern fixed_t opentop;
 extern fixed_t openbottom;
 extern fixed_t openrange;
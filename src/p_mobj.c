@@ -67,6 +67,8 @@ dbool P_SetMobjState(mobj_t* mobj,statenum_t state)
   dbool ret = TRUE;                         // return value
   statenum_t tempstate[NUMSTATES];            // for use with recursion
 
+  P_WakeMobj(mobj);
+
   if (recursion++)                            // if recursion detected,
     memset(seenstate=tempstate,0,sizeof tempstate); // clear state table
 
@@ -135,8 +137,11 @@ void P_ExplodeMissile (mobj_t* mo)
 //
 // Attempts to move something if it has momentum.
 //
+// Like P_ZMovement, written once as P_XYMovementAt and instantiated for
+// the usual compatibility levels, see P_SelectCompatPaths.
+//
 
-static void P_XYMovement (mobj_t* mo)
+static INLINE void P_XYMovementAt(mobj_t* mo, const complevel_t compatibility_level)
 {
   player_t *player;
   fixed_t xmove, ymove;
@@ -415,7 +420,7 @@ static void P_XYMovement (mobj_t* mo)
 //
 // Attempt vertical movement.
 
-static void P_ZMovement (mobj_t* mo)
+static INLINE void P_ZMovementAt(mobj_t* mo, const complevel_t compatibility_level)
 {
   /* killough 7/11/98:
    * BFG fireballs bounced on floors and ceilings in Pre-Beta Doom
@@ -711,6 +716,7 @@ static void P_NightmareRespawn(mobj_t* mobj)
 
   /* killough 11/98: transfer friendliness from deceased */
   mo->flags = (mo->flags & ~MF_FRIEND) | (mobj->flags & MF_FRIEND);
+  P_UpdateTargetGrid(mo);
 
   mo->reactiontime = 18;
 
@@ -724,8 +730,71 @@ static void P_NightmareRespawn(mobj_t* mobj)
 // P_MobjThinker
 //
 
+//
+// Compatibility paths
+//
+// P_XYMovementAt and P_ZMovementAt take the compatibility level as a
+// parameter named after the global, which it shadows, so that
+// demo_compatibility, mbf_features and every compatibility_level test in
+// them fold away when it is a constant. A copy is made for each of the
+// usual levels; any other level runs the copy that reads the global.
+// The comp[] options stay run time tests, as at most levels they can be
+// set apart from the level.
+//
+
+static void P_XYMovementDoom2(mobj_t *mo) { P_XYMovementAt(mo, doom2_19_compatibility); }
+static void P_XYMovementBoom(mobj_t *mo)  { P_XYMovementAt(mo, boom_compatibility); }
+static void P_XYMovementMBF(mobj_t *mo)   { P_XYMovementAt(mo, mbf_compatibility); }
+static void P_XYMovementBest(mobj_t *mo)  { P_XYMovementAt(mo, best_compatibility); }
+static void P_XYMovementAny(mobj_t *mo)   { P_XYMovementAt(mo, compatibility_level); }
+
+static void P_ZMovementDoom2(mobj_t *mo) { P_ZMovementAt(mo, doom2_19_compatibility); }
+static void P_ZMovementBoom(mobj_t *mo)  { P_ZMovementAt(mo, boom_compatibility); }
+static void P_ZMovementMBF(mobj_t *mo)   { P_ZMovementAt(mo, mbf_compatibility); }
+static void P_ZMovementBest(mobj_t *mo)  { P_ZMovementAt(mo, best_compatibility); }
+static void P_ZMovementAny(mobj_t *mo)   { P_ZMovementAt(mo, compatibility_level); }
+
+static void (*P_XYMovement)(mobj_t *mo) = P_XYMovementAny;
+static void (*P_ZMovement)(mobj_t *mo) = P_ZMovementAny;
+static int movementlevel = -1;  // the level they were picked for
+
+//
+// P_SelectCompatPaths
+//
+// Picks the copies of the movement code (and P_TryMove's) for the
+// current compatibility level. G_Compatibility calls it; the callers
+// check it is still current, as a savegame or demo may set the level
+// behind G_Compatibility's back.
+//
+
+void P_SelectCompatPaths(void)
+{
+  switch (compatibility_level)
+  {
+    case doom2_19_compatibility:
+      P_XYMovement = P_XYMovementDoom2, P_ZMovement = P_ZMovementDoom2;
+      break;
+    case boom_compatibility:
+      P_XYMovement = P_XYMovementBoom, P_ZMovement = P_ZMovementBoom;
+      break;
+    case mbf_compatibility:
+      P_XYMovement = P_XYMovementMBF, P_ZMovement = P_ZMovementMBF;
+      break;
+    case best_compatibility:
+      P_XYMovement = P_XYMovementBest, P_ZMovement = P_ZMovementBest;
+      break;
+    default:
+      P_XYMovement = P_XYMovementAny, P_ZMovement = P_ZMovementAny;
+      break;
+  }
+  movementlevel = compatibility_level;
+  P_SelectTryMove();
+}
+
 void P_MobjThinker (mobj_t* mobj)
 {
+  dbool moved = FALSE, rested = FALSE;  // for parking, see below
+
   // killough 11/98:
   // removed old code which looked at target references
   // (we use pointer reference counting now)
@@ -740,9 +809,13 @@ void P_MobjThinker (mobj_t* mobj)
   mobj->PrevY = mobj->y;
   mobj->PrevZ = mobj->z;
 
+  if (movementlevel != (int)compatibility_level)
+    P_SelectCompatPaths();
+
   // momentum movement
   if (mobj->momx | mobj->momy || mobj->flags & MF_SKULLFLY)
   {
+    moved = TRUE;
     P_XYMovement(mobj);
     if (mobj->thinker.function != P_MobjThinker) // cph - Must've been removed
       return;       // killough - mobj was removed
@@ -766,7 +839,7 @@ void P_MobjThinker (mobj_t* mobj)
         !comp[comp_falloff]) // Not in old demos
       P_ApplyTorque(mobj);               // Apply torque
     else
-      mobj->intflags &= ~MIF_FALLING, mobj->gear = 0;  // Reset torque
+      mobj->intflags &= ~MIF_FALLING, mobj->gear = 0, rested = !moved;  // Reset torque
   }
 
   // cycle through states,
@@ -785,6 +858,13 @@ void P_MobjThinker (mobj_t* mobj)
   else
   {
 
+    // A thing that stood still without state changes this tic would do
+    // exactly the same again every tic until something moves, hurts or
+    // changes it (P_WakeMobj), so P_RunThinkers may pass it till then.
+    // Sentient things skip the resting branch and are never parked.
+    if (rested && !(respawnmonsters && mobj->flags & MF_COUNTKILL))
+      mobj->intflags |= MIF_PARKED;
+
     // check for nightmare respawn
 
     if (! (mobj->flags & MF_COUNTKILL) )
@@ -819,7 +899,7 @@ mobj_t* P_SpawnMobj(fixed_t x,fixed_t y,fixed_t z,mobjtype_t type)
   state_t*    st;
   mobjinfo_t* info;
 
-  mobj = Z_Malloc (sizeof(*mobj), PU_LEVEL, NULL);
+  mobj = P_AllocThinker(TZ_MOBJ);
   memset (mobj, 0, sizeof (*mobj));
   info = &mobjinfo[type];
   mobj->type = type;
@@ -889,11 +969,7 @@ int        iquehead;
 int        iquetail;
 
 
-//
-// P_RemoveMobj
-//
-
-void P_RemoveMobj (mobj_t* mobj)
+static void P_QueueRespawn(mobj_t* mobj)
 {
   if ((mobj->flags & MF_SPECIAL)
       && !(mobj->flags & MF_DROPPED)
@@ -909,6 +985,15 @@ void P_RemoveMobj (mobj_t* mobj)
     if (iquehead == iquetail)
       iquetail = (iquetail+1)&(ITEMQUESIZE-1);
     }
+}
+
+//
+// P_RemoveMobj
+//
+
+void P_RemoveMobj (mobj_t* mobj)
+{
+  P_QueueRespawn(mobj);
 
   // unlink from sector and block lists
 
@@ -947,6 +1032,21 @@ void P_RemoveMobj (mobj_t* mobj)
   P_RemoveThinker (&mobj->thinker);
 }
 
+//
+// P_DiscardMobj
+// Does what P_RemoveMobj would for a thing being taken down along with
+// all the rest of the level's, as when a savegame is loaded, bar the
+// unlinking, which P_ClearThingLinks does for all of them at once, and
+// the dropped references and thinker list upkeep, which go with them.
+// The thing's sector nodes are left for the caller.
+//
+
+void P_DiscardMobj(mobj_t* mobj)
+{
+  P_QueueRespawn(mobj);
+  S_StopSound(mobj);
+}
+
 
 /*
  * P_FindDoomedNum
@@ -958,12 +1058,15 @@ void P_RemoveMobj (mobj_t* mobj)
 
 static int P_FindDoomedNum(unsigned type)
 {
-  static struct { int first, next; } *hash;
+  // a static table: under PU_CACHE it went with a purge and was built
+  // again by the next item respawn
+  static struct { int first, next; } hash[NUMMOBJTYPES];
+  static dbool hashed;
   register int i;
 
-  if (!hash)
+  if (!hashed)
     {
-      hash = Z_Malloc(sizeof *hash * NUMMOBJTYPES, PU_CACHE, (void **) &hash);
+      hashed = TRUE;
       for (i=0; i<NUMMOBJTYPES; i++)
   hash[i].first = NUMMOBJTYPES;
       for (i=0; i<NUMMOBJTYPES; i++)
@@ -1406,6 +1509,7 @@ void P_CheckMissileSpawn (mobj_t* th)
 
   th->x += (th->momx>>1);
   th->y += (th->momy>>1);
+  P_SyncBlockThing(th);
   th->z += (th->momz>>1);
 
   // killough 8/12/98: for non-missile objects (e.g. grenades)
@@ -248,8 +248,13 @@ enum {
   MIF_FALLING     = 0x00000001, // Object is falling
   MIF_ARMED       = 0x00000002, // Object is armed (for MF_TOUCHY objects)
   MIF_RESURRECTED = 0x00000004, // Object has been resurrected
+  MIF_PARKED      = 0x00000008, // Idle, P_RunThinkers passes it until woken
 };
 
+// Anything that may move, hurt or change the state of a mobj wakes it,
+// so a parked mobj runs P_MobjThinker again from the next tic
+#define P_WakeMobj(mo) ((mo)->intflags &= ~MIF_PARKED)
+
 
 // Map Object definition.
 //
@@ -267,8 +272,13 @@ enum {
 
 // killough 9/8/98: changed some fields to shorts,
 // for better memory usage (if only for cache).
-/* cph 2006/08/28 - move Prev[XYZ] fields to the end of the struct. Add any
- * other new fields to the end, and make sure you don't break savegames! */
+//
+// The fields are grouped by use: first what moving, colliding and
+// walking the blockmap touch on every thing, then what thinking and
+// drawing it need, and last what only respawning, interpolation and
+// MUSINFO ever look at. Savegames are written field by field (see
+// p_saveg.c), so the order is free to follow the cache; thinker and
+// x, y, z stay first, as in degenmobj_t.
 
 typedef struct mobj_s
 {
@@ -280,22 +290,14 @@ typedef struct mobj_s
     fixed_t             y;
     fixed_t             z;
 
-    // More list: links in sector (if needed)
-    struct mobj_s*      snext;
-    struct mobj_s**     sprev; // killough 8/10/98: change to ptr-to-ptr
-
-    //More drawing info: to determine current sprite.
-    angle_t             angle;  // orientation (yaw)
-    angle_t             pitch;  // looking up/down angle
-    spritenum_t         sprite; // used to find patch_t and flip value
-    int                 frame;  // might be ORed with FF_FULLBRIGHT
-
-    // Interaction info, by BLOCKMAP.
-    // Links in blocks (if needed).
-    struct mobj_s*      bnext;
-    struct mobj_s**     bprev; // killough 8/11/98: change to ptr-to-ptr
+    // Momentums, used to update position.
+    fixed_t             momx;
+    fixed_t             momy;
+    fixed_t             momz;
 
-    struct subsector_s* subsector;
+    // For movement checking.
+    fixed_t             radius;
+    fixed_t             height;
 
     // The closest interval over all contacted Sectors.
     fixed_t             floorz;
@@ -304,36 +306,70 @@ typedef struct mobj_s
     // killough 11/98: the lowest floor over all contacted Sectors.
     fixed_t             dropoffz;
 
-    // For movement checking.
-    fixed_t             radius;
-    fixed_t             height;
-
-    // Momentums, used to update position.
-    fixed_t             momx;
-    fixed_t             momy;
-    fixed_t             momz;
-
     // If == validcount, already checked.
     int                 validcount;
 
+    uint64_t            flags;
+    int                 intflags;  // killough 9/15/98: internal flags
+    int                 health;
+
+    // More list: links in sector (if needed)
+    struct mobj_s*      snext;
+    struct mobj_s**     sprev; // killough 8/10/98: change to ptr-to-ptr
+
+    // Interaction info, by BLOCKMAP.
+    // Cell of blockthings it is kept in, if any.
+    struct blockthings_s* blockcell;
+
+    struct subsector_s* subsector;
+
+    // a linked list of sectors where this object appears
+    struct msecnode_s* touching_sectorlist;                 // phares 3/14/98
+
     mobjtype_t          type;
     mobjinfo_t*         info;   // &mobjinfo[mobj->type]
 
     int                 tics;   // state tic counter
     state_t*            state;
-    uint64_t            flags;
-    int                 intflags;  // killough 9/15/98: internal flags
-    int                 health;
 
-    // Movement direction, movement generation (zig-zagging).
-    short               movedir;        // 0-7
-    short               movecount;      // when 0, select a new dir
-    short               strafecount;    // killough 9/8/98: monster strafing
+    //More drawing info: to determine current sprite.
+    angle_t             angle;  // orientation (yaw)
+    angle_t             pitch;  // looking up/down angle
+    spritenum_t         sprite; // used to find patch_t and flip value
+    int                 frame;  // might be ORed with FF_FULLBRIGHT
 
     // Thing being chased/attacked (or NULL),
     // also the originator for missiles.
     struct mobj_s*      target;
 
+    // Additional info record for player avatars only.
+    // Only valid if type == MT_PLAYER
+    struct player_s*    player;
+
+    // Thing being chased/attacked for tracers.
+    struct mobj_s*      tracer;
+
+    // new field: last known enemy -- killough 2/15/98
+    struct mobj_s*      lastenemy;
+
+    // killough 8/2/98: friction properties part of sectors,
+    // not objects -- removed friction properties from here
+    // e6y: restored friction properties here
+    // Friction values for the sector the object is in
+    int friction;                                           // phares 3/17/98
+    int movefactor;
+
+    // P_GetFriction's last result, while frictiongen, frictionsight and
+    // frictionz still match; frictiongen 0 means there is none
+    unsigned frictiongen, frictionsight;
+    fixed_t frictionz;
+    int cachedfriction, cachedmovefactor;
+
+    // Movement direction, movement generation (zig-zagging).
+    short               movedir;        // 0-7
+    short               movecount;      // when 0, select a new dir
+    short               strafecount;    // killough 9/8/98: monster strafing
+
     // Reaction time: if non 0, don't attack yet.
     // Used by player to freeze a bit after teleporting.
     short               reactiontime;
@@ -347,41 +383,19 @@ typedef struct mobj_s
 
     short               gear; // killough 11/98: used in torque simulation
 
-    // Additional info record for player avatars only.
-    // Only valid if type == MT_PLAYER
-    struct player_s*    player;
-
     // Player number last looked for.
     short               lastlook;
 
     // For nightmare respawn.
     mapthing_t          spawnpoint;
 
-    // Thing being chased/attacked for tracers.
-    struct mobj_s*      tracer;
-
-    // new field: last known enemy -- killough 2/15/98
-    struct mobj_s*      lastenemy;
-
-    // killough 8/2/98: friction properties part of sectors,
-    // not objects -- removed friction properties from here
-    // e6y: restored friction properties here
-    // Friction values for the sector the object is in
-    int friction;                                           // phares 3/17/98
-    int movefactor;
-
-    // a linked list of sectors where this object appears
-    struct msecnode_s* touching_sectorlist;                 // phares 3/14/98
+    // Extra id based on thing type that's used in MUSINFO
+    short               iden_num;
 
     fixed_t             PrevX;
     fixed_t             PrevY;
     fixed_t             PrevZ;
 
-    // Extra id based on thing type that's used in MUSINFO
-    short               iden_num;
-
-    fixed_t             pad; // cph - needed so I can get the size unambiguously on amd64
-
     // SEE WARNING ABOVE ABOUT POINTER FIELDS!!!
 } mobj_t;
 
@@ -417,8 +431,11 @@ extern int iquetail;
 void    P_RespawnSpecials(void);
 mobj_t  *P_SpawnMobj(fixed_t x, fixed_t y, fixed_t z, mobjtype_t type);
 void    P_RemoveMobj(mobj_t *th);
+void    P_DiscardMobj(mobj_t *th);
 dbool   P_SetMobjState(mobj_t *mobj, statenum_t state);
 void    P_MobjThinker(mobj_t *mobj);
+// Picks the hot paths specialised for the current compatibility level
+void    P_SelectCompatPaths(void);
 void    P_SpawnPuff(fixed_t x, fixed_t y, fixed_t z);
 void    P_SpawnBlood(fixed_t x, fixed_t y, fixed_t z, int damage);
 mobj_t  *P_SpawnMissile(mobj_t *source, mobj_t *dest, mobjtype_t type);
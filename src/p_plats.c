@@ -35,9 +35,11 @@
 #include "m_random.h"
 #include "r_main.h"
 #include "p_spec.h"
+#include "p_map.h"
 #include "p_tick.h"
 #include "s_sound.h"
 #include "sounds.h"
+#include "p_saveg.h"
 
 platlist_t *activeplats;       // killough 2/14/98: made global again
 
@@ -218,7 +220,7 @@ int EV_DoPlat
 
      /* Create a thinker */
      rtn = 1;
-     plat = Z_Malloc( sizeof(*plat), PU_LEVSPEC, 0);
+     plat = P_AllocThinker(TZ_PLAT);
      memset(plat, 0, sizeof(*plat));
      P_AddThinker(&plat->thinker);
 
@@ -239,10 +241,12 @@ int EV_DoPlat
         case raiseToNearestAndChange:
            plat->speed = PLATSPEED/2;
            sec->floorpic = sides[line->sidenum[0]].sector->floorpic;
+           P_MarkSectorDirty(sec);
            plat->high    = P_FindNextHighestFloor(sec,sec->floorheight);
            plat->wait    = 0;
            plat->status  = PLAT_UP;
            sec->special  = 0;
+           P_FrictionChanged();
            //jff 3/14/98 clear old field as well
            sec->oldspecial = 0;
 
@@ -252,6 +256,7 @@ int EV_DoPlat
         case raiseAndChange:
            plat->speed   = PLATSPEED/2;
            sec->floorpic = sides[line->sidenum[0]].sector->floorpic;
+           P_MarkSectorDirty(sec);
            plat->high    = sec->floorheight + amount*FRACUNIT;
            plat->wait    = 0;
            plat->status  = PLAT_UP;
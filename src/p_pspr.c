@@ -905,8 +905,10 @@ void A_FireShotgun(player_t *player, pspdef_t *psp)
 
   P_BulletSlope(player->mo);
 
+  P_StartLineAttacks(player->mo, player->mo->angle, 255<<18, MISSILERANGE);
   for (i=0; i<7; i++)
     P_GunShot(player->mo, false);
+  P_EndLineAttacks();
 
   retro_set_rumble_damage(40, 120.0f);
 }
@@ -927,6 +929,7 @@ void A_FireShotgun2(player_t *player, pspdef_t *psp)
 
   P_BulletSlope(player->mo);
 
+  P_StartLineAttacks(player->mo, player->mo->angle, 255<<19, MISSILERANGE);
   for (i=0; i<20; i++)
     {
       int damage = 5*(P_Random(pr_shotgun)%3+1);
@@ -938,6 +941,7 @@ void A_FireShotgun2(player_t *player, pspdef_t *psp)
       P_LineAttack(player->mo, angle, MISSILERANGE, bulletslope +
                    ((t - P_Random(pr_shotgun))<<5), damage);
     }
+  P_EndLineAttacks();
 
   retro_set_rumble_damage(40, 120.0f);
 }
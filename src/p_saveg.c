@@ -31,9 +31,12 @@
  *
  *-----------------------------------------------------------------------------*/
 
+#include <stddef.h>
+
 #include "doomstat.h"
 #include "r_main.h"
 #include "p_maputl.h"
+#include "p_map.h"
 #include "p_spec.h"
 #include "p_tick.h"
 #include "p_saveg.h"
@@ -44,9 +47,439 @@
 
 uint8_t *save_p;
 
-// Pads save_p to a 4-byte boundary
-//  so that the load/save works on SGI&Gecko.
-#define PADSAVEP()    do { save_p += (4 - ((uintptr_t) save_p & 3)) & 3; } while (0)
+//
+// Everything is saved a byte at a time, least significant first, at a
+// width fixed by the savegame rather than by the machine, and with no
+// padding. A game saved on one machine loads the same on any other,
+// and two machines in the same state save the same bytes, whatever
+// their struct layouts and wherever their zones put things.
+//
+
+static uint8_t *P_WriteLE(uint8_t *p, uint64_t v, int width)
+{
+  while (width--)
+    {
+      *p++ = (uint8_t) v;
+      v >>= 8;
+    }
+  return p;
+}
+
+// Sign-extended from the width read
+static int64_t P_ReadLE(const uint8_t **pp, int width)
+{
+  const uint8_t *p = *pp;
+  uint64_t v = 0;
+  int i;
+
+  for (i = 0; i < width; i++)
+    v |= (uint64_t) p[i] << 8*i;
+  if (width < 8 && (v >> (8*width - 1)) & 1)
+    v |= ~(uint64_t) 0 << 8*width;
+  *pp = p + width;
+  return (int64_t) v;
+}
+
+void P_SaveValue(int64_t v, int width)
+{
+  save_p = P_WriteLE(save_p, (uint64_t) v, width);
+}
+
+int64_t P_LoadValue(int width)
+{
+  const uint8_t *p = save_p;
+  int64_t v = P_ReadLE(&p, width);
+  save_p = (uint8_t *) p;
+  return v;
+}
+
+//
+// The structs are saved field by field, from tables of what to save of
+// each and at what width. Pointers go as numbers: things as their
+// index from P_ThinkerToIndex, 0 for none, states, sectors and lines as
+// their place in their arrays, -1 for none, players as their number
+// plus one. Whatever isn't in a table is zero after a load, until the
+// loader sets it up again.
+//
+
+typedef enum {
+  sf_end,
+  sf_int,       // an integer of any size, or an enum or dbool
+  sf_mobj,      // mobj_t *
+  sf_state,     // state_t *
+  sf_sector,    // sector_t *
+  sf_line,      // line_t *
+  sf_player     // player_t *
+} savekind_t;
+
+typedef struct {
+  unsigned short offset;
+  uint8_t size;         // in memory
+  uint8_t width;        // in the savegame
+  uint8_t count;        // of an array
+  uint8_t kind;
+} savefield_t;
+
+#define SAVEARRAY(type, field, width) \
+  { offsetof(type, field), sizeof(((type *) 0)->field[0]), width, \
+    sizeof(((type *) 0)->field) / sizeof(((type *) 0)->field[0]), sf_int }
+#define SAVEINT(type, field, width) \
+  { offsetof(type, field), sizeof(((type *) 0)->field), width, 1, sf_int }
+#define SAVEPTR(type, field, kind) \
+  { offsetof(type, field), sizeof(void *), 4, 1, kind }
+#define SAVEEND { 0, 0, 0, 0, sf_end }
+
+static const savefield_t playerfields[] = {
+  SAVEINT(player_t, playerstate, 4),
+  SAVEINT(player_t, cmd.forwardmove, 1),
+  SAVEINT(player_t, cmd.sidemove, 1),
+  SAVEINT(player_t, cmd.angleturn, 2),
+  SAVEINT(player_t, cmd.consistancy, 2),
+  SAVEINT(player_t, cmd.chatchar, 1),
+  SAVEINT(player_t, cmd.buttons, 1),
+  SAVEINT(player_t, viewz, 4),
+  SAVEINT(player_t, viewheight, 4),
+  SAVEINT(player_t, deltaviewheight, 4),
+  SAVEINT(player_t, bob, 4),
+  SAVEINT(player_t, health, 4),
+  SAVEINT(player_t, armorpoints, 4),
+  SAVEINT(player_t, armortype, 4),
+  SAVEARRAY(player_t, powers, 4),
+  SAVEARRAY(player_t, cards, 4),
+  SAVEINT(player_t, backpack, 4),
+  SAVEARRAY(player_t, frags, 4),
+  SAVEINT(player_t, readyweapon, 4),
+  SAVEINT(player_t, pendingweapon, 4),
+  SAVEARRAY(player_t, weaponowned, 4),
+  SAVEARRAY(player_t, ammo, 4),
+  SAVEARRAY(player_t, maxammo, 4),
+  SAVEINT(player_t, attackdown, 4),
+  SAVEINT(player_t, usedown, 4),
+  SAVEINT(player_t, cheats, 4),
+  SAVEINT(player_t, refire, 4),
+  SAVEINT(player_t, killcount, 4),
+  SAVEINT(player_t, itemcount, 4),
+  SAVEINT(player_t, secretcount, 4),
+  SAVEINT(player_t, damagecount, 4),
+  SAVEINT(player_t, bonuscount, 4),
+  SAVEINT(player_t, extralight, 4),
+  SAVEINT(player_t, fixedcolormap, 4),
+  SAVEINT(player_t, colormap, 4),
+  SAVEPTR(player_t, psprites[ps_weapon].state, sf_state),
+  SAVEINT(player_t, psprites[ps_weapon].tics, 4),
+  SAVEINT(player_t, psprites[ps_weapon].sx, 4),
+  SAVEINT(player_t, psprites[ps_weapon].sy, 4),
+  SAVEPTR(player_t, psprites[ps_flash].state, sf_state),
+  SAVEINT(player_t, psprites[ps_flash].tics, 4),
+  SAVEINT(player_t, psprites[ps_flash].sx, 4),
+  SAVEINT(player_t, psprites[ps_flash].sy, 4),
+  SAVEINT(player_t, didsecret, 4),
+  SAVEINT(player_t, momx, 4),
+  SAVEINT(player_t, momy, 4),
+  SAVEINT(player_t, resurectedkillcount, 4),
+  SAVEINT(player_t, prev_viewz, 4),
+  SAVEINT(player_t, prev_viewangle, 4),
+  SAVEINT(player_t, prev_viewpitch, 4),
+  SAVEEND
+};
+
+static const savefield_t mobjfields[] = {
+  SAVEINT(mobj_t, x, 4),
+  SAVEINT(mobj_t, y, 4),
+  SAVEINT(mobj_t, z, 4),
+  SAVEINT(mobj_t, angle, 4),
+  SAVEINT(mobj_t, pitch, 4),
+  SAVEINT(mobj_t, sprite, 4),
+  SAVEINT(mobj_t, frame, 4),
+  SAVEINT(mobj_t, floorz, 4),
+  SAVEINT(mobj_t, ceilingz, 4),
+  SAVEINT(mobj_t, dropoffz, 4),
+  SAVEINT(mobj_t, radius, 4),
+  SAVEINT(mobj_t, height, 4),
+  SAVEINT(mobj_t, momx, 4),
+  SAVEINT(mobj_t, momy, 4),
+  SAVEINT(mobj_t, momz, 4),
+  SAVEINT(mobj_t, validcount, 4),
+  SAVEINT(mobj_t, type, 4),
+  SAVEINT(mobj_t, tics, 4),
+  SAVEPTR(mobj_t, state, sf_state),
+  SAVEINT(mobj_t, flags, 8),
+  SAVEINT(mobj_t, intflags, 4),
+  SAVEINT(mobj_t, health, 4),
+  SAVEINT(mobj_t, movedir, 2),
+  SAVEINT(mobj_t, movecount, 2),
+  SAVEINT(mobj_t, strafecount, 2),
+  SAVEPTR(mobj_t, target, sf_mobj),
+  SAVEINT(mobj_t, reactiontime, 2),
+  SAVEINT(mobj_t, threshold, 2),
+  SAVEINT(mobj_t, pursuecount, 2),
+  SAVEINT(mobj_t, gear, 2),
+  SAVEPTR(mobj_t, player, sf_player),
+  SAVEINT(mobj_t, lastlook, 2),
+  SAVEINT(mobj_t, spawnpoint.x, 2),
+  SAVEINT(mobj_t, spawnpoint.y, 2),
+  SAVEINT(mobj_t, spawnpoint.angle, 2),
+  SAVEINT(mobj_t, spawnpoint.type, 2),
+  SAVEINT(mobj_t, spawnpoint.options, 2),
+  SAVEPTR(mobj_t, tracer, sf_mobj),
+  SAVEPTR(mobj_t, lastenemy, sf_mobj),
+  SAVEINT(mobj_t, friction, 4),
+  SAVEINT(mobj_t, movefactor, 4),
+  SAVEINT(mobj_t, iden_num, 2),
+  SAVEEND
+};
+
+static const savefield_t ceilingfields[] = {
+  SAVEINT(ceiling_t, type, 4),
+  SAVEPTR(ceiling_t, sector, sf_sector),
+  SAVEINT(ceiling_t, bottomheight, 4),
+  SAVEINT(ceiling_t, topheight, 4),
+  SAVEINT(ceiling_t, speed, 4),
+  SAVEINT(ceiling_t, oldspeed, 4),
+  SAVEINT(ceiling_t, crush, 4),
+  SAVEINT(ceiling_t, newspecial, 4),
+  SAVEINT(ceiling_t, oldspecial, 4),
+  SAVEINT(ceiling_t, texture, 2),
+  SAVEINT(ceiling_t, direction, 4),
+  SAVEINT(ceiling_t, tag, 4),
+  SAVEINT(ceiling_t, olddirection, 4),
+  SAVEEND
+};
+
+static const savefield_t doorfields[] = {
+  SAVEINT(vldoor_t, type, 4),
+  SAVEPTR(vldoor_t, sector, sf_sector),
+  SAVEINT(vldoor_t, topheight, 4),
+  SAVEINT(vldoor_t, speed, 4),
+  SAVEINT(vldoor_t, direction, 4),
+  SAVEINT(vldoor_t, topwait, 4),
+  SAVEINT(vldoor_t, topcountdown, 4),
+  SAVEPTR(vldoor_t, line, sf_line),
+  SAVEINT(vldoor_t, lighttag, 4),
+  SAVEEND
+};
+
+static const savefield_t floorfields[] = {
+  SAVEINT(floormove_t, type, 4),
+  SAVEINT(floormove_t, crush, 4),
+  SAVEPTR(floormove_t, sector, sf_sector),
+  SAVEINT(floormove_t, direction, 4),
+  SAVEINT(floormove_t, newspecial, 4),
+  SAVEINT(floormove_t, oldspecial, 4),
+  SAVEINT(floormove_t, texture, 2),
+  SAVEINT(floormove_t, floordestheight, 4),
+  SAVEINT(floormove_t, speed, 4),
+  SAVEEND
+};
+
+static const savefield_t platfields[] = {
+  SAVEPTR(plat_t, sector, sf_sector),
+  SAVEINT(plat_t, speed, 4),
+  SAVEINT(plat_t, low, 4),
+  SAVEINT(plat_t, high, 4),
+  SAVEINT(plat_t, wait, 4),
+  SAVEINT(plat_t, count, 4),
+  SAVEINT(plat_t, status, 4),
+  SAVEINT(plat_t, oldstatus, 4),
+  SAVEINT(plat_t, crush, 4),
+  SAVEINT(plat_t, tag, 4),
+  SAVEINT(plat_t, type, 4),
+  SAVEEND
+};
+
+static const savefield_t flashfields[] = {
+  SAVEPTR(lightflash_t, sector, sf_sector),
+  SAVEINT(lightflash_t, count, 4),
+  SAVEINT(lightflash_t, maxlight, 4),
+  SAVEINT(lightflash_t, minlight, 4),
+  SAVEINT(lightflash_t, maxtime, 4),
+  SAVEINT(lightflash_t, mintime, 4),
+  SAVEEND
+};
+
+static const savefield_t strobefields[] = {
+  SAVEPTR(strobe_t, sector, sf_sector),
+  SAVEINT(strobe_t, count, 4),
+  SAVEINT(strobe_t, minlight, 4),
+  SAVEINT(strobe_t, maxlight, 4),
+  SAVEINT(strobe_t, darktime, 4),
+  SAVEINT(strobe_t, brighttime, 4),
+  SAVEEND
+};
+
+static const savefield_t glowfields[] = {
+  SAVEPTR(glow_t, sector, sf_sector),
+  SAVEINT(glow_t, minlight, 4),
+  SAVEINT(glow_t, maxlight, 4),
+  SAVEINT(glow_t, direction, 4),
+  SAVEEND
+};
+
+static const savefield_t flickerfields[] = {
+  SAVEPTR(fireflicker_t, sector, sf_sector),
+  SAVEINT(fireflicker_t, count, 4),
+  SAVEINT(fireflicker_t, maxlight, 4),
+  SAVEINT(fireflicker_t, minlight, 4),
+  SAVEEND
+};
+
+static const savefield_t elevatorfields[] = {
+  SAVEINT(elevator_t, type, 4),
+  SAVEPTR(elevator_t, sector, sf_sector),
+  SAVEINT(elevator_t, direction, 4),
+  SAVEINT(elevator_t, floordestheight, 4),
+  SAVEINT(elevator_t, ceilingdestheight, 4),
+  SAVEINT(elevator_t, speed, 4),
+  SAVEEND
+};
+
+static const savefield_t scrollfields[] = {
+  SAVEINT(scroll_t, dx, 4),
+  SAVEINT(scroll_t, dy, 4),
+  SAVEINT(scroll_t, affectee, 4),
+  SAVEINT(scroll_t, control, 4),
+  SAVEINT(scroll_t, last_height, 4),
+  SAVEINT(scroll_t, vdx, 4),
+  SAVEINT(scroll_t, vdy, 4),
+  SAVEINT(scroll_t, accel, 4),
+  SAVEINT(scroll_t, type, 4),
+  SAVEEND
+};
+
+// source is found again from affectee
+static const savefield_t pusherfields[] = {
+  SAVEINT(pusher_t, type, 4),
+  SAVEINT(pusher_t, x_mag, 4),
+  SAVEINT(pusher_t, y_mag, 4),
+  SAVEINT(pusher_t, magnitude, 4),
+  SAVEINT(pusher_t, radius, 4),
+  SAVEINT(pusher_t, x, 4),
+  SAVEINT(pusher_t, y, 4),
+  SAVEINT(pusher_t, affectee, 4),
+  SAVEEND
+};
+
+static size_t P_FieldsSize(const savefield_t *f)
+{
+  size_t size = 0;
+
+  for (; f->kind != sf_end; f++)
+    size += f->width * f->count;
+  return size;
+}
+
+static int64_t P_GetField(const uint8_t *p, int size, int kind)
+{
+  const void *ptr;
+
+  if (kind == sf_int)
+    switch (size)
+      {
+      case 1: { int8_t  v; memcpy(&v, p, sizeof v); return v; }
+      case 2: { int16_t v; memcpy(&v, p, sizeof v); return v; }
+      case 4: { int32_t v; memcpy(&v, p, sizeof v); return v; }
+      default: { int64_t v; memcpy(&v, p, sizeof v); return v; }
+      }
+
+  memcpy(&ptr, p, sizeof ptr);
+  switch (kind)
+    {
+    case sf_mobj:
+      {
+        // killough 2/14/98: NULL if the thinker isn't a mobj
+        const mobj_t *mo = ptr;
+        return mo && mo->thinker.function == P_MobjThinker ?
+          (intptr_t) mo->thinker.prev : 0;
+      }
+    case sf_state:
+      return ptr ? (const state_t *) ptr - states : -1;
+    case sf_sector:
+      return (const sector_t *) ptr - sectors;
+    case sf_line:
+      return ptr ? (const line_t *) ptr - lines : -1;
+    default:
+      return ptr ? (const player_t *) ptr - players + 1 : 0;
+    }
+}
+
+static void P_SetField(uint8_t *p, int size, int kind, int64_t v)
+{
+  void *ptr;
+
+  switch (kind)
+    {
+    case sf_int:
+      switch (size)
+        {
+        case 1: { uint8_t  u = (uint8_t)  v; memcpy(p, &u, sizeof u); break; }
+        case 2: { uint16_t u = (uint16_t) v; memcpy(p, &u, sizeof u); break; }
+        case 4: { uint32_t u = (uint32_t) v; memcpy(p, &u, sizeof u); break; }
+        default: { uint64_t u = (uint64_t) v; memcpy(p, &u, sizeof u); break; }
+        }
+      return;
+    case sf_mobj:               // left an index, for P_UnArchiveThinkers
+      ptr = (void *)(intptr_t) v;
+      break;
+    case sf_state:
+      if (v >= NUMSTATES)
+        {
+          I_Error("Corrupt savegame");
+          v = -1;
+        }
+      ptr = v < 0 ? NULL : &states[v];
+      break;
+    case sf_sector:
+      if (v < 0 || v >= numsectors)
+        {
+          I_Error("Corrupt savegame");
+          v = 0;
+        }
+      ptr = &sectors[v];
+      break;
+    case sf_line:
+      if (v >= numlines)
+        {
+          I_Error("Corrupt savegame");
+          v = -1;
+        }
+      ptr = v < 0 ? NULL : &lines[v];
+      break;
+    default:
+      if (v > MAXPLAYERS)
+        {
+          I_Error("Corrupt savegame");
+          v = 0;
+        }
+      ptr = v <= 0 ? NULL : &players[v - 1];
+      break;
+    }
+  memcpy(p, &ptr, sizeof ptr);
+}
+
+static void P_SaveFields(const void *src, const savefield_t *f)
+{
+  for (; f->kind != sf_end; f++)
+    {
+      const uint8_t *p = (const uint8_t *) src + f->offset;
+      int i;
+
+      for (i = 0; i < f->count; i++, p += f->size)
+        P_SaveValue(P_GetField(p, f->size, f->kind), f->width);
+    }
+}
+
+static void P_LoadFields(void *dest, const savefield_t *f)
+{
+  for (; f->kind != sf_end; f++)
+    {
+      uint8_t *p = (uint8_t *) dest + f->offset;
+      int i;
+
+      for (i = 0; i < f->count; i++, p += f->size)
+        P_SetField(p, f->size, f->kind, P_LoadValue(f->width));
+    }
+}
+
 //
 // P_ArchivePlayers
 //
@@ -54,22 +487,10 @@ void P_ArchivePlayers (void)
 {
   int i;
 
-  CheckSaveGame(sizeof(player_t) * MAXPLAYERS); // killough
+  CheckSaveGame(P_FieldsSize(playerfields) * MAXPLAYERS); // killough
   for (i=0 ; i<MAXPLAYERS ; i++)
     if (playeringame[i])
-      {
-        int      j;
-        player_t *dest;
-
-        PADSAVEP();
-        dest = (player_t *) save_p;
-        memcpy(dest, &players[i], sizeof(player_t));
-        save_p += sizeof(player_t);
-        for (j=0; j<NUMPSPRITES; j++)
-          if (dest->psprites[j].state)
-            dest->psprites[j].state =
-              (state_t *)(dest->psprites[j].state-states);
-      }
+      P_SaveFields(&players[i], playerfields);
 }
 
 //
@@ -82,103 +503,240 @@ void P_UnArchivePlayers (void)
   for (i=0 ; i<MAXPLAYERS ; i++)
     if (playeringame[i])
       {
-        int j;
-
-        PADSAVEP();
-
-        memcpy(&players[i], save_p, sizeof(player_t));
-        save_p += sizeof(player_t);
-
-        // will be set when unarc thinker
-        players[i].mo = NULL;
-        players[i].message = NULL;
-        players[i].attacker = NULL;
-
-        for (j=0 ; j<NUMPSPRITES ; j++)
-          if (players[i]. psprites[j].state)
-            players[i]. psprites[j].state =
-              &states[ (uintptr_t)players[i].psprites[j].state ];
+        // mo is set when unarc thinker, message and attacker left NULL
+        memset(&players[i], 0, sizeof players[i]);
+        P_LoadFields(&players[i], playerfields);
       }
 }
 
-
 //
 // P_ArchiveWorld
 //
-void P_ArchiveWorld (void)
+
+// killough 10/98: full floor & ceiling heights and sidedef offsets,
+// including fractions
+#define SECTORBYTES   (2*4 + 5*2)
+#define LINEBYTES     (3*2)
+#define SIDEBYTES     (2*4 + 3*2)
+
+static size_t P_WorldSize(void)
 {
-  int            i;
-  const sector_t *sec;
-  const line_t   *li;
-  const side_t   *si;
-  short          *put;
-
-  // killough 3/22/98: fix bug caused by hoisting save_p too early
-  // killough 10/98: adjust size for changes below
-  size_t size =
-    (sizeof(short)*5 + sizeof sec->floorheight + sizeof sec->ceilingheight)
-    * numsectors + sizeof(short)*3*numlines + 4;
+  int    i;
+  size_t size = numsectors*SECTORBYTES + numlines*LINEBYTES;
 
   for (i=0; i<numlines; i++)
     {
       if (lines[i].sidenum[0] != NO_INDEX)
-        size +=
-    sizeof(short)*3 + sizeof si->textureoffset + sizeof si->rowoffset;
+        size += SIDEBYTES;
       if (lines[i].sidenum[1] != NO_INDEX)
-  size +=
-    sizeof(short)*3 + sizeof si->textureoffset + sizeof si->rowoffset;
+        size += SIDEBYTES;
     }
+  return size;
+}
 
-  CheckSaveGame(size); // killough
+//
+// The world as P_ArchiveWorld writes it is kept for the level, and a
+// save only encodes again the sectors, lines and sides marked dirty
+// since the last one, then copies the lot. Whatever changes a field
+// saved here has to mark it: the movers, lights and specials through
+// P_MarkSectorDirty, P_MarkLineDirty and P_MarkSideDirty, and the
+// renderer through P_MarkLineMapped, which is safe from its threads.
+// The image is made on the first save of a level, or taken from what
+// P_UnArchiveWorld reads.
+//
 
-  PADSAVEP();                // killough 3/22/98
+static uint8_t *worldimage;     // NULL until made for the level
+static size_t  worldbytes;
+static int     *lineslot;       // where each line's record is in the image
+static int     *sidefirst;      // each side's first record, -1 for none
+static int     *sidenext;       // the side's next record, for shared sides
+static int     *sideslot;       // where each side record is in the image
+static int     *dirtylist[3];   // sectors, lines, sides marked since
+static int     numdirty[3];
+static uint8_t *dirtyflag[3];
+static uint8_t *linemapped;     // lines the renderer has newly mapped
+static volatile dbool anymapped;
+
+enum { dirty_sector, dirty_line, dirty_side };
+
+static void P_MarkDirty(int kind, int i, int n)
+{
+  if (!worldimage || (unsigned) i >= (unsigned) n || dirtyflag[kind][i])
+    return;
+  dirtyflag[kind][i] = 1;
+  dirtylist[kind][numdirty[kind]++] = i;
+}
 
-  put = (short *)save_p;
+void P_MarkSectorDirty(const sector_t *sec)
+{
+  P_MarkDirty(dirty_sector, sec - sectors, numsectors);
+}
 
-  // do sectors
-  for (i=0, sec = sectors ; i<numsectors ; i++,sec++)
+// Lines made up by action functions (see A_LineEffect) aren't in lines[]
+// and are passed over
+void P_MarkLineDirty(const line_t *line)
+{
+  P_MarkDirty(dirty_line, line - lines, numlines);
+}
+
+void P_MarkSideDirty(const side_t *side)
+{
+  P_MarkDirty(dirty_side, side - sides, numsides);
+}
+
+void P_MarkLineMapped(const line_t *line)
+{
+  if (worldimage)
     {
-      // killough 10/98: save full floor & ceiling heights, including fraction
-      memcpy(put, &sec->floorheight, sizeof sec->floorheight);
-      put = (void *)((char *) put + sizeof sec->floorheight);
-      memcpy(put, &sec->ceilingheight, sizeof sec->ceilingheight);
-      put = (void *)((char *) put + sizeof sec->ceilingheight);
-
-      *put++ = sec->floorpic;
-      *put++ = sec->ceilingpic;
-      *put++ = sec->lightlevel;
-      *put++ = sec->special;            // needed?   yes -- transfer types
-      *put++ = sec->tag;                // needed?   need them -- killough
+      linemapped[line - lines] = 1;
+      anymapped = TRUE;
     }
+}
 
-  // do lines
-  for (i=0, li = lines ; i<numlines ; i++,li++)
-    {
-      int j;
+// Call when the level has been set up again and the image freed with it
+void P_ResetWorldImage(void)
+{
+  worldimage = NULL;
+}
 
-      *put++ = li->flags;
-      *put++ = li->special;
-      *put++ = li->tag;
+static void P_PutSector(uint8_t *put, const sector_t *sec)
+{
+  put = P_WriteLE(put, sec->floorheight, 4);
+  put = P_WriteLE(put, sec->ceilingheight, 4);
+  put = P_WriteLE(put, sec->floorpic, 2);
+  put = P_WriteLE(put, sec->ceilingpic, 2);
+  put = P_WriteLE(put, sec->lightlevel, 2);
+  put = P_WriteLE(put, sec->special, 2);  // needed?   yes -- transfer types
+  P_WriteLE(put, sec->tag, 2);            // needed?   need them -- killough
+}
 
-      for (j=0; j<2; j++)
-        if (li->sidenum[j] != NO_INDEX)
+static void P_PutLine(uint8_t *put, const line_t *li)
+{
+  put = P_WriteLE(put, li->flags, 2);
+  put = P_WriteLE(put, li->special, 2);
+  P_WriteLE(put, li->tag, 2);
+}
+
+static void P_PutSide(uint8_t *put, const side_t *si)
+{
+  put = P_WriteLE(put, si->textureoffset, 4);
+  put = P_WriteLE(put, si->rowoffset, 4);
+  put = P_WriteLE(put, si->toptexture, 2);
+  put = P_WriteLE(put, si->bottomtexture, 2);
+  P_WriteLE(put, si->midtexture, 2);
+}
+
+// Lays out the image for the level, filled in from src if given
+static void P_MakeWorldImage(const uint8_t *src)
+{
+  int i, j, k, numrecords = 0;
+  int counts[3];
+
+  counts[dirty_sector] = numsectors;
+  counts[dirty_line] = numlines;
+  counts[dirty_side] = numsides;
+  for (i = 0; i < numlines; i++)
+    for (j = 0; j < 2; j++)
+      if (lines[i].sidenum[j] != NO_INDEX)
+        numrecords++;
+
+  worldbytes = numsectors*SECTORBYTES + numlines*LINEBYTES + numrecords*SIDEBYTES;
+  worldimage = Z_Malloc(worldbytes, PU_LEVEL, 0);
+  lineslot = Z_Malloc(numlines * sizeof *lineslot, PU_LEVEL, 0);
+  sidefirst = Z_Malloc(numsides * sizeof *sidefirst, PU_LEVEL, 0);
+  sidenext = Z_Malloc(numrecords * sizeof *sidenext, PU_LEVEL, 0);
+  sideslot = Z_Malloc(numrecords * sizeof *sideslot, PU_LEVEL, 0);
+  linemapped = Z_Calloc(numlines, 1, PU_LEVEL, 0);
+  anymapped = FALSE;
+  for (i = 0; i < 3; i++)
+    {
+      dirtylist[i] = Z_Malloc(counts[i] * sizeof *dirtylist[i], PU_LEVEL, 0);
+      dirtyflag[i] = Z_Calloc(counts[i], 1, PU_LEVEL, 0);
+      numdirty[i] = 0;
+    }
+
+  for (i = 0; i < numsides; i++)
+    sidefirst[i] = -1;
+  k = numsectors*SECTORBYTES;
+  numrecords = 0;
+  for (i = 0; i < numlines; i++)
+    {
+      lineslot[i] = k;
+      k += LINEBYTES;
+      for (j = 0; j < 2; j++)
+        if (lines[i].sidenum[j] != NO_INDEX)
           {
-      si = &sides[li->sidenum[j]];
+            int side = lines[i].sidenum[j];
+            sideslot[numrecords] = k;
+            sidenext[numrecords] = sidefirst[side];
+            sidefirst[side] = numrecords++;
+            k += SIDEBYTES;
+          }
+    }
+
+  if (src)
+    {
+      memcpy(worldimage, src, worldbytes);
+      return;
+    }
+
+  for (i = 0; i < numsectors; i++)
+    P_PutSector(worldimage + i*SECTORBYTES, &sectors[i]);
+  for (i = 0; i < numlines; i++)
+    P_PutLine(worldimage + lineslot[i], &lines[i]);
+  for (i = 0; i < numsides; i++)
+    for (k = sidefirst[i]; k >= 0; k = sidenext[k])
+      P_PutSide(worldimage + sideslot[k], &sides[i]);
+}
 
-      // killough 10/98: save full sidedef offsets,
-      // preserving fractional scroll offsets
+static void P_UpdateWorldImage(void)
+{
+  int i, k;
 
-      memcpy(put, &si->textureoffset, sizeof si->textureoffset);
-      put = (void *)((char *) put + sizeof si->textureoffset);
-      memcpy(put, &si->rowoffset, sizeof si->rowoffset);
-      put = (void *)((char *) put + sizeof si->rowoffset);
+  for (i = 0; i < numdirty[dirty_sector]; i++)
+    {
+      int n = dirtylist[dirty_sector][i];
+      P_PutSector(worldimage + n*SECTORBYTES, &sectors[n]);
+      dirtyflag[dirty_sector][n] = 0;
+    }
+  for (i = 0; i < numdirty[dirty_line]; i++)
+    {
+      int n = dirtylist[dirty_line][i];
+      P_PutLine(worldimage + lineslot[n], &lines[n]);
+      dirtyflag[dirty_line][n] = 0;
+    }
+  for (i = 0; i < numdirty[dirty_side]; i++)
+    {
+      int n = dirtylist[dirty_side][i];
+      for (k = sidefirst[n]; k >= 0; k = sidenext[k])
+        P_PutSide(worldimage + sideslot[k], &sides[n]);
+      dirtyflag[dirty_side][n] = 0;
+    }
+  numdirty[dirty_sector] = numdirty[dirty_line] = numdirty[dirty_side] = 0;
 
-            *put++ = si->toptexture;
-            *put++ = si->bottomtexture;
-            *put++ = si->midtexture;
+  if (anymapped)
+    {
+      anymapped = FALSE;
+      for (i = 0; i < numlines; i++)
+        if (linemapped[i])
+          {
+            linemapped[i] = 0;
+            P_PutLine(worldimage + lineslot[i], &lines[i]);
           }
     }
-  save_p = (uint8_t*) put;
+}
+
+void P_ArchiveWorld (void)
+{
+  CheckSaveGame(P_WorldSize()); // killough
+
+  if (!worldimage)
+    P_MakeWorldImage(NULL);
+  else
+    P_UpdateWorldImage();
+
+  memcpy(save_p, worldimage, worldbytes);
+  save_p += worldbytes;
 }
 
 
@@ -191,59 +749,52 @@ void P_UnArchiveWorld (void)
   int          i;
   sector_t     *sec;
   line_t       *li;
-  short        *get;
-
-  PADSAVEP();                // killough 3/22/98
-
-  get = (short *) save_p;
+  const uint8_t *get = save_p;
 
   // do sectors
   for (i=0, sec = sectors ; i<numsectors ; i++,sec++)
     {
-      // killough 10/98: load full floor & ceiling heights, including fractions
-
-      memcpy(&sec->floorheight, get, sizeof sec->floorheight);
-      get = (void *)((char *) get + sizeof sec->floorheight);
-      memcpy(&sec->ceilingheight, get, sizeof sec->ceilingheight);
-      get = (void *)((char *) get + sizeof sec->ceilingheight);
-
-      sec->floorpic = *get++;
-      sec->ceilingpic = *get++;
-      sec->lightlevel = *get++;
-      sec->special = *get++;
-      sec->tag = *get++;
+      sec->floorheight = P_ReadLE(&get, 4);
+      sec->ceilingheight = P_ReadLE(&get, 4);
+      sec->floorpic = P_ReadLE(&get, 2);
+      sec->ceilingpic = P_ReadLE(&get, 2);
+      sec->lightlevel = P_ReadLE(&get, 2);
+      sec->special = P_ReadLE(&get, 2);
+      sec->tag = P_ReadLE(&get, 2);
       sec->ceilingdata = 0; //jff 2/22/98 now three thinker fields, not two
       sec->floordata = 0;
       sec->lightingdata = 0;
       sec->soundtarget = 0;
     }
+  sightgeneration++;         // the heights cached sight checks saw are gone
+  openinggeneration++;       // and so are the line openings
+  P_FrictionChanged();
+  P_ResetSoundCache();
 
   // do lines
   for (i=0, li = lines ; i<numlines ; i++,li++)
     {
       int j;
 
-      li->flags = *get++;
-      li->special = *get++;
-      li->tag = *get++;
+      li->flags = P_ReadLE(&get, 2);
+      li->special = P_ReadLE(&get, 2);
+      li->tag = P_ReadLE(&get, 2);
       for (j=0 ; j<2 ; j++)
         if (li->sidenum[j] != NO_INDEX)
           {
             side_t *si = &sides[li->sidenum[j]];
 
-      // killough 10/98: load full sidedef offsets, including fractions
-
-      memcpy(&si->textureoffset, get, sizeof si->textureoffset);
-      get = (void *)((char *) get + sizeof si->textureoffset);
-      memcpy(&si->rowoffset, get, sizeof si->rowoffset);
-      get = (void *)((char *) get + sizeof si->rowoffset);
-
-            si->toptexture = *get++;
-            si->bottomtexture = *get++;
-            si->midtexture = *get++;
+            si->textureoffset = P_ReadLE(&get, 4);
+            si->rowoffset = P_ReadLE(&get, 4);
+            si->toptexture = P_ReadLE(&get, 2);
+            si->bottomtexture = P_ReadLE(&get, 2);
+            si->midtexture = P_ReadLE(&get, 2);
           }
     }
-  save_p = (uint8_t*) get;
+
+  // the world is now what was read, so that's the image to save from
+  P_MakeWorldImage(save_p);
+  save_p = (uint8_t *) get;
 }
 
 //
@@ -295,82 +846,29 @@ void P_IndexToThinker(void)
 void P_ArchiveThinkers (void)
 {
   thinker_t *th;
+  size_t    mobjbytes = P_FieldsSize(mobjfields);
 
-  CheckSaveGame(sizeof brain);      // killough 3/26/98: Save boss brain state
-  memcpy(save_p, &brain, sizeof brain);
-  save_p += sizeof brain;
+  CheckSaveGame(2*4);      // killough 3/26/98: Save boss brain state
+  P_SaveValue(brain.easy, 4);
+  P_SaveValue(brain.targeton, 4);
 
   /* check that enough room is available in savegame buffer
    * - killough 2/14/98
    * cph - use number_of_thinkers saved by P_ThinkerToIndex above
-   * size per object is sizeof(mobj_t) - 2*sizeof(void*) - 4*sizeof(fixed_t) plus
-   * padded type (4) plus 5*sizeof(void*), i.e. sizeof(mobj_t) + 4 +
-   * 3*sizeof(void*)
    * cph - +1 for the tc_end
    */
-  CheckSaveGame(number_of_thinkers*(sizeof(mobj_t)-3*sizeof(fixed_t)+4+3*sizeof(void*)) +1);
+  CheckSaveGame(number_of_thinkers*(1+mobjbytes) +1);
 
   // save off the current thinkers
   for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
     if (th->function == P_MobjThinker)
       {
-        mobj_t *mobj;
-
+        // killough 2/14/98: target, tracer and lastenemy go as indices.
+        // Fixes many savegame problems, and keeps monsters from going to
+        // sleep after killing monsters and not seeing player anymore.
+        // The sector links and touching_sectorlist are made again.
         *save_p++ = tc_mobj;
-        PADSAVEP();
-        mobj = (mobj_t *)save_p;
-	/* cph 2006/07/30 - 
-	 * The end of mobj_t changed from
-	 *  dbool   invisible;
-	 *  mobj_t* lastenemy;
-	 *  mobj_t* above_monster;
-	 *  mobj_t* below_monster;
-	 *  void* touching_sectorlist;
-	 * to
-	 *  mobj_t* lastenemy;
-	 *  void* touching_sectorlist;
-         *  fixed_t PrevX, PrevY, PrevZ, padding;
-	 * at prboom 2.4.4. There is code here to preserve the savegame format.
-	 *
-	 * touching_sectorlist is reconstructed anyway, so we now leave off the
-	 * last 2 words of mobj_t, write 5 words of 0 and then write lastenemy
-	 * into the second of these.
-	 */
-        memcpy (mobj, th, sizeof(*mobj) - 2*sizeof(void*));
-        save_p += sizeof(*mobj) - 2*sizeof(void*) - 4*sizeof(fixed_t);
-        memset (save_p, 0, 5*sizeof(void*));
-        mobj->state = (state_t *)(mobj->state - states);
-
-        // killough 2/14/98: convert pointers into indices.
-        // Fixes many savegame problems, by properly saving
-        // target and tracer fields. Note: we store NULL if
-        // the thinker pointed to by these fields is not a
-        // mobj thinker.
-
-        if (mobj->target)
-          mobj->target = mobj->target->thinker.function ==
-            P_MobjThinker ?
-            (mobj_t *) mobj->target->thinker.prev : NULL;
-
-        if (mobj->tracer)
-          mobj->tracer = mobj->tracer->thinker.function ==
-            P_MobjThinker ?
-            (mobj_t *) mobj->tracer->thinker.prev : NULL;
-
-        // killough 2/14/98: new field: save last known enemy. Prevents
-        // monsters from going to sleep after killing monsters and not
-        // seeing player anymore.
-
-        if (((mobj_t*)th)->lastenemy && ((mobj_t*)th)->lastenemy->thinker.function == P_MobjThinker) {
-          memcpy (save_p + sizeof(void*), &(((mobj_t*)th)->lastenemy->thinker.prev), sizeof(void*));
-	}
-
-        // killough 2/14/98: end changes
-
-        save_p += 5*sizeof(void*);
-
-        if (mobj->player)
-          mobj->player = (player_t *)((mobj->player-players) + 1);
+        P_SaveFields(th, mobjfields);
       }
 
   // add a terminating marker
@@ -379,25 +877,14 @@ void P_ArchiveThinkers (void)
   // killough 9/14/98: save soundtargets
   {
     int i;
-    CheckSaveGame(numsectors * sizeof(mobj_t *));       // killough 9/14/98
+    CheckSaveGame(numsectors * 4);       // killough 9/14/98
     for (i = 0; i < numsectors; i++)
-    {
-      mobj_t *target = sectors[i].soundtarget;
-
-      // Fix crash on reload when a soundtarget points to a removed corpse
-      // (prboom bug #1590350)
-      if (target && target->thinker.function == P_MobjThinker)
-        target = (mobj_t *) target->thinker.prev;
-      else
-        target = NULL;
-
-      if (target)
-        memcpy(save_p, &target, sizeof target);
-      else
-        memset(save_p, 0, sizeof target);
-
-      save_p += sizeof target;
-    }
+      {
+        // Fix crash on reload when a soundtarget points to a removed corpse
+        // (prboom bug #1590350)
+        mobj_t *target = sectors[i].soundtarget;
+        P_SaveValue(P_GetField((const uint8_t *) &target, sizeof target, sf_mobj), 4);
+      }
   }
 }
 
@@ -426,96 +913,297 @@ static void P_SetNewTarget(mobj_t **mop, mobj_t *targ)
 static int P_GetMobj(mobj_t* mi, size_t s)
 {
   uintptr_t i = (uintptr_t)mi;
-  if (i >= s) I_Error("Corrupt savegame");
+  if (i >= s)
+    {
+      I_Error("Corrupt savegame");
+      return 0;
+    }
   return (int)i;
 }
 
+//
+// The 210-212 savegames were copied from memory as it was laid out, on
+// the machine that saved them. P_UnArchiveLegacyGame below reads them
+// the way they were written, so games saved before 213 still load, on
+// the same kind of machine as always.
+//
+
+static dbool legacyload;        // reading one of those, see below
+
+// Pads save_p to a 4-byte boundary
+//  so that the load/save works on SGI&Gecko.
+#define PADSAVEP()    do { save_p += (4 - ((uintptr_t) save_p & 3)) & 3; } while (0)
+
+// mobj_t as those savegames hold it
+typedef struct
+{
+  thinker_t           thinker;
+  fixed_t             x, y, z;
+  struct mobj_s*      snext;
+  struct mobj_s**     sprev;
+  angle_t             angle;
+  angle_t             pitch;
+  spritenum_t         sprite;
+  int                 frame;
+  struct mobj_s*      bnext;
+  struct mobj_s**     bprev;
+  struct subsector_s* subsector;
+  fixed_t             floorz;
+  fixed_t             ceilingz;
+  fixed_t             dropoffz;
+  fixed_t             radius;
+  fixed_t             height;
+  fixed_t             momx, momy, momz;
+  int                 validcount;
+  mobjtype_t          type;
+  mobjinfo_t*         info;
+  int                 tics;
+  state_t*            state;
+  uint64_t            flags;
+  int                 intflags;
+  int                 health;
+  short               movedir;
+  short               movecount;
+  short               strafecount;
+  struct mobj_s*      target;
+  short               reactiontime;
+  short               threshold;
+  short               pursuecount;
+  short               gear;
+  struct player_s*    player;
+  short               lastlook;
+  mapthing_t          spawnpoint;
+  struct mobj_s*      tracer;
+  struct mobj_s*      lastenemy;
+  int                 friction;
+  int                 movefactor;
+  struct msecnode_s*  touching_sectorlist;
+  fixed_t             PrevX, PrevY, PrevZ;
+  short               iden_num;
+  fixed_t             pad;
+} legacymobj_t;
+
+// An index the old formats kept in a pointer field
+static uintptr_t P_LegacyIndex(const void *p, uintptr_t n)
+{
+  uintptr_t i = (uintptr_t) p;
+  if (i >= n)
+    {
+      I_Error("Corrupt savegame");
+      return 0;
+    }
+  return i;
+}
+
+static void P_LoadLegacyMobj(mobj_t *mobj)
+{
+  legacymobj_t old;
+
+  PADSAVEP();
+  /* cph 2006/07/30 - touching_sectorlist and the fields after it were
+   * left off, and 5 words saved in their place, lastenemy in the 2nd. */
+  memset(&old, 0, sizeof old);
+  memcpy(&old, save_p, sizeof old - 2*sizeof(void*) - 4*sizeof(fixed_t));
+  save_p += sizeof old - sizeof(void*) - 4*sizeof(fixed_t);
+  memcpy(&old.lastenemy, save_p, sizeof old.lastenemy);
+  save_p += 4*sizeof(void*);
+
+  mobj->x = old.x;
+  mobj->y = old.y;
+  mobj->z = old.z;
+  mobj->angle = old.angle;
+  mobj->pitch = old.pitch;
+  mobj->sprite = old.sprite;
+  mobj->frame = old.frame;
+  mobj->floorz = old.floorz;
+  mobj->ceilingz = old.ceilingz;
+  mobj->dropoffz = old.dropoffz;
+  mobj->radius = old.radius;
+  mobj->height = old.height;
+  mobj->momx = old.momx;
+  mobj->momy = old.momy;
+  mobj->momz = old.momz;
+  mobj->validcount = old.validcount;
+  mobj->type = old.type;
+  mobj->tics = old.tics;
+  mobj->state = &states[P_LegacyIndex(old.state, NUMSTATES)];
+  mobj->flags = old.flags;
+  mobj->intflags = old.intflags;
+  mobj->health = old.health;
+  mobj->movedir = old.movedir;
+  mobj->movecount = old.movecount;
+  mobj->strafecount = old.strafecount;
+  mobj->target = old.target;            // indices, as P_LoadFields leaves them
+  mobj->tracer = old.tracer;
+  mobj->lastenemy = old.lastenemy;
+  mobj->reactiontime = old.reactiontime;
+  mobj->threshold = old.threshold;
+  mobj->pursuecount = old.pursuecount;
+  mobj->gear = old.gear;
+  mobj->player = old.player ?
+    &players[P_LegacyIndex(old.player, MAXPLAYERS+1) - 1] : NULL;
+  mobj->lastlook = old.lastlook;
+  mobj->spawnpoint = old.spawnpoint;
+  mobj->friction = old.friction;
+  mobj->movefactor = old.movefactor;
+  mobj->iden_num = old.iden_num;
+}
+
+static void P_LoadMobj(mobj_t *mobj)
+{
+  if (legacyload)
+    P_LoadLegacyMobj(mobj);
+  else
+    P_LoadFields(mobj, mobjfields);
+}
+
+// Every load comes after G_InitNew has set up the level again, so the
+// things from its map are there to be thrown away. Those still where
+// the savegame has a thing, at the same place and size, are taken over
+// by it rather than freed and made again: the sector nodes they got when
+// they were spawned are the ones P_SetThingPosition would make, and go
+// back in with P_RelinkThingPosition. A map's things are saved in the
+// order they were spawned, so each saved thing looks for its match a
+// little way past the last one found.
+
+#define REUSE_LOOKAHEAD 16
+
+static mobj_t *P_FindReusableMobj(const mobj_t *saved, mobj_t **spawned,
+                                  size_t numspawned, size_t *next)
+{
+  size_t i, end = MIN(*next + REUSE_LOOKAHEAD, numspawned);
+
+  for (i = *next; i < end; i++)
+    {
+      mobj_t *mo = spawned[i];
+      if (mo && mo->x == saved->x && mo->y == saved->y &&
+          mo->radius == saved->radius &&
+          !((mo->flags ^ saved->flags) & MF_NOSECTOR))
+        {
+          spawned[i] = NULL;
+          *next = i + 1;
+          return mo;
+        }
+    }
+  return NULL;
+}
+
 void P_UnArchiveThinkers (void)
 {
   thinker_t *th;
-  mobj_t    **mobj_p;    // killough 2/14/98: Translation table
+  static mobj_t **mobj_p;     // killough 2/14/98: Translation table
+  static size_t mobj_p_size;  // kept between loads, which come every frame with run-ahead
+  static mobj_t **spawned;    // the level's things, less those taken over
+  static size_t spawned_size;
+  size_t    numspawned = 0;
   size_t    size;        // killough 2/14/98: size of or index into table
+  size_t    mobjbytes = P_FieldsSize(mobjfields);
 
   totallive = 0;
   // killough 3/26/98: Load boss brain state
-  memcpy(&brain, save_p, sizeof brain);
-  save_p += sizeof brain;
-
-  // remove all the current thinkers
-  for (th = thinkercap.next; th != &thinkercap; )
+  if (legacyload)
     {
-      thinker_t *next = th->next;
-      if (th->function == P_MobjThinker)
+      memcpy(&brain, save_p, sizeof brain);
+      save_p += sizeof brain;
+    }
+  else
+    {
+      brain.easy = P_LoadValue(4);
+      brain.targeton = P_LoadValue(4);
+    }
+
+  for (th = thinkercap.next; th != &thinkercap; th = th->next)
+    if (th->function == P_MobjThinker)
       {
-        P_RemoveMobj ((mobj_t *) th);
-        P_RemoveThinkerDelayed(th); // fix mobj leak
+        if (numspawned == spawned_size)
+          spawned = realloc(spawned, (spawned_size = spawned_size ? spawned_size*2 : 256) * sizeof *spawned);
+        spawned[numspawned++] = (mobj_t *) th;
       }
-      else
-        Z_Free (th);
-      th = next;
-    }
-  P_InitThinkers ();
 
   // killough 2/14/98: count number of thinkers by skipping through them
   {
     uint8_t *sp = save_p;     // save pointer and skip header
+    size_t next = 0;
+
     for (size = 1; *save_p++ == tc_mobj; size++)  // killough 2/14/98
-      {                     // skip all entries, adding up count
-        PADSAVEP();
-	/* cph 2006/07/30 - see comment below for change in layout of mobj_t */
-        save_p += sizeof(mobj_t)+3*sizeof(void*)-4*sizeof(fixed_t);
-      }
+      if (legacyload)       // skip all entries, adding up count
+        {
+          mobj_t skipped;
+          P_LoadLegacyMobj(&skipped);
+        }
+      else
+        save_p += mobjbytes;
 
     if (*--save_p != tc_end)
       I_Error ("P_UnArchiveThinkers: Unknown tclass %i in savegame", *save_p);
 
     // first table entry special: 0 maps to NULL
-    *(mobj_p = malloc(size * sizeof *mobj_p)) = 0;   // table of pointers
+    if (size > mobj_p_size)
+      mobj_p = realloc(mobj_p, (mobj_p_size = size) * sizeof *mobj_p);
+    *mobj_p = 0;   // table of pointers
     save_p = sp;           // restore save pointer
+
+    // pick the things to take over, to be found in the table
+    for (size = 1; *save_p++ == tc_mobj; size++)
+      {
+        mobj_t saved;
+        P_LoadMobj(&saved);
+        mobj_p[size] = P_FindReusableMobj(&saved, spawned, numspawned, &next);
+      }
+    save_p = sp;
   }
 
+  // remove all the current thinkers
+  for (th = thinkercap.next; th != &thinkercap; th = th->next)
+    if (th->function == P_MobjThinker)
+      P_DiscardMobj((mobj_t *) th);
+  for (size = 0; size < numspawned; size++)
+    if (spawned[size])
+      P_DelSeclist(spawned[size]->touching_sectorlist);
+  P_ClearThingLinks();
+  for (th = thinkercap.next; th != &thinkercap; )
+    {
+      thinker_t *next = th->next;
+      if (th->function != P_MobjThinker)
+        P_FreeThinker(th);
+      th = next;
+    }
+  for (size = 0; size < numspawned; size++)
+    if (spawned[size])
+      P_FreeThinker(&spawned[size]->thinker);
+  P_InitThinkers ();
+
   // read in saved thinkers
   for (size = 1; *save_p++ == tc_mobj; size++)    // killough 2/14/98
     {
-      mobj_t *mobj = Z_Malloc(sizeof(mobj_t), PU_LEVEL, NULL);
+      mobj_t *mobj = mobj_p[size];
+      msecnode_t *nodes = mobj ? mobj->touching_sectorlist : NULL;
+
+      if (!mobj)
+        mobj = P_AllocThinker(TZ_MOBJ);
 
       // killough 2/14/98 -- insert pointers to thinkers into table, in order:
       mobj_p[size] = mobj;
 
-      PADSAVEP();
-      /* cph 2006/07/30 - 
-       * The end of mobj_t changed from
-       *  dbool   invisible;
-       *  mobj_t* lastenemy;
-       *  mobj_t* above_monster;
-       *  mobj_t* below_monster;
-       *  void* touching_sectorlist;
-       * to
-       *  mobj_t* lastenemy;
-       *  void* touching_sectorlist;
-       *  fixed_t PrevX, PrevY, PrevZ;
-       * at prboom 2.4.4. There is code here to preserve the savegame format.
-       *
-       * touching_sectorlist is reconstructed anyway, so we now read in all 
-       * but the last 5 words from the savegame (filling all but the last 2
-       * fields of our current mobj_t. We then pull lastenemy from the 2nd of
-       * the 5 leftover words, and skip the others.
-       */
-      memcpy (mobj, save_p, sizeof(mobj_t)-2*sizeof(void*)-4*sizeof(fixed_t));
-      save_p += sizeof(mobj_t)-sizeof(void*)-4*sizeof(fixed_t);
-      memcpy (&(mobj->lastenemy), save_p, sizeof(void*));
-      save_p += 4*sizeof(void*);
-      mobj->state = states + (uintptr_t) mobj->state;
+      // a thing taken over keeps none of what it had but its nodes
+      memset(mobj, 0, sizeof *mobj);
+      P_LoadMobj(mobj);
 
       if (mobj->player)
-        (mobj->player = &players[(uintptr_t) mobj->player - 1]) -> mo = mobj;
+        mobj->player->mo = mobj;
 
       // avoid glitchy interpolation
       mobj->PrevX = mobj->x;
       mobj->PrevY = mobj->y;
       mobj->PrevZ = mobj->z;
 
-      P_SetThingPosition (mobj);
+      if (nodes)
+        {
+          mobj->touching_sectorlist = nodes;
+          P_RelinkThingPosition (mobj);
+        }
+      else
+        P_SetThingPosition (mobj);
       mobj->info = &mobjinfo[mobj->type];
 
       // killough 2/28/98:
@@ -552,22 +1240,27 @@ void P_UnArchiveThinkers (void)
     int i;
     for (i = 0; i < numsectors; i++)
     {
-      mobj_t *target;
-      memcpy(&target, save_p, sizeof target);
-      save_p += sizeof target;
+      int64_t target;
+
+      if (legacyload)
+        {
+          mobj_t *saved;
+          memcpy(&saved, save_p, sizeof saved);
+          save_p += sizeof saved;
+          target = (intptr_t) saved;
+        }
+      else
+        target = P_LoadValue(4);
 
       // Must verify soundtarget. See P_ArchiveThinkers.
-      // Check if 'saved' soundtarget pointer was NULL
-      // or otherwise invalid
-      if (!target || P_GetMobj(target,size) >= size)
+      // Check if 'saved' soundtarget was none or otherwise invalid
+      if (target <= 0 || (uint64_t) target >= size)
         sectors[i].soundtarget = 0;
       else
-        P_SetNewTarget(&sectors[i].soundtarget, mobj_p[P_GetMobj(target,size)]);
+        P_SetNewTarget(&sectors[i].soundtarget, mobj_p[target]);
     }
   }
 
-  free(mobj_p);    // free translation table
-
   // killough 3/26/98: Spawn icon landings:
   if (gamemode == commercial)
     P_SpawnBrainTargets();
@@ -607,7 +1300,40 @@ enum {
 // T_FireFlicker                                            // killough 10/4/98
 //
 
-void P_ArchiveSpecials (void)
+// What P_ArchiveSpecials saves of a special thinker, for its class
+static const savefield_t *P_SpecialFields(const thinker_t *th)
+{
+  return
+    th->function==T_MoveCeiling  ? ceilingfields  :
+    th->function==T_VerticalDoor ? doorfields     :
+    th->function==T_MoveFloor    ? floorfields    :
+    th->function==T_PlatRaise    ? platfields     :
+    th->function==T_LightFlash   ? flashfields    :
+    th->function==T_StrobeFlash  ? strobefields   :
+    th->function==T_Glow         ? glowfields     :
+    th->function==T_MoveElevator ? elevatorfields :
+    th->function==T_Scroll       ? scrollfields   :
+    th->function==T_Pusher       ? pusherfields   :
+    th->function==T_FireFlicker  ? flickerfields  :
+    NULL;
+}
+
+// Plats and ceilings in stasis have no function, but are saved all the same
+static const savefield_t *P_StasisFields(const thinker_t *th)
+{
+  platlist_t *pl;
+  ceilinglist_t *cl;     //jff 2/22/98 need this for ceilings too now
+
+  for (pl=activeplats; pl; pl=pl->next)
+    if (pl->plat == (plat_t *) th)   // killough 2/14/98
+      return platfields;
+  for (cl=activeceilings; cl; cl=cl->next) // search for activeceiling
+    if (cl->ceiling == (ceiling_t *) th)   //jff 2/22/98
+      return ceilingfields;
+  return NULL;
+}
+
+static size_t P_SpecialsSize(void)
 {
   thinker_t *th;
   size_t    size = 0;          // killough
@@ -615,208 +1341,360 @@ void P_ArchiveSpecials (void)
   // save off the current thinkers (memory size calculation -- killough)
 
   for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
-    if (!th->function)
-      {
-        platlist_t *pl;
-        ceilinglist_t *cl;     //jff 2/22/98 need this for ceilings too now
-        for (pl=activeplats; pl; pl=pl->next)
-          if (pl->plat == (plat_t *) th)   // killough 2/14/98
-            {
-              size += 4+sizeof(plat_t);
-              goto end;
-            }
-        for (cl=activeceilings; cl; cl=cl->next) // search for activeceiling
-          if (cl->ceiling == (ceiling_t *) th)   //jff 2/22/98
-            {
-              size += 4+sizeof(ceiling_t);
-              goto end;
-            }
-      end:;
-      }
-    else
-      size +=
-        th->function==T_MoveCeiling  ? 4+sizeof(ceiling_t) :
-        th->function==T_VerticalDoor ? 4+sizeof(vldoor_t)  :
-        th->function==T_MoveFloor    ? 4+sizeof(floormove_t):
-        th->function==T_PlatRaise    ? 4+sizeof(plat_t)    :
-        th->function==T_LightFlash   ? 4+sizeof(lightflash_t):
-        th->function==T_StrobeFlash  ? 4+sizeof(strobe_t)  :
-        th->function==T_Glow         ? 4+sizeof(glow_t)    :
-        th->function==T_MoveElevator ? 4+sizeof(elevator_t):
-        th->function==T_Scroll       ? 4+sizeof(scroll_t)  :
-        th->function==T_Pusher       ? 4+sizeof(pusher_t)  :
-        th->function==T_FireFlicker? 4+sizeof(fireflicker_t) :
-      0;
-
-  CheckSaveGame(size + 1);    // killough; cph: +1 for the tc_endspecials
+    {
+      const savefield_t *f = th->function ? P_SpecialFields(th) : P_StasisFields(th);
+      if (f)
+        size += 2 + P_FieldsSize(f);
+    }
+
+  return size + 1;             // cph: +1 for the tc_endspecials
+}
+
+void P_ArchiveSpecials (void)
+{
+  thinker_t *th;
+
+  P_SyncLightThinkers();       // batched lights keep their counts apart
+
+  CheckSaveGame(P_SpecialsSize()); // killough
 
   // save off the current thinkers
   for (th=thinkercap.next; th!=&thinkercap; th=th->next)
     {
-      if (!th->function)
-        {
-          platlist_t *pl;
-          ceilinglist_t *cl;    //jff 2/22/98 add iter variable for ceilings
+      const savefield_t *f;
+
+      // killough 2/8/98: fix plat original height bug.
+      // Since acv==NULL, this could be a plat in stasis.
+      // so check the active plats list, and save this
+      // plat (jff: or ceiling) even if it is in stasis.
+      f = th->function ? P_SpecialFields(th) : P_StasisFields(th);
+      if (!f)
+        continue;
+
+      *save_p++ =
+        f == ceilingfields  ? tc_ceiling  :
+        f == doorfields     ? tc_door     :
+        f == floorfields    ? tc_floor    :
+        f == platfields     ? tc_plat     :
+        f == flashfields    ? tc_flash    :
+        f == strobefields   ? tc_strobe   :
+        f == glowfields     ? tc_glow     :
+        f == elevatorfields ? tc_elevator :
+        f == scrollfields   ? tc_scroll   :
+        f == pusherfields   ? tc_pusher   :
+                              tc_flicker;
+      *save_p++ = th->function != NULL;
+      P_SaveFields(th, f);
+    }
 
-          // killough 2/8/98: fix plat original height bug.
-          // Since acv==NULL, this could be a plat in stasis.
-          // so check the active plats list, and save this
-          // plat (jff: or ceiling) even if it is in stasis.
+  // add a terminating marker
+  *save_p++ = tc_endspecials;
+}
+
+
+// Reads a special into th, and gives it its function unless it was in
+// stasis
+static void P_LoadSpecial(thinker_t *th, size_t size,
+                          const savefield_t *f, think_t function)
+{
+  dbool active = *save_p++;
 
-          for (pl=activeplats; pl; pl=pl->next)
-            if (pl->plat == (plat_t *) th)      // killough 2/14/98
-              goto plat;
+  memset(th, 0, size);
+  P_LoadFields(th, f);
+  if (active)
+    th->function = function;
+  P_AddThinker(th);
+}
 
-          for (cl=activeceilings; cl; cl=cl->next)
-            if (cl->ceiling == (ceiling_t *) th)      //jff 2/22/98
-              goto ceiling;
+//
+// P_UnArchiveSpecials
+//
+void P_UnArchiveSpecials (void)
+{
+  uint8_t tclass;
 
-          continue;
+  // read in saved thinkers
+  while ((tclass = *save_p++) != tc_endspecials)  // killough 2/14/98
+    switch (tclass)
+      {
+      case tc_ceiling:
+        {
+          ceiling_t *ceiling = P_AllocThinker(TZ_CEILING);
+          P_LoadSpecial(&ceiling->thinker, sizeof *ceiling, ceilingfields, T_MoveCeiling);
+          ceiling->sector->ceilingdata = ceiling; //jff 2/22/98
+          P_AddActiveCeiling(ceiling);
+          break;
         }
 
-      if (th->function == T_MoveCeiling)
+      case tc_door:
         {
-          ceiling_t *ceiling;
-        ceiling:                               // killough 2/14/98
-          *save_p++ = tc_ceiling;
-          PADSAVEP();
-          ceiling = (ceiling_t *)save_p;
-          memcpy (ceiling, th, sizeof(*ceiling));
-          save_p += sizeof(*ceiling);
-          ceiling->sector = (sector_t *)(ceiling->sector - sectors);
-          continue;
+          vldoor_t *door = P_AllocThinker(TZ_DOOR);
+          //jff 1/31/98 unarchive line remembered by door as well
+          P_LoadSpecial(&door->thinker, sizeof *door, doorfields, T_VerticalDoor);
+          door->sector->ceilingdata = door;       //jff 2/22/98
+          break;
         }
 
-      if (th->function == T_VerticalDoor)
+      case tc_floor:
         {
-          vldoor_t *door;
-          *save_p++ = tc_door;
-          PADSAVEP();
-          door = (vldoor_t *) save_p;
-          memcpy (door, th, sizeof *door);
-          save_p += sizeof(*door);
-          door->sector = (sector_t *)(door->sector - sectors);
-          //jff 1/31/98 archive line remembered by door as well
-          door->line = (line_t *) (door->line ? door->line-lines : -1);
-          continue;
+          floormove_t *floor = P_AllocThinker(TZ_FLOOR);
+          P_LoadSpecial(&floor->thinker, sizeof *floor, floorfields, T_MoveFloor);
+          floor->sector->floordata = floor; //jff 2/22/98
+          break;
         }
 
-      if (th->function == T_MoveFloor)
+      case tc_plat:
         {
-          floormove_t *floor;
-          *save_p++ = tc_floor;
-          PADSAVEP();
-          floor = (floormove_t *)save_p;
-          memcpy (floor, th, sizeof(*floor));
-          save_p += sizeof(*floor);
-          floor->sector = (sector_t *)(floor->sector - sectors);
-          continue;
+          plat_t *plat = P_AllocThinker(TZ_PLAT);
+          P_LoadSpecial(&plat->thinker, sizeof *plat, platfields, T_PlatRaise);
+          plat->sector->floordata = plat; //jff 2/22/98
+          P_AddActivePlat(plat);
+          break;
         }
 
-      if (th->function == T_PlatRaise)
+      case tc_flash:
         {
-          plat_t *plat;
-        plat:   // killough 2/14/98: added fix for original plat height above
-          *save_p++ = tc_plat;
-          PADSAVEP();
-          plat = (plat_t *)save_p;
-          memcpy (plat, th, sizeof(*plat));
-          save_p += sizeof(*plat);
-          plat->sector = (sector_t *)(plat->sector - sectors);
-          continue;
+          lightflash_t *flash = P_AllocThinker(TZ_LIGHT);
+          P_LoadSpecial(&flash->thinker, sizeof *flash, flashfields, T_LightFlash);
+          break;
         }
 
-      if (th->function == T_LightFlash)
+      case tc_strobe:
         {
-          lightflash_t *flash;
-          *save_p++ = tc_flash;
-          PADSAVEP();
-          flash = (lightflash_t *)save_p;
-          memcpy (flash, th, sizeof(*flash));
-          save_p += sizeof(*flash);
-          flash->sector = (sector_t *)(flash->sector - sectors);
-          continue;
+          strobe_t *strobe = P_AllocThinker(TZ_LIGHT);
+          P_LoadSpecial(&strobe->thinker, sizeof *strobe, strobefields, T_StrobeFlash);
+          break;
         }
 
-      if (th->function == T_StrobeFlash)
+      case tc_glow:
         {
-          strobe_t *strobe;
-          *save_p++ = tc_strobe;
-          PADSAVEP();
-          strobe = (strobe_t *)save_p;
-          memcpy (strobe, th, sizeof(*strobe));
-          save_p += sizeof(*strobe);
-          strobe->sector = (sector_t *)(strobe->sector - sectors);
-          continue;
+          glow_t *glow = P_AllocThinker(TZ_LIGHT);
+          P_LoadSpecial(&glow->thinker, sizeof *glow, glowfields, T_Glow);
+          break;
         }
 
-      if (th->function == T_Glow)
+      case tc_flicker:           // killough 10/4/98
         {
-          glow_t *glow;
-          *save_p++ = tc_glow;
-          PADSAVEP();
-          glow = (glow_t *)save_p;
-          memcpy (glow, th, sizeof(*glow));
-          save_p += sizeof(*glow);
-          glow->sector = (sector_t *)(glow->sector - sectors);
-          continue;
+          fireflicker_t *flicker = P_AllocThinker(TZ_LIGHT);
+          P_LoadSpecial(&flicker->thinker, sizeof *flicker, flickerfields, T_FireFlicker);
+          break;
         }
 
-      // killough 10/4/98: save flickers
-      if (th->function == T_FireFlicker)
+        //jff 2/22/98 new case for elevators
+      case tc_elevator:
         {
-          fireflicker_t *flicker;
-          *save_p++ = tc_flicker;
-          PADSAVEP();
-          flicker = (fireflicker_t *)save_p;
-          memcpy (flicker, th, sizeof(*flicker));
-          save_p += sizeof(*flicker);
-          flicker->sector = (sector_t *)(flicker->sector - sectors);
-          continue;
+          elevator_t *elevator = P_AllocThinker(TZ_ELEVATOR);
+          P_LoadSpecial(&elevator->thinker, sizeof *elevator, elevatorfields, T_MoveElevator);
+          elevator->sector->floordata = elevator; //jff 2/22/98
+          elevator->sector->ceilingdata = elevator; //jff 2/22/98
+          break;
         }
 
-      //jff 2/22/98 new case for elevators
-      if (th->function == T_MoveElevator)
+      case tc_scroll:       // killough 3/7/98: scroll effect thinkers
         {
-          elevator_t *elevator;         //jff 2/22/98
-          *save_p++ = tc_elevator;
-          PADSAVEP();
-          elevator = (elevator_t *)save_p;
-          memcpy (elevator, th, sizeof(*elevator));
-          save_p += sizeof(*elevator);
-          elevator->sector = (sector_t *)(elevator->sector - sectors);
-          continue;
+          scroll_t *scroll = Z_Malloc (sizeof(scroll_t), PU_LEVEL, NULL);
+          P_LoadSpecial(&scroll->thinker, sizeof *scroll, scrollfields, T_Scroll);
+          break;
         }
 
-      // killough 3/7/98: Scroll effect thinkers
-      if (th->function == T_Scroll)
+      case tc_pusher:   // phares 3/22/98: new Push/Pull effect thinkers
         {
-          *save_p++ = tc_scroll;
-          memcpy (save_p, th, sizeof(scroll_t));
-          save_p += sizeof(scroll_t);
-          continue;
+          pusher_t *pusher = Z_Malloc (sizeof(pusher_t), PU_LEVEL, NULL);
+          P_LoadSpecial(&pusher->thinker, sizeof *pusher, pusherfields, T_Pusher);
+          pusher->source = P_GetPushThing(pusher->affectee);
+          break;
         }
 
-      // phares 3/22/98: Push/Pull effect thinkers
+      default:
+        I_Error("P_UnarchiveSpecials: Unknown tclass %i in savegame", tclass);
+        return;
+      }
+}
+
+// killough 2/16/98: save/restore random number generator state information
+
+void P_ArchiveRNG(void)
+{
+  int i;
 
-      if (th->function == T_Pusher)
+  CheckSaveGame(NUMPRCLASS*8 + 2*4);
+  for (i = 0; i < NUMPRCLASS; i++)
+    P_SaveValue(rng.seed[i], 8);
+  P_SaveValue(rng.rndindex, 4);
+  P_SaveValue(rng.prndindex, 4);
+}
+
+void P_UnArchiveRNG(void)
+{
+  int i;
+
+  for (i = 0; i < NUMPRCLASS; i++)
+    rng.seed[i] = P_LoadValue(8);
+  rng.rndindex = P_LoadValue(4);
+  rng.prndindex = P_LoadValue(4);
+}
+
+// killough 2/22/98: Save/restore automap state
+void P_ArchiveMap(void)
+{
+  int i;
+
+  CheckSaveGame(5*4 + markpointnum*2*4);
+
+  P_SaveValue(automapmode, 4);
+  P_SaveValue(1, 4);     // CPhipps - used to be viewactive, now
+                         // that's worked out locally by D_Display
+  P_SaveValue(0, 4);     // CPhipps - used to be followplayer
+                         //  that is now part of automapmode
+  P_SaveValue(0, 4);     // CPhipps - used to be automap_grid, ditto
+  P_SaveValue(markpointnum, 4);
+
+  for (i = 0; i < markpointnum; i++)
+    {
+      P_SaveValue(markpoints[i].x, 4);
+      P_SaveValue(markpoints[i].y, 4);
+    }
+}
+
+void P_UnArchiveMap(void)
+{
+  int i;
+
+  automapmode = P_LoadValue(4);
+  save_p += 3*4;         // unused, see P_ArchiveMap
+
+  if (automapmode & am_active)
+    AM_Start();
+
+  markpointnum = P_LoadValue(4);
+
+  if (markpointnum)
+    {
+      while (markpointnum >= markpointnum_max)
+        markpoints = realloc(markpoints, sizeof *markpoints *
+         (markpointnum_max = markpointnum_max ? markpointnum_max*2 : 16));
+      for (i = 0; i < markpointnum; i++)
         {
-          *save_p++ = tc_pusher;
-          memcpy (save_p, th, sizeof(pusher_t));
-          save_p += sizeof(pusher_t);
-          continue;
+          markpoints[i].x = P_LoadValue(4);
+          markpoints[i].y = P_LoadValue(4);
         }
     }
-
-  // add a terminating marker
-  *save_p++ = tc_endspecials;
 }
 
 
 //
-// P_UnArchiveSpecials
+// P_UnArchiveLegacyGame
+// Reads what a 210-212 savegame has after its header, as those
+// versions wrote it: P_UnArchivePlayers through P_UnArchiveMap in one.
 //
-void P_UnArchiveSpecials (void)
+
+static void P_UnArchiveLegacyPlayers(void)
+{
+  int i;
+
+  for (i=0 ; i<MAXPLAYERS ; i++)
+    if (playeringame[i])
+      {
+        int j;
+
+        PADSAVEP();
+
+        memcpy(&players[i], save_p, sizeof(player_t));
+        save_p += sizeof(player_t);
+
+        // will be set when unarc thinker
+        players[i].mo = NULL;
+        players[i].message = NULL;
+        players[i].centermessage = NULL;
+        players[i].attacker = NULL;
+
+        for (j=0 ; j<NUMPSPRITES ; j++)
+          if (players[i].psprites[j].state)
+            players[i].psprites[j].state =
+              &states[P_LegacyIndex(players[i].psprites[j].state, NUMSTATES)];
+      }
+}
+
+static void P_UnArchiveLegacyWorld(void)
+{
+  int          i;
+  sector_t     *sec;
+  line_t       *li;
+  short        *get;
+
+  PADSAVEP();                // killough 3/22/98
+
+  get = (short *) save_p;
+
+  // do sectors
+  for (i=0, sec = sectors ; i<numsectors ; i++,sec++)
+    {
+      // killough 10/98: load full floor & ceiling heights, including fractions
+      memcpy(&sec->floorheight, get, sizeof sec->floorheight);
+      get = (void *)((char *) get + sizeof sec->floorheight);
+      memcpy(&sec->ceilingheight, get, sizeof sec->ceilingheight);
+      get = (void *)((char *) get + sizeof sec->ceilingheight);
+
+      sec->floorpic = *get++;
+      sec->ceilingpic = *get++;
+      sec->lightlevel = *get++;
+      sec->special = *get++;
+      sec->tag = *get++;
+      sec->ceilingdata = 0; //jff 2/22/98 now three thinker fields, not two
+      sec->floordata = 0;
+      sec->lightingdata = 0;
+      sec->soundtarget = 0;
+    }
+  sightgeneration++;
+  openinggeneration++;
+  P_FrictionChanged();
+  P_ResetSoundCache();
+
+  // do lines
+  for (i=0, li = lines ; i<numlines ; i++,li++)
+    {
+      int j;
+
+      li->flags = *get++;
+      li->special = *get++;
+      li->tag = *get++;
+      for (j=0 ; j<2 ; j++)
+        if (li->sidenum[j] != NO_INDEX)
+          {
+            side_t *si = &sides[li->sidenum[j]];
+
+            // killough 10/98: load full sidedef offsets, including fractions
+            memcpy(&si->textureoffset, get, sizeof si->textureoffset);
+            get = (void *)((char *) get + sizeof si->textureoffset);
+            memcpy(&si->rowoffset, get, sizeof si->rowoffset);
+            get = (void *)((char *) get + sizeof si->rowoffset);
+
+            si->toptexture = *get++;
+            si->bottomtexture = *get++;
+            si->midtexture = *get++;
+          }
+    }
+  save_p = (uint8_t*) get;
+
+  // there's no 213 image to take, so the next save makes one
+  P_MakeWorldImage(NULL);
+}
+
+// Reads a special saved whole, keeping it in stasis if it was saved
+// with no function and may be
+static void P_LoadLegacySpecial(thinker_t *th, size_t size,
+                                think_t function, dbool stasis)
+{
+  memcpy(th, save_p, size);
+  save_p += size;
+  if (th->function || !stasis)
+    th->function = function;
+  P_AddThinker(th);
+}
+
+#define P_LegacySector(s) (&sectors[P_LegacyIndex((s), numsectors)])
+
+static void P_UnArchiveLegacySpecials(void)
 {
   uint8_t tclass;
 
@@ -827,16 +1705,10 @@ void P_UnArchiveSpecials (void)
       case tc_ceiling:
         PADSAVEP();
         {
-          ceiling_t *ceiling = Z_Malloc (sizeof(*ceiling), PU_LEVEL, NULL);
-          memcpy (ceiling, save_p, sizeof(*ceiling));
-          save_p += sizeof(*ceiling);
-          ceiling->sector = &sectors[(uintptr_t)ceiling->sector];
+          ceiling_t *ceiling = P_AllocThinker(TZ_CEILING);
+          P_LoadLegacySpecial(&ceiling->thinker, sizeof *ceiling, T_MoveCeiling, TRUE);
+          ceiling->sector = P_LegacySector(ceiling->sector);
           ceiling->sector->ceilingdata = ceiling; //jff 2/22/98
-
-          if (ceiling->thinker.function)
-            ceiling->thinker.function = T_MoveCeiling;
-
-          P_AddThinker (&ceiling->thinker);
           P_AddActiveCeiling(ceiling);
           break;
         }
@@ -844,46 +1716,33 @@ void P_UnArchiveSpecials (void)
       case tc_door:
         PADSAVEP();
         {
-          vldoor_t *door = Z_Malloc (sizeof(*door), PU_LEVEL, NULL);
-          memcpy (door, save_p, sizeof(*door));
-          save_p += sizeof(*door);
-          door->sector = &sectors[(uintptr_t)door->sector];
-
+          vldoor_t *door = P_AllocThinker(TZ_DOOR);
+          P_LoadLegacySpecial(&door->thinker, sizeof *door, T_VerticalDoor, FALSE);
+          door->sector = P_LegacySector(door->sector);
           //jff 1/31/98 unarchive line remembered by door as well
-          door->line = (intptr_t)door->line!=-1? &lines[(uintptr_t)door->line] : NULL;
-
+          door->line = (intptr_t) door->line != -1 ?
+            &lines[P_LegacyIndex(door->line, numlines)] : NULL;
           door->sector->ceilingdata = door;       //jff 2/22/98
-          door->thinker.function = T_VerticalDoor;
-          P_AddThinker (&door->thinker);
           break;
         }
 
       case tc_floor:
         PADSAVEP();
         {
-          floormove_t *floor = Z_Malloc (sizeof(*floor), PU_LEVEL, NULL);
-          memcpy (floor, save_p, sizeof(*floor));
-          save_p += sizeof(*floor);
-          floor->sector = &sectors[(uintptr_t)floor->sector];
+          floormove_t *floor = P_AllocThinker(TZ_FLOOR);
+          P_LoadLegacySpecial(&floor->thinker, sizeof *floor, T_MoveFloor, FALSE);
+          floor->sector = P_LegacySector(floor->sector);
           floor->sector->floordata = floor; //jff 2/22/98
-          floor->thinker.function = T_MoveFloor;
-          P_AddThinker (&floor->thinker);
           break;
         }
 
       case tc_plat:
         PADSAVEP();
         {
-          plat_t *plat = Z_Malloc (sizeof(*plat), PU_LEVEL, NULL);
-          memcpy (plat, save_p, sizeof(*plat));
-          save_p += sizeof(*plat);
-          plat->sector = &sectors[(uintptr_t)plat->sector];
+          plat_t *plat = P_AllocThinker(TZ_PLAT);
+          P_LoadLegacySpecial(&plat->thinker, sizeof *plat, T_PlatRaise, TRUE);
+          plat->sector = P_LegacySector(plat->sector);
           plat->sector->floordata = plat; //jff 2/22/98
-
-          if (plat->thinker.function)
-            plat->thinker.function = T_PlatRaise;
-
-          P_AddThinker (&plat->thinker);
           P_AddActivePlat(plat);
           break;
         }
@@ -891,48 +1750,36 @@ void P_UnArchiveSpecials (void)
       case tc_flash:
         PADSAVEP();
         {
-          lightflash_t *flash = Z_Malloc (sizeof(*flash), PU_LEVEL, NULL);
-          memcpy (flash, save_p, sizeof(*flash));
-          save_p += sizeof(*flash);
-          flash->sector = &sectors[(uintptr_t)flash->sector];
-          flash->thinker.function = T_LightFlash;
-          P_AddThinker (&flash->thinker);
+          lightflash_t *flash = P_AllocThinker(TZ_LIGHT);
+          P_LoadLegacySpecial(&flash->thinker, sizeof *flash, T_LightFlash, FALSE);
+          flash->sector = P_LegacySector(flash->sector);
           break;
         }
 
       case tc_strobe:
         PADSAVEP();
         {
-          strobe_t *strobe = Z_Malloc (sizeof(*strobe), PU_LEVEL, NULL);
-          memcpy (strobe, save_p, sizeof(*strobe));
-          save_p += sizeof(*strobe);
-          strobe->sector = &sectors[(uintptr_t)strobe->sector];
-          strobe->thinker.function = T_StrobeFlash;
-          P_AddThinker (&strobe->thinker);
+          strobe_t *strobe = P_AllocThinker(TZ_LIGHT);
+          P_LoadLegacySpecial(&strobe->thinker, sizeof *strobe, T_StrobeFlash, FALSE);
+          strobe->sector = P_LegacySector(strobe->sector);
           break;
         }
 
       case tc_glow:
         PADSAVEP();
         {
-          glow_t *glow = Z_Malloc (sizeof(*glow), PU_LEVEL, NULL);
-          memcpy (glow, save_p, sizeof(*glow));
-          save_p += sizeof(*glow);
-          glow->sector = &sectors[(uintptr_t)glow->sector];
-          glow->thinker.function = T_Glow;
-          P_AddThinker (&glow->thinker);
+          glow_t *glow = P_AllocThinker(TZ_LIGHT);
+          P_LoadLegacySpecial(&glow->thinker, sizeof *glow, T_Glow, FALSE);
+          glow->sector = P_LegacySector(glow->sector);
           break;
         }
 
       case tc_flicker:           // killough 10/4/98
         PADSAVEP();
         {
-          fireflicker_t *flicker = Z_Malloc (sizeof(*flicker), PU_LEVEL, NULL);
-          memcpy (flicker, save_p, sizeof(*flicker));
-          save_p += sizeof(*flicker);
-          flicker->sector = &sectors[(uintptr_t)flicker->sector];
-          flicker->thinker.function = T_FireFlicker;
-          P_AddThinker (&flicker->thinker);
+          fireflicker_t *flicker = P_AllocThinker(TZ_LIGHT);
+          P_LoadLegacySpecial(&flicker->thinker, sizeof *flicker, T_FireFlicker, FALSE);
+          flicker->sector = P_LegacySector(flicker->sector);
           break;
         }
 
@@ -940,96 +1787,53 @@ void P_UnArchiveSpecials (void)
       case tc_elevator:
         PADSAVEP();
         {
-          elevator_t *elevator = Z_Malloc (sizeof(*elevator), PU_LEVEL, NULL);
-          memcpy (elevator, save_p, sizeof(*elevator));
-          save_p += sizeof(*elevator);
-          elevator->sector = &sectors[(uintptr_t)elevator->sector];
+          elevator_t *elevator = P_AllocThinker(TZ_ELEVATOR);
+          P_LoadLegacySpecial(&elevator->thinker, sizeof *elevator, T_MoveElevator, FALSE);
+          elevator->sector = P_LegacySector(elevator->sector);
           elevator->sector->floordata = elevator; //jff 2/22/98
           elevator->sector->ceilingdata = elevator; //jff 2/22/98
-          elevator->thinker.function = T_MoveElevator;
-          P_AddThinker (&elevator->thinker);
           break;
         }
 
       case tc_scroll:       // killough 3/7/98: scroll effect thinkers
         {
           scroll_t *scroll = Z_Malloc (sizeof(scroll_t), PU_LEVEL, NULL);
-          memcpy (scroll, save_p, sizeof(scroll_t));
-          save_p += sizeof(scroll_t);
-          scroll->thinker.function = T_Scroll;
-          P_AddThinker(&scroll->thinker);
+          P_LoadLegacySpecial(&scroll->thinker, sizeof *scroll, T_Scroll, FALSE);
           break;
         }
 
       case tc_pusher:   // phares 3/22/98: new Push/Pull effect thinkers
         {
           pusher_t *pusher = Z_Malloc (sizeof(pusher_t), PU_LEVEL, NULL);
-          memcpy (pusher, save_p, sizeof(pusher_t));
-          save_p += sizeof(pusher_t);
-          pusher->thinker.function = T_Pusher;
+          P_LoadLegacySpecial(&pusher->thinker, sizeof *pusher, T_Pusher, FALSE);
           pusher->source = P_GetPushThing(pusher->affectee);
-          P_AddThinker(&pusher->thinker);
           break;
         }
 
       default:
         I_Error("P_UnarchiveSpecials: Unknown tclass %i in savegame", tclass);
+        return;
       }
 }
 
-// killough 2/16/98: save/restore random number generator state information
-
-void P_ArchiveRNG(void)
+void P_UnArchiveLegacyGame(void)
 {
-  CheckSaveGame(sizeof rng);
-  memcpy(save_p, &rng, sizeof rng);
-  save_p += sizeof rng;
-}
+  int unused;
 
-void P_UnArchiveRNG(void)
-{
+  P_UnArchiveLegacyPlayers();
+  P_UnArchiveLegacyWorld();
+  legacyload = TRUE;
+  P_UnArchiveThinkers();
+  legacyload = FALSE;
+  P_UnArchiveLegacySpecials();
+
+  // killough 1/18/98: RNG
   memcpy(&rng, save_p, sizeof rng);
   save_p += sizeof rng;
-}
-
-// killough 2/22/98: Save/restore automap state
-// killough 2/22/98: Save/restore automap state
-void P_ArchiveMap(void)
-{
-  int zero = 0, one = 1;
-  CheckSaveGame(2 * sizeof zero + sizeof markpointnum +
-                markpointnum * sizeof *markpoints +
-                sizeof automapmode + sizeof one);
-
-  memcpy(save_p, &automapmode, sizeof automapmode);
-  save_p += sizeof automapmode;
-  memcpy(save_p, &one, sizeof one);   // CPhipps - used to be viewactive, now
-  save_p += sizeof one;               // that's worked out locally by D_Display
-  memcpy(save_p, &zero, sizeof zero); // CPhipps - used to be followplayer
-  save_p += sizeof zero;              //  that is now part of automapmode
-  memcpy(save_p, &zero, sizeof zero); // CPhipps - used to be automap_grid, ditto
-  save_p += sizeof zero;
-  memcpy(save_p, &markpointnum, sizeof markpointnum);
-  save_p += sizeof markpointnum;
 
-  if (markpointnum)
-    {
-      memcpy(save_p, markpoints, sizeof *markpoints * markpointnum);
-      save_p += markpointnum * sizeof *markpoints;
-    }
-}
-
-void P_UnArchiveMap(void)
-{
-  int unused;
+  // killough 2/22/98: automap
   memcpy(&automapmode, save_p, sizeof automapmode);
-  save_p += sizeof automapmode;
-  memcpy(&unused, save_p, sizeof unused);
-  save_p += sizeof unused;
-  memcpy(&unused, save_p, sizeof unused);
-  save_p += sizeof unused;
-  memcpy(&unused, save_p, sizeof unused);
-  save_p += sizeof unused;
+  save_p += sizeof automapmode + 3 * sizeof unused;
 
   if (automapmode & am_active)
     AM_Start();
@@ -1047,3 +1851,26 @@ void P_UnArchiveMap(void)
     }
 }
 
+//
+// P_ArchiveSize
+// Room the P_Archive* functions above need for the current level, as
+// they ask CheckSaveGame for it.
+//
+
+size_t P_ArchiveSize(void)
+{
+  thinker_t *th;
+  size_t    mobjs = 0;
+
+  for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    if (th->function == P_MobjThinker)
+      mobjs++;
+
+  return P_FieldsSize(playerfields) * MAXPLAYERS +
+    P_WorldSize() +
+    2*4 + mobjs*(1+P_FieldsSize(mobjfields)) + 1 +
+    numsectors * 4 +
+    P_SpecialsSize() +
+    NUMPRCLASS*8 + 2*4 +
+    5*4 + markpointnum*2*4;
+}
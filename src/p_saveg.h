@@ -34,6 +34,8 @@
 #ifndef __P_SAVEG__
 #define __P_SAVEG__
 
+#include "r_defs.h"
+
 /* Persistent storage/archiving.
  * These are the load / save game routines. */
 void P_ArchivePlayers(void);
@@ -55,7 +57,23 @@ void P_UnArchiveRNG(void);
 void P_ArchiveMap(void);
 void P_UnArchiveMap(void);
 
+/* All of the above from a 210-212 savegame, laid out as memory was */
+void P_UnArchiveLegacyGame(void);
+
+/* Upper bound on what the above write for the current level */
+size_t P_ArchiveSize(void);
+
+/* Changes to what P_ArchiveWorld saves, see there */
+void P_MarkSectorDirty(const sector_t *sec);
+void P_MarkLineDirty(const line_t *line);
+void P_MarkSideDirty(const side_t *side);
+void P_MarkLineMapped(const line_t *line);
+void P_ResetWorldImage(void);
+
 extern uint8_t *save_p;
+/* Fixed-width little-endian values at save_p, see p_saveg.c */
+void P_SaveValue(int64_t v, int width);
+int64_t P_LoadValue(int width);
 void CheckSaveGame(size_t,const char*, int);              /* killough */
 #define CheckSaveGame(a) (CheckSaveGame)(a, __FILE__, __LINE__)
 
@@ -32,6 +32,8 @@
  *
  *-----------------------------------------------------------------------------*/
 
+#include <math.h>
+
 #include "config.h"
 #include "doomstat.h"
 #include "m_bbox.h"
@@ -40,18 +42,27 @@
 #include "w_wad.h"
 #include "r_main.h"
 #include "r_things.h"
+#include "r_segs.h"
 #include "p_maputl.h"
 #include "p_map.h"
 #include "p_setup.h"
 #include "p_spec.h"
 #include "p_tick.h"
 #include "p_enemy.h"
+#include "p_saveg.h"
 #include "s_sound.h"
 #include "lprintf.h" //jff 10/6/98 for debug outputs
 #include "v_video.h"
 #include "r_demo.h"
 #include "r_fps.h"
+#include "r_pvs.h"
+#include "r_arena.h"
 #include "u_musinfo.h"
+#include "md5.h"
+#include "r_data.h"
+#include "d_bench.h"
+#include "d_net.h"
+#include "i_thread.h"
 
 //
 // MAP related Lookup tables.
@@ -320,10 +331,19 @@ long      *blockmap;              // was short -- killough
 
 // offsets in blockmap are from here
 long      *blockmaplump;          // was short -- killough
+static long blockmapcount;        // entries in blockmaplump
 
 fixed_t   bmaporgx, bmaporgy;     // origin of block map
 
-mobj_t    **blocklinks;           // for thing chains
+blockthings_t *blockthings;       // for thing chains
+int (*targetgrid)[2];
+int targetgridwidth, targetgridheight;
+
+// Blockmap lists packed cell by cell, with each line's bounding box kept
+// next to its number so that box tests don't have to touch the line_t
+int       *blockcells;
+int       *blocklines;
+fixed_t   (*blocklinebox)[4];
 
 //
 // REJECT
@@ -346,6 +366,70 @@ size_t     num_deathmatchstarts;   // killough
 mapthing_t *deathmatch_p;
 mapthing_t playerstarts[MAXPLAYERS];
 
+//
+// Map lumps in native byte order
+//
+// The things, linedefs, sidedefs and sectors are loaded afresh every
+// time a level is, since play changes what is built from them. On a big
+// endian build each of these lumps is swapped once into a copy that is
+// kept with the level's entry in the level cache (see below), so the
+// P_Load functions read their fields as they are. Little endian builds
+// read the lumps themselves.
+//
+
+enum { NATIVE_THINGS, NATIVE_LINEDEFS, NATIVE_SIDEDEFS, NATIVE_SECTORS,
+       NUMNATIVELUMPS };
+
+#ifdef MSB_FIRST
+
+// Record size, and which of its 16-bit words are numbers to swap
+static const struct { size_t size; uint32_t swap; } nativelayout[NUMNATIVELUMPS] = {
+  { sizeof(mapthing_t),   0x1f },                  // x y angle type options
+  { sizeof(maplinedef_t), 0x7f },                  // all numbers
+  { sizeof(mapsidedef_t), 1<<0 | 1<<1 | 1<<14 },   // offsets and sector
+  { sizeof(mapsector_t),  1<<0 | 1<<1 | 7<<10 },   // heights, light, special, tag
+};
+
+// The copies of the level being loaded: its level cache entry's, or
+// those waiting for P_StoreLevelCache to take them
+static void *pendingnative[NUMNATIVELUMPS];
+static void **loadnative = pendingnative;
+
+static const void *P_MapLump(int lump, int kind)
+{
+  if (!loadnative[kind])
+    {
+      size_t size = nativelayout[kind].size;
+      int len = W_LumpLength(lump), n = len / size, i, j;
+      uint8_t *copy = malloc(len ? len : 1);
+
+      if (len)
+        {
+          memcpy(copy, W_CacheLumpNum(lump), len);
+          W_UnlockLumpNum(lump);
+        }
+      for (i = 0; i < n; i++)
+        {
+          uint16_t *w = (uint16_t *)(copy + i * size);
+
+          for (j = 0; j < (int)size / 2; j++)
+            if (nativelayout[kind].swap & (1u << j))
+              w[j] = SHORT(w[j]);
+        }
+      loadnative[kind] = copy;
+    }
+  return loadnative[kind];
+}
+
+#define P_ReleaseMapLump(lump)
+
+#else
+
+#define P_MapLump(lump, kind)  W_CacheLumpNum(lump)
+#define P_ReleaseMapLump(lump) W_UnlockLumpNum(lump)
+
+#endif
+
 /*
 =================
 =
@@ -649,7 +733,7 @@ static void P_LoadSectors (int lump)
 
   numsectors = W_LumpLength (lump) / sizeof(mapsector_t);
   sectors = Z_Calloc (numsectors,sizeof(sector_t),PU_LEVEL,0);
-  data = W_CacheLumpNum (lump); // cph - wad lump handling updated
+  data = P_MapLump (lump, NATIVE_SECTORS); // cph - wad lump handling updated
 
   for (i=0; i<numsectors; i++)
     {
@@ -659,14 +743,14 @@ static void P_LoadSectors (int lump)
       // [kb] for R_FixWiggle()
 		ss->cachedheight = 0;
       ss->iSectorID=i; // proff 04/05/2000: needed for OpenGL
-      ss->floorheight = SHORT(ms->floorheight)<<FRACBITS;
-      ss->ceilingheight = SHORT(ms->ceilingheight)<<FRACBITS;
+      ss->floorheight = ms->floorheight<<FRACBITS;
+      ss->ceilingheight = ms->ceilingheight<<FRACBITS;
       ss->floorpic = R_FlatNumForName(ms->floorpic);
       ss->ceilingpic = R_FlatNumForName(ms->ceilingpic);
-      ss->lightlevel = SHORT(ms->lightlevel);
-      ss->special = SHORT(ms->special);
-      ss->oldspecial = SHORT(ms->special);
-      ss->tag = SHORT(ms->tag);
+      ss->lightlevel = ms->lightlevel;
+      ss->special = ms->special;
+      ss->oldspecial = ms->special;
+      ss->tag = ms->tag;
       ss->thinglist = NULL;
       ss->touching_thinglist = NULL;            // phares 3/14/98
 
@@ -692,7 +776,7 @@ static void P_LoadSectors (int lump)
       ss->sky = 0;
     }
 
-  W_UnlockLumpNum(lump); // cph - release the data
+  P_ReleaseMapLump(lump); // cph - release the data
 }
 
 /*
@@ -881,7 +965,7 @@ static void P_LoadXNOD(int lump)
 static void P_LoadThings (int lump)
 {
   int  i, numthings = W_LumpLength (lump) / sizeof(mapthing_t);
-  const mapthing_t *data = W_CacheLumpNum (lump);
+  const mapthing_t *data = P_MapLump (lump, NATIVE_THINGS);
 
   if ((!data) || (!numthings))
     I_Error("P_LoadThings: no things in level");
@@ -890,12 +974,6 @@ static void P_LoadThings (int lump)
     {
       mapthing_t mt = data[i];
 
-      mt.x = SHORT(mt.x);
-      mt.y = SHORT(mt.y);
-      mt.angle = SHORT(mt.angle);
-      mt.type = SHORT(mt.type);
-      mt.options = SHORT(mt.options);
-
       if (!P_IsDoomnumAllowed(mt.type))
         continue;
 
@@ -903,7 +981,7 @@ static void P_LoadThings (int lump)
       P_SpawnMapThing(&mt);
     }
 
-  W_UnlockLumpNum(lump); // cph - release the data
+  P_ReleaseMapLump(lump); // cph - release the data
 }
 
 /*
@@ -921,7 +999,7 @@ static void P_LoadLineDefs (int lump)
 
   numlines = W_LumpLength (lump) / sizeof(maplinedef_t);
   lines = Z_Calloc (numlines,sizeof(line_t),PU_LEVEL,0);
-  data = W_CacheLumpNum (lump); // cph - wad lump handling updated
+  data = P_MapLump (lump, NATIVE_LINEDEFS); // cph - wad lump handling updated
 
   for (i=0; i<numlines; i++)
     {
@@ -929,11 +1007,11 @@ static void P_LoadLineDefs (int lump)
       line_t *ld = lines+i;
       vertex_t *v1, *v2;
 
-      ld->flags = (unsigned short)SHORT(mld->flags);
-      ld->special = SHORT(mld->special);
-      ld->tag = SHORT(mld->tag);
-      v1 = ld->v1 = &vertexes[(unsigned short)SHORT(mld->v1)];
-      v2 = ld->v2 = &vertexes[(unsigned short)SHORT(mld->v2)];
+      ld->flags = (unsigned short)mld->flags;
+      ld->special = mld->special;
+      ld->tag = mld->tag;
+      v1 = ld->v1 = &vertexes[(unsigned short)mld->v1];
+      v2 = ld->v2 = &vertexes[(unsigned short)mld->v2];
       ld->dx = v2->x - v1->x;
       ld->dy = v2->y - v1->y;
 
@@ -968,8 +1046,8 @@ static void P_LoadLineDefs (int lump)
       ld->soundorg.y = ld->bbox[BOXTOP] / 2 + ld->bbox[BOXBOTTOM] / 2;
 
       ld->iLineID=i; // proff 04/05/2000: needed for OpenGL
-      ld->sidenum[0] = SHORT(mld->sidenum[0]);
-      ld->sidenum[1] = SHORT(mld->sidenum[1]);
+      ld->sidenum[0] = mld->sidenum[0];
+      ld->sidenum[1] = mld->sidenum[1];
 
       { 
         /* cph 2006/09/30 - fix sidedef errors right away.
@@ -1008,7 +1086,7 @@ static void P_LoadLineDefs (int lump)
         sides[*ld->sidenum].special = ld->special;
     }
 
-  W_UnlockLumpNum(lump); // cph - release the lump
+  P_ReleaseMapLump(lump); // cph - release the lump
 }
 
 // killough 4/4/98: delay using sidedefs until they are loaded
@@ -1042,7 +1120,7 @@ static void P_LoadSideDefs (int lump)
 
 static void P_LoadSideDefs2(int lump)
 {
-  const uint8_t *data = W_CacheLumpNum(lump); // cph - const*, wad lump handling updated
+  const uint8_t *data = P_MapLump(lump, NATIVE_SIDEDEFS); // cph - const*, wad lump handling updated
   int  i;
 
   for (i=0; i<numsides; i++)
@@ -1051,11 +1129,11 @@ static void P_LoadSideDefs2(int lump)
       register side_t *sd = sides + i;
       register sector_t *sec;
 
-      sd->textureoffset = SHORT(msd->textureoffset)<<FRACBITS;
-      sd->rowoffset = SHORT(msd->rowoffset)<<FRACBITS;
+      sd->textureoffset = msd->textureoffset<<FRACBITS;
+      sd->rowoffset = msd->rowoffset<<FRACBITS;
 
       { /* cph 2006/09/30 - catch out-of-range sector numbers; use sector 0 instead */
-        unsigned short sector_num = SHORT(msd->sector);
+        unsigned short sector_num = msd->sector;
         if (sector_num >= numsectors) {
           lprintf(LO_WARN,"P_LoadSideDefs2: sidedef %i has out-of-range sector num %u\n", i, sector_num);
           sector_num = 0;
@@ -1091,7 +1169,7 @@ static void P_LoadSideDefs2(int lump)
         }
     }
 
-  W_UnlockLumpNum(lump); // cph - release the lump
+  P_ReleaseMapLump(lump); // cph - release the lump
 }
 
 //
@@ -1106,37 +1184,34 @@ static void P_LoadSideDefs2(int lump)
                                  // jff 10/8/98 use guardband>0
                                  // jff 10/12/98 0 ok with + 1 in rows,cols
 
-typedef struct linelist_t        // type used to list lines in each block
+typedef struct                   // state while rasterizing the lines
 {
-  long num;
-  struct linelist_t *next;
-} linelist_t;
+  struct { int block, line; } *pairs; // each block each line touches
+  int numpairs, maxpairs;
+  int *count;                    // length of each block's list
+  int *done;                     // 1 + the last line added to each block
+} blockbuild_t;
 
 //
 // Subroutine to add a line number to a block list
 // It simply returns if the line is already in the block
 //
 
-static void AddBlockLine
-(
-  linelist_t **lists,
-  int *count,
-  int *done,
-  int blockno,
-  long lineno
-)
+static void AddBlockLine(blockbuild_t *bb, int blockno, int lineno)
 {
-  linelist_t *l;
-
-  if (done[blockno])
+  if (bb->done[blockno] == lineno+1)
     return;
 
-  l = malloc(sizeof(linelist_t));
-  l->num = lineno;
-  l->next = lists[blockno];
-  lists[blockno] = l;
-  count[blockno]++;
-  done[blockno] = 1;
+  if (bb->numpairs == bb->maxpairs)
+  {
+    bb->maxpairs = bb->maxpairs ? bb->maxpairs*2 : 1024;
+    bb->pairs = realloc(bb->pairs, bb->maxpairs*sizeof(*bb->pairs));
+  }
+  bb->pairs[bb->numpairs].block = blockno;
+  bb->pairs[bb->numpairs].line = lineno;
+  bb->numpairs++;
+  bb->count[blockno]++;
+  bb->done[blockno] = lineno+1;
 }
 
 //
@@ -1146,14 +1221,18 @@ static void AddBlockLine
 // row lines at the left and bottom of each blockmap cell. It then
 // adds the line to all block lists touching the intersection.
 //
+// Each block's list is a 0, the lines touching it from the highest
+// numbered down, and a -1. The lines are rasterized once into (block,
+// line) pairs, counting each block's lines, so the lists can be laid
+// out by a running sum of the counts and filled in a single pass.
+//
 
 static void P_CreateBlockMap(void)
 {
   int xorg,yorg;                 // blockmap origin (lower left)
   int nrows,ncols;               // blockmap dimensions
-  linelist_t **blocklists=NULL;  // array of pointers to lists of lines
-  int *blockcount=NULL;          // array of counters of line lists
-  int *blockdone=NULL;           // array keeping track of blocks/line
+  blockbuild_t bb;               // the blocks each line touches
+  long *fill;                    // where each block's list is up to
   int NBlocks;                   // number of cells = nrows*ncols
   long linetotal=0;              // total length of all blocklists
   int i,j;
@@ -1190,25 +1269,14 @@ static void P_CreateBlockMap(void)
   nrows = (map_maxy+blkmargin-yorg+1+blkmask)>>blkshift;  //+1 needed for
   NBlocks = ncols*nrows;                                  //map exactly 1 cell
 
-  // create the array of pointers on NBlocks to blocklists
-  // also create an array of linelist counts on NBlocks
-  // finally make an array in which we can mark blocks done per line
-
-  // CPhipps - calloc's
-  blocklists = calloc(NBlocks,sizeof(linelist_t *));
-  blockcount = calloc(NBlocks,sizeof(int));
-  blockdone = malloc(NBlocks*sizeof(int));
-
-  // initialize each blocklist, and enter the trailing -1 in all blocklists
-  // note the linked list of lines grows backwards
+  // count the 0 and the trailing -1 in every block's list
 
+  bb.pairs = NULL;
+  bb.numpairs = bb.maxpairs = 0;
+  bb.count = malloc(NBlocks*sizeof(int));
+  bb.done = calloc(NBlocks,sizeof(int));
   for (i=0;i<NBlocks;i++)
-  {
-    blocklists[i] = malloc(sizeof(linelist_t));
-    blocklists[i]->num = -1;
-    blocklists[i]->next = NULL;
-    blockcount[i]++;
-  }
+    bb.count[i] = 2;
 
   // For each linedef in the wad, determine all blockmap blocks it touches,
   // and add the linedef number to the blocklists for those blocks
@@ -1231,18 +1299,14 @@ static void P_CreateBlockMap(void)
     int miny = y1>y2? y2 : y1;
     int maxy = y1>y2? y1 : y2;
 
-    // no blocks done for this linedef yet
-
-    memset(blockdone,0,NBlocks*sizeof(int));
-
     // The line always belongs to the blocks containing its endpoints
 
     bx = (x1-xorg)>>blkshift;
     by = (y1-yorg)>>blkshift;
-    AddBlockLine(blocklists,blockcount,blockdone,by*ncols+bx,i);
+    AddBlockLine(&bb,by*ncols+bx,i);
     bx = (x2-xorg)>>blkshift;
     by = (y2-yorg)>>blkshift;
-    AddBlockLine(blocklists,blockcount,blockdone,by*ncols+bx,i);
+    AddBlockLine(&bb,by*ncols+bx,i);
 
 
     // For each column, see where the line along its left edge, which
@@ -1251,7 +1315,12 @@ static void P_CreateBlockMap(void)
 
     if (!vert)    // don't interesect vertical lines with columns
     {
-      for (j=0;j<ncols;j++)
+      // only the columns from minx to maxx can touch the line
+      int jmax = (maxx-xorg)>>blkshift;
+
+      if (jmax>ncols-1)
+        jmax = ncols-1;
+      for (j=(minx-xorg+blkmask)>>blkshift;j<=jmax;j++)
       {
         // intersection of Linedef with x=xorg+(j<<blkshift)
         // (y-y1)*dx = dy*(x-x1)
@@ -1270,7 +1339,7 @@ static void P_CreateBlockMap(void)
 
         // The cell that contains the intersection point is always added
 
-        AddBlockLine(blocklists,blockcount,blockdone,ncols*yb+j,i);
+        AddBlockLine(&bb,ncols*yb+j,i);
 
         // if the intersection is at a corner it depends on the slope
         // (and whether the line extends past the intersection) which
@@ -1281,23 +1350,23 @@ static void P_CreateBlockMap(void)
           if (sneg)       //   \ - blocks x,y-, x-,y
           {
             if (yb>0 && miny<y)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(yb-1)+j,i);
+              AddBlockLine(&bb,ncols*(yb-1)+j,i);
             if (j>0 && minx<x)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*yb+j-1,i);
+              AddBlockLine(&bb,ncols*yb+j-1,i);
           }
           else if (spos)  //   / - block x-,y-
           {
             if (yb>0 && j>0 && minx<x)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(yb-1)+j-1,i);
+              AddBlockLine(&bb,ncols*(yb-1)+j-1,i);
           }
           else if (horiz) //   - - block x-,y
           {
             if (j>0 && minx<x)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*yb+j-1,i);
+              AddBlockLine(&bb,ncols*yb+j-1,i);
           }
         }
         else if (j>0 && minx<x) // else not at corner: x-,y
-          AddBlockLine(blocklists,blockcount,blockdone,ncols*yb+j-1,i);
+          AddBlockLine(&bb,ncols*yb+j-1,i);
       }
     }
 
@@ -1307,7 +1376,12 @@ static void P_CreateBlockMap(void)
 
     if (!horiz)
     {
-      for (j=0;j<nrows;j++)
+      // only the rows from miny to maxy can touch the line
+      int jmax = (maxy-yorg)>>blkshift;
+
+      if (jmax>nrows-1)
+        jmax = nrows-1;
+      for (j=(miny-yorg+blkmask)>>blkshift;j<=jmax;j++)
       {
         // intersection of Linedef with y=yorg+(j<<blkshift)
         // (x,y) on Linedef i satisfies: (y-y1)*dx = dy*(x-x1)
@@ -1326,7 +1400,7 @@ static void P_CreateBlockMap(void)
 
         // The cell that contains the intersection point is always added
 
-        AddBlockLine(blocklists,blockcount,blockdone,ncols*j+xb,i);
+        AddBlockLine(&bb,ncols*j+xb,i);
 
         // if the intersection is at a corner it depends on the slope
         // (and whether the line extends past the intersection) which
@@ -1337,40 +1411,36 @@ static void P_CreateBlockMap(void)
           if (sneg)       //   \ - blocks x,y-, x-,y
           {
             if (j>0 && miny<y)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(j-1)+xb,i);
+              AddBlockLine(&bb,ncols*(j-1)+xb,i);
             if (xb>0 && minx<x)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*j+xb-1,i);
+              AddBlockLine(&bb,ncols*j+xb-1,i);
           }
           else if (vert)  //   | - block x,y-
           {
             if (j>0 && miny<y)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(j-1)+xb,i);
+              AddBlockLine(&bb,ncols*(j-1)+xb,i);
           }
           else if (spos)  //   / - block x-,y-
           {
             if (xb>0 && j>0 && miny<y)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(j-1)+xb-1,i);
+              AddBlockLine(&bb,ncols*(j-1)+xb-1,i);
           }
         }
         else if (j>0 && miny<y) // else not on a corner: x,y-
-          AddBlockLine(blocklists,blockcount,blockdone,ncols*(j-1)+xb,i);
+          AddBlockLine(&bb,ncols*(j-1)+xb,i);
       }
     }
   }
 
-  // Add initial 0 to all blocklists
   // count the total number of lines (and 0's and -1's)
 
-  memset(blockdone,0,NBlocks*sizeof(int));
   for (i=0,linetotal=0;i<NBlocks;i++)
-  {
-    AddBlockLine(blocklists,blockcount,blockdone,i,0);
-    linetotal += blockcount[i];
-  }
+    linetotal += bb.count[i];
 
   // Create the blockmap lump
 
-  blockmaplump = Z_Malloc(sizeof(*blockmaplump) * (4+NBlocks+linetotal),
+  blockmapcount = 4+NBlocks+linetotal;
+  blockmaplump = Z_Malloc(sizeof(*blockmaplump) * blockmapcount,
                           PU_LEVEL, 0);
   // blockmap header
 
@@ -1379,36 +1449,106 @@ static void P_CreateBlockMap(void)
   blockmaplump[2] = bmapwidth  = ncols;
   blockmaplump[3] = bmapheight = nrows;
 
-  // offsets to lists and block lists
+  // offsets to lists, and the ends of each list
 
+  fill = malloc(NBlocks*sizeof(*fill));
   for (i=0;i<NBlocks;i++)
   {
-    linelist_t *bl = blocklists[i];
     long offs = blockmaplump[4+i] =   // set offset to block's list
-      (i? blockmaplump[4+i-1] : 4+NBlocks) + (i? blockcount[i-1] : 0);
-
-    // add the lines in each block's list to the blockmaplump
-    // delete each list node as we go
+      (i? blockmaplump[4+i-1] : 4+NBlocks) + (i? bb.count[i-1] : 0);
 
-    while (bl)
-    {
-      linelist_t *tmp = bl->next;
-      blockmaplump[offs++] = bl->num;
-      free(bl);
-      bl = tmp;
-    }
+    blockmaplump[offs] = 0;
+    blockmaplump[offs+bb.count[i]-1] = -1;
+    fill[i] = offs+1;
   }
 
+  // add the lines in between, highest numbered first
+
+  for (i=bb.numpairs-1;i>=0;i--)
+    blockmaplump[fill[bb.pairs[i].block]++] = bb.pairs[i].line;
+
   // free all temporary storage
 
-  free (blocklists);
-  free (blockcount);
-  free (blockdone);
+  free (bb.pairs);
+  free (bb.count);
+  free (bb.done);
+  free (fill);
 }
 
 // jff 10/6/98
 // End new code added to speed up calculation of internal blockmap
 
+//
+// P_PackBlockMap
+//
+// Copies each cell's list out of blockmaplump into blocklines, cells
+// back to back, with the lines' bounding boxes alongside in
+// blocklinebox. A cell's first entry is kept even though only
+// demo_compatibility visits it, and the list runs on to the first -1
+// after it, so the packed lists step through exactly the lines that
+// walking blockmaplump does. Entries that aren't lines get an empty box.
+//
+
+static void P_PackBlockMap(void)
+{
+  int ncells = bmapwidth*bmapheight;
+  int i, total = 0;
+
+  for (i = 0; i < ncells; i++)
+    {
+      const long *list = blockmaplump + blockmap[i] + 1;
+
+      while (*list++ != -1)
+        total++;
+      total++;              // the first entry
+    }
+
+  blockcells = Z_Malloc((ncells + 1) * sizeof(*blockcells), PU_LEVEL, 0);
+  blocklines = Z_Malloc(total * sizeof(*blocklines), PU_LEVEL, 0);
+  blocklinebox = Z_Malloc(total * sizeof(*blocklinebox), PU_LEVEL, 0);
+
+  for (total = i = 0; i < ncells; i++)
+    {
+      const long *list = blockmaplump + blockmap[i];
+
+      blockcells[i] = total;
+      do
+        {
+          fixed_t *box = blocklinebox[total];
+
+          blocklines[total] = *list;
+          if (*list >= 0 && *list < numlines)
+            memcpy(box, lines[*list].bbox, sizeof(blocklinebox[0]));
+          else
+            {
+              box[BOXLEFT] = box[BOXBOTTOM] = INT_MAX;
+              box[BOXRIGHT] = box[BOXTOP] = INT_MIN;
+            }
+          total++;
+        }
+      while (*++list != -1);
+    }
+  blockcells[i] = total;
+}
+
+//
+// P_InitBlockMap
+// Sets up the per-cell tables that go with blockmaplump, however it
+// was obtained.
+//
+
+static void P_InitBlockMap(void)
+{
+  // clear out mobj chains - CPhipps - use calloc
+  blockthings = Z_Calloc ((size_t) bmapwidth*bmapheight, sizeof(*blockthings), PU_LEVEL, 0);
+  targetgridwidth = (bmapwidth + (1<<TARGETGRIDSHIFT) - 1) >> TARGETGRIDSHIFT;
+  targetgridheight = (bmapheight + (1<<TARGETGRIDSHIFT) - 1) >> TARGETGRIDSHIFT;
+  targetgrid = Z_Calloc((size_t) targetgridwidth*targetgridheight, sizeof(*targetgrid), PU_LEVEL, 0);
+  blockmap = blockmaplump+4;
+
+  P_PackBlockMap();
+}
+
 //
 // P_LoadBlockMap
 //
@@ -1450,15 +1590,14 @@ static void P_LoadBlockMap (int lump)
 
       W_UnlockLumpNum(lump); // cph - unlock the lump
 
+      blockmapcount = count;
       bmaporgx = blockmaplump[0]<<FRACBITS;
       bmaporgy = blockmaplump[1]<<FRACBITS;
       bmapwidth = blockmaplump[2];
       bmapheight = blockmaplump[3];
     }
 
-  // clear out mobj chains - CPhipps - use calloc
-  blocklinks = Z_Calloc ((size_t) bmapwidth*bmapheight, sizeof(*blocklinks), PU_LEVEL, 0);
-  blockmap = blockmaplump+4;
+  P_InitBlockMap();
 }
 
 //
@@ -1525,6 +1664,95 @@ static void P_LoadReject(int lumpnum, int totallines)
           length, required);
 }
 
+//
+// P_SectorsClosed
+// Whether every sector is bounded by closed loops of lines, so that a
+// line of sight can only leave one across a line. Each vertex has to
+// end an even number of the lines with the sector on just one side.
+//
+
+static dbool P_SectorsClosed(void)
+{
+  uint8_t *odd = Z_Calloc(numvertexes ? numvertexes : 1, 1, PU_STATIC, 0);
+  dbool closed = TRUE;
+  int i, j;
+
+  for (i = 0; i < numsectors && closed; i++)
+    {
+      const sector_t *sec = &sectors[i];
+
+      for (j = 0; j < sec->linecount; j++)
+        {
+          const line_t *ld = sec->lines[j];
+
+          if (ld->frontsector == ld->backsector)
+            continue;
+          odd[ld->v1 - vertexes] ^= 1;
+          odd[ld->v2 - vertexes] ^= 1;
+        }
+      for (j = 0; j < sec->linecount; j++)
+        {
+          const line_t *ld = sec->lines[j];
+
+          if (odd[ld->v1 - vertexes] || odd[ld->v2 - vertexes])
+            closed = FALSE;
+          odd[ld->v1 - vertexes] = odd[ld->v2 - vertexes] = 0;
+        }
+    }
+  Z_Free(odd);
+  return closed;
+}
+
+//
+// P_BuildReject
+// Many maps come with a REJECT of zeros, or none, which makes every
+// sight check a full trace. Fill such a table from the sector
+// visibility sets, which only ever err towards visible, so no sight
+// check that could succeed is rejected. Old demos keep the table they
+// were recorded with.
+//
+
+static void P_BuildReject(void)
+{
+  unsigned int required = (numsectors * numsectors + 7) / 8, i;
+  uint8_t *reject;
+  int64_t hidden = 0;
+
+  if (!build_reject || demo_compatibility || demoplayback || !numsectors)
+    return;
+  for (i = 0; i < required; i++)
+    if (rejectmatrix[i])
+      return;
+  if (!P_SectorsClosed())
+    {
+      lprintf(LO_INFO, "P_BuildReject: open sectors, REJECT left empty\n");
+      return;
+    }
+
+  reject = Z_Calloc(required, 1, PU_LEVEL, 0);
+  if (!R_PVSReject(reject))
+    {
+      Z_Free(reject);
+      return;
+    }
+  if (rejectlump != -1)
+    {
+      W_UnlockLumpNum(rejectlump);
+      rejectlump = -1;
+    }
+  rejectmatrix = reject;
+
+  for (i = 0; i < required; i++)
+    {
+      uint8_t b = reject[i];
+
+      for (; b; b &= b - 1)
+        hidden++;
+    }
+  lprintf(LO_INFO, "P_BuildReject: %d%% of sector pairs rejected\n",
+          (int)(hidden * 100 / ((int64_t)numsectors * numsectors)));
+}
+
 //
 // P_GroupLines
 // Builds sector line lists and subsector sector numbers.
@@ -1614,6 +1842,42 @@ static int P_GroupLines (void)
          P_AddLineToSector(li, li->backsector);
    }
 
+   // List each sector's neighbours and two-sided lines for the P_Find*
+   // functions in p_spec.c. Neither can be longer than its lines.
+   {
+      sector_t **neighborbuffer = Z_Malloc(total*sizeof(sector_t *), PU_LEVEL, 0);
+      line_t **twosidedbuffer = Z_Malloc(total*sizeof(line_t *), PU_LEVEL, 0);
+      int *listed = malloc(numsectors*sizeof(*listed)); // sector listed it last
+
+      for (i=0; i<numsectors; i++)
+         listed[i] = -1;
+
+      for (i=0, sector = sectors; i<numsectors; i++, sector++)
+      {
+         sector->neighbors = neighborbuffer;
+         sector->twosided = twosidedbuffer;
+         sector->neighborcount = sector->twosidedcount = 0;
+
+         for (j=0; j<sector->linecount; j++)
+         {
+            sector_t *other;
+
+            li = sector->lines[j];
+            if (li->sidenum[1] != NO_INDEX)
+               sector->twosided[sector->twosidedcount++] = li;
+            other = li->frontsector == sector ? li->backsector : li->frontsector;
+            if (other && other != sector && listed[other - sectors] != i)
+            {
+               listed[other - sectors] = i;
+               sector->neighbors[sector->neighborcount++] = other;
+            }
+         }
+         neighborbuffer += sector->neighborcount;
+         twosidedbuffer += sector->twosidedcount;
+      }
+      free(listed);
+   }
+
    for (i=0, sector = sectors; i<numsectors; i++, sector++)
    {
       fixed_t *bbox = (void*)sector->blockbox; // cph - For convenience, so
@@ -1739,6 +2003,417 @@ static void P_RemoveSlimeTrails(void)         // killough 10/98
   free(hit);
 }
 
+//
+// P_InitSubsectorInteriorRange
+//
+// Picks a point in each subsector and works out how big a box about it can
+// get, up to INTERIOR_MAX, before PIT_GetSectors would take a linedef as
+// crossing it: the box has to overlap the line's bounding box and straddle
+// the line through it. A thing whose box stays inside can only touch the
+// sector it stands in, which P_CreateSecNodeList uses to skip the blockmap.
+//
+
+#define INTERIOR_MAX (256*FRACUNIT)
+
+typedef struct {
+  double x, y, dist;
+} interior_t;
+
+static void P_InteriorDistance(interior_t *in, const line_t *ld)
+{
+  // how far the box edge is from the line's bounding box, if outside it
+  double bx = MAX(ld->bbox[BOXLEFT] - in->x, in->x - ld->bbox[BOXRIGHT]);
+  double by = MAX(ld->bbox[BOXBOTTOM] - in->y, in->y - ld->bbox[BOXTOP]);
+  // how big the box gets before a corner reaches the line through ld
+  double ax = ld->v1->x - in->x, ay = ld->v1->y - in->y;
+  double dx = ld->dx, dy = ld->dy;
+  double toline = fabs(dx*ay - dy*ax) / (fabs(dx) + fabs(dy));
+  double dist = MAX(MAX(bx, by), toline);
+
+  if (dist < in->dist)
+    in->dist = dist;
+}
+
+// blockmap column or row of a map coordinate held as a double
+#define INTERIOR_BLOCK(v, org) ((int)floor(((v) - (org)) / (1 << MAPBLOCKSHIFT)))
+
+// Reads the blockmap directly rather than through P_BlockLinesIterator, as
+// it may run on several threads at once and must leave validcount alone.
+// A line met in more than one block is just measured again.
+static void P_InitSubsectorInteriorRange(int first, int last)
+{
+  int i, bx, by;
+
+  for (i = first; i < last; i++)
+  {
+    subsector_t *ss = &subsectors[i];
+    double sx = 0, sy = 0;
+    interior_t in;
+    int j;
+
+    for (j = 0; j < ss->numlines; j++)
+    {
+      sx += segs[ss->firstline + j].v1->x;
+      sy += segs[ss->firstline + j].v1->y;
+    }
+    in.x = ss->numlines ? sx / ss->numlines : 0;
+    in.y = ss->numlines ? sy / ss->numlines : 0;
+    in.dist = INTERIOR_MAX;
+
+    // linedef 0 sits in every block for demo_compatibility
+    if (numlines)
+      P_InteriorDistance(&in, &lines[0]);
+    for (bx = MAX(INTERIOR_BLOCK(in.x - INTERIOR_MAX, bmaporgx), 0);
+         bx <= MIN(INTERIOR_BLOCK(in.x + INTERIOR_MAX, bmaporgx), bmapwidth-1); bx++)
+      for (by = MAX(INTERIOR_BLOCK(in.y - INTERIOR_MAX, bmaporgy), 0);
+           by <= MIN(INTERIOR_BLOCK(in.y + INTERIOR_MAX, bmaporgy), bmapheight-1); by++)
+      {
+        int cell = by*bmapwidth + bx;
+
+        for (j = blockcells[cell]; j < blockcells[cell+1]; j++)
+          if (blocklines[j] >= 0)
+            P_InteriorDistance(&in, &lines[blocklines[j]]);
+      }
+
+    ss->interiorx = (fixed_t)in.x;
+    ss->interiory = (fixed_t)in.y;
+    // two units short: one for rounding the point to fixed_t, one to stay
+    // clear of the rounding in the tests it stands for
+    ss->interior = MAX((fixed_t)in.dist - 2*FRACUNIT, 0);
+  }
+}
+
+//
+// P_StartSubsectorInteriors
+// Hands the subsectors out in ranges to threads, which run alongside
+// R_BuildPVS and P_BuildReject on the main thread; nothing between touches
+// what they read or write. P_FinishSubsectorInteriors waits for them, and
+// does any range no thread could be started for, or all of them on a
+// small level or a single CPU.
+//
+
+#define MAX_INTERIOR_TASKS 8
+#define INTERIOR_TASK_MIN  2048 // subsectors worth a thread
+
+typedef struct {
+  int first, last;
+  i_thread_t *thread;
+} interiortask_t;
+
+static interiortask_t interiortasks[MAX_INTERIOR_TASKS];
+static int numinteriortasks;
+
+static void P_InteriorTask(void *arg)
+{
+  interiortask_t *task = arg;
+
+  P_InitSubsectorInteriorRange(task->first, task->last);
+}
+
+static void P_StartSubsectorInteriors(void)
+{
+  int i, count = MIN(I_NumCPUs() - 1, numsubsectors / INTERIOR_TASK_MIN);
+
+  numinteriortasks = MAX(MIN(count, MAX_INTERIOR_TASKS), 0);
+  for (i = 0; i < numinteriortasks; i++)
+  {
+    interiortask_t *task = &interiortasks[i];
+
+    task->first = (int)((int64_t)numsubsectors * i / numinteriortasks);
+    task->last = (int)((int64_t)numsubsectors * (i+1) / numinteriortasks);
+    task->thread = I_ThreadCreate(P_InteriorTask, task);
+  }
+}
+
+static void P_FinishSubsectorInteriors(void)
+{
+  int i;
+
+  if (!numinteriortasks)
+    P_InitSubsectorInteriorRange(0, numsubsectors);
+  for (i = 0; i < numinteriortasks; i++)
+  {
+    interiortask_t *task = &interiortasks[i];
+
+    if (task->thread)
+      I_ThreadJoin(task->thread);
+    else
+      P_InitSubsectorInteriorRange(task->first, task->last);
+    task->thread = NULL;
+  }
+  numinteriortasks = 0;
+}
+
+//
+// Level cache
+//
+// The vertexes, node tree and blockmap of the last few levels loaded,
+// kept so that coming back to a level (a restart, a death in single
+// player, loading a save) skips decoding the nodes and, for levels
+// without a usable BLOCKMAP, rebuilding it, as well as removing slime
+// trails once more. Pointers into lines, sides
+// and sectors are kept as indices and fixed up against the arrays just
+// loaded, which are never cached since play changes them. Entries are
+// keyed by an MD5 of every lump they were built from, so a level whose
+// lumps differ never gets another's data.
+//
+
+#define LEVELCACHESIZE 4
+
+typedef struct
+{
+  int v1, v2, linedef, sidedef, frontsector, backsector;
+  fixed_t offset;
+  angle_t angle;
+  float length;
+  dbool miniseg;
+} cachedseg_t;
+
+typedef struct
+{
+  unsigned char md5[16];
+  unsigned stamp;                 // 0 if unused, else when last used
+  int numvertexes, firstglvertex;
+  int numsegs, numsubsectors, numnodes;
+  long blockmapcount;
+  fixed_t bmaporgx, bmaporgy;
+  int bmapwidth, bmapheight;
+  subsector_t *subsectors;        // all carved from one malloc
+  long *blockmaplump;
+  vertex_t *vertexes;
+  cachedseg_t *segs;
+  node_t *nodes;
+  vertex_t *slimevertexes;        // after P_RemoveSlimeTrails, once run
+#ifdef MSB_FIRST
+  void *native[NUMNATIVELUMPS];   // see P_MapLump
+#endif
+} levelcache_t;
+
+static levelcache_t levelcache[LEVELCACHESIZE];
+static unsigned levelcachestamp;
+
+static void P_HashLump(struct MD5Context *md5, int lump)
+{
+  int len = W_LumpLength(lump);
+
+  MD5Update(md5, (const md5byte *)&len, sizeof len);
+  if (len > 0)
+    {
+      MD5Update(md5, (const md5byte *)W_CacheLumpNum(lump), len);
+      W_UnlockLumpNum(lump);
+    }
+}
+
+// Hashes whatever the cached arrays depend on. Must follow
+// P_GetNodesVersion, which picks the nodes that get loaded.
+
+static void P_LevelCacheKey(int lumpnum, int gl_lumpnum, unsigned char *key)
+{
+  struct MD5Context md5;
+  int flags[3];
+  int i;
+
+  flags[0] = nodes_glbsp;
+  flags[1] = nodes_zdbsp;
+  flags[2] = M_CheckParm("-blockmap") != 0;
+
+  MD5Init(&md5);
+  MD5Update(&md5, (const md5byte *)flags, sizeof flags);
+  for (i = ML_THINGS; i <= ML_BLOCKMAP; i++)
+    if (i != ML_REJECT)
+      P_HashLump(&md5, lumpnum + i);
+  if (nodes_glbsp > 0)
+    for (i = ML_GL_VERTS; i <= ML_GL_NODES; i++)
+      P_HashLump(&md5, gl_lumpnum + i);
+  MD5Final(key, &md5);
+}
+
+static levelcache_t *P_FindLevelCache(const unsigned char *key)
+{
+  int i;
+
+  for (i = 0; i < LEVELCACHESIZE; i++)
+    if (levelcache[i].stamp && !memcmp(levelcache[i].md5, key, 16))
+      {
+        levelcache[i].stamp = ++levelcachestamp;
+        return &levelcache[i];
+      }
+  return NULL;
+}
+
+// Copies the level just loaded into the least recently used entry, and
+// returns it, or NULL if there was nothing to keep or no room.
+// Must run before anything moves vertexes, such as P_RemoveSlimeTrails.
+
+static levelcache_t *P_StoreLevelCache(const unsigned char *key)
+{
+  levelcache_t *lc = levelcache;
+  size_t size;
+  int i;
+
+  if (!numsegs || !numsubsectors)       // failed to load
+    return NULL;
+
+  for (i = 1; i < LEVELCACHESIZE; i++)
+    if (levelcache[i].stamp < lc->stamp)
+      lc = &levelcache[i];
+
+  free(lc->subsectors);
+  free(lc->slimevertexes);
+#ifdef MSB_FIRST
+  for (i = 0; i < NUMNATIVELUMPS; i++)
+    free(lc->native[i]);
+#endif
+  memset(lc, 0, sizeof(*lc));
+
+  size = numsubsectors * sizeof(*lc->subsectors)
+    + blockmapcount * sizeof(*lc->blockmaplump)
+    + numvertexes * sizeof(*lc->vertexes)
+    + numsegs * sizeof(*lc->segs)
+    + numnodes * sizeof(*lc->nodes);
+  if (!(lc->subsectors = malloc(size)))
+    return NULL;
+  lc->blockmaplump = (long *)(lc->subsectors + numsubsectors);
+  lc->vertexes = (vertex_t *)(lc->blockmaplump + blockmapcount);
+  lc->segs = (cachedseg_t *)(lc->vertexes + numvertexes);
+  lc->nodes = (node_t *)(lc->segs + numsegs);
+
+  memcpy(lc->md5, key, 16);
+  lc->stamp = ++levelcachestamp;
+  lc->numvertexes = numvertexes;
+  lc->firstglvertex = firstglvertex;
+  lc->numsegs = numsegs;
+  lc->numsubsectors = numsubsectors;
+  lc->numnodes = numnodes;
+  lc->blockmapcount = blockmapcount;
+  lc->bmaporgx = bmaporgx;
+  lc->bmaporgy = bmaporgy;
+  lc->bmapwidth = bmapwidth;
+  lc->bmapheight = bmapheight;
+
+  memcpy(lc->subsectors, subsectors, numsubsectors * sizeof(*subsectors));
+  memcpy(lc->blockmaplump, blockmaplump, blockmapcount * sizeof(*blockmaplump));
+  memcpy(lc->vertexes, vertexes, numvertexes * sizeof(*vertexes));
+  memcpy(lc->nodes, nodes, numnodes * sizeof(*nodes));
+
+  for (i = 0; i < numsegs; i++)
+    {
+      const seg_t *seg = segs + i;
+      cachedseg_t *cs = lc->segs + i;
+
+      cs->v1 = seg->v1 - vertexes;
+      cs->v2 = seg->v2 - vertexes;
+      cs->linedef = seg->linedef ? seg->linedef - lines : -1;
+      cs->sidedef = seg->sidedef ? seg->sidedef - sides : -1;
+      cs->frontsector = seg->frontsector ? seg->frontsector - sectors : -1;
+      cs->backsector = seg->backsector ? seg->backsector - sectors : -1;
+      cs->offset = seg->offset;
+      cs->angle = seg->angle;
+      cs->length = seg->length;
+      cs->miniseg = seg->miniseg;
+    }
+  return lc;
+}
+
+#ifdef MSB_FIRST
+
+// Points P_MapLump at lc's copies of the map lumps, handing it any built
+// for the level so far; without an entry, frees those.
+
+static void P_UseNativeLumps(levelcache_t *lc)
+{
+  int i;
+
+  for (i = 0; i < NUMNATIVELUMPS; i++)
+    {
+      if (lc && !lc->native[i])
+        lc->native[i] = pendingnative[i];
+      else
+        free(pendingnative[i]);
+      pendingnative[i] = NULL;
+    }
+  loadnative = lc ? lc->native : pendingnative;
+}
+
+#else
+
+#define P_UseNativeLumps(lc) ((void)(lc))
+
+#endif
+
+// Stands in for P_RemoveSlimeTrails once a level's entry has its result,
+// which is the same every time the level is loaded.
+
+static void P_RemoveCachedSlimeTrails(levelcache_t *lc)
+{
+  size_t size = numvertexes * sizeof(*vertexes);
+
+  if (lc && lc->slimevertexes && lc->numvertexes == numvertexes)
+    {
+      memcpy(vertexes, lc->slimevertexes, size);
+      return;
+    }
+  P_RemoveSlimeTrails();
+  if (lc && !lc->slimevertexes && lc->numvertexes == numvertexes &&
+      (lc->slimevertexes = malloc(size ? size : 1)))
+    memcpy(lc->slimevertexes, vertexes, size);
+}
+
+// Stands in for P_LoadVertexes.
+
+static void P_RestoreVertexes(const levelcache_t *lc)
+{
+  numvertexes = lc->numvertexes;
+  firstglvertex = lc->firstglvertex;
+  vertexes = Z_Malloc(numvertexes * sizeof(*vertexes), PU_LEVEL, 0);
+  memcpy(vertexes, lc->vertexes, numvertexes * sizeof(*vertexes));
+}
+
+// Stands in for P_LoadBlockMap and the loading of the nodes, once the
+// lines, sides and sectors are in.
+
+static void P_RestoreLevelCache(const levelcache_t *lc)
+{
+  int i;
+
+  blockmapcount = lc->blockmapcount;
+  blockmaplump = Z_Malloc(blockmapcount * sizeof(*blockmaplump), PU_LEVEL, 0);
+  memcpy(blockmaplump, lc->blockmaplump, blockmapcount * sizeof(*blockmaplump));
+  bmaporgx = lc->bmaporgx;
+  bmaporgy = lc->bmaporgy;
+  bmapwidth = lc->bmapwidth;
+  bmapheight = lc->bmapheight;
+  P_InitBlockMap();
+
+  numsubsectors = lc->numsubsectors;
+  subsectors = Z_Malloc(numsubsectors * sizeof(*subsectors), PU_LEVEL, 0);
+  memcpy(subsectors, lc->subsectors, numsubsectors * sizeof(*subsectors));
+
+  numnodes = lc->numnodes;
+  nodes = Z_Malloc(numnodes * sizeof(*nodes), PU_LEVEL, 0);
+  memcpy(nodes, lc->nodes, numnodes * sizeof(*nodes));
+
+  numsegs = lc->numsegs;
+  segs = Z_Malloc(numsegs * sizeof(*segs), PU_LEVEL, 0);
+  for (i = 0; i < numsegs; i++)
+    {
+      const cachedseg_t *cs = lc->segs + i;
+      seg_t *seg = segs + i;
+
+      seg->v1 = vertexes + cs->v1;
+      seg->v2 = vertexes + cs->v2;
+      seg->offset = cs->offset;
+      seg->angle = cs->angle;
+      seg->sidedef = cs->sidedef < 0 ? NULL : sides + cs->sidedef;
+      seg->linedef = cs->linedef < 0 ? NULL : lines + cs->linedef;
+      seg->iSegID = i;
+      seg->length = cs->length;
+      seg->miniseg = cs->miniseg;
+      seg->frontsector = cs->frontsector < 0 ? NULL : sectors + cs->frontsector;
+      seg->backsector = cs->backsector < 0 ? NULL : sectors + cs->backsector;
+    }
+}
+
 /*
 =================
 =
@@ -1756,7 +2431,20 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
    char  gl_lumpname[9];
    int   gl_lumpnum;
 
+   unsigned char   levelkey[16];
+   levelcache_t   *cached;
+
    R_StopAllInterpolations();
+   R_ReportVertexCache(); // for the level being left
+   R_ReportRenderArena();
+   Z_ReportCacheStats();
+   W_ReportNameCache();
+   P_ReportSightCache();
+   D_ReportCatchUp();
+   P_ReportSpechit();
+   P_ReportIntercepts();
+   P_ReportSoundCache();
+   P_ClearTraceCache();
 
    totallive = totalkills = totalitems = totalsecret = wminfo.maxfrags = 0;
    wminfo.partime = 180;
@@ -1770,7 +2458,12 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
    // Make sure all sounds are stopped before Z_FreeTags.
    S_Start();
 
+   W_StopPrefetch(); // whatever it didn't reach is read as it's needed
+
    Z_FreeTags(PU_LEVEL, PU_PURGELEVEL-1);
+   Z_ReportZoneStats(); // what the level left behind, and what it peaked at
+   P_ClearThinkerZones();
+   P_ResetWorldImage(); // its PU_LEVEL block went with the tags above
    if (rejectlump != -1) { // cph - unlock the reject table
       W_UnlockLumpNum(rejectlump);
       rejectlump = -1;
@@ -1811,8 +2504,13 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
 
    // figgi 10/19/00 -- check for gl lumps and load them
    P_GetNodesVersion(lumpnum,gl_lumpnum);
+   P_LevelCacheKey(lumpnum, gl_lumpnum, levelkey);
+   cached = P_FindLevelCache(levelkey);
+   P_UseNativeLumps(cached);
 
-   if (nodes_glbsp > 0)
+   if (cached)
+      P_RestoreVertexes(cached);
+   else if (nodes_glbsp > 0)
       P_LoadVertexes2 (lumpnum+ML_VERTEXES,gl_lumpnum+ML_GL_VERTS);
    else
       P_LoadVertexes  (lumpnum+ML_VERTEXES);
@@ -1821,34 +2519,55 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
    P_LoadLineDefs  (lumpnum+ML_LINEDEFS);
    P_LoadSideDefs2 (lumpnum+ML_SIDEDEFS);
    P_LoadLineDefs2 (lumpnum+ML_LINEDEFS);
-   P_LoadBlockMap  (lumpnum+ML_BLOCKMAP);
 
-   if (nodes_glbsp > 0)
-   {
-      P_LoadSubsectors(gl_lumpnum + ML_GL_SSECT);
-      P_LoadNodes(gl_lumpnum + ML_GL_NODES);
-      P_LoadGLSegs(gl_lumpnum + ML_GL_SEGS);
-   }
-   else if (nodes_zdbsp == 1)
-   {
-      P_LoadXNOD(lumpnum + ML_NODES);
-   }
+   // sized for the level, so neither grows in the middle of a tic
+   P_InitSpechit();
+   P_InitIntercepts(numlines + W_LumpLength(lumpnum+ML_THINGS) / sizeof(mapthing_t));
+
+   if (cached)
+      P_RestoreLevelCache(cached);
    else
    {
-      P_LoadSubsectors(lumpnum + ML_SSECTORS);
-      P_LoadNodes(lumpnum + ML_NODES);
-      P_LoadSegs(lumpnum + ML_SEGS);
+      P_LoadBlockMap  (lumpnum+ML_BLOCKMAP);
+
+      if (nodes_glbsp > 0)
+      {
+         P_LoadSubsectors(gl_lumpnum + ML_GL_SSECT);
+         P_LoadNodes(gl_lumpnum + ML_GL_NODES);
+         P_LoadGLSegs(gl_lumpnum + ML_GL_SEGS);
+      }
+      else if (nodes_zdbsp == 1)
+      {
+         P_LoadXNOD(lumpnum + ML_NODES);
+      }
+      else
+      {
+         P_LoadSubsectors(lumpnum + ML_SSECTORS);
+         P_LoadNodes(lumpnum + ML_NODES);
+         P_LoadSegs(lumpnum + ML_SEGS);
+      }
+
+      cached = P_StoreLevelCache(levelkey);
+      P_UseNativeLumps(cached);
    }
+   R_BuildSubsectorGrid();
 
    // reject loading and underflow padding separated out into new function
    // P_GroupLines modified to return a number the underflow padding needs
    P_LoadReject(lumpnum, P_GroupLines());
+   P_ResetSoundCache();
+   P_ResetLineOpenings();
 
    // e6y
    // Correction of desync on dv04-423.lmp/dv.wad
    // http://www.doomworld.com/vb/showthread.php?s=&postid=627257#post627257
    if (compatibility_level>=lxdoom_1_compatibility || M_CheckParm("-force_remove_slime_trails") > 0)
-      P_RemoveSlimeTrails();    // killough 10/98: remove slime trails from wad
+      P_RemoveCachedSlimeTrails(cached); // killough 10/98: remove slime trails from wad
+
+   P_StartSubsectorInteriors();
+   R_BuildPVS();
+   P_BuildReject();
+   P_FinishSubsectorInteriors();
 
    // Note: you don't need to clear player queue slots --
    // a much simpler fix is in g_game.c -- killough 10/98
@@ -1864,6 +2583,8 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
    P_MapStart();
 
    P_LoadThings(lumpnum+ML_THINGS);
+   if (!cached)
+      P_UseNativeLumps(NULL); // nowhere to keep them
 
    // if deathmatch, randomly spawn the active players
    if (deathmatch)
@@ -1897,6 +2618,8 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
 
    P_MapEnd();
 
+   R_BuildFlatArena();
+
    // preload graphics
    if (precache)
       R_PrecacheLevel();
@@ -1904,6 +2627,128 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
    R_SmoothPlaying_Reset(NULL); // e6y
 }
 
+//
+// P_PrefetchLevel
+//
+// Starts reading the lumps the given map will need while the intermission
+// is up: the map's own lumps, and the flats, wall patches and spawn sprites
+// its sectors, sidedefs and things name. Only names are resolved here, and
+// nothing that isn't in the wads is reported; P_SetupLevel still checks
+// everything when the map is really loaded.
+//
+
+static void P_MarkPrefetch(byte *marked, int *lumps, int *count, int lump)
+{
+  if (lump >= 0 && lump < numlumps && !marked[lump])
+  {
+    marked[lump] = 1;
+    lumps[(*count)++] = lump;
+  }
+}
+
+static void P_MarkPrefetchTexture(byte *marked, int *lumps, int *count,
+                                  const char *name)
+{
+  int tex = R_CheckTextureNumForName(name), k;
+
+  if (tex > 0)
+    for (k = 0; k < textures[tex]->patchcount; k++)
+      P_MarkPrefetch(marked, lumps, count, textures[tex]->patches[k].patch);
+}
+
+void P_PrefetchLevel(int episode, int map)
+{
+  char lumpname[9], gl_lumpname[9];
+  int lumpnum, gl_lumpnum, count = 0, i, j;
+  byte *marked;
+  int *lumps;
+
+  if (gamemode == commercial)
+  {
+    sprintf(lumpname, "map%02d", map);
+    sprintf(gl_lumpname, "gl_map%02d", map);
+  }
+  else
+  {
+    sprintf(lumpname, "E%dM%d", episode, map);
+    sprintf(gl_lumpname, "GL_E%iM%i", episode, map);
+  }
+  if ((lumpnum = W_CheckNumForName(lumpname)) == -1 ||
+      lumpnum + ML_BLOCKMAP >= numlumps)
+    return;
+  gl_lumpnum = W_CheckNumForName(gl_lumpname);
+
+  marked = calloc(numlumps, 1);
+  lumps = malloc(numlumps * sizeof *lumps);
+
+  for (i = ML_THINGS; i <= ML_BLOCKMAP; i++)
+    P_MarkPrefetch(marked, lumps, &count, lumpnum + i);
+  if (gl_lumpnum != -1)
+    for (i = ML_GL_VERTS; i <= ML_GL_NODES; i++)
+      P_MarkPrefetch(marked, lumps, &count, gl_lumpnum + i);
+
+  {
+    const mapsector_t *ms = W_CacheLumpNum(lumpnum + ML_SECTORS);
+    int n = W_LumpLength(lumpnum + ML_SECTORS) / sizeof(mapsector_t);
+
+    for (i = 0; i < n; i++)
+    {
+      P_MarkPrefetch(marked, lumps, &count,
+          (W_CheckNumForName)(ms[i].floorpic, ns_flats));
+      P_MarkPrefetch(marked, lumps, &count,
+          (W_CheckNumForName)(ms[i].ceilingpic, ns_flats));
+    }
+    W_UnlockLumpNum(lumpnum + ML_SECTORS);
+  }
+
+  {
+    const mapsidedef_t *msd = W_CacheLumpNum(lumpnum + ML_SIDEDEFS);
+    int n = W_LumpLength(lumpnum + ML_SIDEDEFS) / sizeof(mapsidedef_t);
+
+    for (i = 0; i < n; i++)
+    {
+      P_MarkPrefetchTexture(marked, lumps, &count, msd[i].toptexture);
+      P_MarkPrefetchTexture(marked, lumps, &count, msd[i].midtexture);
+      P_MarkPrefetchTexture(marked, lumps, &count, msd[i].bottomtexture);
+    }
+    W_UnlockLumpNum(lumpnum + ML_SIDEDEFS);
+  }
+
+  {
+    const mapthing_t *mt = W_CacheLumpNum(lumpnum + ML_THINGS);
+    int n = W_LumpLength(lumpnum + ML_THINGS) / sizeof(mapthing_t);
+    byte *spritemarked = calloc(numsprites, 1);
+
+    for (i = 0; i < n; i++)
+    {
+      int type = SHORT(mt[i].type);
+
+      for (j = 0; j < NUMMOBJTYPES; j++)
+        if (mobjinfo[j].doomednum == type)
+        {
+          int spr = states[mobjinfo[j].spawnstate].sprite, f, k;
+
+          if (spr < numsprites && !spritemarked[spr])
+          {
+            spritemarked[spr] = 1;
+            for (f = 0; f < sprites[spr].numframes; f++)
+              for (k = 0; k < 8; k++)
+                if (sprites[spr].spriteframes[f].lump[k] >= 0)
+                  P_MarkPrefetch(marked, lumps, &count,
+                      firstspritelump + sprites[spr].spriteframes[f].lump[k]);
+          }
+          break;
+        }
+    }
+    free(spritemarked);
+    W_UnlockLumpNum(lumpnum + ML_THINGS);
+  }
+
+  W_StartPrefetch(lumps, count);
+  free(lumps);
+  free(marked);
+}
+
 /*
 =================
 =
@@ -1914,9 +2759,14 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
 
 void P_Init (void)
 {
+   int phase;
+
+   P_InitGenLineTypes();
    P_InitSwitchList();
    P_InitPicAnims();
+   phase = D_StartupBegin("R_InitSprites");
    R_InitSprites(sprnames);
+   D_StartupEnd(phase);
 }
 /*
  * 
@@ -38,6 +38,7 @@
 
 void P_SetupLevel(int episode, int map, int playermask, skill_t skill);
 void P_Init(void);               /* Called by startup code. */
+void P_PrefetchLevel(int episode, int map); /* read ahead, at intermission */
 void P_Deinit(void);
 
 extern const uint8_t *rejectmatrix;   /* for fast sight rejection -  cph - const* */
@@ -49,6 +50,35 @@ extern int      bmapwidth;
 extern int      bmapheight;      /* in mapblocks */
 extern fixed_t  bmaporgx;
 extern fixed_t  bmaporgy;        /* origin of block map */
-extern mobj_t   **blocklinks;    /* for thing chains */
+
+/* Things in each blockmap cell, in the order they were linked in, with
+ * the position and radius the iterators test kept alongside, and the
+ * side of the target grid they are counted on (TG_NONE if not) */
+typedef struct {
+  mobj_t  *mobj;
+  fixed_t x, y, radius;
+  int     side;
+} blockthing_t;
+
+typedef struct blockthings_s {
+  blockthing_t *things;
+  int          count, max;
+} blockthings_t;
+
+extern blockthings_t *blockthings;
+
+/* Monsters linked in the blockmap, counted by side over cells of
+ * TARGETGRIDSHIFT by TARGETGRIDSHIFT mapblocks */
+#define TARGETGRIDSHIFT 2
+enum { TG_NONE = -1, TG_ENEMIES, TG_FRIENDS };
+
+extern int (*targetgrid)[2];
+extern int targetgridwidth, targetgridheight;
+
+/* Lines of cell i are blocklines[blockcells[i]] up to blockcells[i+1],
+ * first entry included, with their bounding boxes in blocklinebox */
+extern int      *blockcells;
+extern int      *blocklines;
+extern fixed_t  (*blocklinebox)[4];
 
 #endif
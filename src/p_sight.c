@@ -38,6 +38,9 @@
 #include "p_setup.h"
 #include "m_bbox.h"
 #include "lprintf.h"
+#include "d_bench.h"
+#include "p_tick.h"
+#include "i_jobs.h"
 
 //
 // P_CheckSight
@@ -51,10 +54,36 @@ typedef struct {
   fixed_t topslope, bottomslope;   // slopes to top and bottom of target
   fixed_t bbox[4];
   fixed_t maxz,minz;               // cph - z optimisations for 2sided lines
+  dbool marklines;                 // skip lines met twice, using validcount
 } los_t;
 
 static los_t los; // cph - made static
 
+//
+// Sight cache
+//
+// A monster can ask about the same target several times in a tic, from
+// A_Chase, P_LookForPlayers, P_CheckMissileRange and the like. The BSP
+// walk only depends on where the two things are and on the sector
+// heights, so its result is kept, keyed by the pair of things and their
+// positions, until any plane moves.
+//
+
+#define SIGHTCACHESIZE 1024 // power of two
+
+typedef struct {
+  const mobj_t *t1, *t2;
+  fixed_t x1, y1, z1, height1;
+  fixed_t x2, y2, z2, height2;
+  unsigned generation;
+  dbool result;
+} sightcache_t;
+
+static sightcache_t sightcache[SIGHTCACHESIZE];
+static int64_t sightlookups, sighthits;
+
+unsigned sightgeneration;
+
 //
 // P_DivlineSide
 // Returns side 0 (front), 1 (back), or 2 (on).
@@ -73,51 +102,36 @@ static INLINE int P_DivlineSide(fixed_t x, fixed_t y, const divline_t *node)
 }
 
 //
-// P_CrossSubsector
+// P_CrossLine
 // Returns TRUE
-//  if strace crosses the given subsector successfully.
+//  if strace gets past the given line, between the given sectors if it
+//  is two sided, narrowing the slopes to the opening it leaves.
 //
-// killough 4/19/98: made static and cleaned up
 
-static dbool   P_CrossSubsector(int num)
+static dbool   P_CrossLine(los_t *los, const line_t *line,
+                           const sector_t *front, const sector_t *back)
 {
-  seg_t *seg = segs + subsectors[num].firstline;
-  int count;
   fixed_t opentop = 0, openbottom = 0;
-  const sector_t *front = NULL, *back = NULL;
-
-  for (count = subsectors[num].numlines; --count >= 0; seg++) { // check lines
-    line_t *line = seg->linedef;
-    divline_t divl;
-
-   if(!line) // figgi -- skip minisegs
-     continue;
-
-    // allready checked other side?
-    if (line->validcount == validcount)
-      continue;
-
-    line->validcount = validcount;
+  divline_t divl;
 
     /* OPTIMIZE: killough 4/20/98: Added quick bounding-box rejection test
      * cph - this is causing demo desyncs on original Doom demos.
      *  Who knows why. Exclude test for those.
      */
     if (!demo_compatibility)
-    if (line->bbox[BOXLEFT  ] > los.bbox[BOXRIGHT ] ||
-  line->bbox[BOXRIGHT ] < los.bbox[BOXLEFT  ] ||
-  line->bbox[BOXBOTTOM] > los.bbox[BOXTOP   ] ||
-  line->bbox[BOXTOP]    < los.bbox[BOXBOTTOM])
-      continue;
+    if (line->bbox[BOXLEFT  ] > los->bbox[BOXRIGHT ] ||
+  line->bbox[BOXRIGHT ] < los->bbox[BOXLEFT  ] ||
+  line->bbox[BOXBOTTOM] > los->bbox[BOXTOP   ] ||
+  line->bbox[BOXTOP]    < los->bbox[BOXBOTTOM])
+      return TRUE;
 
     // cph - do what we can before forced to check intersection
     if (line->flags & ML_TWOSIDED) {
 
       // no wall to block sight with?
-      if ((front = seg->frontsector)->floorheight ==
-    (back = seg->backsector)->floorheight   &&
+      if (front->floorheight == back->floorheight   &&
     front->ceilingheight == back->ceilingheight)
-  continue;
+  return TRUE;
 
       // possible occluder
       // because of ceiling height differences
@@ -129,8 +143,8 @@ static dbool   P_CrossSubsector(int num)
   front->floorheight : back->floorheight ;
 
       // cph - reject if does not intrude in the z-space of the possible LOS
-      if ((opentop >= los.maxz) && (openbottom <= los.minz))
-  continue;
+      if ((opentop >= los->maxz) && (openbottom <= los->minz))
+  return TRUE;
     }
 
     { // Forget this line if it doesn't cross the line of sight
@@ -139,48 +153,81 @@ static dbool   P_CrossSubsector(int num)
       v1 = line->v1;
       v2 = line->v2;
 
-      if (P_DivlineSide(v1->x, v1->y, &los.strace) ==
-          P_DivlineSide(v2->x, v2->y, &los.strace))
-        continue;
+      if (P_DivlineSide(v1->x, v1->y, &los->strace) ==
+          P_DivlineSide(v2->x, v2->y, &los->strace))
+        return TRUE;
 
       divl.dx = v2->x - (divl.x = v1->x);
       divl.dy = v2->y - (divl.y = v1->y);
 
       // line isn't crossed?
-      if (P_DivlineSide(los.strace.x, los.strace.y, &divl) ==
-    P_DivlineSide(los.t2x, los.t2y, &divl))
-  continue;
+      if (P_DivlineSide(los->strace.x, los->strace.y, &divl) ==
+    P_DivlineSide(los->t2x, los->t2y, &divl))
+  return TRUE;
     }
 
     // cph - if bottom >= top or top < minz or bottom > maxz then it must be
     // solid wrt this LOS
     if (!(line->flags & ML_TWOSIDED) || (openbottom >= opentop) ||
-  (opentop < los.minz) || (openbottom > los.maxz))
+  (opentop < los->minz) || (openbottom > los->maxz))
   return FALSE;
 
     { // crosses a two sided line
       /* cph 2006/07/15 - oops, we missed this in 2.4.0 & .1;
        *  use P_InterceptVector2 for those compat levels only. */ 
       fixed_t frac = (compatibility_level == prboom_5_compatibility || compatibility_level == prboom_6_compatibility) ?
-		      P_InterceptVector2(&los.strace, &divl) : 
-		      P_InterceptVector(&los.strace, &divl);
+		      P_InterceptVector2(&los->strace, &divl) : 
+		      P_InterceptVector(&los->strace, &divl);
 
       if (front->floorheight != back->floorheight) {
-        fixed_t slope = FixedDiv(openbottom - los.sightzstart , frac);
-        if (slope > los.bottomslope)
-            los.bottomslope = slope;
+        fixed_t slope = FixedDiv(openbottom - los->sightzstart , frac);
+        if (slope > los->bottomslope)
+            los->bottomslope = slope;
       }
 
       if (front->ceilingheight != back->ceilingheight)
         {
-          fixed_t slope = FixedDiv(opentop - los.sightzstart , frac);
-          if (slope < los.topslope)
-            los.topslope = slope;
+          fixed_t slope = FixedDiv(opentop - los->sightzstart , frac);
+          if (slope < los->topslope)
+            los->topslope = slope;
         }
 
-      if (los.topslope <= los.bottomslope)
+      if (los->topslope <= los->bottomslope)
         return FALSE;               // stop
     }
+  return TRUE;
+}
+
+//
+// P_CrossSubsector
+// Returns TRUE
+//  if strace crosses the given subsector successfully.
+//
+// killough 4/19/98: made static and cleaned up
+
+static dbool   P_CrossSubsector(los_t *los, int num)
+{
+  seg_t *seg = segs + subsectors[num].firstline;
+  int count;
+
+  for (count = subsectors[num].numlines; --count >= 0; seg++) { // check lines
+    line_t *line = seg->linedef;
+
+   if(!line) // figgi -- skip minisegs
+     continue;
+
+    // allready checked other side? Checking it again narrows the slopes
+    // the same way, so a trace that can't mark lines gets the same answer
+    if (los->marklines)
+    {
+      if (line->validcount == validcount)
+        continue;
+
+      line->validcount = validcount;
+    }
+
+    if (!P_CrossLine(los, line, seg->frontsector, seg->backsector))
+      return FALSE;
   }
   // passed the subsector ok
   return TRUE;
@@ -196,65 +243,128 @@ static dbool   P_CrossSubsector(int num)
 //  could return 2 which was ambigous, and the former is
 //  better optimised; also removes two casts :-)
 
-static dbool   P_CrossBSPNode_LxDoom(int bspnum)
+static dbool   P_CrossBSPNode_LxDoom(los_t *los, int bspnum)
 {
   while (!(bspnum & NF_SUBSECTOR))
     {
       register const node_t *bsp = nodes + bspnum;
       int side,side2;
-      side = R_PointOnSide(los.strace.x, los.strace.y, bsp);
-      side2 = R_PointOnSide(los.t2x, los.t2y, bsp);
+      side = R_PointOnSide(los->strace.x, los->strace.y, bsp);
+      side2 = R_PointOnSide(los->t2x, los->t2y, bsp);
       if (side == side2)
          bspnum = bsp->children[side]; // doesn't touch the other side
       else         // the partition plane is crossed here
-        if (!P_CrossBSPNode_LxDoom(bsp->children[side]))
+        if (!P_CrossBSPNode_LxDoom(los, bsp->children[side]))
           return 0;  // cross the starting side
         else
           bspnum = bsp->children[side^1];  // cross the ending side
     }
-  return P_CrossSubsector(bspnum == -1 ? 0 : bspnum & ~NF_SUBSECTOR);
+  return P_CrossSubsector(los, bspnum == -1 ? 0 : bspnum & ~NF_SUBSECTOR);
 }
 
-static dbool   P_CrossBSPNode_PrBoom(int bspnum)
+static dbool   P_CrossBSPNode_PrBoom(los_t *los, int bspnum)
 {
   while (!(bspnum & NF_SUBSECTOR))
     {
       register const node_t *bsp = nodes + bspnum;
       int side,side2;
-      side = P_DivlineSide(los.strace.x,los.strace.y,(const divline_t *)bsp)&1;
-      side2= P_DivlineSide(los.t2x, los.t2y, (const divline_t *) bsp);
+      side = P_DivlineSide(los->strace.x,los->strace.y,(const divline_t *)bsp)&1;
+      side2= P_DivlineSide(los->t2x, los->t2y, (const divline_t *) bsp);
       if (side == side2)
          bspnum = bsp->children[side]; // doesn't touch the other side
       else         // the partition plane is crossed here
-        if (!P_CrossBSPNode_PrBoom(bsp->children[side]))
+        if (!P_CrossBSPNode_PrBoom(los, bsp->children[side]))
           return 0;  // cross the starting side
         else
           bspnum = bsp->children[side^1];  // cross the ending side
     }
-  return P_CrossSubsector(bspnum == -1 ? 0 : bspnum & ~NF_SUBSECTOR);
+  return P_CrossSubsector(los, bspnum == -1 ? 0 : bspnum & ~NF_SUBSECTOR);
 }
 
 /* proff - Moved the compatibility check outside the functions
  * this gives a slight speedup
  */
-static dbool   P_CrossBSPNode(int bspnum)
+static dbool   P_CrossBSPNode(los_t *los, int bspnum)
 {
   /* cph - LxDoom used some R_* funcs here */
   if (compatibility_level == lxdoom_1_compatibility)
-    return P_CrossBSPNode_LxDoom(bspnum);
+    return P_CrossBSPNode_LxDoom(los, bspnum);
   else
-    return P_CrossBSPNode_PrBoom(bspnum);
+    return P_CrossBSPNode_PrBoom(los, bspnum);
 }
 
 //
-// P_CheckSight
+// P_CrossBlockmap
 // Returns TRUE
-//  if a straight line between t1 and t2 is unobstructed.
-// Uses REJECT.
+//  if strace gets past every line in the blockmap cells it passes
+//  through, walked a column at a time instead of down the BSP tree.
+//
+
+int blockmap_sight;
+
+static dbool PIT_CrossLine(line_t *line)
+{
+  // a two sided line missing its back sector blocks, as it has no opening
+  if ((line->flags & ML_TWOSIDED) && !line->backsector)
+    return FALSE;
+  return P_CrossLine(&los, line, line->frontsector, line->backsector);
+}
+
+static dbool P_CrossBlockmap(void)
+{
+  int64_t x1 = (int64_t)los.strace.x - bmaporgx;
+  int64_t y1 = (int64_t)los.strace.y - bmaporgy;
+  int64_t x2 = (int64_t)los.t2x - bmaporgx;
+  int64_t y2 = (int64_t)los.t2y - bmaporgy;
+  int bx, bx2, by, by1, by2;
+
+  // always walk left to right, so each column is a single y range
+  if (x1 > x2)
+  {
+    int64_t t;
+    t = x1, x1 = x2, x2 = t;
+    t = y1, y1 = y2, y2 = t;
+  }
+
+  bx = (int)(x1 >> MAPBLOCKSHIFT);
+  bx2 = (int)(x2 >> MAPBLOCKSHIFT);
+
+  for (; bx <= bx2; bx++)
+  {
+    // y range of the trace within this column, clipped to its endpoints
+    int64_t cx1 = (int64_t)bx << MAPBLOCKSHIFT;
+    int64_t cx2 = cx1 + (1 << MAPBLOCKSHIFT);
+    int64_t ya = y1, yb = y2;
+
+    if (x2 != x1)
+    {
+      if (cx1 > x1)
+        ya = y1 + (y2 - y1) * (cx1 - x1) / (x2 - x1);
+      if (cx2 < x2)
+        yb = y1 + (y2 - y1) * (cx2 - x1) / (x2 - x1);
+    }
+    if (ya > yb)
+    {
+      int64_t t = ya;
+      ya = yb, yb = t;
+    }
+
+    by1 = (int)(ya >> MAPBLOCKSHIFT);
+    by2 = (int)(yb >> MAPBLOCKSHIFT);
+    for (by = by1; by <= by2; by++)
+      if (!P_BlockLinesIterator(bx, by, PIT_CrossLine))
+        return FALSE;
+  }
+  return TRUE;
+}
+
+//
+// P_SightPrecheck
+// Returns 0 or 1 when REJECT, fake floors or a shared subsector settle
+// whether t1 can see t2, or -1 when the line of sight must be traced.
 //
-// killough 4/20/98: cleaned up, made to use new LOS struct
 
-dbool   P_CheckSight(mobj_t *t1, mobj_t *t2)
+static int P_SightPrecheck(const mobj_t *t1, const mobj_t *t2)
 {
   const sector_t *s1 = t1->subsector->sector;
   const sector_t *s2 = t2->subsector->sector;
@@ -266,7 +376,7 @@ dbool   P_CheckSight(mobj_t *t1, mobj_t *t2)
   // Check in REJECT table.
 
   if (rejectmatrix[pnum>>3] & (1 << (pnum&7)))   // can't possibly be connected
-    return FALSE;
+    return 0;
 
   // killough 4/19/98: make fake floors and ceilings block monster view
 
@@ -281,53 +391,237 @@ dbool   P_CheckSight(mobj_t *t1, mobj_t *t2)
          t1->z >= sectors[s2->heightsec].floorheight) ||
         (t2->z >= sectors[s2->heightsec].ceilingheight &&
          t1->z + t2->height <= sectors[s2->heightsec].ceilingheight))))
-    return FALSE;
+    return 0;
 
   /* killough 11/98: shortcut for melee situations
    * same subsector? obviously visible
    * cph - compatibility optioned for demo sync, cf HR06-UV.LMP */
   if ((t1->subsector == t2->subsector) &&
       (compatibility_level >= mbf_compatibility))
-    return TRUE;
+    return 1;
 
-  // An unobstructed LOS is possible.
-  // Now look from eyes of t1 to any part of t2.
+  return -1;
+}
 
-  validcount++;
+//
+// P_SetupLOS
+// Fills in los for a trace from the eyes of t1 to any part of t2.
+//
 
-  los.topslope = (los.bottomslope = t2->z - (los.sightzstart =
-                                             t1->z + t1->height -
-                                             (t1->height>>2))) + t2->height;
-  los.strace.dx = (los.t2x = t2->x) - (los.strace.x = t1->x);
-  los.strace.dy = (los.t2y = t2->y) - (los.strace.y = t1->y);
+static void P_SetupLOS(los_t *los, const mobj_t *t1, const mobj_t *t2)
+{
+  los->topslope = (los->bottomslope = t2->z - (los->sightzstart =
+                                               t1->z + t1->height -
+                                               (t1->height>>2))) + t2->height;
+  los->strace.dx = (los->t2x = t2->x) - (los->strace.x = t1->x);
+  los->strace.dy = (los->t2y = t2->y) - (los->strace.y = t1->y);
 
   if (t1->x > t2->x)
-    los.bbox[BOXRIGHT] = t1->x, los.bbox[BOXLEFT] = t2->x;
+    los->bbox[BOXRIGHT] = t1->x, los->bbox[BOXLEFT] = t2->x;
   else
-    los.bbox[BOXRIGHT] = t2->x, los.bbox[BOXLEFT] = t1->x;
+    los->bbox[BOXRIGHT] = t2->x, los->bbox[BOXLEFT] = t1->x;
 
   if (t1->y > t2->y)
-    los.bbox[BOXTOP] = t1->y, los.bbox[BOXBOTTOM] = t2->y;
+    los->bbox[BOXTOP] = t1->y, los->bbox[BOXBOTTOM] = t2->y;
   else
-    los.bbox[BOXTOP] = t2->y, los.bbox[BOXBOTTOM] = t1->y;
+    los->bbox[BOXTOP] = t2->y, los->bbox[BOXBOTTOM] = t1->y;
 
   /* cph - calculate min and max z of the potential line of sight
    * For old demos, we disable this optimisation by setting them to
    * the extremes */
   switch (compatibility_level) {
   case lxdoom_1_compatibility:
-    if (los.sightzstart < t2->z) {
-      los.maxz = t2->z + t2->height; los.minz = los.sightzstart;
-    } else if (los.sightzstart > t2->z + t2->height) {
-      los.maxz = los.sightzstart; los.minz = t2->z;
+    if (los->sightzstart < t2->z) {
+      los->maxz = t2->z + t2->height; los->minz = los->sightzstart;
+    } else if (los->sightzstart > t2->z + t2->height) {
+      los->maxz = los->sightzstart; los->minz = t2->z;
     } else {
-      los.maxz = t2->z + t2->height; los.minz = t2->z;
+      los->maxz = t2->z + t2->height; los->minz = t2->z;
     }
     break;
   default:
-    los.maxz = INT_MAX; los.minz = INT_MIN;
+    los->maxz = INT_MAX; los->minz = INT_MIN;
+  }
+
+  los->marklines = TRUE;
+}
+
+static INLINE sightcache_t *P_SightCacheSlot(const mobj_t *t1, const mobj_t *t2)
+{
+  return &sightcache[(((uintptr_t)t1 >> 4) * 31 ^ ((uintptr_t)t2 >> 4)) &
+                     (SIGHTCACHESIZE-1)];
+}
+
+static void P_StoreSight(sightcache_t *sc, const mobj_t *t1, const mobj_t *t2,
+                         dbool result)
+{
+  sc->t1 = t1, sc->t2 = t2;
+  sc->x1 = t1->x, sc->y1 = t1->y, sc->z1 = t1->z, sc->height1 = t1->height;
+  sc->x2 = t2->x, sc->y2 = t2->y, sc->z2 = t2->z, sc->height2 = t2->height;
+  sc->generation = sightgeneration;
+  sc->result = result;
+}
+
+/* The blockmap walk tests the same lines in a different order, which
+ * should give the same answer but is kept away from demos and netgames.
+ * This port only plays demos back (G_ReadDemoTiccmd; there is no -record
+ * and no demorecording flag), so demoplayback covers every demo; a
+ * recording path must be added to the test along with it, or the demo
+ * would take sight results its playback never sees. */
+#define P_UseBlockmapSight() \
+  (blockmap_sight && !demo_compatibility && !demoplayback && !netgame)
+
+//
+// P_CheckSight
+// Returns TRUE
+//  if a straight line between t1 and t2 is unobstructed.
+// Uses REJECT.
+//
+// killough 4/20/98: cleaned up, made to use new LOS struct
+
+static dbool P_DoCheckSight(mobj_t *t1, mobj_t *t2)
+{
+  int precheck = P_SightPrecheck(t1, t2);
+  sightcache_t *sc;
+  dbool result;
+
+  if (precheck >= 0)
+    return precheck;
+
+  // An unobstructed LOS is possible.
+  // Now look from eyes of t1 to any part of t2.
+
+  sightlookups++;
+  sc = P_SightCacheSlot(t1, t2);
+  if (sc->t1 == t1 && sc->t2 == t2 && sc->generation == sightgeneration &&
+      sc->x1 == t1->x && sc->y1 == t1->y &&
+      sc->z1 == t1->z && sc->height1 == t1->height &&
+      sc->x2 == t2->x && sc->y2 == t2->y &&
+      sc->z2 == t2->z && sc->height2 == t2->height)
+  {
+    sighthits++;
+    return sc->result;
+  }
+
+  validcount++;
+  P_SetupLOS(&los, t1, t2);
+
+  if (P_UseBlockmapSight())
+    result = P_CrossBlockmap();
+  else
+    // the head node is the last node output
+    result = P_CrossBSPNode(&los, numnodes-1);
+
+  P_StoreSight(sc, t1, t2, result);
+  return result;
+}
+
+dbool P_CheckSight(mobj_t *t1, mobj_t *t2)
+{
+  int64_t start = D_BenchStart();
+  dbool seen = P_DoCheckSight(t1, t2);
+
+  D_BenchStop(BENCH_SIGHT, start);
+  return seen;
+}
+
+//
+// P_PrecomputeSight
+// Traces, across the job pool, what every awake monster will most likely
+// ask P_CheckSight this tic: whether it sees its target, or each live
+// player if it has none. The answers go into the sight cache as though
+// asked now, so the serial thinker pass only uses one while both things
+// are where they were and no plane has moved since, which is when it
+// would have traced the same answer itself. The traces can't mark lines
+// with validcount, which only saves them rechecking a line.
+//
+
+int sight_precompute;
+
+typedef struct {
+  mobj_t *t1, *t2;
+  dbool result;
+} sightpair_t;
+
+static sightpair_t *sightpairs;
+static int numsightpairs, maxsightpairs;
+
+static void P_AddSightPair(mobj_t *t1, mobj_t *t2)
+{
+  if (P_SightPrecheck(t1, t2) >= 0)
+    return;
+
+  if (numsightpairs == maxsightpairs)
+  {
+    maxsightpairs = maxsightpairs ? maxsightpairs*2 : 256;
+    sightpairs = realloc(sightpairs, maxsightpairs*sizeof(*sightpairs));
   }
+  sightpairs[numsightpairs].t1 = t1;
+  sightpairs[numsightpairs].t2 = t2;
+  numsightpairs++;
+}
+
+static void P_TraceSightPair(void *arg, int i)
+{
+  sightpair_t *pair = &sightpairs[i];
+  los_t trace;
 
-  // the head node is the last node output
-  return P_CrossBSPNode(numnodes-1);
+  P_SetupLOS(&trace, pair->t1, pair->t2);
+  trace.marklines = FALSE;
+  pair->result = P_CrossBSPNode(&trace, numnodes-1);
+}
+
+void P_PrecomputeSight(void)
+{
+  thinker_t *th = NULL;
+  int i;
+
+  if (!sight_precompute || I_JobThreads() <= 1 || P_UseBlockmapSight())
+    return;
+
+  numsightpairs = 0;
+  while ((th = P_NextThinker(th, th_all)) != NULL)
+  {
+    mobj_t *mo;
+
+    if (th->function != (think_t)P_MobjThinker)
+      continue;
+    mo = (mobj_t *)th;
+    if (mo->player || mo->health <= 0 || mo->info->seestate == S_NULL ||
+        (mo->intflags & MIF_PARKED))
+      continue;
+
+    if (mo->target)
+      P_AddSightPair(mo, mo->target);
+    else
+      for (i = 0; i < MAXPLAYERS; i++)
+        if (playeringame[i] && players[i].mo && players[i].health > 0)
+          P_AddSightPair(mo, players[i].mo);
+  }
+
+  I_JobParallelFor(numsightpairs, P_TraceSightPair, NULL);
+
+  // stored in list order, so which of two pairs sharing a slot wins is
+  // always the same
+  for (i = 0; i < numsightpairs; i++)
+  {
+    const sightpair_t *pair = &sightpairs[i];
+    P_StoreSight(P_SightCacheSlot(pair->t1, pair->t2),
+                 pair->t1, pair->t2, pair->result);
+  }
+}
+
+//
+// P_ReportSightCache
+// Logs how often the sight cache hit for the level being left, and
+// empties it for the next one.
+//
+
+void P_ReportSightCache(void)
+{
+  if (sightlookups)
+    lprintf(LO_INFO, "P_ReportSightCache: %d%% of %lld sight checks hit\n",
+        (int)(sighthits * 100 / sightlookups), (long long)sightlookups);
+  sightlookups = sighthits = 0;
+  memset(sightcache, 0, sizeof sightcache);
 }
@@ -58,6 +58,7 @@
 #include "d_deh.h"
 #include "r_plane.h"
 #include "lprintf.h"
+#include "p_saveg.h"
 
 //
 // Animating textures and planes
@@ -70,6 +71,8 @@ typedef struct
     int         basepic;
     int         numpics;
     int         speed;
+    int         step;       // leveltime/speed last written, INT_MIN if none
+    dbool       overlaps;   // shares pics with an earlier animation
 
 } anim_t;
 
@@ -222,6 +225,17 @@ void P_InitPicAnims (void)
                   animdefs[i].endname);
 
     lastanim->speed = LONG(animdefs[i].speed); // killough 5/5/98: add LONG()
+    lastanim->step = INT_MIN;
+    lastanim->overlaps = FALSE;
+    {
+      anim_t *a;
+
+      for (a = anims; a < lastanim; a++)
+        if (a->istexture == lastanim->istexture &&
+            a->basepic < lastanim->basepic + lastanim->numpics &&
+            lastanim->basepic < a->basepic + a->numpics)
+          lastanim->overlaps = TRUE;
+    }
     lastanim++;
   }
 
@@ -229,6 +243,22 @@ void P_InitPicAnims (void)
     W_UnlockLumpNum(lump);
 }
 
+void P_MarkAnimatedFlats(uint8_t *used)
+{
+  const anim_t *a;
+
+  for (a = anims; a < lastanim; a++)
+    if (!a->istexture)
+    {
+      int i;
+
+      for (i = 0; i < a->numpics && !used[a->basepic + i]; i++)
+        ;
+      if (i < a->numpics)
+        memset(used + a->basepic, 1, a->numpics);
+    }
+}
+
 ///////////////////////////////////////////////////////////////
 //
 // Linedef and Sector Special Implementation Utility Functions
@@ -325,6 +355,67 @@ sector_t* getNextSector
 }
 
 
+//
+// P_SurroundingSectors()
+//
+// Points *list at the sectors getNextSector finds across sec's lines
+// and returns how many there are. Without comp_model that is the list
+// P_GroupLines made, with each sector once, which makes no difference
+// to the lowest, highest or nearest heights looked for below. With it
+// the answer hangs on the lines' flags, so is worked out every time.
+//
+
+static int P_SurroundingSectors(sector_t *sec, sector_t ***list)
+{
+  static sector_t **found;
+  static int maxfound;
+  sector_t *other;
+  int i, n = 0;
+
+  if (!comp[comp_model])
+  {
+    *list = sec->neighbors;
+    return sec->neighborcount;
+  }
+
+  if (sec->linecount > maxfound)
+    found = realloc(found, (maxfound = sec->linecount) * sizeof *found);
+  for (i=0 ;i < sec->linecount ; i++)
+    if ((other = getNextSector(sec->lines[i],sec)))
+      found[n++] = other;
+  *list = found;
+  return n;
+}
+
+//
+// P_TwoSidedLines()
+//
+// Points *list at sec's lines that twoSided() accepts, in order, and
+// returns how many there are.
+//
+
+static int P_TwoSidedLines(sector_t *sec, line_t ***list)
+{
+  static line_t **found;
+  static int maxfound;
+  int i, n = 0;
+
+  if (!comp[comp_model])
+  {
+    *list = sec->twosided;
+    return sec->twosidedcount;
+  }
+
+  if (sec->linecount > maxfound)
+    found = realloc(found, (maxfound = sec->linecount) * sizeof *found);
+  for (i=0 ;i < sec->linecount ; i++)
+    if (twoSided(sec - sectors, i))
+      found[n++] = sec->lines[i];
+  *list = found;
+  return n;
+}
+
+
 //
 // P_FindLowestFloorSurrounding()
 //
@@ -333,22 +424,14 @@ sector_t* getNextSector
 //
 fixed_t P_FindLowestFloorSurrounding(sector_t* sec)
 {
-  int                 i;
-  line_t*             check;
-  sector_t*           other;
+  int                 i, n;
+  sector_t**          other;
   fixed_t             floor = sec->floorheight;
 
-  for (i=0 ;i < sec->linecount ; i++)
-  {
-    check = sec->lines[i];
-    other = getNextSector(check,sec);
-
-    if (!other)
-      continue;
-
-    if (other->floorheight < floor)
-      floor = other->floorheight;
-  }
+  n = P_SurroundingSectors(sec, &other);
+  for (i=0 ;i < n ; i++)
+    if (other[i]->floorheight < floor)
+      floor = other[i]->floorheight;
   return floor;
 }
 
@@ -364,9 +447,8 @@ fixed_t P_FindLowestFloorSurrounding(sector_t* sec)
 //
 fixed_t P_FindHighestFloorSurrounding(sector_t *sec)
 {
-  int i;
-  line_t* check;
-  sector_t* other;
+  int i, n;
+  sector_t** other;
   fixed_t floor = -500*FRACUNIT;
 
   //jff 1/26/98 Fix initial value for floor to not act differently
@@ -374,17 +456,10 @@ fixed_t P_FindHighestFloorSurrounding(sector_t *sec)
   if (!comp[comp_model])       /* jff 3/12/98 avoid ovf */
     floor = -32000*FRACUNIT;   // in height calculations
 
-  for (i=0 ;i < sec->linecount ; i++)
-  {
-    check = sec->lines[i];
-    other = getNextSector(check,sec);
-
-    if (!other)
-      continue;
-
-    if (other->floorheight > floor)
-      floor = other->floorheight;
-  }
+  n = P_SurroundingSectors(sec, &other);
+  for (i=0 ;i < n ; i++)
+    if (other[i]->floorheight > floor)
+      floor = other[i]->floorheight;
   return floor;
 }
 
@@ -401,19 +476,17 @@ fixed_t P_FindHighestFloorSurrounding(sector_t *sec)
 //
 fixed_t P_FindNextHighestFloor(sector_t *sec, int currentheight)
 {
-  sector_t *other;
-  int i;
+  sector_t **other;
+  int i, n = P_SurroundingSectors(sec, &other);
 
-  for (i=0 ;i < sec->linecount ; i++)
-    if ((other = getNextSector(sec->lines[i],sec)) &&
-         other->floorheight > currentheight)
+  for (i=0 ;i < n ; i++)
+    if (other[i]->floorheight > currentheight)
     {
-      int height = other->floorheight;
-      while (++i < sec->linecount)
-        if ((other = getNextSector(sec->lines[i],sec)) &&
-            other->floorheight < height &&
-            other->floorheight > currentheight)
-          height = other->floorheight;
+      int height = other[i]->floorheight;
+      while (++i < n)
+        if (other[i]->floorheight < height &&
+            other[i]->floorheight > currentheight)
+          height = other[i]->floorheight;
       return height;
     }
   /* cph - my guess at doom v1.2 - 1.4beta compatibility here.
@@ -436,19 +509,17 @@ fixed_t P_FindNextHighestFloor(sector_t *sec, int currentheight)
 //
 fixed_t P_FindNextLowestFloor(sector_t *sec, int currentheight)
 {
-  sector_t *other;
-  int i;
+  sector_t **other;
+  int i, n = P_SurroundingSectors(sec, &other);
 
-  for (i=0 ;i < sec->linecount ; i++)
-    if ((other = getNextSector(sec->lines[i],sec)) &&
-         other->floorheight < currentheight)
+  for (i=0 ;i < n ; i++)
+    if (other[i]->floorheight < currentheight)
     {
-      int height = other->floorheight;
-      while (++i < sec->linecount)
-        if ((other = getNextSector(sec->lines[i],sec)) &&
-            other->floorheight > height &&
-            other->floorheight < currentheight)
-          height = other->floorheight;
+      int height = other[i]->floorheight;
+      while (++i < n)
+        if (other[i]->floorheight > height &&
+            other[i]->floorheight < currentheight)
+          height = other[i]->floorheight;
       return height;
     }
   return currentheight;
@@ -467,19 +538,17 @@ fixed_t P_FindNextLowestFloor(sector_t *sec, int currentheight)
 //
 fixed_t P_FindNextLowestCeiling(sector_t *sec, int currentheight)
 {
-  sector_t *other;
-  int i;
+  sector_t **other;
+  int i, n = P_SurroundingSectors(sec, &other);
 
-  for (i=0 ;i < sec->linecount ; i++)
-    if ((other = getNextSector(sec->lines[i],sec)) &&
-        other->ceilingheight < currentheight)
+  for (i=0 ;i < n ; i++)
+    if (other[i]->ceilingheight < currentheight)
     {
-      int height = other->ceilingheight;
-      while (++i < sec->linecount)
-        if ((other = getNextSector(sec->lines[i],sec)) &&
-            other->ceilingheight > height &&
-            other->ceilingheight < currentheight)
-          height = other->ceilingheight;
+      int height = other[i]->ceilingheight;
+      while (++i < n)
+        if (other[i]->ceilingheight > height &&
+            other[i]->ceilingheight < currentheight)
+          height = other[i]->ceilingheight;
       return height;
     }
   return currentheight;
@@ -498,19 +567,17 @@ fixed_t P_FindNextLowestCeiling(sector_t *sec, int currentheight)
 //
 fixed_t P_FindNextHighestCeiling(sector_t *sec, int currentheight)
 {
-  sector_t *other;
-  int i;
+  sector_t **other;
+  int i, n = P_SurroundingSectors(sec, &other);
 
-  for (i=0 ;i < sec->linecount ; i++)
-    if ((other = getNextSector(sec->lines[i],sec)) &&
-         other->ceilingheight > currentheight)
+  for (i=0 ;i < n ; i++)
+    if (other[i]->ceilingheight > currentheight)
     {
-      int height = other->ceilingheight;
-      while (++i < sec->linecount)
-        if ((other = getNextSector(sec->lines[i],sec)) &&
-            other->ceilingheight < height &&
-            other->ceilingheight > currentheight)
-          height = other->ceilingheight;
+      int height = other[i]->ceilingheight;
+      while (++i < n)
+        if (other[i]->ceilingheight < height &&
+            other[i]->ceilingheight > currentheight)
+          height = other[i]->ceilingheight;
       return height;
     }
   return currentheight;
@@ -528,25 +595,17 @@ fixed_t P_FindNextHighestCeiling(sector_t *sec, int currentheight)
 //
 fixed_t P_FindLowestCeilingSurrounding(sector_t* sec)
 {
-  int                 i;
-  line_t*             check;
-  sector_t*           other;
+  int                 i, n;
+  sector_t**          other;
   fixed_t             height = INT_MAX;
 
   /* jff 3/12/98 avoid ovf in height calculations */
   if (!comp[comp_model]) height = 32000*FRACUNIT;
 
-  for (i=0 ;i < sec->linecount ; i++)
-  {
-    check = sec->lines[i];
-    other = getNextSector(check,sec);
-
-    if (!other)
-      continue;
-
-    if (other->ceilingheight < height)
-      height = other->ceilingheight;
-  }
+  n = P_SurroundingSectors(sec, &other);
+  for (i=0 ;i < n ; i++)
+    if (other[i]->ceilingheight < height)
+      height = other[i]->ceilingheight;
   return height;
 }
 
@@ -562,9 +621,8 @@ fixed_t P_FindLowestCeilingSurrounding(sector_t* sec)
 //
 fixed_t P_FindHighestCeilingSurrounding(sector_t* sec)
 {
-  int             i;
-  line_t* check;
-  sector_t*       other;
+  int             i, n;
+  sector_t**      other;
   fixed_t height = 0;
 
   /* jff 1/26/98 Fix initial value for floor to not act differently
@@ -572,17 +630,10 @@ fixed_t P_FindHighestCeilingSurrounding(sector_t* sec)
    * jff 3/12/98 avoid ovf in height calculations */
   if (!comp[comp_model]) height = -32000*FRACUNIT;
 
-  for (i=0 ;i < sec->linecount ; i++)
-  {
-    check = sec->lines[i];
-    other = getNextSector(check,sec);
-
-    if (!other)
-      continue;
-
-    if (other->ceilingheight > height)
-      height = other->ceilingheight;
-  }
+  n = P_SurroundingSectors(sec, &other);
+  for (i=0 ;i < n ; i++)
+    if (other[i]->ceilingheight > height)
+      height = other[i]->ceilingheight;
   return height;
 }
 
@@ -602,25 +653,23 @@ fixed_t P_FindShortestTextureAround(int secnum)
 {
   int minsize = INT_MAX;
   side_t*     side;
-  int i;
-  sector_t *sec = &sectors[secnum];
+  line_t**    line;
+  int i, n;
 
   if (!comp[comp_model])
     minsize = 32000<<FRACBITS; //jff 3/13/98 prevent overflow in height calcs
 
-  for (i = 0; i < sec->linecount; i++)
+  n = P_TwoSidedLines(&sectors[secnum], &line);
+  for (i = 0; i < n; i++)
   {
-    if (twoSided(secnum, i))
-    {
-      side = getSide(secnum,i,0);
-      if (side->bottomtexture > 0)  //jff 8/14/98 texture 0 is a placeholder
-        if (textureheight[side->bottomtexture] < minsize)
-          minsize = textureheight[side->bottomtexture];
-      side = getSide(secnum,i,1);
-      if (side->bottomtexture > 0)  //jff 8/14/98 texture 0 is a placeholder
-        if (textureheight[side->bottomtexture] < minsize)
-          minsize = textureheight[side->bottomtexture];
-    }
+    side = &sides[line[i]->sidenum[0]];
+    if (side->bottomtexture > 0)  //jff 8/14/98 texture 0 is a placeholder
+      if (textureheight[side->bottomtexture] < minsize)
+        minsize = textureheight[side->bottomtexture];
+    side = &sides[line[i]->sidenum[1]];
+    if (side->bottomtexture > 0)  //jff 8/14/98 texture 0 is a placeholder
+      if (textureheight[side->bottomtexture] < minsize)
+        minsize = textureheight[side->bottomtexture];
   }
   return minsize;
 }
@@ -641,25 +690,24 @@ fixed_t P_FindShortestUpperAround(int secnum)
 {
   int minsize = INT_MAX;
   side_t*     side;
-  int i;
-  sector_t *sec = &sectors[secnum];
+  line_t**    line;
+  int i, n;
 
   if (!comp[comp_model])
     minsize = 32000<<FRACBITS; //jff 3/13/98 prevent overflow
                                // in height calcs
-  for (i = 0; i < sec->linecount; i++)
+
+  n = P_TwoSidedLines(&sectors[secnum], &line);
+  for (i = 0; i < n; i++)
   {
-    if (twoSided(secnum, i))
-    {
-      side = getSide(secnum,i,0);
-      if (side->toptexture > 0)     //jff 8/14/98 texture 0 is a placeholder
-        if (textureheight[side->toptexture] < minsize)
-          minsize = textureheight[side->toptexture];
-      side = getSide(secnum,i,1);
-      if (side->toptexture > 0)     //jff 8/14/98 texture 0 is a placeholder
-        if (textureheight[side->toptexture] < minsize)
-          minsize = textureheight[side->toptexture];
-    }
+    side = &sides[line[i]->sidenum[0]];
+    if (side->toptexture > 0)  //jff 8/14/98 texture 0 is a placeholder
+      if (textureheight[side->toptexture] < minsize)
+        minsize = textureheight[side->toptexture];
+    side = &sides[line[i]->sidenum[1]];
+    if (side->toptexture > 0)  //jff 8/14/98 texture 0 is a placeholder
+      if (textureheight[side->toptexture] < minsize)
+        minsize = textureheight[side->toptexture];
   }
   return minsize;
 }
@@ -686,6 +734,23 @@ sector_t *P_FindModelFloorSector(fixed_t floordestheight,int secnum)
   int linecount;
 
   sec = &sectors[secnum]; //jff 3/2/98 woops! better do this
+
+  // the two-sided lines are listed, unless the old demo exit is needed
+  if (!comp[comp_model] && !demo_compatibility)
+  {
+    for (i = 0; i < sec->twosidedcount; i++)
+    {
+      line_t *line = sec->twosided[i];
+      sector_t *other = sides[line->sidenum[0]].sector;
+
+      if (other-sectors == secnum)
+          other = sides[line->sidenum[1]].sector;
+      if (other->floorheight == floordestheight)
+        return other;
+    }
+    return NULL;
+  }
+
   //jff 5/23/98 don't disturb sec->linecount while searching
   // but allow early exit in old demos
   linecount = sec->linecount;
@@ -729,6 +794,23 @@ sector_t *P_FindModelCeilingSector(fixed_t ceildestheight,int secnum)
   int linecount;
 
   sec = &sectors[secnum]; //jff 3/2/98 woops! better do this
+
+  // the two-sided lines are listed, unless the old demo exit is needed
+  if (!comp[comp_model] && !demo_compatibility)
+  {
+    for (i = 0; i < sec->twosidedcount; i++)
+    {
+      line_t *line = sec->twosided[i];
+      sector_t *other = sides[line->sidenum[0]].sector;
+
+      if (other-sectors == secnum)
+          other = sides[line->sidenum[1]].sector;
+      if (other->ceilingheight == ceildestheight)
+        return other;
+    }
+    return NULL;
+  }
+
   //jff 5/23/98 don't disturb sec->linecount while searching
   // but allow early exit in old demos
   linecount = sec->linecount;
@@ -753,53 +835,136 @@ sector_t *P_FindModelCeilingSector(fixed_t ceildestheight,int secnum)
 // RETURN NEXT SECTOR # THAT LINE TAG REFERS TO
 //
 
+// Tag index: the sectors (or linedefs) sharing a tag are stored together in
+// list[], in ascending order and ended by -1, and an open-addressed table on
+// the tag finds a group's start. pos[i] is where i itself sits in list[], so
+// stepping to the next sector or linedef with the same tag is one array read.
+
+typedef struct
+{
+  int tag;
+  int first;    // start of the group in list[], -1 if the slot is empty
+  int count;
+} tagslot_t;
+
+typedef struct
+{
+  tagslot_t *slots;
+  unsigned mask;
+  int *list;
+  int *pos;
+} tagindex_t;
+
+static tagindex_t sectortags, linetags;
+
+static const int notagged = -1;
+
+static tagslot_t *P_TagSlot(const tagindex_t *index, int tag)
+{
+  unsigned i = (unsigned) tag & index->mask;
+
+  while (index->slots[i].first >= 0 && index->slots[i].tag != tag)
+    i = (i + 1) & index->mask;
+  return &index->slots[i];
+}
+
+static const int *P_TaggedList(const tagindex_t *index, int tag)
+{
+  const tagslot_t *slot = P_TagSlot(index, tag);
+
+  return slot->first >= 0 ? index->list + slot->first : &notagged;
+}
+
 // Find the next sector with the same tag as a linedef.
-// Rewritten by Lee Killough to use chained hashing to improve speed
+// killough's hash chains are now the tag index above.
+// A start outside the tag's group ends the search, as the old chains did.
 
 int P_FindSectorFromLineTag(const line_t *line, int start)
 {
-  start = start >= 0 ? sectors[start].nexttag :
-    sectors[(unsigned) line->tag % (unsigned) numsectors].firsttag;
-  while (start >= 0 && sectors[start].tag != line->tag)
-    start = sectors[start].nexttag;
-  return start;
+  if (start < 0)
+    return *P_TaggedList(&sectortags, line->tag);
+  return sectors[start].tag == line->tag ?
+    sectortags.list[sectortags.pos[start] + 1] : -1;
 }
 
 // killough 4/16/98: Same thing, only for linedefs
 
 int P_FindLineFromLineTag(const line_t *line, int start)
 {
-  start = start >= 0 ? lines[start].nexttag :
-    lines[(unsigned) line->tag % (unsigned) numlines].firsttag;
-  while (start >= 0 && lines[start].tag != line->tag)
-    start = lines[start].nexttag;
-  return start;
+  if (start < 0)
+    return *P_TaggedList(&linetags, line->tag);
+  return lines[start].tag == line->tag ?
+    linetags.list[linetags.pos[start] + 1] : -1;
 }
 
-// Hash the sector tags across the sectors and linedefs.
-static void P_InitTagLists(void)
+// All the sectors tagged the same as a linedef, ascending and ended by -1,
+// for handlers that walk the whole group.
+
+const int *P_SectorsFromLineTag(const line_t *line)
 {
-  register int i;
+  return P_TaggedList(&sectortags, line->tag);
+}
+
+// Builds an index over n entries; on entry pos[i] holds the tag of entry i.
+static void P_BuildTagIndex(tagindex_t *index, int n)
+{
+  unsigned size = 2;
+  int i, total = 0;
+
+  while (size < 2u * (unsigned) n)
+    size <<= 1;
+  index->mask = size - 1;
+  index->slots = Z_Malloc(size * sizeof *index->slots, PU_LEVEL, 0);
+  for (i = 0; i < (int) size; i++)
+    index->slots[i].first = -1;
 
-  for (i=numsectors; --i>=0; )        // Initially make all slots empty.
-    sectors[i].firsttag = -1;
-  for (i=numsectors; --i>=0; )        // Proceed from last to first sector
-    {                                 // so that lower sectors appear first
-      int j = (unsigned) sectors[i].tag % (unsigned) numsectors; // Hash func
-      sectors[i].nexttag = sectors[j].firsttag;   // Prepend sector to chain
-      sectors[j].firsttag = i;
+  for (i = 0; i < n; i++)       // count each tag's group
+    {
+      tagslot_t *slot = P_TagSlot(index, index->pos[i]);
+      if (slot->first < 0)
+        {
+          slot->tag = index->pos[i];
+          slot->first = slot->count = 0;
+        }
+      slot->count++;
     }
 
-  // killough 4/17/98: same thing, only for linedefs
+  for (i = 0; i < (int) size; i++)  // lay the groups out, each ended by -1
+    if (index->slots[i].first >= 0)
+      {
+        index->slots[i].first = total;
+        total += index->slots[i].count + 1;
+        index->slots[i].count = 0;
+      }
 
-  for (i=numlines; --i>=0; )        // Initially make all slots empty.
-    lines[i].firsttag = -1;
-  for (i=numlines; --i>=0; )        // Proceed from last to first linedef
-    {                               // so that lower linedefs appear first
-      int j = (unsigned) lines[i].tag % (unsigned) numlines; // Hash func
-      lines[i].nexttag = lines[j].firsttag;   // Prepend linedef to chain
-      lines[j].firsttag = i;
+  index->list = Z_Malloc(total * sizeof *index->list, PU_LEVEL, 0);
+  for (i = 0; i < n; i++)       // ascending, so lower entries appear first
+    {
+      tagslot_t *slot = P_TagSlot(index, index->pos[i]);
+      index->pos[i] = slot->first + slot->count++;
+      index->list[index->pos[i]] = i;
     }
+  for (i = 0; i < (int) size; i++)
+    if (index->slots[i].first >= 0)
+      index->list[index->slots[i].first + index->slots[i].count] = -1;
+}
+
+// Index the sector tags across the sectors and linedefs.
+static void P_InitTagLists(void)
+{
+  int i;
+
+  sectortags.pos = Z_Malloc(numsectors * sizeof *sectortags.pos, PU_LEVEL, 0);
+  for (i = 0; i < numsectors; i++)
+    sectortags.pos[i] = sectors[i].tag;
+  P_BuildTagIndex(&sectortags, numsectors);
+
+  // killough 4/17/98: same thing, only for linedefs
+
+  linetags.pos = Z_Malloc(numlines * sizeof *linetags.pos, PU_LEVEL, 0);
+  for (i = 0; i < numlines; i++)
+    linetags.pos[i] = lines[i].tag;
+  P_BuildTagIndex(&linetags, numlines);
 }
 
 //
@@ -813,23 +978,15 @@ int P_FindMinSurroundingLight
 ( sector_t*     sector,
   int           max )
 {
-  int         i;
+  int         i, n;
   int         min;
-  line_t*     line;
-  sector_t*   check;
+  sector_t**  check;
 
   min = max;
-  for (i=0 ; i < sector->linecount ; i++)
-  {
-    line = sector->lines[i];
-    check = getNextSector(line,sector);
-
-    if (!check)
-      continue;
-
-    if (check->lightlevel < min)
-      min = check->lightlevel;
-  }
+  n = P_SurroundingSectors(sector, &check);
+  for (i=0 ; i < n ; i++)
+    if (check[i]->lightlevel < min)
+      min = check[i]->lightlevel;
   return min;
 }
 
@@ -1151,6 +1308,8 @@ void P_CrossSpecialLine(line_t *line, int side, mobj_t *thing)
 {
   int         ok;
 
+  P_MarkLineDirty(line);  // many types clear their special below
+
   //  Things that should never trigger lines
   if (!thing->player)
   {
@@ -1173,79 +1332,33 @@ void P_CrossSpecialLine(line_t *line, int side, mobj_t *thing)
   //jff 02/04/98 add check here for generalized lindef types
   if (!demo_compatibility) // generalized types not recognized if old demo
   {
-    // pointer to line function is NULL by default, set non-null if
-    // line special is walkover generalized linedef type
-    int (*linefunc)(line_t *line)=NULL;
+    int type = P_GenLineType(line->special);
 
-    // check each range of generalized linedefs
-    if ((unsigned)line->special >= GenEnd)
-    {
-      // Out of range for GenFloors
-    }
-    else if ((unsigned)line->special >= GenFloorBase)
-    {
-      if (!thing->player)
-        if ((line->special & FloorChange) || !(line->special & FloorModel))
-          return;     // FloorModel is "Allow Monsters" if FloorChange is 0
-      if (!line->tag) //jff 2/27/98 all walk generalized types require tag
-        return;
-      linefunc = EV_DoGenFloor;
-    }
-    else if ((unsigned)line->special >= GenCeilingBase)
-    {
-      if (!thing->player)
-        if ((line->special & CeilingChange) || !(line->special & CeilingModel))
-          return;     // CeilingModel is "Allow Monsters" if CeilingChange is 0
-      if (!line->tag) //jff 2/27/98 all walk generalized types require tag
-        return;
-      linefunc = EV_DoGenCeiling;
-    }
-    else if ((unsigned)line->special >= GenDoorBase)
+    // look up the generalized class; walkover crushers are not dispatched
+    if ((type & GenLineClass) != GenNone && (type & GenLineClass) != GenCrusher)
     {
+      int (*linefunc)(line_t *line) = genlinefuncs[type & GenLineClass];
+
       if (!thing->player)
       {
-        if (!(line->special & DoorMonster))
-          return;                    // monsters disallowed from this door
-        if (line->flags & ML_SECRET) // they can't open secret doors either
-          return;
+        if (!(type & GenLineMonsters))
+          return;                    // monsters disallowed from this type
+        if ((type & GenLineClass) == GenDoor && line->flags & ML_SECRET)
+          return;                    // they can't open secret doors either
       }
-      if (!line->tag) //3/2/98 move outside the monster check
-        return;
-      linefunc = EV_DoGenDoor;
-    }
-    else if ((unsigned)line->special >= GenLockedBase)
-    {
-      if (!thing->player)
-        return;                     // monsters disallowed from unlocking doors
-      if (((line->special&TriggerType)==WalkOnce) || ((line->special&TriggerType)==WalkMany))
-      { //jff 4/1/98 check for being a walk type before reporting door type
-        if (!P_CanUnlockGenDoor(line,thing->player))
+      if ((type & GenLineClass) == GenLocked)
+      {
+        if (((line->special&TriggerType)==WalkOnce) || ((line->special&TriggerType)==WalkMany))
+        { //jff 4/1/98 check for being a walk type before reporting door type
+          if (!P_CanUnlockGenDoor(line,thing->player))
+            return;
+        }
+        else
           return;
       }
-      else
-        return;
-      linefunc = EV_DoGenLockedDoor;
-    }
-    else if ((unsigned)line->special >= GenLiftBase)
-    {
-      if (!thing->player)
-        if (!(line->special & LiftMonster))
-          return; // monsters disallowed
-      if (!line->tag) //jff 2/27/98 all walk generalized types require tag
+      else if (!line->tag) //jff 2/27/98 all walk generalized types require tag
         return;
-      linefunc = EV_DoGenLift;
-    }
-    else if ((unsigned)line->special >= GenStairsBase)
-    {
-      if (!thing->player)
-        if (!(line->special & StairMonster))
-          return; // monsters disallowed
-      if (!line->tag) //jff 2/27/98 all walk generalized types require tag
-        return;
-      linefunc = EV_DoGenStairs;
-    }
 
-    if (linefunc) // if it was a valid generalized type
       switch((line->special & TriggerType) >> TriggerTypeShift)
       {
         case WalkOnce:
@@ -1258,6 +1371,7 @@ void P_CrossSpecialLine(line_t *line, int side, mobj_t *thing)
         default:                  // if not a walk type, do nothing here
           return;
       }
+    }
   }
 
   if (!thing->player)
@@ -2043,93 +2157,38 @@ void P_ShootSpecialLine
 ( mobj_t*       thing,
   line_t*       line )
 {
+  P_MarkLineDirty(line);  // many types clear their special below
+
   //jff 02/04/98 add check here for generalized linedef
   if (!demo_compatibility)
   {
-    // pointer to line function is NULL by default, set non-null if
-    // line special is gun triggered generalized linedef type
-    int (*linefunc)(line_t *line)=NULL;
+    int type = P_GenLineType(line->special);
 
-    // check each range of generalized linedefs
-    if ((unsigned)line->special >= GenEnd)
-    {
-      // Out of range for GenFloors
-    }
-    else if ((unsigned)line->special >= GenFloorBase)
+    if ((type & GenLineClass) != GenNone)
     {
-      if (!thing->player)
-        if ((line->special & FloorChange) || !(line->special & FloorModel))
-          return;   // FloorModel is "Allow Monsters" if FloorChange is 0
-      if (!line->tag) //jff 2/27/98 all gun generalized types require tag
-        return;
+      int (*linefunc)(line_t *line) = genlinefuncs[type & GenLineClass];
 
-      linefunc = EV_DoGenFloor;
-    }
-    else if ((unsigned)line->special >= GenCeilingBase)
-    {
-      if (!thing->player)
-        if ((line->special & CeilingChange) || !(line->special & CeilingModel))
-          return;   // CeilingModel is "Allow Monsters" if CeilingChange is 0
-      if (!line->tag) //jff 2/27/98 all gun generalized types require tag
-        return;
-      linefunc = EV_DoGenCeiling;
-    }
-    else if ((unsigned)line->special >= GenDoorBase)
-    {
       if (!thing->player)
       {
-        if (!(line->special & DoorMonster))
-          return;   // monsters disallowed from this door
-        if (line->flags & ML_SECRET) // they can't open secret doors either
-          return;
+        if (!(type & GenLineMonsters))
+          return;   // monsters disallowed from this type
+        if ((type & GenLineClass) == GenDoor && line->flags & ML_SECRET)
+          return;   // they can't open secret doors either
       }
-      if (!line->tag) //jff 3/2/98 all gun generalized types require tag
-        return;
-      linefunc = EV_DoGenDoor;
-    }
-    else if ((unsigned)line->special >= GenLockedBase)
-    {
-      if (!thing->player)
-        return;   // monsters disallowed from unlocking doors
-      if (((line->special&TriggerType)==GunOnce) || ((line->special&TriggerType)==GunMany))
-      { //jff 4/1/98 check for being a gun type before reporting door type
-        if (!P_CanUnlockGenDoor(line,thing->player))
+      if ((type & GenLineClass) == GenLocked)
+      {
+        if (((line->special&TriggerType)==GunOnce) || ((line->special&TriggerType)==GunMany))
+        { //jff 4/1/98 check for being a gun type before reporting door type
+          if (!P_CanUnlockGenDoor(line,thing->player))
+            return;
+        }
+        else
           return;
       }
-      else
-        return;
-      if (!line->tag) //jff 2/27/98 all gun generalized types require tag
-        return;
-
-      linefunc = EV_DoGenLockedDoor;
-    }
-    else if ((unsigned)line->special >= GenLiftBase)
-    {
-      if (!thing->player)
-        if (!(line->special & LiftMonster))
-          return; // monsters disallowed
-      linefunc = EV_DoGenLift;
-    }
-    else if ((unsigned)line->special >= GenStairsBase)
-    {
-      if (!thing->player)
-        if (!(line->special & StairMonster))
-          return; // monsters disallowed
-      if (!line->tag) //jff 2/27/98 all gun generalized types require tag
+      // jff 2/27/98 all gun generalized types but lifts require tag
+      if (!line->tag && (type & GenLineClass) != GenLift)
         return;
-      linefunc = EV_DoGenStairs;
-    }
-    else if ((unsigned)line->special >= GenCrusherBase)
-    {
-      if (!thing->player)
-        if (!(line->special & StairMonster))
-          return; // monsters disallowed
-      if (!line->tag) //jff 2/27/98 all gun generalized types require tag
-        return;
-      linefunc = EV_DoGenCrusher;
-    }
 
-    if (linefunc)
       switch((line->special & TriggerType) >> TriggerTypeShift)
       {
         case GunOnce:
@@ -2143,6 +2202,7 @@ void P_ShootSpecialLine
         default:  // if not a gun type, do nothing here
           return;
       }
+    }
   }
 
   // Impacts that other things can activate.
@@ -2269,6 +2329,7 @@ void P_PlayerInSpecialSector (player_t* player)
         // Tally player in secret sector, clear secret special
         player->secretcount++;
         sector->special = 0;
+        P_MarkSectorDirty(sector);
         break;
 
       case 11:
@@ -2319,6 +2380,7 @@ void P_PlayerInSpecialSector (player_t* player)
       sector->special &= ~SECRET_MASK;
       if (sector->special<32) // if all extended bits clear,
         sector->special=0;    // sector is not special anymore
+      P_MarkSectorDirty(sector);
     }
 
     // phares 3/19/98:
@@ -2344,6 +2406,7 @@ void P_PlayerInSpecialSector (player_t* player)
 
 static dbool  levelTimer;
 static int      levelTimeCount;
+static int      nextanimtic = INT_MIN; // first leveltime any anim steps on
 dbool         levelFragLimit;      // Ty 03/18/98 Added -frags support
 int             levelFragLimitCount; // Ty 03/18/98 Added -frags support
 
@@ -2352,6 +2415,7 @@ void P_UpdateSpecials (void)
   anim_t*     anim;
   int         pic;
   int         i;
+  dbool       rewritten;
 
   // Downcount level timer, exit level if elapsed
   if (levelTimer == TRUE)
@@ -2384,55 +2448,83 @@ void P_UpdateSpecials (void)
   }
 
   // Animate flats and textures globally
-  for (anim = anims ; anim < lastanim ; anim++)
+  // Each animation's pics are only rewritten on the tics it advances,
+  // and after any earlier one was rewritten if it shares pics with it,
+  // so that the later animation still has the last word on them.
+  // Between the tics any animation advances on nothing changes, so the
+  // list is only walked from the earliest of them.
+  if (leveltime >= nextanimtic)
   {
-    for (i=anim->basepic ; i<anim->basepic+anim->numpics ; i++)
+    rewritten = FALSE;
+    nextanimtic = INT_MAX;
+    for (anim = anims ; anim < lastanim ; anim++)
     {
-      pic = anim->basepic + ( (leveltime/anim->speed + i)%anim->numpics );
-      if (anim->istexture)
-        texturetranslation[i] = pic;
-      else
-        flattranslation[i] = pic;
+      int step = leveltime/anim->speed;
+
+      if ((step+1)*anim->speed < nextanimtic)
+        nextanimtic = (step+1)*anim->speed;
+      if (step == anim->step && !(anim->overlaps && rewritten))
+        continue;
+      anim->step = step;
+      rewritten = TRUE;
+      for (i=anim->basepic ; i<anim->basepic+anim->numpics ; i++)
+      {
+        pic = anim->basepic + ( (step + i)%anim->numpics );
+        if (anim->istexture)
+          texturetranslation[i] = pic;
+        else
+          flattranslation[i] = pic;
+      }
     }
   }
 
   // Check buttons (retriggerable switches) and change texture on timeout
-  for (i = 0; i < MAXBUTTONS; i++)
-    if (buttonlist[i].btimer)
+  // Buttons pop out in buttonlist order on the tic before their btimer,
+  // and the list is only walked on the tics one of them does.
+  if (leveltime + 1 >= buttonpoptic)
+  {
+    buttonpoptic = INT_MAX;
+    for (i = 0; i < MAXBUTTONS; i++)
     {
-      buttonlist[i].btimer--;
       if (!buttonlist[i].btimer)
+        continue;
+      if (buttonlist[i].btimer > leveltime + 1)
       {
-        switch(buttonlist[i].where)
-        {
-          case SWTCH_TOP:
-            sides[buttonlist[i].line->sidenum[0]].toptexture =
-              buttonlist[i].btexture;
-            break;
+        if (buttonlist[i].btimer < buttonpoptic)
+          buttonpoptic = buttonlist[i].btimer;
+        continue;
+      }
+      switch(buttonlist[i].where)
+      {
+        case SWTCH_TOP:
+          sides[buttonlist[i].line->sidenum[0]].toptexture =
+            buttonlist[i].btexture;
+          break;
 
-          case SWTCH_MIDDLE:
-            sides[buttonlist[i].line->sidenum[0]].midtexture =
-              buttonlist[i].btexture;
-            break;
+        case SWTCH_MIDDLE:
+          sides[buttonlist[i].line->sidenum[0]].midtexture =
+            buttonlist[i].btexture;
+          break;
 
-          case SWTCH_BOTTOM:
-            sides[buttonlist[i].line->sidenum[0]].bottomtexture =
-              buttonlist[i].btexture;
-            break;
-        }
-        {
-          /* don't take the address of the switch's sound origin,
-           * unless in a compatibility mode. */
-          mobj_t *so = (mobj_t *)buttonlist[i].soundorg;
-          if (comp[comp_sound] || compatibility_level < prboom_6_compatibility)
-            /* since the buttonlist array is usually zeroed out,
-             * button popouts generally appear to come from (0,0) */
-            so = (mobj_t *)&buttonlist[i].soundorg;
-          S_StartSound(so, sfx_swtchn);
-        }
-        memset(&buttonlist[i],0,sizeof(button_t));
+        case SWTCH_BOTTOM:
+          sides[buttonlist[i].line->sidenum[0]].bottomtexture =
+            buttonlist[i].btexture;
+          break;
       }
+      P_MarkSideDirty(&sides[buttonlist[i].line->sidenum[0]]);
+      {
+        /* don't take the address of the switch's sound origin,
+         * unless in a compatibility mode. */
+        mobj_t *so = (mobj_t *)buttonlist[i].soundorg;
+        if (comp[comp_sound] || compatibility_level < prboom_6_compatibility)
+          /* since the buttonlist array is usually zeroed out,
+           * button popouts generally appear to come from (0,0) */
+          so = (mobj_t *)&buttonlist[i].soundorg;
+        S_StartSound(so, sfx_swtchn);
+      }
+      memset(&buttonlist[i],0,sizeof(button_t));
     }
+  }
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -2568,6 +2660,11 @@ void P_SpawnSpecials (void)
 
   for (i = 0;i < MAXBUTTONS;i++)
     memset(&buttonlist[i],0,sizeof(button_t));
+  buttonpoptic = INT_MAX;
+
+  // leveltime starts over (or is restored by a savegame after this), so
+  // walk the animations on the first tic to bring them all up to it
+  nextanimtic = INT_MIN;
 
   // P_InitTagLists() must be called before P_FindSectorFromLineTag()
   // or P_FindLineFromLineTag() can be called.
@@ -2626,6 +2723,131 @@ void P_SpawnSpecials (void)
    }
 }
 
+//
+// Scroller and pusher runs
+//
+// Scrollers and pushers are spawned back to back, so each kind sits in
+// one unbroken run on the thinker list, with nothing else run between
+// its first thinker and its last. The whole run is done when the walk
+// reaches its first thinker, and the rest are passed over as the walk
+// reaches them. That lets the carriers of one sector add up their
+// pushes and walk its things once, and the pushers of one sector share
+// one pass over its things or one gather from the blockmap. Momentum
+// and texture offsets only ever have amounts added to them here, and
+// nothing the effects test changes until the run is over, so this is
+// exact, demos included. A scroller or pusher found anywhere else on
+// the list still runs by itself.
+//
+
+typedef struct
+{
+  dbool found;              // looked for since P_ClearThinkerRuns
+  thinker_t **thinkers;     // the run, in thinker order
+  int *group;               // each one's group, or -1 if not grouped
+  int num, max;
+  int *affectees;           // the sector each group affects
+  int *members;             // the grouped thinkers, group by group
+  int *firstmember;         // where each group starts in members
+  fixed_t (*sum)[2];        // a group's carry this tic, for scrollers
+  int numgroups;
+  int next;                 // the member the walk should reach next
+} thinkerrun_t;
+
+static thinkerrun_t scrollrun, pushrun;
+
+void P_ClearThinkerRuns(void)
+{
+  scrollrun.found = pushrun.found = FALSE;
+}
+
+//
+// P_FindThinkerRun
+// Collects the run that starts at first. affectee gives the sector a
+// thinker is grouped by, or -1 if it is to be run by itself.
+//
+
+static void P_FindThinkerRun(thinkerrun_t *run, thinker_t *first,
+                             int affectee(thinker_t *))
+{
+  int *groupof = malloc(numsectors * sizeof *groupof);
+  thinker_t *th;
+  int i, g;
+
+  for (i = 0; i < numsectors; i++)
+    groupof[i] = -1;
+
+  run->num = run->numgroups = 0;
+  for (th = first; th != &thinkercap && th->function == first->function;
+       th = th->next)
+    {
+      int sec = affectee(th);
+
+      if (run->num == run->max)
+        {
+          run->max = run->max ? run->max*2 : 64;
+          run->thinkers = realloc(run->thinkers, run->max * sizeof *run->thinkers);
+          run->group = realloc(run->group, run->max * sizeof *run->group);
+          run->affectees = realloc(run->affectees, run->max * sizeof *run->affectees);
+          run->members = realloc(run->members, run->max * sizeof *run->members);
+          run->firstmember = realloc(run->firstmember,
+                                     (run->max + 1) * sizeof *run->firstmember);
+          run->sum = realloc(run->sum, run->max * sizeof *run->sum);
+        }
+      if (sec >= 0 && groupof[sec] < 0)
+        {
+          groupof[sec] = run->numgroups;
+          run->affectees[run->numgroups++] = sec;
+        }
+      run->thinkers[run->num] = th;
+      run->group[run->num++] = sec >= 0 ? groupof[sec] : -1;
+    }
+  free(groupof);
+
+  // lay the members out group by group, each group in thinker order
+
+  for (g = 0; g <= run->numgroups; g++)
+    run->firstmember[g] = 0;
+  for (i = 0; i < run->num; i++)
+    if ((g = run->group[i]) >= 0)
+      run->firstmember[g + 1]++;
+  for (g = 0; g < run->numgroups; g++)
+    run->firstmember[g + 1] += run->firstmember[g];
+  for (i = 0; i < run->num; i++)        // leaves each start at its end
+    if ((g = run->group[i]) >= 0)
+      run->members[run->firstmember[g]++] = i;
+  for (g = run->numgroups; g > 0; g--)
+    run->firstmember[g] = run->firstmember[g - 1];
+  run->firstmember[0] = 0;
+  run->found = TRUE;
+}
+//
+// P_ReachThinkerRun
+// Called as the walk reaches th. Returns TRUE if th is in the run, in
+// which case the caller is done: the run's first thinker runs the lot
+// through runall, and the others have already been run by it.
+//
+
+static dbool P_ReachThinkerRun(thinkerrun_t *run, thinker_t *th,
+                               int affectee(thinker_t *),
+                               void runall(void))
+{
+  if (!run->found)
+    P_FindThinkerRun(run, th, affectee);
+
+  if (th == run->thinkers[0])
+    {
+      run->next = 1;
+      runall();
+      return TRUE;
+    }
+  if (run->next < run->num && th == run->thinkers[run->next])
+    {
+      run->next++;
+      return TRUE;
+    }
+  return FALSE;
+}
+
 // killough 2/28/98:
 //
 // This function, with the help of r_plane.c and r_bsp.c, supports generalized
@@ -2645,7 +2867,14 @@ void P_SpawnSpecials (void)
 // This is the main scrolling code
 // killough 3/7/98
 
-void T_Scroll(scroll_t *s)
+//
+// P_ScrollAmount
+// Works out how far scroller s moves things this tic, keeping its
+// control height and accelerated speed up to date. Returns FALSE if it
+// moves nothing.
+//
+
+static dbool P_ScrollAmount(scroll_t *s, fixed_t *pdx, fixed_t *pdy)
 {
   fixed_t dx = s->dx, dy = s->dy;
 
@@ -2666,21 +2895,49 @@ void T_Scroll(scroll_t *s)
       s->vdy = dy += s->vdy;
     }
 
-  if (!(dx | dy))                   // no-op if both (x,y) offsets 0
-    return;
+  *pdx = dx;
+  *pdy = dy;
+  return (dx | dy) != 0;            // no-op if both (x,y) offsets 0
+}
+
+static void P_CarryThings(sector_t *sec, fixed_t dx, fixed_t dy)
+{
+  // killough 3/7/98: Carry things on floor
+  // killough 3/20/98: use new sector list which reflects TRUE members
+  // killough 3/27/98: fix carrier bug
+  // killough 4/4/98: Underwater, carry things even w/o gravity
+
+  fixed_t height = sec->floorheight;
+  fixed_t waterheight = sec->heightsec != -1 &&   // killough 4/4/98
+    sectors[sec->heightsec].floorheight > height ?
+    sectors[sec->heightsec].floorheight : INT_MIN;
+  msecnode_t *node;
+  mobj_t *thing;
+
+  for (node = sec->touching_thinglist; node; node = SN_SNEXT(node))
+    if (!((thing = node->m_thing)->flags & MF_NOCLIP) &&
+        (!(thing->flags & MF_NOGRAVITY || thing->z > height) ||
+         thing->z < waterheight))
+      {
+        // Move objects only if on floor or underwater,
+        // non-floating, and clipped.
+        thing->momx += dx;
+        thing->momy += dy;
+      }
+}
 
+static void P_ScrollBy(scroll_t *s, fixed_t dx, fixed_t dy)
+{
   switch (s->type)
     {
       side_t *side;
       sector_t *sec;
-      fixed_t height, waterheight;  // killough 4/4/98: add waterheight
-      msecnode_t *node;
-      mobj_t *thing;
 
     case sc_side:                   // killough 3/7/98: Scroll wall texture
         side = sides + s->affectee;
         side->textureoffset += dx;
         side->rowoffset += dy;
+        P_MarkSideDirty(side);
         break;
 
     case sc_floor:                  // killough 3/7/98: Scroll floor texture
@@ -2696,28 +2953,7 @@ void T_Scroll(scroll_t *s)
         break;
 
     case sc_carry:
-
-      // killough 3/7/98: Carry things on floor
-      // killough 3/20/98: use new sector list which reflects TRUE members
-      // killough 3/27/98: fix carrier bug
-      // killough 4/4/98: Underwater, carry things even w/o gravity
-
-      sec = sectors + s->affectee;
-      height = sec->floorheight;
-      waterheight = sec->heightsec != -1 &&
-        sectors[sec->heightsec].floorheight > height ?
-        sectors[sec->heightsec].floorheight : INT_MIN;
-
-      for (node = sec->touching_thinglist; node; node = node->m_snext)
-        if (!((thing = node->m_thing)->flags & MF_NOCLIP) &&
-            (!(thing->flags & MF_NOGRAVITY || thing->z > height) ||
-             thing->z < waterheight))
-          {
-            // Move objects only if on floor or underwater,
-            // non-floating, and clipped.
-            thing->momx += dx;
-            thing->momy += dy;
-          }
+      P_CarryThings(sectors + s->affectee, dx, dy);
       break;
 
     case sc_carry_ceiling:       // to be added later
@@ -2725,6 +2961,55 @@ void T_Scroll(scroll_t *s)
     }
 }
 
+// Carriers are grouped by the sector they carry things in
+
+static int P_ScrollerGroup(thinker_t *th)
+{
+  scroll_t *s = (scroll_t *) th;
+
+  return s->type == sc_carry ? s->affectee : -1;
+}
+
+static void P_RunScrollers(void)
+{
+  int i;
+
+  memset(scrollrun.sum, 0, scrollrun.numgroups * sizeof *scrollrun.sum);
+  for (i = 0; i < scrollrun.num; i++)
+    {
+      scroll_t *s = (scroll_t *) scrollrun.thinkers[i];
+      int g = scrollrun.group[i];
+      fixed_t dx, dy;
+
+      if (!P_ScrollAmount(s, &dx, &dy))
+        continue;
+      if (g < 0)
+        P_ScrollBy(s, dx, dy);
+      else
+        {
+          scrollrun.sum[g][0] += dx;
+          scrollrun.sum[g][1] += dy;
+        }
+    }
+
+  for (i = 0; i < scrollrun.numgroups; i++)
+    if (scrollrun.sum[i][0] | scrollrun.sum[i][1])
+      P_CarryThings(sectors + scrollrun.affectees[i],
+                    scrollrun.sum[i][0], scrollrun.sum[i][1]);
+}
+
+void T_Scroll(scroll_t *s)
+{
+  fixed_t dx, dy;
+
+  if (P_ReachThinkerRun(&scrollrun, &s->thinker, P_ScrollerGroup,
+                        P_RunScrollers))
+    return;
+
+  if (P_ScrollAmount(s, &dx, &dy))
+    P_ScrollBy(s, dx, dy);
+}
+
 //
 // Add_Scroller()
 //
@@ -2949,7 +3234,7 @@ void T_Friction(friction_t *f)
                 thing->movefactor = f->movefactor;
                 }
             }
-        node = node->m_snext;
+        node = SN_SNEXT(node);
         }
 }
 
@@ -3063,6 +3348,7 @@ static void P_SpawnFriction(void)
             sectors[s].movefactor = movefactor;
           }
       }
+  P_FrictionChanged();
 }
 
 //
@@ -3200,6 +3486,231 @@ static dbool PIT_PushThing(mobj_t* thing)
   return TRUE;
 }
 
+// Sets up tmpusher and tmbbox for point pusher p, and finds the
+// blocks its force reaches.
+
+static void P_PointPushRange(pusher_t *p, int *xl, int *xh, int *yl, int *yh)
+{
+    int radius = p->radius; // where force goes to zero
+
+    tmpusher = p; // MT_PUSH/MT_PULL point source
+    tmbbox[BOXTOP]    = p->y + radius;
+    tmbbox[BOXBOTTOM] = p->y - radius;
+    tmbbox[BOXRIGHT]  = p->x + radius;
+    tmbbox[BOXLEFT]   = p->x - radius;
+
+    *xl = (tmbbox[BOXLEFT] - bmaporgx - MAXRADIUS)>>MAPBLOCKSHIFT;
+    *xh = (tmbbox[BOXRIGHT] - bmaporgx + MAXRADIUS)>>MAPBLOCKSHIFT;
+    *yl = (tmbbox[BOXBOTTOM] - bmaporgy - MAXRADIUS)>>MAPBLOCKSHIFT;
+    *yh = (tmbbox[BOXTOP] - bmaporgy + MAXRADIUS)>>MAPBLOCKSHIFT;
+}
+
+/////////////////////////////
+//
+// P_PointPush pushes or pulls everything within the force radius of
+// point pusher p. Crosses sectors, so use blockmap.
+//
+
+static void P_PointPush(pusher_t *p)
+{
+    int xl,xh,yl,yh,bx,by;
+
+    P_PointPushRange(p, &xl, &xh, &yl, &yh);
+    for (bx=xl ; bx<=xh ; bx++)
+        for (by=yl ; by<=yh ; by++)
+            P_BlockThingsIterator(bx,by,PIT_PushThing);
+}
+
+/////////////////////////////
+//
+// P_ConstantPush applies wind or current p to thing, which is touching
+// sector sec.
+//
+
+static void P_ConstantPush(pusher_t *p, sector_t *sec, mobj_t *thing)
+{
+    int xspeed,yspeed;
+    int ht = 0;
+
+    if (sec->heightsec != -1) // special water sector?
+        ht = sectors[sec->heightsec].floorheight;
+    if (p->type == p_wind)
+        {
+        if (sec->heightsec == -1) // NOT special water sector
+            if (thing->z > thing->floorz) // above ground
+                {
+                xspeed = p->x_mag; // full force
+                yspeed = p->y_mag;
+                }
+            else // on ground
+                {
+                xspeed = (p->x_mag)>>1; // half force
+                yspeed = (p->y_mag)>>1;
+                }
+        else // special water sector
+            {
+            if (thing->z > ht) // above ground
+                {
+                xspeed = p->x_mag; // full force
+                yspeed = p->y_mag;
+                }
+            else if (thing->player->viewz < ht) // underwater
+                xspeed = yspeed = 0; // no force
+            else // wading in water
+                {
+                xspeed = (p->x_mag)>>1; // half force
+                yspeed = (p->y_mag)>>1;
+                }
+            }
+        }
+    else // p_current
+        {
+        if (sec->heightsec == -1) // NOT special water sector
+            if (thing->z > sec->floorheight) // above ground
+                xspeed = yspeed = 0; // no force
+            else // on ground
+                {
+                xspeed = p->x_mag; // full force
+                yspeed = p->y_mag;
+                }
+        else // special water sector
+            if (thing->z > ht) // above ground
+                xspeed = yspeed = 0; // no force
+            else // underwater
+                {
+                xspeed = p->x_mag; // full force
+                yspeed = p->y_mag;
+                }
+        }
+    thing->momx += xspeed<<(FRACBITS-PUSH_FACTOR);
+    thing->momy += yspeed<<(FRACBITS-PUSH_FACTOR);
+}
+
+// Pushers are grouped by the sector they affect
+
+static int P_PusherGroup(thinker_t *th)
+{
+    return ((pusher_t *) th)->affectee;
+}
+
+static mobj_t **pushthings;   // things gathered for a sector's point pushers
+static int numpushthings, maxpushthings;
+
+static dbool PIT_GatherPushThing(mobj_t* thing)
+{
+    if (numpushthings == maxpushthings)
+        {
+        maxpushthings = maxpushthings ? maxpushthings*2 : 128;
+        pushthings = realloc(pushthings, maxpushthings * sizeof *pushthings);
+        }
+    pushthings[numpushthings++] = thing;
+    return TRUE;
+}
+
+//
+// P_PointPushGroup runs several point pushers of one sector off one
+// gather from the blockmap, covering all their ranges. Each thing is in
+// one block, so each pusher still sees just the things in its own.
+//
+
+static void P_PointPushGroup(const int *members, int num)
+{
+    int xl = INT_MAX, xh = INT_MIN, yl = INT_MAX, yh = INT_MIN;
+    int i, j, bx, by;
+
+    for (i = 0; i < num; i++)
+        {
+        pusher_t *p = (pusher_t *) pushrun.thinkers[members[i]];
+        int pxl,pxh,pyl,pyh;
+
+        if (p->type != p_push)
+            continue;
+        P_PointPushRange(p, &pxl, &pxh, &pyl, &pyh);
+        if (pxl < xl) xl = pxl;
+        if (pxh > xh) xh = pxh;
+        if (pyl < yl) yl = pyl;
+        if (pyh > yh) yh = pyh;
+        }
+
+    numpushthings = 0;
+    for (bx=xl ; bx<=xh ; bx++)
+        for (by=yl ; by<=yh ; by++)
+            P_BlockThingsIterator(bx,by,PIT_GatherPushThing);
+
+    for (i = 0; i < num; i++)
+        {
+        pusher_t *p = (pusher_t *) pushrun.thinkers[members[i]];
+        int pxl,pxh,pyl,pyh;
+
+        if (p->type != p_push)
+            continue;
+        P_PointPushRange(p, &pxl, &pxh, &pyl, &pyh);
+        for (j = 0; j < numpushthings; j++)
+            {
+            int cell = pushthings[j]->blockcell - blockthings;
+
+            bx = cell % bmapwidth;
+            by = cell / bmapwidth;
+            if (bx >= pxl && bx <= pxh && by >= pyl && by <= pyh)
+                PIT_PushThing(pushthings[j]);
+            }
+        }
+}
+
+static void P_RunPushers(void)
+{
+    int g;
+
+    if (demo_compatibility || !allow_pushers)
+        return;
+
+    for (g = 0; g < pushrun.numgroups; g++)
+        {
+        sector_t *sec = sectors + pushrun.affectees[g];
+        const int *members = pushrun.members + pushrun.firstmember[g];
+        int num = pushrun.firstmember[g+1] - pushrun.firstmember[g];
+        int i, points = 0, constants;
+        msecnode_t *node;
+
+        if (!(sec->special & PUSH_MASK))
+            continue;
+
+        for (i = 0; i < num; i++)
+            if (((pusher_t *) pushrun.thinkers[members[i]])->type == p_push)
+                points++;
+        constants = num - points;
+
+        if (points == 1)
+            {
+            for (i = 0; ((pusher_t *) pushrun.thinkers[members[i]])->type != p_push; i++)
+                ;
+            P_PointPush((pusher_t *) pushrun.thinkers[members[i]]);
+            }
+        else if (points)
+            P_PointPushGroup(members, num);
+
+        if (!constants)
+            continue;
+
+        // one walk of the sector's things for all its winds and currents
+
+        for (node = sec->touching_thinglist; node; node = SN_SNEXT(node))
+            {
+            mobj_t *thing = node->m_thing;
+
+            if (!thing->player || (thing->flags & (MF_NOGRAVITY | MF_NOCLIP)))
+                continue;
+            for (i = 0; i < num; i++)
+                {
+                pusher_t *p = (pusher_t *) pushrun.thinkers[members[i]];
+
+                if (p->type != p_push)
+                    P_ConstantPush(p, sec, thing);
+                }
+            }
+        }
+}
+
 /////////////////////////////
 //
 // T_Pusher looks for all objects that are inside the radius of
@@ -3209,12 +3720,10 @@ static dbool PIT_PushThing(mobj_t* thing)
 void T_Pusher(pusher_t *p)
 {
     sector_t *sec;
-    mobj_t   *thing;
     msecnode_t* node;
-    int xspeed,yspeed;
-    int xl,xh,yl,yh,bx,by;
-    int radius;
-    int ht = 0;
+
+    if (P_ReachThinkerRun(&pushrun, &p->thinker, P_PusherGroup, P_RunPushers))
+        return;
 
     if (demo_compatibility || !allow_pushers)
         return;
@@ -3227,103 +3736,22 @@ void T_Pusher(pusher_t *p)
     if (!(sec->special & PUSH_MASK))
         return;
 
-    // For constant pushers (wind/current) there are 3 situations:
-    //
-    // 1) Affected Thing is above the floor.
-    //
-    //    Apply the full force if wind, no force if current.
-    //
-    // 2) Affected Thing is on the ground.
-    //
-    //    Apply half force if wind, full force if current.
-    //
-    // 3) Affected Thing is below the ground (underwater effect).
-    //
-    //    Apply no force if wind, full force if current.
-
     if (p->type == p_push)
         {
-
-        // Seek out all pushable things within the force radius of this
-        // point pusher. Crosses sectors, so use blockmap.
-
-        tmpusher = p; // MT_PUSH/MT_PULL point source
-        radius = p->radius; // where force goes to zero
-        tmbbox[BOXTOP]    = p->y + radius;
-        tmbbox[BOXBOTTOM] = p->y - radius;
-        tmbbox[BOXRIGHT]  = p->x + radius;
-        tmbbox[BOXLEFT]   = p->x - radius;
-
-        xl = (tmbbox[BOXLEFT] - bmaporgx - MAXRADIUS)>>MAPBLOCKSHIFT;
-        xh = (tmbbox[BOXRIGHT] - bmaporgx + MAXRADIUS)>>MAPBLOCKSHIFT;
-        yl = (tmbbox[BOXBOTTOM] - bmaporgy - MAXRADIUS)>>MAPBLOCKSHIFT;
-        yh = (tmbbox[BOXTOP] - bmaporgy + MAXRADIUS)>>MAPBLOCKSHIFT;
-        for (bx=xl ; bx<=xh ; bx++)
-            for (by=yl ; by<=yh ; by++)
-                P_BlockThingsIterator(bx,by,PIT_PushThing);
+        P_PointPush(p);
         return;
         }
 
     // constant pushers p_wind and p_current
 
-    if (sec->heightsec != -1) // special water sector?
-        ht = sectors[sec->heightsec].floorheight;
     node = sec->touching_thinglist; // things touching this sector
-    for ( ; node ; node = node->m_snext)
+    for ( ; node ; node = SN_SNEXT(node))
         {
-        thing = node->m_thing;
+        mobj_t *thing = node->m_thing;
+
         if (!thing->player || (thing->flags & (MF_NOGRAVITY | MF_NOCLIP)))
             continue;
-        if (p->type == p_wind)
-            {
-            if (sec->heightsec == -1) // NOT special water sector
-                if (thing->z > thing->floorz) // above ground
-                    {
-                    xspeed = p->x_mag; // full force
-                    yspeed = p->y_mag;
-                    }
-                else // on ground
-                    {
-                    xspeed = (p->x_mag)>>1; // half force
-                    yspeed = (p->y_mag)>>1;
-                    }
-            else // special water sector
-                {
-                if (thing->z > ht) // above ground
-                    {
-                    xspeed = p->x_mag; // full force
-                    yspeed = p->y_mag;
-                    }
-                else if (thing->player->viewz < ht) // underwater
-                    xspeed = yspeed = 0; // no force
-                else // wading in water
-                    {
-                    xspeed = (p->x_mag)>>1; // half force
-                    yspeed = (p->y_mag)>>1;
-                    }
-                }
-            }
-        else // p_current
-            {
-            if (sec->heightsec == -1) // NOT special water sector
-                if (thing->z > sec->floorheight) // above ground
-                    xspeed = yspeed = 0; // no force
-                else // on ground
-                    {
-                    xspeed = p->x_mag; // full force
-                    yspeed = p->y_mag;
-                    }
-            else // special water sector
-                if (thing->z > ht) // above ground
-                    xspeed = yspeed = 0; // no force
-                else // underwater
-                    {
-                    xspeed = p->x_mag; // full force
-                    yspeed = p->y_mag;
-                    }
-            }
-        thing->momx += xspeed<<(FRACBITS-PUSH_FACTOR);
-        thing->momy += yspeed<<(FRACBITS-PUSH_FACTOR);
+        P_ConstantPush(p, sec, thing);
         }
 }
 
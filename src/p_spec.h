@@ -193,6 +193,11 @@
 #define LockedKindShift            5
 #define LockedSpeedShift           3
 
+// define the bits of the generalized linedef decode table, genlinetypes[]
+
+#define GenLineClass          0x07
+#define GenLineMonsters       0x08
+
 // define names for the TriggerType field of the general linedefs
 
 typedef enum
@@ -207,6 +212,20 @@ typedef enum
   PushMany,
 } triggertype_e;
 
+// define names for the class of a generalized linedef type, ordered by base
+
+typedef enum
+{
+  GenNone,
+  GenCrusher,
+  GenStairs,
+  GenLift,
+  GenLocked,
+  GenDoor,
+  GenCeiling,
+  GenFloor,
+} genlineclass_e;
+
 // define names for the Speed field of the general linedefs
 
 typedef enum
@@ -534,7 +553,7 @@ typedef struct
   line_t* line;
   bwhere_e where;
   int   btexture;
-  int   btimer;
+  int   btimer;     // leveltime the button pops out at, 0 if unused
   mobj_t* soundorg;
 
 } button_t;
@@ -758,6 +777,8 @@ typedef struct {
 
 // list of retriggerable buttons active
 extern button_t buttonlist[MAXBUTTONS];
+// earliest btimer in buttonlist, INT_MAX if none is pressed
+extern int buttonpoptic;
 
 extern platlist_t *activeplats;        // killough 2/14/98
 
@@ -833,6 +854,9 @@ int P_FindLineFromLineTag
 ( const line_t *line,
   int start );   // killough 4/17/98
 
+const int *P_SectorsFromLineTag
+( const line_t *line );
+
 int P_FindMinSurroundingLight
 ( sector_t* sector,
   int max );
@@ -925,6 +949,8 @@ void T_Friction
 void T_Pusher
 ( pusher_t * );      // phares 3/20/98: Push thinker
 
+void P_ClearThinkerRuns(void);
+
 ////////////////////////////////////////////////////////////////
 //
 // Linedef and sector special handler prototypes
@@ -1046,6 +1072,18 @@ int EV_DoGenDoor
 int EV_DoGenLockedDoor
 ( line_t* line );
 
+// Generalized linedef decode table, indexed by special - GenCrusherBase:
+// the type's class and whether monsters may trigger it.
+extern byte genlinetypes[GenEnd - GenCrusherBase];
+
+extern int (*const genlinefuncs[])(line_t *line);
+
+#define P_GenLineType(special) \
+  ((unsigned)(special) - GenCrusherBase < GenEnd - GenCrusherBase ? \
+   genlinetypes[(unsigned)(special) - GenCrusherBase] : GenNone)
+
+void P_InitGenLineTypes(void);
+
 ////////////////////////////////////////////////////////////////
 //
 // Linedef and sector special thinker spawning
@@ -1056,6 +1094,9 @@ int EV_DoGenLockedDoor
 void P_InitPicAnims
 ( void );
 
+// Sets used for every flat in an animation one of them is in
+void P_MarkAnimatedFlats(uint8_t *used);
+
 void P_InitSwitchList
 ( void );
 
@@ -1098,6 +1139,13 @@ void P_SpawnStrobeFlash
 void P_SpawnGlowingLight
 ( sector_t* sector );
 
+dbool P_IsBatchedLight(const thinker_t *th);
+void P_AddLightThinker(thinker_t *th);
+void P_RemoveLightThinker(thinker_t *th);
+void P_RunLightThinkers(void);
+void P_SyncLightThinkers(void);
+void P_ClearLightThinkers(void);
+
 // p_plats
 
 void P_AddActivePlat
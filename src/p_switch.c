@@ -39,14 +39,17 @@
 #include "s_sound.h"
 #include "sounds.h"
 #include "lprintf.h"
+#include "p_saveg.h"
 
 // killough 2/8/98: Remove switch limit
 
 static int *switchlist;                           // killough
 static int max_numswitches;                       // killough
 static int numswitches;                           // killough
+static int *switchindex;  // first place in switchlist of each texture, or -1
 
 button_t  buttonlist[MAXBUTTONS];
+int       buttonpoptic = INT_MAX;
 
 // Default switch definitions for Doom
 const switchlist_t doom_alphSwitchList[] =
@@ -164,6 +167,13 @@ void P_InitSwitchList(void)
   numswitches = index/2;
   switchlist[index] = -1;
 
+  // index each texture's first appearance, for P_ChangeSwitchTexture
+  switchindex = realloc(switchindex, numtextures * sizeof *switchindex);
+  for (i = 0; i < numtextures; i++)
+    switchindex[i] = -1;
+  while (--index >= 0)
+    switchindex[switchlist[index]] = index;
+
   if (lump != -1)
      W_UnlockLumpNum(lump);
 }
@@ -200,7 +210,11 @@ static void P_StartButton
      buttonlist[i].line = line;
      buttonlist[i].where = w;
      buttonlist[i].btexture = texture;
-     buttonlist[i].btimer = time;
+     // P_UpdateSpecials runs later this tic, so the button pops out
+     // on the tic (time-1) from now, as when btimer counted down
+     buttonlist[i].btimer = leveltime + time;
+     if (buttonpoptic > leveltime + time)
+        buttonpoptic = leveltime + time;
      /* use sound origin of line itself - no need to compatibility-wrap
       * as the popout code gets it wrong whatever its value */
      buttonlist[i].soundorg = (mobj_t *)&line->soundorg;
@@ -210,6 +224,17 @@ static void P_StartButton
   I_Error("P_StartButton: no button slots left!");
 }
 
+//
+// P_SwitchIndex()
+//
+// Returns where texture first appears in switchlist, or -1 if it is not
+// a switch texture.
+//
+static int P_SwitchIndex(int texture)
+{
+   return texture >= 0 && texture < numtextures ? switchindex[texture] : -1;
+}
+
 //
 // P_ChangeSwitchTexture()
 //
@@ -228,7 +253,7 @@ void P_ChangeSwitchTexture
   int           useAgain )
 {
    /* Rearranged a bit to avoid too much code duplication */
-   int     i;
+   int     i, ttop_i, tmid_i, tbot_i;
    bwhere_e position = 0;
    int16_t *texture  = NULL;
    int16_t *ttop     = &sides[line->sidenum[0]].toptexture;
@@ -249,35 +274,38 @@ void P_ChangeSwitchTexture
 
    /* don't zero line->special until after exit switch test */
    if (!useAgain)
+   {
       line->special = 0;
+      P_MarkLineDirty(line);
+   }
 
-   /* search for a texture to change */
+   /* search for a texture to change: the one earliest in switchlist,
+    * top before middle before bottom if they are the same texture */
 
-   for (i = 0;i < numswitches*2;i++)
-   { /* this could be more efficient... */
-      if (switchlist[i] == *ttop)
-      {
-         texture = ttop;
-         position = SWTCH_TOP;
-         break;
-      }
-      else if (switchlist[i] == *tmid)
-      {
-         texture = tmid;
-         position = SWTCH_MIDDLE;
-         break;
-      }
-      else if (switchlist[i] == *tbot)
-      {
-         texture = tbot;
-         position = SWTCH_BOTTOM;
-         break;
-      }
+   i = INT_MAX;
+   if ((ttop_i = P_SwitchIndex(*ttop)) >= 0)
+   {
+      i = ttop_i;
+      texture = ttop;
+      position = SWTCH_TOP;
+   }
+   if ((tmid_i = P_SwitchIndex(*tmid)) >= 0 && tmid_i < i)
+   {
+      i = tmid_i;
+      texture = tmid;
+      position = SWTCH_MIDDLE;
+   }
+   if ((tbot_i = P_SwitchIndex(*tbot)) >= 0 && tbot_i < i)
+   {
+      i = tbot_i;
+      texture = tbot;
+      position = SWTCH_BOTTOM;
    }
 
    if (texture == NULL)
       return; /* no switch texture was found to change */
    *texture = switchlist[i^1];
+   P_MarkSideDirty(&sides[line->sidenum[0]]);
 
    S_StartSound(soundorg, sound);
 
@@ -305,6 +333,7 @@ P_UseSpecialLine
   line_t*       line,
   int           side )
 {
+  P_MarkLineDirty(line);  // some types clear their special below
 
   // e6y
   // b.m. side test was broken in boom201
@@ -315,86 +344,25 @@ P_UseSpecialLine
   //jff 02/04/98 add check here for generalized floor/ceil mover
   if (!demo_compatibility)
   {
-    // pointer to line function is NULL by default, set non-null if
-    // line special is push or switch generalized linedef type
-    int (*linefunc)(line_t *line)=NULL;
+    int type = P_GenLineType(line->special);
 
-    // check each range of generalized linedefs
-    if ((unsigned)line->special >= GenEnd)
-    {
-      // Out of range for GenFloors
-    }
-    else if ((unsigned)line->special >= GenFloorBase)
-    {
-      if (!thing->player)
-        if ((line->special & FloorChange) || !(line->special & FloorModel))
-          return FALSE; // FloorModel is "Allow Monsters" if FloorChange is 0
-      if (!line->tag && ((line->special&6)!=6)) //jff 2/27/98 all non-manual
-        return FALSE;                         // generalized types require tag
-      linefunc = EV_DoGenFloor;
-    }
-    else if ((unsigned)line->special >= GenCeilingBase)
-    {
-      if (!thing->player)
-        if ((line->special & CeilingChange) || !(line->special & CeilingModel))
-          return FALSE;   // CeilingModel is "Allow Monsters" if CeilingChange is 0
-      if (!line->tag && ((line->special&6)!=6)) //jff 2/27/98 all non-manual
-        return FALSE;                         // generalized types require tag
-      linefunc = EV_DoGenCeiling;
-    }
-    else if ((unsigned)line->special >= GenDoorBase)
+    if ((type & GenLineClass) != GenNone)
     {
+      int (*linefunc)(line_t *line) = genlinefuncs[type & GenLineClass];
+
       if (!thing->player)
       {
-        if (!(line->special & DoorMonster))
-          return FALSE;   // monsters disallowed from this door
-        if (line->flags & ML_SECRET) // they can't open secret doors either
-          return FALSE;
+        if (!(type & GenLineMonsters))
+          return FALSE;   // monsters disallowed from this type
+        if ((type & GenLineClass) == GenDoor && line->flags & ML_SECRET)
+          return FALSE;   // they can't open secret doors either
       }
-      if (!line->tag && ((line->special&6)!=6)) //jff 3/2/98 all non-manual
-        return FALSE;                         // generalized types require tag
-      linefunc = EV_DoGenDoor;
-    }
-    else if ((unsigned)line->special >= GenLockedBase)
-    {
-      if (!thing->player)
-        return FALSE;   // monsters disallowed from unlocking doors
-      if (!P_CanUnlockGenDoor(line,thing->player))
-        return FALSE;
-      if (!line->tag && ((line->special&6)!=6)) //jff 2/27/98 all non-manual
-        return FALSE;                         // generalized types require tag
-
-      linefunc = EV_DoGenLockedDoor;
-    }
-    else if ((unsigned)line->special >= GenLiftBase)
-    {
-      if (!thing->player)
-        if (!(line->special & LiftMonster))
-          return FALSE; // monsters disallowed
-      if (!line->tag && ((line->special&6)!=6)) //jff 2/27/98 all non-manual
-        return FALSE;                         // generalized types require tag
-      linefunc = EV_DoGenLift;
-    }
-    else if ((unsigned)line->special >= GenStairsBase)
-    {
-      if (!thing->player)
-        if (!(line->special & StairMonster))
-          return FALSE; // monsters disallowed
-      if (!line->tag && ((line->special&6)!=6)) //jff 2/27/98 all non-manual
-        return FALSE;                         // generalized types require tag
-      linefunc = EV_DoGenStairs;
-    }
-    else if ((unsigned)line->special >= GenCrusherBase)
-    {
-      if (!thing->player)
-        if (!(line->special & CrusherMonster))
-          return FALSE; // monsters disallowed
+      if ((type & GenLineClass) == GenLocked)
+        if (!P_CanUnlockGenDoor(line,thing->player))
+          return FALSE;
       if (!line->tag && ((line->special&6)!=6)) //jff 2/27/98 all non-manual
         return FALSE;                         // generalized types require tag
-      linefunc = EV_DoGenCrusher;
-    }
 
-    if (linefunc)
       switch((line->special & TriggerType) >> TriggerTypeShift)
       {
         case PushOnce:
@@ -417,6 +385,7 @@ P_UseSpecialLine
         default:  // if not a switch/push type, do nothing here
           return FALSE;
       }
+    }
   }
 
   // Switches that other things can activate.
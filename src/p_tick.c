@@ -36,21 +36,127 @@
 #include "p_spec.h"
 #include "p_tick.h"
 #include "p_map.h"
+#include "p_maputl.h"
 #include "r_fps.h"
+#include "r_state.h"
 #include "u_musinfo.h"
+#include "z_bmalloc.h"
+#include "d_bench.h"
+#include "m_random.h"
 
 int leveltime;
 
-static dbool   newthinkerpresent;
+// First thinker added since P_RunThinkers last looked for new movers to
+// interpolate. Thinkers are only ever added at the end of the list, so
+// everything after it is new too.
+static thinker_t *newthinkers;
 
 //
 // THINKERS
-// All thinkers should be allocated by Z_Malloc
+// All thinkers should be allocated by Z_Malloc or P_AllocThinker
 // so they can be operated on uniformly.
 // The actual structures will vary in size,
 // but the first element must be thinker_t.
 //
 
+// Thinkers that are spawned and removed all through a level come from
+// block pools rather than the zone heap, one pool per size. Pools are
+// freed with the level by Z_FreeTags.
+
+#define LIGHTSIZE MAX(MAX(sizeof(fireflicker_t), sizeof(lightflash_t)), \
+                      MAX(sizeof(strobe_t), sizeof(glow_t)))
+
+static struct block_memory_alloc_s thinkerzones[NUMTHINKERZONES] = {
+  { NULL, sizeof(mobj_t),      128, PU_LEVEL,   "Mobjs", NULL },
+  { NULL, sizeof(ceiling_t),   32,  PU_LEVSPEC, "Ceilings", NULL },
+  { NULL, sizeof(floormove_t), 32,  PU_LEVSPEC, "Floors", NULL },
+  { NULL, sizeof(plat_t),      32,  PU_LEVSPEC, "Plats", NULL },
+  { NULL, sizeof(vldoor_t),    32,  PU_LEVSPEC, "Doors", NULL },
+  { NULL, sizeof(elevator_t),  32,  PU_LEVSPEC, "Elevators", NULL },
+  { NULL, LIGHTSIZE,           64,  PU_LEVSPEC, "Lights", NULL },
+};
+
+void *P_AllocThinker(thinkerzone_e zone)
+{
+  return Z_BMalloc(&thinkerzones[zone]);
+}
+
+//
+// P_FreeThinker
+// Frees a thinker from whichever pool it came from, or from the zone
+// heap if none. Mobjs are freed most often, so their pool is asked first.
+//
+
+void P_FreeThinker(thinker_t *thinker)
+{
+  int i;
+
+  for (i = 0; i < NUMTHINKERZONES; i++)
+    if (Z_BOwns(&thinkerzones[i], thinker))
+      {
+        Z_BFree(&thinkerzones[i], thinker);
+        return;
+      }
+  Z_Free(thinker);
+}
+
+// Call once Z_FreeTags has freed the pools with the old level
+void P_ClearThinkerZones(void)
+{
+  int i;
+
+  for (i = 0; i < NUMTHINKERZONES; i++)
+    NULL_BLOCK_MEMORY_ALLOC_ZONE(thinkerzones[i]);
+}
+
+//
+// Thinker batching
+//
+// With it on, the sector light thinkers stay on the thinker list, so
+// savegames and the searches through it see them as before, but are
+// run from p_lights.c's arrays after the main list. Flickers and flashes
+// draw on pr_lights, which only has a seed of its own with
+// demo_insurance; otherwise every class but pr_misc shares one, and
+// moving the lights' draws changes everyone else's numbers. So it is
+// only used with demo_insurance on, and never while a demo plays or in
+// a netgame, where the order has to match exactly.
+//
+
+static dbool thinker_batching;  // requested by the frontend
+static dbool batchlights;       // latched by P_InitThinkers for the level
+
+//
+// Mobj parking
+//
+// P_MobjThinker marks a thing MIF_PARKED once a tic has left it exactly
+// as it found it: at rest on the floor, in a state that never ends.
+// P_RunThinkers then passes it by in its place on the list until
+// P_WakeMobj clears the mark (state changes, moves, damage, a moving
+// floor or ceiling) or it turns out to have gained momentum or lost its
+// floor behind the wakers' backs, so order and results stay the same.
+//
+
+int mobj_parking = 1;
+static dbool parkmobjs;         // latched by P_InitThinkers for the level
+
+static dbool P_MobjParked(mobj_t *mo)
+{
+  if (!(mo->intflags & MIF_PARKED))
+    return FALSE;
+  if (mo->momx | mo->momy | mo->momz || mo->z != mo->floorz ||
+      (respawnmonsters && mo->flags & MF_COUNTKILL))
+  {
+    P_WakeMobj(mo);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+void P_SetThinkerBatching(dbool on)
+{
+  thinker_batching = on;
+}
+
 // killough 8/29/98: we maintain several separate threads, each containing
 // a special class of thinkers, to allow more efficient searches.
 thinker_t thinkerclasscap[th_all+1];
@@ -71,6 +177,13 @@ void P_InitThinkers(void)
       thinkerclasscap[i].cprev = thinkerclasscap[i].cnext = &thinkerclasscap[i];
 
    thinkercap.prev = thinkercap.next  = &thinkercap;
+   newthinkers = NULL;
+
+   batchlights = thinker_batching && demo_insurance && !demo_compatibility &&
+     !demoplayback && !netgame;
+   parkmobjs = mobj_parking;
+   P_ClearLightThinkers();
+   P_ClearThinkerRuns();
 }
 
 //
@@ -105,6 +218,10 @@ void P_UpdateThinker(thinker_t *thinker)
   thinker->cnext = th;
   thinker->cprev = th->cprev;
   th->cprev = thinker;
+
+  // Friendliness changes come through here, so keep the target grid up
+  if (thinker->function == P_MobjThinker)
+    P_UpdateTargetGrid((mobj_t *) thinker);
 }
 
 /*
@@ -130,7 +247,8 @@ void P_AddThinker(thinker_t* thinker)
   thinker->cnext        = NULL;
   thinker->cprev        = NULL;
   P_UpdateThinker(thinker);
-  newthinkerpresent = TRUE;
+  if (!newthinkers)
+    newthinkers = thinker;
 }
 
 //
@@ -161,6 +279,8 @@ void P_RemoveThinkerDelayed(thinker_t *thinker)
 
    /* Remove from main thinker list */
    next = thinker->next;
+   if (thinker == newthinkers)
+      newthinkers = next != &thinkercap ? next : NULL;
    /* Note that currentthinker is guaranteed to point to us,
     * and since we're freeing our memory, we had better change that. So
     * point it to thinker->prev, so the iterator will correctly move on to
@@ -170,7 +290,7 @@ void P_RemoveThinkerDelayed(thinker_t *thinker)
    /* Remove from current thinker class list */
    th = thinker->cnext;
    (th->cprev = thinker->cprev)->cnext = th;
-   Z_Free(thinker);
+   P_FreeThinker(thinker);
 }
 
 //
@@ -189,6 +309,8 @@ void P_RemoveThinkerDelayed(thinker_t *thinker)
 void P_RemoveThinker(thinker_t *thinker)
 {
   R_StopInterpolationIfNeeded(thinker);
+  if (batchlights && P_IsBatchedLight(thinker))
+    P_RemoveLightThinker(thinker);
   thinker->function = P_RemoveThinkerDelayed;
 
   P_UpdateThinker(thinker);
@@ -252,16 +374,36 @@ void P_SetTarget(mobj_t **mop, mobj_t *targ)
 
 static void P_RunThinkers (void)
 {
+  dbool   isnew = FALSE;
+
   for (currentthinker = thinkercap.next;
        currentthinker != &thinkercap;
        currentthinker = currentthinker->next)
   {
-    if (newthinkerpresent)
+    if (currentthinker == newthinkers)
+    {
+      isnew = TRUE;
+      newthinkers = NULL;
+    }
+    if (isnew)
       R_ActivateThinkerInterpolations(currentthinker);
+    if (batchlights && P_IsBatchedLight(currentthinker))
+    {
+      // New lights join their array here, so their spawners and the
+      // savegame loader need not know about batching
+      if (isnew)
+        P_AddLightThinker(currentthinker);
+      continue;
+    }
+    if (parkmobjs && currentthinker->function == (think_t)P_MobjThinker &&
+        P_MobjParked((mobj_t *)currentthinker))
+      continue;
     if (currentthinker->function)
       currentthinker->function(currentthinker);
   }
-  newthinkerpresent = FALSE;
+
+  if (batchlights)
+    P_RunLightThinkers();
 
   // Dedicated thinkers
   P_MapMusicThinker();
@@ -277,6 +419,7 @@ static void P_RunThinkers (void)
 
 void P_Ticker (void)
 {
+  int64_t start;
   int i;
 
   /* pause if in menu and at least one tic has been run
@@ -301,9 +444,68 @@ void P_Ticker (void)
     if (playeringame[i])
       P_PlayerThink(&players[i]);
 
+  start = D_BenchStart();
+  P_PrecomputeSight();
   P_RunThinkers();
+  D_BenchStop(BENCH_THINKERS, start);
+  start = D_BenchStart();
   P_UpdateSpecials();
   P_RespawnSpecials();
+  D_BenchStop(BENCH_SPECIALS, start);
   P_MapEnd();
   leveltime++;                       // for par times
 }
+
+/*
+ * P_StateChecksum
+ *
+ * FNV-1a, a byte at a time, over the fields in the order they're listed
+ * in p_tick.h.
+ */
+
+static uint32_t P_ChecksumInt(uint32_t h, int v)
+{
+  int i;
+
+  for (i = 0; i < 32; i += 8)
+    h = (h ^ ((unsigned)v >> i & 0xff)) * 16777619u;
+  return h;
+}
+
+uint32_t P_StateChecksum(void)
+{
+  uint32_t h = 2166136261u;
+  thinker_t *th = NULL;
+  int i;
+
+  h = P_ChecksumInt(h, leveltime);
+  h = P_ChecksumInt(h, rng.rndindex);
+  h = P_ChecksumInt(h, rng.prndindex);
+  for (i = 0; i < NUMPRCLASS; i++)
+    h = P_ChecksumInt(h, (int)rng.seed[i]);
+
+  for (i = 0; i < numsectors; i++)
+  {
+    h = P_ChecksumInt(h, sectors[i].floorheight);
+    h = P_ChecksumInt(h, sectors[i].ceilingheight);
+  }
+
+  while ((th = P_NextThinker(th, th_all)) != NULL)
+  {
+    const mobj_t *mo = (const mobj_t *)th;
+
+    if (th->function != P_MobjThinker)
+      continue;
+    h = P_ChecksumInt(h, mo->x);
+    h = P_ChecksumInt(h, mo->y);
+    h = P_ChecksumInt(h, mo->z);
+    h = P_ChecksumInt(h, mo->momx);
+    h = P_ChecksumInt(h, mo->momy);
+    h = P_ChecksumInt(h, mo->momz);
+    h = P_ChecksumInt(h, mo->angle);
+    h = P_ChecksumInt(h, mo->health);
+    h = P_ChecksumInt(h, mo->state ? (int)(mo->state - states) : -1);
+    h = P_ChecksumInt(h, mo->tics);
+  }
+  return h;
+}
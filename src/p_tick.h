@@ -40,6 +40,13 @@
 
 void P_Ticker(void);
 
+/* Hash of the game state demo sync rests on: the random number generator,
+ * sector heights and every mobj's position, momentum, angle, health and
+ * state. Two runs of a demo that stay in sync agree on it every tic. */
+uint32_t P_StateChecksum(void);
+
+extern int mobj_parking;  // idle things skip their thinker until woken
+
 void P_InitThinkers(void);
 void P_AddThinker(thinker_t *thinker);
 void P_RemoveThinker(thinker_t *thinker);
@@ -49,6 +56,26 @@ void P_UpdateThinker(thinker_t *thinker);   // killough 8/29/98
 
 void P_SetTarget(mobj_t **mo, mobj_t *target);   // killough 11/98
 
+/* Pools for the thinkers that come and go through a level */
+typedef enum {
+  TZ_MOBJ,
+  TZ_CEILING,
+  TZ_FLOOR,
+  TZ_PLAT,
+  TZ_DOOR,
+  TZ_ELEVATOR,
+  TZ_LIGHT,     /* fireflicker_t, lightflash_t, strobe_t and glow_t */
+  NUMTHINKERZONES
+} thinkerzone_e;
+
+void *P_AllocThinker(thinkerzone_e zone);
+void P_FreeThinker(thinker_t *thinker);
+void P_ClearThinkerZones(void);
+
+/* Run the sector light thinkers from dense arrays; takes effect from the
+ * next level start or savegame load */
+void P_SetThinkerBatching(dbool on);
+
 /* killough 8/29/98: threads of thinkers, for more efficient searches
  * cph 2002/01/13: for consistency with the main thinker list, keep objects
  * pending deletion on a class list too
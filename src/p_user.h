@@ -43,5 +43,6 @@ void P_CalcHeight(player_t *player);
 void P_DeathThink(player_t *player);
 void P_MovePlayer(player_t *player);
 void P_Thrust(player_t *player, angle_t angle, fixed_t move);
+void P_CheckPitch(angle_t *pitch);
 
 #endif  /* __P_USER__ */
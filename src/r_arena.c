@@ -0,0 +1,192 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      The per-frame render arena. Each render thread keeps its drawsegs,
+ *      openings, masked columns and vissprites in one block, so once a map
+ *      has been looked around they stop moving and the zone is not chopped
+ *      up by them.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#include "z_zone.h"
+#include "doomtype.h"
+#include "r_defs.h"
+#include "r_main.h"
+#include "r_arena.h"
+#include "lprintf.h"
+#include "i_thread.h"
+
+// Room each region starts with. Ports short on memory can set these to
+// what R_ReportRenderArena says their maps need, so nothing grows.
+#ifndef RENDER_ARENA_DRAWSEGS
+#define RENDER_ARENA_DRAWSEGS   128
+#endif
+#ifndef RENDER_ARENA_OPENINGS
+#define RENDER_ARENA_OPENINGS   16384
+#endif
+#ifndef RENDER_ARENA_MASKEDCOLS
+#define RENDER_ARENA_MASKEDCOLS 4096
+#endif
+#ifndef RENDER_ARENA_VISSPRITES
+#define RENDER_ARENA_VISSPRITES 128
+#endif
+
+// Regions start on this boundary within the block
+#define ARENA_ALIGN 32
+
+static const size_t regionunit[NUMARENAREGIONS] = {
+  sizeof(drawseg_t), sizeof(int16_t), sizeof(int), sizeof(vissprite_t)
+};
+
+static const size_t regionstart[NUMARENAREGIONS] = {
+  RENDER_ARENA_DRAWSEGS, RENDER_ARENA_OPENINGS, RENDER_ARENA_MASKEDCOLS,
+  RENDER_ARENA_VISSPRITES
+};
+
+typedef struct {
+  byte   *block;                        // NULL until the first frame
+  byte   *region[NUMARENAREGIONS];
+  size_t count[NUMARENAREGIONS];
+  dbool  grown[NUMARENAREGIONS];        // region moved to a block of its own
+  dbool  outgrown;                      // any of them did
+} renderarena_t;
+
+static THREAD_LOCAL renderarena_t arena;
+
+// Room in each render thread's arena, for the report
+static size_t arenacount[MAX_RENDER_THREADS][NUMARENAREGIONS];
+
+static size_t R_RegionBytes(int region, size_t count)
+{
+  return (count * regionunit[region] + ARENA_ALIGN-1) & ~(size_t)(ARENA_ALIGN-1);
+}
+
+void R_ResetRenderArena(void)
+{
+  size_t size = 0;
+  byte *p;
+  int i;
+
+  if (arena.block && !arena.outgrown)
+    return;
+
+  for (i = 0; i < NUMARENAREGIONS; i++)
+  {
+    if (!arena.count[i])
+      arena.count[i] = regionstart[i];
+    if (arena.grown[i])
+      free(arena.region[i]);
+    size += R_RegionBytes(i, arena.count[i]);
+  }
+  free(arena.block);
+
+  //e6y: set all fields to zero
+  arena.block = p = malloc(size);
+  memset(p, 0, size);
+
+  for (i = 0; i < NUMARENAREGIONS; i++)
+  {
+    arena.region[i] = p;
+    arena.grown[i] = FALSE;
+    arenacount[slicenum][i] = arena.count[i];
+    p += R_RegionBytes(i, arena.count[i]);
+  }
+  arena.outgrown = FALSE;
+}
+
+void *R_ArenaRegion(arenaregion_e region, size_t *count)
+{
+  *count = arena.count[region];
+  return arena.region[region];
+}
+
+// Until the next reset the region lives in a block of its own, which
+// is the only thing that moves if it has to grow again this frame
+void *R_GrowArenaRegion(arenaregion_e region, size_t count, size_t used)
+{
+  size_t unit = regionunit[region];
+  byte *p;
+
+  if (arena.grown[region])
+    p = realloc(arena.region[region], count * unit);
+  else
+  {
+    p = malloc(count * unit);
+    memcpy(p, arena.region[region], used * unit);
+  }
+  memset(p + used * unit, 0, (count - used) * unit);
+
+  arena.region[region] = p;
+  arena.count[region] = count;
+  arena.grown[region] = arena.outgrown = TRUE;
+  arenacount[slicenum][region] = count;
+  return p;
+}
+
+// The most of each region any render thread has needed
+static void R_ArenaPeak(size_t *count)
+{
+  int i, j;
+
+  for (j = 0; j < NUMARENAREGIONS; j++)
+    count[j] = 0;
+  for (i = 0; i < MAX_RENDER_THREADS; i++)
+    for (j = 0; j < NUMARENAREGIONS; j++)
+      if (arenacount[i][j] > count[j])
+        count[j] = arenacount[i][j];
+}
+
+size_t R_RenderArenaBytes(void)
+{
+  size_t count[NUMARENAREGIONS];
+  size_t size = 0;
+  int j;
+
+  R_ArenaPeak(count);
+  if (!count[RA_DRAWSEGS])
+    return 0;
+  for (j = 0; j < NUMARENAREGIONS; j++)
+    size += R_RegionBytes(j, count[j]);
+  return size;
+}
+
+void R_ReportRenderArena(void)
+{
+  size_t count[NUMARENAREGIONS];
+  size_t size = R_RenderArenaBytes();
+
+  R_ArenaPeak(count);
+  if (!count[RA_DRAWSEGS])
+    return;
+
+  lprintf(LO_INFO, "R_ReportRenderArena: %u drawsegs, %u openings, %u masked columns and %u vissprites, %u KB a thread\n",
+        (unsigned)count[RA_DRAWSEGS], (unsigned)count[RA_OPENINGS],
+        (unsigned)count[RA_MASKEDCOLS], (unsigned)count[RA_VISSPRITES],
+        (unsigned)(size >> 10));
+}
@@ -0,0 +1,67 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      The per-frame render arena: one block per render thread holding
+ *      its drawsegs, openings, masked columns and vissprites, laid out
+ *      again between frames whenever one of them outgrew its room.
+ *
+ *-----------------------------------------------------------------------------*/
+
+
+#ifndef R_ARENA_H
+#define R_ARENA_H
+
+#include <stddef.h>
+
+typedef enum {
+  RA_DRAWSEGS,    // drawseg_t
+  RA_OPENINGS,    // int16_t
+  RA_MASKEDCOLS,  // int
+  RA_VISSPRITES,  // vissprite_t
+  NUMARENAREGIONS
+} arenaregion_e;
+
+// Call at frame start, before anything takes a region: regions that grew
+// last frame are folded back into a single block. Everything in the
+// arena is dropped.
+void R_ResetRenderArena(void);
+
+// Start of the region and room for how many it has
+void *R_ArenaRegion(arenaregion_e region, size_t *count);
+
+// Give the region room for at least count, keeping the first used. The
+// region is moved, so anything pointing into it has to be adjusted.
+void *R_GrowArenaRegion(arenaregion_e region, size_t count, size_t used);
+
+// Log the most any render thread has needed, for sizing RENDER_ARENA_*
+void R_ReportRenderArena(void);
+// That most, in bytes, for one thread
+size_t R_RenderArenaBytes(void);
+
+#endif
@@ -38,22 +38,24 @@
 #include "r_plane.h"
 #include "r_things.h"
 #include "r_bsp.h" // cph - sanity checking
+#include "r_pvs.h"
+#include "r_arena.h"
 #include "v_video.h"
 #include "lprintf.h"
 
-seg_t     *curline;
-side_t    *sidedef;
-line_t    *linedef;
-sector_t  *frontsector;
-sector_t  *backsector;
-drawseg_t *ds_p;
+THREAD_LOCAL seg_t     *curline;
+THREAD_LOCAL side_t    *sidedef;
+THREAD_LOCAL line_t    *linedef;
+THREAD_LOCAL sector_t  *frontsector;
+THREAD_LOCAL sector_t  *backsector;
+THREAD_LOCAL drawseg_t *ds_p;
 
 // killough 4/7/98: indicates doors closed wrt automap bugfix:
 // cph - replaced by linedef rendering flags - int      doorclosed;
 
 // killough: New code which removes 2s linedef limit
-drawseg_t *drawsegs;
-unsigned  maxdrawsegs;
+THREAD_LOCAL drawseg_t *drawsegs;
+THREAD_LOCAL unsigned  maxdrawsegs;
 // drawseg_t drawsegs[MAXDRAWSEGS];       // old code -- killough
 
 //
@@ -62,41 +64,110 @@ unsigned  maxdrawsegs;
 
 void R_ClearDrawSegs(void)
 {
-  ds_p = drawsegs;
+  size_t count;
+
+  ds_p = drawsegs = R_ArenaRegion(RA_DRAWSEGS, &count);
+  maxdrawsegs = count;
 }
 
 // CPhipps -
 // Instead of clipsegs, let's try using an array with one entry for each column,
 // indicating whether it's blocked by a solid wall yet or not.
+//
+// One bit per column, so runs are found 64 columns at a time, and a count
+// of the columns still open so the BSP walk can stop once there are none.
 
-uint8_t solidcol[MAX_SCREENWIDTH];
+THREAD_LOCAL uint64_t solidcols[SOLIDCOLWORDS];
+THREAD_LOCAL int opencolumns;
+
+static inline int R_LowestBit(uint64_t bits)
+{
+#if defined(__GNUC__)
+   return __builtin_ctzll(bits);
+#else
+   int n = 0;
+   while (!(bits & 1))
+   {
+      bits >>= 1;
+      n++;
+   }
+   return n;
+#endif
+}
+
+//
+// R_FindColumn
+// The first column from first up to last that is solid, or open if solid
+// is false; last if there is none.
+//
+
+static int R_FindColumn(int first, int last, dbool solid)
+{
+   const uint64_t flip = solid ? 0 : ~(uint64_t)0;
+   int word = first >> 6;
+   uint64_t bits = (solidcols[word] ^ flip) & (~(uint64_t)0 << (first & 63));
+
+   while (!bits)
+   {
+      if (++word << 6 >= last)
+         return last;
+      bits = solidcols[word] ^ flip;
+   }
+   first = (word << 6) + R_LowestBit(bits);
+   return first < last ? first : last;
+}
+
+static inline int R_CountBits(uint64_t bits)
+{
+#if defined(__GNUC__)
+   return __builtin_popcountll(bits);
+#else
+   int n = 0;
+   for (; bits; bits &= bits - 1)
+      n++;
+   return n;
+#endif
+}
+
+//
+// R_SetSolidColumns
+// Marks first up to last solid. The wall just stored may have marked
+// some of them already.
+//
+
+static void R_SetSolidColumns(int first, int last)
+{
+   while (first < last)
+   {
+      const int bit = first & 63;
+      const int n = MIN(64 - bit, last - first);
+      const uint64_t mask = (n == 64 ? ~(uint64_t)0 : (((uint64_t)1 << n) - 1)) << bit;
+
+      opencolumns -= R_CountBits(mask & ~solidcols[first >> 6]);
+      solidcols[first >> 6] |= mask;
+      first += n;
+   }
+}
 
 // CPhipps -
 // R_ClipWallSegment
 //
 // Replaces the old R_Clip*WallSegment functions. It draws bits of walls in those
-// columns which aren't solid, and updates the solidcol[] array appropriately
+// columns which aren't solid, and updates the solidcols[] bits appropriately
 
 static void R_ClipWallSegment(int first, int last, dbool   solid)
 {
-   uint8_t *p;
    while (first < last)
    {
-      if (solidcol[first])
-      {
-         if (!(p = memchr(solidcol+first, 0, last-first))) return; // All solid
-         first = p - solidcol;
-      }
-      else
-      {
-         int to;
-         if (!(p = memchr(solidcol+first, 1, last-first))) to = last;
-         else to = p - solidcol;
-         R_StoreWallRange(first, to-1);
-         if (solid)
-            memset(solidcol+first,1,to-first);
-         first = to;
-      }
+      int to;
+
+      if ((first = R_FindColumn(first, last, FALSE)) == last)
+         return; // All solid
+      to = R_FindColumn(first, last, TRUE);
+      R_StoreWallRange(first, to-1);
+      if (solid)
+         R_SetSolidColumns(first, to);
+      first = to;
    }
 }
 
@@ -106,7 +177,12 @@ static void R_ClipWallSegment(int first, int last, dbool   solid)
 
 void R_ClearClipSegs (void)
 {
-  memset(solidcol, 0, SCREENWIDTH);
+  memset(solidcols, 0, sizeof(solidcols));
+  opencolumns = SCREENWIDTH;
+
+  // columns outside this thread's slice are someone else's problem
+  R_SetSolidColumns(0, slicex1);
+  R_SetSolidColumns(slicex2 + 1, SCREENWIDTH);
 }
 
 // killough 1/18/98 -- This function is used to fix the automap bug which
@@ -115,9 +191,9 @@ void R_ClearClipSegs (void)
 // cph - converted to R_RecalcLineFlags. This recalculates all the flags for
 // a line, including closure and texture tiling.
 
-static void R_RecalcLineFlags(void)
+static int R_LineFlags(void)
 {
-  linedef->r_validcount = gametic;
+  int flags;
 
   /* First decide if the line is closed, normal, or invisible */
   if (!(linedef->flags & ML_TWOSIDED)
@@ -139,7 +215,7 @@ static void R_RecalcLineFlags(void)
         frontsector->ceilingpic!=skyflatnum)
     )
       )
-    linedef->r_flags = RF_CLOSED;
+    flags = RF_CLOSED;
   else {
     // Reject empty lines used for triggers
     //  and special events.
@@ -156,13 +232,13 @@ static void R_RecalcLineFlags(void)
       sizeof(frontsector->ceilingpic) + sizeof(frontsector->floorpic) +
       sizeof(frontsector->lightlevel) + sizeof(frontsector->floorlightsec) +
       sizeof(frontsector->ceilinglightsec))) {
-      linedef->r_flags = 0; return;
+      return 0;
     } else
-      linedef->r_flags = RF_IGNORE;
+      flags = RF_IGNORE;
   }
 
   /* cph - I'm too lazy to try and work with offsets in this */
-  if (curline->sidedef->rowoffset) return;
+  if (curline->sidedef->rowoffset) return flags;
 
   /* Now decide on texture tiling */
   if (linedef->flags & ML_TWOSIDED) {
@@ -171,19 +247,28 @@ static void R_RecalcLineFlags(void)
     /* Does top texture need tiling */
     if ((c = frontsector->ceilingheight - backsector->ceilingheight) > 0 &&
    (textureheight[texturetranslation[curline->sidedef->toptexture]] > c))
-      linedef->r_flags |= RF_TOP_TILE;
+      flags |= RF_TOP_TILE;
 
     /* Does bottom texture need tiling */
     if ((c = frontsector->floorheight - backsector->floorheight) > 0 &&
    (textureheight[texturetranslation[curline->sidedef->bottomtexture]] > c))
-      linedef->r_flags |= RF_BOT_TILE;
+      flags |= RF_BOT_TILE;
   } else {
     int c;
     /* Does middle texture need tiling */
     if ((c = frontsector->ceilingheight - frontsector->floorheight) > 0 &&
    (textureheight[texturetranslation[curline->sidedef->midtexture]] > c))
-      linedef->r_flags |= RF_MID_TILE;
+      flags |= RF_MID_TILE;
   }
+  return flags;
+}
+
+/* Other renderer threads may be looking at the same line, so the flags are
+ * worked out first and only published once complete. */
+static void R_RecalcLineFlags(void)
+{
+  linedef->r_flags = R_LineFlags();
+  linedef->r_validcount = gametic;
 }
 
 //
@@ -218,7 +303,8 @@ sector_t *R_FakeFlat(sector_t *sec, sector_t *tempsec,
       int underwater = heightsec!=-1 && viewz<=sectors[heightsec].floorheight;
 
       // Replace sector being drawn, with a copy to be hacked
-      *tempsec = *sec;
+      // (of what's drawn of it, see sector_t)
+      memcpy(tempsec, sec, offsetof(sector_t, cachedheight));
 
       // Replace floor and ceiling height with other sector's heights.
       tempsec->floorheight   = s->floorheight;
@@ -303,12 +389,12 @@ static void R_AddLine (seg_t *line)
   angle_t  angle2;
   angle_t  span;
   angle_t  tspan;
-  static sector_t tempsec;     // killough 3/8/98: ceiling/water hack
+  static THREAD_LOCAL sector_t tempsec;     // killough 3/8/98: ceiling/water hack
 
   curline = line;
 
-  angle1 = R_PointToAngle (line->v1->x, line->v1->y);
-  angle2 = R_PointToAngle (line->v2->x, line->v2->y);
+  angle1 = R_VertexAngle (line->v1);
+  angle2 = R_VertexAngle (line->v2);
 
   // Clip to view edges.
   span = angle1 - angle2;
@@ -385,6 +471,9 @@ static void R_AddLine (seg_t *line)
 //  if some part of the bbox might be visible.
 //
 
+// how far R_CheckBBox widens the box, see there
+#define BBOX_ANGLE_SLACK (1<<ANGLETOFINESHIFT)
+
 static const int checkcoord[12][4] = // killough -- static const
 {
   {3,0,2,1},
@@ -418,8 +507,12 @@ static dbool   R_CheckBBox(const fixed_t *bspcoord)
       return TRUE;
 
     check = checkcoord[boxpos];
-    angle1 = R_PointToAngle (bspcoord[check[0]], bspcoord[check[1]]) - viewangle;
-    angle2 = R_PointToAngle (bspcoord[check[2]], bspcoord[check[3]]) - viewangle;
+    // The float angles are closer to the truth than the tantoangle[]
+    // ones R_AddLine uses, which can be up to half a fine angle out, so
+    // the box is widened by a fine angle each way: it may let through a
+    // node the exact test would have culled, never the other way round.
+    angle1 = R_PointToAngleApprox (bspcoord[check[0]], bspcoord[check[1]]) - viewangle + BBOX_ANGLE_SLACK;
+    angle2 = R_PointToAngleApprox (bspcoord[check[2]], bspcoord[check[3]]) - viewangle - BBOX_ANGLE_SLACK;
   }
 
   // cph - replaced old code, which was unclear and badly commented
@@ -453,7 +546,7 @@ static dbool   R_CheckBBox(const fixed_t *bspcoord)
     if (sx1 == sx2)
       return FALSE;
 
-    if (!memchr(solidcol+sx1, 0, sx2-sx1)) return FALSE;
+    if (R_FindColumn(sx1, sx2, FALSE) == sx2) return FALSE;
     // All columns it covers are already solidly covered
   }
 
@@ -482,10 +575,21 @@ static void R_Subsector(int num)
   count = sub->numlines;
   line = &segs[sub->firstline];
 
+  if (pvssubsectors && !pvssubsectors[num] && !frontsector->thinglist)
+    return;
+
   // killough 3/8/98, 4/4/98: Deep water / fake ceiling effect
   frontsector = R_FakeFlat(frontsector, &tempsec, &floorlightlevel,
                            &ceilinglightlevel, FALSE);   // killough 4/11/98
 
+  // Out of sight from the view sector, but its sprites can still poke
+  // out past the corners hiding it
+  if (pvssubsectors && !pvssubsectors[num])
+  {
+    R_AddSprites(sub, (floorlightlevel+ceilinglightlevel)/2);
+    return;
+  }
+
   // killough 3/7/98: Add (x,y) offsets to flats, add deep water check
   // killough 3/16/98: add floorlightlevel
   // killough 10/98: add support for skies transferred from sidedefs
@@ -551,9 +655,18 @@ void R_RenderBSPNode(int bspnum)
   while (!(bspnum & NF_SUBSECTOR))  // Found a subsector?
     {
       const node_t *bsp = &nodes[bspnum];
+      int side;
+
+      // Every column of the slice is behind a solid wall already
+      if (!opencolumns)
+        return;
+
+      // Nothing under here can be seen from the view sector, or holds a thing
+      if (pvsnodes && !pvsnodes[bspnum])
+        return;
 
       // Decide which side the view point is on.
-      int side = R_PointOnSide(viewx, viewy, bsp);
+      side = R_PointOnSide(viewx, viewy, bsp);
       // Recursively divide front space.
       R_RenderBSPNode(bsp->children[side]);
 
@@ -34,21 +34,37 @@
 #ifndef __R_BSP__
 #define __R_BSP__
 
-extern seg_t    *curline;
-extern side_t   *sidedef;
-extern line_t   *linedef;
-extern sector_t *frontsector;
-extern sector_t *backsector;
+#include "i_thread.h"
+
+extern THREAD_LOCAL seg_t    *curline;
+extern THREAD_LOCAL side_t   *sidedef;
+extern THREAD_LOCAL line_t   *linedef;
+extern THREAD_LOCAL sector_t *frontsector;
+extern THREAD_LOCAL sector_t *backsector;
 
 /* old code -- killough:
  * extern drawseg_t drawsegs[MAXDRAWSEGS];
  * new code -- killough: */
-extern drawseg_t *drawsegs;
-extern unsigned maxdrawsegs;
+extern THREAD_LOCAL drawseg_t *drawsegs;
+extern THREAD_LOCAL unsigned maxdrawsegs;
+
+// One bit per column of the view, set once a solid wall covers it
+#define SOLIDCOLWORDS ((MAX_SCREENWIDTH + 63) / 64)
+extern THREAD_LOCAL uint64_t solidcols[SOLIDCOLWORDS];
+extern THREAD_LOCAL int opencolumns;
+
+static INLINE void R_SetSolidColumn(int x)
+{
+  const uint64_t bit = (uint64_t)1 << (x & 63);
 
-extern uint8_t solidcol[MAX_SCREENWIDTH];
+  if (!(solidcols[x >> 6] & bit))
+  {
+    solidcols[x >> 6] |= bit;
+    opencolumns--;
+  }
+}
 
-extern drawseg_t *ds_p;
+extern THREAD_LOCAL drawseg_t *ds_p;
 
 void R_ClearClipSegs(void);
 void R_ClearDrawSegs(void);
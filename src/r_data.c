@@ -42,8 +42,14 @@
 #include "r_bsp.h"
 #include "r_things.h"
 #include "p_tick.h"
+#include "p_maputl.h"
+#include "p_spec.h"
+#include "v_video.h"
 #include "lprintf.h"  // jff 08/03/98 - declaration of lprintf
+#include "d_bench.h"
 #include "p_tick.h"
+#include "r_mipmap.h"
+#include "r_rounded.h"
 
 //
 // Graphics.
@@ -95,6 +101,7 @@ int       numtextures;
 texture_t **textures; // proff - 04/05/2000 removed static for OpenGL
 fixed_t   *textureheight; //needed for texture pegging (and TFE fix - killough)
 int       *flattranslation;             // for global animation
+const uint8_t **flatpixels;
 int       *texturetranslation;
 
 //
@@ -242,6 +249,10 @@ static void R_InitTextures (void)
             }
         }
 
+      texture->singlepatch = texture->patchcount == 1 &&
+        !texture->patches[0].originx && !texture->patches[0].originy &&
+        texture->patches[0].patch != -1;
+
       for (j=1; j*2 <= texture->width; j<<=1)
         ;
       texture->widthmask = j-1;
@@ -298,6 +309,7 @@ static void R_InitFlats(void)
     Z_Malloc((numflats+1)*sizeof(*flattranslation), PU_STATIC, 0);
   for (i=0 ; i<numflats ; i++)
     flattranslation[i] = i;
+  flatpixels = calloc(numflats+1, sizeof(*flatpixels));
 }
 
 //
@@ -338,6 +350,11 @@ static void R_InitColormaps(void)
     colormaps[1] = defaultmap;
     numcolormaps = 2;
   }
+
+  // Rebuild the true colour palettes so the fused colormap tables
+  // match the colormaps just loaded
+  V_DestroyUnusedTrueColorPalettes();
+  V_UpdateTrueColorPalette();
 }
 
 // killough 4/4/98: get colormap number from name
@@ -407,14 +424,28 @@ const lighttable_t* R_ColourMap(int lightlevel, fixed_t spryscale)
 
 void R_InitData(void)
 {
+  int phase;
+
+  // anything built from the last set of textures and flats
+  R_FreeMips();
+  R_FreeRounded();
+
   lprintf(LO_INFO, "Textures\n");
+  phase = D_StartupBegin("R_InitTextures");
   R_InitTextures();
+  D_StartupEnd(phase);
   lprintf(LO_INFO, "Flats\n");
+  phase = D_StartupBegin("R_InitFlats");
   R_InitFlats();
+  D_StartupEnd(phase);
   lprintf(LO_INFO, "Sprites\n");
+  phase = D_StartupBegin("R_InitSpriteLumps");
   R_InitSpriteLumps();
+  D_StartupEnd(phase);
   lprintf(LO_INFO, "Colormaps\n");
+  phase = D_StartupBegin("R_InitColormaps");
   R_InitColormaps();                    // killough 3/20/98
+  D_StartupEnd(phase);
 }
 
 //
@@ -483,6 +514,60 @@ int R_SafeTextureNumForName(const char *name, int snum)
   return i;
 }
 
+//
+// R_BuildFlatArena
+// Copies every flat the level's sectors use, with the rest of the
+// animations they are in, into one block, each 64-byte aligned and one
+// after the other, so R_DoDrawPlane finds them by index without caching
+// and locking a lump a plane. A flat the level takes on later (from a
+// saved game, say) is still read from its lump.
+//
+
+#define FLATSIZE       (64*64)
+#define FLATARENAALIGN 64
+
+static uint8_t *flatarena;
+
+void R_BuildFlatArena(void)
+{
+  byte *used = calloc(numflats, 1);
+  uint8_t *p;
+  int i, count = 0;
+
+  free(flatarena);
+  flatarena = NULL;
+  memset(flatpixels, 0, numflats * sizeof(*flatpixels));
+
+  for (i = 0; i < numsectors; i++)
+    used[sectors[i].floorpic] = used[sectors[i].ceilingpic] = 1;
+  P_MarkAnimatedFlats(used);
+  for (i = 0; i < numflats; i++)
+    count += used[i];
+
+  if (count)
+  {
+    flatarena = malloc(count * FLATSIZE + FLATARENAALIGN - 1);
+    p = (uint8_t *)(((uintptr_t)flatarena + FLATARENAALIGN - 1) &
+                    ~(uintptr_t)(FLATARENAALIGN - 1));
+
+    for (i = 0; i < numflats; i++)
+      if (used[i])
+      {
+        int lump = firstflat + i;
+        int len = W_LumpLength(lump);
+
+        if (len > FLATSIZE)
+          len = FLATSIZE;
+        memcpy(p, W_CacheLumpNum(lump), len);
+        W_UnlockLumpNum(lump);
+        memset(p + len, 0, FLATSIZE - len);  // short flats read as black
+        flatpixels[i] = p;
+        p += FLATSIZE;
+      }
+  }
+  free(used);
+}
+
 //
 // R_PrecacheLevel
 // Preloads all relevant graphics for the level.
@@ -490,44 +575,156 @@ int R_SafeTextureNumForName(const char *name, int snum)
 // Totally rewritten by Lee Killough to use less memory,
 // to avoid using alloca(), and to improve performance.
 // cph - new wad lump handling, calls cache functions but acquires no locks
+//
+// Now builds the level's wall composites at once on the job pool, and
+// only lists the rest to load, nearest the player first; R_PrecacheStep
+// works through it a little each frame, and whatever is left after
+// precache_tics tics is loaded in one go.
+
+typedef enum {
+  PRECACHE_FLAT,
+  PRECACHE_TEXTURE,
+  PRECACHE_SPRITE
+} precache_e;
+
+typedef struct {
+  precache_e type;
+  int num;
+  fixed_t dist;
+} precachejob_t;
+
+int precache_budget = 2000;  // microseconds of each frame to spend
+int precache_tics = 35;      // tics before the rest is loaded at once
+
+static precachejob_t *precachejobs;
+static int numprecachejobs, maxprecachejobs, precachedone;
+
+// without a usable clock, this many jobs a frame
+#define PRECACHE_UNTIMED_JOBS 8
 
 static INLINE void precache_lump(int l)
 {
   W_CacheLumpNum(l); W_UnlockLumpNum(l);
 }
 
+static void R_AddPrecacheJob(precache_e type, int num, fixed_t dist)
+{
+  if (numprecachejobs == maxprecachejobs)
+  {
+    maxprecachejobs = maxprecachejobs ? maxprecachejobs*2 : 256;
+    precachejobs = realloc(precachejobs, maxprecachejobs*sizeof(*precachejobs));
+  }
+  precachejobs[numprecachejobs].type = type;
+  precachejobs[numprecachejobs].num = num;
+  precachejobs[numprecachejobs].dist = dist;
+  numprecachejobs++;
+}
+
+static int R_ComparePrecacheJobs(const void *a, const void *b)
+{
+  const precachejob_t *ja = a, *jb = b;
+
+  if (ja->dist != jb->dist)
+    return ja->dist < jb->dist ? -1 : 1;
+  if (ja->type != jb->type)
+    return ja->type - jb->type;
+  return ja->num - jb->num;
+}
+
+static void R_RunPrecacheJob(const precachejob_t *job)
+{
+  switch (job->type)
+  {
+    case PRECACHE_FLAT:
+      precache_lump(firstflat + job->num);
+      break;
+    case PRECACHE_TEXTURE:
+      R_CacheTextureCompositePatchNum(job->num);
+      R_UnlockTextureCompositePatchNum(job->num);
+      break;
+    case PRECACHE_SPRITE:
+      {
+        int j = sprites[job->num].numframes;
+        while (--j >= 0)
+          {
+            short *sflump = sprites[job->num].spriteframes[j].lump;
+            int k = 7;
+            do
+              {
+                R_CachePatchNum(firstspritelump + sflump[k]);
+                R_UnlockPatchNum(firstspritelump + sflump[k]);
+              }
+            while (--k >= 0);
+          }
+      }
+      break;
+  }
+}
+
 void R_PrecacheLevel(void)
 {
   register int i;
-  register uint8_t *hitlist;
+  fixed_t *hitlist;
+  fixed_t ox = 0, oy = 0;
 
-  if (demoplayback)
-    return;
+  numprecachejobs = precachedone = 0;
+
+  // distances are from where the player starts
+  if (players[consoleplayer].mo)
+  {
+    ox = players[consoleplayer].mo->x;
+    oy = players[consoleplayer].mo->y;
+  }
 
   {
     size_t size = numflats > numsprites  ? numflats : numsprites;
-    hitlist = Z_Malloc(((size_t)numtextures > size) ? (size_t)numtextures : size, PU_STATIC, 0);
+    size = ((size_t)numtextures > size) ? (size_t)numtextures : size;
+    hitlist = Z_Malloc(size * sizeof(*hitlist), PU_STATIC, 0);
   }
 
   // Precache flats.
 
-  memset(hitlist, 0, numflats);
+  for (i = numflats; --i >= 0; )
+    hitlist[i] = INT_MAX;
 
   for (i = numsectors; --i >= 0; )
-    hitlist[sectors[i].floorpic] = hitlist[sectors[i].ceilingpic] = 1;
+  {
+    fixed_t dist = P_AproxDistance(sectors[i].soundorg.x - ox,
+                                   sectors[i].soundorg.y - oy);
+    if (dist < hitlist[sectors[i].floorpic])
+      hitlist[sectors[i].floorpic] = dist;
+    if (dist < hitlist[sectors[i].ceilingpic])
+      hitlist[sectors[i].ceilingpic] = dist;
+  }
 
   for (i = numflats; --i >= 0; )
-    if (hitlist[i])
-      precache_lump(firstflat + i);
+    if (hitlist[i] != INT_MAX && !flatpixels[i])
+      R_AddPrecacheJob(PRECACHE_FLAT, i, hitlist[i]);
 
   // Precache textures.
 
-  memset(hitlist, 0, numtextures);
+  for (i = numtextures; --i >= 0; )
+    hitlist[i] = INT_MAX;
 
-  for (i = numsides; --i >= 0;)
-    hitlist[sides[i].bottomtexture] =
-      hitlist[sides[i].toptexture] =
-      hitlist[sides[i].midtexture] = 1;
+  for (i = numlines; --i >= 0; )
+  {
+    const line_t *line = &lines[i];
+    fixed_t dist = P_AproxDistance((line->v1->x >> 1) + (line->v2->x >> 1) - ox,
+                                   (line->v1->y >> 1) + (line->v2->y >> 1) - oy);
+    int s;
+
+    for (s = 0; s < 2; s++)
+      if (line->sidenum[s] != NO_INDEX)
+      {
+        const side_t *side = &sides[line->sidenum[s]];
+        if (dist < hitlist[side->bottomtexture])
+          hitlist[side->bottomtexture] = dist;
+        if (dist < hitlist[side->toptexture])
+          hitlist[side->toptexture] = dist;
+        if (dist < hitlist[side->midtexture])
+          hitlist[side->midtexture] = dist;
+      }
+  }
 
   // Sky texture is always present.
   // Note that F_SKY1 is the name used to
@@ -536,41 +733,91 @@ void R_PrecacheLevel(void)
   //  a wall texture, with an episode dependend
   //  name.
 
-  hitlist[skytexture] = 1;
+  hitlist[skytexture] = 0;
 
-  for (i = numtextures; --i >= 0; )
-    if (hitlist[i])
+  // Composites are built here, all at once on the job pool, rather than
+  // a few a frame, so building one never stalls a frame once play starts.
+  // Single-patch textures only need their patch, which the list loads.
+  {
+    int *texlist = malloc(numtextures * sizeof(*texlist));
+    int count = 0;
+
+    for (i = numtextures; --i >= 0; )
+      if (hitlist[i] != INT_MAX)
       {
-        texture_t *texture = textures[i];
-        int j = texture->patchcount;
-        while (--j >= 0)
-          precache_lump(texture->patches[j].patch);
+        if (textures[i]->singlepatch)
+          R_AddPrecacheJob(PRECACHE_TEXTURE, i, hitlist[i]);
+        else
+          texlist[count++] = i;
       }
 
+    R_BuildTextureComposites(texlist, count);
+    free(texlist);
+  }
+
   // Precache sprites.
-  memset(hitlist, 0, numsprites);
+
+  for (i = numsprites; --i >= 0; )
+    hitlist[i] = INT_MAX;
 
   {
     thinker_t *th = NULL;
     while ((th = P_NextThinker(th,th_all)) != NULL)
       if (th->function == P_MobjThinker)
-        hitlist[((mobj_t *)th)->sprite] = 1;
-  }
-
-  for (i=numsprites; --i >= 0;)
-    if (hitlist[i])
       {
-        int j = sprites[i].numframes;
-        while (--j >= 0)
-          {
-            short *sflump = sprites[i].spriteframes[j].lump;
-            int k = 7;
-            do
-              precache_lump(firstspritelump + sflump[k]);
-            while (--k >= 0);
-          }
+        const mobj_t *mo = (mobj_t *)th;
+        fixed_t dist = P_AproxDistance(mo->x - ox, mo->y - oy);
+        if (dist < hitlist[mo->sprite])
+          hitlist[mo->sprite] = dist;
       }
+  }
+
+  for (i = numsprites; --i >= 0; )
+    if (hitlist[i] != INT_MAX)
+      R_AddPrecacheJob(PRECACHE_SPRITE, i, hitlist[i]);
+
   Z_Free(hitlist);
+
+  qsort(precachejobs, numprecachejobs, sizeof(*precachejobs), R_ComparePrecacheJobs);
+}
+
+//
+// R_PrecacheStep
+// Works through the precache list for up to precache_budget us,
+// or all of it once precache_tics tics of the level have gone by.
+//
+
+void R_PrecacheStep(void)
+{
+  int64_t start;
+  int jobs = 0;
+
+  if (precachedone == numprecachejobs)
+    return;
+
+  start = I_GetTimeUS();
+
+  while (precachedone < numprecachejobs)
+  {
+    if (leveltime < precache_tics)
+    {
+      if (start ? I_GetTimeUS() - start >= precache_budget
+                : jobs >= PRECACHE_UNTIMED_JOBS)
+        break;
+    }
+    R_RunPrecacheJob(&precachejobs[precachedone++]);
+    jobs++;
+  }
+
+  if (precachedone == numprecachejobs)
+    lprintf(LO_INFO, "R_PrecacheStep: %d graphics loaded by tic %d\n",
+            numprecachejobs, leveltime);
+}
+
+void R_PrecacheProgress(int *done, int *total)
+{
+  *done = precachedone;
+  *total = numprecachejobs;
 }
 
 // Proff - Added for OpenGL
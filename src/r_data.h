@@ -36,6 +36,7 @@
 #ifndef __R_DATA__
 #define __R_DATA__
 
+#include <retro_inline.h>
 #include "r_defs.h"
 #include "r_state.h"
 #include "r_patch.h"
@@ -63,6 +64,9 @@ typedef struct
   // CPhipps - end of additions
   short width, height;
   short patchcount;      // All the patches[patchcount] are drawn
+  // One patch at (0,0): if it is solid and exactly the texture's size,
+  // the texture uses the patch's own rpatch_t instead of a composite
+  dbool singlepatch;
   texpatch_t patches[1]; // back-to-front into the cached texture.
 } texture_t;
 
@@ -72,10 +76,26 @@ extern texture_t **textures;
 
 const uint8_t *R_GetTextureColumn(const rpatch_t *texpatch, int col);
 
+// R_GetTextureColumn without the call, for the seg loop. A composite's
+// columns lie back to back, height texels each (see
+// createTextureCompositePatch and R_LoadCachedPatch), so the wrapped
+// column is found by arithmetic. Only negative columns of textures whose
+// width is not a power of two need the wrap to the full width first.
+static INLINE const uint8_t *R_TextureColumn(const rpatch_t *texpatch, int col)
+{
+  if (col < 0 && (unsigned)texpatch->width != texpatch->widthmask + 1)
+    return R_GetTextureColumn(texpatch, col);
+  return texpatch->pixels + (col & texpatch->widthmask) * texpatch->height;
+}
+
 
 // I/O, setting up the stuff.
 void R_InitData (void);
 void R_PrecacheLevel (void);
+void R_BuildFlatArena (void);        // once the level's sectors are in
+void R_PrecacheStep (void);          // call once a frame
+void R_PrecacheProgress (int *done, int *total);
+extern int precache_budget, precache_tics;
 
 
 // Retrieval.
@@ -93,6 +113,7 @@ int R_SafeTextureNumForName (const char *name, int snum);
 int R_CheckTextureNumForName (const char *name);
 
 int R_ColormapNumForName(const char *name);      // killough 4/4/98
+extern int firstcolormaplump, lastcolormaplump;  // killough 4/17/98
 /* cph 2001/11/17 - new func to do lighting calcs and get suitable colour map */
 const lighttable_t* R_ColourMap(int lightlevel, fixed_t spryscale);
 
@@ -84,24 +84,60 @@ typedef struct
 // Stores things/mobjs.
 //
 
-typedef struct
+typedef struct sector_s
 {
+  // What the renderer reads of each sector it draws comes first, so
+  // that the BSP walk and the wall and plane setup touch only the
+  // first few cache lines of it, and what only the game uses follows.
+
+  fixed_t floorheight;
+  fixed_t ceilingheight;
+
+  // killough 3/7/98: support flat heights drawn at another sector's heights
+  int heightsec;    // other sector, or -1 if no other sector
+
+  int bottommap, midmap, topmap; // killough 4/4/98: dynamic colormaps
+
+  // killough 10/98: support skies coming from sidedefs. Allows scrolling
+  // skies and other effects. No "level info" kind of lump is needed,
+  // because you can use an arbitrary number of skies per level with this
+  // method. This field only applies when skyflatnum is used for floorpic
+  // or ceilingpic, because the rest of Doom needs to know which is sky
+  // and which isn't, etc.
+
+  int sky;
+
+  // killough 3/7/98: floor and ceiling texture offsets
+  // (R_LineFlags compares from here to lightlevel in one go)
+  fixed_t   floor_xoffs,   floor_yoffs;
+  fixed_t ceiling_xoffs, ceiling_yoffs;
+
+  // killough 4/11/98: support for lightlevels coming from another sector
+  int floorlightsec, ceilinglightsec;
+
+  short floorpic;
+  short ceilingpic;
+  short lightlevel;
+  short special;
+  short oldspecial;      //jff 2/16/98 remembers if sector WAS secret (automap)
+  short tag;
+
+  // R_FakeFlat copies only the fields above into its stand-in sectors
+
   // [kb] for R_FixWiggle()
   int	cachedheight;
   int	scaleindex;
 
+  int validcount;        // if == validcount, already checked
+  mobj_t *thinglist;     // list of mobjs in sector
+
   int iSectorID; // proff 04/05/2000: needed for OpenGL and used in debugmode by the HUD to draw sectornum
   dbool   no_toptextures;
   dbool   no_bottomtextures;
-  fixed_t floorheight;
-  fixed_t ceilingheight;
-  int nexttag,firsttag;  // killough 1/30/98: improves searches for tags.
   int soundtraversed;    // 0 = untraversed, 1,2 = sndlines-1
   mobj_t *soundtarget;   // thing that made a sound (or null)
   int blockbox[4];       // mapblock bounding box for height changes
   degenmobj_t soundorg;  // origin for any sounds played by the sector
-  int validcount;        // if == validcount, already checked
-  mobj_t *thinglist;     // list of mobjs in sector
 
   /* killough 8/28/98: friction is a sector property, not an mobj property.
    * these fields used to be in mobj_t, but presented performance problems
@@ -119,11 +155,6 @@ typedef struct
   int prevsec;     // -1 or number of sector for previous step
   int nextsec;     // -1 or number of next step sector
 
-  // killough 3/7/98: support flat heights drawn at another sector's heights
-  int heightsec;    // other sector, or -1 if no other sector
-
-  int bottommap, midmap, topmap; // killough 4/4/98: dynamic colormaps
-
   // list of mobjs that are at least partially in the sector
   // thinglist is a subset of touching_thinglist
   struct msecnode_s *touching_thinglist;               // phares 3/14/98
@@ -131,28 +162,12 @@ typedef struct
   int linecount;
   struct line_s **lines;
 
-  // killough 10/98: support skies coming from sidedefs. Allows scrolling
-  // skies and other effects. No "level info" kind of lump is needed,
-  // because you can use an arbitrary number of skies per level with this
-  // method. This field only applies when skyflatnum is used for floorpic
-  // or ceilingpic, because the rest of Doom needs to know which is sky
-  // and which isn't, etc.
-
-  int sky;
-
-  // killough 3/7/98: floor and ceiling texture offsets
-  fixed_t   floor_xoffs,   floor_yoffs;
-  fixed_t ceiling_xoffs, ceiling_yoffs;
-
-  // killough 4/11/98: support for lightlevels coming from another sector
-  int floorlightsec, ceilinglightsec;
-
-  short floorpic;
-  short ceilingpic;
-  short lightlevel;
-  short special;
-  short oldspecial;      //jff 2/16/98 remembers if sector WAS secret (automap)
-  short tag;
+  // the sectors across its lines, each once, as getNextSector finds
+  // them without comp_model, and its lines with two sidedefs, in order
+  int neighborcount;
+  struct sector_s **neighbors;
+  int twosidedcount;
+  struct line_s **twosided;
 } sector_t;
 
 //
@@ -202,7 +217,6 @@ typedef struct line_s
   sector_t *backsector;
   int validcount;        // if == validcount, already checked
   void *specialdata;     // thinker_t for reversable actions
-  int firsttag,nexttag;  // killough 4/17/98: improves searches for tags.
   int r_validcount;      // cph: if == gametic, r_flags already done
   enum {                 // cph:
     RF_TOP_TILE  = 1,     // Upper texture needs tiling
@@ -230,6 +244,56 @@ typedef struct line_s
 // destroyed, with the links changed appropriately.
 //
 // For the links, NULL means top or end of list.
+//
+// With SECNODE_INDEX_LINKS, the default where pointers are 64 bits, the
+// four links and the sector are 32-bit indices into the level's node
+// chunks and sectors[], which shrinks a node from 56 bytes to 32 so the
+// threads friction, pushers and P_CheckSector walk take half the cache
+// lines. Index 0 ends a thread. Read and write the links through the
+// SN_ macros below, which are plain field accesses in pointer mode.
+
+#if !defined(SECNODE_INDEX_LINKS) && !defined(SECNODE_POINTER_LINKS) && \
+    defined(UINTPTR_MAX) && UINTPTR_MAX > 0xffffffffu
+#define SECNODE_INDEX_LINKS
+#endif
+
+#ifdef SECNODE_INDEX_LINKS
+
+typedef uint32_t secnodelink_t;
+
+typedef struct msecnode_s
+{
+  struct mobj_s     *m_thing;  // this object
+  secnodelink_t      m_tprev;  // prev msecnode_t for this thing
+  secnodelink_t      m_tnext;  // next msecnode_t for this thing
+  secnodelink_t      m_sprev;  // prev msecnode_t for this sector
+  secnodelink_t      m_snext;  // next msecnode_t for this sector
+  uint32_t           m_sector; // index of a sector containing this object
+  uint32_t           m_self : 31; // this node's own index
+  uint32_t           visited : 1; // killough 4/4/98, 4/7/98: used in search algorithms
+} msecnode_t;
+
+// Nodes live in fixed chunks of PU_LEVEL memory that never move, so a
+// node's address stays good while it is in use (see P_GetSecnode).
+
+#define SECNODE_CHUNKSHIFT 9
+#define SECNODE_CHUNKMASK  ((1u << SECNODE_CHUNKSHIFT) - 1)
+
+extern msecnode_t **secnodechunks;
+
+static INLINE msecnode_t *SN_Node(secnodelink_t link)
+{
+  return link ? secnodechunks[link >> SECNODE_CHUNKSHIFT] +
+    (link & SECNODE_CHUNKMASK) : NULL;
+}
+
+#define SN_LINK(n)          ((n) ? (secnodelink_t)(n)->m_self : 0)
+#define SN_SECTOR(n)        (sectors + (n)->m_sector)
+#define SN_SETSECTOR(n, s)  ((n)->m_sector = (uint32_t)((s) - sectors))
+
+#else
+
+typedef struct msecnode_s *secnodelink_t;
 
 typedef struct msecnode_s
 {
@@ -242,6 +306,18 @@ typedef struct msecnode_s
   dbool   visited; // killough 4/4/98, 4/7/98: used in search algorithms
 } msecnode_t;
 
+#define SN_Node(link)       (link)
+#define SN_LINK(n)          (n)
+#define SN_SECTOR(n)        ((n)->m_sector)
+#define SN_SETSECTOR(n, s)  ((n)->m_sector = (s))
+
+#endif
+
+#define SN_TPREV(n) SN_Node((n)->m_tprev)
+#define SN_TNEXT(n) SN_Node((n)->m_tnext)
+#define SN_SPREV(n) SN_Node((n)->m_sprev)
+#define SN_SNEXT(n) SN_Node((n)->m_snext)
+
 //
 // The LineSeg.
 //
@@ -280,6 +356,9 @@ typedef struct subsector_s
 {
   sector_t *sector;
   int numlines, firstline;
+  // a box of half-size less than interior about (interiorx, interiory)
+  // meets no linedef as P_CreateSecNodeList tests them
+  fixed_t interiorx, interiory, interior;
 } subsector_t;
 
 
@@ -324,7 +403,8 @@ typedef struct drawseg_s
   // Pointers to lists for sprite clipping,
   // all three adjusted so [x1] is first value.
 
-  int *sprtopclip, *sprbottomclip, *maskedtexturecol; // dropoff overflow
+  int16_t *sprtopclip, *sprbottomclip;
+  int *maskedtexturecol;
 } drawseg_t;
 
 // proff: Added for OpenGL
@@ -409,15 +489,14 @@ typedef struct
 
 typedef struct visplane
 {
-  struct visplane *next;        // Next visplane in hash chain -- killough
   int picnum, lightlevel, minx, maxx;
   fixed_t height;
   fixed_t xoffs, yoffs;         // killough 2/28/98: Support scrolling flats
-  unsigned int pad1;          // leave pads for [minx-1]/[maxx+1]
-  unsigned int top[MAX_SCREENWIDTH];
-  unsigned int pad2, pad3;    // killough 2/8/98, 4/25/98
-  unsigned int bottom[MAX_SCREENWIDTH];
-  unsigned int pad4; // dropoff overflow
+  uint16_t pad1;              // leave pads for [minx-1]/[maxx+1]
+  uint16_t top[MAX_SCREENWIDTH]; // 0xffff where the plane has no rows
+  uint16_t pad2, pad3;        // killough 2/8/98, 4/25/98
+  uint16_t bottom[MAX_SCREENWIDTH];
+  uint16_t pad4;
 } visplane_t;
 
 #endif
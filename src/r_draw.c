@@ -43,6 +43,11 @@
 #include "g_game.h"
 #include "am_map.h"
 #include "lprintf.h"
+#include "i_thread.h"
+#include "r_simd.h"
+#include "r_mipmap.h"
+#include "r_rounded.h"
+#include "r_profile.h"
 
 //
 // All drawing to the view buffer is accomplished in this file.
@@ -56,6 +61,7 @@
 uint8_t *viewimage;
 int  viewwidth;
 int  scaledviewwidth;
+int  scaledviewheight;
 int  viewheight;
 
 // Color tables for different players,
@@ -79,14 +85,26 @@ typedef enum
    COL_FLEXADD
 } columntype_e;
 
-static int    temp_x = 0;
-static int    tempyl[4], tempyh[4];
-static uint16_t short_tempbuf[MAX_SCREENHEIGHT * 4];
-static int    startx = 0;
-static int    temptype = COL_NONE;
-static int    commontop, commonbot;
+// Columns batched in tempbuf before a flush. Sixteen when the quad
+// flush moves rows eight pixels at a time with 128-bit stores, four
+// otherwise. Columns are lit as they are written, so a batch carries on
+// across colormap changes and only breaks on a new column type or a gap.
+#ifdef R_SIMD
+#define TEMPBUF_SHIFT 4
+#else
+#define TEMPBUF_SHIFT 2
+#endif
+#define TEMPBUF_COLS (1 << TEMPBUF_SHIFT)
+
+// Each renderer thread batches its own columns
+static THREAD_LOCAL int    temp_x = 0;
+static THREAD_LOCAL int    tempyl[TEMPBUF_COLS], tempyh[TEMPBUF_COLS];
+static THREAD_LOCAL pixel_t short_tempbuf[MAX_SCREENHEIGHT * TEMPBUF_COLS];
+static THREAD_LOCAL int    startx = 0;
+static THREAD_LOCAL int    temptype = COL_NONE;
+static THREAD_LOCAL int    commontop, commonbot;
 // SoM 7-28-04: Fix the fuzz problem.
-static const uint8_t   *tempfuzzmap;
+static THREAD_LOCAL const uint8_t   *tempfuzzmap;
 
 //
 // Spectre/Invisibility.
@@ -105,9 +123,12 @@ static const int fuzzoffset_org[FUZZTABLE] = {
   FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF
 };
 
-static int fuzzoffset[FUZZTABLE];
+// The fuzz offsets in pixels, repeated for a whole column, so a run of
+// count pixels starting at fuzzpos reads fuzzstream[fuzzpos..fuzzpos+count)
+// without wrapping
+static int fuzzstream[FUZZTABLE + MAX_SCREENHEIGHT];
 
-static int fuzzpos = 0;
+static THREAD_LOCAL int fuzzpos = 0;
 
 // render pipelines
 #define RDC_STANDARD      1
@@ -123,6 +144,8 @@ static int fuzzpos = 0;
 draw_vars_t drawvars = { 
   NULL, // short_topleft
   NULL, // int_topleft
+  0, // short_pitch
+  1, // short_colpitch
   RDRAW_FILTER_POINT, // filterwall
   RDRAW_FILTER_POINT, // filterfloor
   RDRAW_FILTER_POINT, // filtersprite
@@ -134,7 +157,9 @@ draw_vars_t drawvars = {
 
   // 49152 = FRACUNIT * 0.75
   // 81920 = FRACUNIT * 1.25
-  49152 // mag_threshold
+  49152, // mag_threshold
+
+  0 // column_major
 };
 
 //
@@ -157,13 +182,16 @@ static void R_QuadFlushError(void)
    I_Error("R_FlushQuadColumn called without being initialized.\n");
 }
 
-static void (*R_FlushWholeColumns)(void) = R_FlushWholeError;
-static void (*R_FlushHTColumns)(void)    = R_FlushHTError;
-static void (*R_FlushQuadColumn)(void) = R_QuadFlushError;
+static THREAD_LOCAL void (*R_FlushWholeColumns)(void) = R_FlushWholeError;
+static THREAD_LOCAL void (*R_FlushHTColumns)(void)    = R_FlushHTError;
+static THREAD_LOCAL void (*R_FlushQuadColumn)(void) = R_QuadFlushError;
 
 static void R_FlushColumns(void)
 {
-   if(temp_x != 4 || commontop >= commonbot)
+   R_ProfileCount(RPC_BATCHES, 1);
+   R_ProfileCount(RPC_BATCHCOLUMNS, temp_x);
+   R_ProfileCount(RPC_FULLBATCHES, temp_x == TEMPBUF_COLS);
+   if(temp_x != TEMPBUF_COLS || commontop >= commonbot)
       R_FlushWholeColumns();
    else
    {
@@ -198,21 +226,24 @@ void R_ResetColumnBuffer(void)
  * Flushes the entire columns in the buffer, one at a time.
  * This is used when a quad flush isn't possible.
  * Opaque version -- no remapping whatsoever.
+ *
+ * The opaque flushes take the row pitch as an argument so that they can
+ * be built for each fixed pitch further down.
 */
-static void R_FlushWhole16(void)
+static INLINE void R_FlushWholeRows16(const int pitch)
 {
    while(--temp_x >= 0)
    {
       int yl           = tempyl[temp_x];
-      uint16_t *source = &short_tempbuf[temp_x + (yl << 2)];
-      uint16_t *dest   = drawvars.short_topleft + yl * SURFACE_SHORT_PITCH + startx + temp_x;
+      pixel_t *source = &short_tempbuf[temp_x + (yl << TEMPBUF_SHIFT)];
+      pixel_t *dest   = drawvars.short_topleft + yl * pitch + (startx + temp_x) * drawvars.short_colpitch;
       int   count      = tempyh[temp_x] - yl + 1;
       
       while(--count >= 0)
       {
          *dest   = *source;
-         source += 4;
-         dest   += SURFACE_SHORT_PITCH;
+         source += TEMPBUF_COLS;
+         dest   += pitch;
       }
    }
 }
@@ -224,14 +255,14 @@ static void R_FlushWhole16(void)
 // preparation for a quad flush.
 // Opaque version -- no remapping whatsoever.
 //
-static void R_FlushHT16(void)
+static INLINE void R_FlushHTRows16(const int pitch)
 {
-   uint16_t *source;
-   uint16_t *dest;
+   pixel_t *source;
+   pixel_t *dest;
    int count, colnum = 0;
    int yl, yh;
 
-   while(colnum < 4)
+   while(colnum < TEMPBUF_COLS)
    {
       yl = tempyl[colnum];
       yh = tempyh[colnum];
@@ -239,54 +270,314 @@ static void R_FlushHT16(void)
       // flush column head
       if(yl < commontop)
       {
-         source = &short_tempbuf[colnum + (yl << 2)];
-         dest   = drawvars.short_topleft + yl * SURFACE_SHORT_PITCH + startx + colnum;
+         source = &short_tempbuf[colnum + (yl << TEMPBUF_SHIFT)];
+         dest   = drawvars.short_topleft + yl * pitch + (startx + colnum) * drawvars.short_colpitch;
          count  = commontop - yl;
          
          while(--count >= 0)
          {
             *dest = *source;
-            source += 4;
-            dest += SURFACE_SHORT_PITCH;
+            source += TEMPBUF_COLS;
+            dest += pitch;
          }
       }
       
       // flush column tail
       if(yh > commonbot)
       {
-         source = &short_tempbuf[colnum + ((commonbot + 1) << 2)];
-         dest   = drawvars.short_topleft + (commonbot + 1) * SURFACE_SHORT_PITCH + startx + colnum;
+         source = &short_tempbuf[colnum + ((commonbot + 1) << TEMPBUF_SHIFT)];
+         dest   = drawvars.short_topleft + (commonbot + 1) * pitch + (startx + colnum) * drawvars.short_colpitch;
          count  = yh - commonbot;
          
          while(--count >= 0)
          {
             *dest = *source;
 
-            source += 4;
-            dest += SURFACE_SHORT_PITCH;
+            source += TEMPBUF_COLS;
+            dest += pitch;
          }
       }         
       ++colnum;
    }
 }
 
-static void R_FlushQuad16(void)
+#if defined(PRBOOM_32BPP) && defined(R_SIMD)
+//
+// R_Transpose32x4
+//
+// The 4x4 quarter of R_Transpose8x8 that fits four 128-bit registers
+// of XRGB8888 pixels.
+//
+static INLINE void R_Transpose32x4(pixel_t *dest, int destpitch,
+                                   const pixel_t *src, int srcpitch)
+{
+#if defined(R_SIMD_SSE2)
+   __m128i a0 = _mm_loadu_si128((const __m128i *)(src + 0 * srcpitch));
+   __m128i a1 = _mm_loadu_si128((const __m128i *)(src + 1 * srcpitch));
+   __m128i a2 = _mm_loadu_si128((const __m128i *)(src + 2 * srcpitch));
+   __m128i a3 = _mm_loadu_si128((const __m128i *)(src + 3 * srcpitch));
+   __m128i b0 = _mm_unpacklo_epi32(a0, a1);
+   __m128i b1 = _mm_unpacklo_epi32(a2, a3);
+   __m128i b2 = _mm_unpackhi_epi32(a0, a1);
+   __m128i b3 = _mm_unpackhi_epi32(a2, a3);
+
+   _mm_storeu_si128((__m128i *)(dest + 0 * destpitch), _mm_unpacklo_epi64(b0, b1));
+   _mm_storeu_si128((__m128i *)(dest + 1 * destpitch), _mm_unpackhi_epi64(b0, b1));
+   _mm_storeu_si128((__m128i *)(dest + 2 * destpitch), _mm_unpacklo_epi64(b2, b3));
+   _mm_storeu_si128((__m128i *)(dest + 3 * destpitch), _mm_unpackhi_epi64(b2, b3));
+#else
+   uint32x4x2_t t0 = vtrnq_u32(vld1q_u32(src + 0 * srcpitch), vld1q_u32(src + 1 * srcpitch));
+   uint32x4x2_t t1 = vtrnq_u32(vld1q_u32(src + 2 * srcpitch), vld1q_u32(src + 3 * srcpitch));
+
+   vst1q_u32(dest + 0 * destpitch, vcombine_u32(vget_low_u32(t0.val[0]), vget_low_u32(t1.val[0])));
+   vst1q_u32(dest + 1 * destpitch, vcombine_u32(vget_low_u32(t0.val[1]), vget_low_u32(t1.val[1])));
+   vst1q_u32(dest + 2 * destpitch, vcombine_u32(vget_high_u32(t0.val[0]), vget_high_u32(t1.val[0])));
+   vst1q_u32(dest + 3 * destpitch, vcombine_u32(vget_high_u32(t0.val[1]), vget_high_u32(t1.val[1])));
+#endif
+}
+#endif
+
+//
+// R_Transpose8x8
+//
+// Transposes an 8x8 block of pixels: dest[j*destpitch+i] becomes
+// src[i*srcpitch+j]. Used to move between tempbuf or screen rows and
+// the columns of the column-major view buffer.
+//
+static void R_Transpose8x8(pixel_t *dest, int destpitch,
+                           const pixel_t *src, int srcpitch)
 {
-   uint16_t *source = &short_tempbuf[commontop << 2];
-   uint16_t *dest   = drawvars.short_topleft + commontop * SURFACE_SHORT_PITCH + startx;
+#if defined(PRBOOM_32BPP) && defined(R_SIMD)
+   R_Transpose32x4(dest, destpitch, src, srcpitch);
+   R_Transpose32x4(dest + 4, destpitch, src + 4 * srcpitch, srcpitch);
+   R_Transpose32x4(dest + 4 * destpitch, destpitch, src + 4, srcpitch);
+   R_Transpose32x4(dest + 4 * destpitch + 4, destpitch, src + 4 * srcpitch + 4, srcpitch);
+#elif defined(R_SIMD_SSE2)
+   __m128i a0, a1, a2, a3, a4, a5, a6, a7;
+   __m128i b0, b1, b2, b3, b4, b5, b6, b7;
+
+   a0 = _mm_loadu_si128((const __m128i *)(src + 0 * srcpitch));
+   a1 = _mm_loadu_si128((const __m128i *)(src + 1 * srcpitch));
+   a2 = _mm_loadu_si128((const __m128i *)(src + 2 * srcpitch));
+   a3 = _mm_loadu_si128((const __m128i *)(src + 3 * srcpitch));
+   a4 = _mm_loadu_si128((const __m128i *)(src + 4 * srcpitch));
+   a5 = _mm_loadu_si128((const __m128i *)(src + 5 * srcpitch));
+   a6 = _mm_loadu_si128((const __m128i *)(src + 6 * srcpitch));
+   a7 = _mm_loadu_si128((const __m128i *)(src + 7 * srcpitch));
+
+   // pairs of rows interleaved, then pairs of pairs
+   b0 = _mm_unpacklo_epi16(a0, a1);
+   b1 = _mm_unpackhi_epi16(a0, a1);
+   b2 = _mm_unpacklo_epi16(a2, a3);
+   b3 = _mm_unpackhi_epi16(a2, a3);
+   b4 = _mm_unpacklo_epi16(a4, a5);
+   b5 = _mm_unpackhi_epi16(a4, a5);
+   b6 = _mm_unpacklo_epi16(a6, a7);
+   b7 = _mm_unpackhi_epi16(a6, a7);
+
+   a0 = _mm_unpacklo_epi32(b0, b2);
+   a1 = _mm_unpackhi_epi32(b0, b2);
+   a2 = _mm_unpacklo_epi32(b1, b3);
+   a3 = _mm_unpackhi_epi32(b1, b3);
+   a4 = _mm_unpacklo_epi32(b4, b6);
+   a5 = _mm_unpackhi_epi32(b4, b6);
+   a6 = _mm_unpacklo_epi32(b5, b7);
+   a7 = _mm_unpackhi_epi32(b5, b7);
+
+   _mm_storeu_si128((__m128i *)(dest + 0 * destpitch), _mm_unpacklo_epi64(a0, a4));
+   _mm_storeu_si128((__m128i *)(dest + 1 * destpitch), _mm_unpackhi_epi64(a0, a4));
+   _mm_storeu_si128((__m128i *)(dest + 2 * destpitch), _mm_unpacklo_epi64(a1, a5));
+   _mm_storeu_si128((__m128i *)(dest + 3 * destpitch), _mm_unpackhi_epi64(a1, a5));
+   _mm_storeu_si128((__m128i *)(dest + 4 * destpitch), _mm_unpacklo_epi64(a2, a6));
+   _mm_storeu_si128((__m128i *)(dest + 5 * destpitch), _mm_unpackhi_epi64(a2, a6));
+   _mm_storeu_si128((__m128i *)(dest + 6 * destpitch), _mm_unpacklo_epi64(a3, a7));
+   _mm_storeu_si128((__m128i *)(dest + 7 * destpitch), _mm_unpackhi_epi64(a3, a7));
+#elif defined(R_SIMD_NEON)
+   uint16x8x2_t t0 = vtrnq_u16(vld1q_u16(src + 0 * srcpitch), vld1q_u16(src + 1 * srcpitch));
+   uint16x8x2_t t1 = vtrnq_u16(vld1q_u16(src + 2 * srcpitch), vld1q_u16(src + 3 * srcpitch));
+   uint16x8x2_t t2 = vtrnq_u16(vld1q_u16(src + 4 * srcpitch), vld1q_u16(src + 5 * srcpitch));
+   uint16x8x2_t t3 = vtrnq_u16(vld1q_u16(src + 6 * srcpitch), vld1q_u16(src + 7 * srcpitch));
+   // even and odd columns of rows 0-3 and 4-7, two columns per register
+   uint32x4x2_t e0 = vtrnq_u32(vreinterpretq_u32_u16(t0.val[0]), vreinterpretq_u32_u16(t1.val[0]));
+   uint32x4x2_t o0 = vtrnq_u32(vreinterpretq_u32_u16(t0.val[1]), vreinterpretq_u32_u16(t1.val[1]));
+   uint32x4x2_t e1 = vtrnq_u32(vreinterpretq_u32_u16(t2.val[0]), vreinterpretq_u32_u16(t3.val[0]));
+   uint32x4x2_t o1 = vtrnq_u32(vreinterpretq_u32_u16(t2.val[1]), vreinterpretq_u32_u16(t3.val[1]));
+
+#define TRANSPOSE_LO(a, b) vreinterpretq_u16_u32(vcombine_u32(vget_low_u32(a), vget_low_u32(b)))
+#define TRANSPOSE_HI(a, b) vreinterpretq_u16_u32(vcombine_u32(vget_high_u32(a), vget_high_u32(b)))
+   vst1q_u16(dest + 0 * destpitch, TRANSPOSE_LO(e0.val[0], e1.val[0]));
+   vst1q_u16(dest + 1 * destpitch, TRANSPOSE_LO(o0.val[0], o1.val[0]));
+   vst1q_u16(dest + 2 * destpitch, TRANSPOSE_LO(e0.val[1], e1.val[1]));
+   vst1q_u16(dest + 3 * destpitch, TRANSPOSE_LO(o0.val[1], o1.val[1]));
+   vst1q_u16(dest + 4 * destpitch, TRANSPOSE_HI(e0.val[0], e1.val[0]));
+   vst1q_u16(dest + 5 * destpitch, TRANSPOSE_HI(o0.val[0], o1.val[0]));
+   vst1q_u16(dest + 6 * destpitch, TRANSPOSE_HI(e0.val[1], e1.val[1]));
+   vst1q_u16(dest + 7 * destpitch, TRANSPOSE_HI(o0.val[1], o1.val[1]));
+#undef TRANSPOSE_LO
+#undef TRANSPOSE_HI
+#else
+   int i, j;
+
+   for (j = 0; j < 8; j++)
+      for (i = 0; i < 8; i++)
+         dest[j * destpitch + i] = src[i * srcpitch + j];
+#endif
+}
+
+//
+// R_FlushQuadTransposed16
+//
+// Quad flush into the column-major view buffer: each tempbuf row is
+// spread across the columns, eight rows per transposed block.
+//
+static void R_FlushQuadTransposed16(void)
+{
+   const pixel_t *source = &short_tempbuf[commontop << TEMPBUF_SHIFT];
+   const int colpitch     = drawvars.short_colpitch;
+   pixel_t *dest         = drawvars.short_topleft + commontop + startx * colpitch;
+   int count              = commonbot - commontop + 1;
+   int i;
+
+#ifdef R_SIMD
+   for (; count >= 8; count -= 8)
+   {
+      for (i = 0; i < TEMPBUF_COLS; i += 8)
+         R_Transpose8x8(dest + i * colpitch, colpitch, source + i, TEMPBUF_COLS);
+      source += 8 * TEMPBUF_COLS;
+      dest += 8;
+   }
+#endif
+
+   while(--count >= 0)
+   {
+      for (i = 0; i < TEMPBUF_COLS; i++)
+         dest[i * colpitch] = source[i];
+      source += TEMPBUF_COLS;
+      dest++;
+   }
+}
+
+static INLINE void R_FlushQuadRows16(const int pitch)
+{
+   pixel_t *source = &short_tempbuf[commontop << TEMPBUF_SHIFT];
+   pixel_t *dest   = drawvars.short_topleft + commontop * pitch + startx;
    int        count = commonbot - commontop + 1;
+#ifdef R_SIMD
+   int i;
+#endif
+
+   if (drawvars.short_colpitch != 1)
+   {
+      R_FlushQuadTransposed16();
+      return;
+   }
 
    while(--count >= 0)
    {
+#if defined(PRBOOM_32BPP) && defined(R_SIMD_SSE2)
+      for (i = 0; i < TEMPBUF_COLS; i += 4)
+         _mm_storeu_si128((__m128i *)(dest + i), _mm_loadu_si128((const __m128i *)(source + i)));
+#elif defined(PRBOOM_32BPP) && defined(R_SIMD_NEON)
+      for (i = 0; i < TEMPBUF_COLS; i += 4)
+         vst1q_u32(dest + i, vld1q_u32(source + i));
+#elif defined(R_SIMD_SSE2)
+      for (i = 0; i < TEMPBUF_COLS; i += 8)
+         _mm_storeu_si128((__m128i *)(dest + i), _mm_loadu_si128((const __m128i *)(source + i)));
+#elif defined(R_SIMD_NEON)
+      for (i = 0; i < TEMPBUF_COLS; i += 8)
+         vst1q_u16(dest + i, vld1q_u16(source + i));
+#else
       dest[0] = source[0];
       dest[1] = source[1];
       dest[2] = source[2];
       dest[3] = source[3];
-      source += 4;
-      dest += SURFACE_SHORT_PITCH;
+#endif
+      source += TEMPBUF_COLS;
+      dest += pitch;
    }
 }
 
+//
+// Opaque flushes for fixed pitches
+//
+// The pitches of the screen widths prboom-resolution offers, and 1 for
+// the column-major view buffer, get flushes with the pitch a constant,
+// so the compiler can fold the row stepping. R_SetFlushPitch picks the
+// set for the current pitch, or the general one.
+//
+
+#define FLUSH_PITCH(name, pitch) \
+static void R_FlushWhole16_##name(void) { R_FlushWholeRows16(pitch); } \
+static void R_FlushHT16_##name(void)    { R_FlushHTRows16(pitch); } \
+static void R_FlushQuad16_##name(void)  { R_FlushQuadRows16(pitch); }
+
+FLUSH_PITCH(any, drawvars.short_pitch)
+FLUSH_PITCH(1, 1)
+FLUSH_PITCH(320, 320)
+FLUSH_PITCH(640, 640)
+FLUSH_PITCH(960, 960)
+FLUSH_PITCH(1280, 1280)
+FLUSH_PITCH(1600, 1600)
+FLUSH_PITCH(1920, 1920)
+FLUSH_PITCH(2560, 2560)
+#undef FLUSH_PITCH
+
+typedef struct {
+   int pitch;
+   void (*whole)(void), (*ht)(void), (*quad)(void);
+} pitchflush_t;
+
+#define FLUSH_PITCH(name) { name, R_FlushWhole16_##name, R_FlushHT16_##name, R_FlushQuad16_##name }
+static const pitchflush_t pitchflushes[] = {
+   FLUSH_PITCH(1), FLUSH_PITCH(320), FLUSH_PITCH(640), FLUSH_PITCH(960),
+   FLUSH_PITCH(1280), FLUSH_PITCH(1600), FLUSH_PITCH(1920), FLUSH_PITCH(2560)
+};
+#undef FLUSH_PITCH
+
+// What the opaque column drawers hand R_FlushColumns
+static void (*R_FlushWhole16)(void) = R_FlushWhole16_any;
+static void (*R_FlushHT16)(void)    = R_FlushHT16_any;
+static void (*R_FlushQuad16)(void)  = R_FlushQuad16_any;
+
+static void R_SetFlushPitch(int pitch)
+{
+   int i;
+
+   R_FlushWhole16 = R_FlushWhole16_any;
+   R_FlushHT16    = R_FlushHT16_any;
+   R_FlushQuad16  = R_FlushQuad16_any;
+   for (i = 0; i < (int)(sizeof(pitchflushes) / sizeof(*pitchflushes)); i++)
+      if (pitchflushes[i].pitch == pitch)
+      {
+         R_FlushWhole16 = pitchflushes[i].whole;
+         R_FlushHT16    = pitchflushes[i].ht;
+         R_FlushQuad16  = pitchflushes[i].quad;
+      }
+}
+
+//
+// R_FuzzRun
+//
+// Darkens count pixels down a column with the fuzz stream. Each pixel reads
+// the row above or below, which may already have been written, so the run
+// has to go one pixel at a time.
+//
+static void R_FuzzRun(pixel_t *dest, int count)
+{
+   const int *fuzz = fuzzstream + fuzzpos;
+   const int pitch = drawvars.short_pitch;
+   int i;
+
+   if (count <= 0)
+      return;
+
+   for (i = 0; i < count; i++, dest += pitch)
+      // SoM 7-28-04: Fix the fuzz problem.
+      *dest = GETBLENDED16_9406(dest[fuzz[i]], 0);
+
+   fuzzpos = (fuzzpos + count) % FUZZTABLE;
+}
+
 /*
  * R_FlushWholeFuzz16
  *
@@ -296,29 +587,16 @@ static void R_FlushQuad16(void)
 */
 static void R_FlushWholeFuzz16(void)
 {
-   uint16_t *source;
-   uint16_t *dest;
+   pixel_t *dest;
    int  count, yl;
 
    while(--temp_x >= 0)
    {
       yl     = tempyl[temp_x];
-      source = &short_tempbuf[temp_x + (yl << 2)];
-      dest   = drawvars.short_topleft + yl * SURFACE_SHORT_PITCH + startx + temp_x;
+      dest   = drawvars.short_topleft + yl * drawvars.short_pitch + (startx + temp_x) * drawvars.short_colpitch;
       count  = tempyh[temp_x] - yl + 1;
       
-      while(--count >= 0)
-      {
-         // SoM 7-28-04: Fix the fuzz problem.
-         *dest = GETBLENDED16_9406(dest[fuzzoffset[fuzzpos]], 0);
-         
-         // Clamp table lookup index.
-         if(++fuzzpos == FUZZTABLE) 
-            fuzzpos = 0;
-
-         source += 4;
-         dest += SURFACE_SHORT_PITCH;
-      }
+      R_FuzzRun(dest, count);
    }
 }
 
@@ -331,12 +609,11 @@ static void R_FlushWholeFuzz16(void)
 //
 static void R_FlushHTFuzz16(void)
 {
-   uint16_t *source;
-   uint16_t *dest;
+   pixel_t *dest;
    int count, colnum = 0;
    int yl, yh;
 
-   while(colnum < 4)
+   while(colnum < TEMPBUF_COLS)
    {
       yl = tempyl[colnum];
       yh = tempyh[colnum];
@@ -344,70 +621,314 @@ static void R_FlushHTFuzz16(void)
       // flush column head
       if(yl < commontop)
       {
-         source = &short_tempbuf[colnum + (yl << 2)];
-         dest   = drawvars.short_topleft + yl * SURFACE_SHORT_PITCH + startx + colnum;
+         dest   = drawvars.short_topleft + yl * drawvars.short_pitch + (startx + colnum) * drawvars.short_colpitch;
          count  = commontop - yl;
          
-         while(--count >= 0)
-         {
-            // SoM 7-28-04: Fix the fuzz problem.
-            *dest = GETBLENDED16_9406(dest[fuzzoffset[fuzzpos]], 0);
-            
-            // Clamp table lookup index.
-            if(++fuzzpos == FUZZTABLE) 
-               fuzzpos = 0;
-
-            source += 4;
-            dest += SURFACE_SHORT_PITCH;
-         }
+         R_FuzzRun(dest, count);
       }
       
       // flush column tail
       if(yh > commonbot)
       {
-         source = &short_tempbuf[colnum + ((commonbot + 1) << 2)];
-         dest   = drawvars.short_topleft + (commonbot + 1) * SURFACE_SHORT_PITCH + startx + colnum;
+         dest   = drawvars.short_topleft + (commonbot + 1) * drawvars.short_pitch + (startx + colnum) * drawvars.short_colpitch;
          count  = yh - commonbot;
          
-         while(--count >= 0)
-         {
-            // SoM 7-28-04: Fix the fuzz problem.
-            *dest = GETBLENDED16_9406(dest[fuzzoffset[fuzzpos]], 0);
-            
-            // Clamp table lookup index.
-            if(++fuzzpos == FUZZTABLE) 
-               fuzzpos = 0;
-
-            source += 4;
-            dest += SURFACE_SHORT_PITCH;
-         }
+         R_FuzzRun(dest, count);
       }         
       ++colnum;
    }
 }
 
+#ifdef R_SIMD
+//
+// R_Darken8
+//
+// GETBLENDED16_9406(c, 0) on eight pixels at once. Each channel becomes
+// c*15/16, which fits a 16-bit lane, so red, green and blue are scaled
+// separately and merged back into 565. XRGB8888 splits into the blue and
+// red bytes and the green and X bytes, each already in a 16-bit lane.
+//
+static void R_Darken8(pixel_t *dest, const pixel_t *src)
+{
+#if defined(PRBOOM_32BPP) && defined(R_SIMD_SSE2)
+   const __m128i fifteen = _mm_set1_epi16(15);
+   const __m128i mask8   = _mm_set1_epi16(0xff);
+   int i;
+
+   for (i = 0; i < 8; i += 4)
+   {
+      __m128i c  = _mm_loadu_si128((const __m128i *)(src + i));
+      __m128i rb = _mm_srli_epi16(_mm_mullo_epi16(_mm_and_si128(c, mask8), fifteen), 4);
+      __m128i xg = _mm_srli_epi16(_mm_mullo_epi16(_mm_srli_epi16(c, 8), fifteen), 4);
+
+      _mm_storeu_si128((__m128i *)(dest + i), _mm_or_si128(rb, _mm_slli_epi16(xg, 8)));
+   }
+#elif defined(PRBOOM_32BPP)
+   int i;
+
+   for (i = 0; i < 8; i += 4)
+   {
+      uint16x8_t c  = vreinterpretq_u16_u32(vld1q_u32(src + i));
+      uint16x8_t rb = vshrq_n_u16(vmulq_n_u16(vandq_u16(c, vdupq_n_u16(0xff)), 15), 4);
+      uint16x8_t xg = vshrq_n_u16(vmulq_n_u16(vshrq_n_u16(c, 8), 15), 4);
+
+      vst1q_u32(dest + i, vreinterpretq_u32_u16(vorrq_u16(rb, vshlq_n_u16(xg, 8))));
+   }
+#elif defined(R_SIMD_SSE2)
+   const __m128i fifteen = _mm_set1_epi16(15);
+   const __m128i mask6   = _mm_set1_epi16(0x3f);
+   const __m128i mask5   = _mm_set1_epi16(0x1f);
+   __m128i c = _mm_loadu_si128((const __m128i *)src);
+   __m128i r = _mm_srli_epi16(_mm_mullo_epi16(_mm_srli_epi16(c, 11), fifteen), 4);
+   __m128i g = _mm_srli_epi16(_mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(c, 5), mask6), fifteen), 4);
+   __m128i b = _mm_srli_epi16(_mm_mullo_epi16(_mm_and_si128(c, mask5), fifteen), 4);
+
+   _mm_storeu_si128((__m128i *)dest,
+         _mm_or_si128(_mm_or_si128(_mm_slli_epi16(r, 11), _mm_slli_epi16(g, 5)), b));
+#else
+   uint16x8_t c = vld1q_u16(src);
+   uint16x8_t r = vshrq_n_u16(vmulq_n_u16(vshrq_n_u16(c, 11), 15), 4);
+   uint16x8_t g = vshrq_n_u16(vmulq_n_u16(vandq_u16(vshrq_n_u16(c, 5), vdupq_n_u16(0x3f)), 15), 4);
+   uint16x8_t b = vshrq_n_u16(vmulq_n_u16(vandq_u16(c, vdupq_n_u16(0x1f)), 15), 4);
+
+   vst1q_u16(dest, vorrq_u16(vorrq_u16(vshlq_n_u16(r, 11), vshlq_n_u16(g, 5)), b));
+#endif
+}
+#endif
+
+//
+// R_DrawRoundedColumn16
+//
+// The RoundedUV column drawers' loop for textures with cached Scale2x
+// quads (dcvars->rounded, see R_GetTextureRounded): one fetch from the
+// quads, or from the source for the middle of a texel, in place of five
+// texel reads and the Scale2x comparisons per pixel. rowmaps[y&3] turns
+// the texel into a colour, stride entries apart.
+//
+static void R_DrawRoundedColumn16(pixel_t *dest, int y, int count, fixed_t frac,
+      const draw_column_vars_t *dcvars, unsigned fracu,
+      const pixel_t *const rowmaps[4], int stride)
+{
+   const uint8_t *source = dcvars->source;
+   const uint8_t *quads = dcvars->rounded;
+   const fixed_t fracstep = dcvars->iscale;
+   const unsigned texheight = dcvars->texheight;
+   const fixed_t u = fracu << 8;
+
+   if (!(texheight & (texheight - 1)))
+   {
+      const fixed_t mask = texheight ? (fixed_t)(((texheight - 1) << 16) | 0xffff) : -1;
+
+      while (count--)
+      {
+         const fixed_t v = frac & mask;
+         const int spot = v >> 16;
+
+         *dest = rowmaps[y & 3][R_RoundedTexel(quads, source, spot, R_RoundedCorner(u, v)) * stride];
+         y++;
+         dest += TEMPBUF_COLS;
+         frac += fracstep;
+      }
+   }
+   else
+   {
+      const fixed_t heightmask = texheight << 16;
+
+      if (frac < 0)
+         while ((frac += heightmask) < 0);
+      else
+         while (frac >= heightmask)
+            frac -= heightmask;
+
+      while (count--)
+      {
+         const int spot = frac >> 16;
+
+         *dest = rowmaps[y & 3][R_RoundedTexel(quads, source, spot, R_RoundedCorner(u, frac)) * stride];
+         y++;
+         dest += TEMPBUF_COLS;
+         if ((frac += fracstep) >= heightmask)
+            frac -= heightmask;
+      }
+   }
+}
+
+#if defined(R_SIMD) && !defined(PRBOOM_32BPP)
+#define R_FILTER_SIMD
+#define FILTER_LANES 8
+
+//
+// R_FilterBlend8
+//
+// The bilinear blend of eight pixels. Rather than summing four lookups
+// into the weight-quantized VID_PAL16 tables, the four full-intensity
+// 565 taps are split into channels and multiplied by 8-bit weights that
+// sum to 256, so each channel total fits a 16-bit lane and a shift by
+// eight repacks it.
+//
+static INLINE void R_FilterBlend8(pixel_t *dest,
+      const pixel_t tap[4][FILTER_LANES], const int weight[4][FILTER_LANES])
+{
+#if defined(R_SIMD_SSE2)
+   const __m128i mask6 = _mm_set1_epi16(0x3f);
+   const __m128i mask5 = _mm_set1_epi16(0x1f);
+   __m128i r = _mm_setzero_si128(), g = r, b = r;
+   int t;
+
+   for (t = 0; t < 4; t++)
+   {
+      __m128i c = _mm_loadu_si128((const __m128i *)tap[t]);
+      __m128i w = _mm_packs_epi32(_mm_loadu_si128((const __m128i *)weight[t]),
+                                  _mm_loadu_si128((const __m128i *)(weight[t] + 4)));
+
+      r = _mm_add_epi16(r, _mm_mullo_epi16(_mm_srli_epi16(c, 11), w));
+      g = _mm_add_epi16(g, _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(c, 5), mask6), w));
+      b = _mm_add_epi16(b, _mm_mullo_epi16(_mm_and_si128(c, mask5), w));
+   }
+
+   _mm_storeu_si128((__m128i *)dest,
+         _mm_or_si128(_mm_or_si128(_mm_slli_epi16(_mm_srli_epi16(r, 8), 11),
+                                   _mm_slli_epi16(_mm_srli_epi16(g, 8), 5)),
+                      _mm_srli_epi16(b, 8)));
+#else
+   uint16x8_t r = vdupq_n_u16(0), g = r, b = r;
+   int t;
+
+   for (t = 0; t < 4; t++)
+   {
+      uint16x8_t c = vld1q_u16(tap[t]);
+      uint16x8_t w = vcombine_u16(vmovn_u32(vreinterpretq_u32_s32(vld1q_s32(weight[t]))),
+                                  vmovn_u32(vreinterpretq_u32_s32(vld1q_s32(weight[t] + 4))));
+
+      r = vmlaq_u16(r, vshrq_n_u16(c, 11), w);
+      g = vmlaq_u16(g, vandq_u16(vshrq_n_u16(c, 5), vdupq_n_u16(0x3f)), w);
+      b = vmlaq_u16(b, vandq_u16(c, vdupq_n_u16(0x1f)), w);
+   }
+
+   vst1q_u16(dest, vorrq_u16(vorrq_u16(vshlq_n_u16(vshrq_n_u16(r, 8), 11),
+                                       vshlq_n_u16(vshrq_n_u16(g, 8), 5)),
+                             vshrq_n_u16(b, 8)));
+#endif
+}
+
+//
+// R_FilterColumn16
+//
+// Draws the bilinear column rows into the temp buffer eight at a time
+// for power of two (and unwrapped) textures, leaving any remainder and
+// other heights to the drawer's scalar loop. rowmaps[y&3] turns a texel
+// into a full-intensity colour, stride entries apart, after the optional
+// translation; the dithered drawers pick a colormap per row through it.
+//
+static void R_FilterColumn16(pixel_t **dest, int *y, int *count, fixed_t *frac,
+      const draw_column_vars_t *dcvars, unsigned fracu,
+      const uint8_t *translation, const pixel_t *const rowmaps[4], int stride)
+{
+   const uint8_t *source = dcvars->source;
+   const uint8_t *nextsource = dcvars->nextsource;
+   const fixed_t fracstep = dcvars->iscale;
+   const unsigned texheight = dcvars->texheight;
+   const unsigned fracv0 = 0xffff - fracu;
+   fixed_t mask;
+   pixel_t tap[4][FILTER_LANES], row[FILTER_LANES];
+   int weight[4][FILTER_LANES];
+
+   if (texheight & (texheight - 1))
+      return;
+   mask = texheight ? (fixed_t)(((texheight - 1) << 16) | 0xffff) : -1;
+
+   while (*count >= FILTER_LANES)
+   {
+      fixed_t f = *frac;
+      int i;
+
+      for (i = 0; i < FILTER_LANES; i++)
+      {
+         const pixel_t *map = rowmaps[(*y + i) & 3];
+         const int lo = (f & mask) >> 16;
+         const int hi = ((f + (1<<16)) & mask) >> 16;
+         const unsigned fv = f & 0xffff;
+         int w0, w1, w2;
+
+         if (translation)
+         {
+            tap[0][i] = map[translation[nextsource[hi]] * stride];
+            tap[1][i] = map[translation[source[hi]] * stride];
+            tap[2][i] = map[translation[source[lo]] * stride];
+            tap[3][i] = map[translation[nextsource[lo]] * stride];
+         }
+         else
+         {
+            tap[0][i] = map[nextsource[hi] * stride];
+            tap[1][i] = map[source[hi] * stride];
+            tap[2][i] = map[source[lo] * stride];
+            tap[3][i] = map[nextsource[lo] * stride];
+         }
+         w0 = (fracu * fv) >> 24;
+         w1 = (fracv0 * fv) >> 24;
+         w2 = (fracv0 * (0xffff - fv)) >> 24;
+         weight[0][i] = w0;
+         weight[1][i] = w1;
+         weight[2][i] = w2;
+         weight[3][i] = 256 - w0 - w1 - w2;
+         f = (fixed_t)((unsigned)f + (unsigned)fracstep);
+      }
+
+      R_FilterBlend8(row, (const pixel_t (*)[FILTER_LANES])tap,
+            (const int (*)[FILTER_LANES])weight);
+      for (i = 0; i < FILTER_LANES; i++)
+      {
+         **dest = row[i];
+         *dest += TEMPBUF_COLS;
+      }
+
+      *frac = f;
+      *y += FILTER_LANES;
+      *count -= FILTER_LANES;
+   }
+}
+#endif
+
 static void R_FlushQuadFuzz16(void)
 {
-   uint16_t *source = &short_tempbuf[commontop << 2];
-   uint16_t *dest   = drawvars.short_topleft + commontop * SURFACE_SHORT_PITCH + startx;
-   int fuzz1        = fuzzpos;
-   int fuzz2        = (fuzz1 + tempyl[1]) % FUZZTABLE;
-   int fuzz3        = (fuzz2 + tempyl[2]) % FUZZTABLE;
-   int fuzz4        = (fuzz3 + tempyl[3]) % FUZZTABLE;
+   const int colpitch = drawvars.short_colpitch;
+   pixel_t *dest   = drawvars.short_topleft + commontop * drawvars.short_pitch + startx * colpitch;
+   const int *fuzz[TEMPBUF_COLS];
    int count        = commonbot - commontop + 1;
+   int i, pos = fuzzpos;
+
+   // one unwrapped fuzz stream per column of the batch
+   for (i = 0; i < TEMPBUF_COLS; i++)
+   {
+      if (i)
+         pos = (pos + tempyl[i]) % FUZZTABLE;
+      fuzz[i] = fuzzstream + pos;
+   }
 
    while(--count >= 0)
    {
-      dest[0] = GETBLENDED16_9406(dest[0 + fuzzoffset[fuzz1]], 0);
-      dest[1] = GETBLENDED16_9406(dest[1 + fuzzoffset[fuzz2]], 0);
-      dest[2] = GETBLENDED16_9406(dest[2 + fuzzoffset[fuzz3]], 0);
-      dest[3] = GETBLENDED16_9406(dest[3 + fuzzoffset[fuzz4]], 0);
-      fuzz1 = (fuzz1 + 1) % FUZZTABLE;
-      fuzz2 = (fuzz2 + 1) % FUZZTABLE;
-      fuzz3 = (fuzz3 + 1) % FUZZTABLE;
-      fuzz4 = (fuzz4 + 1) % FUZZTABLE;
-      source += 4 * sizeof(uint8_t);
-      dest += SURFACE_SHORT_PITCH * sizeof(uint8_t);
+#ifdef R_SIMD
+      // The fuzz offsets only reach into the rows above and below,
+      // so the whole row can be gathered before any of it is stored
+      pixel_t row[TEMPBUF_COLS];
+
+      for (i = 0; i < TEMPBUF_COLS; i++)
+         row[i] = dest[i * colpitch + *fuzz[i]++];
+      if (colpitch == 1)
+         for (i = 0; i < TEMPBUF_COLS; i += 8)
+            R_Darken8(dest + i, row + i);
+      else
+      {
+         for (i = 0; i < TEMPBUF_COLS; i += 8)
+            R_Darken8(row + i, row + i);
+         for (i = 0; i < TEMPBUF_COLS; i++)
+            dest[i * colpitch] = row[i];
+      }
+#else
+      for (i = 0; i < TEMPBUF_COLS; i++)
+         dest[i * colpitch] = GETBLENDED16_9406(dest[i * colpitch + *fuzz[i]++], 0);
+#endif
+      dest += drawvars.short_pitch;
    }
 }
 
@@ -430,7 +951,7 @@ static void R_DrawColumn16_PointUV(draw_column_vars_t *dcvars)
 {
    int count;
 
-   uint16_t *dest;
+   pixel_t *dest;
 
    fixed_t frac;
    const fixed_t fracstep = dcvars->iscale;
@@ -477,7 +998,7 @@ static void R_DrawColumn16_PointUV(draw_column_vars_t *dcvars)
       if (count <= 0) return;
    }
 
-   if(temp_x == 4 ||
+   if(temp_x == TEMPBUF_COLS ||
          (temp_x && (temptype != (COL_OPAQUE) || temp_x + startx != dcvars->x)))
       R_FlushColumns();
 
@@ -496,7 +1017,7 @@ static void R_DrawColumn16_PointUV(draw_column_vars_t *dcvars)
       R_FlushHTColumns = R_FlushHT16;
       R_FlushQuadColumn = R_FlushQuad16;
 
-      dest = &short_tempbuf[dcvars->yl << 2];
+      dest = &short_tempbuf[dcvars->yl << TEMPBUF_SHIFT];
 
    }
    else
@@ -510,7 +1031,7 @@ static void R_DrawColumn16_PointUV(draw_column_vars_t *dcvars)
          commonbot = dcvars->yh;
 
 
-      dest = &short_tempbuf[(dcvars->yl << 2) + temp_x];
+      dest = &short_tempbuf[(dcvars->yl << TEMPBUF_SHIFT) + temp_x];
 
    }
    temp_x += 1;
@@ -526,7 +1047,7 @@ static void R_DrawColumn16_PointUV(draw_column_vars_t *dcvars)
          {
             *dest = (V_Palette16[ ((source[(frac & ((127<<16)|0xffff))>>16]))*64 + ((64 -1)) ]);
             ;
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -537,7 +1058,7 @@ static void R_DrawColumn16_PointUV(draw_column_vars_t *dcvars)
          {
             *dest = (V_Palette16[ ((source[(frac)>>16]))*64 + ((64 -1)) ]);
             ;
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -551,11 +1072,11 @@ static void R_DrawColumn16_PointUV(draw_column_vars_t *dcvars)
             {
                *dest = (V_Palette16[ ((source[(frac & fixedt_heightmask)>>16]))*64 + ((64 -1)) ]);
                ;
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
                *dest = (V_Palette16[ ((source[(frac & fixedt_heightmask)>>16]))*64 + ((64 -1)) ]);
                ;
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
             }
             if (count & 1)
@@ -581,7 +1102,7 @@ static void R_DrawColumn16_PointUV(draw_column_vars_t *dcvars)
 
                *dest = (V_Palette16[ ((source[(frac)>>16]))*64 + ((64 -1)) ]);
                ;
-               dest += 4;
+               dest += TEMPBUF_COLS;
                if ((frac += fracstep) >= (int)heightmask) frac -= heightmask;;
 
 
@@ -595,7 +1116,7 @@ static void R_DrawColumn16_PointUV(draw_column_vars_t *dcvars)
 // simple depth color mapping
 static void R_DrawColumn16_PointUV_PointZ(draw_column_vars_t *dcvars)
 {
-   uint16_t *dest;
+   pixel_t *dest;
 
    fixed_t frac;
    const fixed_t   fracstep = dcvars->iscale;
@@ -642,7 +1163,7 @@ static void R_DrawColumn16_PointUV_PointZ(draw_column_vars_t *dcvars)
       if (count <= 0) return;
    }
 
-   if(temp_x == 4 ||
+   if(temp_x == TEMPBUF_COLS ||
          (temp_x && (temptype != (COL_OPAQUE) || temp_x + startx != dcvars->x)))
       R_FlushColumns();
 
@@ -661,7 +1182,7 @@ static void R_DrawColumn16_PointUV_PointZ(draw_column_vars_t *dcvars)
       R_FlushHTColumns = R_FlushHT16;
       R_FlushQuadColumn = R_FlushQuad16;
 
-      dest = &short_tempbuf[dcvars->yl << 2];
+      dest = &short_tempbuf[dcvars->yl << TEMPBUF_SHIFT];
 
    }
    else
@@ -675,7 +1196,7 @@ static void R_DrawColumn16_PointUV_PointZ(draw_column_vars_t *dcvars)
          commonbot = dcvars->yh;
 
 
-      dest = &short_tempbuf[(dcvars->yl << 2) + temp_x];
+      dest = &short_tempbuf[(dcvars->yl << TEMPBUF_SHIFT) + temp_x];
 
    }
    temp_x += 1;
@@ -685,6 +1206,7 @@ static void R_DrawColumn16_PointUV_PointZ(draw_column_vars_t *dcvars)
    {
       const uint8_t *source = dcvars->source;
       const lighttable_t *colormap = dcvars->colormap;
+      const pixel_t *colormap16 = V_Colormap16(colormap);
       count++;
 
       if (dcvars->texheight == 128)
@@ -692,9 +1214,9 @@ static void R_DrawColumn16_PointUV_PointZ(draw_column_vars_t *dcvars)
 
          while(count--)
          {
-            *dest = (V_Palette16[ (colormap[(source[(frac & ((127<<16)|0xffff))>>16])])*64 + ((64 -1)) ]);
+            *dest = (colormap16[(source[(frac & ((127<<16)|0xffff))>>16])]);
             ;
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -703,9 +1225,9 @@ static void R_DrawColumn16_PointUV_PointZ(draw_column_vars_t *dcvars)
 
          while (count--)
          {
-            *dest = (V_Palette16[ (colormap[(source[(frac)>>16])])*64 + ((64 -1)) ]);
+            *dest = (colormap16[(source[(frac)>>16])]);
             ;
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -717,17 +1239,17 @@ static void R_DrawColumn16_PointUV_PointZ(draw_column_vars_t *dcvars)
             fixed_t fixedt_heightmask = (heightmask<<16)|0xffff;
             while ((count-=2)>=0)
             {
-               *dest = (V_Palette16[ (colormap[(source[(frac & fixedt_heightmask)>>16])])*64 + ((64 -1)) ]);
+               *dest = (colormap16[(source[(frac & fixedt_heightmask)>>16])]);
                ;
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
-               *dest = (V_Palette16[ (colormap[(source[(frac & fixedt_heightmask)>>16])])*64 + ((64 -1)) ]);
+               *dest = (colormap16[(source[(frac & fixedt_heightmask)>>16])]);
                ;
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
             }
             if (count & 1)
-               *dest = (V_Palette16[ (colormap[(source[(frac & fixedt_heightmask)>>16])])*64 + ((64 -1)) ]);
+               *dest = (colormap16[(source[(frac & fixedt_heightmask)>>16])]);
             ;
          }
          else
@@ -747,9 +1269,9 @@ static void R_DrawColumn16_PointUV_PointZ(draw_column_vars_t *dcvars)
 
 
 
-               *dest = (V_Palette16[ (colormap[(source[(frac)>>16])])*64 + ((64 -1)) ]);
+               *dest = (colormap16[(source[(frac)>>16])]);
                ;
-               dest += 4;
+               dest += TEMPBUF_COLS;
                if ((frac += fracstep) >= (int)heightmask) frac -= heightmask;;
 
 
@@ -764,7 +1286,7 @@ static void R_DrawColumn16_PointUV_PointZ(draw_column_vars_t *dcvars)
 // z-dither
 static void R_DrawColumn16_PointUV_LinearZ(draw_column_vars_t *dcvars)
 {
-   uint16_t *dest;
+   pixel_t *dest;
 
    fixed_t frac;
    const fixed_t fracstep = dcvars->iscale;
@@ -811,7 +1333,7 @@ static void R_DrawColumn16_PointUV_LinearZ(draw_column_vars_t *dcvars)
       if (count <= 0) return;
    }
 
-      if(temp_x == 4 ||
+      if(temp_x == TEMPBUF_COLS ||
             (temp_x && (temptype != (COL_OPAQUE) || temp_x + startx != dcvars->x)))
          R_FlushColumns();
 
@@ -830,7 +1352,7 @@ static void R_DrawColumn16_PointUV_LinearZ(draw_column_vars_t *dcvars)
          R_FlushHTColumns = R_FlushHT16;
          R_FlushQuadColumn = R_FlushQuad16;
 
-         dest = &short_tempbuf[dcvars->yl << 2];
+         dest = &short_tempbuf[dcvars->yl << TEMPBUF_SHIFT];
 
       }
       else
@@ -844,7 +1366,7 @@ static void R_DrawColumn16_PointUV_LinearZ(draw_column_vars_t *dcvars)
             commonbot = dcvars->yh;
 
 
-         dest = &short_tempbuf[(dcvars->yl << 2) + temp_x];
+         dest = &short_tempbuf[(dcvars->yl << TEMPBUF_SHIFT) + temp_x];
 
       }
       temp_x += 1;
@@ -858,6 +1380,7 @@ static void R_DrawColumn16_PointUV_LinearZ(draw_column_vars_t *dcvars)
 
       const int fracz = (dcvars->z >> 6) & 255;
       const uint8_t *dither_colormaps[2] = { dcvars->colormap, dcvars->nextcolormap };
+      const pixel_t *dither_colormaps16[2] = { V_Colormap16(dither_colormaps[0]), V_Colormap16(dither_colormaps[1]) };
       count++;
 
 
@@ -871,9 +1394,9 @@ static void R_DrawColumn16_PointUV_LinearZ(draw_column_vars_t *dcvars)
 
          while(count--)
          {
-            *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac & ((127<<16)|0xffff))>>16])]))*64 + ((64 -1)) ]);
+            *dest = (dither_colormaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac & ((127<<16)|0xffff))>>16])]);
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -882,9 +1405,9 @@ static void R_DrawColumn16_PointUV_LinearZ(draw_column_vars_t *dcvars)
 
          while (count--)
          {
-            *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac)>>16])]))*64 + ((64 -1)) ]);
+            *dest = (dither_colormaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac)>>16])]);
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -896,17 +1419,17 @@ static void R_DrawColumn16_PointUV_LinearZ(draw_column_vars_t *dcvars)
             fixed_t fixedt_heightmask = (heightmask<<16)|0xffff;
             while ((count-=2)>=0)
             {
-               *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac & fixedt_heightmask)>>16])]))*64 + ((64 -1)) ]);
+               *dest = (dither_colormaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac & fixedt_heightmask)>>16])]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
-               *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac & fixedt_heightmask)>>16])]))*64 + ((64 -1)) ]);
+               *dest = (dither_colormaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac & fixedt_heightmask)>>16])]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
             }
             if (count & 1)
-               *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac & fixedt_heightmask)>>16])]))*64 + ((64 -1)) ]);
+               *dest = (dither_colormaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac & fixedt_heightmask)>>16])]);
             (y++);
          }
          else
@@ -926,9 +1449,9 @@ static void R_DrawColumn16_PointUV_LinearZ(draw_column_vars_t *dcvars)
 
 
 
-               *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac)>>16])]))*64 + ((64 -1)) ]);
+               *dest = (dither_colormaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac)>>16])]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                if ((frac += fracstep) >= (int)heightmask) frac -= heightmask;;
 
 
@@ -945,7 +1468,7 @@ static void R_DrawColumn16_LinearUV(draw_column_vars_t *dcvars)
 {
    int count;
 
-   uint16_t *dest;
+   pixel_t *dest;
 
    fixed_t frac;
    const fixed_t fracstep = dcvars->iscale;
@@ -1003,7 +1526,7 @@ static void R_DrawColumn16_LinearUV(draw_column_vars_t *dcvars)
    }
 
 
-   if(temp_x == 4 ||
+   if(temp_x == TEMPBUF_COLS ||
          (temp_x && (temptype != (COL_OPAQUE) || temp_x + startx != dcvars->x)))
       R_FlushColumns();
 
@@ -1022,7 +1545,7 @@ static void R_DrawColumn16_LinearUV(draw_column_vars_t *dcvars)
       R_FlushHTColumns = R_FlushHT16;
       R_FlushQuadColumn = R_FlushQuad16;
 
-      dest = &short_tempbuf[dcvars->yl << 2];
+      dest = &short_tempbuf[dcvars->yl << TEMPBUF_SHIFT];
 
    }
    else
@@ -1036,7 +1559,7 @@ static void R_DrawColumn16_LinearUV(draw_column_vars_t *dcvars)
          commonbot = dcvars->yh;
 
 
-      dest = &short_tempbuf[(dcvars->yl << 2) + temp_x];
+      dest = &short_tempbuf[(dcvars->yl << TEMPBUF_SHIFT) + temp_x];
 
    }
    temp_x += 1;
@@ -1059,6 +1582,16 @@ static void R_DrawColumn16_LinearUV(draw_column_vars_t *dcvars)
 
       count++;
 
+#ifdef R_FILTER_SIMD
+      {
+         const pixel_t *const pal = V_Palette16 + VID_COLORWEIGHTMASK;
+         const pixel_t *const rowmaps[4] = { pal, pal, pal, pal };
+
+         R_FilterColumn16(&dest, &y, &count, &frac, dcvars, filter_fracu,
+               NULL, rowmaps, VID_NUMCOLORWEIGHTS);
+      }
+#endif
+
 
 
 
@@ -1072,7 +1605,7 @@ static void R_DrawColumn16_LinearUV(draw_column_vars_t *dcvars)
          {
             *dest = (( V_Palette16[ ((nextsource[((frac+(1<<16)) & ((127<<16)|0xffff))>>16]))*64 + ((filter_fracu*((frac & ((127<<16)|0xffff))&0xffff))>>(32-6)) ] + V_Palette16[ ((source[((frac+(1<<16)) & ((127<<16)|0xffff))>>16]))*64 + (((0xffff-filter_fracu)*((frac & ((127<<16)|0xffff))&0xffff))>>(32-6)) ] + V_Palette16[ ((source[(frac & ((127<<16)|0xffff))>>16]))*64 + (((0xffff-filter_fracu)*(0xffff-((frac & ((127<<16)|0xffff))&0xffff)))>>(32-6)) ] + V_Palette16[ ((nextsource[(frac & ((127<<16)|0xffff))>>16]))*64 + ((filter_fracu*(0xffff-((frac & ((127<<16)|0xffff))&0xffff)))>>(32-6)) ]));
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -1083,7 +1616,7 @@ static void R_DrawColumn16_LinearUV(draw_column_vars_t *dcvars)
          {
             *dest = (( V_Palette16[ ((nextsource[((frac+(1<<16)))>>16]))*64 + ((filter_fracu*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ ((source[((frac+(1<<16)))>>16]))*64 + (((0xffff-filter_fracu)*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ ((source[(frac)>>16]))*64 + (((0xffff-filter_fracu)*(0xffff-((frac)&0xffff)))>>(32-6)) ] + V_Palette16[ ((nextsource[(frac)>>16]))*64 + ((filter_fracu*(0xffff-((frac)&0xffff)))>>(32-6)) ]));
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -1097,11 +1630,11 @@ static void R_DrawColumn16_LinearUV(draw_column_vars_t *dcvars)
             {
                *dest = (( V_Palette16[ ((nextsource[((frac+(1<<16)) & fixedt_heightmask)>>16]))*64 + ((filter_fracu*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ ((source[((frac+(1<<16)) & fixedt_heightmask)>>16]))*64 + (((0xffff-filter_fracu)*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ ((source[(frac & fixedt_heightmask)>>16]))*64 + (((0xffff-filter_fracu)*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ] + V_Palette16[ ((nextsource[(frac & fixedt_heightmask)>>16]))*64 + ((filter_fracu*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ]));
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
                *dest = (( V_Palette16[ ((nextsource[((frac+(1<<16)) & fixedt_heightmask)>>16]))*64 + ((filter_fracu*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ ((source[((frac+(1<<16)) & fixedt_heightmask)>>16]))*64 + (((0xffff-filter_fracu)*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ ((source[(frac & fixedt_heightmask)>>16]))*64 + (((0xffff-filter_fracu)*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ] + V_Palette16[ ((nextsource[(frac & fixedt_heightmask)>>16]))*64 + ((filter_fracu*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ]));
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
             }
             if (count & 1)
@@ -1138,7 +1671,7 @@ static void R_DrawColumn16_LinearUV(draw_column_vars_t *dcvars)
 
                *dest = (( V_Palette16[ ((nextsource[(nextfrac)>>16]))*64 + ((filter_fracu*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ ((source[(nextfrac)>>16]))*64 + (((0xffff-filter_fracu)*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ ((source[(frac)>>16]))*64 + (((0xffff-filter_fracu)*(0xffff-((frac)&0xffff)))>>(32-6)) ] + V_Palette16[ ((nextsource[(frac)>>16]))*64 + ((filter_fracu*(0xffff-((frac)&0xffff)))>>(32-6)) ]));
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                if ((frac += fracstep) >= (int)heightmask) frac -= heightmask;;
 
                if ((nextfrac += fracstep) >= (int)heightmask) nextfrac -= heightmask;;
@@ -1155,7 +1688,7 @@ static void R_DrawColumn16_LinearUV_PointZ(draw_column_vars_t *dcvars)
 {
    int count;
 
-   uint16_t *dest;
+   pixel_t *dest;
 
    fixed_t frac;
    const fixed_t fracstep = dcvars->iscale;
@@ -1212,7 +1745,7 @@ static void R_DrawColumn16_LinearUV_PointZ(draw_column_vars_t *dcvars)
       if (count <= 0) return;
    }
 
-   if(temp_x == 4 ||
+   if(temp_x == TEMPBUF_COLS ||
          (temp_x && (temptype != (COL_OPAQUE) || temp_x + startx != dcvars->x)))
       R_FlushColumns();
 
@@ -1231,7 +1764,7 @@ static void R_DrawColumn16_LinearUV_PointZ(draw_column_vars_t *dcvars)
       R_FlushHTColumns = R_FlushHT16;
       R_FlushQuadColumn = R_FlushQuad16;
 
-      dest = &short_tempbuf[dcvars->yl << 2];
+      dest = &short_tempbuf[dcvars->yl << TEMPBUF_SHIFT];
 
    }
    else
@@ -1245,7 +1778,7 @@ static void R_DrawColumn16_LinearUV_PointZ(draw_column_vars_t *dcvars)
          commonbot = dcvars->yh;
 
 
-      dest = &short_tempbuf[(dcvars->yl << 2) + temp_x];
+      dest = &short_tempbuf[(dcvars->yl << TEMPBUF_SHIFT) + temp_x];
 
    }
    temp_x += 1;
@@ -1263,6 +1796,16 @@ static void R_DrawColumn16_LinearUV_PointZ(draw_column_vars_t *dcvars)
 
       count++;
 
+#ifdef R_FILTER_SIMD
+      {
+         const pixel_t *const colormap16 = V_Colormap16(colormap);
+         const pixel_t *const rowmaps[4] = { colormap16, colormap16, colormap16, colormap16 };
+
+         R_FilterColumn16(&dest, &y, &count, &frac, dcvars, filter_fracu,
+               NULL, rowmaps, 1);
+      }
+#endif
+
       if (dcvars->texheight == 128)
       {
 
@@ -1270,7 +1813,7 @@ static void R_DrawColumn16_LinearUV_PointZ(draw_column_vars_t *dcvars)
          {
             *dest = (( V_Palette16[ (colormap[(nextsource[((frac+(1<<16)) & ((127<<16)|0xffff))>>16])])*64 + ((filter_fracu*((frac & ((127<<16)|0xffff))&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(source[((frac+(1<<16)) & ((127<<16)|0xffff))>>16])])*64 + (((0xffff-filter_fracu)*((frac & ((127<<16)|0xffff))&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(source[(frac & ((127<<16)|0xffff))>>16])])*64 + (((0xffff-filter_fracu)*(0xffff-((frac & ((127<<16)|0xffff))&0xffff)))>>(32-6)) ] + V_Palette16[ (colormap[(nextsource[(frac & ((127<<16)|0xffff))>>16])])*64 + ((filter_fracu*(0xffff-((frac & ((127<<16)|0xffff))&0xffff)))>>(32-6)) ]));
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -1281,7 +1824,7 @@ static void R_DrawColumn16_LinearUV_PointZ(draw_column_vars_t *dcvars)
          {
             *dest = (( V_Palette16[ (colormap[(nextsource[((frac+(1<<16)))>>16])])*64 + ((filter_fracu*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(source[((frac+(1<<16)))>>16])])*64 + (((0xffff-filter_fracu)*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(source[(frac)>>16])])*64 + (((0xffff-filter_fracu)*(0xffff-((frac)&0xffff)))>>(32-6)) ] + V_Palette16[ (colormap[(nextsource[(frac)>>16])])*64 + ((filter_fracu*(0xffff-((frac)&0xffff)))>>(32-6)) ]));
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -1295,11 +1838,11 @@ static void R_DrawColumn16_LinearUV_PointZ(draw_column_vars_t *dcvars)
             {
                *dest = (( V_Palette16[ (colormap[(nextsource[((frac+(1<<16)) & fixedt_heightmask)>>16])])*64 + ((filter_fracu*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(source[((frac+(1<<16)) & fixedt_heightmask)>>16])])*64 + (((0xffff-filter_fracu)*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(source[(frac & fixedt_heightmask)>>16])])*64 + (((0xffff-filter_fracu)*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ] + V_Palette16[ (colormap[(nextsource[(frac & fixedt_heightmask)>>16])])*64 + ((filter_fracu*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ]));
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
                *dest = (( V_Palette16[ (colormap[(nextsource[((frac+(1<<16)) & fixedt_heightmask)>>16])])*64 + ((filter_fracu*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(source[((frac+(1<<16)) & fixedt_heightmask)>>16])])*64 + (((0xffff-filter_fracu)*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(source[(frac & fixedt_heightmask)>>16])])*64 + (((0xffff-filter_fracu)*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ] + V_Palette16[ (colormap[(nextsource[(frac & fixedt_heightmask)>>16])])*64 + ((filter_fracu*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ]));
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
             }
             if (count & 1)
@@ -1328,7 +1871,7 @@ static void R_DrawColumn16_LinearUV_PointZ(draw_column_vars_t *dcvars)
             {
                *dest = (( V_Palette16[ (colormap[(nextsource[(nextfrac)>>16])])*64 + ((filter_fracu*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(source[(nextfrac)>>16])])*64 + (((0xffff-filter_fracu)*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(source[(frac)>>16])])*64 + (((0xffff-filter_fracu)*(0xffff-((frac)&0xffff)))>>(32-6)) ] + V_Palette16[ (colormap[(nextsource[(frac)>>16])])*64 + ((filter_fracu*(0xffff-((frac)&0xffff)))>>(32-6)) ]));
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                if ((frac += fracstep) >= (int)heightmask) frac -= heightmask;;
 
                if ((nextfrac += fracstep) >= (int)heightmask) nextfrac -= heightmask;;
@@ -1344,7 +1887,7 @@ static void R_DrawColumn16_LinearUV_LinearZ(draw_column_vars_t *dcvars)
 {
    int count;
 
-   uint16_t *dest;
+   pixel_t *dest;
 
    fixed_t frac;
    const fixed_t fracstep = dcvars->iscale;
@@ -1401,7 +1944,7 @@ static void R_DrawColumn16_LinearUV_LinearZ(draw_column_vars_t *dcvars)
       if (count <= 0) return;
    }
 
-   if(temp_x == 4 ||
+   if(temp_x == TEMPBUF_COLS ||
          (temp_x && (temptype != (COL_OPAQUE) || temp_x + startx != dcvars->x)))
       R_FlushColumns();
 
@@ -1420,7 +1963,7 @@ static void R_DrawColumn16_LinearUV_LinearZ(draw_column_vars_t *dcvars)
       R_FlushHTColumns = R_FlushHT16;
       R_FlushQuadColumn = R_FlushQuad16;
 
-      dest = &short_tempbuf[dcvars->yl << 2];
+      dest = &short_tempbuf[dcvars->yl << TEMPBUF_SHIFT];
 
    }
    else
@@ -1434,7 +1977,7 @@ static void R_DrawColumn16_LinearUV_LinearZ(draw_column_vars_t *dcvars)
          commonbot = dcvars->yh;
 
 
-      dest = &short_tempbuf[(dcvars->yl << 2) + temp_x];
+      dest = &short_tempbuf[(dcvars->yl << TEMPBUF_SHIFT) + temp_x];
 
    }
    temp_x += 1;
@@ -1457,6 +2000,20 @@ static void R_DrawColumn16_LinearUV_LinearZ(draw_column_vars_t *dcvars)
 
       count++;
 
+#ifdef R_FILTER_SIMD
+      {
+         const pixel_t *const rowmaps[4] = {
+            V_Colormap16(dither_colormaps[filter_getDitheredPixelLevel(x, 0, fracz)]),
+            V_Colormap16(dither_colormaps[filter_getDitheredPixelLevel(x, 1, fracz)]),
+            V_Colormap16(dither_colormaps[filter_getDitheredPixelLevel(x, 2, fracz)]),
+            V_Colormap16(dither_colormaps[filter_getDitheredPixelLevel(x, 3, fracz)])
+         };
+
+         R_FilterColumn16(&dest, &y, &count, &frac, dcvars, filter_fracu,
+               NULL, rowmaps, 1);
+      }
+#endif
+
       if (dcvars->texheight == 128)
       {
 
@@ -1464,7 +2021,7 @@ static void R_DrawColumn16_LinearUV_LinearZ(draw_column_vars_t *dcvars)
          {
             *dest = (( V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(nextsource[((frac+(1<<16)) & ((127<<16)|0xffff))>>16])]))*64 + ((filter_fracu*((frac & ((127<<16)|0xffff))&0xffff))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[((frac+(1<<16)) & ((127<<16)|0xffff))>>16])]))*64 + (((0xffff-filter_fracu)*((frac & ((127<<16)|0xffff))&0xffff))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac & ((127<<16)|0xffff))>>16])]))*64 + (((0xffff-filter_fracu)*(0xffff-((frac & ((127<<16)|0xffff))&0xffff)))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(nextsource[(frac & ((127<<16)|0xffff))>>16])]))*64 + ((filter_fracu*(0xffff-((frac & ((127<<16)|0xffff))&0xffff)))>>(32-6)) ]));
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -1475,7 +2032,7 @@ static void R_DrawColumn16_LinearUV_LinearZ(draw_column_vars_t *dcvars)
          {
             *dest = (( V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(nextsource[((frac+(1<<16)))>>16])]))*64 + ((filter_fracu*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[((frac+(1<<16)))>>16])]))*64 + (((0xffff-filter_fracu)*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac)>>16])]))*64 + (((0xffff-filter_fracu)*(0xffff-((frac)&0xffff)))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(nextsource[(frac)>>16])]))*64 + ((filter_fracu*(0xffff-((frac)&0xffff)))>>(32-6)) ]));
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -1489,11 +2046,11 @@ static void R_DrawColumn16_LinearUV_LinearZ(draw_column_vars_t *dcvars)
             {
                *dest = (( V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(nextsource[((frac+(1<<16)) & fixedt_heightmask)>>16])]))*64 + ((filter_fracu*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[((frac+(1<<16)) & fixedt_heightmask)>>16])]))*64 + (((0xffff-filter_fracu)*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac & fixedt_heightmask)>>16])]))*64 + (((0xffff-filter_fracu)*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(nextsource[(frac & fixedt_heightmask)>>16])]))*64 + ((filter_fracu*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ]));
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
                *dest = (( V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(nextsource[((frac+(1<<16)) & fixedt_heightmask)>>16])]))*64 + ((filter_fracu*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[((frac+(1<<16)) & fixedt_heightmask)>>16])]))*64 + (((0xffff-filter_fracu)*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac & fixedt_heightmask)>>16])]))*64 + (((0xffff-filter_fracu)*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(nextsource[(frac & fixedt_heightmask)>>16])]))*64 + ((filter_fracu*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ]));
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
             }
             if (count & 1)
@@ -1530,7 +2087,7 @@ static void R_DrawColumn16_LinearUV_LinearZ(draw_column_vars_t *dcvars)
 
                *dest = (( V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(nextsource[(nextfrac)>>16])]))*64 + ((filter_fracu*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(nextfrac)>>16])]))*64 + (((0xffff-filter_fracu)*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac)>>16])]))*64 + (((0xffff-filter_fracu)*(0xffff-((frac)&0xffff)))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(nextsource[(frac)>>16])]))*64 + ((filter_fracu*(0xffff-((frac)&0xffff)))>>(32-6)) ]));
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                if ((frac += fracstep) >= (int)heightmask) frac -= heightmask;;
 
                if ((nextfrac += fracstep) >= (int)heightmask) nextfrac -= heightmask;;
@@ -1547,7 +2104,7 @@ static void R_DrawColumn16_RoundedUV(draw_column_vars_t *dcvars)
 {
   int count;
 
-  uint16_t *dest;
+  pixel_t *dest;
 
   fixed_t frac;
   const fixed_t fracstep = dcvars->iscale;
@@ -1606,7 +2163,7 @@ static void R_DrawColumn16_RoundedUV(draw_column_vars_t *dcvars)
 
    {
 
-      if(temp_x == 4 ||
+      if(temp_x == TEMPBUF_COLS ||
          (temp_x && (temptype != (COL_OPAQUE) || temp_x + startx != dcvars->x)))
          R_FlushColumns();
 
@@ -1625,7 +2182,7 @@ static void R_DrawColumn16_RoundedUV(draw_column_vars_t *dcvars)
          R_FlushHTColumns = R_FlushHT16;
          R_FlushQuadColumn = R_FlushQuad16;
 
-         dest = &short_tempbuf[dcvars->yl << 2];
+         dest = &short_tempbuf[dcvars->yl << TEMPBUF_SHIFT];
 
       }
       else
@@ -1639,7 +2196,7 @@ static void R_DrawColumn16_RoundedUV(draw_column_vars_t *dcvars)
             commonbot = dcvars->yh;
 
 
-         dest = &short_tempbuf[(dcvars->yl << 2) + temp_x];
+         dest = &short_tempbuf[(dcvars->yl << TEMPBUF_SHIFT) + temp_x];
 
       }
       temp_x += 1;
@@ -1658,6 +2215,16 @@ static void R_DrawColumn16_RoundedUV(draw_column_vars_t *dcvars)
 
       count++;
 
+      if (dcvars->rounded)
+      {
+         const pixel_t *const pal = V_Palette16 + VID_COLORWEIGHTMASK;
+         const pixel_t *const rowmaps[4] = { pal, pal, pal, pal };
+
+         R_DrawRoundedColumn16(dest, y, count, frac, dcvars, filter_fracu,
+               rowmaps, VID_NUMCOLORWEIGHTS);
+         return;
+      }
+
 
 
 
@@ -1671,7 +2238,7 @@ static void R_DrawColumn16_RoundedUV(draw_column_vars_t *dcvars)
          {
             *dest = (V_Palette16[ ((filter_getScale2xQuadColors( source[ ((frac & ((127<<16)|0xffff))>>16) ], source[ (((0)>(((frac & ((127<<16)|0xffff))>>16)-1)?(0):(((frac & ((127<<16)|0xffff))>>16)-1))) ], nextsource[ ((frac & ((127<<16)|0xffff))>>16) ], source[ (((frac+(1<<16)) & ((127<<16)|0xffff))>>16) ], prevsource[ ((frac & ((127<<16)|0xffff))>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & ((127<<16)|0xffff))>>8) & 0xff)>>(8-6)) ] ]))*64 + ((64 -1)) ]);
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -1682,7 +2249,7 @@ static void R_DrawColumn16_RoundedUV(draw_column_vars_t *dcvars)
          {
             *dest = (V_Palette16[ ((filter_getScale2xQuadColors( source[ ((frac)>>16) ], source[ (((0)>(((frac)>>16)-1)?(0):(((frac)>>16)-1))) ], nextsource[ ((frac)>>16) ], source[ (((frac+(1<<16)))>>16) ], prevsource[ ((frac)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac)>>8) & 0xff)>>(8-6)) ] ]))*64 + ((64 -1)) ]);
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -1696,11 +2263,11 @@ static void R_DrawColumn16_RoundedUV(draw_column_vars_t *dcvars)
             {
                *dest = (V_Palette16[ ((filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ]))*64 + ((64 -1)) ]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
                *dest = (V_Palette16[ ((filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ]))*64 + ((64 -1)) ]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
             }
             if (count & 1)
@@ -1737,7 +2304,7 @@ static void R_DrawColumn16_RoundedUV(draw_column_vars_t *dcvars)
 
                *dest = (V_Palette16[ ((filter_getScale2xQuadColors( source[ ((frac)>>16) ], source[ (((0)>(((frac)>>16)-1)?(0):(((frac)>>16)-1))) ], nextsource[ ((frac)>>16) ], source[ ((nextfrac)>>16) ], prevsource[ ((frac)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac)>>8) & 0xff)>>(8-6)) ] ]))*64 + ((64 -1)) ]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                if ((frac += fracstep) >= (int)heightmask) frac -= heightmask;;
 
                if ((nextfrac += fracstep) >= (int)heightmask) nextfrac -= heightmask;;
@@ -1754,7 +2321,7 @@ static void R_DrawColumn16_RoundedUV_PointZ(draw_column_vars_t *dcvars)
 {
    int count;
 
-   uint16_t *dest;
+   pixel_t *dest;
 
    fixed_t frac;
    const fixed_t fracstep = dcvars->iscale;
@@ -1816,7 +2383,7 @@ static void R_DrawColumn16_RoundedUV_PointZ(draw_column_vars_t *dcvars)
 
    {
 
-      if(temp_x == 4 ||
+      if(temp_x == TEMPBUF_COLS ||
             (temp_x && (temptype != (COL_OPAQUE) || temp_x + startx != dcvars->x)))
          R_FlushColumns();
 
@@ -1835,7 +2402,7 @@ static void R_DrawColumn16_RoundedUV_PointZ(draw_column_vars_t *dcvars)
          R_FlushHTColumns = R_FlushHT16;
          R_FlushQuadColumn = R_FlushQuad16;
 
-         dest = &short_tempbuf[dcvars->yl << 2];
+         dest = &short_tempbuf[dcvars->yl << TEMPBUF_SHIFT];
 
       }
       else
@@ -1849,7 +2416,7 @@ static void R_DrawColumn16_RoundedUV_PointZ(draw_column_vars_t *dcvars)
             commonbot = dcvars->yh;
 
 
-         dest = &short_tempbuf[(dcvars->yl << 2) + temp_x];
+         dest = &short_tempbuf[(dcvars->yl << TEMPBUF_SHIFT) + temp_x];
 
       }
       temp_x += 1;
@@ -1860,6 +2427,7 @@ static void R_DrawColumn16_RoundedUV_PointZ(draw_column_vars_t *dcvars)
    {
       const uint8_t *source = dcvars->source;
       const lighttable_t *colormap = dcvars->colormap;
+      const pixel_t *colormap16 = V_Colormap16(colormap);
 
       int y = dcvars->yl;
       const uint8_t *prevsource = dcvars->prevsource;
@@ -1869,6 +2437,16 @@ static void R_DrawColumn16_RoundedUV_PointZ(draw_column_vars_t *dcvars)
 
       count++;
 
+      if (dcvars->rounded)
+      {
+         const pixel_t *const colormap16 = V_Colormap16(colormap);
+         const pixel_t *const rowmaps[4] = { colormap16, colormap16, colormap16, colormap16 };
+
+         R_DrawRoundedColumn16(dest, y, count, frac, dcvars, filter_fracu,
+               rowmaps, 1);
+         return;
+      }
+
 
 
 
@@ -1880,9 +2458,9 @@ static void R_DrawColumn16_RoundedUV_PointZ(draw_column_vars_t *dcvars)
 
          while(count--)
          {
-            *dest = (V_Palette16[ (colormap[(filter_getScale2xQuadColors( source[ ((frac & ((127<<16)|0xffff))>>16) ], source[ (((0)>(((frac & ((127<<16)|0xffff))>>16)-1)?(0):(((frac & ((127<<16)|0xffff))>>16)-1))) ], nextsource[ ((frac & ((127<<16)|0xffff))>>16) ], source[ (((frac+(1<<16)) & ((127<<16)|0xffff))>>16) ], prevsource[ ((frac & ((127<<16)|0xffff))>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & ((127<<16)|0xffff))>>8) & 0xff)>>(8-6)) ] ])])*64 + ((64 -1)) ]);
+            *dest = (colormap16[(filter_getScale2xQuadColors( source[ ((frac & ((127<<16)|0xffff))>>16) ], source[ (((0)>(((frac & ((127<<16)|0xffff))>>16)-1)?(0):(((frac & ((127<<16)|0xffff))>>16)-1))) ], nextsource[ ((frac & ((127<<16)|0xffff))>>16) ], source[ (((frac+(1<<16)) & ((127<<16)|0xffff))>>16) ], prevsource[ ((frac & ((127<<16)|0xffff))>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & ((127<<16)|0xffff))>>8) & 0xff)>>(8-6)) ] ])]);
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -1891,9 +2469,9 @@ static void R_DrawColumn16_RoundedUV_PointZ(draw_column_vars_t *dcvars)
 
          while (count--)
          {
-            *dest = (V_Palette16[ (colormap[(filter_getScale2xQuadColors( source[ ((frac)>>16) ], source[ (((0)>(((frac)>>16)-1)?(0):(((frac)>>16)-1))) ], nextsource[ ((frac)>>16) ], source[ (((frac+(1<<16)))>>16) ], prevsource[ ((frac)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac)>>8) & 0xff)>>(8-6)) ] ])])*64 + ((64 -1)) ]);
+            *dest = (colormap16[(filter_getScale2xQuadColors( source[ ((frac)>>16) ], source[ (((0)>(((frac)>>16)-1)?(0):(((frac)>>16)-1))) ], nextsource[ ((frac)>>16) ], source[ (((frac+(1<<16)))>>16) ], prevsource[ ((frac)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac)>>8) & 0xff)>>(8-6)) ] ])]);
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -1905,17 +2483,17 @@ static void R_DrawColumn16_RoundedUV_PointZ(draw_column_vars_t *dcvars)
             fixed_t fixedt_heightmask = (heightmask<<16)|0xffff;
             while ((count-=2)>=0)
             {
-               *dest = (V_Palette16[ (colormap[(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])])*64 + ((64 -1)) ]);
+               *dest = (colormap16[(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
-               *dest = (V_Palette16[ (colormap[(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])])*64 + ((64 -1)) ]);
+               *dest = (colormap16[(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
             }
             if (count & 1)
-               *dest = (V_Palette16[ (colormap[(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])])*64 + ((64 -1)) ]);
+               *dest = (colormap16[(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])]);
             (y++);
          }
          else
@@ -1946,9 +2524,9 @@ static void R_DrawColumn16_RoundedUV_PointZ(draw_column_vars_t *dcvars)
 
 
 
-               *dest = (V_Palette16[ (colormap[(filter_getScale2xQuadColors( source[ ((frac)>>16) ], source[ (((0)>(((frac)>>16)-1)?(0):(((frac)>>16)-1))) ], nextsource[ ((frac)>>16) ], source[ ((nextfrac)>>16) ], prevsource[ ((frac)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac)>>8) & 0xff)>>(8-6)) ] ])])*64 + ((64 -1)) ]);
+               *dest = (colormap16[(filter_getScale2xQuadColors( source[ ((frac)>>16) ], source[ (((0)>(((frac)>>16)-1)?(0):(((frac)>>16)-1))) ], nextsource[ ((frac)>>16) ], source[ ((nextfrac)>>16) ], prevsource[ ((frac)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac)>>8) & 0xff)>>(8-6)) ] ])]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                if ((frac += fracstep) >= (int)heightmask) frac -= heightmask;;
 
                if ((nextfrac += fracstep) >= (int)heightmask) nextfrac -= heightmask;;
@@ -1965,7 +2543,7 @@ static void R_DrawColumn16_RoundedUV_LinearZ(draw_column_vars_t *dcvars)
 {
    int count;
 
-   uint16_t *dest;
+   pixel_t *dest;
 
    fixed_t frac;
    const fixed_t fracstep = dcvars->iscale;
@@ -2028,7 +2606,7 @@ static void R_DrawColumn16_RoundedUV_LinearZ(draw_column_vars_t *dcvars)
 
    {
 
-      if(temp_x == 4 ||
+      if(temp_x == TEMPBUF_COLS ||
             (temp_x && (temptype != (COL_OPAQUE) || temp_x + startx != dcvars->x)))
          R_FlushColumns();
 
@@ -2047,7 +2625,7 @@ static void R_DrawColumn16_RoundedUV_LinearZ(draw_column_vars_t *dcvars)
          R_FlushHTColumns = R_FlushHT16;
          R_FlushQuadColumn = R_FlushQuad16;
 
-         dest = &short_tempbuf[dcvars->yl << 2];
+         dest = &short_tempbuf[dcvars->yl << TEMPBUF_SHIFT];
 
       }
       else
@@ -2061,7 +2639,7 @@ static void R_DrawColumn16_RoundedUV_LinearZ(draw_column_vars_t *dcvars)
             commonbot = dcvars->yh;
 
 
-         dest = &short_tempbuf[(dcvars->yl << 2) + temp_x];
+         dest = &short_tempbuf[(dcvars->yl << TEMPBUF_SHIFT) + temp_x];
 
       }
       temp_x += 1;
@@ -2078,6 +2656,7 @@ static void R_DrawColumn16_RoundedUV_LinearZ(draw_column_vars_t *dcvars)
 
       const int fracz = (dcvars->z >> 6) & 255;
       const uint8_t *dither_colormaps[2] = { dcvars->colormap, dcvars->nextcolormap };
+      const pixel_t *dither_colormaps16[2] = { V_Colormap16(dither_colormaps[0]), V_Colormap16(dither_colormaps[1]) };
 
 
 
@@ -2091,6 +2670,20 @@ static void R_DrawColumn16_RoundedUV_LinearZ(draw_column_vars_t *dcvars)
 
       count++;
 
+      if (dcvars->rounded)
+      {
+         const pixel_t *const rowmaps[4] = {
+            V_Colormap16(dither_colormaps[filter_getDitheredPixelLevel(x, 0, fracz)]),
+            V_Colormap16(dither_colormaps[filter_getDitheredPixelLevel(x, 1, fracz)]),
+            V_Colormap16(dither_colormaps[filter_getDitheredPixelLevel(x, 2, fracz)]),
+            V_Colormap16(dither_colormaps[filter_getDitheredPixelLevel(x, 3, fracz)])
+         };
+
+         R_DrawRoundedColumn16(dest, y, count, frac, dcvars, filter_fracu,
+               rowmaps, 1);
+         return;
+      }
+
 
 
 
@@ -2102,9 +2695,9 @@ static void R_DrawColumn16_RoundedUV_LinearZ(draw_column_vars_t *dcvars)
 
          while(count--)
          {
-            *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(filter_getScale2xQuadColors( source[ ((frac & ((127<<16)|0xffff))>>16) ], source[ (((0)>(((frac & ((127<<16)|0xffff))>>16)-1)?(0):(((frac & ((127<<16)|0xffff))>>16)-1))) ], nextsource[ ((frac & ((127<<16)|0xffff))>>16) ], source[ (((frac+(1<<16)) & ((127<<16)|0xffff))>>16) ], prevsource[ ((frac & ((127<<16)|0xffff))>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & ((127<<16)|0xffff))>>8) & 0xff)>>(8-6)) ] ])]))*64 + ((64 -1)) ]);
+            *dest = (dither_colormaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(filter_getScale2xQuadColors( source[ ((frac & ((127<<16)|0xffff))>>16) ], source[ (((0)>(((frac & ((127<<16)|0xffff))>>16)-1)?(0):(((frac & ((127<<16)|0xffff))>>16)-1))) ], nextsource[ ((frac & ((127<<16)|0xffff))>>16) ], source[ (((frac+(1<<16)) & ((127<<16)|0xffff))>>16) ], prevsource[ ((frac & ((127<<16)|0xffff))>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & ((127<<16)|0xffff))>>8) & 0xff)>>(8-6)) ] ])]);
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -2113,9 +2706,9 @@ static void R_DrawColumn16_RoundedUV_LinearZ(draw_column_vars_t *dcvars)
 
          while (count--)
          {
-            *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(filter_getScale2xQuadColors( source[ ((frac)>>16) ], source[ (((0)>(((frac)>>16)-1)?(0):(((frac)>>16)-1))) ], nextsource[ ((frac)>>16) ], source[ (((frac+(1<<16)))>>16) ], prevsource[ ((frac)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac)>>8) & 0xff)>>(8-6)) ] ])]))*64 + ((64 -1)) ]);
+            *dest = (dither_colormaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(filter_getScale2xQuadColors( source[ ((frac)>>16) ], source[ (((0)>(((frac)>>16)-1)?(0):(((frac)>>16)-1))) ], nextsource[ ((frac)>>16) ], source[ (((frac+(1<<16)))>>16) ], prevsource[ ((frac)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac)>>8) & 0xff)>>(8-6)) ] ])]);
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -2127,17 +2720,17 @@ static void R_DrawColumn16_RoundedUV_LinearZ(draw_column_vars_t *dcvars)
             fixed_t fixedt_heightmask = (heightmask<<16)|0xffff;
             while ((count-=2)>=0)
             {
-               *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])]))*64 + ((64 -1)) ]);
+               *dest = (dither_colormaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
-               *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])]))*64 + ((64 -1)) ]);
+               *dest = (dither_colormaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
             }
             if (count & 1)
-               *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])]))*64 + ((64 -1)) ]);
+               *dest = (dither_colormaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])]);
             (y++);
          }
          else
@@ -2168,9 +2761,9 @@ static void R_DrawColumn16_RoundedUV_LinearZ(draw_column_vars_t *dcvars)
 
 
 
-               *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(filter_getScale2xQuadColors( source[ ((frac)>>16) ], source[ (((0)>(((frac)>>16)-1)?(0):(((frac)>>16)-1))) ], nextsource[ ((frac)>>16) ], source[ ((nextfrac)>>16) ], prevsource[ ((frac)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac)>>8) & 0xff)>>(8-6)) ] ])]))*64 + ((64 -1)) ]);
+               *dest = (dither_colormaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(filter_getScale2xQuadColors( source[ ((frac)>>16) ], source[ (((0)>(((frac)>>16)-1)?(0):(((frac)>>16)-1))) ], nextsource[ ((frac)>>16) ], source[ ((nextfrac)>>16) ], prevsource[ ((frac)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac)>>8) & 0xff)>>(8-6)) ] ])]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                if ((frac += fracstep) >= (int)heightmask) frac -= heightmask;;
 
                if ((nextfrac += fracstep) >= (int)heightmask) nextfrac -= heightmask;;
@@ -2195,7 +2788,7 @@ static void R_DrawTranslatedColumn16_PointUV(draw_column_vars_t *dcvars)
 {
    int count;
 
-   uint16_t *dest;
+   pixel_t *dest;
 
    fixed_t frac;
    const fixed_t fracstep = dcvars->iscale;
@@ -2242,7 +2835,7 @@ static void R_DrawTranslatedColumn16_PointUV(draw_column_vars_t *dcvars)
       if (count <= 0) return;
    }
 
-   if(temp_x == 4 ||
+   if(temp_x == TEMPBUF_COLS ||
          (temp_x && (temptype != (COL_OPAQUE) || temp_x + startx != dcvars->x)))
       R_FlushColumns();
 
@@ -2261,7 +2854,7 @@ static void R_DrawTranslatedColumn16_PointUV(draw_column_vars_t *dcvars)
       R_FlushHTColumns = R_FlushHT16;
       R_FlushQuadColumn = R_FlushQuad16;
 
-      dest = &short_tempbuf[dcvars->yl << 2];
+      dest = &short_tempbuf[dcvars->yl << TEMPBUF_SHIFT];
 
    }
    else
@@ -2275,7 +2868,7 @@ static void R_DrawTranslatedColumn16_PointUV(draw_column_vars_t *dcvars)
          commonbot = dcvars->yh;
 
 
-      dest = &short_tempbuf[(dcvars->yl << 2) + temp_x];
+      dest = &short_tempbuf[(dcvars->yl << TEMPBUF_SHIFT) + temp_x];
 
    }
    temp_x += 1;
@@ -2300,7 +2893,7 @@ static void R_DrawTranslatedColumn16_PointUV(draw_column_vars_t *dcvars)
          {
             *dest = (V_Palette16[ ((translation[(source[(frac & ((127<<16)|0xffff))>>16])]))*64 + ((64 -1)) ]);
             ;
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -2311,7 +2904,7 @@ static void R_DrawTranslatedColumn16_PointUV(draw_column_vars_t *dcvars)
          {
             *dest = (V_Palette16[ ((translation[(source[(frac)>>16])]))*64 + ((64 -1)) ]);
             ;
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -2325,11 +2918,11 @@ static void R_DrawTranslatedColumn16_PointUV(draw_column_vars_t *dcvars)
             {
                *dest = (V_Palette16[ ((translation[(source[(frac & fixedt_heightmask)>>16])]))*64 + ((64 -1)) ]);
                ;
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
                *dest = (V_Palette16[ ((translation[(source[(frac & fixedt_heightmask)>>16])]))*64 + ((64 -1)) ]);
                ;
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
             }
             if (count & 1)
@@ -2355,7 +2948,7 @@ static void R_DrawTranslatedColumn16_PointUV(draw_column_vars_t *dcvars)
 
                *dest = (V_Palette16[ ((translation[(source[(frac)>>16])]))*64 + ((64 -1)) ]);
                ;
-               dest += 4;
+               dest += TEMPBUF_COLS;
                if ((frac += fracstep) >= (int)heightmask) frac -= heightmask;;
 
 
@@ -2371,7 +2964,7 @@ static void R_DrawTranslatedColumn16_PointUV_PointZ(draw_column_vars_t *dcvars)
 {
    int count;
 
-   uint16_t *dest;
+   pixel_t *dest;
 
    fixed_t frac;
    const fixed_t fracstep = dcvars->iscale;
@@ -2418,7 +3011,7 @@ static void R_DrawTranslatedColumn16_PointUV_PointZ(draw_column_vars_t *dcvars)
       if (count <= 0) return;
    }
 
-   if(temp_x == 4 ||
+   if(temp_x == TEMPBUF_COLS ||
          (temp_x && (temptype != (COL_OPAQUE) || temp_x + startx != dcvars->x)))
       R_FlushColumns();
 
@@ -2437,7 +3030,7 @@ static void R_DrawTranslatedColumn16_PointUV_PointZ(draw_column_vars_t *dcvars)
       R_FlushHTColumns = R_FlushHT16;
       R_FlushQuadColumn = R_FlushQuad16;
 
-      dest = &short_tempbuf[dcvars->yl << 2];
+      dest = &short_tempbuf[dcvars->yl << TEMPBUF_SHIFT];
 
    }
    else
@@ -2451,7 +3044,7 @@ static void R_DrawTranslatedColumn16_PointUV_PointZ(draw_column_vars_t *dcvars)
          commonbot = dcvars->yh;
 
 
-      dest = &short_tempbuf[(dcvars->yl << 2) + temp_x];
+      dest = &short_tempbuf[(dcvars->yl << TEMPBUF_SHIFT) + temp_x];
 
    }
    temp_x += 1;
@@ -2462,6 +3055,8 @@ static void R_DrawTranslatedColumn16_PointUV_PointZ(draw_column_vars_t *dcvars)
       const uint8_t *source = dcvars->source;
       const lighttable_t *colormap = dcvars->colormap;
       const uint8_t *translation = dcvars->translation;
+      pixel_t scratch[256];
+      const pixel_t *transmap16 = V_TranslatedColormap16(colormap, translation, scratch);
       count++;
 
 
@@ -2475,9 +3070,9 @@ static void R_DrawTranslatedColumn16_PointUV_PointZ(draw_column_vars_t *dcvars)
 
          while(count--)
          {
-            *dest = (V_Palette16[ (colormap[(translation[(source[(frac & ((127<<16)|0xffff))>>16])])])*64 + ((64 -1)) ]);
+            *dest = (transmap16[(source[(frac & ((127<<16)|0xffff))>>16])]);
             ;
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -2486,9 +3081,9 @@ static void R_DrawTranslatedColumn16_PointUV_PointZ(draw_column_vars_t *dcvars)
 
          while (count--)
          {
-            *dest = (V_Palette16[ (colormap[(translation[(source[(frac)>>16])])])*64 + ((64 -1)) ]);
+            *dest = (transmap16[(source[(frac)>>16])]);
             ;
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -2500,17 +3095,17 @@ static void R_DrawTranslatedColumn16_PointUV_PointZ(draw_column_vars_t *dcvars)
             fixed_t fixedt_heightmask = (heightmask<<16)|0xffff;
             while ((count-=2)>=0)
             {
-               *dest = (V_Palette16[ (colormap[(translation[(source[(frac & fixedt_heightmask)>>16])])])*64 + ((64 -1)) ]);
+               *dest = (transmap16[(source[(frac & fixedt_heightmask)>>16])]);
                ;
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
-               *dest = (V_Palette16[ (colormap[(translation[(source[(frac & fixedt_heightmask)>>16])])])*64 + ((64 -1)) ]);
+               *dest = (transmap16[(source[(frac & fixedt_heightmask)>>16])]);
                ;
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
             }
             if (count & 1)
-               *dest = (V_Palette16[ (colormap[(translation[(source[(frac & fixedt_heightmask)>>16])])])*64 + ((64 -1)) ]);
+               *dest = (transmap16[(source[(frac & fixedt_heightmask)>>16])]);
             ;
          }
          else
@@ -2525,9 +3120,9 @@ static void R_DrawTranslatedColumn16_PointUV_PointZ(draw_column_vars_t *dcvars)
                   frac -= heightmask;
             while (count--)
             {
-               *dest = (V_Palette16[ (colormap[(translation[(source[(frac)>>16])])])*64 + ((64 -1)) ]);
+               *dest = (transmap16[(source[(frac)>>16])]);
                ;
-               dest += 4;
+               dest += TEMPBUF_COLS;
                if ((frac += fracstep) >= (int)heightmask) frac -= heightmask;;
             }
          }
@@ -2541,7 +3136,7 @@ static void R_DrawTranslatedColumn16_PointUV_LinearZ(draw_column_vars_t *dcvars)
 {
   int count;
 
-  uint16_t *dest;
+  pixel_t *dest;
 
   fixed_t frac;
   const fixed_t fracstep = dcvars->iscale;
@@ -2592,7 +3187,7 @@ static void R_DrawTranslatedColumn16_PointUV_LinearZ(draw_column_vars_t *dcvars)
 
    {
 
-      if(temp_x == 4 ||
+      if(temp_x == TEMPBUF_COLS ||
          (temp_x && (temptype != (COL_OPAQUE) || temp_x + startx != dcvars->x)))
          R_FlushColumns();
 
@@ -2611,7 +3206,7 @@ static void R_DrawTranslatedColumn16_PointUV_LinearZ(draw_column_vars_t *dcvars)
          R_FlushHTColumns = R_FlushHT16;
          R_FlushQuadColumn = R_FlushQuad16;
 
-         dest = &short_tempbuf[dcvars->yl << 2];
+         dest = &short_tempbuf[dcvars->yl << TEMPBUF_SHIFT];
 
       }
       else
@@ -2625,7 +3220,7 @@ static void R_DrawTranslatedColumn16_PointUV_LinearZ(draw_column_vars_t *dcvars)
             commonbot = dcvars->yh;
 
 
-         dest = &short_tempbuf[(dcvars->yl << 2) + temp_x];
+         dest = &short_tempbuf[(dcvars->yl << TEMPBUF_SHIFT) + temp_x];
 
       }
       temp_x += 1;
@@ -2643,6 +3238,10 @@ static void R_DrawTranslatedColumn16_PointUV_LinearZ(draw_column_vars_t *dcvars)
 
       const int fracz = (dcvars->z >> 6) & 255;
       const uint8_t *dither_colormaps[2] = { dcvars->colormap, dcvars->nextcolormap };
+      pixel_t scratch[2][256];
+      const pixel_t *dither_transmaps16[2] = {
+         V_TranslatedColormap16(dither_colormaps[0], translation, scratch[0]),
+         V_TranslatedColormap16(dither_colormaps[1], translation, scratch[1]) };
       count++;
 
 
@@ -2656,9 +3255,9 @@ static void R_DrawTranslatedColumn16_PointUV_LinearZ(draw_column_vars_t *dcvars)
 
          while(count--)
          {
-            *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(source[(frac & ((127<<16)|0xffff))>>16])])]))*64 + ((64 -1)) ]);
+            *dest = (dither_transmaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac & ((127<<16)|0xffff))>>16])]);
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -2667,9 +3266,9 @@ static void R_DrawTranslatedColumn16_PointUV_LinearZ(draw_column_vars_t *dcvars)
 
          while (count--)
          {
-            *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(source[(frac)>>16])])]))*64 + ((64 -1)) ]);
+            *dest = (dither_transmaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac)>>16])]);
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -2681,17 +3280,17 @@ static void R_DrawTranslatedColumn16_PointUV_LinearZ(draw_column_vars_t *dcvars)
             fixed_t fixedt_heightmask = (heightmask<<16)|0xffff;
             while ((count-=2)>=0)
             {
-               *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(source[(frac & fixedt_heightmask)>>16])])]))*64 + ((64 -1)) ]);
+               *dest = (dither_transmaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac & fixedt_heightmask)>>16])]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
-               *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(source[(frac & fixedt_heightmask)>>16])])]))*64 + ((64 -1)) ]);
+               *dest = (dither_transmaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac & fixedt_heightmask)>>16])]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
             }
             if (count & 1)
-               *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(source[(frac & fixedt_heightmask)>>16])])]))*64 + ((64 -1)) ]);
+               *dest = (dither_transmaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac & fixedt_heightmask)>>16])]);
             (y++);
          }
          else
@@ -2711,9 +3310,9 @@ static void R_DrawTranslatedColumn16_PointUV_LinearZ(draw_column_vars_t *dcvars)
 
 
 
-               *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(source[(frac)>>16])])]))*64 + ((64 -1)) ]);
+               *dest = (dither_transmaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(source[(frac)>>16])]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                if ((frac += fracstep) >= (int)heightmask) frac -= heightmask;;
 
 
@@ -2729,7 +3328,7 @@ static void R_DrawTranslatedColumn16_LinearUV(draw_column_vars_t *dcvars)
 {
   int count;
 
-  uint16_t *dest;
+  pixel_t *dest;
 
   fixed_t frac;
   const fixed_t fracstep = dcvars->iscale;
@@ -2801,7 +3400,7 @@ static void R_DrawTranslatedColumn16_LinearUV(draw_column_vars_t *dcvars)
 
    {
 
-      if(temp_x == 4 ||
+      if(temp_x == TEMPBUF_COLS ||
          (temp_x && (temptype != (COL_OPAQUE) || temp_x + startx != dcvars->x)))
          R_FlushColumns();
 
@@ -2820,7 +3419,7 @@ static void R_DrawTranslatedColumn16_LinearUV(draw_column_vars_t *dcvars)
          R_FlushHTColumns = R_FlushHT16;
          R_FlushQuadColumn = R_FlushQuad16;
 
-         dest = &short_tempbuf[dcvars->yl << 2];
+         dest = &short_tempbuf[dcvars->yl << TEMPBUF_SHIFT];
 
       }
       else
@@ -2834,7 +3433,7 @@ static void R_DrawTranslatedColumn16_LinearUV(draw_column_vars_t *dcvars)
             commonbot = dcvars->yh;
 
 
-         dest = &short_tempbuf[(dcvars->yl << 2) + temp_x];
+         dest = &short_tempbuf[(dcvars->yl << TEMPBUF_SHIFT) + temp_x];
 
       }
       temp_x += 1;
@@ -2859,6 +3458,16 @@ static void R_DrawTranslatedColumn16_LinearUV(draw_column_vars_t *dcvars)
 
       count++;
 
+#ifdef R_FILTER_SIMD
+      {
+         const pixel_t *const pal = V_Palette16 + VID_COLORWEIGHTMASK;
+         const pixel_t *const rowmaps[4] = { pal, pal, pal, pal };
+
+         R_FilterColumn16(&dest, &y, &count, &frac, dcvars, filter_fracu,
+               translation, rowmaps, VID_NUMCOLORWEIGHTS);
+      }
+#endif
+
 
 
 
@@ -2872,7 +3481,7 @@ static void R_DrawTranslatedColumn16_LinearUV(draw_column_vars_t *dcvars)
          {
             *dest = (( V_Palette16[ ((translation[(nextsource[((frac+(1<<16)) & ((127<<16)|0xffff))>>16])]))*64 + ((filter_fracu*((frac & ((127<<16)|0xffff))&0xffff))>>(32-6)) ] + V_Palette16[ ((translation[(source[((frac+(1<<16)) & ((127<<16)|0xffff))>>16])]))*64 + (((0xffff-filter_fracu)*((frac & ((127<<16)|0xffff))&0xffff))>>(32-6)) ] + V_Palette16[ ((translation[(source[(frac & ((127<<16)|0xffff))>>16])]))*64 + (((0xffff-filter_fracu)*(0xffff-((frac & ((127<<16)|0xffff))&0xffff)))>>(32-6)) ] + V_Palette16[ ((translation[(nextsource[(frac & ((127<<16)|0xffff))>>16])]))*64 + ((filter_fracu*(0xffff-((frac & ((127<<16)|0xffff))&0xffff)))>>(32-6)) ]));
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -2883,7 +3492,7 @@ static void R_DrawTranslatedColumn16_LinearUV(draw_column_vars_t *dcvars)
          {
             *dest = (( V_Palette16[ ((translation[(nextsource[((frac+(1<<16)))>>16])]))*64 + ((filter_fracu*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ ((translation[(source[((frac+(1<<16)))>>16])]))*64 + (((0xffff-filter_fracu)*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ ((translation[(source[(frac)>>16])]))*64 + (((0xffff-filter_fracu)*(0xffff-((frac)&0xffff)))>>(32-6)) ] + V_Palette16[ ((translation[(nextsource[(frac)>>16])]))*64 + ((filter_fracu*(0xffff-((frac)&0xffff)))>>(32-6)) ]));
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -2897,11 +3506,11 @@ static void R_DrawTranslatedColumn16_LinearUV(draw_column_vars_t *dcvars)
             {
                *dest = (( V_Palette16[ ((translation[(nextsource[((frac+(1<<16)) & fixedt_heightmask)>>16])]))*64 + ((filter_fracu*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ ((translation[(source[((frac+(1<<16)) & fixedt_heightmask)>>16])]))*64 + (((0xffff-filter_fracu)*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ ((translation[(source[(frac & fixedt_heightmask)>>16])]))*64 + (((0xffff-filter_fracu)*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ] + V_Palette16[ ((translation[(nextsource[(frac & fixedt_heightmask)>>16])]))*64 + ((filter_fracu*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ]));
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
                *dest = (( V_Palette16[ ((translation[(nextsource[((frac+(1<<16)) & fixedt_heightmask)>>16])]))*64 + ((filter_fracu*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ ((translation[(source[((frac+(1<<16)) & fixedt_heightmask)>>16])]))*64 + (((0xffff-filter_fracu)*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ ((translation[(source[(frac & fixedt_heightmask)>>16])]))*64 + (((0xffff-filter_fracu)*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ] + V_Palette16[ ((translation[(nextsource[(frac & fixedt_heightmask)>>16])]))*64 + ((filter_fracu*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ]));
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
             }
             if (count & 1)
@@ -2938,7 +3547,7 @@ static void R_DrawTranslatedColumn16_LinearUV(draw_column_vars_t *dcvars)
 
                *dest = (( V_Palette16[ ((translation[(nextsource[(nextfrac)>>16])]))*64 + ((filter_fracu*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ ((translation[(source[(nextfrac)>>16])]))*64 + (((0xffff-filter_fracu)*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ ((translation[(source[(frac)>>16])]))*64 + (((0xffff-filter_fracu)*(0xffff-((frac)&0xffff)))>>(32-6)) ] + V_Palette16[ ((translation[(nextsource[(frac)>>16])]))*64 + ((filter_fracu*(0xffff-((frac)&0xffff)))>>(32-6)) ]));
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                if ((frac += fracstep) >= (int)heightmask) frac -= heightmask;;
 
                if ((nextfrac += fracstep) >= (int)heightmask) nextfrac -= heightmask;;
@@ -2954,7 +3563,7 @@ static void R_DrawTranslatedColumn16_LinearUV_PointZ(draw_column_vars_t *dcvars)
 {
   int count;
 
-  uint16_t *dest;
+  pixel_t *dest;
 
   fixed_t frac;
   const fixed_t fracstep = dcvars->iscale;
@@ -3013,7 +3622,7 @@ static void R_DrawTranslatedColumn16_LinearUV_PointZ(draw_column_vars_t *dcvars)
 
    {
 
-      if(temp_x == 4 ||
+      if(temp_x == TEMPBUF_COLS ||
          (temp_x && (temptype != (COL_OPAQUE) || temp_x + startx != dcvars->x)))
          R_FlushColumns();
 
@@ -3032,7 +3641,7 @@ static void R_DrawTranslatedColumn16_LinearUV_PointZ(draw_column_vars_t *dcvars)
          R_FlushHTColumns = R_FlushHT16;
          R_FlushQuadColumn = R_FlushQuad16;
 
-         dest = &short_tempbuf[dcvars->yl << 2];
+         dest = &short_tempbuf[dcvars->yl << TEMPBUF_SHIFT];
 
       }
       else
@@ -3046,7 +3655,7 @@ static void R_DrawTranslatedColumn16_LinearUV_PointZ(draw_column_vars_t *dcvars)
             commonbot = dcvars->yh;
 
 
-         dest = &short_tempbuf[(dcvars->yl << 2) + temp_x];
+         dest = &short_tempbuf[(dcvars->yl << TEMPBUF_SHIFT) + temp_x];
 
       }
       temp_x += 1;
@@ -3072,6 +3681,16 @@ static void R_DrawTranslatedColumn16_LinearUV_PointZ(draw_column_vars_t *dcvars)
 
       count++;
 
+#ifdef R_FILTER_SIMD
+      {
+         const pixel_t *const colormap16 = V_Colormap16(colormap);
+         const pixel_t *const rowmaps[4] = { colormap16, colormap16, colormap16, colormap16 };
+
+         R_FilterColumn16(&dest, &y, &count, &frac, dcvars, filter_fracu,
+               translation, rowmaps, 1);
+      }
+#endif
+
 
 
 
@@ -3085,7 +3704,7 @@ static void R_DrawTranslatedColumn16_LinearUV_PointZ(draw_column_vars_t *dcvars)
          {
             *dest = (( V_Palette16[ (colormap[(translation[(nextsource[((frac+(1<<16)) & ((127<<16)|0xffff))>>16])])])*64 + ((filter_fracu*((frac & ((127<<16)|0xffff))&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(translation[(source[((frac+(1<<16)) & ((127<<16)|0xffff))>>16])])])*64 + (((0xffff-filter_fracu)*((frac & ((127<<16)|0xffff))&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(translation[(source[(frac & ((127<<16)|0xffff))>>16])])])*64 + (((0xffff-filter_fracu)*(0xffff-((frac & ((127<<16)|0xffff))&0xffff)))>>(32-6)) ] + V_Palette16[ (colormap[(translation[(nextsource[(frac & ((127<<16)|0xffff))>>16])])])*64 + ((filter_fracu*(0xffff-((frac & ((127<<16)|0xffff))&0xffff)))>>(32-6)) ]));
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -3096,7 +3715,7 @@ static void R_DrawTranslatedColumn16_LinearUV_PointZ(draw_column_vars_t *dcvars)
          {
             *dest = (( V_Palette16[ (colormap[(translation[(nextsource[((frac+(1<<16)))>>16])])])*64 + ((filter_fracu*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(translation[(source[((frac+(1<<16)))>>16])])])*64 + (((0xffff-filter_fracu)*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(translation[(source[(frac)>>16])])])*64 + (((0xffff-filter_fracu)*(0xffff-((frac)&0xffff)))>>(32-6)) ] + V_Palette16[ (colormap[(translation[(nextsource[(frac)>>16])])])*64 + ((filter_fracu*(0xffff-((frac)&0xffff)))>>(32-6)) ]));
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -3110,11 +3729,11 @@ static void R_DrawTranslatedColumn16_LinearUV_PointZ(draw_column_vars_t *dcvars)
             {
                *dest = (( V_Palette16[ (colormap[(translation[(nextsource[((frac+(1<<16)) & fixedt_heightmask)>>16])])])*64 + ((filter_fracu*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(translation[(source[((frac+(1<<16)) & fixedt_heightmask)>>16])])])*64 + (((0xffff-filter_fracu)*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(translation[(source[(frac & fixedt_heightmask)>>16])])])*64 + (((0xffff-filter_fracu)*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ] + V_Palette16[ (colormap[(translation[(nextsource[(frac & fixedt_heightmask)>>16])])])*64 + ((filter_fracu*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ]));
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
                *dest = (( V_Palette16[ (colormap[(translation[(nextsource[((frac+(1<<16)) & fixedt_heightmask)>>16])])])*64 + ((filter_fracu*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(translation[(source[((frac+(1<<16)) & fixedt_heightmask)>>16])])])*64 + (((0xffff-filter_fracu)*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(translation[(source[(frac & fixedt_heightmask)>>16])])])*64 + (((0xffff-filter_fracu)*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ] + V_Palette16[ (colormap[(translation[(nextsource[(frac & fixedt_heightmask)>>16])])])*64 + ((filter_fracu*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ]));
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
             }
             if (count & 1)
@@ -3151,7 +3770,7 @@ static void R_DrawTranslatedColumn16_LinearUV_PointZ(draw_column_vars_t *dcvars)
 
                *dest = (( V_Palette16[ (colormap[(translation[(nextsource[(nextfrac)>>16])])])*64 + ((filter_fracu*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(translation[(source[(nextfrac)>>16])])])*64 + (((0xffff-filter_fracu)*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(translation[(source[(frac)>>16])])])*64 + (((0xffff-filter_fracu)*(0xffff-((frac)&0xffff)))>>(32-6)) ] + V_Palette16[ (colormap[(translation[(nextsource[(frac)>>16])])])*64 + ((filter_fracu*(0xffff-((frac)&0xffff)))>>(32-6)) ]));
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                if ((frac += fracstep) >= (int)heightmask) frac -= heightmask;;
 
                if ((nextfrac += fracstep) >= (int)heightmask) nextfrac -= heightmask;;
@@ -3167,7 +3786,7 @@ static void R_DrawTranslatedColumn16_LinearUV_LinearZ(draw_column_vars_t *dcvars
 {
   int count;
 
-  uint16_t *dest;
+  pixel_t *dest;
 
   fixed_t frac;
   const fixed_t fracstep = dcvars->iscale;
@@ -3230,7 +3849,7 @@ static void R_DrawTranslatedColumn16_LinearUV_LinearZ(draw_column_vars_t *dcvars
 
    {
 
-      if(temp_x == 4 ||
+      if(temp_x == TEMPBUF_COLS ||
          (temp_x && (temptype != (COL_OPAQUE) || temp_x + startx != dcvars->x)))
          R_FlushColumns();
 
@@ -3249,7 +3868,7 @@ static void R_DrawTranslatedColumn16_LinearUV_LinearZ(draw_column_vars_t *dcvars
          R_FlushHTColumns = R_FlushHT16;
          R_FlushQuadColumn = R_FlushQuad16;
 
-         dest = &short_tempbuf[dcvars->yl << 2];
+         dest = &short_tempbuf[dcvars->yl << TEMPBUF_SHIFT];
 
       }
       else
@@ -3263,7 +3882,7 @@ static void R_DrawTranslatedColumn16_LinearUV_LinearZ(draw_column_vars_t *dcvars
             commonbot = dcvars->yh;
 
 
-         dest = &short_tempbuf[(dcvars->yl << 2) + temp_x];
+         dest = &short_tempbuf[(dcvars->yl << TEMPBUF_SHIFT) + temp_x];
 
       }
       temp_x += 1;
@@ -3294,6 +3913,20 @@ static void R_DrawTranslatedColumn16_LinearUV_LinearZ(draw_column_vars_t *dcvars
 
       count++;
 
+#ifdef R_FILTER_SIMD
+      {
+         const pixel_t *const rowmaps[4] = {
+            V_Colormap16(dither_colormaps[filter_getDitheredPixelLevel(x, 0, fracz)]),
+            V_Colormap16(dither_colormaps[filter_getDitheredPixelLevel(x, 1, fracz)]),
+            V_Colormap16(dither_colormaps[filter_getDitheredPixelLevel(x, 2, fracz)]),
+            V_Colormap16(dither_colormaps[filter_getDitheredPixelLevel(x, 3, fracz)])
+         };
+
+         R_FilterColumn16(&dest, &y, &count, &frac, dcvars, filter_fracu,
+               translation, rowmaps, 1);
+      }
+#endif
+
 
 
 
@@ -3307,7 +3940,7 @@ static void R_DrawTranslatedColumn16_LinearUV_LinearZ(draw_column_vars_t *dcvars
          {
             *dest = (( V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(nextsource[((frac+(1<<16)) & ((127<<16)|0xffff))>>16])])]))*64 + ((filter_fracu*((frac & ((127<<16)|0xffff))&0xffff))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(source[((frac+(1<<16)) & ((127<<16)|0xffff))>>16])])]))*64 + (((0xffff-filter_fracu)*((frac & ((127<<16)|0xffff))&0xffff))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(source[(frac & ((127<<16)|0xffff))>>16])])]))*64 + (((0xffff-filter_fracu)*(0xffff-((frac & ((127<<16)|0xffff))&0xffff)))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(nextsource[(frac & ((127<<16)|0xffff))>>16])])]))*64 + ((filter_fracu*(0xffff-((frac & ((127<<16)|0xffff))&0xffff)))>>(32-6)) ]));
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -3318,7 +3951,7 @@ static void R_DrawTranslatedColumn16_LinearUV_LinearZ(draw_column_vars_t *dcvars
          {
             *dest = (( V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(nextsource[((frac+(1<<16)))>>16])])]))*64 + ((filter_fracu*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(source[((frac+(1<<16)))>>16])])]))*64 + (((0xffff-filter_fracu)*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(source[(frac)>>16])])]))*64 + (((0xffff-filter_fracu)*(0xffff-((frac)&0xffff)))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(nextsource[(frac)>>16])])]))*64 + ((filter_fracu*(0xffff-((frac)&0xffff)))>>(32-6)) ]));
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -3332,11 +3965,11 @@ static void R_DrawTranslatedColumn16_LinearUV_LinearZ(draw_column_vars_t *dcvars
             {
                *dest = (( V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(nextsource[((frac+(1<<16)) & fixedt_heightmask)>>16])])]))*64 + ((filter_fracu*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(source[((frac+(1<<16)) & fixedt_heightmask)>>16])])]))*64 + (((0xffff-filter_fracu)*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(source[(frac & fixedt_heightmask)>>16])])]))*64 + (((0xffff-filter_fracu)*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(nextsource[(frac & fixedt_heightmask)>>16])])]))*64 + ((filter_fracu*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ]));
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
                *dest = (( V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(nextsource[((frac+(1<<16)) & fixedt_heightmask)>>16])])]))*64 + ((filter_fracu*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(source[((frac+(1<<16)) & fixedt_heightmask)>>16])])]))*64 + (((0xffff-filter_fracu)*((frac & fixedt_heightmask)&0xffff))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(source[(frac & fixedt_heightmask)>>16])])]))*64 + (((0xffff-filter_fracu)*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(nextsource[(frac & fixedt_heightmask)>>16])])]))*64 + ((filter_fracu*(0xffff-((frac & fixedt_heightmask)&0xffff)))>>(32-6)) ]));
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
             }
             if (count & 1)
@@ -3373,7 +4006,7 @@ static void R_DrawTranslatedColumn16_LinearUV_LinearZ(draw_column_vars_t *dcvars
 
                *dest = (( V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(nextsource[(nextfrac)>>16])])]))*64 + ((filter_fracu*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(source[(nextfrac)>>16])])]))*64 + (((0xffff-filter_fracu)*((frac)&0xffff))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(source[(frac)>>16])])]))*64 + (((0xffff-filter_fracu)*(0xffff-((frac)&0xffff)))>>(32-6)) ] + V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(nextsource[(frac)>>16])])]))*64 + ((filter_fracu*(0xffff-((frac)&0xffff)))>>(32-6)) ]));
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                if ((frac += fracstep) >= (int)heightmask) frac -= heightmask;;
 
                if ((nextfrac += fracstep) >= (int)heightmask) nextfrac -= heightmask;;
@@ -3388,7 +4021,7 @@ static void R_DrawTranslatedColumn16_LinearUV_LinearZ(draw_column_vars_t *dcvars
 static void R_DrawTranslatedColumn16_RoundedUV(draw_column_vars_t *dcvars)
 {
   int count;
-  uint16_t *dest;
+  pixel_t *dest;
   fixed_t frac;
   const fixed_t fracstep = dcvars->iscale;
   const fixed_t slope_texu = dcvars->texu;
@@ -3444,7 +4077,7 @@ static void R_DrawTranslatedColumn16_RoundedUV(draw_column_vars_t *dcvars)
 
    {
 
-      if(temp_x == 4 ||
+      if(temp_x == TEMPBUF_COLS ||
          (temp_x && (temptype != (COL_OPAQUE) || temp_x + startx != dcvars->x)))
          R_FlushColumns();
 
@@ -3463,7 +4096,7 @@ static void R_DrawTranslatedColumn16_RoundedUV(draw_column_vars_t *dcvars)
          R_FlushHTColumns = R_FlushHT16;
          R_FlushQuadColumn = R_FlushQuad16;
 
-         dest = &short_tempbuf[dcvars->yl << 2];
+         dest = &short_tempbuf[dcvars->yl << TEMPBUF_SHIFT];
 
       }
       else
@@ -3477,7 +4110,7 @@ static void R_DrawTranslatedColumn16_RoundedUV(draw_column_vars_t *dcvars)
             commonbot = dcvars->yh;
 
 
-         dest = &short_tempbuf[(dcvars->yl << 2) + temp_x];
+         dest = &short_tempbuf[(dcvars->yl << TEMPBUF_SHIFT) + temp_x];
 
       }
       temp_x += 1;
@@ -3510,7 +4143,7 @@ static void R_DrawTranslatedColumn16_RoundedUV(draw_column_vars_t *dcvars)
          {
             *dest = (V_Palette16[ ((translation[(filter_getScale2xQuadColors( source[ ((frac & ((127<<16)|0xffff))>>16) ], source[ (((0)>(((frac & ((127<<16)|0xffff))>>16)-1)?(0):(((frac & ((127<<16)|0xffff))>>16)-1))) ], nextsource[ ((frac & ((127<<16)|0xffff))>>16) ], source[ (((frac+(1<<16)) & ((127<<16)|0xffff))>>16) ], prevsource[ ((frac & ((127<<16)|0xffff))>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & ((127<<16)|0xffff))>>8) & 0xff)>>(8-6)) ] ])]))*64 + ((64 -1)) ]);
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -3521,7 +4154,7 @@ static void R_DrawTranslatedColumn16_RoundedUV(draw_column_vars_t *dcvars)
          {
             *dest = (V_Palette16[ ((translation[(filter_getScale2xQuadColors( source[ ((frac)>>16) ], source[ (((0)>(((frac)>>16)-1)?(0):(((frac)>>16)-1))) ], nextsource[ ((frac)>>16) ], source[ (((frac+(1<<16)))>>16) ], prevsource[ ((frac)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac)>>8) & 0xff)>>(8-6)) ] ])]))*64 + ((64 -1)) ]);
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -3535,11 +4168,11 @@ static void R_DrawTranslatedColumn16_RoundedUV(draw_column_vars_t *dcvars)
             {
                *dest = (V_Palette16[ ((translation[(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])]))*64 + ((64 -1)) ]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
                *dest = (V_Palette16[ ((translation[(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])]))*64 + ((64 -1)) ]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
             }
             if (count & 1)
@@ -3576,7 +4209,7 @@ static void R_DrawTranslatedColumn16_RoundedUV(draw_column_vars_t *dcvars)
 
                *dest = (V_Palette16[ ((translation[(filter_getScale2xQuadColors( source[ ((frac)>>16) ], source[ (((0)>(((frac)>>16)-1)?(0):(((frac)>>16)-1))) ], nextsource[ ((frac)>>16) ], source[ ((nextfrac)>>16) ], prevsource[ ((frac)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac)>>8) & 0xff)>>(8-6)) ] ])]))*64 + ((64 -1)) ]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                if ((frac += fracstep) >= (int)heightmask) frac -= heightmask;;
 
                if ((nextfrac += fracstep) >= (int)heightmask) nextfrac -= heightmask;;
@@ -3592,7 +4225,7 @@ static void R_DrawTranslatedColumn16_RoundedUV_PointZ(draw_column_vars_t *dcvars
 {
   int count;
 
-  uint16_t *dest;
+  pixel_t *dest;
 
   fixed_t frac;
   const fixed_t fracstep = dcvars->iscale;
@@ -3656,7 +4289,7 @@ static void R_DrawTranslatedColumn16_RoundedUV_PointZ(draw_column_vars_t *dcvars
 
    {
 
-      if(temp_x == 4 ||
+      if(temp_x == TEMPBUF_COLS ||
          (temp_x && (temptype != (COL_OPAQUE) || temp_x + startx != dcvars->x)))
          R_FlushColumns();
 
@@ -3675,7 +4308,7 @@ static void R_DrawTranslatedColumn16_RoundedUV_PointZ(draw_column_vars_t *dcvars
          R_FlushHTColumns = R_FlushHT16;
          R_FlushQuadColumn = R_FlushQuad16;
 
-         dest = &short_tempbuf[dcvars->yl << 2];
+         dest = &short_tempbuf[dcvars->yl << TEMPBUF_SHIFT];
 
       }
       else
@@ -3689,7 +4322,7 @@ static void R_DrawTranslatedColumn16_RoundedUV_PointZ(draw_column_vars_t *dcvars
             commonbot = dcvars->yh;
 
 
-         dest = &short_tempbuf[(dcvars->yl << 2) + temp_x];
+         dest = &short_tempbuf[(dcvars->yl << TEMPBUF_SHIFT) + temp_x];
 
       }
       temp_x += 1;
@@ -3701,6 +4334,8 @@ static void R_DrawTranslatedColumn16_RoundedUV_PointZ(draw_column_vars_t *dcvars
       const uint8_t *source = dcvars->source;
       const lighttable_t *colormap = dcvars->colormap;
       const uint8_t *translation = dcvars->translation;
+      pixel_t scratch[256];
+      const pixel_t *transmap16 = V_TranslatedColormap16(colormap, translation, scratch);
 
       int y = dcvars->yl;
       const uint8_t *prevsource = dcvars->prevsource;
@@ -3721,9 +4356,9 @@ static void R_DrawTranslatedColumn16_RoundedUV_PointZ(draw_column_vars_t *dcvars
 
          while(count--)
          {
-            *dest = (V_Palette16[ (colormap[(translation[(filter_getScale2xQuadColors( source[ ((frac & ((127<<16)|0xffff))>>16) ], source[ (((0)>(((frac & ((127<<16)|0xffff))>>16)-1)?(0):(((frac & ((127<<16)|0xffff))>>16)-1))) ], nextsource[ ((frac & ((127<<16)|0xffff))>>16) ], source[ (((frac+(1<<16)) & ((127<<16)|0xffff))>>16) ], prevsource[ ((frac & ((127<<16)|0xffff))>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & ((127<<16)|0xffff))>>8) & 0xff)>>(8-6)) ] ])])])*64 + ((64 -1)) ]);
+            *dest = (transmap16[(filter_getScale2xQuadColors( source[ ((frac & ((127<<16)|0xffff))>>16) ], source[ (((0)>(((frac & ((127<<16)|0xffff))>>16)-1)?(0):(((frac & ((127<<16)|0xffff))>>16)-1))) ], nextsource[ ((frac & ((127<<16)|0xffff))>>16) ], source[ (((frac+(1<<16)) & ((127<<16)|0xffff))>>16) ], prevsource[ ((frac & ((127<<16)|0xffff))>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & ((127<<16)|0xffff))>>8) & 0xff)>>(8-6)) ] ])]);
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -3732,9 +4367,9 @@ static void R_DrawTranslatedColumn16_RoundedUV_PointZ(draw_column_vars_t *dcvars
 
          while (count--)
          {
-            *dest = (V_Palette16[ (colormap[(translation[(filter_getScale2xQuadColors( source[ ((frac)>>16) ], source[ (((0)>(((frac)>>16)-1)?(0):(((frac)>>16)-1))) ], nextsource[ ((frac)>>16) ], source[ (((frac+(1<<16)))>>16) ], prevsource[ ((frac)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac)>>8) & 0xff)>>(8-6)) ] ])])])*64 + ((64 -1)) ]);
+            *dest = (transmap16[(filter_getScale2xQuadColors( source[ ((frac)>>16) ], source[ (((0)>(((frac)>>16)-1)?(0):(((frac)>>16)-1))) ], nextsource[ ((frac)>>16) ], source[ (((frac+(1<<16)))>>16) ], prevsource[ ((frac)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac)>>8) & 0xff)>>(8-6)) ] ])]);
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -3746,17 +4381,17 @@ static void R_DrawTranslatedColumn16_RoundedUV_PointZ(draw_column_vars_t *dcvars
             fixed_t fixedt_heightmask = (heightmask<<16)|0xffff;
             while ((count-=2)>=0)
             {
-               *dest = (V_Palette16[ (colormap[(translation[(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])])])*64 + ((64 -1)) ]);
+               *dest = (transmap16[(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
-               *dest = (V_Palette16[ (colormap[(translation[(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])])])*64 + ((64 -1)) ]);
+               *dest = (transmap16[(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
             }
             if (count & 1)
-               *dest = (V_Palette16[ (colormap[(translation[(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])])])*64 + ((64 -1)) ]);
+               *dest = (transmap16[(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])]);
             (y++);
          }
          else
@@ -3787,9 +4422,9 @@ static void R_DrawTranslatedColumn16_RoundedUV_PointZ(draw_column_vars_t *dcvars
 
 
 
-               *dest = (V_Palette16[ (colormap[(translation[(filter_getScale2xQuadColors( source[ ((frac)>>16) ], source[ (((0)>(((frac)>>16)-1)?(0):(((frac)>>16)-1))) ], nextsource[ ((frac)>>16) ], source[ ((nextfrac)>>16) ], prevsource[ ((frac)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac)>>8) & 0xff)>>(8-6)) ] ])])])*64 + ((64 -1)) ]);
+               *dest = (transmap16[(filter_getScale2xQuadColors( source[ ((frac)>>16) ], source[ (((0)>(((frac)>>16)-1)?(0):(((frac)>>16)-1))) ], nextsource[ ((frac)>>16) ], source[ ((nextfrac)>>16) ], prevsource[ ((frac)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac)>>8) & 0xff)>>(8-6)) ] ])]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                if ((frac += fracstep) >= (int)heightmask) frac -= heightmask;;
 
                if ((nextfrac += fracstep) >= (int)heightmask) nextfrac -= heightmask;;
@@ -3804,7 +4439,7 @@ static void R_DrawTranslatedColumn16_RoundedUV_PointZ(draw_column_vars_t *dcvars
 static void R_DrawTranslatedColumn16_RoundedUV_LinearZ(draw_column_vars_t *dcvars)
 {
    int count;
-   uint16_t *dest;
+   pixel_t *dest;
    fixed_t frac;
    const fixed_t fracstep = dcvars->iscale;
    const fixed_t slope_texu = dcvars->texu;
@@ -3866,7 +4501,7 @@ static void R_DrawTranslatedColumn16_RoundedUV_LinearZ(draw_column_vars_t *dcvar
 
    {
 
-      if(temp_x == 4 ||
+      if(temp_x == TEMPBUF_COLS ||
             (temp_x && (temptype != (COL_OPAQUE) || temp_x + startx != dcvars->x)))
          R_FlushColumns();
 
@@ -3885,7 +4520,7 @@ static void R_DrawTranslatedColumn16_RoundedUV_LinearZ(draw_column_vars_t *dcvar
          R_FlushHTColumns = R_FlushHT16;
          R_FlushQuadColumn = R_FlushQuad16;
 
-         dest = &short_tempbuf[dcvars->yl << 2];
+         dest = &short_tempbuf[dcvars->yl << TEMPBUF_SHIFT];
 
       }
       else
@@ -3899,7 +4534,7 @@ static void R_DrawTranslatedColumn16_RoundedUV_LinearZ(draw_column_vars_t *dcvar
             commonbot = dcvars->yh;
 
 
-         dest = &short_tempbuf[(dcvars->yl << 2) + temp_x];
+         dest = &short_tempbuf[(dcvars->yl << TEMPBUF_SHIFT) + temp_x];
 
       }
       temp_x += 1;
@@ -3915,6 +4550,10 @@ static void R_DrawTranslatedColumn16_RoundedUV_LinearZ(draw_column_vars_t *dcvar
 
       const int fracz = (dcvars->z >> 6) & 255;
       const uint8_t *dither_colormaps[2] = { dcvars->colormap, dcvars->nextcolormap };
+      pixel_t scratch[2][256];
+      const pixel_t *dither_transmaps16[2] = {
+         V_TranslatedColormap16(dither_colormaps[0], translation, scratch[0]),
+         V_TranslatedColormap16(dither_colormaps[1], translation, scratch[1]) };
 
 
 
@@ -3939,9 +4578,9 @@ static void R_DrawTranslatedColumn16_RoundedUV_LinearZ(draw_column_vars_t *dcvar
 
          while(count--)
          {
-            *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(filter_getScale2xQuadColors( source[ ((frac & ((127<<16)|0xffff))>>16) ], source[ (((0)>(((frac & ((127<<16)|0xffff))>>16)-1)?(0):(((frac & ((127<<16)|0xffff))>>16)-1))) ], nextsource[ ((frac & ((127<<16)|0xffff))>>16) ], source[ (((frac+(1<<16)) & ((127<<16)|0xffff))>>16) ], prevsource[ ((frac & ((127<<16)|0xffff))>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & ((127<<16)|0xffff))>>8) & 0xff)>>(8-6)) ] ])])]))*64 + ((64 -1)) ]);
+            *dest = (dither_transmaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(filter_getScale2xQuadColors( source[ ((frac & ((127<<16)|0xffff))>>16) ], source[ (((0)>(((frac & ((127<<16)|0xffff))>>16)-1)?(0):(((frac & ((127<<16)|0xffff))>>16)-1))) ], nextsource[ ((frac & ((127<<16)|0xffff))>>16) ], source[ (((frac+(1<<16)) & ((127<<16)|0xffff))>>16) ], prevsource[ ((frac & ((127<<16)|0xffff))>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & ((127<<16)|0xffff))>>8) & 0xff)>>(8-6)) ] ])]);
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -3950,9 +4589,9 @@ static void R_DrawTranslatedColumn16_RoundedUV_LinearZ(draw_column_vars_t *dcvar
 
          while (count--)
          {
-            *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(filter_getScale2xQuadColors( source[ ((frac)>>16) ], source[ (((0)>(((frac)>>16)-1)?(0):(((frac)>>16)-1))) ], nextsource[ ((frac)>>16) ], source[ (((frac+(1<<16)))>>16) ], prevsource[ ((frac)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac)>>8) & 0xff)>>(8-6)) ] ])])]))*64 + ((64 -1)) ]);
+            *dest = (dither_transmaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(filter_getScale2xQuadColors( source[ ((frac)>>16) ], source[ (((0)>(((frac)>>16)-1)?(0):(((frac)>>16)-1))) ], nextsource[ ((frac)>>16) ], source[ (((frac+(1<<16)))>>16) ], prevsource[ ((frac)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac)>>8) & 0xff)>>(8-6)) ] ])]);
             (y++);
-            dest += 4;
+            dest += TEMPBUF_COLS;
             frac += fracstep;
          }
       }
@@ -3964,17 +4603,17 @@ static void R_DrawTranslatedColumn16_RoundedUV_LinearZ(draw_column_vars_t *dcvar
             fixed_t fixedt_heightmask = (heightmask<<16)|0xffff;
             while ((count-=2)>=0)
             {
-               *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])])]))*64 + ((64 -1)) ]);
+               *dest = (dither_transmaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
-               *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])])]))*64 + ((64 -1)) ]);
+               *dest = (dither_transmaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                frac += fracstep;
             }
             if (count & 1)
-               *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])])]))*64 + ((64 -1)) ]);
+               *dest = (dither_transmaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(filter_getScale2xQuadColors( source[ ((frac & fixedt_heightmask)>>16) ], source[ (((0)>(((frac & fixedt_heightmask)>>16)-1)?(0):(((frac & fixedt_heightmask)>>16)-1))) ], nextsource[ ((frac & fixedt_heightmask)>>16) ], source[ (((frac+(1<<16)) & fixedt_heightmask)>>16) ], prevsource[ ((frac & fixedt_heightmask)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac & fixedt_heightmask)>>8) & 0xff)>>(8-6)) ] ])]);
             (y++);
          }
          else
@@ -4005,9 +4644,9 @@ static void R_DrawTranslatedColumn16_RoundedUV_LinearZ(draw_column_vars_t *dcvar
 
 
 
-               *dest = (V_Palette16[ ((dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(translation[(filter_getScale2xQuadColors( source[ ((frac)>>16) ], source[ (((0)>(((frac)>>16)-1)?(0):(((frac)>>16)-1))) ], nextsource[ ((frac)>>16) ], source[ ((nextfrac)>>16) ], prevsource[ ((frac)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac)>>8) & 0xff)>>(8-6)) ] ])])]))*64 + ((64 -1)) ]);
+               *dest = (dither_transmaps16[((filter_ditherMatrix[(y)&(4 -1)][(x)&(4 -1)] < (fracz)) ? 1 : 0)][(filter_getScale2xQuadColors( source[ ((frac)>>16) ], source[ (((0)>(((frac)>>16)-1)?(0):(((frac)>>16)-1))) ], nextsource[ ((frac)>>16) ], source[ ((nextfrac)>>16) ], prevsource[ ((frac)>>16) ] ) [ filter_roundedUVMap[ ((filter_fracu>>(8-6))<<6) + ((((frac)>>8) & 0xff)>>(8-6)) ] ])]);
                (y++);
-               dest += 4;
+               dest += TEMPBUF_COLS;
                if ((frac += fracstep) >= (int)heightmask) frac -= heightmask;;
 
                if ((nextfrac += fracstep) >= (int)heightmask) nextfrac -= heightmask;;
@@ -4082,7 +4721,7 @@ static void R_DrawFuzzColumn16_PointUV(draw_column_vars_t *dcvars)
       if (count <= 0) return;
    }
 
-   if(temp_x == 4 ||
+   if(temp_x == TEMPBUF_COLS ||
          (temp_x && (temptype != (COL_FUZZ) || temp_x + startx != dcvars->x)))
       R_FlushColumns();
 
@@ -4168,7 +4807,7 @@ static void R_DrawFuzzColumn16_PointUV_PointZ(draw_column_vars_t *dcvars)
      if (count <= 0) return;
   }
 
-  if(temp_x == 4 ||
+  if(temp_x == TEMPBUF_COLS ||
         (temp_x && (temptype != (COL_FUZZ) || temp_x + startx != dcvars->x)))
      R_FlushColumns();
 
@@ -4253,7 +4892,7 @@ static void R_DrawFuzzColumn16_PointUV_LinearZ(draw_column_vars_t *dcvars)
      if (count <= 0) return;
   }
 
-  if(temp_x == 4 ||
+  if(temp_x == TEMPBUF_COLS ||
         (temp_x && (temptype != (COL_FUZZ) || temp_x + startx != dcvars->x)))
      R_FlushColumns();
 
@@ -4356,7 +4995,7 @@ static void R_DrawFuzzColumn16_LinearUV(draw_column_vars_t *dcvars)
      if (count <= 0) return;
   }
 
-  if(temp_x == 4 ||
+  if(temp_x == TEMPBUF_COLS ||
         (temp_x && (temptype != (COL_FUZZ) || temp_x + startx != dcvars->x)))
      R_FlushColumns();
 
@@ -4461,7 +5100,7 @@ static void R_DrawFuzzColumn16_LinearUV_PointZ(draw_column_vars_t *dcvars)
       if (count <= 0) return;
    }
 
-   if(temp_x == 4 ||
+   if(temp_x == TEMPBUF_COLS ||
          (temp_x && (temptype != (COL_FUZZ) || temp_x + startx != dcvars->x)))
       R_FlushColumns();
 
@@ -4581,7 +5220,7 @@ static void R_DrawFuzzColumn16_LinearUV_LinearZ(draw_column_vars_t *dcvars)
 
    {
 
-      if(temp_x == 4 ||
+      if(temp_x == TEMPBUF_COLS ||
          (temp_x && (temptype != (COL_FUZZ) || temp_x + startx != dcvars->x)))
          R_FlushColumns();
 
@@ -4684,7 +5323,7 @@ static void R_DrawFuzzColumn16_RoundedUV(draw_column_vars_t *dcvars)
       if (count <= 0) return;
    }
 
-   if(temp_x == 4 ||
+   if(temp_x == TEMPBUF_COLS ||
          (temp_x && (temptype != (COL_FUZZ) || temp_x + startx != dcvars->x)))
       R_FlushColumns();
 
@@ -4782,7 +5421,7 @@ static void R_DrawFuzzColumn16_RoundedUV_PointZ(draw_column_vars_t *dcvars)
          return;
    }
 
-   if(temp_x == 4 ||
+   if(temp_x == TEMPBUF_COLS ||
          (temp_x && (temptype != (COL_FUZZ) || temp_x + startx != dcvars->x)))
       R_FlushColumns();
 
@@ -4885,7 +5524,7 @@ static void R_DrawFuzzColumn16_RoundedUV_LinearZ(draw_column_vars_t *dcvars)
       if (count <= 0) return;
    }
 
-   if(temp_x == 4 ||
+   if(temp_x == TEMPBUF_COLS ||
          (temp_x && (temptype != (COL_FUZZ) || temp_x + startx != dcvars->x)))
       R_FlushColumns();
 
@@ -4927,6 +5566,9 @@ static R_DrawColumn_f drawcolumnfuncs[RDRAW_FILTER_MAXFILTERS][RDRAW_FILTER_MAXF
       {R_DrawColumn16_RoundedUV,
        R_DrawTranslatedColumn16_RoundedUV,
        R_DrawFuzzColumn16_RoundedUV,},
+      {R_DrawColumn16_PointUV,
+       R_DrawTranslatedColumn16_PointUV,
+       R_DrawFuzzColumn16_PointUV,},
     },
     {
       {NULL, NULL, NULL},
@@ -4939,6 +5581,9 @@ static R_DrawColumn_f drawcolumnfuncs[RDRAW_FILTER_MAXFILTERS][RDRAW_FILTER_MAXF
       {R_DrawColumn16_RoundedUV_PointZ,
        R_DrawTranslatedColumn16_RoundedUV_PointZ,
        R_DrawFuzzColumn16_RoundedUV_PointZ,},
+      {R_DrawColumn16_PointUV_PointZ,
+       R_DrawTranslatedColumn16_PointUV_PointZ,
+       R_DrawFuzzColumn16_PointUV_PointZ,},
     },
     {
       {NULL, NULL, NULL},
@@ -4951,9 +5596,38 @@ static R_DrawColumn_f drawcolumnfuncs[RDRAW_FILTER_MAXFILTERS][RDRAW_FILTER_MAXF
       {R_DrawColumn16_RoundedUV_LinearZ,
        R_DrawTranslatedColumn16_RoundedUV_LinearZ,
        R_DrawFuzzColumn16_RoundedUV_LinearZ,},
+      {R_DrawColumn16_PointUV_LinearZ,
+       R_DrawTranslatedColumn16_PointUV_LinearZ,
+       R_DrawFuzzColumn16_PointUV_LinearZ,},
     },
 };
 
+//
+// R_DrawSkyColumn16
+//
+// dcvars->source holds finished pixels, one per view row (see
+// R_GetSkyColumn), so the column is a straight copy into the view.
+//
+void R_DrawSkyColumn16(draw_column_vars_t *dcvars)
+{
+   const pixel_t *source = (const pixel_t *)dcvars->source + dcvars->yl;
+   pixel_t *dest = drawvars.short_topleft + dcvars->yl * drawvars.short_pitch +
+      dcvars->x * drawvars.short_colpitch;
+   int count = dcvars->yh - dcvars->yl + 1;
+
+   if (count <= 0)
+      return;
+
+   if (drawvars.short_pitch == 1)
+      memcpy(dest, source, count * sizeof(*dest));
+   else
+      while (count--)
+      {
+         *dest = *source++;
+         dest += drawvars.short_pitch;
+      }
+}
+
 R_DrawColumn_f R_GetDrawColumnFunc(enum column_pipeline_e type,
                                    enum draw_filter_type_e filter,
                                    enum draw_filter_type_e filterz) {
@@ -4977,6 +5651,7 @@ void R_SetDefaultDrawColumnVars(draw_column_vars_t *dcvars)
    dcvars->source        = NULL;
    dcvars->prevsource    = NULL;
    dcvars->nextsource    = NULL;
+   dcvars->rounded       = NULL;
    dcvars->colormap      = colormaps[0];
    dcvars->nextcolormap  = colormaps[0];
    dcvars->translation   = NULL;
@@ -4999,7 +5674,6 @@ extern lighttable_t *(*c_zlight)[LIGHTLEVELS][MAXLIGHTZ];
 void R_InitTranslationTables (void)
 {
    int i, j;
-#define MAXTRANS 3
    uint8_t transtocolour[MAXTRANS];
 
    // killough 5/2/98:
@@ -5044,6 +5718,7 @@ void R_InitTranslationTables (void)
          translationtables[i+512] = i;
       }
    }
+   V_TranslationsChanged();
 }
 
 //
@@ -5059,6 +5734,199 @@ void R_InitTranslationTables (void)
 //  and the inner loop has to step in texture space u and v.
 //
 
+#ifdef R_SIMD
+//
+// Vector span engine
+//
+// Spans are stepped eight pixels at a time. The texture coordinates for
+// all eight are advanced and turned into flat offsets (and, for the
+// linear filter, bilinear weights) in vector registers; only the texel,
+// colormap and palette fetches stay scalar, since neither SSE2 nor NEON
+// can gather. The result row goes out with one 128-bit store (two for
+// 32-bit pixels) when drawing straight to the screen.
+//
+
+#define SPAN_LANES 8
+
+// R_FilterBlend8 takes 8-bit weights; the 32-bit pixel path still sums
+// VID_PAL16 lookups
+#ifdef R_FILTER_SIMD
+#define SPAN_WEIGHTBITS 8
+#else
+#define SPAN_WEIGHTBITS VID_COLORWEIGHTBITS
+#endif
+
+typedef struct
+{
+   int spot[4][SPAN_LANES];   // (u+1,v+1) (u,v+1) (u,v) (u+1,v)
+   int weight[4][SPAN_LANES]; // matching SPAN_WEIGHTBITS weights
+} span_taps_t;
+
+#if defined(R_SIMD_SSE2)
+typedef __m128i span_vec_t;
+#define SPAN_SET(a,b,c,d)     _mm_set_epi32(d,c,b,a)
+#define SPAN_DUP(a)           _mm_set1_epi32(a)
+#define SPAN_ADD(a,b)         _mm_add_epi32(a,b)
+#define SPAN_SUB(a,b)         _mm_sub_epi32(a,b)
+#define SPAN_AND(a,b)         _mm_and_si128(a,b)
+#define SPAN_OR(a,b)          _mm_or_si128(a,b)
+#define SPAN_XOR(a,b)         _mm_xor_si128(a,b)
+#define SPAN_SRA(a,n)         _mm_srai_epi32(a,n)
+#define SPAN_SRL(a,n)         _mm_srli_epi32(a,n)
+#define SPAN_STORE(p,a)       _mm_storeu_si128((__m128i *)(p),a)
+
+// SSE2 has no 32-bit low multiply, so build it from the even/odd lanes
+static INLINE __m128i R_SpanMul(__m128i a, __m128i b)
+{
+   __m128i even = _mm_mul_epu32(a, b);
+   __m128i odd  = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+
+   return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0,0,2,0)),
+                             _mm_shuffle_epi32(odd, _MM_SHUFFLE(0,0,2,0)));
+}
+#define SPAN_MUL(a,b)         R_SpanMul(a,b)
+
+static INLINE void R_SpanStoreRow16(pixel_t *dest, const pixel_t *pix)
+{
+#ifdef PRBOOM_32BPP
+   _mm_storeu_si128((__m128i *)dest, _mm_loadu_si128((const __m128i *)pix));
+   _mm_storeu_si128((__m128i *)(dest + 4), _mm_loadu_si128((const __m128i *)(pix + 4)));
+#else
+   _mm_storeu_si128((__m128i *)dest,
+         _mm_set_epi16(pix[7], pix[6], pix[5], pix[4],
+                       pix[3], pix[2], pix[1], pix[0]));
+#endif
+}
+#else
+typedef int32x4_t span_vec_t;
+
+static INLINE int32x4_t R_SpanSet(int a, int b, int c, int d)
+{
+   const int32_t v[4] = { a, b, c, d };
+   return vld1q_s32(v);
+}
+#define SPAN_SET(a,b,c,d)     R_SpanSet(a,b,c,d)
+#define SPAN_DUP(a)           vdupq_n_s32(a)
+#define SPAN_ADD(a,b)         vaddq_s32(a,b)
+#define SPAN_SUB(a,b)         vsubq_s32(a,b)
+#define SPAN_AND(a,b)         vandq_s32(a,b)
+#define SPAN_OR(a,b)          vorrq_s32(a,b)
+#define SPAN_XOR(a,b)         veorq_s32(a,b)
+#define SPAN_SRA(a,n)         vshrq_n_s32(a,n)
+#define SPAN_SRL(a,n)         vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(a),n))
+#define SPAN_MUL(a,b)         vmulq_s32(a,b)
+#define SPAN_STORE(p,a)       vst1q_s32(p,a)
+
+static INLINE void R_SpanStoreRow16(pixel_t *dest, const pixel_t *pix)
+{
+#ifdef PRBOOM_32BPP
+   vst1q_u32(dest, vld1q_u32(pix));
+   vst1q_u32(dest + 4, vld1q_u32(pix + 4));
+#else
+   vst1q_u16(dest, vld1q_u16(pix));
+#endif
+}
+#endif
+
+// Eight pixels of a span; one store on screens[0], scattered down the
+// columns of the column-major view buffer
+static INLINE void R_SpanStore16(pixel_t *dest, const pixel_t *pix, int colpitch)
+{
+   int i;
+
+   if (colpitch == 1)
+      R_SpanStoreRow16(dest, pix);
+   else
+      for (i = 0; i < SPAN_LANES; i++)
+         dest[i * colpitch] = pix[i];
+}
+
+//
+// R_SpanLanes
+// Texture coordinates of four consecutive pixels, starting at frac.
+// Unsigned arithmetic so the wraparound matches repeated frac += step.
+//
+static INLINE span_vec_t R_SpanLanes(fixed_t frac, fixed_t step)
+{
+   return SPAN_SET(frac, (int)((unsigned)frac + (unsigned)step),
+         (int)((unsigned)frac + 2u * (unsigned)step),
+         (int)((unsigned)frac + 3u * (unsigned)step));
+}
+
+//
+// R_SpanSpots
+// Flat offsets of the next eight pixels, point sampled.
+//
+static void R_SpanSpots(int *spot, fixed_t xfrac, fixed_t yfrac,
+                        fixed_t xstep, fixed_t ystep)
+{
+   const span_vec_t umask = SPAN_DUP(63);
+   const span_vec_t vmask = SPAN_DUP(4032);
+   int half;
+
+   for (half = 0; half < SPAN_LANES; half += 4)
+   {
+      span_vec_t x = R_SpanLanes(xfrac, xstep);
+      span_vec_t y = R_SpanLanes(yfrac, ystep);
+
+      SPAN_STORE(spot + half, SPAN_OR(SPAN_AND(SPAN_SRA(x, 16), umask),
+                                      SPAN_AND(SPAN_SRA(y, 10), vmask)));
+      xfrac = (fixed_t)((unsigned)xfrac + 4u * (unsigned)xstep);
+      yfrac = (fixed_t)((unsigned)yfrac + 4u * (unsigned)ystep);
+   }
+}
+
+//
+// R_SpanTaps
+// The four bilinear taps and their weights for the next eight pixels,
+// as FILTER_BILINEAR_SPAN16 computes them one at a time.
+//
+static void R_SpanTaps(span_taps_t *taps, fixed_t xfrac, fixed_t yfrac,
+                       fixed_t xstep, fixed_t ystep)
+{
+   const span_vec_t umask = SPAN_DUP(0x3f);
+   const span_vec_t vmask = SPAN_DUP(0xfc0);
+   const span_vec_t fmask = SPAN_DUP(0xffff);
+   const span_vec_t one   = SPAN_DUP(FRACUNIT);
+   int half;
+
+   for (half = 0; half < SPAN_LANES; half += 4)
+   {
+      span_vec_t x  = R_SpanLanes(xfrac, xstep);
+      span_vec_t y  = R_SpanLanes(yfrac, ystep);
+      span_vec_t u0 = SPAN_AND(SPAN_SRA(x, 16), umask);
+      span_vec_t u1 = SPAN_AND(SPAN_SRA(SPAN_ADD(x, one), 16), umask);
+      span_vec_t v0 = SPAN_AND(SPAN_SRA(y, 10), vmask);
+      span_vec_t v1 = SPAN_AND(SPAN_SRA(SPAN_ADD(y, one), 10), vmask);
+      span_vec_t fu = SPAN_AND(x, fmask);
+      span_vec_t fv = SPAN_AND(y, fmask);
+      span_vec_t iu = SPAN_XOR(fu, fmask);   // 0xffff - fu
+      span_vec_t iv = SPAN_XOR(fv, fmask);
+
+      SPAN_STORE(taps->spot[0] + half, SPAN_OR(u1, v1));
+      SPAN_STORE(taps->spot[1] + half, SPAN_OR(u0, v1));
+      SPAN_STORE(taps->spot[2] + half, SPAN_OR(u0, v0));
+      SPAN_STORE(taps->spot[3] + half, SPAN_OR(u1, v0));
+      span_vec_t w0 = SPAN_SRL(SPAN_MUL(fu, fv), 32-SPAN_WEIGHTBITS);
+      span_vec_t w1 = SPAN_SRL(SPAN_MUL(iu, fv), 32-SPAN_WEIGHTBITS);
+      span_vec_t w2 = SPAN_SRL(SPAN_MUL(iu, iv), 32-SPAN_WEIGHTBITS);
+
+      SPAN_STORE(taps->weight[0] + half, w0);
+      SPAN_STORE(taps->weight[1] + half, w1);
+      SPAN_STORE(taps->weight[2] + half, w2);
+#ifdef R_FILTER_SIMD
+      // the blend needs weights summing to exactly 256
+      SPAN_STORE(taps->weight[3] + half,
+            SPAN_SUB(SPAN_DUP(256), SPAN_ADD(SPAN_ADD(w0, w1), w2)));
+#else
+      SPAN_STORE(taps->weight[3] + half, SPAN_SRL(SPAN_MUL(fu, iv), 32-SPAN_WEIGHTBITS));
+#endif
+      xfrac = (fixed_t)((unsigned)xfrac + 4u * (unsigned)xstep);
+      yfrac = (fixed_t)((unsigned)yfrac + 4u * (unsigned)ystep);
+   }
+}
+#endif
+
 static void R_DrawSpan16_PointUV_PointZ(draw_span_vars_t *dsvars)
 {
    unsigned count = dsvars->x2 - dsvars->x1 + 1;
@@ -5071,7 +5939,30 @@ static void R_DrawSpan16_PointUV_PointZ(draw_span_vars_t *dsvars)
 
    const uint8_t *colormap = dsvars->colormap;
 
-   uint16_t *dest = drawvars.short_topleft + dsvars->y* SCREENWIDTH + dsvars->x1;
+
+   const pixel_t *colormap16 = V_Colormap16(colormap);
+
+   const int colpitch = drawvars.short_colpitch;
+   pixel_t *dest = drawvars.short_topleft + dsvars->y * drawvars.short_pitch + dsvars->x1 * colpitch;
+
+#ifdef R_SIMD
+   while (count >= SPAN_LANES)
+   {
+      int spot[SPAN_LANES], i;
+      pixel_t pix[SPAN_LANES];
+
+      R_SpanSpots(spot, xfrac, yfrac, xstep, ystep);
+      for (i = 0; i < SPAN_LANES; i++)
+         pix[i] = colormap16[(source[spot[i]])];
+      R_SpanStore16(dest, pix, colpitch);
+
+      xfrac = (fixed_t)((unsigned)xfrac + SPAN_LANES * (unsigned)xstep);
+      yfrac = (fixed_t)((unsigned)yfrac + SPAN_LANES * (unsigned)ystep);
+      dest += SPAN_LANES * colpitch;
+      count -= SPAN_LANES;
+   }
+#endif
+
    while (count)
    {
       const fixed_t xtemp = (xfrac >> 16) & 63;
@@ -5080,7 +5971,8 @@ static void R_DrawSpan16_PointUV_PointZ(draw_span_vars_t *dsvars)
       const fixed_t spot = xtemp | ytemp;
       xfrac += xstep;
       yfrac += ystep;
-      *dest++ = V_Palette16[ (colormap[(source[spot])])*64 + ((64 -1)) ];
+      *dest = colormap16[(source[spot])];
+      dest += colpitch;
       count--;
    }
 }
@@ -5097,7 +5989,8 @@ static void R_DrawSpan16_PointUV_LinearZ(draw_span_vars_t *dsvars)
 
 
 
-   uint16_t *dest = drawvars.short_topleft + dsvars->y* SCREENWIDTH + dsvars->x1;
+   const int colpitch = drawvars.short_colpitch;
+   pixel_t *dest = drawvars.short_topleft + dsvars->y * drawvars.short_pitch + dsvars->x1 * colpitch;
 
    const int y = dsvars->y;
    int x1 = dsvars->x1;
@@ -5105,7 +5998,25 @@ static void R_DrawSpan16_PointUV_LinearZ(draw_span_vars_t *dsvars)
 
    const int fracz = (dsvars->z >> 12) & 255;
    const uint8_t *dither_colormaps[2] = { dsvars->colormap, dsvars->nextcolormap };
+   const pixel_t *dither_colormaps16[2] = { V_Colormap16(dither_colormaps[0]), V_Colormap16(dither_colormaps[1]) };
 
+#ifdef R_SIMD
+   while (count >= SPAN_LANES)
+   {
+      int spot[SPAN_LANES], i;
+      pixel_t pix[SPAN_LANES];
+
+      R_SpanSpots(spot, xfrac, yfrac, xstep, ystep);
+      for (i = 0; i < SPAN_LANES; i++, x1--)
+         pix[i] = dither_colormaps16[((filter_ditherMatrix[(y)&(4 -1)][(x1)&(4 -1)] < (fracz)) ? 1 : 0)][(source[spot[i]])];
+      R_SpanStore16(dest, pix, colpitch);
+
+      xfrac = (fixed_t)((unsigned)xfrac + SPAN_LANES * (unsigned)xstep);
+      yfrac = (fixed_t)((unsigned)yfrac + SPAN_LANES * (unsigned)ystep);
+      dest += SPAN_LANES * colpitch;
+      count -= SPAN_LANES;
+   }
+#endif
 
    while (count) {
       const fixed_t xtemp = (xfrac >> 16) & 63;
@@ -5114,7 +6025,8 @@ static void R_DrawSpan16_PointUV_LinearZ(draw_span_vars_t *dsvars)
       const fixed_t spot = xtemp | ytemp;
       xfrac += xstep;
       yfrac += ystep;
-      *dest++ = V_Palette16[ (dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x1)&(4 -1)] < (fracz)) ? 1 : 0)][(source[spot])])*64 + ((64 -1)) ];
+      *dest = dither_colormaps16[((filter_ditherMatrix[(y)&(4 -1)][(x1)&(4 -1)] < (fracz)) ? 1 : 0)][(source[spot])];
+      dest += colpitch;
       count--;
 
       x1--;
@@ -5144,12 +6056,55 @@ static void R_DrawSpan16_LinearUV_PointZ(draw_span_vars_t *dsvars)
 
       const uint8_t *colormap = dsvars->colormap;
 
-      uint16_t *dest = drawvars.short_topleft + dsvars->y* SCREENWIDTH + dsvars->x1;
+      const int colpitch = drawvars.short_colpitch;
+      pixel_t *dest = drawvars.short_topleft + dsvars->y * drawvars.short_pitch + dsvars->x1 * colpitch;
+
+#ifdef R_SIMD
+#ifdef R_FILTER_SIMD
+      const pixel_t *colormap16 = V_Colormap16(colormap);
+#endif
+
+      while (count >= SPAN_LANES)
+      {
+         span_taps_t taps;
+         pixel_t pix[SPAN_LANES];
+#ifdef R_FILTER_SIMD
+         pixel_t tap[4][SPAN_LANES];
+#endif
+         int i;
+
+         R_SpanTaps(&taps, xfrac, yfrac, xstep, ystep);
+#ifdef R_FILTER_SIMD
+         for (i = 0; i < SPAN_LANES; i++)
+         {
+            tap[0][i] = colormap16[source[taps.spot[0][i]]];
+            tap[1][i] = colormap16[source[taps.spot[1][i]]];
+            tap[2][i] = colormap16[source[taps.spot[2][i]]];
+            tap[3][i] = colormap16[source[taps.spot[3][i]]];
+         }
+         R_FilterBlend8(pix, (const pixel_t (*)[FILTER_LANES])tap,
+               (const int (*)[FILTER_LANES])taps.weight);
+#else
+         for (i = 0; i < SPAN_LANES; i++)
+            pix[i] = V_Palette16[ (colormap[(source[taps.spot[0][i]])])*64 + taps.weight[0][i] ] +
+                     V_Palette16[ (colormap[(source[taps.spot[1][i]])])*64 + taps.weight[1][i] ] +
+                     V_Palette16[ (colormap[(source[taps.spot[2][i]])])*64 + taps.weight[2][i] ] +
+                     V_Palette16[ (colormap[(source[taps.spot[3][i]])])*64 + taps.weight[3][i] ];
+#endif
+         R_SpanStore16(dest, pix, colpitch);
+
+         xfrac = (fixed_t)((unsigned)xfrac + SPAN_LANES * (unsigned)xstep);
+         yfrac = (fixed_t)((unsigned)yfrac + SPAN_LANES * (unsigned)ystep);
+         dest += SPAN_LANES * colpitch;
+         count -= SPAN_LANES;
+      }
+#endif
 
       while (count) {
 
 
-         *dest++ = ( V_Palette16[ (colormap[(source[ ((((xfrac)+(1<<16))>>16)&0x3f) | ((((yfrac)+(1<<16))>>10)&0xfc0)])])*64 + ((unsigned int)(((xfrac)&0xffff)*((yfrac)&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(source[ (((xfrac)>>16)&0x3f) | ((((yfrac)+(1<<16))>>10)&0xfc0)])])*64 + ((unsigned int)((0xffff-((xfrac)&0xffff))*((yfrac)&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(source[ (((xfrac)>>16)&0x3f) | (((yfrac)>>10)&0xfc0)])])*64 + ((unsigned int)((0xffff-((xfrac)&0xffff))*(0xffff-((yfrac)&0xffff)))>>(32-6)) ] + V_Palette16[ (colormap[(source[ ((((xfrac)+(1<<16))>>16)&0x3f) | (((yfrac)>>10)&0xfc0)])])*64 + ((unsigned int)(((xfrac)&0xffff)*(0xffff-((yfrac)&0xffff)))>>(32-6)) ]);
+         *dest = ( V_Palette16[ (colormap[(source[ ((((xfrac)+(1<<16))>>16)&0x3f) | ((((yfrac)+(1<<16))>>10)&0xfc0)])])*64 + ((unsigned int)(((xfrac)&0xffff)*((yfrac)&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(source[ (((xfrac)>>16)&0x3f) | ((((yfrac)+(1<<16))>>10)&0xfc0)])])*64 + ((unsigned int)((0xffff-((xfrac)&0xffff))*((yfrac)&0xffff))>>(32-6)) ] + V_Palette16[ (colormap[(source[ (((xfrac)>>16)&0x3f) | (((yfrac)>>10)&0xfc0)])])*64 + ((unsigned int)((0xffff-((xfrac)&0xffff))*(0xffff-((yfrac)&0xffff)))>>(32-6)) ] + V_Palette16[ (colormap[(source[ ((((xfrac)+(1<<16))>>16)&0x3f) | (((yfrac)>>10)&0xfc0)])])*64 + ((unsigned int)(((xfrac)&0xffff)*(0xffff-((yfrac)&0xffff)))>>(32-6)) ]);
+         dest += colpitch;
          xfrac += xstep;
          yfrac += ystep;
          count--;
@@ -5178,7 +6133,8 @@ static void R_DrawSpan16_LinearUV_LinearZ(draw_span_vars_t *dsvars)
 
 
 
-      uint16_t *dest = drawvars.short_topleft + dsvars->y* SCREENWIDTH + dsvars->x1;
+      const int colpitch = drawvars.short_colpitch;
+      pixel_t *dest = drawvars.short_topleft + dsvars->y * drawvars.short_pitch + dsvars->x1 * colpitch;
 
       const int y = dsvars->y;
       int x1 = dsvars->x1;
@@ -5187,11 +6143,57 @@ static void R_DrawSpan16_LinearUV_LinearZ(draw_span_vars_t *dsvars)
       const int fracz = (dsvars->z >> 12) & 255;
       const uint8_t *dither_colormaps[2] = { dsvars->colormap, dsvars->nextcolormap };
 
+#ifdef R_SIMD
+#ifdef R_FILTER_SIMD
+      const pixel_t *dither_colormaps16[2] = { V_Colormap16(dither_colormaps[0]), V_Colormap16(dither_colormaps[1]) };
+#endif
+
+      while (count >= SPAN_LANES)
+      {
+         span_taps_t taps;
+         pixel_t pix[SPAN_LANES];
+#ifdef R_FILTER_SIMD
+         pixel_t tap[4][SPAN_LANES];
+#endif
+         int i;
+
+         R_SpanTaps(&taps, xfrac, yfrac, xstep, ystep);
+         for (i = 0; i < SPAN_LANES; i++, x1--)
+         {
+#ifdef R_FILTER_SIMD
+            const pixel_t *colormap16 = dither_colormaps16[((filter_ditherMatrix[(y)&(4 -1)][(x1)&(4 -1)] < (fracz)) ? 1 : 0)];
+
+            tap[0][i] = colormap16[source[taps.spot[0][i]]];
+            tap[1][i] = colormap16[source[taps.spot[1][i]]];
+            tap[2][i] = colormap16[source[taps.spot[2][i]]];
+            tap[3][i] = colormap16[source[taps.spot[3][i]]];
+#else
+            const uint8_t *colormap = dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x1)&(4 -1)] < (fracz)) ? 1 : 0)];
+
+            pix[i] = V_Palette16[ (colormap[(source[taps.spot[0][i]])])*64 + taps.weight[0][i] ] +
+                     V_Palette16[ (colormap[(source[taps.spot[1][i]])])*64 + taps.weight[1][i] ] +
+                     V_Palette16[ (colormap[(source[taps.spot[2][i]])])*64 + taps.weight[2][i] ] +
+                     V_Palette16[ (colormap[(source[taps.spot[3][i]])])*64 + taps.weight[3][i] ];
+#endif
+         }
+#ifdef R_FILTER_SIMD
+         R_FilterBlend8(pix, (const pixel_t (*)[FILTER_LANES])tap,
+               (const int (*)[FILTER_LANES])taps.weight);
+#endif
+         R_SpanStore16(dest, pix, colpitch);
+
+         xfrac = (fixed_t)((unsigned)xfrac + SPAN_LANES * (unsigned)xstep);
+         yfrac = (fixed_t)((unsigned)yfrac + SPAN_LANES * (unsigned)ystep);
+         dest += SPAN_LANES * colpitch;
+         count -= SPAN_LANES;
+      }
+#endif
 
       while (count) {
 
 
-         *dest++ = ( V_Palette16[ (dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x1)&(4 -1)] < (fracz)) ? 1 : 0)][(source[ ((((xfrac)+(1<<16))>>16)&0x3f) | ((((yfrac)+(1<<16))>>10)&0xfc0)])])*64 + ((unsigned int)(((xfrac)&0xffff)*((yfrac)&0xffff))>>(32-6)) ] + V_Palette16[ (dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x1)&(4 -1)] < (fracz)) ? 1 : 0)][(source[ (((xfrac)>>16)&0x3f) | ((((yfrac)+(1<<16))>>10)&0xfc0)])])*64 + ((unsigned int)((0xffff-((xfrac)&0xffff))*((yfrac)&0xffff))>>(32-6)) ] + V_Palette16[ (dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x1)&(4 -1)] < (fracz)) ? 1 : 0)][(source[ (((xfrac)>>16)&0x3f) | (((yfrac)>>10)&0xfc0)])])*64 + ((unsigned int)((0xffff-((xfrac)&0xffff))*(0xffff-((yfrac)&0xffff)))>>(32-6)) ] + V_Palette16[ (dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x1)&(4 -1)] < (fracz)) ? 1 : 0)][(source[ ((((xfrac)+(1<<16))>>16)&0x3f) | (((yfrac)>>10)&0xfc0)])])*64 + ((unsigned int)(((xfrac)&0xffff)*(0xffff-((yfrac)&0xffff)))>>(32-6)) ]);
+         *dest = ( V_Palette16[ (dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x1)&(4 -1)] < (fracz)) ? 1 : 0)][(source[ ((((xfrac)+(1<<16))>>16)&0x3f) | ((((yfrac)+(1<<16))>>10)&0xfc0)])])*64 + ((unsigned int)(((xfrac)&0xffff)*((yfrac)&0xffff))>>(32-6)) ] + V_Palette16[ (dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x1)&(4 -1)] < (fracz)) ? 1 : 0)][(source[ (((xfrac)>>16)&0x3f) | ((((yfrac)+(1<<16))>>10)&0xfc0)])])*64 + ((unsigned int)((0xffff-((xfrac)&0xffff))*((yfrac)&0xffff))>>(32-6)) ] + V_Palette16[ (dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x1)&(4 -1)] < (fracz)) ? 1 : 0)][(source[ (((xfrac)>>16)&0x3f) | (((yfrac)>>10)&0xfc0)])])*64 + ((unsigned int)((0xffff-((xfrac)&0xffff))*(0xffff-((yfrac)&0xffff)))>>(32-6)) ] + V_Palette16[ (dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x1)&(4 -1)] < (fracz)) ? 1 : 0)][(source[ ((((xfrac)+(1<<16))>>16)&0x3f) | (((yfrac)>>10)&0xfc0)])])*64 + ((unsigned int)(((xfrac)&0xffff)*(0xffff-((yfrac)&0xffff)))>>(32-6)) ]);
+         dest += colpitch;
          xfrac += xstep;
          yfrac += ystep;
          count--;
@@ -5222,9 +6224,30 @@ static void R_DrawSpan16_RoundedUV_PointZ(draw_span_vars_t *dsvars)
 
       const uint8_t *colormap = dsvars->colormap;
 
-      uint16_t *dest = drawvars.short_topleft + dsvars->y* SCREENWIDTH + dsvars->x1;
+
+      const pixel_t *colormap16 = V_Colormap16(colormap);
+
+      const int colpitch = drawvars.short_colpitch;
+      pixel_t *dest = drawvars.short_topleft + dsvars->y * drawvars.short_pitch + dsvars->x1 * colpitch;
+      if (dsvars->rounded)
+      {
+         const uint8_t *quads = dsvars->rounded;
+
+         while (count) {
+            const int spot = ((xfrac>>16)&0x3f) | ((yfrac>>10)&0xfc0);
+
+            *dest = colormap16[R_RoundedTexel(quads, source, spot, R_RoundedCorner(xfrac, yfrac))];
+            dest += colpitch;
+            xfrac += xstep;
+            yfrac += ystep;
+            count--;
+         }
+         return;
+      }
+
       while (count) {
-         *dest++ = V_Palette16[ (colormap[(filter_getScale2xQuadColors( source[ (((xfrac)>>16)&0x3f) | (((yfrac)>>10)&0xfc0) ], source[ (((xfrac)>>16)&0x3f) | ((((yfrac)-(1<<16))>>10)&0xfc0) ], source[ ((((xfrac)+(1<<16))>>16)&0x3f) | (((yfrac)>>10)&0xfc0) ], source[ (((xfrac)>>16)&0x3f) | ((((yfrac)+(1<<16))>>10)&0xfc0) ], source[ ((((xfrac)-(1<<16))>>16)&0x3f) | (((yfrac)>>10)&0xfc0) ] ) [ filter_roundedUVMap[ (((((xfrac)>>8) & 0xff)>>(8-6))<<6) + ((((yfrac)>>8) & 0xff)>>(8-6)) ] ])])*64 + ((64 -1)) ];
+         *dest = colormap16[(filter_getScale2xQuadColors( source[ (((xfrac)>>16)&0x3f) | (((yfrac)>>10)&0xfc0) ], source[ (((xfrac)>>16)&0x3f) | ((((yfrac)-(1<<16))>>10)&0xfc0) ], source[ ((((xfrac)+(1<<16))>>16)&0x3f) | (((yfrac)>>10)&0xfc0) ], source[ (((xfrac)>>16)&0x3f) | ((((yfrac)+(1<<16))>>10)&0xfc0) ], source[ ((((xfrac)-(1<<16))>>16)&0x3f) | (((yfrac)>>10)&0xfc0) ] ) [ filter_roundedUVMap[ (((((xfrac)>>8) & 0xff)>>(8-6))<<6) + ((((yfrac)>>8) & 0xff)>>(8-6)) ] ])];
+         dest += colpitch;
          xfrac += xstep;
          yfrac += ystep;
          count--;
@@ -5253,7 +6276,8 @@ static void R_DrawSpan16_RoundedUV_LinearZ(draw_span_vars_t *dsvars)
 
 
 
-      uint16_t *dest = drawvars.short_topleft + dsvars->y* SCREENWIDTH + dsvars->x1;
+      const int colpitch = drawvars.short_colpitch;
+      pixel_t *dest = drawvars.short_topleft + dsvars->y * drawvars.short_pitch + dsvars->x1 * colpitch;
 
       const int y = dsvars->y;
       int x1 = dsvars->x1;
@@ -5261,10 +6285,29 @@ static void R_DrawSpan16_RoundedUV_LinearZ(draw_span_vars_t *dsvars)
 
       const int fracz = (dsvars->z >> 12) & 255;
       const uint8_t *dither_colormaps[2] = { dsvars->colormap, dsvars->nextcolormap };
+      const pixel_t *dither_colormaps16[2] = { V_Colormap16(dither_colormaps[0]), V_Colormap16(dither_colormaps[1]) };
 
 
+      if (dsvars->rounded)
+      {
+         const uint8_t *quads = dsvars->rounded;
+
+         while (count) {
+            const int spot = ((xfrac>>16)&0x3f) | ((yfrac>>10)&0xfc0);
+
+            *dest = dither_colormaps16[((filter_ditherMatrix[(y)&(4 -1)][(x1)&(4 -1)] < (fracz)) ? 1 : 0)][R_RoundedTexel(quads, source, spot, R_RoundedCorner(xfrac, yfrac))];
+            dest += colpitch;
+            xfrac += xstep;
+            yfrac += ystep;
+            count--;
+            x1--;
+         }
+         return;
+      }
+
       while (count) {
-         *dest++ = V_Palette16[ (dither_colormaps[((filter_ditherMatrix[(y)&(4 -1)][(x1)&(4 -1)] < (fracz)) ? 1 : 0)][(filter_getScale2xQuadColors( source[ (((xfrac)>>16)&0x3f) | (((yfrac)>>10)&0xfc0) ], source[ (((xfrac)>>16)&0x3f) | ((((yfrac)-(1<<16))>>10)&0xfc0) ], source[ ((((xfrac)+(1<<16))>>16)&0x3f) | (((yfrac)>>10)&0xfc0) ], source[ (((xfrac)>>16)&0x3f) | ((((yfrac)+(1<<16))>>10)&0xfc0) ], source[ ((((xfrac)-(1<<16))>>16)&0x3f) | (((yfrac)>>10)&0xfc0) ] ) [ filter_roundedUVMap[ (((((xfrac)>>8) & 0xff)>>(8-6))<<6) + ((((yfrac)>>8) & 0xff)>>(8-6)) ] ])])*64 + ((64 -1)) ];
+         *dest = dither_colormaps16[((filter_ditherMatrix[(y)&(4 -1)][(x1)&(4 -1)] < (fracz)) ? 1 : 0)][(filter_getScale2xQuadColors( source[ (((xfrac)>>16)&0x3f) | (((yfrac)>>10)&0xfc0) ], source[ (((xfrac)>>16)&0x3f) | ((((yfrac)-(1<<16))>>10)&0xfc0) ], source[ ((((xfrac)+(1<<16))>>16)&0x3f) | (((yfrac)>>10)&0xfc0) ], source[ (((xfrac)>>16)&0x3f) | ((((yfrac)+(1<<16))>>10)&0xfc0) ], source[ ((((xfrac)-(1<<16))>>16)&0x3f) | (((yfrac)>>10)&0xfc0) ] ) [ filter_roundedUVMap[ (((((xfrac)>>8) & 0xff)>>(8-6))<<6) + ((((yfrac)>>8) & 0xff)>>(8-6)) ] ])];
+         dest += colpitch;
          xfrac += xstep;
          yfrac += ystep;
          count--;
@@ -5274,30 +6317,123 @@ static void R_DrawSpan16_RoundedUV_LinearZ(draw_span_vars_t *dsvars)
    }
 }
 
+//
+// R_DrawSpan16_MipUV_*
+// Point sampled from the level of the flat's mip chain (dsvars->source,
+// see R_GetFlatMips) that fits the span's step. Level 0 is the flat
+// itself, so that's left to the point drawers.
+//
+
+static void R_DrawSpan16_MipUV_PointZ(draw_span_vars_t *dsvars)
+{
+   const int level = R_MipLevel(D_abs(dsvars->xstep) > D_abs(dsvars->ystep) ?
+         dsvars->xstep : dsvars->ystep, FLAT_MIPLEVELS);
+   unsigned count = dsvars->x2 - dsvars->x1 + 1;
+   fixed_t xfrac = dsvars->xfrac;
+   fixed_t yfrac = dsvars->yfrac;
+   const fixed_t xstep = dsvars->xstep;
+   const fixed_t ystep = dsvars->ystep;
+   const uint8_t *source = dsvars->source + flatmipofs[level];
+   const int ushift = 16 + level, vshift = 10 + 2*level;
+   const int umask = (64 >> level) - 1, vmask = umask << (6 - level);
+
+   const pixel_t *colormap16 = V_Colormap16(dsvars->colormap);
+
+   const int colpitch = drawvars.short_colpitch;
+   pixel_t *dest = drawvars.short_topleft + dsvars->y * drawvars.short_pitch + dsvars->x1 * colpitch;
+
+   if (!level)
+   {
+      R_DrawSpan16_PointUV_PointZ(dsvars);
+      return;
+   }
+
+   while (count)
+   {
+      *dest = colormap16[source[((xfrac >> ushift) & umask) | ((yfrac >> vshift) & vmask)]];
+      xfrac += xstep;
+      yfrac += ystep;
+      dest += colpitch;
+      count--;
+   }
+}
+
+static void R_DrawSpan16_MipUV_LinearZ(draw_span_vars_t *dsvars)
+{
+   const int level = R_MipLevel(D_abs(dsvars->xstep) > D_abs(dsvars->ystep) ?
+         dsvars->xstep : dsvars->ystep, FLAT_MIPLEVELS);
+   unsigned count = dsvars->x2 - dsvars->x1 + 1;
+   fixed_t xfrac = dsvars->xfrac;
+   fixed_t yfrac = dsvars->yfrac;
+   const fixed_t xstep = dsvars->xstep;
+   const fixed_t ystep = dsvars->ystep;
+   const uint8_t *source = dsvars->source + flatmipofs[level];
+   const int ushift = 16 + level, vshift = 10 + 2*level;
+   const int umask = (64 >> level) - 1, vmask = umask << (6 - level);
+
+   const int colpitch = drawvars.short_colpitch;
+   pixel_t *dest = drawvars.short_topleft + dsvars->y * drawvars.short_pitch + dsvars->x1 * colpitch;
+
+   const int y = dsvars->y;
+   int x1 = dsvars->x1;
+
+   const int fracz = (dsvars->z >> 12) & 255;
+   const pixel_t *dither_colormaps16[2] = { V_Colormap16(dsvars->colormap), V_Colormap16(dsvars->nextcolormap) };
+
+   if (!level)
+   {
+      R_DrawSpan16_PointUV_LinearZ(dsvars);
+      return;
+   }
+
+   while (count)
+   {
+      *dest = dither_colormaps16[((filter_ditherMatrix[(y)&(4 -1)][(x1)&(4 -1)] < (fracz)) ? 1 : 0)]
+         [source[((xfrac >> ushift) & umask) | ((yfrac >> vshift) & vmask)]];
+      xfrac += xstep;
+      yfrac += ystep;
+      dest += colpitch;
+      count--;
+
+      x1--;
+   }
+}
+
 static R_DrawSpan_f drawspanfuncs[RDRAW_FILTER_MAXFILTERS][RDRAW_FILTER_MAXFILTERS] = {
     {
       NULL,
       NULL,
       NULL,
       NULL,
+      NULL,
     },
     {
       NULL,
       R_DrawSpan16_PointUV_PointZ,
       R_DrawSpan16_LinearUV_PointZ,
       R_DrawSpan16_RoundedUV_PointZ,
+      R_DrawSpan16_MipUV_PointZ,
     },
     {
       NULL,
       R_DrawSpan16_PointUV_LinearZ,
       R_DrawSpan16_LinearUV_LinearZ,
       R_DrawSpan16_RoundedUV_LinearZ,
+      R_DrawSpan16_MipUV_LinearZ,
+    },
+    {
+      NULL,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
     },
     {
       NULL,
       NULL,
       NULL,
       NULL,
+      NULL,
     },
 };
 
@@ -5322,18 +6458,198 @@ void R_DrawSpan(draw_span_vars_t *dsvars) {
 //  of a pixel to draw.
 //
 
+// Off-screen copy of the view, when it is drawn column-major or below
+// screen size. Pixel (x,y) is at x*viewbuffercolpitch + y*viewbufferpitch.
+static pixel_t *viewbuffer;
+static int viewbufferpitch, viewbuffercolpitch;
+
+// The view buffer's memory, kept across view size changes and only
+// reallocated when a larger view needs more than it holds
+static pixel_t *viewbufferstore;
+static size_t viewbuffersize;
+
+// Offset in the view buffer of the pixel nearest to each screen column
+// and row of the view, when it is being scaled up
+static int viewscalex[MAX_SCREENWIDTH], viewscaley[MAX_SCREENHEIGHT];
+
 void R_InitBuffer(int width, int height)
 {
-  int i=0;
+  size_t size = 0;
+  int i;
+
   // Handle resize,
   //  e.g. smaller view windows
   //  with border and/or status bar.
 
   // Same with base row offset.
 
-  drawvars.short_topleft = (unsigned short *)(screens[0].data);
+  if (drawvars.column_major)
+  {
+    // Round the columns up to whole transpose blocks
+    viewbufferpitch = 1;
+    viewbuffercolpitch = (height + 7) & ~7;
+    size = width * viewbuffercolpitch;
+  }
+  else if (width != SCREENWIDTH)
+  {
+    viewbufferpitch = width;
+    viewbuffercolpitch = 1;
+    size = width * height;
+  }
+
+  // dynamic resolution steps come back down to sizes already allocated
+  if (size > viewbuffersize)
+  {
+    if (viewbufferstore)
+      Z_Free(viewbufferstore);
+    viewbufferstore = Z_Malloc(size * sizeof(*viewbufferstore), PU_STATIC, 0);
+    memset(viewbufferstore, 0, size * sizeof(*viewbufferstore));
+    viewbuffersize = size;
+  }
+  viewbuffer = size ? viewbufferstore : NULL;
+
+  if (width != SCREENWIDTH)
+  {
+    for (i = 0; i < scaledviewwidth; i++)
+      viewscalex[i] = i * width / scaledviewwidth * viewbuffercolpitch;
+    for (i = 0; i < scaledviewheight; i++)
+      viewscaley[i] = i * height / scaledviewheight * viewbufferpitch;
+  }
+
+  R_StartViewBuffer(-1);
+}
+
+//
+// R_StartViewBuffer
+//
+// The patch drawers share drawvars with the view, so this is redone at
+// the start of every frame.
+//
+
+void R_StartViewBuffer(int colour)
+{
+  int i, x, y;
+
+  if (viewbuffer)
+  {
+    drawvars.short_topleft  = viewbuffer;
+    drawvars.short_pitch    = viewbufferpitch;
+    drawvars.short_colpitch = viewbuffercolpitch;
+  }
+  else
+  {
+    drawvars.short_topleft  = (pixel_t *)(screens[0].data);
+    drawvars.short_pitch    = SURFACE_SHORT_PITCH;
+    drawvars.short_colpitch = 1;
+  }
   drawvars.int_topleft = (unsigned int *)(screens[0].data);
+  R_SetFlushPitch(drawvars.short_pitch);
+
+  for (i=0; i<FUZZTABLE + MAX_SCREENHEIGHT; i++)
+	  fuzzstream[i] = fuzzoffset_org[i % FUZZTABLE] * drawvars.short_pitch;
+
+  if (colour < 0)
+    return;
+
+  if (!viewbuffer)
+    V_FillRect(0, 0, viewwidth, viewheight, (uint8_t)colour);
+  else
+    for (x = 0; x < viewwidth; x++)
+      for (y = 0; y < viewheight; y++)
+        viewbuffer[x * viewbuffercolpitch + y * viewbufferpitch] =
+          VID_PAL16(colour, VID_COLORWEIGHTMASK);
+}
+
+//
+// R_ScaleViewBuffer
+//
+// Nearest-neighbour scaling of view columns x1..x2 up to the screen
+// columns they cover. Screen rows that land on the same view row as the
+// one above are copied from it.
+//
+
+static void R_ScaleViewBuffer(int x1, int x2)
+{
+  pixel_t *screen = (pixel_t *)screens[0].data;
+  int sx1 = (x1 * scaledviewwidth + viewwidth - 1) / viewwidth;
+  int sx2 = ((x2 + 1) * scaledviewwidth + viewwidth - 1) / viewwidth - 1;
+  int sx, sy;
+
+  if (sx2 > scaledviewwidth - 1)
+    sx2 = scaledviewwidth - 1;
+  if (sx1 > sx2)
+    return;
+
+  for (sy = 0; sy < scaledviewheight; sy++)
+  {
+    pixel_t *dest = screen + sy * SURFACE_SHORT_PITCH;
+
+    if (sy && viewscaley[sy] == viewscaley[sy - 1])
+      memcpy(dest + sx1, dest - SURFACE_SHORT_PITCH + sx1, (sx2 - sx1 + 1) * sizeof(*dest));
+    else
+    {
+      const pixel_t *source = viewbuffer + viewscaley[sy];
+
+      for (sx = sx1; sx <= sx2; sx++)
+        dest[sx] = source[viewscalex[sx]];
+    }
+  }
+}
+
+//
+// R_TransposeRect16
+//
+// Copies width columns of height pixels, column x at src + x*srcpitch,
+// into rows of dest, row y at dest + y*destpitch. The same call turns
+// screen rows into columns with the roles of the two swapped.
+//
+
+void R_TransposeRect16(pixel_t *dest, int destpitch,
+                       const pixel_t *src, int srcpitch,
+                       int width, int height)
+{
+  int x, y;
+
+  for (x = 0; x + 8 <= width; x += 8)
+  {
+    for (y = 0; y + 8 <= height; y += 8)
+      R_Transpose8x8(dest + y * destpitch + x, destpitch,
+                      src + x * srcpitch + y, srcpitch);
+    for (; y < height; y++)
+    {
+      int i;
+
+      for (i = 0; i < 8; i++)
+        dest[y * destpitch + x + i] = src[(x + i) * srcpitch + y];
+    }
+  }
+
+  for (; x < width; x++)
+    for (y = 0; y < height; y++)
+      dest[y * destpitch + x] = src[x * srcpitch + y];
+}
+
+//
+// R_FinishViewBuffer
+//
+// Transposes columns x1..x2 of the view buffer into screens[0], in 8x8
+// blocks where the vector code is available, or scales them up when the
+// view is drawn below screen size. Each render thread calls this for its
+// own slice.
+//
+
+void R_FinishViewBuffer(int x1, int x2)
+{
+  if (!viewbuffer)
+    return;
+
+  if (viewwidth != scaledviewwidth)
+  {
+    R_ScaleViewBuffer(x1, x2);
+    return;
+  }
 
-  for (i=0; i<FUZZTABLE; i++)
-	  fuzzoffset[i] = fuzzoffset_org[i] * SURFACE_SHORT_PITCH;
+  R_TransposeRect16((pixel_t *)screens[0].data + x1, SURFACE_SHORT_PITCH,
+                    viewbuffer + x1 * viewbuffercolpitch, viewbuffercolpitch,
+                    x2 - x1 + 1, viewheight);
 }
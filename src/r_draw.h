@@ -49,6 +49,8 @@ enum draw_filter_type_e {
   RDRAW_FILTER_POINT,
   RDRAW_FILTER_LINEAR,
   RDRAW_FILTER_ROUNDED,
+  // point sampled from a mip level picked by distance; walls and flats
+  RDRAW_FILTER_MIPMAP,
   RDRAW_FILTER_MAXFILTERS
 };
 
@@ -73,6 +75,7 @@ typedef struct {
   const uint8_t       *source; // first pixel in a column
   const uint8_t       *prevsource; // first pixel in previous column
   const uint8_t       *nextsource; // first pixel in next column
+  const uint8_t       *rounded; // Scale2x quads of source, or NULL
   const lighttable_t  *colormap;
   const lighttable_t  *nextcolormap;
   const uint8_t       *translation;
@@ -94,13 +97,19 @@ typedef struct {
   fixed_t             xstep;
   fixed_t             ystep;
   const uint8_t       *source; // start of a 64*64 tile image
+  const uint8_t       *rounded; // Scale2x quads of source, or NULL
   const lighttable_t  *colormap;
   const lighttable_t  *nextcolormap;
 } draw_span_vars_t;
 
 typedef struct {
-  unsigned short *short_topleft;
+  pixel_t *short_topleft;
   unsigned int   *int_topleft;
+  // Distance between vertically and horizontally adjacent pixels of the
+  // target, in pixels. SURFACE_SHORT_PITCH and 1 for screens[0]; the other
+  // way round for the column-major view buffer.
+  int short_pitch;
+  int short_colpitch;
 
   enum draw_filter_type_e filterwall;
   enum draw_filter_type_e filterfloor;
@@ -115,12 +124,18 @@ typedef struct {
   // If a texture is being minified (dcvars.iscale > rdraw_magThresh), then it
   // drops back to point filtering.
   fixed_t mag_threshold;
+
+  // Render the 3D view into a column-major buffer, so that wall and
+  // sprite columns are stored contiguously, and transpose it into
+  // screens[0] once it is complete.
+  int column_major;
 } draw_vars_t;
 
 extern draw_vars_t drawvars;
 
 extern uint8_t playernumtotrans[MAXPLAYERS]; // CPhipps - what translation table for what player
 extern uint8_t       *translationtables;
+#define MAXTRANS 3  // translation tables for player colours
 
 typedef void (*R_DrawColumn_f)(draw_column_vars_t *dcvars);
 R_DrawColumn_f R_GetDrawColumnFunc(enum column_pipeline_e type,
@@ -133,8 +148,23 @@ R_DrawSpan_f R_GetDrawSpanFunc(enum draw_filter_type_e filter,
                                enum draw_filter_type_e filterz);
 void R_DrawSpan(draw_span_vars_t *dsvars);
 
+// Copies ready-made pixels, for columns the sky cache already built
+void R_DrawSkyColumn16(draw_column_vars_t *dcvars);
+
 void R_InitBuffer(int width, int height);
 
+// Points drawvars at the view's render target for this frame, and fills
+// it with colour (HOM detection) when colour >= 0.
+void R_StartViewBuffer(int colour);
+// Copies view columns x1..x2 of a column-major view buffer into
+// screens[0]. Does nothing when the view is drawn straight to the screen.
+void R_FinishViewBuffer(int x1, int x2);
+// Copies width columns of height pixels (column x at src + x*srcpitch)
+// into rows of dest (row y at dest + y*destpitch), in 8x8 blocks.
+void R_TransposeRect16(pixel_t *dest, int destpitch,
+                       const pixel_t *src, int srcpitch,
+                       int width, int height);
+
 // Initialize color translation tables, for player rendering etc.
 void R_InitTranslationTables(void);
 
@@ -0,0 +1,183 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Deferred drawing: a per-thread list of the columns, spans and lump
+ *      releases made while walking the BSP, planes and sprites, run in
+ *      the order they were made so the picture (fuzz included) comes out
+ *      the same as drawing immediately.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#include "z_zone.h"
+#include "doomtype.h"
+#include "r_drawlist.h"
+#include "r_patch.h"
+#include "w_wad.h"
+#include "i_system.h"
+#include "r_main.h"
+#include "r_profile.h"
+
+int render_deferred;
+
+THREAD_LOCAL int rendervisibletime, renderfilltime;
+
+typedef enum {
+  DC_COLUMN,
+  DC_SPAN,
+  DC_RESETCOLUMNS,
+  DC_UNLOCKTEXTURE,
+  DC_UNLOCKPATCH,
+  DC_UNLOCKLUMP
+} drawcmd_e;
+
+typedef struct {
+  drawcmd_e type;
+  union {
+    struct {
+      R_DrawColumn_f func;
+      draw_column_vars_t vars;
+    } column;
+    draw_span_vars_t span;
+    int lump;
+  } u;
+} drawcmd_t;
+
+static THREAD_LOCAL drawcmd_t *drawlist;
+static THREAD_LOCAL int numdrawcmds, maxdrawcmds;
+static THREAD_LOCAL dbool recording;
+static THREAD_LOCAL int64_t liststarttime;
+
+static drawcmd_t *R_NewDrawCmd(drawcmd_e type)
+{
+  if (numdrawcmds == maxdrawcmds)
+  {
+    maxdrawcmds = maxdrawcmds ? maxdrawcmds * 2 : 1024;
+    drawlist = realloc(drawlist, maxdrawcmds * sizeof(*drawlist));
+  }
+  drawlist[numdrawcmds].type = type;
+  return &drawlist[numdrawcmds++];
+}
+
+void R_QueueColumn(R_DrawColumn_f colfunc, draw_column_vars_t *dcvars)
+{
+  drawcmd_t *cmd;
+
+  R_ProfileCount(RPC_COLUMNS, 1);
+  R_ProfileColumn(dcvars);
+  if (!recording)
+  {
+    colfunc(dcvars);
+    return;
+  }
+
+  cmd = R_NewDrawCmd(DC_COLUMN);
+  cmd->u.column.func = colfunc;
+  cmd->u.column.vars = *dcvars;
+}
+
+void R_QueueSpan(draw_span_vars_t *dsvars)
+{
+  R_ProfileSpan(dsvars);
+  if (!recording)
+  {
+    R_DrawSpan(dsvars);
+    return;
+  }
+
+  R_NewDrawCmd(DC_SPAN)->u.span = *dsvars;
+}
+
+void R_QueueResetColumnBuffer(void)
+{
+  if (!recording)
+    R_ResetColumnBuffer();
+  else
+    R_NewDrawCmd(DC_RESETCOLUMNS);
+}
+
+static void R_QueueUnlock(drawcmd_e type, int lump)
+{
+  if (recording)
+    R_NewDrawCmd(type)->u.lump = lump;
+  else if (type == DC_UNLOCKTEXTURE)
+    R_UnlockTextureCompositePatchNum(lump);
+  else if (type == DC_UNLOCKPATCH)
+    R_UnlockPatchNum(lump);
+  else
+    W_UnlockLumpNum(lump);
+}
+
+void R_QueueUnlockTexture(int texnum) { R_QueueUnlock(DC_UNLOCKTEXTURE, texnum); }
+void R_QueueUnlockPatch(int lump)     { R_QueueUnlock(DC_UNLOCKPATCH, lump); }
+void R_QueueUnlockLump(int lump)      { R_QueueUnlock(DC_UNLOCKLUMP, lump); }
+
+void R_BeginDrawList(dbool record)
+{
+  numdrawcmds = 0;
+  recording = record;
+  liststarttime = I_GetTimeUS();
+}
+
+dbool R_DrawListRecording(void)
+{
+  return recording;
+}
+
+void R_RunDrawList(void)
+{
+  int64_t filltime = I_GetTimeUS();
+  int i;
+
+  rendervisibletime = (int)(filltime - liststarttime);
+  recording = FALSE;
+
+  for (i = 0; i < numdrawcmds; i++)
+  {
+    drawcmd_t *cmd = &drawlist[i];
+
+    switch (cmd->type)
+    {
+      case DC_COLUMN:
+        cmd->u.column.func(&cmd->u.column.vars);
+        break;
+      case DC_SPAN:
+        R_DrawSpan(&cmd->u.span);
+        break;
+      case DC_RESETCOLUMNS:
+        R_ResetColumnBuffer();
+        break;
+      default:
+        R_QueueUnlock(cmd->type, cmd->u.lump);
+        break;
+    }
+  }
+  numdrawcmds = 0;
+
+  renderfilltime = (int)(I_GetTimeUS() - filltime);
+}
@@ -0,0 +1,70 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Deferred drawing. The renderer hands every column, span and
+ *      texture release to the R_Queue* functions; normally they act at
+ *      once, but between R_BeginDrawList and R_RunDrawList they are
+ *      recorded, so the visibility pass and the fill pass can be timed
+ *      (and run) separately.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#ifndef __R_DRAWLIST__
+#define __R_DRAWLIST__
+
+#include "r_draw.h"
+#include "i_thread.h"
+
+// Config: record the view into a draw list before filling it
+extern int render_deferred;
+
+// Microseconds the calling render thread spent working out what to draw,
+// and drawing it, last frame. When not deferring the two are interleaved
+// and all of it counts as visibility.
+extern THREAD_LOCAL int rendervisibletime, renderfilltime;
+
+// Drawn at once when not recording, otherwise a copy is kept
+void R_QueueColumn(R_DrawColumn_f colfunc, draw_column_vars_t *dcvars);
+void R_QueueSpan(draw_span_vars_t *dsvars);
+void R_QueueResetColumnBuffer(void);
+
+// Cached graphics stay locked until the columns drawn from them are done
+void R_QueueUnlockTexture(int texnum);
+void R_QueueUnlockPatch(int lump);
+void R_QueueUnlockLump(int lump);
+
+// Start the calling thread's list; if record is false everything is
+// drawn at once and the list stays empty
+void R_BeginDrawList(dbool record);
+// Draw and clear everything recorded since R_BeginDrawList
+void R_RunDrawList(void);
+// Whether the calling thread is recording rather than drawing
+dbool R_DrawListRecording(void);
+
+#endif
@@ -103,6 +103,19 @@ uint8_t *filter_getScale2xQuadColors(uint8_t e, uint8_t b, uint8_t f, uint8_t h,
 
 // do red and blue at once for slight speedup
 //
+#ifdef PRBOOM_32BPP
+#define GETBLENDED16_5050(col1, col2) \
+  ((((col1&0xff00ff)+(col2&0xff00ff))>>1)&0xff00ff) | \
+  ((((col1&0x00ff00)+(col2&0x00ff00))>>1)&0x00ff00)
+//
+#define GETBLENDED16_3268(col1, col2) \
+  ((((col1&0xff00ff)*5+(col2&0xff00ff)*11)>>4)&0xff00ff) | \
+  ((((col1&0x00ff00)*5+(col2&0x00ff00)*11)>>4)&0x00ff00)
+
+#define GETBLENDED16_9406(col1, col2) \
+  ((((col1&0xff00ff)*15+(col2&0xff00ff))>>4)&0xff00ff) | \
+  ((((col1&0x00ff00)*15+(col2&0x00ff00))>>4)&0x00ff00)
+#else
 #define GETBLENDED16_5050(col1, col2) \
   ((((col1&0xf81f)+(col2&0xf81f))>>1)&0xf81f) | \
   ((((col1&0x07e0)+(col2&0x07e0))>>1)&0x07e0)
@@ -114,5 +127,6 @@ uint8_t *filter_getScale2xQuadColors(uint8_t e, uint8_t b, uint8_t f, uint8_t h,
 #define GETBLENDED16_9406(col1, col2) \
   ((((col1&0xf81f)*15+(col2&0xf81f))>>4)&0xf81f) | \
   ((((col1&0x07e0)*15+(col2&0x07e0))>>4)&0x07e0)
+#endif
 
 #endif
@@ -38,42 +38,56 @@
 #include "p_spec.h"
 #include "r_demo.h"
 #include "r_fps.h"
+#include "g_game.h"
+#include "p_user.h"
 
 int movement_smooth = FALSE;
+int late_input = FALSE;
 
+// Interpolated values are kept in a table per kind of mover, so the
+// per-frame passes are plain loops over arrays. Each entry belongs to a
+// sector or side and is found again through slot[] when its mover stops.
 typedef enum
 {
   INTERP_SectorFloor,
   INTERP_SectorCeiling,
-  INTERP_Vertex,
   INTERP_WallPanning,
   INTERP_FloorPanning,
-  INTERP_CeilingPanning
+  INTERP_CeilingPanning,
+  NUMINTERPOLATIONTYPES
 } interpolation_type_e;
 
 dbool   WasRenderedInTryRunTics;
 
+// values per entry
+static const int interpolation_components[NUMINTERPOLATIONTYPES] = {
+  1, // INTERP_SectorFloor
+  1, // INTERP_SectorCeiling
+  2, // INTERP_WallPanning
+  2, // INTERP_FloorPanning
+  2, // INTERP_CeilingPanning
+};
+
 typedef struct
 {
-  interpolation_type_e type;
-  void *address;
-} interpolation_t;
+  int num, max;
+  int *owner;       // sector or side number of each entry
+  int *slot;        // entry of each sector or side, -1 for none
+  int numslots;
+  fixed_t **pos;    // the values, components to an entry
+  fixed_t *oldpos;  // what they were at the last tic
+  fixed_t *bakpos;  // what they really are, while interpolated
+} interpolation_table_t;
 
-static int numinterpolations = 0;
+static interpolation_table_t interpolations[NUMINTERPOLATIONTYPES];
 
 tic_vars_t tic_vars;
 
-static void R_DoAnInterpolation (int i, fixed_t smoothratio);
 void R_ResetViewInterpolation ();
 
 static dbool   NoInterpolateView;
 static dbool   didInterp;
 
-static interpolation_t *curipos;
-typedef fixed_t fixed2_t[2];
-static fixed2_t *oldipos;
-static fixed2_t *bakipos;
-
 
 void R_InterpolateView (player_t *player)
 {
@@ -114,6 +128,26 @@ void R_InterpolateView (player_t *player)
     viewangle = R_SmoothPlaying_Get(player->mo->angle) + viewangleoffset;
     viewpitch = R_SmoothPlaying_Get(player->mo->pitch) + viewpitchoffset;
   }
+
+  // The player's own view looks where they've since turned to, not where
+  // the last tic left them: the angle is that of the next tic as far as
+  // it's been built, so it carries on smoothly once the tic runs. Where
+  // the tic won't turn the player, it's left as it was.
+  if (late_input && !NoInterpolate && !demoplayback &&
+      player == &players[consoleplayer] && player->playerstate == PST_LIVE &&
+      !player->mo->reactiontime)
+  {
+    angle_t turn, look, pitch;
+
+    G_PendingLook(&turn, &look);
+    viewangle = player->mo->angle + turn + viewangleoffset;
+    if (!(automapmode & am_active) || (automapmode & am_overlay))
+    {
+      pitch = player->mo->pitch + look;
+      P_CheckPitch(&pitch);
+      viewpitch = pitch + viewpitchoffset;
+    }
+  }
 }
 
 void R_ResetViewInterpolation ()
@@ -122,192 +156,140 @@ void R_ResetViewInterpolation ()
 }
 
 
-static void R_CopyInterpToOld (int i)
+static void R_InterpolationFields(interpolation_type_e type, int owner, fixed_t **pos)
 {
-  switch (curipos[i].type)
+  switch (type)
   {
   case INTERP_SectorFloor:
-    oldipos[i][0] = ((sector_t*)curipos[i].address)->floorheight;
+    pos[0] = &sectors[owner].floorheight;
     break;
   case INTERP_SectorCeiling:
-    oldipos[i][0] = ((sector_t*)curipos[i].address)->ceilingheight;
-    break;
-  case INTERP_Vertex:
-    oldipos[i][0] = ((vertex_t*)curipos[i].address)->x;
-    oldipos[i][1] = ((vertex_t*)curipos[i].address)->y;
+    pos[0] = &sectors[owner].ceilingheight;
     break;
   case INTERP_WallPanning:
-    oldipos[i][0] = ((side_t*)curipos[i].address)->rowoffset;
-    oldipos[i][1] = ((side_t*)curipos[i].address)->textureoffset;
+    pos[0] = &sides[owner].rowoffset;
+    pos[1] = &sides[owner].textureoffset;
     break;
   case INTERP_FloorPanning:
-    oldipos[i][0] = ((sector_t*)curipos[i].address)->floor_xoffs;
-    oldipos[i][1] = ((sector_t*)curipos[i].address)->floor_yoffs;
+    pos[0] = &sectors[owner].floor_xoffs;
+    pos[1] = &sectors[owner].floor_yoffs;
     break;
   case INTERP_CeilingPanning:
-    oldipos[i][0] = ((sector_t*)curipos[i].address)->ceiling_xoffs;
-    oldipos[i][1] = ((sector_t*)curipos[i].address)->ceiling_yoffs;
-    break;
-  }
-}
-
-static void R_CopyBakToInterp (int i)
-{
-  switch (curipos[i].type)
-  {
-  case INTERP_SectorFloor:
-    ((sector_t*)curipos[i].address)->floorheight = bakipos[i][0];
-    break;
-  case INTERP_SectorCeiling:
-    ((sector_t*)curipos[i].address)->ceilingheight = bakipos[i][0];
-    break;
-  case INTERP_Vertex:
-    ((vertex_t*)curipos[i].address)->x = bakipos[i][0];
-    ((vertex_t*)curipos[i].address)->y = bakipos[i][1];
+    pos[0] = &sectors[owner].ceiling_xoffs;
+    pos[1] = &sectors[owner].ceiling_yoffs;
     break;
-  case INTERP_WallPanning:
-    ((side_t*)curipos[i].address)->rowoffset = bakipos[i][0];
-    ((side_t*)curipos[i].address)->textureoffset = bakipos[i][1];
-    break;
-  case INTERP_FloorPanning:
-    ((sector_t*)curipos[i].address)->floor_xoffs = bakipos[i][0];
-    ((sector_t*)curipos[i].address)->floor_yoffs = bakipos[i][1];
-    break;
-  case INTERP_CeilingPanning:
-    ((sector_t*)curipos[i].address)->ceiling_xoffs = bakipos[i][0];
-    ((sector_t*)curipos[i].address)->ceiling_yoffs = bakipos[i][1];
+  default:
     break;
   }
 }
 
-static void R_DoAnInterpolation (int i, fixed_t smoothratio)
+void R_UpdateInterpolations()
 {
-  fixed_t pos;
-  fixed_t *adr1 = NULL;
-  fixed_t *adr2 = NULL;
-
-  switch (curipos[i].type)
-  {
-  case INTERP_SectorFloor:
-    adr1 = &((sector_t*)curipos[i].address)->floorheight;
-    break;
-  case INTERP_SectorCeiling:
-    adr1 = &((sector_t*)curipos[i].address)->ceilingheight;
-    break;
-  case INTERP_Vertex:
-    adr1 = &((vertex_t*)curipos[i].address)->x;
-////    adr2 = &((vertex_t*)curipos[i].Address)->y;
-    break;
-  case INTERP_WallPanning:
-    adr1 = &((side_t*)curipos[i].address)->rowoffset;
-    adr2 = &((side_t*)curipos[i].address)->textureoffset;
-    break;
-  case INTERP_FloorPanning:
-    adr1 = &((sector_t*)curipos[i].address)->floor_xoffs;
-    adr2 = &((sector_t*)curipos[i].address)->floor_yoffs;
-    break;
-  case INTERP_CeilingPanning:
-    adr1 = &((sector_t*)curipos[i].address)->ceiling_xoffs;
-    adr2 = &((sector_t*)curipos[i].address)->ceiling_yoffs;
-    break;
-
- default:
+  int t, i;
+  if (!movement_smooth)
     return;
-  }
-
-  if (adr1)
+  for (t = 0; t < NUMINTERPOLATIONTYPES; t++)
   {
-    pos = bakipos[i][0] = *adr1;
-    *adr1 = oldipos[i][0] + FixedMul (pos - oldipos[i][0], smoothratio);
-  }
+    interpolation_table_t *table = &interpolations[t];
+    int count = table->num * interpolation_components[t];
 
-  if (adr2)
-  {
-    pos = bakipos[i][1] = *adr2;
-    *adr2 = oldipos[i][1] + FixedMul (pos - oldipos[i][1], smoothratio);
+    for (i = 0; i < count; i++)
+      table->oldpos[i] = *table->pos[i];
   }
-
 }
 
-
-void R_UpdateInterpolations()
+static void R_SetInterpolation(interpolation_type_e type, int owner)
 {
-  int i;
+  interpolation_table_t *table = &interpolations[type];
+  int components = interpolation_components[type];
+  int numowners = type == INTERP_WallPanning ? numsides : numsectors;
+  int i, n;
+
   if (!movement_smooth)
     return;
-  for (i = numinterpolations-1; i >= 0; --i)
-    R_CopyInterpToOld (i);
-}
 
-int interpolations_max = 0;
+  if (table->numslots != numowners)
+  {
+    table->slot = (int*)realloc(table->slot, sizeof(*table->slot) * numowners);
+    for (i = 0; i < numowners; i++)
+      table->slot[i] = -1;
+    table->numslots = numowners;
+  }
 
-static void R_SetInterpolation(interpolation_type_e type, void *posptr)
-{
-  int i;
-  if (!movement_smooth)
+  if (table->slot[owner] >= 0)
     return;
 
-  if (numinterpolations >= interpolations_max) {
-    interpolations_max = interpolations_max ? interpolations_max * 2 : 256;
+  if (table->num >= table->max) {
+    table->max = table->max ? table->max * 2 : 256;
+    n = table->max * components;
 
-    oldipos = (fixed2_t*)realloc(oldipos, sizeof(*oldipos) * interpolations_max);
-    bakipos = (fixed2_t*)realloc(bakipos, sizeof(*bakipos) * interpolations_max);
-    curipos = (interpolation_t*)realloc(curipos, sizeof(*curipos) * interpolations_max);
+    table->owner = (int*)realloc(table->owner, sizeof(*table->owner) * table->max);
+    table->pos = (fixed_t**)realloc(table->pos, sizeof(*table->pos) * n);
+    table->oldpos = (fixed_t*)realloc(table->oldpos, sizeof(*table->oldpos) * n);
+    table->bakpos = (fixed_t*)realloc(table->bakpos, sizeof(*table->bakpos) * n);
   }
 
-  for(i = numinterpolations-1; i >= 0; i--)
-    if (curipos[i].address == posptr && curipos[i].type == type)
-      return;
+  n = table->num++;
+  table->owner[n] = owner;
+  table->slot[owner] = n;
 
-  curipos[numinterpolations].address = posptr;
-  curipos[numinterpolations].type = type;
-  R_CopyInterpToOld (numinterpolations);
-  numinterpolations++;
+  n *= components;
+  R_InterpolationFields(type, owner, table->pos + n);
+  for (i = n; i < n + components; i++)
+    table->oldpos[i] = *table->pos[i];
 }
 
-static void R_StopInterpolation(interpolation_type_e type, void *posptr)
+static void R_StopInterpolation(interpolation_type_e type, int owner)
 {
-  int i;
+  interpolation_table_t *table = &interpolations[type];
+  int components = interpolation_components[type];
+  int i, last, c;
 
   if (!movement_smooth)
     return;
 
-  for(i=numinterpolations-1; i>= 0; --i)
+  if (owner >= table->numslots || (i = table->slot[owner]) < 0)
+    return;
+
+  // move the last entry into the gap
+  table->slot[owner] = -1;
+  last = --table->num;
+  if (i != last)
   {
-    if (curipos[i].address == posptr && curipos[i].type == type)
+    table->owner[i] = table->owner[last];
+    table->slot[table->owner[i]] = i;
+    for (c = 0; c < components; c++)
     {
-      numinterpolations--;
-      oldipos[i][0] = oldipos[numinterpolations][0];
-      oldipos[i][1] = oldipos[numinterpolations][1];
-      bakipos[i][0] = bakipos[numinterpolations][0];
-      bakipos[i][1] = bakipos[numinterpolations][1];
-      curipos[i] = curipos[numinterpolations];
-      break;
+      int to = i * components + c, from = last * components + c;
+
+      table->pos[to] = table->pos[from];
+      table->oldpos[to] = table->oldpos[from];
+      table->bakpos[to] = table->bakpos[from];
     }
   }
 }
 
 void R_StopAllInterpolations(void)
 {
-  int i;
+  int t, i;
 
   if (!movement_smooth)
     return;
 
-  for(i=numinterpolations-1; i>= 0; --i)
+  for (t = 0; t < NUMINTERPOLATIONTYPES; t++)
   {
-    numinterpolations--;
-    oldipos[i][0] = oldipos[numinterpolations][0];
-    oldipos[i][1] = oldipos[numinterpolations][1];
-    bakipos[i][0] = bakipos[numinterpolations][0];
-    bakipos[i][1] = bakipos[numinterpolations][1];
-    curipos[i] = curipos[numinterpolations];
+    interpolation_table_t *table = &interpolations[t];
+
+    // R_SetInterpolation resizes slot[] if the next level needs it
+    for (i = 0; i < table->num; i++)
+      table->slot[table->owner[i]] = -1;
+    table->num = 0;
   }
 }
 
 void R_DoInterpolations(fixed_t smoothratio)
 {
-  int i;
+  int t, i;
   if (!movement_smooth)
     return;
 
@@ -319,15 +301,23 @@ void R_DoInterpolations(fixed_t smoothratio)
 
   didInterp = true;
 
-  for (i = numinterpolations-1; i >= 0; --i)
+  for (t = 0; t < NUMINTERPOLATIONTYPES; t++)
   {
-    R_DoAnInterpolation (i, smoothratio);
+    interpolation_table_t *table = &interpolations[t];
+    int count = table->num * interpolation_components[t];
+
+    for (i = 0; i < count; i++)
+    {
+      fixed_t pos = table->bakpos[i] = *table->pos[i];
+
+      *table->pos[i] = table->oldpos[i] + FixedMul(pos - table->oldpos[i], smoothratio);
+    }
   }
 }
 
 void R_RestoreInterpolations()
 {
-  int i;
+  int t, i;
 
   if (!movement_smooth)
     return;
@@ -335,9 +325,13 @@ void R_RestoreInterpolations()
   if (didInterp)
   {
     didInterp = false;
-    for (i = numinterpolations-1; i >= 0; --i)
+    for (t = 0; t < NUMINTERPOLATIONTYPES; t++)
     {
-      R_CopyBakToInterp (i);
+      interpolation_table_t *table = &interpolations[t];
+      int count = table->num * interpolation_components[t];
+
+      for (i = 0; i < count; i++)
+        *table->pos[i] = table->bakpos[i];
     }
   }
 }
@@ -353,49 +347,50 @@ void R_ActivateSectorInterpolations()
   for (i=0, sec = sectors ; i<numsectors ; i++,sec++)
   {
     if (sec->floordata)
-      R_SetInterpolation (INTERP_SectorFloor, sec);
+      R_SetInterpolation (INTERP_SectorFloor, i);
     if (sec->ceilingdata)
-      R_SetInterpolation (INTERP_SectorCeiling, sec);
+      R_SetInterpolation (INTERP_SectorCeiling, i);
   }
 }
 
+// The sector or side a mover interpolates, -1 for none
 static void R_InterpolationGetData(thinker_t *th,
   interpolation_type_e *type1, interpolation_type_e *type2,
-  void **posptr1, void **posptr2)
+  int *owner1, int *owner2)
 {
-  *posptr1 = NULL;
-  *posptr2 = NULL;
+  *owner1 = -1;
+  *owner2 = -1;
 
   if (th->function == T_MoveFloor)
   {
     *type1 = INTERP_SectorFloor;
-    *posptr1 = ((floormove_t *)th)->sector;
+    *owner1 = ((floormove_t *)th)->sector - sectors;
   }
   else
   if (th->function == T_PlatRaise)
   {
     *type1 = INTERP_SectorFloor;
-    *posptr1 = ((plat_t *)th)->sector;
+    *owner1 = ((plat_t *)th)->sector - sectors;
   }
   else
   if (th->function == T_MoveCeiling)
   {
     *type1 = INTERP_SectorCeiling;
-    *posptr1 = ((ceiling_t *)th)->sector;
+    *owner1 = ((ceiling_t *)th)->sector - sectors;
   }
   else
   if (th->function == T_VerticalDoor)
   {
     *type1 = INTERP_SectorCeiling;
-    *posptr1 = ((vldoor_t *)th)->sector;
+    *owner1 = ((vldoor_t *)th)->sector - sectors;
   }
   else
   if (th->function == T_MoveElevator)
   {
     *type1 = INTERP_SectorFloor;
-    *posptr1 = ((elevator_t *)th)->sector;
+    *owner1 = ((elevator_t *)th)->sector - sectors;
     *type2 = INTERP_SectorCeiling;
-    *posptr2 = ((elevator_t *)th)->sector;
+    *owner2 = ((elevator_t *)th)->sector - sectors;
   }
   else
   if (th->function == T_Scroll)
@@ -404,15 +399,15 @@ static void R_InterpolationGetData(thinker_t *th,
     {
       case sc_side:
         *type1 = INTERP_WallPanning;
-        *posptr1 = sides + ((scroll_t *)th)->affectee;
+        *owner1 = ((scroll_t *)th)->affectee;
         break;
       case sc_floor:
         *type1 = INTERP_FloorPanning;
-        *posptr1 = sectors + ((scroll_t *)th)->affectee;
+        *owner1 = ((scroll_t *)th)->affectee;
         break;
       case sc_ceiling:
         *type1 = INTERP_CeilingPanning;
-        *posptr1 = sectors + ((scroll_t *)th)->affectee;
+        *owner1 = ((scroll_t *)th)->affectee;
         break;
       default: ;
     }
@@ -421,39 +416,37 @@ static void R_InterpolationGetData(thinker_t *th,
 
 void R_ActivateThinkerInterpolations(thinker_t *th)
 {
-  void *posptr1;
-  void *posptr2;
+  int owner1, owner2;
   interpolation_type_e type1, type2;
 
   if (!movement_smooth)
     return;
 
-  R_InterpolationGetData(th, &type1, &type2, &posptr1, &posptr2);
+  R_InterpolationGetData(th, &type1, &type2, &owner1, &owner2);
 
-  if(posptr1)
+  if(owner1 >= 0)
   {
-    R_SetInterpolation (type1, posptr1);
+    R_SetInterpolation (type1, owner1);
 
-    if(posptr2)
-      R_SetInterpolation (type2, posptr2);
+    if(owner2 >= 0)
+      R_SetInterpolation (type2, owner2);
   }
 }
 
 void R_StopInterpolationIfNeeded(thinker_t *th)
 {
-  void *posptr1;
-  void *posptr2;
+  int owner1, owner2;
   interpolation_type_e type1, type2;
 
   if (!movement_smooth)
     return;
 
-  R_InterpolationGetData(th, &type1, &type2, &posptr1, &posptr2);
+  R_InterpolationGetData(th, &type1, &type2, &owner1, &owner2);
 
-  if(posptr1)
+  if(owner1 >= 0)
   {
-    R_StopInterpolation (type1, posptr1);
-    if(posptr2)
-      R_StopInterpolation (type2, posptr2);
+    R_StopInterpolation (type1, owner1);
+    if(owner2 >= 0)
+      R_StopInterpolation (type2, owner2);
   }
 }
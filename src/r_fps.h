@@ -38,6 +38,8 @@
 #include "doomstat.h"
 
 extern int movement_smooth;
+// Config: turn the view by the input that's come in for the next tic
+extern int late_input;
 
 extern int interpolation_maxobjects;
 
@@ -34,6 +34,8 @@
  *-----------------------------------------------------------------------------*/
 
 
+#include <limits.h>
+
 #include "config.h"
 #include "doomstat.h"
 #include "d_net.h"
@@ -42,7 +44,12 @@
 #include "r_things.h"
 #include "r_plane.h"
 #include "r_bsp.h"
+#include "r_segs.h"
 #include "r_draw.h"
+#include "r_drawlist.h"
+#include "r_pvs.h"
+#include "r_arena.h"
+#include "r_profile.h"
 #include "m_bbox.h"
 #include "r_sky.h"
 #include "v_video.h"
@@ -53,6 +60,10 @@
 #include "g_game.h"
 #include "r_demo.h"
 #include "r_fps.h"
+#include "i_thread.h"
+#include "d_bench.h"
+#include "p_setup.h"
+#include "p_maputl.h"
 
 // Fineangles in the SCREENWIDTH wide window.
 #define FIELDOFVIEW 2048
@@ -288,6 +299,41 @@ angle_t R_PointToAngle2(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2)
    return 0;
 }
 
+//
+// R_PointToAngleApprox
+// Float atan2 for the renderer: one division and a polynomial, within
+// about 2^13 of the true angle, where the tantoangle[] lookup can be off
+// by nearly 2^18. Not for anything that has to match R_PointToAngle.
+//
+
+angle_t R_PointToAngleApprox(fixed_t x, fixed_t y)
+{
+  const float dx = (float)(x - viewx);
+  const float dy = (float)(y - viewy);
+  const float ax = dx < 0 ? -dx : dx;
+  const float ay = dy < 0 ? -dy : dy;
+  float z, z2, a;
+  angle_t an;
+
+  if (ax == 0 && ay == 0)
+    return 0;
+
+  z = ax > ay ? ay / ax : ax / ay;
+  z2 = z * z;
+  // atan(z) for 0 <= z <= 1, scaled so pi/4 is ANG45
+  a = z * (0.9998660f + z2 * (-0.3302995f + z2 * (0.1801410f +
+        z2 * (-0.0851330f + z2 * 0.0208351f))));
+  an = (angle_t)(a * (float)(ANG180 / 3.14159265358979323846));
+
+  if (ay > ax)
+    an = ANG90 - an;
+  if (dx < 0)
+    an = ANG180 - an;
+  if (dy < 0)
+    an = 0 - an;
+  return an;
+}
+
 //
 // R_InitTextureMapping
 //
@@ -333,10 +379,12 @@ static void R_InitTextureMapping (void)
   //  xtoviewangle will give the smallest view angle
   //  that maps to x.
 
-  for (x=0; x<=viewwidth; x++)
+  // viewangletox[] never rises with i, so one pass from the right edge
+  // finds them all rather than a scan from 0 for every x
+  for (i=0, x=viewwidth; x>=0; x--)
     {
-      for (i=0; viewangletox[i] > x; i++)
-        ;
+      while (viewangletox[i] > x)
+        i++;
       xtoviewangle[x] = (i<<ANGLETOFINESHIFT)-ANG90;
     }
 
@@ -406,12 +454,160 @@ void R_SetViewSize(int blocks)
   setblocks = blocks;
 }
 
+//
+// Dynamic resolution
+// While R_RenderPlayerView overruns the budget the view is drawn smaller,
+// in eighths of its size on screen, and scaled up into screens[0]. The
+// status bar, HUD and menus are drawn over it at full size as usual.
+//
+
+static const int dynres_scales[] = { 8, 7, 6, 5, 4 };
+#define DYNRES_STEPS (sizeof(dynres_scales) / sizeof(*dynres_scales))
+#define DYNRES_HOLD  16  // frames to settle after a step before the next
+
+static int dynres_budget;              // microseconds, 0 for always full size
+static int dynres_step, dynres_wanted; // index into dynres_scales
+static int dynres_time, dynres_hold;
+
+void R_SetDynamicResolution(int budget)
+{
+  dynres_budget = budget > 0 ? budget : 0;
+  if (!dynres_budget)
+    dynres_wanted = 0;
+  dynres_time = 0;
+  dynres_hold = 0;
+}
+
+int R_GetDynamicResolution(void)
+{
+  return dynres_budget;
+}
+
+//
+// R_AdaptViewScale
+// Picks the scale for the next frame from the time this one took. Fill
+// time goes with the number of pixels, so moving back up a step waits
+// until the larger view is expected to fit with room to spare.
+//
+
+static void R_AdaptViewScale(int time)
+{
+  int step = dynres_step;
+
+  if (!dynres_budget || time <= 0) // no clock to go by
+    return;
+
+  dynres_time = dynres_time ? (dynres_time * 7 + time) / 8 : time;
+
+  if (dynres_hold)
+  {
+    dynres_hold--;
+    return;
+  }
+
+  if (dynres_time > dynres_budget)
+  {
+    if (step < (int)DYNRES_STEPS - 1)
+      step++;
+  }
+  else if (step > 0)
+  {
+    int64_t cur = dynres_scales[step], up = dynres_scales[step - 1];
+
+    if (dynres_time * up * up < (int64_t)dynres_budget * cur * cur * 3 / 4)
+      step--;
+  }
+
+  if (step != dynres_step)
+  {
+    dynres_wanted = step;
+    dynres_time = 0;
+    dynres_hold = DYNRES_HOLD;
+  }
+}
+
+//
+// View size tables
+// R_ExecuteSetViewSize runs again on every dynamic resolution step and
+// screenblocks change. The projection tables only depend on the view and
+// screen sizes, so those of the last few view sizes are kept and copied
+// back when one comes round again instead of being worked out anew.
+//
+
+#define VIEWTABLES_CACHED 8
+
+typedef struct {
+  int width, height;              // viewwidth and viewheight, 0 if unused
+  int screenwidth, screenheight;
+  fixed_t focallength;
+  angle_t clipangle;
+  int *viewangletox;              // FINEANGLES/2
+  angle_t *xtoviewangle;          // width+1
+  fixed_t *yslope;                // height
+  fixed_t *distscale;             // width
+} viewtables_t;
+
+static viewtables_t viewtables[VIEWTABLES_CACHED];
+static int viewtables_next;
+
+static const viewtables_t *R_FindViewTables(void)
+{
+  int i;
+
+  for (i = 0; i < VIEWTABLES_CACHED; i++)
+    if (viewtables[i].width == viewwidth && viewtables[i].height == viewheight &&
+        viewtables[i].screenwidth == SCREENWIDTH && viewtables[i].screenheight == SCREENHEIGHT)
+      return &viewtables[i];
+  return NULL;
+}
+
+static void R_LoadViewTables(const viewtables_t *vt)
+{
+  fieldofview = FIELDOFVIEW;
+  focallength = vt->focallength;
+  clipangle = vt->clipangle;
+  memcpy(viewangletox, vt->viewangletox, sizeof(*viewangletox) * (FINEANGLES/2));
+  memcpy(xtoviewangle, vt->xtoviewangle, sizeof(*xtoviewangle) * (viewwidth+1));
+  memcpy(yslope, vt->yslope, sizeof(*yslope) * viewheight);
+  memcpy(distscale, vt->distscale, sizeof(*distscale) * viewwidth);
+}
+
+// Keep the current tables, in place of the oldest kept
+static void R_SaveViewTables(void)
+{
+  viewtables_t *vt = &viewtables[viewtables_next];
+
+  viewtables_next = (viewtables_next + 1) % VIEWTABLES_CACHED;
+
+  // one block for all four, the same size as the tables themselves
+  free(vt->viewangletox);
+  vt->viewangletox = malloc(sizeof(*vt->viewangletox) * (FINEANGLES/2) +
+                            sizeof(*vt->xtoviewangle) * (viewwidth+1) +
+                            sizeof(*vt->yslope) * viewheight +
+                            sizeof(*vt->distscale) * viewwidth);
+  vt->xtoviewangle = (angle_t *)(vt->viewangletox + FINEANGLES/2);
+  vt->yslope = (fixed_t *)(vt->xtoviewangle + viewwidth+1);
+  vt->distscale = vt->yslope + viewheight;
+
+  vt->width = viewwidth;
+  vt->height = viewheight;
+  vt->screenwidth = SCREENWIDTH;
+  vt->screenheight = SCREENHEIGHT;
+  vt->focallength = focallength;
+  vt->clipangle = clipangle;
+  memcpy(vt->viewangletox, viewangletox, sizeof(*viewangletox) * (FINEANGLES/2));
+  memcpy(vt->xtoviewangle, xtoviewangle, sizeof(*xtoviewangle) * (viewwidth+1));
+  memcpy(vt->yslope, yslope, sizeof(*yslope) * viewheight);
+  memcpy(vt->distscale, distscale, sizeof(*distscale) * viewwidth);
+}
+
 //
 // R_ExecuteSetViewSize
 //
 
 void R_ExecuteSetViewSize (void)
 {
+  const viewtables_t *tables;
   int i;
 
   setsizeneeded = FALSE;
@@ -419,15 +615,17 @@ void R_ExecuteSetViewSize (void)
   if (!setblocks)
   {
      scaledviewwidth = SCREENWIDTH;
-     viewheight = SCREENHEIGHT - ST_SCALED_HEIGHT;
+     scaledviewheight = SCREENHEIGHT - ST_SCALED_HEIGHT;
   }
   else
   {
      scaledviewwidth = SCREENWIDTH;
-     viewheight = SCREENHEIGHT;
+     scaledviewheight = SCREENHEIGHT;
   }
 
-  viewwidth = scaledviewwidth;
+  dynres_step = dynres_wanted;
+  viewwidth = scaledviewwidth * dynres_scales[dynres_step] / 8;
+  viewheight = scaledviewheight * dynres_scales[dynres_step] / 8;
 
   viewheightfrac = viewheight<<FRACBITS;//e6y
 
@@ -439,9 +637,13 @@ void R_ExecuteSetViewSize (void)
 // proff 11/06/98: Added for high-res
   projectiony = ((SCREENHEIGHT * centerx * 320) / 200) / SCREENWIDTH * FRACUNIT;
 
-  R_InitBuffer (scaledviewwidth, viewheight);
+  R_InitBuffer (viewwidth, viewheight);
 
-  R_InitTextureMapping();
+  tables = R_FindViewTables();
+  if (tables)
+    R_LoadViewTables(tables);
+  else
+    R_InitTextureMapping();
 
   // psprite scales
 // proff 08/17/98: Changed for high-res
@@ -460,6 +662,9 @@ void R_ExecuteSetViewSize (void)
   for (i=0 ; i<viewwidth ; i++)
     screenheightarray[i] = viewheight;
 
+  if (tables)
+    return;
+
   // planes
   for (i=0 ; i<viewheight ; i++)
     {   // killough 5/2/98: reformatted
@@ -474,6 +679,7 @@ void R_ExecuteSetViewSize (void)
       distscale[i] = FixedDiv(FRACUNIT,cosadj);
     }
 
+  R_SaveViewTables();
 }
 
 //
@@ -484,6 +690,8 @@ extern int screenblocks;
 
 void R_Init (void)
 {
+  int phase;
+
   // CPhipps - R_DrawColumn isn't constant anymore, so must
   //  initialise in code
   // current column draw function
@@ -501,7 +709,96 @@ void R_Init (void)
   lprintf(LO_INFO, "R_InitTranslationsTables\n");
   R_InitTranslationTables();
   lprintf(LO_INFO, "R_InitPatches\n");
+  phase = D_StartupBegin("R_InitPatches");
   R_InitPatches();
+  D_StartupEnd(phase);
+}
+
+//
+// Subsector grid
+// For each blockmap cell, the node that R_PointInSubsector's descent
+// reaches from the root for every point of the cell alike; lookups inside
+// the grid start there instead of at the root.
+//
+
+static int *subsectorgrid;
+static fixed_t ssgridorgx, ssgridorgy;
+static int ssgridwidth, ssgridheight;
+
+//
+// R_RectOnSide
+// The side of node that every point of x1..x2 by y1..y2 is on, or -1.
+// Away from the node's origin lines, R_PointOnSide is either a constant or
+// the difference of a function of y and one of x, each monotonic, so
+// evaluating it at the corners of the pieces either side of those lines
+// covers the whole rectangle.
+//
+
+static int R_RectOnSide(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
+                        const node_t *node)
+{
+  fixed_t xs[4], ys[4];
+  int numxs = 2, numys = 2, side, i, j;
+
+  // the relative coordinates mustn't wrap anywhere in the rectangle
+  if ((int64_t)x1 - node->x < INT_MIN || (int64_t)x2 - node->x > INT_MAX ||
+      (int64_t)y1 - node->y < INT_MIN || (int64_t)y2 - node->y > INT_MAX)
+    return -1;
+
+  xs[0] = x1, xs[1] = x2;
+  if (node->x > x1 && node->x <= x2)
+    xs[numxs++] = node->x - 1, xs[numxs++] = node->x;
+  ys[0] = y1, ys[1] = y2;
+  if (node->y > y1 && node->y <= y2)
+    ys[numys++] = node->y - 1, ys[numys++] = node->y;
+
+  side = R_PointOnSide(x1, y1, node);
+  for (i = 0; i < numxs; i++)
+    for (j = 0; j < numys; j++)
+      if (R_PointOnSide(xs[i], ys[j], node) != side)
+        return -1;
+  return side;
+}
+
+//
+// R_BuildSubsectorGrid
+// Call once the level's nodes and blockmap are loaded
+//
+
+void R_BuildSubsectorGrid(void)
+{
+  int bx, by;
+
+  subsectorgrid = NULL;
+  if (!numnodes || bmapwidth <= 0 || bmapheight <= 0)
+    return;
+
+  ssgridorgx = bmaporgx;
+  ssgridorgy = bmaporgy;
+  ssgridwidth = bmapwidth;
+  ssgridheight = bmapheight;
+  subsectorgrid = Z_Malloc(ssgridwidth * ssgridheight * sizeof(*subsectorgrid), PU_LEVEL, 0);
+
+  for (by = 0; by < ssgridheight; by++)
+    for (bx = 0; bx < ssgridwidth; bx++)
+    {
+      int64_t x1 = (int64_t)ssgridorgx + ((int64_t)bx << MAPBLOCKSHIFT);
+      int64_t y1 = (int64_t)ssgridorgy + ((int64_t)by << MAPBLOCKSHIFT);
+      int nodenum = numnodes-1;
+
+      if (x1 + MAPBLOCKSIZE - 1 <= INT_MAX && y1 + MAPBLOCKSIZE - 1 <= INT_MAX)
+        while (!(nodenum & NF_SUBSECTOR))
+        {
+          int side = R_RectOnSide((fixed_t)x1, (fixed_t)y1,
+              (fixed_t)(x1 + MAPBLOCKSIZE - 1), (fixed_t)(y1 + MAPBLOCKSIZE - 1),
+              &nodes[nodenum]);
+
+          if (side < 0)
+            break;
+          nodenum = nodes[nodenum].children[side];
+        }
+      subsectorgrid[by * ssgridwidth + bx] = nodenum;
+    }
 }
 
 /*
@@ -522,6 +819,15 @@ subsector_t *R_PointInSubsector(fixed_t x, fixed_t y)
 
    nodenum = numnodes-1;
 
+   if (subsectorgrid)
+   {
+      int64_t bx = ((int64_t)x - ssgridorgx) >> MAPBLOCKSHIFT;
+      int64_t by = ((int64_t)y - ssgridorgy) >> MAPBLOCKSHIFT;
+
+      if (bx >= 0 && bx < ssgridwidth && by >= 0 && by < ssgridheight)
+         nodenum = subsectorgrid[by * ssgridwidth + bx];
+   }
+
    while (!(nodenum & NF_SUBSECTOR))
    {
       node_t *node   = &nodes[nodenum];
@@ -614,58 +920,315 @@ static void R_SetupFrame (player_t *player)
   else
     fixedcolormap = 0;
 
+  R_SetupPVS(viewx, viewy);
+
+  vertexgen++;
   validcount++;
 }
 
 int autodetect_hom = 0;       // killough 2/7/98: HOM autodetection flag
 
+// View columns drawn by the calling thread, and which slice that is.
+// Slice 0 always belongs to the main thread.
+THREAD_LOCAL int slicex1, slicex2, slicenum;
+
 //
-// R_RenderView
+// R_SetSlice
+// Cuts the view into count vertical bands. Bands are kept a multiple
+// of 4 columns wide so the quad column buffer never straddles two threads.
 //
-void R_RenderPlayerView (player_t* player)
+
+static void R_SetSlice(int num, int count)
 {
-  R_SetupFrame (player);
+  int width = ((viewwidth + count - 1) / count + 3) & ~3;
+
+  slicenum = num;
+  slicex1 = num * width;
+  slicex2 = num == count - 1 ? viewwidth - 1 : slicex1 + width - 1;
+  if (slicex2 > viewwidth - 1)
+    slicex2 = viewwidth - 1;
+}
+
+// Set for a frame drawn while the next tic runs (see D_StartPendingTic):
+// the view is recorded, and nothing reads the game state once every
+// slice has got through R_RenderSliceVisible
+static dbool renderholdtic;
+
+//
+// R_RenderSliceVisible
+// Everything after R_SetupFrame that reads the level, for the columns
+// of the current slice
+//
+
+static void R_RenderSliceVisible(void)
+{
+  R_BeginDrawList(render_deferred || renderholdtic);
 
   // Clear buffers.
+  R_ResetRenderArena ();
   R_ClearClipSegs ();
   R_ClearDrawSegs ();
   R_ClearPlanes ();
   R_ClearSprites ();
 
-    if (autodetect_hom)
-    { // killough 2/10/98: add flashing red HOM indicators
-      unsigned char color=(gametic % 20) < 9 ? 0xb0 : 0;
-      V_FillRect(0, 0, viewwidth, viewheight, color);
-    }
-
   // check for new console commands.
 #ifdef HAVE_NET
   NetUpdate ();
 #endif
 
   // The head node is the last node output.
+  R_ProfileStart(RPS_BSP);
   R_RenderBSPNode (numnodes-1);
-  R_ResetColumnBuffer();
+  R_QueueResetColumnBuffer();
+  R_ProfileStop(RPS_BSP);
 
   // Check for new console commands.
 #ifdef HAVE_NET
   NetUpdate ();
 #endif
 
+    R_ProfileStart(RPS_PLANES);
     R_DrawPlanes ();
+    R_ProfileStop(RPS_PLANES);
 
   // Check for new console commands.
 #ifdef HAVE_NET
   NetUpdate ();
 #endif
 
+    R_ProfileStart(RPS_MASKED);
     R_DrawMasked ();
-    R_ResetColumnBuffer();
+    R_QueueResetColumnBuffer();
+    R_ProfileStop(RPS_MASKED);
+}
+
+//
+// R_RenderSliceFill
+// Fills the slice from what R_RenderSliceVisible recorded, if anything
+//
+
+static void R_RenderSliceFill(void)
+{
+  R_ProfileStart(RPS_FILL);
+  R_RunDrawList();
+  R_ProfileStop(RPS_FILL);
+
+  R_FinishViewBuffer(slicex1, slicex2);
 
   // Check for new console commands.
 #ifdef HAVE_NET
   NetUpdate ();
 #endif
+}
+
+#ifdef PRBOOM_THREADS
+//
+// Screen-slice renderer threads
+//
+// Each worker walks the whole BSP for its own band of the view, with the
+// columns outside the band marked solid up front. All of the state that
+// changes while drawing lives in THREAD_LOCAL storage in r_bsp, r_segs,
+// r_plane, r_things and r_draw; view setup stays on the main thread.
+//
+
+typedef struct {
+  i_thread_t *thread;
+  int        num;
+  unsigned   frame;
+} renderworker_t;
+
+static renderworker_t renderworkers[MAX_RENDER_THREADS];
+static int      numrenderslices = 1;
+static i_mutex_t *renderlock;
+static i_cond_t *renderstart, *renderdone, *rendervisible;
+static unsigned renderframe;
+static int      renderpending, rendervisiblepending;
+static dbool    renderquit;
+
+static void R_RenderWorker(void *arg)
+{
+  renderworker_t *worker = arg;
+
+  I_MutexLock(renderlock);
+  for (;;)
+  {
+    while (worker->frame == renderframe && !renderquit)
+      I_CondWait(renderstart, renderlock);
+    if (renderquit)
+      break;
+    worker->frame = renderframe;
+    I_MutexUnlock(renderlock);
+
+    R_SetSlice(worker->num, numrenderslices);
+    if (slicex1 <= slicex2)
+      R_RenderSliceVisible();
+
+    I_MutexLock(renderlock);
+    if (--rendervisiblepending == 0)
+      I_CondSignal(rendervisible);
+    I_MutexUnlock(renderlock);
+
+    if (slicex1 <= slicex2)
+      R_RenderSliceFill();
+
+    I_MutexLock(renderlock);
+    if (--renderpending == 0)
+      I_CondSignal(renderdone);
+  }
+  I_MutexUnlock(renderlock);
+}
+
+static void R_StopRenderThreads(void)
+{
+  int i;
+
+  if (numrenderslices <= 1)
+    return;
+
+  I_MutexLock(renderlock);
+  renderquit = TRUE;
+  I_CondBroadcast(renderstart);
+  I_MutexUnlock(renderlock);
+
+  for (i = 1; i < numrenderslices; i++)
+  {
+    I_ThreadJoin(renderworkers[i].thread);
+    renderworkers[i].thread = NULL;
+  }
+
+  renderquit = FALSE;
+  numrenderslices = 1;
+}
+
+//
+// R_SetRenderThreads
+// Changes the number of threads the view is split between. Must be
+// called between frames. Falls back to as many threads as could be
+// started, down to plain single-threaded rendering.
+//
+
+void R_SetRenderThreads(int count)
+{
+  int i;
+
+  if (count < 1)
+    count = 1;
+  if (count > MAX_RENDER_THREADS)
+    count = MAX_RENDER_THREADS;
+  if (count == numrenderslices)
+    return;
+
+  R_StopRenderThreads();
+
+  if (count == 1)
+    return;
 
-  R_RestoreInterpolations();
+  if (!renderlock)
+  {
+    renderlock  = I_MutexCreate();
+    renderstart = I_CondCreate();
+    renderdone  = I_CondCreate();
+    rendervisible = I_CondCreate();
+    if (!renderlock || !renderstart || !renderdone || !rendervisible)
+    {
+      lprintf(LO_WARN, "R_SetRenderThreads: threads unavailable\n");
+      return;
+    }
+  }
+
+  for (i = 1; i < count; i++)
+  {
+    renderworkers[i].num = i;
+    renderworkers[i].frame = renderframe;
+    if (!(renderworkers[i].thread = I_ThreadCreate(R_RenderWorker, &renderworkers[i])))
+      break;
+    numrenderslices = i + 1;
+  }
+
+  if (numrenderslices != count)
+    lprintf(LO_WARN, "R_SetRenderThreads: only %d of %d threads started\n",
+        numrenderslices, count);
+}
+#else
+void R_SetRenderThreads(int count)
+{
+}
+#endif
+
+//
+// R_RenderView
+//
+void R_RenderPlayerView (player_t* player)
+{
+  int64_t starttime;
+
+  if (dynres_step != dynres_wanted)
+  {
+    R_ExecuteSetViewSize();
+    screen_dirty = TRUE;
+  }
+
+  starttime = I_GetTimeUS();
+#ifdef RENDER_PROFILE
+  R_StartProfileFrame();
+#endif
+
+  R_SetupFrame (player);
+  R_UpdateSkyCache();
+
+  // killough 2/10/98: add flashing red HOM indicators
+  R_StartViewBuffer(autodetect_hom ? ((gametic % 20) < 9 ? 0xb0 : 0) : -1);
+
+  renderholdtic = D_TicPending();
+
+#ifdef PRBOOM_THREADS
+  if (numrenderslices > 1)
+  {
+    I_MutexLock(renderlock);
+    renderpending = rendervisiblepending = numrenderslices - 1;
+    renderframe++;
+    I_CondBroadcast(renderstart);
+    I_MutexUnlock(renderlock);
+
+    R_SetSlice(0, numrenderslices);
+    R_RenderSliceVisible();
+
+    if (renderholdtic)
+    {
+      I_MutexLock(renderlock);
+      while (rendervisiblepending)
+        I_CondWait(rendervisible, renderlock);
+      I_MutexUnlock(renderlock);
+
+      R_RestoreInterpolations();
+      D_StartPendingTic();
+    }
+
+    R_RenderSliceFill();
+
+    I_MutexLock(renderlock);
+    while (renderpending)
+      I_CondWait(renderdone, renderlock);
+    I_MutexUnlock(renderlock);
+  }
+  else
+#endif
+  {
+    R_SetSlice(0, 1);
+    R_RenderSliceVisible();
+    if (renderholdtic)
+    {
+      R_RestoreInterpolations();
+      D_StartPendingTic();
+    }
+    R_RenderSliceFill();
+  }
+
+  if (!renderholdtic)
+    R_RestoreInterpolations();
+
+  R_AdaptViewScale((int)(I_GetTimeUS() - starttime));
+#ifdef RENDER_PROFILE
+  R_EndProfileFrame();
+#endif
 }
@@ -36,6 +36,7 @@
 
 #include "d_player.h"
 #include "r_data.h"
+#include "i_thread.h"
 
 //
 // POV related.
@@ -56,6 +57,9 @@ extern fixed_t  projectiony; /* proff 11/06/98: Added for high-res */
 extern int      validcount;
 extern fixed_t skyiscale;
 
+// Columns of the view drawn by this thread (see R_SetRenderThreads)
+extern THREAD_LOCAL int slicex1, slicex2, slicenum;
+
 //
 // Lighting LUT.
 // Used for z-depth cuing per column/row,
@@ -94,7 +98,13 @@ int R_PointOnSide(fixed_t x, fixed_t y, const node_t *node);
 int R_PointOnSegSide(fixed_t x, fixed_t y, const seg_t *line);
 angle_t R_PointToAngle(fixed_t x, fixed_t y);
 angle_t R_PointToAngle2(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2);
+// float version of R_PointToAngle, off by less than a fine angle;
+// renderer culling only, never game logic
+angle_t R_PointToAngleApprox(fixed_t x, fixed_t y);
 subsector_t *R_PointInSubsector(fixed_t x, fixed_t y);
+// Where R_PointInSubsector starts its descent for each blockmap cell;
+// call once the level's nodes and blockmap are loaded
+void R_BuildSubsectorGrid(void);
 
 //
 // REFRESH - the actual rendering functions.
@@ -105,4 +115,9 @@ void R_Init(void);                           // Called by startup code.
 void R_SetViewSize(int blocks);              // Called by M_Responder.
 void R_ExecuteSetViewSize(void);             // cph - called by D_Display to complete a view resize
 
+#define MAX_RENDER_THREADS 8
+void R_SetRenderThreads(int count);          // Split the view between threads
+void R_SetDynamicResolution(int budget);     // Shrink the view to keep it under budget us, 0 for off
+int R_GetDynamicResolution(void);            // The budget last set
+
 #endif
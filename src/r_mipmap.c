@@ -0,0 +1,215 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Mip chains of flats and wall textures. Each level halves the one
+ *      above it, averaging 2x2 blocks in PLAYPAL colour and mapping the
+ *      result back to the nearest palette entry. Built the first time a
+ *      flat or texture is drawn in mipmap mode and kept until R_FreeMips,
+ *      when the wads are unloaded or the textures set up again.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#include "z_zone.h"
+#include "doomstat.h"
+#include "w_wad.h"
+#include "r_main.h"
+#include "r_patch.h"
+#include "r_mipmap.h"
+
+const int flatmipofs[FLAT_MIPLEVELS] = { 0, 4096, 5120, 5376, 5440, 5456, 5460 };
+
+static uint8_t **flatmips;
+static texmips_t **texturemips;
+static int numflatmips, numtexturemips;  // numflats, numtextures when made
+
+static uint8_t mippalette[256*3];  // PLAYPAL's first palette
+static uint8_t *rgb555topal;       // nearest palette entry of each 5:5:5 colour
+
+static void R_InitMipPalette(void)
+{
+  int c;
+
+  memcpy(mippalette, W_CacheLumpName("PLAYPAL"), sizeof mippalette);
+  W_UnlockLumpName("PLAYPAL");
+  rgb555topal = malloc(32768);
+
+  for (c = 0; c < 32768; c++)
+  {
+    int r = ((c >> 10) & 31) << 3, g = ((c >> 5) & 31) << 3, b = (c & 31) << 3;
+    int best = 0, bestdist = INT_MAX, i;
+
+    for (i = 0; i < 256; i++)
+    {
+      int dr = mippalette[i*3] - r, dg = mippalette[i*3+1] - g, db = mippalette[i*3+2] - b;
+      int dist = dr*dr + dg*dg + db*db;
+      if (dist < bestdist)
+      {
+        bestdist = dist;
+        best = i;
+      }
+    }
+    rgb555topal[c] = best;
+  }
+}
+
+static uint8_t R_AveragePixels(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+{
+  const uint8_t *pa = mippalette + a*3, *pb = mippalette + b*3;
+  const uint8_t *pc = mippalette + c*3, *pd = mippalette + d*3;
+  int r = (pa[0] + pb[0] + pc[0] + pd[0] + 2) >> 2;
+  int g = (pa[1] + pb[1] + pc[1] + pd[1] + 2) >> 2;
+  int bl = (pa[2] + pb[2] + pc[2] + pd[2] + 2) >> 2;
+
+  return rgb555topal[((r >> 3) << 10) | ((g >> 3) << 5) | (bl >> 3)];
+}
+
+// Halve a w x h image; pixel (u, v) is at u*ustride + v*vstride in both
+static void R_HalveImage(uint8_t *dest, int dustride, int dvstride,
+                         const uint8_t *src, int ustride, int vstride,
+                         int w, int h)
+{
+  int u, v;
+
+  for (u = 0; u < w/2; u++)
+    for (v = 0; v < h/2; v++)
+    {
+      const uint8_t *s = src + 2*u*ustride + 2*v*vstride;
+      dest[u*dustride + v*dvstride] =
+        R_AveragePixels(s[0], s[ustride], s[vstride], s[ustride + vstride]);
+    }
+}
+
+const uint8_t *R_GetFlatMips(int flatnum)
+{
+  uint8_t *mips;
+  int l;
+
+  Z_Lock();
+  if (!flatmips)
+  {
+    flatmips = calloc(numflats, sizeof *flatmips);
+    numflatmips = numflats;
+  }
+  if (!rgb555topal)
+    R_InitMipPalette();
+
+  if (!(mips = flatmips[flatnum]))
+  {
+    mips = malloc(FLAT_MIPSIZE);
+    memcpy(mips, W_CacheLumpNum(firstflat + flatnum), 4096);
+    W_UnlockLumpNum(firstflat + flatnum);
+
+    // flats are row-major, 64 >> l texels a row
+    for (l = 1; l < FLAT_MIPLEVELS; l++)
+    {
+      int size = 64 >> (l-1);
+      R_HalveImage(mips + flatmipofs[l], 1, size/2,
+                   mips + flatmipofs[l-1], 1, size, size, size);
+    }
+    flatmips[flatnum] = mips;
+  }
+  Z_Unlock();
+
+  return mips;
+}
+
+const texmips_t *R_GetTextureMips(int texnum)
+{
+  texmips_t *mips;
+
+  Z_Lock();
+  if (!texturemips)
+  {
+    texturemips = calloc(numtextures, sizeof *texturemips);
+    numtexturemips = numtextures;
+  }
+  if (!rgb555topal)
+    R_InitMipPalette();
+
+  if (!(mips = texturemips[texnum]))
+  {
+    const rpatch_t *patch = R_CacheTextureCompositePatchNum(texnum);
+    int width = patch->widthmask + 1, x, l;
+
+    mips = calloc(1, sizeof *mips);
+    mips->widthmask[0] = patch->widthmask;
+    mips->height[0] = patch->height;
+
+    // level 0 is the composite itself, less any columns past widthmask
+    mips->pixels[0] = malloc(width * patch->height);
+    for (x = 0; x < width; x++)
+      memcpy(mips->pixels[0] + x * patch->height, patch->columns[x].pixels, patch->height);
+    R_UnlockTextureCompositePatchNum(texnum);
+
+    // stop once a level would no longer line up with the one above
+    for (l = 1; l < TEXTURE_MIPLEVELS; l++)
+    {
+      int w = (mips->widthmask[l-1] + 1), h = mips->height[l-1];
+
+      if (w < 2 || h < 2 || (h & 1))
+        break;
+      mips->widthmask[l] = (w >> 1) - 1;
+      mips->height[l] = h >> 1;
+      mips->pixels[l] = malloc((w >> 1) * (h >> 1));
+      R_HalveImage(mips->pixels[l], h/2, 1, mips->pixels[l-1], h, 1, w, h);
+    }
+    mips->levels = l;
+    texturemips[texnum] = mips;
+  }
+  Z_Unlock();
+
+  return mips;
+}
+
+void R_FreeMips(void)
+{
+  int i, l;
+
+  Z_Lock();
+  for (i = 0; i < numflatmips; i++)
+    free(flatmips[i]);
+  free(flatmips);
+  flatmips = NULL;
+  numflatmips = 0;
+
+  for (i = 0; i < numtexturemips; i++)
+    if (texturemips[i])
+    {
+      for (l = 0; l < texturemips[i]->levels; l++)
+        free(texturemips[i]->pixels[l]);
+      free(texturemips[i]);
+    }
+  free(texturemips);
+  texturemips = NULL;
+  numtexturemips = 0;
+
+  free(rgb555topal);
+  rgb555topal = NULL;
+  Z_Unlock();
+}
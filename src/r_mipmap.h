@@ -0,0 +1,83 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Mip chains of flats and wall textures, for RDRAW_FILTER_MIPMAP.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#ifndef R_MIPMAP_H
+#define R_MIPMAP_H
+
+#include <retro_inline.h>
+#include "doomtype.h"
+#include "m_fixed.h"
+
+// 64x64, 32x32, ... 1x1
+#define FLAT_MIPLEVELS 7
+#define FLAT_MIPSIZE   5461
+
+// Offset of each level into a flat's mip chain
+extern const int flatmipofs[FLAT_MIPLEVELS];
+
+// Levels 0..levels-1; level l is (widthmask+1)>>l columns of height>>l
+// pixels, column-major like the composite it came from
+#define TEXTURE_MIPLEVELS 6
+
+typedef struct {
+  int levels;
+  unsigned widthmask[TEXTURE_MIPLEVELS];
+  int height[TEXTURE_MIPLEVELS];
+  uint8_t *pixels[TEXTURE_MIPLEVELS];
+} texmips_t;
+
+// The flat's levels back to back, level 0 first. Both are built on first
+// use and take the zone lock, so look them up once a plane or seg.
+const uint8_t *R_GetFlatMips(int flatnum);
+const texmips_t *R_GetTextureMips(int texnum);
+
+// Drops every mip chain and the palette lookup, before the flats and
+// textures they were built from change or go
+void R_FreeMips(void);
+
+// Level whose texels are about a pixel apart at step texels per pixel
+static INLINE int R_MipLevel(fixed_t step, int levels)
+{
+  int level = 0;
+
+  if (step < 0)
+    step = -step;
+  while (step >= 2*FRACUNIT && level < levels-1)
+  {
+    step >>= 1;
+    level++;
+  }
+  return level;
+}
+
+#endif
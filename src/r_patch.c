@@ -40,6 +40,8 @@
 #include "r_draw.h"
 #include "lprintf.h"
 #include "r_patch.h"
+#include "r_patchcache.h"
+#include "i_jobs.h"
 
 // posts are runs of non masked source pixels
 typedef struct
@@ -88,6 +90,23 @@ void R_InitPatches(void) {
     // clear out new patches to signal they're uninitialized
     memset(texture_composites, 0, sizeof(rpatch_t)*numtextures);
   }
+  R_OpenPatchCache(numlumps + numtextures);
+}
+
+//---------------------------------------------------------------------------
+size_t R_PatchCacheBytes(void) {
+  size_t bytes = 0;
+  int i;
+
+  Z_Lock();
+  if (patches)
+    for (i = 0; i < numlumps; i++)
+      bytes += Z_BlockSize(patches[i].data);
+  if (texture_composites)
+    for (i = 0; i < numtextures; i++)
+      bytes += Z_BlockSize(texture_composites[i].data);
+  Z_Unlock();
+  return bytes;
 }
 
 //---------------------------------------------------------------------------
@@ -191,7 +210,7 @@ static int getColumnEdgeSlope(const column_t *prevcolumn, const column_t *nextco
 static void createPatch(int id) {
   rpatch_t *patch;
   const int patchNum = id;
-  const patch_t *oldPatch = (const patch_t*)W_CacheLumpNum(patchNum);
+  const patch_t *oldPatch;
   const column_t *oldColumn, *oldPrevColumn, *oldNextColumn;
   int x, y;
   int pixelDataSize;
@@ -205,6 +224,11 @@ static void createPatch(int id) {
   int edgeSlope;
 
   patch = &patches[id];
+  if (R_LoadCachedPatch(id, patch, PU_CACHE))
+    return;
+
+  oldPatch = (const patch_t*)W_CacheLumpNum(patchNum);
+
   // proff - 2003-02-16 What about endianess?
   patch->width = SHORT(oldPatch->width);
   patch->widthmask = 0;
@@ -356,6 +380,8 @@ static void createPatch(int id) {
 
   W_UnlockLumpNum(patchNum);
   free(numPostsInColumn);
+
+  R_StoreCachedPatch(id, patch);
 }
 
 typedef struct {
@@ -413,6 +439,14 @@ static void createTextureCompositePatch(int id) {
 
 
   composite_patch = &texture_composites[id];
+  // the disk cache has one file position; builds may run on the job pool
+  Z_Lock();
+  if (R_LoadCachedPatch(numlumps + id, composite_patch, PU_STATIC))
+  {
+    Z_Unlock();
+    return;
+  }
+  Z_Unlock();
 
   texture = textures[id];
 
@@ -670,6 +704,29 @@ static void createTextureCompositePatch(int id) {
   }
 
   free(countsInColumn);
+
+  Z_Lock();
+  R_StoreCachedPatch(numlumps + id, composite_patch);
+  Z_Unlock();
+}
+
+//---------------------------------------------------------------------------
+// Each composite only writes its own slot, and the zone, lump cache and
+// disk cache take their own locks, so different textures can be built at
+// once. Single-patch textures are left to their first lock, which checks
+// the patch under the zone lock.
+static void buildTextureComposite(void *arg, int i) {
+  const int id = ((const int *)arg)[i];
+
+  if (!texture_composites[id].data && !textures[id]->singlepatch)
+    createTextureCompositePatch(id);
+}
+
+void R_BuildTextureComposites(const int *ids, int count) {
+  if (!texture_composites)
+    I_Error("R_BuildTextureComposites: Composite patches not initialized");
+
+  I_JobParallelFor(count, buildTextureComposite, (void *)ids);
 }
 
 //---------------------------------------------------------------------------
@@ -686,14 +743,21 @@ const rpatch_t *R_CachePatchNum(int id) {
     return NULL;
   }
 
+  Z_Lock();
   if (!patches[id].data)
+  {
+    zcachestats.misses++;
     createPatch(id);
+  }
+  else
+    zcachestats.hits++;
 
   /* cph - if wasn't locked but now is, tell z_zone to hold it */
   if (!patches[id].locks && locks) {
-    Z_ChangeTag(patches[id].data,PU_STATIC);
+    Z_Hold(patches[id].data);
   }
   patches[id].locks += locks;
+  Z_Unlock();
 
   return &patches[id];
 }
@@ -701,12 +765,57 @@ const rpatch_t *R_CachePatchNum(int id) {
 void R_UnlockPatchNum(int id)
 {
   const int unlocks = 1;
+  Z_Lock();
   patches[id].locks -= unlocks;
   /* cph - Note: must only tell z_zone to make purgeable if currently locked, 
    * else it might already have been purged
    */
   if (unlocks && !patches[id].locks)
-    Z_ChangeTag(patches[id].data, PU_CACHE);
+    Z_Release(patches[id].data);
+  Z_Unlock();
+}
+
+//---------------------------------------------------------------------------
+// A texture made of one solid patch at (0,0) that is exactly the texture's
+// size would get a composite identical to the patch's own rpatch_t, so it
+// points into the patch instead and locks that. Its composite slot keeps
+// data NULL; the pointers are refreshed on every lock since the patch may
+// have been purged and rebuilt in between. Returns false, and clears
+// singlepatch so the composite gets built, when the patch has holes or the
+// wrong size: the composite fills holes for the solid wall drawers.
+static dbool aliasTexturePatch(int id) {
+  rpatch_t *composite_patch = &texture_composites[id];
+  texture_t *texture = textures[id];
+  const int lump = texture->patches[0].patch;
+  const rpatch_t *patch = R_CachePatchNum(lump);
+  int x;
+
+  if (patch->width != texture->width || patch->height != texture->height)
+    x = -1;
+  else
+    for (x=0; x<patch->width; x++) {
+      const rcolumn_t *column = &patch->columns[x];
+      if (column->numPosts != 1 || column->posts[0].topdelta != 0 ||
+          column->posts[0].length != patch->height)
+        break;
+    }
+
+  if (x != texture->width) {
+    R_UnlockPatchNum(lump);
+    texture->singlepatch = FALSE;
+    return FALSE;
+  }
+
+  composite_patch->width = patch->width;
+  composite_patch->height = patch->height;
+  composite_patch->widthmask = texture->widthmask;
+  composite_patch->isNotTileable = 0;
+  composite_patch->leftoffset = 0;
+  composite_patch->topoffset = 0;
+  composite_patch->pixels = patch->pixels;
+  composite_patch->columns = patch->columns;
+  composite_patch->posts = patch->posts;
+  return TRUE;
 }
 
 //---------------------------------------------------------------------------
@@ -716,14 +825,27 @@ const rpatch_t *R_CacheTextureCompositePatchNum(int id) {
   if (!texture_composites)
     I_Error("R_CacheTextureCompositePatchNum: Composite patches not initialized");
 
+  Z_Lock();
+  if (textures[id]->singlepatch && aliasTexturePatch(id))
+  {
+    Z_Unlock();
+    return &texture_composites[id];
+  }
+
   if (!texture_composites[id].data)
+  {
+    zcachestats.misses++;
     createTextureCompositePatch(id);
+  }
+  else
+    zcachestats.hits++;
 
   /* cph - if wasn't locked but now is, tell z_zone to hold it */
   if (!texture_composites[id].locks && locks) {
-    Z_ChangeTag(texture_composites[id].data,PU_STATIC);
+    Z_Hold(texture_composites[id].data);
   }
   texture_composites[id].locks += locks;
+  Z_Unlock();
 
   return &texture_composites[id];
 
@@ -732,12 +854,20 @@ const rpatch_t *R_CacheTextureCompositePatchNum(int id) {
 void R_UnlockTextureCompositePatchNum(int id)
 {
   const int unlocks = 1;
+  Z_Lock();
+  if (textures[id]->singlepatch)
+  {
+    R_UnlockPatchNum(textures[id]->patches[0].patch);
+    Z_Unlock();
+    return;
+  }
   texture_composites[id].locks -= unlocks;
   /* cph - Note: must only tell z_zone to make purgeable if currently locked, 
    * else it might already have been purged
    */
   if (unlocks && !texture_composites[id].locks)
-    Z_ChangeTag(texture_composites[id].data, PU_CACHE);
+    Z_Release(texture_composites[id].data);
+  Z_Unlock();
 }
 
 //---------------------------------------------------------------------------
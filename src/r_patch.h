@@ -84,6 +84,9 @@ void R_UnlockPatchNum(int id);
 
 const rpatch_t *R_CacheTextureCompositePatchNum(int id);
 void R_UnlockTextureCompositePatchNum(int id);
+// Builds the listed composites not yet built across the job pool and
+// returns once they all are; call only while nothing is rendering
+void R_BuildTextureComposites(const int *ids, int count);
 
 
 // Size query funcs
@@ -104,5 +107,7 @@ const rcolumn_t *R_GetPatchColumn(const rpatch_t *patch, int columnIndex);
 
 void R_InitPatches();
 void R_FlushAllPatches();
+// Bytes of patches and texture composites built and still cached
+size_t R_PatchCacheBytes(void);
 
 #endif
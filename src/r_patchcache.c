@@ -0,0 +1,297 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      On-disk cache of converted patches and texture composites.
+ *
+ *      The file starts with a header naming the wads it was built from
+ *      (by MD5) and an offset table with one entry per slot, zero for
+ *      slots not converted yet. Each patch is appended the first time it
+ *      is built and its offset written into the table afterwards, so a
+ *      write cut short just leaves the slot empty. Posts and pixels are
+ *      stored in memory layout and read straight into the Z_Malloc'ed
+ *      patch data; only the column pointers are rebuilt.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#include "z_zone.h"
+#include "doomstat.h"
+#include "w_wad.h"
+#include "w_ident.h"
+#include "i_system.h"
+#include "lprintf.h"
+#include "md5.h"
+#include "r_patchcache.h"
+
+#include <streams/file_stream.h>
+
+#define PATCHCACHE_MAGIC   "PRBPTCH"
+#define PATCHCACHE_VERSION 1
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t postsize;   // sizeof(rpost_t) of the build that wrote it
+  unsigned char md5[16];
+  uint32_t numslots;
+} patchcache_header_t;
+
+typedef struct {
+  int32_t width, height;
+  int32_t leftoffset, topoffset;
+  uint32_t widthmask;
+  int32_t isNotTileable;
+  int32_t numposts;
+} patchcache_entry_t;
+
+// per column: number of posts, and the index of its first post
+typedef struct {
+  int32_t numPosts;
+  int32_t firstPost;
+} patchcache_column_t;
+
+int patch_cache;
+
+static RFILE *cachefile;
+static uint32_t *cacheoffsets;
+static int numcacheslots;
+
+// The wads by their own MD5s, which W_WadDigest keeps between runs
+static void R_HashWads(unsigned char digest[16])
+{
+  struct MD5Context md5;
+  size_t i;
+
+  MD5Init(&md5);
+  for (i = 0; i < numwadfiles; i++)
+  {
+    unsigned char waddigest[16];
+
+    if (W_WadDigest(&wadfiles[i], waddigest))
+      MD5Update(&md5, waddigest, sizeof waddigest);
+  }
+  MD5Update(&md5, (const md5byte *)&numlumps, sizeof numlumps);
+  MD5Final(digest, &md5);
+}
+
+static void R_ResetPatchCache(const patchcache_header_t *header)
+{
+  filestream_truncate(cachefile, 0);
+  filestream_seek(cachefile, 0, RETRO_VFS_SEEK_POSITION_START);
+  memset(cacheoffsets, 0, numcacheslots * sizeof *cacheoffsets);
+  filestream_write(cachefile, header, sizeof *header);
+  filestream_write(cachefile, cacheoffsets, numcacheslots * sizeof *cacheoffsets);
+  filestream_flush(cachefile);
+}
+
+void R_OpenPatchCache(int numslots)
+{
+  patchcache_header_t header, old;
+  char path[PATH_MAX+1];
+  char md5hex[33];
+#ifdef _WIN32
+  char slash = '\\';
+#else
+  char slash = '/';
+#endif
+  int i;
+
+  if (!patch_cache || cachefile)
+    return;
+
+  memset(&header, 0, sizeof header);
+  memcpy(header.magic, PATCHCACHE_MAGIC, sizeof PATCHCACHE_MAGIC);
+  header.version = PATCHCACHE_VERSION;
+  header.postsize = sizeof(rpost_t);
+  header.numslots = numslots;
+  R_HashWads(header.md5);
+
+  for (i = 0; i < 16; i++)
+    sprintf(md5hex + i * 2, "%02x", header.md5[i]);
+  snprintf(path, sizeof path, "%s%cprboom_%s.pcache", I_DoomExeDir(), slash, md5hex);
+
+  cachefile = filestream_open(path,
+      RETRO_VFS_FILE_ACCESS_READ_WRITE | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+      RETRO_VFS_FILE_ACCESS_HINT_NONE);
+  if (!cachefile)
+    cachefile = filestream_open(path, RETRO_VFS_FILE_ACCESS_READ_WRITE,
+        RETRO_VFS_FILE_ACCESS_HINT_NONE);
+  if (!cachefile)
+  {
+    lprintf(LO_WARN, "R_OpenPatchCache: couldn't open %s\n", path);
+    return;
+  }
+
+  numcacheslots = numslots;
+  cacheoffsets = malloc(numslots * sizeof *cacheoffsets);
+
+  if (filestream_read(cachefile, &old, sizeof old) != sizeof old ||
+      memcmp(&old, &header, sizeof header) ||
+      filestream_read(cachefile, cacheoffsets, numslots * sizeof *cacheoffsets)
+        != (int64_t)(numslots * sizeof *cacheoffsets))
+  {
+    lprintf(LO_INFO, "R_OpenPatchCache: starting %s\n", path);
+    R_ResetPatchCache(&header);
+  }
+  else
+    lprintf(LO_INFO, "R_OpenPatchCache: using %s\n", path);
+}
+
+void R_ClosePatchCache(void)
+{
+  if (!cachefile)
+    return;
+
+  filestream_close(cachefile);
+  cachefile = NULL;
+  free(cacheoffsets);
+  cacheoffsets = NULL;
+  numcacheslots = 0;
+}
+
+dbool R_LoadCachedPatch(int slot, rpatch_t *patch, int tag)
+{
+  patchcache_entry_t entry;
+  patchcache_column_t *columns;
+  int pixelDataSize, columnsDataSize, postsDataSize;
+  int x;
+
+  if (!cachefile || slot >= numcacheslots || !cacheoffsets[slot])
+    return FALSE;
+
+  filestream_seek(cachefile, cacheoffsets[slot], RETRO_VFS_SEEK_POSITION_START);
+  if (filestream_read(cachefile, &entry, sizeof entry) != sizeof entry ||
+      entry.width <= 0 || entry.height < 0 || entry.numposts < 0)
+    return FALSE;
+
+  // same layout as createPatch
+  pixelDataSize = (entry.width * entry.height + 4) & ~3;
+  columnsDataSize = sizeof(rcolumn_t) * entry.width;
+  postsDataSize = entry.numposts * sizeof(rpost_t);
+
+  columns = malloc(entry.width * sizeof *columns);
+  if (filestream_read(cachefile, columns, entry.width * sizeof *columns)
+      != (int64_t)(entry.width * sizeof *columns))
+  {
+    free(columns);
+    return FALSE;
+  }
+
+  patch->data = (unsigned char*)Z_Malloc(pixelDataSize + columnsDataSize + postsDataSize,
+      tag, (void **)&patch->data);
+  patch->pixels = patch->data;
+  patch->columns = (rcolumn_t*)((unsigned char*)patch->pixels + pixelDataSize);
+  patch->posts = (rpost_t*)((unsigned char*)patch->columns + columnsDataSize);
+
+  if (filestream_read(cachefile, patch->posts, postsDataSize) != postsDataSize ||
+      filestream_read(cachefile, patch->pixels, entry.width * entry.height)
+        != entry.width * entry.height)
+  {
+    free(columns);
+    Z_Free(patch->data);
+    patch->data = NULL;
+    return FALSE;
+  }
+
+  memset(patch->pixels + entry.width * entry.height, 0,
+      pixelDataSize - entry.width * entry.height);
+
+  patch->width = entry.width;
+  patch->height = entry.height;
+  patch->widthmask = entry.widthmask;
+  patch->isNotTileable = entry.isNotTileable;
+  patch->leftoffset = entry.leftoffset;
+  patch->topoffset = entry.topoffset;
+
+  for (x = 0; x < entry.width; x++)
+  {
+    patch->columns[x].pixels = patch->pixels + x * patch->height;
+    patch->columns[x].numPosts = columns[x].numPosts;
+    patch->columns[x].posts = patch->posts + columns[x].firstPost;
+  }
+
+  free(columns);
+  return TRUE;
+}
+
+void R_StoreCachedPatch(int slot, const rpatch_t *patch)
+{
+  patchcache_entry_t entry;
+  patchcache_column_t *columns;
+  int64_t offset;
+  uint32_t offset32;
+  int x;
+
+  if (!cachefile || slot >= numcacheslots)
+    return;
+
+  entry.width = patch->width;
+  entry.height = patch->height;
+  entry.leftoffset = patch->leftoffset;
+  entry.topoffset = patch->topoffset;
+  entry.widthmask = patch->widthmask;
+  entry.isNotTileable = patch->isNotTileable;
+  // only as many posts as the columns reach; merging the posts of
+  // multipatch composite columns leaves the end of the array unused
+  entry.numposts = 0;
+
+  columns = malloc(patch->width * sizeof *columns);
+  for (x = 0; x < patch->width; x++)
+  {
+    int end;
+
+    columns[x].numPosts = patch->columns[x].numPosts;
+    columns[x].firstPost = patch->columns[x].posts - patch->posts;
+    end = columns[x].firstPost + columns[x].numPosts;
+    if (end > entry.numposts)
+      entry.numposts = end;
+  }
+
+  offset = filestream_seek(cachefile, 0, RETRO_VFS_SEEK_POSITION_END) < 0 ?
+    -1 : filestream_tell(cachefile);
+  if (offset <= 0 || offset > 0xffffffff)
+  {
+    free(columns);
+    return;
+  }
+
+  filestream_write(cachefile, &entry, sizeof entry);
+  filestream_write(cachefile, columns, patch->width * sizeof *columns);
+  filestream_write(cachefile, patch->posts, entry.numposts * sizeof(rpost_t));
+  filestream_write(cachefile, patch->pixels, patch->width * patch->height);
+  free(columns);
+
+  // only point the slot at the entry once it's all there
+  filestream_flush(cachefile);
+  offset32 = (uint32_t)offset;
+  filestream_seek(cachefile, sizeof(patchcache_header_t) + slot * sizeof offset32,
+      RETRO_VFS_SEEK_POSITION_START);
+  filestream_write(cachefile, &offset32, sizeof offset32);
+  filestream_flush(cachefile);
+  cacheoffsets[slot] = offset32;
+}
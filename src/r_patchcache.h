@@ -0,0 +1,52 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      On-disk cache of converted patches and texture composites, kept in
+ *      the save directory and keyed by the MD5 of the loaded wads.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#ifndef R_PATCHCACHE_H
+#define R_PATCHCACHE_H
+
+#include "r_patch.h"
+
+// Config: keep converted patches on disk between sessions
+extern int patch_cache;
+
+// Slots 0..numlumps-1 are lump patches, the rest texture composites
+void R_OpenPatchCache(int numslots);
+void R_ClosePatchCache(void);
+
+// Fill in patch from the cache, its data Z_Malloc'ed with the given tag;
+// false if the slot hasn't been stored yet
+dbool R_LoadCachedPatch(int slot, rpatch_t *patch, int tag);
+void R_StoreCachedPatch(int slot, const rpatch_t *patch);
+
+#endif
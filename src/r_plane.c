@@ -32,9 +32,9 @@
  *      Moreover, the sky areas have to be determined.
  *
  * MAXVISPLANES is no longer a limit on the number of visplanes,
- * but a limit on the number of hash slots; larger numbers mean
- * better performance usually but after a point they are wasted,
- * and memory and time overheads creep in.
+ * only the initial size of the open-addressed hash table, which
+ * doubles whenever it gets half full. The visplanes themselves
+ * come from a pool that is handed out again every frame.
  *
  * For more information on visplanes, see:
  *
@@ -52,59 +52,85 @@
 #include "w_wad.h"
 #include "r_main.h"
 #include "r_draw.h"
+#include "r_drawlist.h"
+#include "r_arena.h"
+#include "r_profile.h"
+#include "r_mipmap.h"
+#include "r_rounded.h"
 #include "r_things.h"
 #include "r_sky.h"
 #include "r_plane.h"
+#include "r_segs.h"
 #include "v_video.h"
 #include "lprintf.h"
+#include "i_thread.h"
+#include "i_jobs.h"
 
 #define MAXVISPLANES 128    /* must be a power of 2 */
+#define VISPLANEBLOCK 32    /* visplanes allocated at a time */
 
-static visplane_t *visplanes[MAXVISPLANES];   // killough
-static visplane_t *freetail;                  // killough
-static visplane_t **freehead = &freetail;     // killough
-visplane_t *floorplane, *ceilingplane;
+// Hash slots hold the newest visplane with each key; older duplicates
+// made by R_DupPlane are only reached through the pool.
+static THREAD_LOCAL visplane_t **visplanes;                // killough
+static THREAD_LOCAL unsigned visplanemask;
+static THREAD_LOCAL int numvisplaneslots;                  // slots in use
+
+// Every visplane ever allocated by this thread, in the order they were
+// handed out this frame
+static THREAD_LOCAL visplane_t **visplanepool;
+static THREAD_LOCAL int visplanepoolsize;
+
+THREAD_LOCAL int numvisplanes, maxvisplaneprobe;
+THREAD_LOCAL visplane_t *floorplane, *ceilingplane;
 
 // killough -- hash function for visplanes
 // Empirically verified to be fairly uniform:
 
 #define visplane_hash(picnum,lightlevel,height) \
-  ((unsigned)((picnum)*3+(lightlevel)+(height)*7) & (MAXVISPLANES-1))
+  ((unsigned)((picnum)*3+(lightlevel)+(height)*7) & visplanemask)
 
-size_t maxopenings;
-int *openings,*lastopening; // dropoff overflow
+THREAD_LOCAL size_t maxopenings;
+THREAD_LOCAL int16_t *openings,*lastopening;
+THREAD_LOCAL size_t maxmaskedcols;
+THREAD_LOCAL int *maskedcols,*lastmaskedcol;
 
 // Clip values are the solid pixel bounding the range.
 //  floorclip starts out SCREENHEIGHT
 //  ceilingclip starts out -1
 
-int floorclip[MAX_SCREENWIDTH], ceilingclip[MAX_SCREENWIDTH]; // dropoff overflow
+THREAD_LOCAL int16_t floorclip[MAX_SCREENWIDTH], ceilingclip[MAX_SCREENWIDTH];
 
 // spanstart holds the start of a plane span; initialized to 0 at start
 
-static int spanstart[MAX_SCREENHEIGHT];                // killough 2/8/98
+static THREAD_LOCAL int spanstart[MAX_SCREENHEIGHT];                // killough 2/8/98
 
 //
 // texture mapping
 //
 
-static const lighttable_t **planezlight;
-static fixed_t planeheight;
+static THREAD_LOCAL const lighttable_t **planezlight;
+static THREAD_LOCAL fixed_t planeheight;
 
 // killough 2/8/98: make variables static
 
-static fixed_t basexscale, baseyscale;
-static fixed_t cachedheight[MAX_SCREENHEIGHT];
-static fixed_t cacheddistance[MAX_SCREENHEIGHT];
-static fixed_t cachedxstep[MAX_SCREENHEIGHT];
-static fixed_t cachedystep[MAX_SCREENHEIGHT];
-static fixed_t xoffs,yoffs;    // killough 2/28/98: flat offsets
+static THREAD_LOCAL fixed_t basexscale, baseyscale;
+static THREAD_LOCAL fixed_t cachedheight[MAX_SCREENHEIGHT];
+static THREAD_LOCAL fixed_t cacheddistance[MAX_SCREENHEIGHT];
+static THREAD_LOCAL fixed_t cachedxstep[MAX_SCREENHEIGHT];
+static THREAD_LOCAL fixed_t cachedystep[MAX_SCREENHEIGHT];
+// vertexgen the rows above were cached for; the job threads that draw
+// flats never run R_ClearPlanes, so each thread checks it itself
+static THREAD_LOCAL unsigned int cachedgen;
+static THREAD_LOCAL fixed_t xoffs,yoffs;    // killough 2/28/98: flat offsets
 
 fixed_t yslope[MAX_SCREENHEIGHT], distscale[MAX_SCREENWIDTH];
 
 /* forward declarations */
 extern dbool   r_wiggle_fix;
 
+// Config: draw flats on the job threads once the walls are done
+int render_parallel_planes;
+
 //
 // R_InitPlanes
 // Only at game startup.
@@ -179,7 +205,7 @@ static void R_MapPlane(int y, int x1, int x2, draw_span_vars_t *dsvars)
    dsvars->x1 = x1;
    dsvars->x2 = x2;
 
-   R_DrawSpan(dsvars);
+   R_QueueSpan(dsvars);
 }
 
 //
@@ -198,14 +224,19 @@ void R_ClearPlanes(void)
       ceilingclip[i] = -1;
    }
 
-   for (i=0;i<MAXVISPLANES;i++)    // new code -- killough
-      for (*freehead = visplanes[i], visplanes[i] = NULL; *freehead; )
-         freehead = &(*freehead)->next;
+   // the table is per thread, so can't be statically allocated
+   if (!visplanes)
+   {
+      visplanemask = MAXVISPLANES - 1;
+      visplanes = malloc(MAXVISPLANES * sizeof(*visplanes));
+   }
+   memset(visplanes, 0, (visplanemask + 1) * sizeof(*visplanes));
+   numvisplaneslots = 0;
+   numvisplanes = 0;
+   maxvisplaneprobe = 0;
 
-   lastopening = openings;
-
-   // texture calculation
-   memset (cachedheight, 0, sizeof(cachedheight));
+   openings = lastopening = R_ArenaRegion(RA_OPENINGS, &maxopenings);
+   maskedcols = lastmaskedcol = R_ArenaRegion(RA_MASKEDCOLS, &maxmaskedcols);
 
    // scale will be unit scale at SCREENWIDTH/2 distance
    basexscale = FixedDiv (viewsin,projection);
@@ -214,17 +245,81 @@ void R_ClearPlanes(void)
 
 // New function, by Lee Killough
 
-static visplane_t *new_visplane(unsigned hash)
+static visplane_t *new_visplane(void)
 {
-  visplane_t *check = freetail;
-  if (!check)
-    check = calloc(1, sizeof *check);
-  else
-    if (!(freetail = freetail->next))
-      freehead = &freetail;
-  check->next = visplanes[hash];
-  visplanes[hash] = check;
-  return check;
+  if (numvisplanes == visplanepoolsize)
+  {
+    visplane_t *block = calloc(VISPLANEBLOCK, sizeof *block);
+    int i;
+
+    visplanepool = realloc(visplanepool,
+        (visplanepoolsize + VISPLANEBLOCK) * sizeof(*visplanepool));
+    for (i = 0; i < VISPLANEBLOCK; i++)
+      visplanepool[visplanepoolsize++] = block + i;
+  }
+  return visplanepool[numvisplanes++];
+}
+
+//
+// R_GrowPlaneHash
+//
+// Doubles the hash table once it is half full, to keep probes short
+//
+
+static void R_GrowPlaneHash(void)
+{
+  visplane_t **old = visplanes;
+  unsigned oldmask = visplanemask, i;
+
+  visplanemask = visplanemask * 2 + 1;
+  visplanes = calloc(visplanemask + 1, sizeof(*visplanes));
+
+  for (i = 0; i <= oldmask; i++)
+    if (old[i])
+    {
+      unsigned hash = visplane_hash(old[i]->picnum, old[i]->lightlevel, old[i]->height);
+
+      while (visplanes[hash])
+        hash = (hash + 1) & visplanemask;
+      visplanes[hash] = old[i];
+    }
+  free(old);
+}
+
+//
+// R_HashPlane
+//
+// Makes pl the plane found for its key, replacing any older plane with
+// the same key in the table
+//
+
+static void R_HashPlane(visplane_t *pl)
+{
+  unsigned hash;
+  int probe = 0;
+
+  if ((numvisplaneslots + 1) * 2 > (int)visplanemask + 1)
+    R_GrowPlaneHash();
+
+  for (hash = visplane_hash(pl->picnum, pl->lightlevel, pl->height);
+       visplanes[hash]; hash = (hash + 1) & visplanemask, probe++)
+  {
+    const visplane_t *check = visplanes[hash];
+
+    if (pl->height == check->height &&
+        pl->picnum == check->picnum &&
+        pl->lightlevel == check->lightlevel &&
+        pl->xoffs == check->xoffs &&
+        pl->yoffs == check->yoffs)
+      break;
+  }
+
+  if (!visplanes[hash])
+    numvisplaneslots++;
+  visplanes[hash] = pl;
+
+  if (probe > maxvisplaneprobe)
+    maxvisplaneprobe = probe;
 }
 
 /*
@@ -234,8 +329,7 @@ static visplane_t *new_visplane(unsigned hash)
  */
 visplane_t *R_DupPlane(const visplane_t *pl, int start, int stop)
 {
-      unsigned hash = visplane_hash(pl->picnum, pl->lightlevel, pl->height);
-      visplane_t *new_pl = new_visplane(hash);
+      visplane_t *new_pl = new_visplane();
 
       new_pl->height = pl->height;
       new_pl->picnum = pl->picnum;
@@ -245,6 +339,7 @@ visplane_t *R_DupPlane(const visplane_t *pl, int start, int stop)
       new_pl->minx = start;
       new_pl->maxx = stop;
       memset(new_pl->top, 0xff, sizeof new_pl->top);
+      R_HashPlane(new_pl);
       return new_pl;
 }
 //
@@ -257,6 +352,7 @@ visplane_t *R_FindPlane(fixed_t height, int picnum, int lightlevel,
 {
    visplane_t *check;
    unsigned hash;                      // killough
+   int probe = 0;
 
    if (picnum == skyflatnum || picnum & PL_SKYFLAT)
       height = lightlevel = 0;         // killough 7/19/98: most skies map together
@@ -264,15 +360,19 @@ visplane_t *R_FindPlane(fixed_t height, int picnum, int lightlevel,
    // New visplane algorithm uses hash table -- killough
    hash = visplane_hash(picnum,lightlevel,height);
 
-   for (check=visplanes[hash]; check; check=check->next)  // killough
+   for (; (check = visplanes[hash]); hash = (hash + 1) & visplanemask, probe++)
       if (height == check->height &&
             picnum == check->picnum &&
             lightlevel == check->lightlevel &&
             xoffs == check->xoffs &&      // killough 2/28/98: Add offset checks
             yoffs == check->yoffs)
+      {
+         if (probe > maxvisplaneprobe)
+            maxvisplaneprobe = probe;
          return check;
+      }
 
-   check = new_visplane(hash);         // killough
+   check = new_visplane();             // killough
 
    check->height = height;
    check->picnum = picnum;
@@ -283,6 +383,7 @@ visplane_t *R_FindPlane(fixed_t height, int picnum, int lightlevel,
    check->yoffs = yoffs;
 
    memset (check->top, 0xff, sizeof check->top);
+   R_HashPlane(check);
 
    return check;
 }
@@ -350,9 +451,25 @@ static void R_MakeSpans(int x, unsigned int t1, unsigned int b1,
       spanstart[b2--] = x;
 }
 
+// The part of a plane column between rows y1 and y2, in the form
+// R_MakeSpans takes; an empty column is 0xffffffff, 0
+
+static INLINE void R_ClipPlaneColumn(unsigned int *t, unsigned int *b,
+                                     unsigned int y1, unsigned int y2)
+{
+   if (*t < y1)
+      *t = y1;
+   if (*b > y2)
+      *b = y2;
+   if (*t > *b)
+      *t = 0xffffffffu, *b = 0;
+}
+
 // New function, by Lee Killough
+// Only draws rows y1 to y2 of a flat, so that bands of one plane can be
+// drawn apart; the top sentinels must already be set (R_SetPlaneEnds).
 
-static void R_DoDrawPlane(visplane_t *pl)
+static void R_DoDrawPlane(visplane_t *pl, int y1, int y2)
 {
    int x;
    draw_column_vars_t dcvars;
@@ -360,6 +477,13 @@ static void R_DoDrawPlane(visplane_t *pl)
 
    R_SetDefaultDrawColumnVars(&dcvars);
 
+   // texture calculation
+   if (cachedgen != vertexgen)
+   {
+      memset (cachedheight, 0, sizeof(cachedheight));
+      cachedgen = vertexgen;
+   }
+
    if (pl->minx <= pl->maxx)
    {
       if (pl->picnum == skyflatnum || pl->picnum & PL_SKYFLAT)
@@ -431,27 +555,49 @@ static void R_DoDrawPlane(visplane_t *pl)
          dcvars.texheight = textureheight[texture]>>FRACBITS; // killough
          dcvars.iscale = skyiscale;
 
+         // the normal sky is usually colormapped already
+         if (!(pl->picnum & PL_SKYFLAT) && R_GetSkyColumn(0))
+         {
+            for (x = pl->minx; (dcvars.x = x) <= pl->maxx; x++)
+               if ((dcvars.yl = pl->top[x]) != 0xffff && dcvars.yl <= (dcvars.yh = pl->bottom[x]))
+               {
+                  dcvars.source = (const uint8_t *)R_GetSkyColumn((an + xtoviewangle[x]) >> ANGLETOSKYSHIFT);
+                  R_QueueColumn(R_DrawSkyColumn16, &dcvars);
+               }
+            return;
+         }
+
          tex_patch = R_CacheTextureCompositePatchNum(texture);
 
          // killough 10/98: Use sky scrolling offset, and possibly flip picture
          for (x = pl->minx; (dcvars.x = x) <= pl->maxx; x++)
-            if ((dcvars.yl = pl->top[x]) != -1 && dcvars.yl <= (dcvars.yh = pl->bottom[x])) // dropoff overflow
+            if ((dcvars.yl = pl->top[x]) != 0xffff && dcvars.yl <= (dcvars.yh = pl->bottom[x]))
             {
                dcvars.source = R_GetTextureColumn(tex_patch, ((an + xtoviewangle[x])^flip) >> ANGLETOSKYSHIFT);
                dcvars.prevsource = R_GetTextureColumn(tex_patch, ((an + xtoviewangle[x-1])^flip) >> ANGLETOSKYSHIFT);
                dcvars.nextsource = R_GetTextureColumn(tex_patch, ((an + xtoviewangle[x+1])^flip) >> ANGLETOSKYSHIFT);
-               colfunc(&dcvars);
+               R_QueueColumn(colfunc, &dcvars);
             }
 
-         R_UnlockTextureCompositePatchNum(texture);
+         R_QueueUnlockTexture(texture);
 
       }
       else
       {     // regular flat
-         int stop, light;
+         int stop, light, flat = flattranslation[pl->picnum];
+         dbool locked = FALSE;
          draw_span_vars_t dsvars;
 
-         dsvars.source = W_CacheLumpNum(firstflat + flattranslation[pl->picnum]);
+         if (drawvars.filterfloor == RDRAW_FILTER_MIPMAP)
+            dsvars.source = R_GetFlatMips(flat);
+         else if (!(dsvars.source = flatpixels[flat]))
+         {
+            // not in the level's flat arena
+            dsvars.source = W_CacheLumpNum(firstflat + flat);
+            locked = TRUE;
+         }
+         dsvars.rounded = drawvars.filterfloor == RDRAW_FILTER_ROUNDED ?
+            R_GetFlatRounded(flat) : NULL;
 
          xoffs = pl->xoffs;  // killough 2/28/98: Add offsets
          yoffs = pl->yoffs;
@@ -466,13 +612,19 @@ static void R_DoDrawPlane(visplane_t *pl)
 
          stop = pl->maxx + 1;
          planezlight = zlight[light];
-         pl->top[pl->minx-1] = pl->top[stop] = 0xffffffffu; // dropoff overflow
 
          for (x = pl->minx ; x <= stop ; x++)
-            R_MakeSpans(x,pl->top[x-1],pl->bottom[x-1],
-                  pl->top[x],pl->bottom[x], &dsvars);
+         {
+            unsigned int t1 = pl->top[x-1], b1 = pl->bottom[x-1];
+            unsigned int t2 = pl->top[x], b2 = pl->bottom[x];
+
+            R_ClipPlaneColumn(&t1, &b1, y1, y2);
+            R_ClipPlaneColumn(&t2, &b2, y1, y2);
+            R_MakeSpans(x, t1, b1, t2, b2, &dsvars);
+         }
 
-         W_UnlockLumpNum(firstflat + flattranslation[pl->picnum]);
+         if (locked)
+            R_QueueUnlockLump(firstflat + flat);
       }
    }
 }
@@ -482,14 +634,107 @@ static void R_DoDrawPlane(visplane_t *pl)
 // At the end of each frame.
 //
 
+static dbool R_IsSkyPlane(const visplane_t *pl)
+{
+  return pl->picnum == skyflatnum || pl->picnum & PL_SKYFLAT;
+}
+
+static void R_SetPlaneEnds(visplane_t *pl)
+{
+  if (pl->minx <= pl->maxx && !R_IsSkyPlane(pl))
+    pl->top[pl->minx-1] = pl->top[pl->maxx+1] = 0xffff;
+}
+
+//
+// Flats on the job threads
+//
+// Visplanes cover separate pixels, so flats can be drawn in any order
+// and at once; planes at least half the view wide are cut into bands of
+// rows as well. The job threads never record, so their spans go straight
+// to the screen, which is fine as nothing else drawn this frame touches
+// those pixels. Skies stay on the calling thread, whose column buffer
+// may hold columns of the same quads as a neighbouring plane.
+//
+
+typedef struct {
+  visplane_t *pl;
+  int y1, y2;
+} planejob_t;
+
+static THREAD_LOCAL planejob_t *planejobs;
+static THREAD_LOCAL int maxplanejobs;
+
+static void R_PlaneJob(void *arg)
+{
+  planejob_t *job = arg;
+
+  R_DoDrawPlane(job->pl, job->y1, job->y2);
+}
+
+static void R_DrawPlanesParallel(void)
+{
+  int threads = I_JobThreads();
+  int i, b, numjobs = 0;
+  i_jobgroup_t group;
+
+  for (i = 0; i < numvisplanes; i++)
+  {
+    visplane_t *pl = visplanepool[i];
+
+    if (pl->minx > pl->maxx || R_IsSkyPlane(pl))
+      continue;
+    numjobs += (pl->maxx - pl->minx + 1) * 2 >= viewwidth ? threads : 1;
+  }
+
+  if (numjobs > maxplanejobs)
+  {
+    maxplanejobs = numjobs * 2;
+    planejobs = realloc(planejobs, maxplanejobs * sizeof(*planejobs));
+  }
+
+  numjobs = 0;
+  I_JobGroupInit(&group);
+  for (i = 0; i < numvisplanes; i++)
+  {
+    visplane_t *pl = visplanepool[i];
+    int bands;
+
+    if (pl->minx > pl->maxx || R_IsSkyPlane(pl))
+      continue;
+
+    bands = (pl->maxx - pl->minx + 1) * 2 >= viewwidth ? threads : 1;
+    for (b = 0; b < bands; b++)
+    {
+      planejob_t *job = &planejobs[numjobs++];
+
+      job->pl = pl;
+      job->y1 = viewheight * b / bands;
+      job->y2 = viewheight * (b+1) / bands - 1;
+      I_JobRun(&group, R_PlaneJob, job);
+    }
+  }
+
+  for (i = 0; i < numvisplanes; i++)
+    if (R_IsSkyPlane(visplanepool[i]))
+      R_DoDrawPlane(visplanepool[i], 0, viewheight - 1);
+
+  I_JobWait(&group);
+}
+
 void R_DrawPlanes (void)
 {
   int i;
-  visplane_t *pl;
 
-  for (i=0;i<MAXVISPLANES;i++)
+  R_ProfileCount(RPC_VISPLANES, numvisplanes);
+  for (i=0;i<numvisplanes;i++)
+     R_SetPlaneEnds(visplanepool[i]);
+
+  if (render_parallel_planes && I_JobThreads() > 1)
   {
-     for (pl=visplanes[i]; pl; pl=pl->next)
-        R_DoDrawPlane(pl);
+    R_DrawPlanesParallel();
+    return;
   }
+
+  for (i=0;i<numvisplanes;i++)
+     R_DoDrawPlane(visplanepool[i], 0, viewheight - 1);
 }
@@ -35,16 +35,25 @@
 #define __R_PLANE__
 
 #include "r_data.h"
+#include "i_thread.h"
 
 /* killough 10/98: special mask indicates sky flat comes from sidedef */
 #define PL_SKYFLAT (0x80000000)
 
 /* Visplane related. */
-extern int *lastopening; // dropoff overflow
+extern THREAD_LOCAL int16_t *lastopening;
+extern THREAD_LOCAL int *lastmaskedcol;    // masked texture columns of drawsegs
 
-extern int floorclip[], ceilingclip[]; // dropoff overflow
+extern THREAD_LOCAL int16_t floorclip[], ceilingclip[];
+
+/* Visplanes used this frame, and the longest hash table probe made
+ * finding or adding one, for the calling render thread */
+extern THREAD_LOCAL int numvisplanes, maxvisplaneprobe;
 extern fixed_t yslope[], distscale[];
 
+// Config: draw flats on the job threads (see i_jobs.h)
+extern int render_parallel_planes;
+
 void R_InitPlanes(void);
 void R_ClearPlanes(void);
 void R_DrawPlanes (void);
@@ -0,0 +1,221 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Render profiling, in WANT_PROFILE builds: time spent in each stage
+ *      of the view and counts of what was drawn, for the frontend's perf
+ *      counters and the on-screen overlay, and an overdraw heatmap of the
+ *      view. Compiles to nothing otherwise.
+ *
+ *-----------------------------------------------------------------------------*/
+
+
+#include <stdio.h>
+
+#include "z_zone.h"
+#include "doomdef.h"
+#include "r_main.h"
+#include "r_state.h"
+#include "r_profile.h"
+#include "i_system.h"
+#include "i_thread.h"
+#include "v_video.h"
+
+int render_heatmap;
+
+#ifdef RENDER_PROFILE
+
+static const char *const stagenames[NUMPROFILESTAGES] = {
+  "R_RenderBSPNode", "R_DrawPlanes", "R_DrawMasked", "R_DrawPlayerSprites",
+  "R_RunDrawList"
+};
+
+static const char *const stagelabels[NUMPROFILESTAGES] = {
+  "BSP", "PLANES", "MASKED", "PSPRITES", "FILL"
+};
+
+int profilecounts[MAX_RENDER_THREADS][NUMPROFILECOUNTS];
+static int64_t profiletimes[MAX_RENDER_THREADS][NUMPROFILESTAGES];
+static THREAD_LOCAL int64_t stagestart[NUMPROFILESTAGES];
+
+// Summed over the render threads and the frames since the overlay was
+// last put together
+static int64_t sumtimes[NUMPROFILESTAGES];
+static int64_t sumcounts[NUMPROFILECOUNTS];
+static int sumframes;
+
+static char profilelines[NUMPROFILELINES][32];
+
+// Writes to each pixel of the view this frame, row by row. Render threads
+// and job bands never share a pixel, so the counts need no locking.
+static uint8_t *heatcounts;
+static int heatwidth, heatheight;
+
+// Palette colours for 0, 1, 2... writes; the last for anything more
+static const uint8_t heatcolours[] = {
+  0,    // black: nothing drawn
+  200,  // blue
+  112,  // green
+  231,  // yellow
+  216,  // orange
+  176,  // red
+  4     // white
+};
+#define NUMHEATCOLOURS (sizeof heatcolours / sizeof *heatcolours)
+
+// The frontend's counters can't be shared between threads, so they only
+// see the main thread's slice
+void R_StartProfileStage(profilestage_e stage)
+{
+  if (!slicenum)
+    I_PerfStart(stage, stagenames[stage]);
+  stagestart[stage] = I_GetTimeUS();
+}
+
+void R_StopProfileStage(profilestage_e stage)
+{
+  profiletimes[slicenum][stage] += I_GetTimeUS() - stagestart[stage];
+  if (!slicenum)
+    I_PerfStop(stage);
+}
+
+void R_ProfileWrite(int x1, int y1, int x2, int y2)
+{
+  int x, y;
+
+  if (x2 < x1 || y2 < y1)
+    return;
+  R_ProfileCount(RPC_PIXELS, (x2 - x1 + 1) * (y2 - y1 + 1));
+
+  if (!heatcounts || x1 < 0 || y1 < 0 || x2 >= heatwidth || y2 >= heatheight)
+    return;
+  for (y = y1; y <= y2; y++)
+  {
+    uint8_t *count = heatcounts + y * heatwidth;
+
+    for (x = x1; x <= x2; x++)
+      if (count[x] < 255)
+        count[x]++;
+  }
+}
+
+void R_StartProfileFrame(void)
+{
+  if (!render_heatmap)
+  {
+    free(heatcounts);
+    heatcounts = NULL;
+    return;
+  }
+
+  if (!heatcounts || heatwidth != viewwidth || heatheight != viewheight)
+  {
+    heatwidth = viewwidth;
+    heatheight = viewheight;
+    heatcounts = realloc(heatcounts, heatwidth * heatheight);
+  }
+  memset(heatcounts, 0, heatwidth * heatheight);
+}
+
+//
+// R_DrawHeatmap
+// Paints the finished view with heatcolours, scaled up the way
+// R_FinishViewBuffer scales a view drawn below screen size
+//
+
+static void R_DrawHeatmap(void)
+{
+  pixel_t colours[NUMHEATCOLOURS];
+  int i, sx, sy;
+
+  for (i = 0; i < (int)NUMHEATCOLOURS; i++)
+    colours[i] = VID_PAL16(heatcolours[i], VID_COLORWEIGHTMASK);
+
+  for (sy = 0; sy < scaledviewheight; sy++)
+  {
+    pixel_t *dest = (pixel_t *)screens[0].data + sy * SURFACE_SHORT_PITCH;
+    const uint8_t *count = heatcounts + sy * heatheight / scaledviewheight * heatwidth;
+
+    for (sx = 0; sx < scaledviewwidth; sx++)
+    {
+      int n = count[sx * heatwidth / scaledviewwidth];
+
+      dest[sx] = colours[n < (int)NUMHEATCOLOURS ? n : (int)NUMHEATCOLOURS - 1];
+    }
+  }
+}
+
+void R_EndProfileFrame(void)
+{
+  int i, j;
+
+  if (heatcounts && heatwidth == viewwidth && heatheight == viewheight)
+    R_DrawHeatmap();
+
+  for (i = 0; i < MAX_RENDER_THREADS; i++)
+  {
+    for (j = 0; j < NUMPROFILESTAGES; j++)
+      sumtimes[j] += profiletimes[i][j];
+    for (j = 0; j < NUMPROFILECOUNTS; j++)
+      sumcounts[j] += profilecounts[i][j];
+  }
+  memset(profiletimes, 0, sizeof profiletimes);
+  memset(profilecounts, 0, sizeof profilecounts);
+
+  if (++sumframes < TICRATE)
+    return;
+
+  for (j = 0; j < NUMPROFILESTAGES; j++)
+    snprintf(profilelines[j], sizeof profilelines[j], "%-8s %6.2f MS",
+        stagelabels[j], sumtimes[j] / 1000.0 / sumframes);
+  snprintf(profilelines[j++], sizeof profilelines[0], "SEGS %d PLANES %d",
+      (int)(sumcounts[RPC_SEGS] / sumframes),
+      (int)(sumcounts[RPC_VISPLANES] / sumframes));
+  snprintf(profilelines[j++], sizeof profilelines[0], "SPRITES %d COLUMNS %d",
+      (int)(sumcounts[RPC_VISSPRITES] / sumframes),
+      (int)(sumcounts[RPC_COLUMNS] / sumframes));
+  snprintf(profilelines[j++], sizeof profilelines[0], "BATCH %.1f COLS FULL %d%%",
+      sumcounts[RPC_BATCHES] ?
+        (double)sumcounts[RPC_BATCHCOLUMNS] / sumcounts[RPC_BATCHES] : 0.0,
+      sumcounts[RPC_BATCHES] ?
+        (int)(sumcounts[RPC_FULLBATCHES] * 100 / sumcounts[RPC_BATCHES]) : 0);
+  // writes per pixel of the view; 1.00 is every pixel drawn exactly once
+  snprintf(profilelines[j], sizeof profilelines[0], "OVERDRAW %.2f",
+      (double)sumcounts[RPC_PIXELS] / sumframes / (viewwidth * viewheight));
+
+  memset(sumtimes, 0, sizeof sumtimes);
+  memset(sumcounts, 0, sizeof sumcounts);
+  sumframes = 0;
+}
+
+const char *R_ProfileLine(int line)
+{
+  return profilelines[line];
+}
+
+#endif
@@ -0,0 +1,105 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Render profiling, in WANT_PROFILE builds: time spent in each stage
+ *      of the view and counts of what was drawn, for the frontend's perf
+ *      counters and the on-screen overlay, and an overdraw heatmap of the
+ *      view. Compiles to nothing otherwise.
+ *
+ *-----------------------------------------------------------------------------*/
+
+
+#ifndef R_PROFILE_H
+#define R_PROFILE_H
+
+// Config: paint the view with how often each pixel was written, in
+// WANT_PROFILE builds
+extern int render_heatmap;
+
+#ifdef RENDER_PROFILE
+
+#include "doomtype.h"
+#include "r_main.h"
+
+typedef enum {
+  RPS_BSP,        // R_RenderBSPNode
+  RPS_PLANES,     // R_DrawPlanes
+  RPS_MASKED,     // R_DrawMasked, player sprites included
+  RPS_PSPRITES,   // R_DrawPlayerSprites
+  RPS_FILL,       // R_RunDrawList, when drawing is deferred
+  NUMPROFILESTAGES
+} profilestage_e;
+
+typedef enum {
+  RPC_SEGS,
+  RPC_VISPLANES,
+  RPC_VISSPRITES,
+  RPC_COLUMNS,
+  RPC_BATCHES,      // r_draw.c column buffer flushes
+  RPC_BATCHCOLUMNS, // columns in those flushes
+  RPC_FULLBATCHES,  // flushes of a full column buffer
+  RPC_PIXELS,       // pixels written by columns and spans, overdraw included
+  NUMPROFILECOUNTS
+} profilecount_e;
+
+// Per render thread, for the frame being drawn
+extern int profilecounts[MAX_RENDER_THREADS][NUMPROFILECOUNTS];
+
+void R_StartProfileStage(profilestage_e stage);
+void R_StopProfileStage(profilestage_e stage);
+
+// Count a column or span as written; x1..x2 by y1..y2 of the view
+void R_ProfileWrite(int x1, int y1, int x2, int y2);
+
+// Call before any slice of the frame is started
+void R_StartProfileFrame(void);
+// Call once every slice of the frame is done
+void R_EndProfileFrame(void);
+
+// Text of the overlay, averaged over the last second
+#define NUMPROFILELINES (NUMPROFILESTAGES + 4)
+const char *R_ProfileLine(int line);
+
+#define R_ProfileStart(stage)    R_StartProfileStage(stage)
+#define R_ProfileStop(stage)     R_StopProfileStage(stage)
+#define R_ProfileCount(count, n) (profilecounts[slicenum][count] += (n))
+#define R_ProfileColumn(dcvars)  R_ProfileWrite((dcvars)->x, (dcvars)->yl, (dcvars)->x, (dcvars)->yh)
+#define R_ProfileSpan(dsvars)    R_ProfileWrite((dsvars)->x1, (dsvars)->y, (dsvars)->x2, (dsvars)->y)
+
+#else
+
+#define R_ProfileStart(stage)
+#define R_ProfileStop(stage)
+#define R_ProfileCount(count, n)
+#define R_ProfileColumn(dcvars)
+#define R_ProfileSpan(dsvars)
+
+#endif
+
+#endif
@@ -0,0 +1,779 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Sector to sector visibility, in the manner of Quake's vis but in
+ *      two dimensions.
+ *
+ *      Every two sided line between different sectors is a portal, one
+ *      each way. From each portal the sight lines are followed through
+ *      chains of portals: each portal in a chain is clipped down to the
+ *      part some straight line through the first portal and the previous
+ *      one can reach, and the chain ends once nothing is left. A sector
+ *      sees whatever its portals do. Floor and ceiling heights are
+ *      ignored, since doors and lifts move, so the result only ever errs
+ *      towards visible. A portal whose chains get out of hand keeps
+ *      everything a plain flood past its line reaches.
+ *
+ *      Rows are stored zero-run compressed, one bit per sector, and the
+ *      whole set is written to the save directory after it's built.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#include <math.h>
+
+#include "z_zone.h"
+#include "doomstat.h"
+#include "r_main.h"
+#include "r_state.h"
+#include "i_system.h"
+#include "lprintf.h"
+#include "md5.h"
+#include "r_pvs.h"
+
+#include <streams/file_stream.h>
+
+#define PVS_MAGIC   "PRBPVS"
+#define PVS_VERSION 1
+
+// Portals followed from one portal, and for the whole level, before
+// giving up; the portals left keep their floods
+#define PVS_MAXSTEPS      0x4000
+#define PVS_MAXTOTALSTEPS 0x1000000
+
+// Largest table of what each portal reaches to build, in bytes
+#define PVS_MAXPORTALVIS (64 << 20)
+
+// Map units either side of a clipping line that count as on it
+#define PVS_EPSILON  (1.0/64)
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  unsigned char md5[16];  // of the line and sector layout
+  uint32_t numsectors;
+  uint32_t datasize;      // compressed rows, after numsectors+1 offsets
+} pvs_header_t;
+
+typedef struct {
+  double x1, y1, x2, y2;
+} pvsseg_t;
+
+// One way through a line; the sector entered is on the left
+typedef struct {
+  pvsseg_t seg;
+  int line;
+  int to;
+} portal_t;
+
+int render_pvs;
+int build_reject;
+const byte *pvsnodes, *pvssubsectors;
+
+static byte *pvsdata;
+static uint32_t *pvsofs;
+static int rowbytes;
+static byte *pvsrow;
+static int pvssector;
+static byte *basenodevis, *nodevis, *subsectorvis;
+static int *nodeparent, *subsectorparent;
+
+// while building
+static portal_t *portals;
+static int *firstportal;
+static byte *inchain;
+static byte *visrow;
+static int steps, totalsteps, flooded;
+static byte *portalvis;
+static byte **mightrows;
+static int nummightrows;
+
+//
+// Clipping
+//
+
+// Distance of x,y left of l
+static double R_PVSSide(const pvsseg_t *l, double x, double y)
+{
+  double dx = l->x2 - l->x1, dy = l->y2 - l->y1;
+
+  return (dx * (y - l->y1) - dy * (x - l->x1)) / sqrt(dx * dx + dy * dy);
+}
+
+// Keep the part of s left of l (right if sign is -1); false if nothing
+// is clear of the line
+static dbool R_ClipPVSSeg(pvsseg_t *s, const pvsseg_t *l, double sign)
+{
+  double d1 = sign * R_PVSSide(l, s->x1, s->y1);
+  double d2 = sign * R_PVSSide(l, s->x2, s->y2);
+  double t;
+
+  if (d1 <= PVS_EPSILON && d2 <= PVS_EPSILON)
+    return FALSE;
+
+  if (d1 < -PVS_EPSILON)
+  {
+    t = (d1 + PVS_EPSILON) / (d1 - d2);
+    s->x1 += t * (s->x2 - s->x1);
+    s->y1 += t * (s->y2 - s->y1);
+  }
+  else if (d2 < -PVS_EPSILON)
+  {
+    t = (d2 + PVS_EPSILON) / (d2 - d1);
+    s->x2 += t * (s->x1 - s->x2);
+    s->y2 += t * (s->y1 - s->y2);
+  }
+  return TRUE;
+}
+
+// Keep the part of target a straight line through src and pass can hit.
+// Such lines lie between the separators: lines from an end of src to
+// an end of pass with the rest of src on one side and of pass on the
+// other.
+static dbool R_ClipToSeparators(const pvsseg_t *src, const pvsseg_t *pass,
+                                pvsseg_t *target)
+{
+  double sx[2] = {src->x1, src->x2}, sy[2] = {src->y1, src->y2};
+  double px[2] = {pass->x1, pass->x2}, py[2] = {pass->y1, pass->y2};
+  int i, j;
+
+  for (i = 0; i < 2; i++)
+    for (j = 0; j < 2; j++)
+    {
+      pvsseg_t sep;
+      double a, b;
+
+      sep.x1 = sx[i]; sep.y1 = sy[i];
+      sep.x2 = px[j]; sep.y2 = py[j];
+      if (fabs(sep.x2 - sep.x1) + fabs(sep.y2 - sep.y1) < PVS_EPSILON)
+        continue; // shared end
+
+      a = R_PVSSide(&sep, sx[i^1], sy[i^1]);
+      b = R_PVSSide(&sep, px[j^1], py[j^1]);
+      if (a > PVS_EPSILON && b < -PVS_EPSILON)
+      {
+        if (!R_ClipPVSSeg(target, &sep, -1))
+          return FALSE;
+      }
+      else if (a < -PVS_EPSILON && b > PVS_EPSILON)
+      {
+        if (!R_ClipPVSSeg(target, &sep, 1))
+          return FALSE;
+      }
+    }
+  return TRUE;
+}
+
+//
+// Building
+//
+
+#define R_SetPVSBit(row, n)  ((row)[(n) >> 3] |= 1 << ((n) & 7))
+#define R_GetPVSBit(row, n)  ((row)[(n) >> 3] & (1 << ((n) & 7)))
+
+// Whether might, cut down to what portal can lead to, still has sectors
+// not marked visible yet; if so the cut is left in next
+static dbool R_MightSeeMore(const byte *might, int portal, byte *next)
+{
+  const uint64_t *r = (const uint64_t *)(portalvis + (size_t)portal * rowbytes);
+  const uint64_t *m = (const uint64_t *)might, *v = (const uint64_t *)visrow;
+  uint64_t *n = (uint64_t *)next, more = 0;
+  int i;
+
+  for (i = 0; i < rowbytes / 8; i++)
+    more |= (n[i] = m[i] & r[i]) & ~v[i];
+  return more != 0;
+}
+
+static byte *R_MightRow(int depth)
+{
+  if (depth >= nummightrows)
+  {
+    int n = nummightrows ? nummightrows * 2 : 64;
+
+    mightrows = realloc(mightrows, n * sizeof *mightrows);
+    while (nummightrows < n)
+      mightrows[nummightrows++] = malloc(rowbytes);
+  }
+  return mightrows[depth];
+}
+
+// Sight lines have come through src and then pass into sector, and
+// can't reach anything outside might
+static void R_FlowPVS(const pvsseg_t *src, const pvsseg_t *pass, int sector,
+                      const byte *might, int depth)
+{
+  int i;
+
+  R_SetPVSBit(visrow, sector);
+  if (++steps > PVS_MAXSTEPS)
+    return;
+
+  for (i = firstportal[sector]; i < firstportal[sector+1]; i++)
+  {
+    const portal_t *p = &portals[i];
+    pvsseg_t target = p->seg, source = *src;
+    byte *next;
+
+    // a straight line crosses each line once
+    if (inchain[p->line])
+      continue;
+
+    if (!R_ClipPVSSeg(&target, pass, 1) ||
+        !R_ClipPVSSeg(&target, src, 1) ||
+        !R_ClipToSeparators(src, pass, &target))
+      continue;
+
+    // only the part of the source that can see what's left matters
+    if (!R_ClipPVSSeg(&source, pass, -1) ||
+        !R_ClipToSeparators(&target, pass, &source))
+      continue;
+
+    if (!R_MightSeeMore(might, i, next = R_MightRow(depth)))
+      continue;
+
+    inchain[p->line] = 1;
+    R_FlowPVS(&source, &target, p->to, next, depth + 1);
+    inchain[p->line] = 0;
+  }
+}
+
+// Start portal off with every sector reached flooding through portals
+// with some part past its line, which is all a sight line could reach
+static void R_FloodPortal(int portal, int *stack)
+{
+  const pvsseg_t *l = &portals[portal].seg;
+  byte *reach = portalvis + (size_t)portal * rowbytes;
+  int sp = 0;
+
+  R_SetPVSBit(reach, portals[portal].to);
+  stack[sp++] = portals[portal].to;
+  while (sp)
+  {
+    int s = stack[--sp], i;
+
+    for (i = firstportal[s]; i < firstportal[s+1]; i++)
+    {
+      pvsseg_t q = portals[i].seg;
+
+      if (!R_GetPVSBit(reach, portals[i].to) && R_ClipPVSSeg(&q, l, 1))
+      {
+        R_SetPVSBit(reach, portals[i].to);
+        stack[sp++] = portals[i].to;
+      }
+    }
+  }
+}
+
+// Narrow portal down to what sight lines through it reach
+static void R_PortalPVS(int portal)
+{
+  const portal_t *s = &portals[portal];
+  const byte *reach = portalvis + (size_t)portal * rowbytes;
+  int next = s->to;
+  int i;
+
+  if (totalsteps > PVS_MAXTOTALSTEPS)
+  {
+    flooded++;
+    return;
+  }
+
+  memset(visrow, 0, rowbytes);
+  R_SetPVSBit(visrow, next);
+  inchain[s->line] = 1;
+  steps = 0;
+
+  // anything beyond the first portal's line can be seen through it
+  for (i = firstportal[next]; i < firstportal[next+1]; i++)
+  {
+    const portal_t *p = &portals[i];
+    pvsseg_t target = p->seg;
+    byte *might;
+
+    if (inchain[p->line] || !R_ClipPVSSeg(&target, &s->seg, 1) ||
+        !R_MightSeeMore(reach, i, might = R_MightRow(0)))
+      continue;
+
+    inchain[p->line] = 1;
+    R_FlowPVS(&s->seg, &target, p->to, might, 1);
+    inchain[p->line] = 0;
+  }
+
+  inchain[s->line] = 0;
+  totalsteps += steps;
+
+  // the flood stands for portals with too many ways through
+  if (steps > PVS_MAXSTEPS)
+    flooded++;
+  else
+    memcpy(portalvis + (size_t)portal * rowbytes, visrow, rowbytes);
+}
+
+static int R_CompressPVSRow(const byte *row, byte *out)
+{
+  byte *p = out;
+  int i, j;
+
+  for (i = 0; i < rowbytes; i++)
+  {
+    *p++ = row[i];
+    if (row[i])
+      continue;
+    for (j = 1; i + j < rowbytes && !row[i+j] && j < 255; j++)
+      ;
+    *p++ = j;
+    i += j - 1;
+  }
+  return p - out;
+}
+
+static void R_DecompressPVSRow(const byte *in, const byte *inend, byte *row)
+{
+  byte *p = row, *end = row + rowbytes;
+
+  while (p < end && in < inend)
+  {
+    if (*in)
+      *p++ = *in++;
+    else
+    {
+      int n = in + 1 < inend ? in[1] : 1;
+
+      if (n > end - p)
+        n = end - p;
+      memset(p, 0, n);
+      p += n;
+      in += 2;
+    }
+  }
+  if (p < end)
+    memset(p, 0, end - p);
+}
+
+static int *portalreach;
+
+static int R_ComparePortalReach(const void *a, const void *b)
+{
+  return portalreach[*(const int *)a] - portalreach[*(const int *)b];
+}
+
+static dbool R_ComputePVS(pvs_header_t *header)
+{
+  byte *rows = NULL, *row;
+  int *stack, *order;
+  int numportals = 0, size = 0, maxsize = 0;
+  int i, j;
+
+  firstportal = calloc(numsectors + 1, sizeof *firstportal);
+  for (i = 0; i < numlines; i++)
+    if (lines[i].backsector && lines[i].frontsector != lines[i].backsector &&
+        (lines[i].dx || lines[i].dy))
+    {
+      firstportal[lines[i].frontsector - sectors]++;
+      firstportal[lines[i].backsector - sectors]++;
+      numportals += 2;
+    }
+  for (i = 0; i < numsectors; i++)
+    firstportal[i+1] += firstportal[i];
+
+  if ((int64_t)numportals * rowbytes > PVS_MAXPORTALVIS)
+  {
+    lprintf(LO_WARN, "R_BuildPVS: level too big, %d sectors and %d portals\n",
+        numsectors, numportals);
+    free(firstportal);
+    firstportal = NULL;
+    return FALSE;
+  }
+
+  // fill from the back so each sector's portals end up at firstportal
+  portals = malloc((numportals ? numportals : 1) * sizeof *portals);
+  for (i = numlines - 1; i >= 0; i--)
+  {
+    const line_t *l = &lines[i];
+    double x1 = l->v1->x / (double)FRACUNIT, y1 = l->v1->y / (double)FRACUNIT;
+    double x2 = l->v2->x / (double)FRACUNIT, y2 = l->v2->y / (double)FRACUNIT;
+    portal_t *p;
+
+    if (!l->backsector || l->frontsector == l->backsector || !(l->dx || l->dy))
+      continue;
+
+    // the back sector is on the left going from v1 to v2
+    p = &portals[--firstportal[l->frontsector - sectors]];
+    p->seg.x1 = x1; p->seg.y1 = y1;
+    p->seg.x2 = x2; p->seg.y2 = y2;
+    p->line = i;
+    p->to = l->backsector - sectors;
+
+    p = &portals[--firstportal[l->backsector - sectors]];
+    p->seg.x1 = x2; p->seg.y1 = y2;
+    p->seg.x2 = x1; p->seg.y2 = y1;
+    p->line = i;
+    p->to = l->frontsector - sectors;
+  }
+
+  inchain = calloc(numlines ? numlines : 1, 1);
+  visrow = malloc(rowbytes);
+  stack = malloc(numsectors * sizeof *stack);
+  portalvis = calloc((size_t)numportals * rowbytes + 1, 1);
+  portalreach = malloc((numportals ? numportals : 1) * sizeof *portalreach);
+  order = malloc((numportals ? numportals : 1) * sizeof *order);
+
+  // as in vis, portals that reach the least are done first, so the
+  // ones that reach further can prune with their final sets
+  for (i = 0; i < numportals; i++)
+  {
+    const byte *reach = portalvis + (size_t)i * rowbytes;
+
+    R_FloodPortal(i, stack);
+    portalreach[i] = 0;
+    for (j = 0; j < numsectors; j++)
+      if (R_GetPVSBit(reach, j))
+        portalreach[i]++;
+    order[i] = i;
+  }
+  qsort(order, numportals, sizeof *order, R_ComparePortalReach);
+
+  totalsteps = flooded = 0;
+  for (i = 0; i < numportals; i++)
+    R_PortalPVS(order[i]);
+
+  // a sector sees itself and whatever its portals see
+  pvsofs = Z_Malloc((numsectors + 1) * sizeof *pvsofs, PU_LEVEL, 0);
+  row = malloc(rowbytes * 2 + 2); // worst case a row grows by half
+  for (i = 0; i < numsectors; i++)
+  {
+    int len, k;
+
+    memset(visrow, 0, rowbytes);
+    R_SetPVSBit(visrow, i);
+    for (j = firstportal[i]; j < firstportal[i+1]; j++)
+      for (k = 0; k < rowbytes; k++)
+        visrow[k] |= portalvis[(size_t)j * rowbytes + k];
+
+    len = R_CompressPVSRow(visrow, row);
+    if (size + len > maxsize)
+    {
+      maxsize = maxsize * 2 + len;
+      rows = realloc(rows, maxsize);
+    }
+    pvsofs[i] = size;
+    memcpy(rows + size, row, len);
+    size += len;
+  }
+  pvsofs[numsectors] = size;
+
+  pvsdata = Z_Malloc(size ? size : 1, PU_LEVEL, 0);
+  memcpy(pvsdata, rows, size);
+  header->datasize = size;
+
+  for (i = 0; i < nummightrows; i++)
+    free(mightrows[i]);
+  free(mightrows);
+  free(order);
+  free(portalreach);
+  free(portalvis);
+  free(row);
+  free(rows);
+  free(stack);
+  free(visrow);
+  free(inchain);
+  free(portals);
+  free(firstportal);
+  mightrows = NULL;
+  nummightrows = 0;
+  portalreach = NULL;
+  portalvis = NULL;
+  visrow = inchain = NULL;
+  portals = NULL;
+  firstportal = NULL;
+  return TRUE;
+}
+
+//
+// Cache file
+//
+
+static void R_PVSHeader(pvs_header_t *header)
+{
+  struct MD5Context md5;
+  int i;
+
+  memset(header, 0, sizeof *header);
+  memcpy(header->magic, PVS_MAGIC, sizeof PVS_MAGIC);
+  header->version = PVS_VERSION;
+  header->numsectors = numsectors;
+
+  MD5Init(&md5);
+  MD5Update(&md5, (const md5byte *)&numsectors, sizeof numsectors);
+  for (i = 0; i < numlines; i++)
+  {
+    int32_t l[6];
+
+    l[0] = lines[i].v1->x;
+    l[1] = lines[i].v1->y;
+    l[2] = lines[i].v2->x;
+    l[3] = lines[i].v2->y;
+    l[4] = lines[i].frontsector ? lines[i].frontsector - sectors : -1;
+    l[5] = lines[i].backsector ? lines[i].backsector - sectors : -1;
+    MD5Update(&md5, (const md5byte *)l, sizeof l);
+  }
+  MD5Final(header->md5, &md5);
+}
+
+static dbool R_LoadPVS(const char *path, pvs_header_t *header)
+{
+  pvs_header_t old;
+  RFILE *f = filestream_open(path, RETRO_VFS_FILE_ACCESS_READ,
+      RETRO_VFS_FILE_ACCESS_HINT_NONE);
+  int64_t ofssize = (numsectors + 1) * sizeof *pvsofs;
+  int i;
+
+  if (!f)
+    return FALSE;
+
+  if (filestream_read(f, &old, sizeof old) != sizeof old ||
+      memcmp(old.magic, header->magic, sizeof old.magic) ||
+      old.version != header->version ||
+      memcmp(old.md5, header->md5, sizeof old.md5) ||
+      old.numsectors != header->numsectors)
+  {
+    filestream_close(f);
+    return FALSE;
+  }
+
+  pvsofs = Z_Malloc(ofssize, PU_LEVEL, 0);
+  pvsdata = Z_Malloc(old.datasize ? old.datasize : 1, PU_LEVEL, 0);
+  if (filestream_read(f, pvsofs, ofssize) != ofssize ||
+      filestream_read(f, pvsdata, old.datasize) != (int64_t)old.datasize)
+  {
+    filestream_close(f);
+    Z_Free(pvsofs);
+    Z_Free(pvsdata);
+    pvsofs = NULL;
+    pvsdata = NULL;
+    return FALSE;
+  }
+  filestream_close(f);
+
+  for (i = 0; i < numsectors; i++)
+    if (pvsofs[i] > pvsofs[i+1] || pvsofs[i+1] > old.datasize)
+    {
+      Z_Free(pvsofs);
+      Z_Free(pvsdata);
+      pvsofs = NULL;
+      pvsdata = NULL;
+      return FALSE;
+    }
+
+  header->datasize = old.datasize;
+  return TRUE;
+}
+
+static void R_SavePVS(const char *path, const pvs_header_t *header)
+{
+  RFILE *f = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+      RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+  if (!f)
+  {
+    lprintf(LO_WARN, "R_BuildPVS: couldn't write %s\n", path);
+    return;
+  }
+  filestream_write(f, header, sizeof *header);
+  filestream_write(f, pvsofs, (numsectors + 1) * sizeof *pvsofs);
+  filestream_write(f, pvsdata, header->datasize);
+  filestream_close(f);
+}
+
+void R_BuildPVS(void)
+{
+  pvs_header_t header;
+  char path[PATH_MAX+1];
+  char md5hex[33];
+#ifdef _WIN32
+  char slash = '\\';
+#else
+  char slash = '/';
+#endif
+  int64_t start = I_GetTimeUS();
+  dbool cached;
+  int64_t visible = 0;
+  int i, j;
+
+  // last level's are gone with the rest of PU_LEVEL
+  pvsnodes = pvssubsectors = NULL;
+  pvsofs = NULL;
+  pvsdata = NULL;
+  pvssector = -1;
+
+  if ((!render_pvs && !build_reject) || !numsectors)
+    return;
+
+  // whole words, so the rows can be scanned a word at a time
+  rowbytes = ((numsectors + 63) >> 6) << 3;
+  R_PVSHeader(&header);
+  for (i = 0; i < 16; i++)
+    sprintf(md5hex + i * 2, "%02x", header.md5[i]);
+  snprintf(path, sizeof path, "%s%cprboom_%s.pvs", I_DoomExeDir(), slash, md5hex);
+
+  cached = R_LoadPVS(path, &header);
+  if (!cached)
+  {
+    if (!R_ComputePVS(&header))
+      return;
+    R_SavePVS(path, &header);
+  }
+
+  pvsrow = Z_Malloc(rowbytes, PU_LEVEL, 0);
+  basenodevis = Z_Malloc(numnodes ? numnodes : 1, PU_LEVEL, 0);
+  nodevis = Z_Malloc(numnodes ? numnodes : 1, PU_LEVEL, 0);
+  subsectorvis = Z_Malloc(numsubsectors ? numsubsectors : 1, PU_LEVEL, 0);
+
+  nodeparent = Z_Malloc((numnodes ? numnodes : 1) * sizeof *nodeparent, PU_LEVEL, 0);
+  subsectorparent = Z_Malloc((numsubsectors ? numsubsectors : 1) * sizeof *subsectorparent,
+      PU_LEVEL, 0);
+  for (i = 0; i < numsubsectors; i++)
+    subsectorparent[i] = -1;
+  for (i = 0; i < numnodes; i++)
+    nodeparent[i] = -1;
+  for (i = 0; i < numnodes; i++)
+    for (j = 0; j < 2; j++)
+    {
+      unsigned int child = nodes[i].children[j];
+
+      if (!(child & NF_SUBSECTOR))
+        nodeparent[child] = i;
+      else if ((int)(child & ~NF_SUBSECTOR) < numsubsectors)
+        subsectorparent[child & ~NF_SUBSECTOR] = i;
+    }
+
+  for (i = 0; i < numsectors; i++)
+  {
+    R_DecompressPVSRow(pvsdata + pvsofs[i], pvsdata + pvsofs[i+1], pvsrow);
+    for (j = 0; j < numsectors; j++)
+      if (R_GetPVSBit(pvsrow, j))
+        visible++;
+  }
+
+  lprintf(LO_INFO, "R_BuildPVS: %d sectors, %d%% visible on average, %s in %d ms\n",
+      numsectors, (int)(visible * 100 / ((int64_t)numsectors * numsectors)),
+      cached ? "loaded" : "built", (int)((I_GetTimeUS() - start) / 1000));
+  if (!cached && flooded)
+    lprintf(LO_INFO, "R_BuildPVS: %d portals too open to work out\n", flooded);
+}
+
+dbool R_PVSReject(byte *reject)
+{
+  int i, j;
+
+  if (!pvsofs)
+    return FALSE;
+
+  for (i = 0; i < numsectors; i++)
+  {
+    R_DecompressPVSRow(pvsdata + pvsofs[i], pvsdata + pvsofs[i+1], pvsrow);
+    for (j = 0; j < numsectors; j++)
+      if (!R_GetPVSBit(pvsrow, j))
+      {
+        int pnum = i*numsectors + j;
+
+        reject[pnum>>3] |= 1 << (pnum&7);
+      }
+  }
+  pvssector = -1;  // pvsrow is no longer its row
+
+  // sight between two points goes both ways
+  for (i = 0; i < numsectors; i++)
+    for (j = i + 1; j < numsectors; j++)
+    {
+      int p1 = i*numsectors + j, p2 = j*numsectors + i;
+
+      if (!(reject[p1>>3] & (1 << (p1&7))) || !(reject[p2>>3] & (1 << (p2&7))))
+      {
+        reject[p1>>3] &= ~(1 << (p1&7));
+        reject[p2>>3] &= ~(1 << (p2&7));
+      }
+    }
+  return TRUE;
+}
+
+//
+// Per frame
+//
+
+static byte R_MarkPVSNode(unsigned int bspnum)
+{
+  byte vis;
+
+  if (bspnum & NF_SUBSECTOR)
+  {
+    int num = bspnum == (unsigned int)-1 ? 0 : bspnum & ~NF_SUBSECTOR;
+    int sector = subsectors[num].sector - sectors;
+
+    return subsectorvis[num] = R_GetPVSBit(pvsrow, sector) ? 1 : 0;
+  }
+
+  vis = R_MarkPVSNode(nodes[bspnum].children[0]);
+  vis |= R_MarkPVSNode(nodes[bspnum].children[1]);
+  return basenodevis[bspnum] = vis;
+}
+
+void R_SetupPVS(fixed_t x, fixed_t y)
+{
+  int sector, i;
+
+  if (!render_pvs || !pvsofs)
+  {
+    pvsnodes = pvssubsectors = NULL;
+    return;
+  }
+
+  sector = R_PointInSubsector(x, y)->sector - sectors;
+  if (sector != pvssector)
+  {
+    pvssector = sector;
+    R_DecompressPVSRow(pvsdata + pvsofs[sector], pvsdata + pvsofs[sector+1], pvsrow);
+    R_MarkPVSNode(numnodes ? (unsigned int)(numnodes - 1) : (unsigned int)-1);
+  }
+
+  // R_Subsector still wants the sprites of hidden subsectors, since
+  // they can stick out past whatever hides the rest
+  memcpy(nodevis, basenodevis, numnodes);
+  for (i = 0; i < numsubsectors; i++)
+    if (!subsectorvis[i] && subsectors[i].sector->thinglist)
+    {
+      int n;
+
+      for (n = subsectorparent[i]; n >= 0 && !nodevis[n]; n = nodeparent[n])
+        nodevis[n] = 1;
+    }
+
+  pvsnodes = nodevis;
+  pvssubsectors = subsectorvis;
+}
@@ -0,0 +1,65 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Potentially visible sets: which sectors can be seen from anywhere
+ *      in each sector, worked out at level load and kept in the save
+ *      directory keyed by the MD5 of the map's lines.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#ifndef R_PVS_H
+#define R_PVS_H
+
+#include "doomtype.h"
+#include "m_fixed.h"
+
+// Config: skip BSP subtrees that can't be seen from the view sector.
+// Takes effect from the next level loaded.
+extern int render_pvs;
+
+// Config: fill an all-zero REJECT from the sets, where allowed. Builds
+// the sets even when render_pvs is off.
+extern int build_reject;
+
+// Nonzero for each subsector that may be seen from the view sector, and
+// each node with such a subsector or a thing under it; NULL when not
+// culling
+extern const byte *pvsnodes, *pvssubsectors;
+
+// Call once the level's lines and sectors are grouped
+void R_BuildPVS(void);
+
+// Set the REJECT bit of each pair of sectors neither of which may see
+// the other; FALSE if there are no sets for the level
+dbool R_PVSReject(byte *reject);
+
+// Pick the set for the sector holding the view point
+void R_SetupPVS(fixed_t x, fixed_t y);
+
+#endif
@@ -0,0 +1,187 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Cached Scale2x quads of flats and wall textures. The rounded
+ *      drawers otherwise read five texels and redo the Scale2x
+ *      comparisons for every pixel; with the quads built once they make
+ *      one fetch. Built the first time a flat or texture is drawn in
+ *      rounded mode and kept, within ROUNDED_BUDGET, until R_FreeRounded
+ *      drops them when the wads are unloaded or the textures set up again.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#include "z_zone.h"
+#include "doomstat.h"
+#include "w_wad.h"
+#include "r_main.h"
+#include "r_data.h"
+#include "r_patch.h"
+#include "r_rounded.h"
+
+// A 128x128 texture takes 64K of quads, a flat 16K
+#ifdef MEMORY_LOW
+#define ROUNDED_BUDGET (4*1024*1024)
+#else
+#define ROUNDED_BUDGET (32*1024*1024)
+#endif
+
+static uint8_t **flatrounded;
+static uint8_t **texturerounded;
+static int numflatrounded, numtexturerounded;  // numflats, numtextures when made
+static size_t roundedbytes;
+
+//
+// R_RoundedQuad
+// filter_getScale2xQuadColors without its shared result buffer
+//
+//   B
+// D E F
+//   H
+//
+static void R_RoundedQuad(uint8_t *quad, uint8_t e, uint8_t b, uint8_t f,
+                          uint8_t h, uint8_t d)
+{
+  const uint8_t rowColors[3] = { d, e, f };
+  const int code = (b == f)<<0 | (f == h)<<1 | (h == d)<<2 | (d == b)<<3;
+
+  quad[0] = rowColors[filter_roundedRowMap[0*16+code]];
+  quad[1] = rowColors[filter_roundedRowMap[1*16+code]];
+  quad[2] = rowColors[filter_roundedRowMap[2*16+code]];
+  quad[3] = rowColors[filter_roundedRowMap[3*16+code]];
+}
+
+// NULL when size more bytes would go past the budget
+static uint8_t *R_RoundedAlloc(size_t size)
+{
+  if (roundedbytes + size > ROUNDED_BUDGET)
+    return NULL;
+  roundedbytes += size;
+  return malloc(size);
+}
+
+size_t R_RoundedCacheBytes(void)
+{
+  return roundedbytes;
+}
+
+const uint8_t *R_GetFlatRounded(int flatnum)
+{
+  uint8_t *quads;
+
+  Z_Lock();
+  if (!flatrounded)
+  {
+    flatrounded = calloc(numflats, sizeof *flatrounded);
+    numflatrounded = numflats;
+  }
+
+  // the neighbours wrap like the span drawers' texture coordinates
+  if (!(quads = flatrounded[flatnum]) && (quads = R_RoundedAlloc(64*64*4)))
+  {
+    const uint8_t *flat = W_CacheLumpNum(firstflat + flatnum);
+    int u, v;
+
+    for (v = 0; v < 64; v++)
+      for (u = 0; u < 64; u++)
+        R_RoundedQuad(quads + ((u | (v<<6))<<2),
+                      flat[u | (v<<6)],
+                      flat[u | (((v-1)&63)<<6)],
+                      flat[((u+1)&63) | (v<<6)],
+                      flat[u | (((v+1)&63)<<6)],
+                      flat[((u-1)&63) | (v<<6)]);
+    W_UnlockLumpNum(firstflat + flatnum);
+    flatrounded[flatnum] = quads;
+  }
+  Z_Unlock();
+
+  return quads;
+}
+
+const uint8_t *R_GetTextureRounded(int texnum)
+{
+  uint8_t *quads;
+
+  Z_Lock();
+  if (!texturerounded)
+  {
+    texturerounded = calloc(numtextures, sizeof *texturerounded);
+    numtexturerounded = numtextures;
+  }
+
+  if (!(quads = texturerounded[texnum]))
+  {
+    const rpatch_t *patch = R_CacheTextureCompositePatchNum(texnum);
+    const int width = patch->widthmask + 1, height = patch->height;
+
+    // neighbouring columns as R_RenderSegLoop picks them; rows clamp at
+    // the top like filter_getRoundedForColumn and wrap at the bottom
+    if ((quads = R_RoundedAlloc((size_t)width * height * 4)))
+    {
+      int x, y;
+
+      for (x = 0; x < width; x++)
+      {
+        const uint8_t *col = R_GetTextureColumn(patch, x);
+        const uint8_t *prev = R_GetTextureColumn(patch, x-1);
+        const uint8_t *next = R_GetTextureColumn(patch, x+1);
+        uint8_t *q = quads + x * height * 4;
+
+        for (y = 0; y < height; y++)
+          R_RoundedQuad(q + (y<<2), col[y], col[y ? y-1 : 0], next[y],
+                        col[y+1 < height ? y+1 : 0], prev[y]);
+      }
+      texturerounded[texnum] = quads;
+    }
+    R_UnlockTextureCompositePatchNum(texnum);
+  }
+  Z_Unlock();
+
+  return quads;
+}
+
+void R_FreeRounded(void)
+{
+  int i;
+
+  Z_Lock();
+  for (i = 0; i < numflatrounded; i++)
+    free(flatrounded[i]);
+  free(flatrounded);
+  flatrounded = NULL;
+  numflatrounded = 0;
+
+  for (i = 0; i < numtexturerounded; i++)
+    free(texturerounded[i]);
+  free(texturerounded);
+  texturerounded = NULL;
+  numtexturerounded = 0;
+
+  roundedbytes = 0;
+  Z_Unlock();
+}
@@ -0,0 +1,70 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Cached Scale2x quads of flats and wall textures, for
+ *      RDRAW_FILTER_ROUNDED.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#ifndef R_ROUNDED_H
+#define R_ROUNDED_H
+
+#include "doomtype.h"
+#include "r_filter.h"
+
+// Each texel gets the four corners E0..E3 of its Scale2x upscale (see
+// R_FilterInit), four bytes apart, in the texel order of the source: spot
+// u | v<<6 for flats, column-major like the composite for textures. The
+// middle of the texel (filter_roundedUVMap entry 4) is the texel itself,
+// so it is read from the source.
+//
+// Both are built on first use and take the zone lock, so look them up
+// once a plane or seg. They return NULL once the cache is at its budget,
+// leaving the drawers to work the quads out per pixel.
+const uint8_t *R_GetFlatRounded(int flatnum);
+const uint8_t *R_GetTextureRounded(int texnum);
+
+// Bytes of quads built so far
+size_t R_RoundedCacheBytes(void);
+
+// Drops every quad, before the flats and textures they came from change
+// or go
+void R_FreeRounded(void);
+
+// Which corner, or 4 for the middle, lies under the 16.16 coordinates
+#define R_RoundedCorner(u, v) \
+  filter_roundedUVMap[ \
+    (((((u)>>8) & 0xff)>>(8-FILTER_UVBITS))<<FILTER_UVBITS) + \
+    ((((v)>>8) & 0xff)>>(8-FILTER_UVBITS)) \
+  ]
+
+#define R_RoundedTexel(quads, source, spot, corner) \
+  ((corner) == 4 ? (source)[spot] : (quads)[((spot)<<2) + (corner)])
+
+#endif
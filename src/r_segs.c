@@ -40,57 +40,65 @@
 #include "r_plane.h"
 #include "r_things.h"
 #include "r_draw.h"
+#include "r_drawlist.h"
+#include "r_arena.h"
+#include "r_profile.h"
+#include "r_mipmap.h"
+#include "r_rounded.h"
 #include "w_wad.h"
 #include "v_video.h"
 #include "lprintf.h"
+#include "i_thread.h"
+#include "p_saveg.h"
+#include "r_simd.h"
 
 // OPTIMIZE: closed two sided lines as single sided
 
 // killough 1/6/98: replaced globals with statics where appropriate
 
 // True if any of the segs textures might be visible.
-static dbool    segtextured;
-static dbool    markfloor;      // False if the back side is the same plane.
-static dbool    markceiling;
-static dbool    maskedtexture;
-static int      toptexture;
-static int      bottomtexture;
-static int      midtexture;
+static THREAD_LOCAL dbool    segtextured;
+static THREAD_LOCAL dbool    markfloor;      // False if the back side is the same plane.
+static THREAD_LOCAL dbool    markceiling;
+static THREAD_LOCAL dbool    maskedtexture;
+static THREAD_LOCAL int      toptexture;
+static THREAD_LOCAL int      bottomtexture;
+static THREAD_LOCAL int      midtexture;
 
 dbool           r_wiggle_fix = 0;
 
-static fixed_t  toptexheight, midtexheight, bottomtexheight; // cph
+static THREAD_LOCAL fixed_t  toptexheight, midtexheight, bottomtexheight; // cph
 
-angle_t         rw_normalangle; // angle to line origin
-int             rw_angle1;
-fixed_t         rw_distance;
+THREAD_LOCAL angle_t rw_normalangle; // angle to line origin
+THREAD_LOCAL int     rw_angle1;
+THREAD_LOCAL fixed_t rw_distance;
 
 //
 // regular wall
 //
-static int      rw_x;
-static int      rw_stopx;
-static angle_t  rw_centerangle;
-static fixed_t  rw_offset;
-static fixed_t  rw_scale;
-static fixed_t  rw_scalestep;
-static fixed_t  rw_midtexturemid;
-static fixed_t  rw_toptexturemid;
-static fixed_t  rw_bottomtexturemid;
-static int      rw_lightlevel;
-static int      worldtop;
-static int      worldbottom;
-static int      worldhigh;
-static int      worldlow;
-static fixed_t  pixhigh;
-static fixed_t  pixlow;
-static fixed_t  pixhighstep;
-static fixed_t  pixlowstep;
-static fixed_t  topfrac;
-static fixed_t  topstep;
-static fixed_t  bottomfrac;
-static fixed_t  bottomstep;
-static int      *maskedtexturecol; // dropoff overflow
+static THREAD_LOCAL int      rw_x;
+static THREAD_LOCAL int      rw_stopx;
+static THREAD_LOCAL angle_t  rw_centerangle;
+static THREAD_LOCAL fixed_t  rw_offset;
+static THREAD_LOCAL fixed_t  rw_scale;
+static THREAD_LOCAL fixed_t  rw_scalestep;
+static THREAD_LOCAL fixed_t  rw_midtexturemid;
+static THREAD_LOCAL fixed_t  rw_toptexturemid;
+static THREAD_LOCAL fixed_t  rw_bottomtexturemid;
+static THREAD_LOCAL int      rw_lightlevel;
+static THREAD_LOCAL int      worldtop;
+static THREAD_LOCAL int      worldbottom;
+static THREAD_LOCAL int      worldhigh;
+static THREAD_LOCAL int      worldlow;
+static THREAD_LOCAL fixed_t  pixhigh;
+static THREAD_LOCAL fixed_t  pixlow;
+static THREAD_LOCAL fixed_t  pixhighstep;
+static THREAD_LOCAL fixed_t  pixlowstep;
+static THREAD_LOCAL fixed_t  topfrac;
+static THREAD_LOCAL fixed_t  topstep;
+static THREAD_LOCAL fixed_t  bottomfrac;
+static THREAD_LOCAL fixed_t  bottomstep;
+static THREAD_LOCAL int      *maskedtexturecol;
 
 //
 // R_FixWiggle()
@@ -132,10 +140,10 @@ static int      *maskedtexturecol; // dropoff overflow
 //   possibly, creating a noticable performance penalty.
 //   
 
-static int			max_rwscale = 64 * FRACUNIT;
-static int			heightbits = 12;
-static int			heightunit = (1 << 12);
-static int			invhgtbits = 4;
+static THREAD_LOCAL int	max_rwscale = 64 * FRACUNIT;
+static THREAD_LOCAL int	heightbits = 12;
+static THREAD_LOCAL int	heightunit = (1 << 12);
+static THREAD_LOCAL int	invhgtbits = 4;
  
 static const struct
 {
@@ -152,7 +160,7 @@ static const struct
 
 void R_FixWiggle (sector_t *sector)
 {
-	static int	lastheight = 0;
+	static THREAD_LOCAL int	lastheight = 0;
 	int		height = (sector->ceilingheight - sector->floorheight) >> FRACBITS;
 
 	// disallow negative heights. using 1 forces cache initialization
@@ -162,23 +170,31 @@ void R_FixWiggle (sector_t *sector)
 	// early out?
 	if (height != lastheight)
 	{
+		int scaleindex;
+
 		lastheight = height;
 
 		// initialize, or handle moving sector
+		// (index is stored before the height, since other renderer
+		//  threads may be checking the same sector)
 		if (height != sector->cachedheight)
 		{
-			sector->cachedheight = height;
-			sector->scaleindex = 0;
-			height >>= 7;
+			int h = height >> 7;
 
 			// calculate adjustment
-			while (height >>= 1)
-				sector->scaleindex++;
+			scaleindex = 0;
+			while (h >>= 1)
+				scaleindex++;
+
+			sector->scaleindex = scaleindex;
+			sector->cachedheight = height;
 		}
+		else
+			scaleindex = sector->scaleindex;
 
 		// fine-tune renderer for this wall
-		max_rwscale = scale_values[sector->scaleindex].clamp;
-		heightbits = scale_values[sector->scaleindex].heightbits;
+		max_rwscale = scale_values[scaleindex].clamp;
+		heightbits = scale_values[scaleindex].heightbits;
 		heightunit = (1 << heightbits);
 		invhgtbits = FRACBITS - heightbits;
 	}
@@ -224,6 +240,19 @@ static fixed_t R_ScaleFromGlobalAngle(angle_t visangle)
 // R_RenderMaskedSegRange
 //
 
+// Columns set up before their posts are drawn; at least the widest column
+// buffer batch in r_draw.c.
+#define MASKEDSEG_BATCH 16
+
+typedef struct
+{
+   int x;
+   fixed_t texu, scale, iscale;
+   fixed_t topscreen;
+   const lighttable_t *colormap, *nextcolormap;
+   const rcolumn_t *column, *prevcolumn, *nextcolumn;
+} maskedcol_t;
+
 void R_RenderMaskedSegRange(drawseg_t *ds, int x1, int x2)
 {
    int      texnum;
@@ -232,6 +261,8 @@ void R_RenderMaskedSegRange(drawseg_t *ds, int x1, int x2)
    R_DrawColumn_f colfunc;
    draw_column_vars_t dcvars;
    angle_t angle;
+   dbool neighbours;
+   int x;
 
    R_SetDefaultDrawColumnVars(&dcvars);
 
@@ -282,67 +313,123 @@ void R_RenderMaskedSegRange(drawseg_t *ds, int x1, int x2)
 
    patch = R_CacheTextureCompositePatchNum(texnum);
 
-   /* draw the columns */
+   /* draw the columns
+    *
+    * The columns are set up MASKEDSEG_BATCH at a time and then drawn post
+    * by post: first post of every column, then the second, and so on.
+    * Each post lands next to the same post of the neighbouring column, so
+    * the solid runs of the mid texture batch up in the column buffer
+    * instead of being broken by the gaps between the posts of one column.
+    * The posts of a single column never overlap, so the order is free.
+    */
+
+   neighbours = drawvars.filterwall == RDRAW_FILTER_LINEAR ||
+                drawvars.filterwall == RDRAW_FILTER_ROUNDED;
+   dcvars.texheight = patch->height; // killough 11/98
 
-   for (dcvars.x = x1 ; dcvars.x <= x2 ; dcvars.x++, spryscale += rw_scalestep)
+   for (x = x1 ; x <= x2 ; x += MASKEDSEG_BATCH)
    {
-      if (maskedtexturecol[dcvars.x] == INT_MAX) // dropoff overflow
-         continue;
-
-      // calculate texture offset - POPE
-      angle = (ds->rw_centerangle + xtoviewangle[dcvars.x]) >> ANGLETOFINESHIFT;
-      dcvars.texu = ds->rw_offset - FixedMul(finetangent[angle], ds->rw_distance);
-      if (drawvars.filterwall == RDRAW_FILTER_LINEAR)
-         dcvars.texu -= (FRACUNIT>>1);
-
-      if (!fixedcolormap)
-         dcvars.z = spryscale; // for filtering -- POPE
-      dcvars.colormap = R_ColourMap(rw_lightlevel,spryscale);
-      dcvars.nextcolormap = R_ColourMap(rw_lightlevel+1,spryscale); // for filtering -- POPE
-
-      // killough 3/2/98:
-      //
-      // This calculation used to overflow and cause crashes in Doom:
-      //
-      // sprtopscreen = centeryfrac - FixedMul(dcvars.texturemid, spryscale);
-      //
-      // This code fixes it, by using double-precision intermediate
-      // arithmetic and by skipping the drawing of 2s normals whose
-      // mapping to screen coordinates is totally out of range:
+      maskedcol_t cols[MASKEDSEG_BATCH];
+      const int last = x2 < x + MASKEDSEG_BATCH - 1 ? x2 : x + MASKEDSEG_BATCH - 1;
+      int numcols = 0, maxposts = 0, i, p;
+      fixed_t nextscale;
 
+      for (dcvars.x = x ; dcvars.x <= last ; dcvars.x++, spryscale += rw_scalestep)
       {
-         int64_t t = ((int64_t) centeryfrac << FRACBITS) -
-            (int64_t) dcvars.texturemid * spryscale;
-         if (t + (int64_t) textureheight[texnum] * spryscale < 0 ||
-               t > (int64_t) MAX_SCREENHEIGHT << FRACBITS*2)
-            continue;        // skip if the texture is out of screen's range
-         sprtopscreen = (long)(t >> FRACBITS);
-      }
+         maskedcol_t *mc;
+         fixed_t topscreen;
+
+         if (maskedtexturecol[dcvars.x] == INT_MAX) // dropoff overflow
+            continue;
+
+         // killough 3/2/98:
+         //
+         // This calculation used to overflow and cause crashes in Doom:
+         //
+         // sprtopscreen = centeryfrac - FixedMul(dcvars.texturemid, spryscale);
+         //
+         // This code fixes it, by using double-precision intermediate
+         // arithmetic and by skipping the drawing of 2s normals whose
+         // mapping to screen coordinates is totally out of range:
+
+         {
+            int64_t t = ((int64_t) centeryfrac << FRACBITS) -
+               (int64_t) dcvars.texturemid * spryscale;
+            if (t + (int64_t) textureheight[texnum] * spryscale < 0 ||
+                  t > (int64_t) MAX_SCREENHEIGHT << FRACBITS*2)
+               continue;        // skip if the texture is out of screen's range
+            topscreen = (long)(t >> FRACBITS);
+         }
 
-      dcvars.iscale = 0xffffffffu / (unsigned) spryscale;
+         mc = &cols[numcols++];
+         mc->x = dcvars.x;
+         mc->scale = spryscale;
+         mc->topscreen = topscreen;
 
-      // killough 1/25/98: here's where Medusa came in, because
-      // it implicitly assumed that the column was all one patch.
-      // Originally, Doom did not construct complete columns for
-      // multipatched textures, so there were no header or trailer
-      // bytes in the column referred to below, which explains
-      // the Medusa effect. The fix is to construct TRUE columns
-      // when forming multipatched textures (see r_data.c).
+         // calculate texture offset - POPE
+         angle = (ds->rw_centerangle + xtoviewangle[dcvars.x]) >> ANGLETOFINESHIFT;
+         mc->texu = ds->rw_offset - FixedMul(finetangent[angle], ds->rw_distance);
+         if (drawvars.filterwall == RDRAW_FILTER_LINEAR)
+            mc->texu -= (FRACUNIT>>1);
+
+         mc->colormap = R_ColourMap(rw_lightlevel,spryscale);
+         mc->nextcolormap = R_ColourMap(rw_lightlevel+1,spryscale); // for filtering -- POPE
+         mc->iscale = 0xffffffffu / (unsigned) spryscale;
+
+         // killough 1/25/98: here's where Medusa came in, because
+         // it implicitly assumed that the column was all one patch.
+         // Originally, Doom did not construct complete columns for
+         // multipatched textures, so there were no header or trailer
+         // bytes in the column referred to below, which explains
+         // the Medusa effect. The fix is to construct TRUE columns
+         // when forming multipatched textures (see r_data.c).
+
+         mc->column = R_GetPatchColumnWrapped(patch, maskedtexturecol[dcvars.x]);
+         if (neighbours)
+         {
+            mc->prevcolumn = R_GetPatchColumnWrapped(patch, maskedtexturecol[dcvars.x]-1);
+            mc->nextcolumn = R_GetPatchColumnWrapped(patch, maskedtexturecol[dcvars.x]+1);
+         }
+         else
+            mc->prevcolumn = mc->nextcolumn = mc->column;
+
+         if (mc->column->numPosts > maxposts)
+            maxposts = mc->column->numPosts;
+
+         maskedtexturecol[dcvars.x] = INT_MAX; // dropoff overflow
+      }
+
+      nextscale = spryscale;
 
       // draw the texture
-      R_DrawMaskedColumn(
-            patch,
-            colfunc,
-            &dcvars,
-            R_GetPatchColumnWrapped(patch, maskedtexturecol[dcvars.x]),
-            R_GetPatchColumnWrapped(patch, maskedtexturecol[dcvars.x]-1),
-            R_GetPatchColumnWrapped(patch, maskedtexturecol[dcvars.x]+1)
-            );
+      for (p = 0 ; p < maxposts ; p++)
+      {
+         for (i = 0 ; i < numcols ; i++)
+         {
+            const maskedcol_t *mc = &cols[i];
+
+            if (p >= mc->column->numPosts)
+               continue;
+
+            dcvars.x = mc->x;
+            dcvars.texu = mc->texu;
+            if (!fixedcolormap)
+               dcvars.z = mc->scale; // for filtering -- POPE
+            dcvars.colormap = mc->colormap;
+            dcvars.nextcolormap = mc->nextcolormap;
+            dcvars.iscale = mc->iscale;
+            spryscale = mc->scale;
+            sprtopscreen = mc->topscreen;
+
+            R_DrawMaskedPost(colfunc, &dcvars, mc->column, mc->prevcolumn,
+                             mc->nextcolumn, &mc->column->posts[p]);
+         }
+      }
 
-      maskedtexturecol[dcvars.x] = INT_MAX; // dropoff overflow
+      spryscale = nextscale;
    }
 
-   R_UnlockTextureCompositePatchNum(texnum);
+   R_QueueUnlockTexture(texnum);
 
    curline = NULL; /* cph 2001/11/18 - must clear curline now we're done with it, so R_ColourMap doesn't try using it for other things */
 }
@@ -354,29 +441,269 @@ void R_RenderMaskedSegRange(drawseg_t *ds, int x1, int x2)
 // CALLED: CORE LOOPING ROUTINE.
 //
 
-static int didsolidcol; /* True if at least one column was marked solid */
+static THREAD_LOCAL int didsolidcol; /* True if at least one column was marked solid */
+
+//
+// R_SetMipColumn
+// For RDRAW_FILTER_MIPMAP: point the column at the mip level that suits
+// its scale, with the texture coordinates scaled to match.
+//
+
+static void R_SetMipColumn(draw_column_vars_t *dcvars, const texmips_t *mips,
+                           int texturecolumn, fixed_t iscale)
+{
+   const int level = R_MipLevel(iscale, mips->levels);
+
+   // an earlier tier of the same column may have changed it
+   dcvars->iscale = iscale;
+   if (!level)
+      return;
+
+   texturecolumn = (texturecolumn >> level) & mips->widthmask[level];
+   dcvars->source = mips->pixels[level] + texturecolumn * mips->height[level];
+   dcvars->iscale = iscale >> level;
+   dcvars->texturemid >>= level;
+   // wrap untiled textures too, the rounding may land a texel past the end
+   dcvars->texheight = mips->height[level];
+}
+
+//
+// R_SetRoundedColumn
+// For RDRAW_FILTER_ROUNDED: hand the drawer the column's cached Scale2x
+// quads, if the texture has them.
+//
+
+static void R_SetRoundedColumn(draw_column_vars_t *dcvars, const uint8_t *quads,
+                               const rpatch_t *patch, int texturecolumn)
+{
+   dcvars->rounded = NULL;
+   if (!quads)
+      return;
+
+   while (texturecolumn < 0)
+      texturecolumn += patch->width;
+   dcvars->rounded = quads + (texturecolumn & patch->widthmask) * patch->height * 4;
+   // the quads wrap at the texture height, so wrap untiled textures too
+   dcvars->texheight = patch->height;
+}
+
+//
+// R_SetupSegColumns
+// The first half of the wall pass: the stepped values of every column of
+// the seg, and the wall top and bottom clipped against the openings as
+// they stand before the seg is drawn (no column touches another's), so
+// R_RenderSegLoop only has to look them up.
+//
+
+static THREAD_LOCAL int segyl[MAX_SCREENWIDTH], segyh[MAX_SCREENWIDTH];
+static THREAD_LOCAL int segtopmid[MAX_SCREENWIDTH], segbottommid[MAX_SCREENWIDTH];
+static THREAD_LOCAL fixed_t segscale[MAX_SCREENWIDTH];
+
+// k steps on, wrapping the way the += of the old loop did
+static inline fixed_t R_SegSteps(fixed_t step, unsigned k)
+{
+   return (fixed_t)(k*(unsigned)step);
+}
+
+#if defined(R_SIMD_SSE2)
+// Four clip entries, sign extended
+static inline __m128i R_LoadClip(const int16_t *clip)
+{
+   __m128i v = _mm_loadl_epi64((const __m128i *)clip);
+
+   return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+}
+
+static inline __m128i R_SegLanes(fixed_t v, fixed_t step)
+{
+   return _mm_setr_epi32(v, (fixed_t)((unsigned)v + (unsigned)R_SegSteps(step, 1)),
+         (fixed_t)((unsigned)v + (unsigned)R_SegSteps(step, 2)),
+         (fixed_t)((unsigned)v + (unsigned)R_SegSteps(step, 3)));
+}
+#endif
+
+static void R_SetupSegColumns(void)
+{
+   int x = rw_x;
+   const int n = rw_stopx - rw_x;
+   const int round = heightunit - 1;
+
+#if defined(R_SIMD_SSE2)
+   {
+      const __m128i shift = _mm_cvtsi32_si128(heightbits);
+      const __m128i one = _mm_set1_epi32(1), rnd = _mm_set1_epi32(round);
+      __m128i top = R_SegLanes(topfrac, topstep);
+      __m128i bottom = R_SegLanes(bottomfrac, bottomstep);
+      __m128i high = R_SegLanes(pixhigh, pixhighstep);
+      __m128i low = R_SegLanes(pixlow, pixlowstep);
+      __m128i scale = R_SegLanes(rw_scale, rw_scalestep);
+      const __m128i top4 = _mm_set1_epi32(R_SegSteps(topstep, 4));
+      const __m128i bottom4 = _mm_set1_epi32(R_SegSteps(bottomstep, 4));
+      const __m128i high4 = _mm_set1_epi32(R_SegSteps(pixhighstep, 4));
+      const __m128i low4 = _mm_set1_epi32(R_SegSteps(pixlowstep, 4));
+      const __m128i scale4 = _mm_set1_epi32(R_SegSteps(rw_scalestep, 4));
+
+      for (; x + 4 <= rw_stopx; x += 4)
+      {
+         __m128i yl = _mm_sra_epi32(_mm_add_epi32(top, rnd), shift);
+         __m128i yh = _mm_sra_epi32(bottom, shift);
+         __m128i ceil = _mm_add_epi32(R_LoadClip(ceilingclip + x), one);
+         __m128i floor = _mm_sub_epi32(R_LoadClip(floorclip + x), one);
+         __m128i m;
+
+         // yl = max(yl, ceil), yh = min(yh, floor)
+         m = _mm_cmpgt_epi32(ceil, yl);
+         yl = _mm_or_si128(_mm_and_si128(m, ceil), _mm_andnot_si128(m, yl));
+         m = _mm_cmpgt_epi32(yh, floor);
+         yh = _mm_or_si128(_mm_and_si128(m, floor), _mm_andnot_si128(m, yh));
+
+         _mm_storeu_si128((__m128i *)(segyl + x), yl);
+         _mm_storeu_si128((__m128i *)(segyh + x), yh);
+         _mm_storeu_si128((__m128i *)(segtopmid + x), _mm_sra_epi32(high, shift));
+         _mm_storeu_si128((__m128i *)(segbottommid + x),
+               _mm_sra_epi32(_mm_add_epi32(low, rnd), shift));
+         _mm_storeu_si128((__m128i *)(segscale + x), scale);
+
+         top = _mm_add_epi32(top, top4);
+         bottom = _mm_add_epi32(bottom, bottom4);
+         high = _mm_add_epi32(high, high4);
+         low = _mm_add_epi32(low, low4);
+         scale = _mm_add_epi32(scale, scale4);
+      }
+   }
+#elif defined(R_SIMD_NEON)
+   {
+      const int32x4_t shift = vdupq_n_s32(-heightbits);
+      const int32x4_t one = vdupq_n_s32(1), rnd = vdupq_n_s32(round);
+      const int32_t lanes[4] = { 0, 1, 2, 3 };
+      const int32x4_t l = vld1q_s32(lanes);
+      int32x4_t top = vmlaq_n_s32(vdupq_n_s32(topfrac), l, topstep);
+      int32x4_t bottom = vmlaq_n_s32(vdupq_n_s32(bottomfrac), l, bottomstep);
+      int32x4_t high = vmlaq_n_s32(vdupq_n_s32(pixhigh), l, pixhighstep);
+      int32x4_t low = vmlaq_n_s32(vdupq_n_s32(pixlow), l, pixlowstep);
+      int32x4_t scale = vmlaq_n_s32(vdupq_n_s32(rw_scale), l, rw_scalestep);
+      const int32x4_t top4 = vdupq_n_s32(R_SegSteps(topstep, 4));
+      const int32x4_t bottom4 = vdupq_n_s32(R_SegSteps(bottomstep, 4));
+      const int32x4_t high4 = vdupq_n_s32(R_SegSteps(pixhighstep, 4));
+      const int32x4_t low4 = vdupq_n_s32(R_SegSteps(pixlowstep, 4));
+      const int32x4_t scale4 = vdupq_n_s32(R_SegSteps(rw_scalestep, 4));
+
+      for (; x + 4 <= rw_stopx; x += 4)
+      {
+         int32x4_t ceil = vaddq_s32(vmovl_s16(vld1_s16(ceilingclip + x)), one);
+         int32x4_t floor = vsubq_s32(vmovl_s16(vld1_s16(floorclip + x)), one);
+
+         vst1q_s32(segyl + x, vmaxq_s32(vshlq_s32(vaddq_s32(top, rnd), shift), ceil));
+         vst1q_s32(segyh + x, vminq_s32(vshlq_s32(bottom, shift), floor));
+         vst1q_s32(segtopmid + x, vshlq_s32(high, shift));
+         vst1q_s32(segbottommid + x, vshlq_s32(vaddq_s32(low, rnd), shift));
+         vst1q_s32(segscale + x, scale);
+
+         top = vaddq_s32(top, top4);
+         bottom = vaddq_s32(bottom, bottom4);
+         high = vaddq_s32(high, high4);
+         low = vaddq_s32(low, low4);
+         scale = vaddq_s32(scale, scale4);
+      }
+   }
+#endif
+
+   // the rest one at a time, from where the vectors stopped
+   {
+      const unsigned k = x - rw_x;
+      fixed_t top = (fixed_t)((unsigned)topfrac + R_SegSteps(topstep, k));
+      fixed_t bottom = (fixed_t)((unsigned)bottomfrac + R_SegSteps(bottomstep, k));
+      fixed_t high = (fixed_t)((unsigned)pixhigh + R_SegSteps(pixhighstep, k));
+      fixed_t low = (fixed_t)((unsigned)pixlow + R_SegSteps(pixlowstep, k));
+      fixed_t scale = (fixed_t)((unsigned)rw_scale + R_SegSteps(rw_scalestep, k));
+
+      for (; x < rw_stopx; x++)
+      {
+         int yl = (top+round)>>heightbits;
+         int yh = bottom>>heightbits;
+
+         segyl[x] = yl <= ceilingclip[x] ? ceilingclip[x]+1 : yl;
+         segyh[x] = yh >= floorclip[x] ? floorclip[x]-1 : yh;
+         segtopmid[x] = high>>heightbits;
+         segbottommid[x] = (low+round)>>heightbits;
+         segscale[x] = scale;
+
+         top += topstep;
+         bottom += bottomstep;
+         high += pixhighstep;
+         low += pixlowstep;
+         scale += rw_scalestep;
+      }
+   }
+
+   // where the loop used to leave them
+   topfrac += R_SegSteps(topstep, n);
+   bottomfrac += R_SegSteps(bottomstep, n);
+   rw_scale += R_SegSteps(rw_scalestep, n);
+   if (!midtexture)
+   {
+      if (toptexture)
+         pixhigh += R_SegSteps(pixhighstep, n);
+      if (bottomtexture)
+         pixlow += R_SegSteps(pixlowstep, n);
+   }
+}
 
 static void R_RenderSegLoop (void)
 {
-   const rpatch_t *tex_patch;
+   const rpatch_t *mid_patch = NULL, *top_patch = NULL, *bottom_patch = NULL;
+   const texmips_t *mid_mips = NULL, *top_mips = NULL, *bottom_mips = NULL;
+   const dbool mipmapped = drawvars.filterwall == RDRAW_FILTER_MIPMAP;
+   const uint8_t *mid_rounded = NULL, *top_rounded = NULL, *bottom_rounded = NULL;
+   const dbool rounded = drawvars.filterwall == RDRAW_FILTER_ROUNDED;
+   // only the linear and rounded drawers look at the next and previous columns
+   const dbool neighbours = rounded || drawvars.filterwall == RDRAW_FILTER_LINEAR;
+   fixed_t iscale = 0;
    draw_column_vars_t dcvars;
    R_DrawColumn_f colfunc = R_GetDrawColumnFunc(RDC_PIPELINE_STANDARD, drawvars.filterwall, drawvars.filterz);
    fixed_t  texturecolumn = 0;   // shut up compiler warning
 
    R_SetDefaultDrawColumnVars(&dcvars);
 
+   // Lock the composites once for the whole seg rather than per column;
+   // this also keeps the (shared) patch cache out of the inner loop.
+   if (midtexture)
+      mid_patch = R_CacheTextureCompositePatchNum(midtexture);
+   if (toptexture)
+      top_patch = R_CacheTextureCompositePatchNum(toptexture);
+   if (bottomtexture)
+      bottom_patch = R_CacheTextureCompositePatchNum(bottomtexture);
+
+   if (mipmapped)
+   {
+      if (midtexture)
+         mid_mips = R_GetTextureMips(midtexture);
+      if (toptexture)
+         top_mips = R_GetTextureMips(toptexture);
+      if (bottomtexture)
+         bottom_mips = R_GetTextureMips(bottomtexture);
+   }
+   else if (rounded)
+   {
+      if (midtexture)
+         mid_rounded = R_GetTextureRounded(midtexture);
+      if (toptexture)
+         top_rounded = R_GetTextureRounded(toptexture);
+      if (bottomtexture)
+         bottom_rounded = R_GetTextureRounded(bottomtexture);
+   }
+
+   R_SetupSegColumns();
+
    for ( ; rw_x < rw_stopx ; rw_x++)
    {
       /* mark floor / ceiling areas */
-      int yh = bottomfrac>>heightbits;
-      int yl = (topfrac+heightunit-1)>>heightbits;
+      int yh = segyh[rw_x];
+      int yl = segyl[rw_x];
 
       // no space above wall?
       int bottom,top = ceilingclip[rw_x]+1;
 
-      if (yl < top)
-         yl = top;
-
       if (markceiling)
       {
          bottom = yl-1;
@@ -393,11 +720,7 @@ static void R_RenderSegLoop (void)
          ceilingclip[rw_x] = bottom;
       }
 
-      //      yh = bottomfrac>>heightbits;
-
       bottom = floorclip[rw_x]-1;
-      if (yh > bottom)
-         yh = bottom;
 
       if (markfloor)
       {
@@ -416,6 +739,8 @@ static void R_RenderSegLoop (void)
       // texturecolumn and lighting are independent of wall tiers
       if (segtextured)
       {
+         const fixed_t scale = segscale[rw_x];
+
          // calculate texture offset
          angle_t angle =(rw_centerangle+xtoviewangle[rw_x])>>ANGLETOFINESHIFT;
 
@@ -425,12 +750,12 @@ static void R_RenderSegLoop (void)
          dcvars.texu = texturecolumn; // for filtering -- POPE
          texturecolumn >>= FRACBITS;
 
-         dcvars.colormap = R_ColourMap(rw_lightlevel,rw_scale);
-         dcvars.nextcolormap = R_ColourMap(rw_lightlevel+1,rw_scale); // for filtering -- POPE
-         dcvars.z = rw_scale; // for filtering -- POPE
+         dcvars.colormap = R_ColourMap(rw_lightlevel,scale);
+         dcvars.nextcolormap = R_ColourMap(rw_lightlevel+1,scale); // for filtering -- POPE
+         dcvars.z = scale; // for filtering -- POPE
 
          dcvars.x = rw_x;
-         dcvars.iscale = 0xffffffffu / (unsigned)rw_scale;
+         dcvars.iscale = iscale = 0xffffffffu / (unsigned)scale;
       }
 
       // draw the wall tiers
@@ -440,14 +765,18 @@ static void R_RenderSegLoop (void)
          dcvars.yl = yl;     // single sided line
          dcvars.yh = yh;
          dcvars.texturemid = rw_midtexturemid;
-         tex_patch = R_CacheTextureCompositePatchNum(midtexture);
-         dcvars.source = R_GetTextureColumn(tex_patch, texturecolumn);
-         dcvars.prevsource = R_GetTextureColumn(tex_patch, texturecolumn-1);
-         dcvars.nextsource = R_GetTextureColumn(tex_patch, texturecolumn+1);
+         dcvars.source = R_TextureColumn(mid_patch, texturecolumn);
+         if (neighbours)
+         {
+            dcvars.prevsource = R_TextureColumn(mid_patch, texturecolumn-1);
+            dcvars.nextsource = R_TextureColumn(mid_patch, texturecolumn+1);
+         }
          dcvars.texheight = midtexheight;
-         colfunc (&dcvars);
-         R_UnlockTextureCompositePatchNum(midtexture);
-         tex_patch = NULL;
+         if (mipmapped)
+            R_SetMipColumn(&dcvars, mid_mips, texturecolumn, iscale);
+         else if (rounded)
+            R_SetRoundedColumn(&dcvars, mid_rounded, mid_patch, texturecolumn);
+         R_QueueColumn(colfunc, &dcvars);
          ceilingclip[rw_x] = viewheight;
          floorclip[rw_x] = -1;
       }
@@ -458,8 +787,7 @@ static void R_RenderSegLoop (void)
          if (toptexture)
          {
             // top wall
-            int mid = pixhigh>>heightbits;
-            pixhigh += pixhighstep;
+            int mid = segtopmid[rw_x];
 
             if (mid >= floorclip[rw_x])
                mid = floorclip[rw_x]-1;
@@ -469,14 +797,18 @@ static void R_RenderSegLoop (void)
                dcvars.yl = yl;
                dcvars.yh = mid;
                dcvars.texturemid = rw_toptexturemid;
-               tex_patch = R_CacheTextureCompositePatchNum(toptexture);
-               dcvars.source = R_GetTextureColumn(tex_patch,texturecolumn);
-               dcvars.prevsource = R_GetTextureColumn(tex_patch,texturecolumn-1);
-               dcvars.nextsource = R_GetTextureColumn(tex_patch,texturecolumn+1);
+               dcvars.source = R_TextureColumn(top_patch, texturecolumn);
+               if (neighbours)
+               {
+                  dcvars.prevsource = R_TextureColumn(top_patch, texturecolumn-1);
+                  dcvars.nextsource = R_TextureColumn(top_patch, texturecolumn+1);
+               }
                dcvars.texheight = toptexheight;
-               colfunc (&dcvars);
-               R_UnlockTextureCompositePatchNum(toptexture);
-               tex_patch = NULL;
+               if (mipmapped)
+                  R_SetMipColumn(&dcvars, top_mips, texturecolumn, iscale);
+               else if (rounded)
+                  R_SetRoundedColumn(&dcvars, top_rounded, top_patch, texturecolumn);
+               R_QueueColumn(colfunc, &dcvars);
                ceilingclip[rw_x] = mid;
             }
             else
@@ -491,8 +823,7 @@ static void R_RenderSegLoop (void)
 
          if (bottomtexture)          // bottom wall
          {
-            int mid = (pixlow+heightunit-1)>>heightbits;
-            pixlow += pixlowstep;
+            int mid = segbottommid[rw_x];
 
             // no space above wall?
             if (mid <= ceilingclip[rw_x])
@@ -503,14 +834,18 @@ static void R_RenderSegLoop (void)
                dcvars.yl = mid;
                dcvars.yh = yh;
                dcvars.texturemid = rw_bottomtexturemid;
-               tex_patch = R_CacheTextureCompositePatchNum(bottomtexture);
-               dcvars.source = R_GetTextureColumn(tex_patch, texturecolumn);
-               dcvars.prevsource = R_GetTextureColumn(tex_patch, texturecolumn-1);
-               dcvars.nextsource = R_GetTextureColumn(tex_patch, texturecolumn+1);
+               dcvars.source = R_TextureColumn(bottom_patch, texturecolumn);
+               if (neighbours)
+               {
+                  dcvars.prevsource = R_TextureColumn(bottom_patch, texturecolumn-1);
+                  dcvars.nextsource = R_TextureColumn(bottom_patch, texturecolumn+1);
+               }
                dcvars.texheight = bottomtexheight;
-               colfunc (&dcvars);
-               R_UnlockTextureCompositePatchNum(bottomtexture);
-               tex_patch = NULL;
+               if (mipmapped)
+                  R_SetMipColumn(&dcvars, bottom_mips, texturecolumn, iscale);
+               else if (rounded)
+                  R_SetRoundedColumn(&dcvars, bottom_rounded, bottom_patch, texturecolumn);
+               R_QueueColumn(colfunc, &dcvars);
                floorclip[rw_x] = mid;
             }
             else
@@ -526,7 +861,7 @@ static void R_RenderSegLoop (void)
          // add this info to the solid columns array for r_bsp.c
          if ((markceiling || markfloor) &&
                (floorclip[rw_x] <= ceilingclip[rw_x] + 1)) {
-            solidcol[rw_x] = 1; didsolidcol = 1;
+            R_SetSolidColumn(rw_x); didsolidcol = 1;
          }
 
          // save texturecol for backdrawing of masked mid texture
@@ -534,10 +869,14 @@ static void R_RenderSegLoop (void)
             maskedtexturecol[rw_x] = texturecolumn;
       }
 
-      rw_scale += rw_scalestep;
-      topfrac += topstep;
-      bottomfrac += bottomstep;
    }
+
+   if (midtexture)
+      R_QueueUnlockTexture(midtexture);
+   if (toptexture)
+      R_QueueUnlockTexture(toptexture);
+   if (bottomtexture)
+      R_QueueUnlockTexture(bottomtexture);
 }
 
 // killough 5/2/98: move from r_main.c, made static, simplified
@@ -558,6 +897,84 @@ static fixed_t R_PointToDist(fixed_t x, fixed_t y)
             + ANG90) >> ANGLETOFINESHIFT]);
 }
 
+//
+// Vertex cache
+// Most vertices are shared by several segs, each of which used to work
+// out the same angle (and for the first vertex, distance) again. Entries
+// are stamped with the vertexgen they were worked out for.
+//
+
+typedef struct {
+   unsigned int anglegen, distgen;
+   angle_t angle;
+   fixed_t dist;
+} vertexview_t;
+
+unsigned int vertexgen = 1;
+
+static THREAD_LOCAL vertexview_t *vertexviews;
+static THREAD_LOCAL int numvertexviews;
+
+// lookups and hits, per render slice
+static int64_t vertexlookups[MAX_RENDER_THREADS], vertexhits[MAX_RENDER_THREADS];
+
+static vertexview_t *R_VertexView(const vertex_t *v)
+{
+   if (numvertexviews < numvertexes)
+   {
+      vertexviews = realloc(vertexviews, numvertexes * sizeof(*vertexviews));
+      memset(vertexviews + numvertexviews, 0,
+            (numvertexes - numvertexviews) * sizeof(*vertexviews));
+      numvertexviews = numvertexes;
+   }
+   vertexlookups[slicenum]++;
+   return &vertexviews[v - vertexes];
+}
+
+angle_t R_VertexAngle(const vertex_t *v)
+{
+   vertexview_t *vv = R_VertexView(v);
+
+   if (vv->anglegen != vertexgen)
+   {
+      vv->angle = R_PointToAngle(v->x, v->y);
+      vv->anglegen = vertexgen;
+   }
+   else
+      vertexhits[slicenum]++;
+   return vv->angle;
+}
+
+static fixed_t R_VertexDist(const vertex_t *v)
+{
+   vertexview_t *vv = R_VertexView(v);
+
+   if (vv->distgen != vertexgen)
+   {
+      vv->dist = (viewx==v->x && viewy==v->y) ? 0 : R_PointToDist(v->x, v->y);
+      vv->distgen = vertexgen;
+   }
+   else
+      vertexhits[slicenum]++;
+   return vv->dist;
+}
+
+void R_ReportVertexCache(void)
+{
+   int64_t lookups = 0, hits = 0;
+   int i;
+
+   for (i = 0; i < MAX_RENDER_THREADS; i++)
+   {
+      lookups += vertexlookups[i];
+      hits += vertexhits[i];
+      vertexlookups[i] = vertexhits[i] = 0;
+   }
+   if (lookups)
+      lprintf(LO_INFO, "R_ReportVertexCache: %d%% of %lld vertex lookups hit\n",
+            (int)(hits * 100 / lookups), (long long)lookups);
+}
+
 //
 // R_StoreWallRange
 // A wall segment will be drawn
@@ -568,23 +985,26 @@ void R_StoreWallRange(const int start, const int stop)
    fixed_t hyp;
    angle_t offsetangle;
 
+   R_ProfileCount(RPC_SEGS, 1);
+
    if (ds_p == drawsegs+maxdrawsegs)   // killough 1/98 -- fix 2s line HOM
    {
       unsigned pos = ds_p - drawsegs; // jff 8/9/98 fix from ZDOOM1.14a
-      unsigned newmax = maxdrawsegs ? maxdrawsegs*2 : 128; // killough
-      drawsegs = realloc(drawsegs,newmax*sizeof(*drawsegs));
+      unsigned newmax = maxdrawsegs*2; // killough
+      drawsegs = R_GrowArenaRegion(RA_DRAWSEGS, newmax, pos);
       ds_p = drawsegs + pos;          // jff 8/9/98 fix from ZDOOM1.14a
       maxdrawsegs = newmax;
    }
 
-   if(curline->miniseg == FALSE) // figgi -- skip minisegs
-      curline->linedef->flags |= ML_MAPPED;
-
    sidedef = curline->sidedef;
    linedef = curline->linedef;
 
    // mark the segment as visible for auto map
-   linedef->flags |= ML_MAPPED;
+   if (!(linedef->flags & ML_MAPPED))
+   {
+      linedef->flags |= ML_MAPPED;
+      P_MarkLineMapped(linedef);
+   }
 
    // calculate rw_distance for scale calculation
    rw_normalangle = curline->angle + ANG90;
@@ -594,8 +1014,7 @@ void R_StoreWallRange(const int start, const int stop)
    if (D_abs(offsetangle) > ANG90)
       offsetangle = ANG90;
 
-   hyp = (viewx==curline->v1->x && viewy==curline->v1->y)?
-      0 : R_PointToDist (curline->v1->x, curline->v1->y);
+   hyp = R_VertexDist(curline->v1);
    rw_distance = FixedMul(hyp, finecosine[offsetangle>>ANGLETOFINESHIFT]);
 
    ds_p->x1 = rw_x = start;
@@ -604,35 +1023,53 @@ void R_StoreWallRange(const int start, const int stop)
    rw_stopx = stop+1;
 
    {     // killough 1/6/98, 2/1/98: remove limit on openings
-      extern int *openings; // dropoff overflow
-      extern size_t maxopenings;
+      extern THREAD_LOCAL int16_t *openings;
+      extern THREAD_LOCAL size_t maxopenings;
+      extern THREAD_LOCAL int *maskedcols;
+      extern THREAD_LOCAL size_t maxmaskedcols;
       size_t pos = lastopening - openings;
-      size_t need = (rw_stopx - start)*4 + pos;
+      size_t need = (rw_stopx - start)*2 + pos;
+      size_t maskedpos = lastmaskedcol - maskedcols;
+      size_t maskedneed = (rw_stopx - start) + maskedpos;
+      drawseg_t *ds;                //jff 8/9/98 needed for fix from ZDoom
+
+      // jff 8/9/98 borrowed fix for openings from ZDOOM1.14
+      // [RH] We also need to adjust the openings pointers that
+      //    were already stored in drawsegs.
+#define ADJUST(p, old, oldlast, new) if (ds->p + ds->x1 >= old && ds->p + ds->x1 <= oldlast)\
+            ds->p = ds->p - old + new;
       if (need > maxopenings)
       {
-         drawseg_t *ds;                //jff 8/9/98 needed for fix from ZDoom
-         int *oldopenings = openings; // dropoff overflow
-         int *oldlast = lastopening; // dropoff overflow
+         int16_t *oldopenings = openings;
+         int16_t *oldlast = lastopening;
 
          do
-            maxopenings = maxopenings ? maxopenings*2 : 16384;
+            maxopenings *= 2;
          while (need > maxopenings);
-         openings = realloc(openings, maxopenings * sizeof(*openings));
+         openings = R_GrowArenaRegion(RA_OPENINGS, maxopenings, pos);
          lastopening = openings + pos;
 
-         // jff 8/9/98 borrowed fix for openings from ZDOOM1.14
-         // [RH] We also need to adjust the openings pointers that
-         //    were already stored in drawsegs.
          for (ds = drawsegs; ds < ds_p; ds++)
          {
-#define ADJUST(p) if (ds->p + ds->x1 >= oldopenings && ds->p + ds->x1 <= oldlast)\
-            ds->p = ds->p - oldopenings + openings;
-            ADJUST (maskedtexturecol);
-            ADJUST (sprtopclip);
-            ADJUST (sprbottomclip);
+            ADJUST (sprtopclip, oldopenings, oldlast, openings);
+            ADJUST (sprbottomclip, oldopenings, oldlast, openings);
          }
-#undef ADJUST
       }
+      if (maskedneed > maxmaskedcols)
+      {
+         int *oldcols = maskedcols;
+         int *oldlast = lastmaskedcol;
+
+         do
+            maxmaskedcols *= 2;
+         while (maskedneed > maxmaskedcols);
+         maskedcols = R_GrowArenaRegion(RA_MASKEDCOLS, maxmaskedcols, maskedpos);
+         lastmaskedcol = maskedcols + maskedpos;
+
+         for (ds = drawsegs; ds < ds_p; ds++)
+            ADJUST (maskedtexturecol, oldcols, oldlast, maskedcols);
+      }
+#undef ADJUST
    }  // killough: end of code to remove limits on openings
 
    if (r_wiggle_fix)
@@ -811,8 +1248,8 @@ void R_StoreWallRange(const int start, const int stop)
       if (sidedef->midtexture)    // masked midtexture
       {
          maskedtexture = TRUE;
-         ds_p->maskedtexturecol = maskedtexturecol = lastopening - rw_x;
-         lastopening += rw_stopx - rw_x;
+         ds_p->maskedtexturecol = maskedtexturecol = lastmaskedcol - rw_x;
+         lastmaskedcol += rw_stopx - rw_x;
       }
    }
 
@@ -918,13 +1355,13 @@ void R_StoreWallRange(const int start, const int stop)
    // save sprite clipping info
    if ((ds_p->silhouette & SIL_TOP || maskedtexture) && !ds_p->sprtopclip)
    {
-      memcpy (lastopening, ceilingclip+start, sizeof(int)*(rw_stopx-start)); // dropoff overflow
+      memcpy (lastopening, ceilingclip+start, sizeof(*lastopening)*(rw_stopx-start));
       ds_p->sprtopclip = lastopening - start;
       lastopening += rw_stopx - start;
    }
    if ((ds_p->silhouette & SIL_BOTTOM || maskedtexture) && !ds_p->sprbottomclip)
    {
-      memcpy (lastopening, floorclip+start, sizeof(int)*(rw_stopx-start)); // dropoff overflow
+      memcpy (lastopening, floorclip+start, sizeof(*lastopening)*(rw_stopx-start));
       ds_p->sprbottomclip = lastopening - start;
       lastopening += rw_stopx - start;
    }
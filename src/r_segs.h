@@ -37,4 +37,12 @@
 void R_RenderMaskedSegRange(drawseg_t *ds, int x1, int x2);
 void R_StoreWallRange(const int start, const int stop);
 
+// Per thread cache of each vertex's angle and distance from the view
+// point, good while vertexgen stays the same; bump it when the view moves
+extern unsigned int vertexgen;
+angle_t R_VertexAngle(const vertex_t *v);
+
+// Log how often the cache had the answer since the last call
+void R_ReportVertexCache(void);
+
 #endif
@@ -0,0 +1,54 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Compile time selection of the vector instruction set used by the
+ *      renderer's inner loops. Defines R_SIMD_SSE2 or R_SIMD_NEON (and
+ *      R_SIMD for either) and pulls in the matching intrinsics header.
+ *      Builds without either keep the plain C paths.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#ifndef R_SIMD_H
+#define R_SIMD_H
+
+#include <retro_environment.h>
+
+#if defined(__SSE2__)
+#define R_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(HAVE_NEON) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define R_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(R_SIMD_SSE2) || defined(R_SIMD_NEON)
+#define R_SIMD
+#endif
+
+#endif
@@ -34,9 +34,13 @@
  *
  *-----------------------------------------------------------------------------*/
 
+#include "z_zone.h"
 #include "r_sky.h"
 #include "r_main.h"
 #include "r_state.h"
+#include "r_draw.h"
+#include "r_patch.h"
+#include "v_video.h"
 #include "doomstat.h"
 
 //
@@ -118,3 +122,134 @@ void R_InitSkyMap (void)
     }
   }
 }
+
+//
+// Sky column cache
+//
+// With point filtering every sky column maps view rows onto texture rows
+// the same way, so the normal sky is colormapped once into columns of
+// ready pixels. Each covers rows centery-viewheight .. centery+viewheight-1,
+// so looking up and down doesn't rebuild it; palette flashes, the
+// invulnerability colormap and view size changes do.
+//
+
+static struct {
+  int texture;
+  fixed_t texturemid, iscale;
+  int height, gamma;
+  const pixel_t *colormap16;
+  unsigned widthmask;
+  pixel_t *pixels;
+  size_t size;
+} skycache;
+
+static dbool skycachevalid;
+
+static void R_BuildSkyCache(const pixel_t *colormap16)
+{
+  const rpatch_t *tex_patch = R_CacheTextureCompositePatchNum(skytexture);
+  int texheight = textureheight[skytexture]>>FRACBITS;
+  int rows = 2*viewheight;
+  size_t size = (tex_patch->widthmask+1) * rows * sizeof(*skycache.pixels);
+  unsigned c;
+
+  if (size > skycache.size)
+  {
+    skycache.pixels = realloc(skycache.pixels, size);
+    skycache.size = size;
+  }
+
+  // same texel choice as R_DrawColumn16_PointUV_PointZ
+  for (c = 0; c <= tex_patch->widthmask; c++)
+  {
+    const uint8_t *source = tex_patch->columns[c].pixels;
+    pixel_t *dest = skycache.pixels + c * rows;
+    fixed_t frac = skytexturemid - viewheight*skyiscale;
+    int y;
+
+    if (!(texheight & (texheight-1)))
+    {
+      const fixed_t mask = ((texheight-1)<<FRACBITS)|0xffff;
+
+      for (y = 0; y < rows; y++, frac += skyiscale)
+        dest[y] = colormap16[source[(frac & mask)>>FRACBITS]];
+    }
+    else
+    {
+      const fixed_t wrap = texheight<<FRACBITS;
+
+      for (y = 0; y < rows; y++, frac += skyiscale)
+      {
+        fixed_t f = frac % wrap;
+
+        dest[y] = colormap16[source[(f < 0 ? f + wrap : f)>>FRACBITS]];
+      }
+    }
+  }
+
+  skycache.texture = skytexture;
+  skycache.texturemid = skytexturemid;
+  skycache.iscale = skyiscale;
+  skycache.height = viewheight;
+  skycache.gamma = usegamma;
+  skycache.colormap16 = colormap16;
+  skycache.widthmask = tex_patch->widthmask;
+
+  R_UnlockTextureCompositePatchNum(skytexture);
+}
+
+//
+// R_UpdateSkyCache
+// Called once a frame after R_SetupFrame, before any render thread
+// starts on the planes.
+//
+void R_UpdateSkyCache(void)
+{
+  const lighttable_t *colormap;
+  const pixel_t *colormap16;
+  int texheight;
+
+  skycachevalid = FALSE;
+
+  // only the point filtered drawer is this simple
+  if ((drawvars.filterwall != RDRAW_FILTER_POINT &&
+       drawvars.filterwall != RDRAW_FILTER_MIPMAP) ||
+      drawvars.filterz != RDRAW_FILTER_POINT)
+    return;
+
+  // the rows cached reach viewheight either side of centery
+  if (centery < 0 || centery > viewheight)
+    return;
+
+  // non power of two heights wrap once a pixel, so the step must fit
+  texheight = textureheight[skytexture]>>FRACBITS;
+  if (texheight <= 0 ||
+      ((texheight & (texheight-1)) && skyiscale >= texheight<<FRACBITS))
+    return;
+
+  // as in R_DoDrawPlane
+  if (comp[comp_skymap] || !(colormap = fixedcolormap))
+    colormap = fullcolormap;
+  colormap16 = V_Colormap16(colormap);
+
+  if (skycache.texture != skytexture || skycache.texturemid != skytexturemid ||
+      skycache.iscale != skyiscale || skycache.height != viewheight ||
+      skycache.gamma != usegamma || skycache.colormap16 != colormap16)
+    R_BuildSkyCache(colormap16);
+
+  skycachevalid = TRUE;
+}
+
+//
+// R_GetSkyColumn
+// Pixels for texture column col of the normal sky, indexed by view row,
+// or NULL when the cache can't stand in for the column drawer this frame.
+//
+const pixel_t *R_GetSkyColumn(unsigned col)
+{
+  if (!skycachevalid)
+    return NULL;
+
+  col &= skycache.widthmask;
+  return skycache.pixels + col * 2*skycache.height + skycache.height - centery;
+}
@@ -35,6 +35,7 @@
 #define __R_SKY__
 
 #include "m_fixed.h"
+#include "doomtype.h"
 
 /* SKY, store the number for name. */
 #define SKYFLATNAME  "F_SKY1"
@@ -55,4 +56,9 @@ extern dbool   skystretch;
 /* Called whenever the view size changes. */
 void R_InitSkyMap(void);
 
+/* Colormapped columns of the normal sky, rebuilt as needed once a frame;
+ * R_GetSkyColumn returns NULL when they can't be used. */
+void R_UpdateSkyCache(void);
+const pixel_t *R_GetSkyColumn(unsigned col);
+
 #endif
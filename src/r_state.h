@@ -38,6 +38,7 @@
 // Need data structure definitions.
 #include "d_player.h"
 #include "r_data.h"
+#include "i_thread.h"
 
 //
 // Refresh internal data structures,
@@ -47,9 +48,14 @@
 // needed for texture pegging
 extern fixed_t *textureheight;
 
+// Size of the view on screen; viewwidth and viewheight are what it is
+// drawn at, less when the dynamic resolution has stepped down
 extern int scaledviewwidth;
+extern int scaledviewheight;
 
 extern int firstflat, numflats;
+// Each flat's 4096 pixels in the level's flat arena, NULL if it isn't in it
+extern const uint8_t **flatpixels;
 
 // for global animation
 extern int *flattranslation;
@@ -101,13 +107,13 @@ extern angle_t          clipangle;
 extern int              viewangletox[FINEANGLES/2];
 extern angle_t          xtoviewangle[MAX_SCREENWIDTH+1];  // killough 2/8/98
 extern int              fieldofview;
-extern fixed_t          rw_distance;
-extern angle_t          rw_normalangle;
+extern THREAD_LOCAL fixed_t rw_distance;
+extern THREAD_LOCAL angle_t rw_normalangle;
 
 // angle to line origin
-extern int              rw_angle1;
+extern THREAD_LOCAL int  rw_angle1;
 
-extern visplane_t       *floorplane;
-extern visplane_t       *ceilingplane;
+extern THREAD_LOCAL visplane_t *floorplane;
+extern THREAD_LOCAL visplane_t *ceilingplane;
 
 #endif
@@ -37,10 +37,14 @@
 #include "r_bsp.h"
 #include "r_segs.h"
 #include "r_draw.h"
+#include "r_drawlist.h"
+#include "r_arena.h"
+#include "r_profile.h"
 #include "r_things.h"
 #include "r_fps.h"
 #include "v_video.h"
 #include "lprintf.h"
+#include "i_jobs.h"
 
 #define MINZ        (FRACUNIT*4)
 #define BASEYCENTER 100
@@ -69,8 +73,8 @@ fixed_t pspriteyscale;
 // constant arrays
 //  used for psprite clipping and initializing clipping
 
-int negonearray[MAX_SCREENWIDTH];        // killough 2/8/98: // dropoff overflow
-int screenheightarray[MAX_SCREENWIDTH];  // change to MAX_* // dropoff overflow
+int16_t negonearray[MAX_SCREENWIDTH];        // killough 2/8/98:
+int16_t screenheightarray[MAX_SCREENWIDTH];  // change to MAX_*
 
 //
 // INITIALIZATION FUNCTIONS
@@ -262,8 +266,15 @@ static void R_InitSpriteDefs(const char * const * namelist)
 // GAME FUNCTIONS
 //
 
-static vissprite_t *vissprites, **vissprite_ptrs;  // killough
-static size_t num_vissprite, num_vissprite_alloc, num_vissprite_ptrs;
+static THREAD_LOCAL vissprite_t *vissprites, **vissprite_ptrs;  // killough
+static THREAD_LOCAL size_t num_vissprite, num_vissprite_alloc, num_vissprite_ptrs;
+
+#ifdef PRBOOM_THREADS
+// sector_t::validcount belongs to the main thread; the other render
+// slices keep their own marks, stamped with the same frame validcount
+static THREAD_LOCAL int *slicemarks;
+static THREAD_LOCAL int numslicemarks;
+#endif
 
 //
 // R_InitSprites
@@ -286,6 +297,16 @@ void R_InitSprites(const char * const *namelist)
 void R_ClearSprites (void)
 {
    num_vissprite = 0;            // killough
+   vissprites = R_ArenaRegion(RA_VISSPRITES, &num_vissprite_alloc);
+
+#ifdef PRBOOM_THREADS
+   if (slicenum && numslicemarks != numsectors)
+   {
+      numslicemarks = numsectors;
+      slicemarks = realloc(slicemarks, numsectors * sizeof(*slicemarks));
+      memset(slicemarks, 0, numsectors * sizeof(*slicemarks));
+   }
+#endif
 }
 
 //
@@ -296,16 +317,53 @@ static vissprite_t *R_NewVisSprite(void)
 {
    if (num_vissprite >= num_vissprite_alloc)             // killough
    {
-      size_t num_vissprite_alloc_prev = num_vissprite_alloc;
+      num_vissprite_alloc *= 2;
+      vissprites = R_GrowArenaRegion(RA_VISSPRITES, num_vissprite_alloc,
+            num_vissprite);
+   }
+   return vissprites + num_vissprite++;
+}
+
+//
+// R_SpriteExtent
+// R_ProjectSprite only needs the size and offsets of a sprite patch to
+// place it on screen, so each render slice keeps them per sprite lump
+// instead of taking the zone lock to cache the whole patch for every
+// thing it projects, most of which are then rejected.
+//
+
+typedef struct {
+   short width, leftoffset, topoffset;
+   dbool known;
+} spriteextent_t;
+
+static THREAD_LOCAL spriteextent_t *spriteextents;
+static THREAD_LOCAL int numspriteextents;
+
+static const spriteextent_t *R_SpriteExtent(int lump)
+{
+   spriteextent_t *se;
+
+   if (numspriteextents < numspritelumps)
+   {
+      spriteextents = realloc(spriteextents, numspritelumps * sizeof(*spriteextents));
+      memset(spriteextents + numspriteextents, 0,
+            (numspritelumps - numspriteextents) * sizeof(*spriteextents));
+      numspriteextents = numspritelumps;
+   }
 
-      num_vissprite_alloc = num_vissprite_alloc ? num_vissprite_alloc*2 : 128;
-      vissprites = realloc(vissprites,num_vissprite_alloc*sizeof(*vissprites));
+   se = &spriteextents[lump];
+   if (!se->known)
+   {
+      const rpatch_t *patch = R_CachePatchNum(lump+firstspritelump);
 
-      //e6y: set all fields to zero
-      memset(vissprites + num_vissprite_alloc_prev, 0,
-            (num_vissprite_alloc - num_vissprite_alloc_prev)*sizeof(*vissprites));
+      se->width = patch->width;
+      se->leftoffset = patch->leftoffset;
+      se->topoffset = patch->topoffset;
+      se->known = TRUE;
+      R_UnlockPatchNum(lump+firstspritelump);
    }
-   return vissprites + num_vissprite++;
+   return se;
 }
 
 //
@@ -315,10 +373,10 @@ static vissprite_t *R_NewVisSprite(void)
 //  in posts/runs of opaque pixels.
 //
 
-int   *mfloorclip;   // dropoff overflow
-int   *mceilingclip; // dropoff overflow
-fixed_t spryscale;
-fixed_t sprtopscreen;
+THREAD_LOCAL int16_t *mfloorclip;
+THREAD_LOCAL int16_t *mceilingclip;
+THREAD_LOCAL fixed_t spryscale;
+THREAD_LOCAL fixed_t sprtopscreen;
 
 void R_DrawMaskedColumn(
       const rpatch_t *patch,
@@ -330,47 +388,79 @@ void R_DrawMaskedColumn(
       )
 {
   int     i;
+
+  dcvars->texheight = patch->height; // killough 11/98
+  for (i=0; i<column->numPosts; i++)
+    R_DrawMaskedPost(colfunc, dcvars, column, prevcolumn, nextcolumn, &column->posts[i]);
+}
+
+//
+// R_DrawMaskedPost
+// One post of R_DrawMaskedColumn, for callers that order the posts of
+// several columns themselves. dcvars->texheight must already be set.
+//
+
+void R_DrawMaskedPost(
+      R_DrawColumn_f colfunc,
+      draw_column_vars_t *dcvars,
+      const rcolumn_t *column,
+      const rcolumn_t *prevcolumn,
+      const rcolumn_t *nextcolumn,
+      const rpost_t *post
+      )
+{
   int     topscreen;
   int     bottomscreen;
   fixed_t basetexturemid = dcvars->texturemid;
 
-  dcvars->texheight = patch->height; // killough 11/98
-  for (i=0; i<column->numPosts; i++) {
-    const rpost_t *post = &column->posts[i];
-
-    // calculate unclipped screen coordinates for post
-    topscreen = sprtopscreen + spryscale*post->topdelta;
-    bottomscreen = topscreen + spryscale*post->length;
+  // calculate unclipped screen coordinates for post
+  topscreen = sprtopscreen + spryscale*post->topdelta;
+  bottomscreen = topscreen + spryscale*post->length;
 
-    dcvars->yl = (topscreen+FRACUNIT-1)>>FRACBITS;
-    dcvars->yh = (bottomscreen-1)>>FRACBITS;
+  dcvars->yl = (topscreen+FRACUNIT-1)>>FRACBITS;
+  dcvars->yh = (bottomscreen-1)>>FRACBITS;
 
-    if (dcvars->yh >= mfloorclip[dcvars->x])
-      dcvars->yh = mfloorclip[dcvars->x]-1;
+  if (dcvars->yh >= mfloorclip[dcvars->x])
+    dcvars->yh = mfloorclip[dcvars->x]-1;
 
-    if (dcvars->yl <= mceilingclip[dcvars->x])
-      dcvars->yl = mceilingclip[dcvars->x]+1;
+  if (dcvars->yl <= mceilingclip[dcvars->x])
+    dcvars->yl = mceilingclip[dcvars->x]+1;
 
-    // killough 3/2/98, 3/27/98: Failsafe against overflow/crash:
-    if (dcvars->yl <= dcvars->yh && dcvars->yh < viewheight)
-    {
-      dcvars->source = column->pixels + post->topdelta;
-      dcvars->prevsource = prevcolumn->pixels + post->topdelta;
-      dcvars->nextsource = nextcolumn->pixels + post->topdelta;
-
-      dcvars->texturemid = basetexturemid - (post->topdelta<<FRACBITS);
-
-      dcvars->edgeslope = post->slope;
-      // Drawn by either R_DrawColumn
-      //  or (SHADOW) R_DrawFuzzColumn.
-      dcvars->drawingmasked = 1; // POPE
-      colfunc (dcvars);
-      dcvars->drawingmasked = 0; // POPE
-    }
+  // killough 3/2/98, 3/27/98: Failsafe against overflow/crash:
+  if (dcvars->yl <= dcvars->yh && dcvars->yh < viewheight)
+  {
+    dcvars->source = column->pixels + post->topdelta;
+    dcvars->prevsource = prevcolumn->pixels + post->topdelta;
+    dcvars->nextsource = nextcolumn->pixels + post->topdelta;
+
+    dcvars->texturemid = basetexturemid - (post->topdelta<<FRACBITS);
+
+    dcvars->edgeslope = post->slope;
+    // Drawn by either R_DrawColumn
+    //  or (SHADOW) R_DrawFuzzColumn.
+    dcvars->drawingmasked = 1; // POPE
+    R_QueueColumn(colfunc, dcvars);
+    dcvars->drawingmasked = 0; // POPE
   }
   dcvars->texturemid = basetexturemid;
 }
 
+//
+// Sprite spans
+// The posts of the texture column a sprite is sampling, placed on the
+// screen once and shared by the run of screen columns that sample the
+// same column; magnified sprites at high resolution draw several screen
+// columns a texel. Only the per-column clipping is left to each one.
+// Columns with more posts than this go through R_DrawMaskedColumn.
+//
+
+#define MAX_SPRITE_SPANS 64
+
+typedef struct {
+  int yl, yh;           // unclipped screen rows of the post
+  const rpost_t *post;
+} spritespan_t;
+
 //
 // R_DrawVisSprite
 //  mfloorclip and mceilingclip should also be set.
@@ -385,6 +475,9 @@ static void R_DrawVisSprite(vissprite_t *vis, int x1, int x2)
   draw_column_vars_t dcvars;
   enum draw_filter_type_e filter;
   enum draw_filter_type_e filterz;
+  spritespan_t spans[MAX_SPRITE_SPANS];
+  int numspans = -1, spancolumn = 0, i;
+  const rcolumn_t *column = NULL, *prevcolumn = NULL, *nextcolumn = NULL;
 
   R_SetDefaultDrawColumnVars(&dcvars);
   if (vis->mobjflags & MF_PLAYERSPRITE) {
@@ -431,21 +524,70 @@ static void R_DrawVisSprite(vissprite_t *vis, int x1, int x2)
     sprtopscreen += (viewheight/2 - centery)<<FRACBITS;
   }
 
+  dcvars.texheight = patch->height; // killough 11/98
   for (dcvars.x=vis->x1 ; dcvars.x<=vis->x2 ; dcvars.x++, frac += vis->xiscale)
   {
+    int top, bottom;
+
     texturecolumn = frac>>FRACBITS;
     dcvars.texu = frac;
 
-    R_DrawMaskedColumn(
-      patch,
-      colfunc,
-      &dcvars,
-      R_GetPatchColumnClamped(patch, texturecolumn),
-      R_GetPatchColumnClamped(patch, texturecolumn-1),
-      R_GetPatchColumnClamped(patch, texturecolumn+1)
-    );
+    if (numspans < 0 || texturecolumn != spancolumn)
+    {
+      column = R_GetPatchColumnClamped(patch, texturecolumn);
+      prevcolumn = R_GetPatchColumnClamped(patch, texturecolumn-1);
+      nextcolumn = R_GetPatchColumnClamped(patch, texturecolumn+1);
+      spancolumn = texturecolumn;
+      numspans = column->numPosts;
+      if (numspans <= MAX_SPRITE_SPANS)
+        for (i = 0; i < numspans; i++)
+        {
+          // as R_DrawMaskedPost places them
+          const rpost_t *post = &column->posts[i];
+          int topscreen = sprtopscreen + spryscale*post->topdelta;
+          int bottomscreen = topscreen + spryscale*post->length;
+
+          spans[i].yl = (topscreen+FRACUNIT-1)>>FRACBITS;
+          spans[i].yh = (bottomscreen-1)>>FRACBITS;
+          spans[i].post = post;
+        }
+    }
+
+    if (numspans > MAX_SPRITE_SPANS)
+    {
+      R_DrawMaskedColumn(patch, colfunc, &dcvars, column, prevcolumn, nextcolumn);
+      continue;
+    }
+
+    top = mceilingclip[dcvars.x]+1;
+    bottom = mfloorclip[dcvars.x]-1;
+    if (top > bottom)
+      continue;
+
+    for (i = 0; i < numspans; i++)
+    {
+      const rpost_t *post = spans[i].post;
+      fixed_t basetexturemid = dcvars.texturemid;
+
+      dcvars.yl = spans[i].yl < top ? top : spans[i].yl;
+      dcvars.yh = spans[i].yh > bottom ? bottom : spans[i].yh;
+
+      // killough 3/2/98, 3/27/98: Failsafe against overflow/crash:
+      if (dcvars.yl > dcvars.yh || dcvars.yh >= viewheight)
+        continue;
+
+      dcvars.source = column->pixels + post->topdelta;
+      dcvars.prevsource = prevcolumn->pixels + post->topdelta;
+      dcvars.nextsource = nextcolumn->pixels + post->topdelta;
+      dcvars.texturemid = basetexturemid - (post->topdelta<<FRACBITS);
+      dcvars.edgeslope = post->slope;
+      dcvars.drawingmasked = 1; // POPE
+      R_QueueColumn(colfunc, &dcvars);
+      dcvars.drawingmasked = 0; // POPE
+      dcvars.texturemid = basetexturemid;
+    }
   }
-  R_UnlockPatchNum(vis->patch+firstspritelump); // cph - release lump
+  R_QueueUnlockPatch(vis->patch+firstspritelump); // cph - release lump
 }
 
 //
@@ -475,6 +617,9 @@ static void R_ProjectSprite (mobj_t* thing, int lightlevel)
    fixed_t tz;
    int width;
 
+   // Do not attempt to render special TNT1 invisible sprite
+   if (thing->sprite == SPR_TNT1) return;
+
    if (movement_smooth)
    {
       fx = thing->PrevX + FixedMul (tic_vars.frac, thing->x - thing->PrevX);
@@ -509,9 +654,6 @@ static void R_ProjectSprite (mobj_t* thing, int lightlevel)
    if (D_abs(tx)>(tz<<2))
       return;
 
-   // Do not attempt to render special TNT1 invisible sprite
-   if (thing->sprite == SPR_TNT1) return;
-
    // decide which patch to use for sprite relative to player
    sprdef = &sprites[thing->sprite];
 
@@ -547,7 +689,7 @@ static void R_ProjectSprite (mobj_t* thing, int lightlevel)
    }
 
    {
-      const rpatch_t* patch = R_CachePatchNum(lump+firstspritelump);
+      const spriteextent_t *patch = R_SpriteExtent(lump);
 
       /* calculate edges of the shape
        * cph 2003/08/1 - fraggle points out that this offset must be flipped
@@ -564,11 +706,10 @@ static void R_ProjectSprite (mobj_t* thing, int lightlevel)
 
       gzt = fz + (patch->topoffset << FRACBITS);
       width = patch->width;
-      R_UnlockPatchNum(lump+firstspritelump);
    }
 
    // off the side?
-   if (x1 > viewwidth || x2 < 0)
+   if (x1 > slicex2 || x2 < slicex1)
       return;
 
    // killough 4/9/98: clip things which are out of view due to height
@@ -612,8 +753,8 @@ static void R_ProjectSprite (mobj_t* thing, int lightlevel)
    vis->gz = fz;
    vis->gzt = gzt;                          // killough 3/27/98
    vis->texturemid = vis->gzt - viewz;
-   vis->x1 = x1 < 0 ? 0 : x1;
-   vis->x2 = x2 >= viewwidth ? viewwidth-1 : x2;
+   vis->x1 = x1 < slicex1 ? slicex1 : x1;
+   vis->x2 = x2 > slicex2 ? slicex2 : x2;
    iscale = FixedDiv (FRACUNIT, xscale);
 
    if (flip)
@@ -659,11 +800,24 @@ void R_AddSprites(subsector_t* subsec, int lightlevel)
    //  subsectors during BSP building.
    // Thus we check whether its already added.
 
-   if (sec->validcount == validcount)
-      return;
+#ifdef PRBOOM_THREADS
+   if (slicenum)
+   {
+      int *mark = &slicemarks[sec - sectors];
+
+      if (*mark == validcount)
+         return;
+      *mark = validcount;
+   }
+   else
+#endif
+   {
+      if (sec->validcount == validcount)
+         return;
 
-   // Well, now it will be done.
-   sec->validcount = validcount;
+      // Well, now it will be done.
+      sec->validcount = validcount;
+   }
 
    // Handle all things in sector.
 
@@ -714,7 +868,7 @@ static void R_DrawPSprite (pspdef_t *psp, int lightlevel)
    }
 
    // off the side
-   if (x2 < 0 || x1 > viewwidth)
+   if (x2 < slicex1 || x1 > slicex2)
       return;
 
    // store information in a vissprite
@@ -723,8 +877,8 @@ static void R_DrawPSprite (pspdef_t *psp, int lightlevel)
    // killough 12/98: fix psprite positioning problem
    vis->texturemid = (BASEYCENTER<<FRACBITS) /* +  FRACUNIT/2 */ -
       (psp->sy-topoffset);
-   vis->x1 = x1 < 0 ? 0 : x1;
-   vis->x2 = x2 >= viewwidth ? viewwidth-1 : x2;
+   vis->x1 = x1 < slicex1 ? slicex1 : x1;
+   vis->x2 = x2 > slicex2 ? slicex2 : x2;
    // proff 11/06/98: Added for high-res
    vis->scale = pspriteyscale;
 
@@ -787,40 +941,67 @@ void R_DrawPlayerSprites(void)
 //
 
 // killough 9/2/98: merge sort
+// Now a stable LSD radix sort, one byte per pass, over a packed array of
+// (key, index) pairs so the passes never touch the vissprites themselves.
+// Nearest first, sprites of equal scale keeping the order they were added.
 
-static void msort(vissprite_t **s, vissprite_t **t, int n)
+typedef struct {
+   uint32_t key;
+   int index;
+} vissort_t;
+
+static THREAD_LOCAL vissort_t *vissprite_keys;
+
+// below this, insertion sort beats clearing the histograms
+#define RADIXSORT_MIN 64
+
+static void R_RadixSortKeys(vissort_t *s, vissort_t *t, int n)
 {
-   if (n >= 16)
+   int shift;
+
+   for (shift = 0; shift < 32; shift += 8)
    {
-      int n1 = n/2, n2 = n - n1;
-      vissprite_t **s1 = s, **s2 = s + n1, **d = t;
+      int count[256], i, sum;
+      vissort_t *swap;
 
-      msort(s1, t, n1);
-      msort(s2, t, n2);
+      memset(count, 0, sizeof count);
+      for (i = 0; i < n; i++)
+         count[(s[i].key >> shift) & 0xff]++;
 
-      while ((*s1)->scale > (*s2)->scale ?
-            (*d++ = *s1++, --n1) : (*d++ = *s2++, --n2));
+      // all keys share this byte, the pass wouldn't move anything
+      if (count[(s[0].key >> shift) & 0xff] == n)
+         continue;
 
-      if (n2)
-         memcpy(d, s2, n2 * sizeof(void *));
-      else
-         memcpy(d, s1, n1 * sizeof(void *));
+      for (i = 0, sum = 0; i < 256; i++)
+      {
+         int c = count[i];
+         count[i] = sum;
+         sum += c;
+      }
 
-      memcpy(s, t, n * sizeof(void *));
+      for (i = 0; i < n; i++)
+         t[count[(s[i].key >> shift) & 0xff]++] = s[i];
+
+      swap = s; s = t; t = swap;
    }
-   else
+
+   if (s != vissprite_keys)
+      memcpy(vissprite_keys, s, n * sizeof *s);
+}
+
+static void R_InsertionSortKeys(vissort_t *s, int n)
+{
+   int i;
+   for (i = 1; i < n; i++)
    {
-      int i;
-      for (i = 1; i < n; i++)
+      vissort_t temp = s[i];
+      int j = i;
+      while (j && s[j-1].key > temp.key)
       {
-         vissprite_t *temp = s[i];
-         if (s[i-1]->scale < temp->scale)
-         {
-            int j = i;
-            while ((s[j] = s[j-1])->scale < temp->scale && --j);
-            s[j] = temp;
-         }
+         s[j] = s[j-1];
+         j--;
       }
+      s[j] = temp;
    }
 }
 
@@ -832,22 +1013,33 @@ void R_SortVisSprites (void)
 
       // If we need to allocate more pointers for the vissprites,
       // allocate as many as were allocated for sprites -- killough
-      // killough 9/22/98: allocate twice as many
 
-      if (num_vissprite_ptrs < num_vissprite*2)
+      if (num_vissprite_ptrs < num_vissprite)
       {
          free(vissprite_ptrs);  // better than realloc -- no preserving needed
-         vissprite_ptrs = malloc((num_vissprite_ptrs = num_vissprite_alloc*2)
-               * sizeof *vissprite_ptrs);
+         free(vissprite_keys);
+         num_vissprite_ptrs = num_vissprite_alloc;
+         vissprite_ptrs = malloc(num_vissprite_ptrs * sizeof *vissprite_ptrs);
+         // twice as many keys, the second half is the radix scratch
+         vissprite_keys = malloc(num_vissprite_ptrs * 2 * sizeof *vissprite_keys);
       }
 
+      // flipping the sign bit orders scale as unsigned, inverting
+      // the lot puts the largest (nearest) first
       while (--i>=0)
-         vissprite_ptrs[i] = vissprites+i;
+      {
+         vissprite_keys[i].key = ~((uint32_t)vissprites[i].scale ^ 0x80000000u);
+         vissprite_keys[i].index = i;
+      }
 
-      // killough 9/22/98: replace qsort with merge sort, since the keys
-      // are roughly in order to begin with, due to BSP rendering.
+      if (num_vissprite < RADIXSORT_MIN)
+         R_InsertionSortKeys(vissprite_keys, num_vissprite);
+      else
+         R_RadixSortKeys(vissprite_keys, vissprite_keys + num_vissprite_ptrs,
+               num_vissprite);
 
-      msort(vissprite_ptrs, vissprite_ptrs + num_vissprite, num_vissprite);
+      for (i = num_vissprite; --i>=0; )
+         vissprite_ptrs[i] = vissprites + vissprite_keys[i].index;
    }
 }
 
@@ -855,16 +1047,85 @@ void R_SortVisSprites (void)
 // R_DrawSprite
 //
 
+//
+// Drawseg column index
+//
+// For every band of SEGBANDWIDTH screen columns, a bit set of the drawsegs
+// that reach into it and could clip a sprite or hold a masked texture.
+// Bit j of a set stands for drawsegs[numindexedsegs-1-j], so walking the
+// bits upwards visits the drawsegs from last to first, the same order as
+// scanning the whole list.
+//
+
+#define SEGBANDBITS 5
+#define SEGBANDWIDTH (1 << SEGBANDBITS)
+#define NUMSEGBANDS ((MAX_SCREENWIDTH + SEGBANDWIDTH - 1) / SEGBANDWIDTH)
+
+static THREAD_LOCAL uint64_t *segbands;
+static THREAD_LOCAL int numsegbandwords, maxsegbandwords;
+static THREAD_LOCAL int numindexedsegs;
+
+static inline int R_LowestBit(uint64_t bits)
+{
+#if defined(__GNUC__)
+   return __builtin_ctzll(bits);
+#else
+   int n = 0;
+   while (!(bits & 1))
+   {
+      bits >>= 1;
+      n++;
+   }
+   return n;
+#endif
+}
+
+static void R_IndexDrawSegs(void)
+{
+   int i;
+
+   numindexedsegs = ds_p - drawsegs;
+   numsegbandwords = (numindexedsegs + 63) >> 6;
+
+   if (numsegbandwords > maxsegbandwords)
+   {
+      free(segbands);
+      maxsegbandwords = numsegbandwords * 2;
+      segbands = malloc(NUMSEGBANDS * maxsegbandwords * sizeof *segbands);
+   }
+
+   memset(segbands, 0, NUMSEGBANDS * numsegbandwords * sizeof *segbands);
+
+   for (i = 0; i < numindexedsegs; i++)
+   {
+      const drawseg_t *ds = &drawsegs[i];
+      int j = numindexedsegs - 1 - i;
+      uint64_t bit = (uint64_t)1 << (j & 63);
+      uint64_t *set;
+      int band, lastband;
+
+      if (!ds->silhouette && !ds->maskedtexturecol)
+         continue;
+
+      band = ds->x1 >> SEGBANDBITS;
+      lastband = ds->x2 >> SEGBANDBITS;
+      set = segbands + band * numsegbandwords + (j >> 6);
+      for (; band <= lastband; band++, set += numsegbandwords)
+         *set |= bit;
+   }
+}
+
 static void R_DrawSprite (vissprite_t* spr)
 {
    drawseg_t *ds;
-   int     clipbot[MAX_SCREENWIDTH]; // killough 2/8/98: // dropoff overflow
-   int     cliptop[MAX_SCREENWIDTH]; // change to MAX_*  // dropoff overflow
+   int16_t clipbot[MAX_SCREENWIDTH]; // killough 2/8/98:
+   int16_t cliptop[MAX_SCREENWIDTH]; // change to MAX_*
    int     x;
    int     r1;
    int     r2;
    fixed_t scale;
    fixed_t lowscale;
+   int     firstband, lastband, word;
 
    for (x = spr->x1 ; x<=spr->x2 ; x++)
       clipbot[x] = cliptop[x] = -2;
@@ -872,52 +1133,64 @@ static void R_DrawSprite (vissprite_t* spr)
    // Scan drawsegs from end to start for obscuring segs.
    // The first drawseg that has a greater scale is the clip seg.
 
-   // Modified by Lee Killough:
-   // (pointer check was originally nonportable
-   // and buggy, by going past LEFT end of array):
+   // Only the drawsegs indexed under the column bands the sprite covers
+   // are looked at, still from last to first.
 
-   //    for (ds=ds_p-1 ; ds >= drawsegs ; ds--)    old buggy code
+   firstband = spr->x1 >> SEGBANDBITS;
+   lastband = spr->x2 >> SEGBANDBITS;
 
-   for (ds=ds_p ; ds-- > drawsegs ; )  // new -- killough
-   {      // determine if the drawseg obscures the sprite
-      if (ds->x1 > spr->x2 || ds->x2 < spr->x1 ||
-            (!ds->silhouette && !ds->maskedtexturecol))
-         continue;      // does not cover sprite
+   for (word = 0; word < numsegbandwords; word++)
+   {
+      const uint64_t *set = segbands + firstband * numsegbandwords + word;
+      uint64_t bits = 0;
+      int band;
 
-      r1 = ds->x1 < spr->x1 ? spr->x1 : ds->x1;
-      r2 = ds->x2 > spr->x2 ? spr->x2 : ds->x2;
+      for (band = firstband; band <= lastband; band++, set += numsegbandwords)
+         bits |= *set;
 
-      if (ds->scale1 > ds->scale2)
+      for (; bits; bits &= bits - 1)
       {
-         lowscale = ds->scale2;
-         scale = ds->scale1;
-      }
-      else
-      {
-         lowscale = ds->scale1;
-         scale = ds->scale2;
-      }
+         ds = drawsegs + numindexedsegs - 1 - ((word << 6) + R_LowestBit(bits));
 
-      if (scale < spr->scale || (lowscale < spr->scale &&
-               !R_PointOnSegSide (spr->gx, spr->gy, ds->curline)))
-      {
-         if (ds->maskedtexturecol)       // masked mid texture?
-            R_RenderMaskedSegRange(ds, r1, r2);
-         continue;               // seg is behind sprite
-      }
+         // determine if the drawseg obscures the sprite
+         if (ds->x1 > spr->x2 || ds->x2 < spr->x1)
+            continue;      // does not cover sprite
+
+         r1 = ds->x1 < spr->x1 ? spr->x1 : ds->x1;
+         r2 = ds->x2 > spr->x2 ? spr->x2 : ds->x2;
+
+         if (ds->scale1 > ds->scale2)
+         {
+            lowscale = ds->scale2;
+            scale = ds->scale1;
+         }
+         else
+         {
+            lowscale = ds->scale1;
+            scale = ds->scale2;
+         }
+
+         if (scale < spr->scale || (lowscale < spr->scale &&
+                  !R_PointOnSegSide (spr->gx, spr->gy, ds->curline)))
+         {
+            if (ds->maskedtexturecol)       // masked mid texture?
+               R_RenderMaskedSegRange(ds, r1, r2);
+            continue;               // seg is behind sprite
+         }
 
-      // clip this piece of the sprite
-      // killough 3/27/98: optimized and made much shorter
+         // clip this piece of the sprite
+         // killough 3/27/98: optimized and made much shorter
 
-      if (ds->silhouette&SIL_BOTTOM && spr->gz < ds->bsilheight) //bottom sil
-         for (x=r1 ; x<=r2 ; x++)
-            if (clipbot[x] == -2)
-               clipbot[x] = ds->sprbottomclip[x];
+         if (ds->silhouette&SIL_BOTTOM && spr->gz < ds->bsilheight) //bottom sil
+            for (x=r1 ; x<=r2 ; x++)
+               if (clipbot[x] == -2)
+                  clipbot[x] = ds->sprbottomclip[x];
 
-      if (ds->silhouette&SIL_TOP && spr->gzt > ds->tsilheight)   // top sil
-         for (x=r1 ; x<=r2 ; x++)
-            if (cliptop[x] == -2)
-               cliptop[x] = ds->sprtopclip[x];
+         if (ds->silhouette&SIL_TOP && spr->gzt > ds->tsilheight)   // top sil
+            for (x=r1 ; x<=r2 ; x++)
+               if (cliptop[x] == -2)
+                  cliptop[x] = ds->sprtopclip[x];
+      }
    }
 
    // killough 3/27/98:
@@ -979,6 +1252,126 @@ static void R_DrawSprite (vissprite_t* spr)
    R_DrawVisSprite (spr, spr->x1, spr->x2);
 }
 
+//
+// Masked pass in column bands
+//
+// Each band draws the whole sorted sprite list and the masked mid
+// textures clipped to its own columns, so every column still gets its
+// draws in the same order. Bands are a multiple of 4 columns wide, like
+// the render slices, so no quad of the column buffer is shared. Only done
+// when drawing at once: a recorded view would have its walls drawn over
+// the sprites later.
+//
+
+// Config: draw the masked pass on the job threads
+int render_parallel_masked;
+
+typedef struct {
+   int x1, x2;
+   vissprite_t **sprites;
+   int numsprites;
+   drawseg_t *drawsegs, *ds_end;
+   uint64_t *segbands;
+   int numsegbandwords, numindexedsegs;
+   dbool psprites;
+} maskedband_t;
+
+static void R_DrawMaskedBand(void *arg)
+{
+   const maskedband_t *band = arg;
+   // the running thread's own, should it be a renderer thread helping out
+   drawseg_t *olddrawsegs = drawsegs, *oldds_p = ds_p;
+   uint64_t *oldsegbands = segbands;
+   int oldsegbandwords = numsegbandwords, oldindexedsegs = numindexedsegs;
+   int oldslicex1 = slicex1, oldslicex2 = slicex2;
+   drawseg_t *ds;
+   int i;
+
+   drawsegs = band->drawsegs;
+   ds_p = band->ds_end;
+   segbands = band->segbands;
+   numsegbandwords = band->numsegbandwords;
+   numindexedsegs = band->numindexedsegs;
+
+   for (i = band->numsprites; --i >= 0; )
+   {
+      vissprite_t spr = *band->sprites[i];
+
+      if (spr.x1 > band->x2 || spr.x2 < band->x1)
+         continue;
+      if (spr.x1 < band->x1)
+      {
+         spr.startfrac += spr.xiscale * (band->x1 - spr.x1);
+         spr.x1 = band->x1;
+      }
+      if (spr.x2 > band->x2)
+         spr.x2 = band->x2;
+      R_DrawSprite(&spr);
+   }
+
+   for (ds = ds_p; ds-- > drawsegs; )
+      if (ds->maskedtexturecol && ds->x1 <= band->x2 && ds->x2 >= band->x1)
+         R_RenderMaskedSegRange(ds, ds->x1 < band->x1 ? band->x1 : ds->x1,
+                                ds->x2 > band->x2 ? band->x2 : ds->x2);
+
+   if (band->psprites)
+   {
+      slicex1 = band->x1;
+      slicex2 = band->x2;
+      R_DrawPlayerSprites();
+   }
+
+   R_QueueResetColumnBuffer();
+
+   drawsegs = olddrawsegs;
+   ds_p = oldds_p;
+   segbands = oldsegbands;
+   numsegbandwords = oldsegbandwords;
+   numindexedsegs = oldindexedsegs;
+   slicex1 = oldslicex1;
+   slicex2 = oldslicex2;
+}
+
+static dbool R_DrawMaskedParallel(void)
+{
+   maskedband_t bands[MAX_JOB_THREADS];
+   int numbands = I_JobThreads();
+   int width = ((slicex2 - slicex1 + numbands) / numbands + 3) & ~3;
+   i_jobgroup_t group;
+   int i;
+
+   if (!render_parallel_masked || numbands <= 1 || R_DrawListRecording() ||
+       width * 2 > slicex2 - slicex1 + 1)
+      return false;
+
+   // nothing of this thread's may be left to land on top of the sprites
+   R_QueueResetColumnBuffer();
+
+   I_JobGroupInit(&group);
+   for (i = 0; i < numbands; i++)
+   {
+      maskedband_t *band = &bands[i];
+
+      band->x1 = slicex1 + i * width;
+      band->x2 = i == numbands - 1 ? slicex2 : band->x1 + width - 1;
+      if (band->x2 > slicex2)
+         band->x2 = slicex2;
+      if (band->x1 > band->x2)
+         break;
+      band->sprites = vissprite_ptrs;
+      band->numsprites = (int)num_vissprite;
+      band->drawsegs = drawsegs;
+      band->ds_end = ds_p;
+      band->segbands = segbands;
+      band->numsegbandwords = numsegbandwords;
+      band->numindexedsegs = numindexedsegs;
+      band->psprites = !viewangleoffset && !viewpitchoffset;
+      I_JobRun(&group, R_DrawMaskedBand, band);
+   }
+   I_JobWait(&group);
+   return true;
+}
+
 //
 // R_DrawMasked
 //
@@ -989,6 +1382,13 @@ void R_DrawMasked(void)
    drawseg_t *ds;
 
    R_SortVisSprites();
+   R_ProfileCount(RPC_VISSPRITES, num_vissprite);
+
+   if (num_vissprite)
+      R_IndexDrawSegs();
+
+   if (R_DrawMaskedParallel())
+      return;
 
    // draw all vissprites back to front
 
@@ -1010,5 +1410,9 @@ void R_DrawMasked(void)
    // draw the psprites on top of everything
    //  but does not draw on side views
    if (!viewangleoffset && !viewpitchoffset)
+   {
+      R_ProfileStart(RPS_PSPRITES);
       R_DrawPlayerSprites ();
+      R_ProfileStop(RPS_PSPRITES);
+   }
 }
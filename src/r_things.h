@@ -35,29 +35,39 @@
 #define __R_THINGS__
 
 #include "r_draw.h"
+#include "i_thread.h"
 
 /* Constant arrays used for psprite clipping and initializing clipping. */
 
-extern int negonearray[MAX_SCREENWIDTH];       /* killough 2/8/98: */ // dropoff overflow
-extern int screenheightarray[MAX_SCREENWIDTH]; /* change to MAX_*  */ // dropoff overflow
+extern int16_t negonearray[MAX_SCREENWIDTH];       /* killough 2/8/98: */
+extern int16_t screenheightarray[MAX_SCREENWIDTH]; /* change to MAX_*  */
 
 /* Vars for R_DrawMaskedColumn */
 
-extern int     *mfloorclip;    // dropoff overflow
-extern int     *mceilingclip;  // dropoff overflow
-extern fixed_t spryscale;
-extern fixed_t sprtopscreen;
+extern THREAD_LOCAL int16_t *mfloorclip;
+extern THREAD_LOCAL int16_t *mceilingclip;
+extern THREAD_LOCAL fixed_t spryscale;
+extern THREAD_LOCAL fixed_t sprtopscreen;
 extern fixed_t pspritescale;
 extern fixed_t pspriteiscale;
 /* proff 11/06/98: Added for high-res */
 extern fixed_t pspriteyscale;
 
+/* Config: draw the masked pass on the job threads (see i_jobs.h) */
+extern int render_parallel_masked;
+
 void R_DrawMaskedColumn(const rpatch_t *patch,
                         R_DrawColumn_f colfunc,
                         draw_column_vars_t *dcvars,
                         const rcolumn_t *column,
                         const rcolumn_t *prevcolumn,
                         const rcolumn_t *nextcolumn);
+void R_DrawMaskedPost(R_DrawColumn_f colfunc,
+                      draw_column_vars_t *dcvars,
+                      const rcolumn_t *column,
+                      const rcolumn_t *prevcolumn,
+                      const rcolumn_t *nextcolumn,
+                      const rpost_t *post);
 void R_SortVisSprites(void);
 void R_AddSprites(subsector_t* subsec, int lightlevel);
 void R_DrawPlayerSprites(void);
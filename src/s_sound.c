@@ -72,6 +72,11 @@ typedef struct
   void *origin;        // origin of sound
   int handle;          // handle of the sound being played
   int is_pickup;       // killough 4/25/98: whether sound is a player's weapon
+  // what the last parameter update was worked out from (listener NULL if none)
+  mobj_t *listener;
+  fixed_t listenx, listeny, originx, originy;
+  angle_t listenangle;
+  int basevolume;
 } channel_t;
 
 // the set of channels available
@@ -210,7 +215,7 @@ static void S_StartSoundAtVolume(degenmobj_t *origin, int sfx_id, int volume)
   sfxinfo_t *sfx;
 
   //jff 1/22/98 return if sound is not enabled
-  if (nosfxparm)
+  if (nosfxparm || fastforwarding)
     return;
 
   is_pickup = sfx_id & PICKUP_SOUND || sfx_id == sfx_oof || (compatibility_level >= prboom_2_compatibility && sfx_id == sfx_noway); // killough 4/25/98
@@ -398,7 +403,28 @@ void S_UpdateSounds(void* listener_p)
               // check non-local sounds for distance clipping
               // or modify their params
               if (c->origin && listener_p != c->origin) { // killough 3/20/98
-                if (!S_AdjustSoundParams(listener, c->origin,
+                degenmobj_t *origin = c->origin;
+
+                // nothing has moved or turned since the last update
+                if (listener && c->listener == listener &&
+                    c->listenx == listener->x && c->listeny == listener->y &&
+                    c->listenangle == listener->angle &&
+                    c->originx == origin->x && c->originy == origin->y &&
+                    c->basevolume == volume)
+                  continue;
+
+                c->listener = listener;
+                if (listener)
+                {
+                  c->listenx = listener->x;
+                  c->listeny = listener->y;
+                  c->listenangle = listener->angle;
+                }
+                c->originx = origin->x;
+                c->originy = origin->y;
+                c->basevolume = volume;
+
+                if (!S_AdjustSoundParams(listener, origin,
                                          &volume, &sep, &pitch))
                   S_StopChannel(cnum);
                 else
@@ -737,5 +763,6 @@ static int S_getChannel(void *origin, sfxinfo_t *sfxinfo, int is_pickup)
   c->sfxinfo = sfxinfo;
   c->origin = origin;
   c->is_pickup = is_pickup;         // killough 4/25/98
+  c->listener = NULL;               // params not updated yet
   return cnum;
 }
@@ -113,6 +113,7 @@ static void STlib_drawNum
   // isn't refreshing.
   if(n->oldnum == num && !refresh)
     return;
+  V_MarkRect(n->x - numdigits*w, n->y, numdigits*w, h);
 
   // CPhipps - compact some code, use num instead of *n->num
   if ((neg = (n->oldnum = num) < 0))
@@ -221,6 +222,8 @@ void STlib_updatePercent
   int refresh )
 {
   if (*per->n.on && (refresh || (per->n.oldnum != *per->n.num))) {
+    V_MarkRect(per->n.x - per->p->leftoffset, per->n.y - per->p->topoffset,
+               per->p->width, per->p->height);
     // killough 2/21/98: fix percents not updated;
     /* CPhipps - make %'s only be updated if number changed */
     // CPhipps - patch drawing updated
@@ -287,9 +290,15 @@ void STlib_updateMultIcon
       h = mi->p[mi->oldinum].height;
 
       V_CopyRect(x, y-ST_Y, BG, w, h, x, y, FG, VPT_STRETCH);
+      V_MarkRect(x, y, w, h);
     }
     if (*mi->inum != -1)  // killough 2/16/98: redraw only if != -1
-      V_DrawNumPatch(mi->x, mi->y, FG, mi->p[*mi->inum].lumpnum, CR_DEFAULT, VPT_STRETCH);
+    {
+      const patchnum_t *p = &mi->p[*mi->inum];
+
+      V_DrawNumPatch(mi->x, mi->y, FG, p->lumpnum, CR_DEFAULT, VPT_STRETCH);
+      V_MarkRect(mi->x - p->leftoffset, mi->y - p->topoffset, p->width, p->height);
+    }
     mi->oldinum = *mi->inum;
   }
 }
@@ -348,6 +357,7 @@ void STlib_updateBinIcon
     y = bi->y - bi->p->topoffset;
     w = bi->p->width;
     h = bi->p->height;
+    V_MarkRect(x, y, w, h);
 
     if (*bi->val)
       V_DrawNumPatch(bi->x, bi->y, FG, bi->p->lumpnum, CR_DEFAULT, VPT_STRETCH);
@@ -390,6 +390,8 @@ static void ST_refreshBackground(void)
 {
   int y=0;
 
+  V_MarkRect(0, ST_Y, 320, ST_HEIGHT);
+
   if (st_statusbaron)
     {
       // proff 05/17/2000: draw to the frontbuffer in OpenGL
@@ -48,11 +48,32 @@
 // Each screen is [SCREENWIDTH*SCREENHEIGHT];
 screeninfo_t screens[NUM_SCREENS];
 
+// Screen holding the last V_DrawNumBackground picture, already scaled and
+// in screen colours; the lump is -1 when it has to be drawn again
+#define BGCACHE_SCR 1
+static int bgcachelump = -1;
+static const pixel_t *bgcachepalette;
+
 
 // array of pointers to color translation tables
 const uint8_t *colrngs[CR_LIMIT];
 
 int usegamma;
+dbool screen_dirty = TRUE;
+int dirtybox[4] = { INT_MIN, INT_MAX, INT_MAX, INT_MIN };
+
+void V_MarkRect(int x, int y, int width, int height)
+{
+  int x1 = MAX(x * SCREENWIDTH / 320, 0);
+  int y1 = MAX(y * SCREENHEIGHT / 200, 0);
+  int x2 = MIN(((x + width) * SCREENWIDTH + 319) / 320, SCREENWIDTH) - 1;
+  int y2 = MIN(((y + height) * SCREENHEIGHT + 199) / 200, SCREENHEIGHT) - 1;
+
+  if (x1 > x2 || y1 > y2)
+    return;
+  M_AddToBox(dirtybox, x1, y1);
+  M_AddToBox(dirtybox, x2, y2);
+}
 
 /*
  * V_InitColorTranslation
@@ -267,6 +288,13 @@ void V_CopyRect(int srcx, int srcy, int srcscrn, int width,
   src = screens[srcscrn].data + SURFACE_BYTE_PITCH * srcy + srcx * SURFACE_PIXEL_DEPTH;
   dest = screens[destscrn].data + SURFACE_BYTE_PITCH * desty + destx * SURFACE_PIXEL_DEPTH;
 
+  // whole rows are contiguous, so the block goes in one copy
+  if (width * SURFACE_PIXEL_DEPTH == SURFACE_BYTE_PITCH && height > 0)
+  {
+    memcpy (dest, src, height * SURFACE_BYTE_PITCH);
+    return;
+  }
+
   for ( ; height>0 ; height--)
     {
       memcpy (dest, src, width * SURFACE_PIXEL_DEPTH);
@@ -311,20 +339,32 @@ void V_DrawBackground(const char* flatname, int scrn)
   int         x,y;
   int         lump;
   const int   w = (64*SCREENWIDTH/320), h = (64*SCREENHEIGHT/200);
+  pixel_t    *dest = (pixel_t *)screens[scrn].data;
 
   // killough 4/17/98:
   const uint8_t *src = W_CacheLumpNum(lump = firstflat + R_FlatNumForName(flatname));
 
   /* V_DrawBlock(0, 0, scrn, 64, 64, src, 0); */
 
-  V_DRAWFLAT(scrn, int16_t, GETCOL16);
+  V_DRAWFLAT(scrn, pixel_t, GETCOL16);
 
   /* end V_DrawBlock */
 
-  for (y=0 ; y<SCREENHEIGHT ; y+=h)
-    for (x=y ? 0 : w; x<SCREENWIDTH ; x+=w)
-      V_CopyRect(0, 0, scrn, ((SCREENWIDTH-x) < w) ? (SCREENWIDTH-x) : w,
-     ((SCREENHEIGHT-y) < h) ? (SCREENHEIGHT-y) : h, x, y, scrn, VPT_NONE);
+  // Widen each row of the tile across the screen, doubling the copy each
+  // time, then fill the rest of the screen a whole row at a time from the
+  // row one tile above
+  for (y=0 ; y<h ; y++)
+  {
+    pixel_t *row = dest + y * SURFACE_SHORT_PITCH;
+
+    for (x=w ; x<SCREENWIDTH ; x+=x)
+      memcpy(row + x, row,
+          ((SCREENWIDTH-x) < x ? (SCREENWIDTH-x) : x) * sizeof(*row));
+  }
+
+  for ( ; y<SCREENHEIGHT ; y++)
+    memcpy(dest + y * SURFACE_SHORT_PITCH, dest + (y - h) * SURFACE_SHORT_PITCH,
+        SCREENWIDTH * sizeof(*dest));
   W_UnlockLumpNum(lump);
 }
 
@@ -395,8 +435,10 @@ static void V_DrawMemPatch(int x, int y, int scrn, const rpatch_t *patch,
 
    R_SetDefaultDrawColumnVars(&dcvars);
 
-   drawvars.short_topleft = (uint16_t*)screens[scrn].data;
-   drawvars.int_topleft   = (uint32_t*)screens[scrn].data;
+   drawvars.short_topleft  = (pixel_t*)screens[scrn].data;
+   drawvars.int_topleft    = (uint32_t*)screens[scrn].data;
+   drawvars.short_pitch    = SURFACE_SHORT_PITCH;
+   drawvars.short_colpitch = 1;
 
    if (!(flags & VPT_STRETCH))
    {
@@ -498,6 +540,261 @@ static void V_DrawMemPatch(int x, int y, int scrn, const rpatch_t *patch,
    drawvars = olddrawvars;
 }
 
+//
+// Pre-scaled patches
+//
+// With the point sampled patch drawer, a stretched patch comes out the same
+// every time it is drawn at the same fraction of an output pixel. The HUD,
+// status bar, menus and message fonts draw the same few dozen every frame,
+// so the first draw of each records the palette indices V_DrawMemPatch
+// would have left as runs of opaque pixels per output row, and later draws
+// copy them out through the current palette. At whole multiples of 320x200
+// every position has the same fraction; other sizes keep one entry per
+// fraction in use, which for a line of text is a handful. The cache is
+// flushed when the output size changes, when it grows past
+// SCALEDPATCH_MEMORY, and by D_DoomDeinit before the wads (whose lump
+// numbers key it) and translation tables go.
+//
+
+#ifndef SCALEDPATCH_MEMORY
+#define SCALEDPATCH_MEMORY (16*1024*1024)
+#endif
+#define SCALEDPATCH_HASH 256
+
+typedef struct {
+  short x, length; // output columns from the patch's left edge
+  int ofs;         // first index into pixels
+} scaledspan_t;
+
+typedef struct scaledpatch_s {
+  struct scaledpatch_s *next;
+  int lump;
+  const uint8_t *trans; // NULL unless translated
+  int flip;
+  int leftoffset, topoffset;
+  int xphase, yphase;   // fraction of an output pixel the left/top edge is at
+  int width, height;    // in output pixels
+  int *rows;            // height+1 indices into spans
+  scaledspan_t *spans;
+  uint8_t *pixels;
+} scaledpatch_t;
+
+static scaledpatch_t *scaledpatches[SCALEDPATCH_HASH];
+static size_t scaledpatchmemory;
+static int scaledpatchwidth, scaledpatchheight;
+
+void V_FlushScaledPatches(void)
+{
+  int i;
+
+  for (i = 0; i < SCALEDPATCH_HASH; i++)
+    while (scaledpatches[i])
+    {
+      scaledpatch_t *sp = scaledpatches[i];
+
+      scaledpatches[i] = sp->next;
+      free(sp);
+    }
+  scaledpatchmemory = 0;
+  scaledpatchwidth = SCREENWIDTH;
+  scaledpatchheight = SCREENHEIGHT;
+}
+
+// The pre-scaling only reproduces the plain point sampled drawer
+static dbool V_CanPreScalePatches(void)
+{
+  return drawvars.filterpatch == RDRAW_FILTER_POINT &&
+    drawvars.patch_edges != RDRAW_MASKEDCOLUMNEDGE_SLOPED;
+}
+
+// Walks the patch's columns and posts exactly as V_DrawMemPatch does with
+// VPT_STRETCH set, nothing clipped away, and keeps the result
+static scaledpatch_t *V_BuildScaledPatch(const rpatch_t *patch, int lump,
+        const uint8_t *trans, int flip, int xphase, int yphase)
+{
+  const int DX = (SCREENWIDTH<<16) / 320, DXI = (320<<16) / SCREENWIDTH;
+  const int DY = (SCREENHEIGHT<<16) / 200, DYI = (200<<16) / SCREENHEIGHT;
+  const int w = (patch->width << 16) - 1;
+  const fixed_t heightmask = patch->height << 16;
+  const int width = (xphase + patch->width * DX) >> 16;
+  const int height = (yphase + patch->height * DY) >> 16;
+  uint8_t *image = malloc(width * height * 2);
+  uint8_t *opaque = image + width * height;
+  int numspans = 0, numpixels = 0;
+  int x, r, col = 0;
+  scaledpatch_t *sp;
+  int *rows;
+  scaledspan_t *spans;
+  uint8_t *pixels;
+
+  memset(opaque, 0, width * height);
+
+  for (x = 0; x < width; x++, col += DXI)
+  {
+    const rcolumn_t *column = R_GetPatchColumn(patch, flip ? (w - col)>>16 : col>>16);
+    int i;
+
+    for (i = 0; i < column->numPosts; i++)
+    {
+      const rpost_t *post = &column->posts[i];
+      const uint8_t *source = column->pixels + post->topdelta;
+      int yl = (yphase + post->topdelta * DY) >> 16;
+      int yh = (yphase + (post->topdelta + post->length) * DY - (FRACUNIT>>1)) >> 16;
+      fixed_t frac = 0;
+
+      if (yh >= height)
+        yh = height - 1;
+      for (r = yl; r <= yh; r++)
+      {
+        uint8_t c = source[frac>>16];
+
+        image[r * width + x] = trans ? trans[c] : c;
+        opaque[r * width + x] = 1;
+        if ((frac += DYI) >= heightmask)
+          frac -= heightmask;
+      }
+    }
+  }
+
+  // count the runs so the entry can be one allocation
+  for (r = 0; r < height; r++)
+    for (x = 0; x < width; x++)
+      if (opaque[r * width + x])
+      {
+        numpixels++;
+        if (!x || !opaque[r * width + x - 1])
+          numspans++;
+      }
+
+  sp = malloc(sizeof(*sp) + (height + 1) * sizeof(*rows) +
+              numspans * sizeof(*spans) + numpixels);
+  rows = (int *)(sp + 1);
+  spans = (scaledspan_t *)(rows + height + 1);
+  pixels = (uint8_t *)(spans + numspans);
+
+  sp->lump = lump;
+  sp->trans = trans;
+  sp->flip = flip;
+  sp->leftoffset = patch->leftoffset;
+  sp->topoffset = patch->topoffset;
+  sp->xphase = xphase;
+  sp->yphase = yphase;
+  sp->width = width;
+  sp->height = height;
+  sp->rows = rows;
+  sp->spans = spans;
+  sp->pixels = pixels;
+
+  numspans = numpixels = 0;
+  for (r = 0; r < height; r++)
+  {
+    rows[r] = numspans;
+    for (x = 0; x < width; x++)
+      if (opaque[r * width + x])
+      {
+        if (!x || !opaque[r * width + x - 1])
+        {
+          spans[numspans].x = x;
+          spans[numspans].length = 0;
+          spans[numspans++].ofs = numpixels;
+        }
+        spans[numspans-1].length++;
+        pixels[numpixels++] = image[r * width + x];
+      }
+  }
+  rows[height] = numspans;
+
+  free(image);
+
+  scaledpatchmemory += sizeof(*sp) + (height + 1) * sizeof(*rows) +
+    numspans * sizeof(*spans) + numpixels;
+  return sp;
+}
+
+static void V_DrawScaledPatch(int x, int y, int scrn, const scaledpatch_t *sp)
+{
+  const int left = ((x - sp->leftoffset) * ((SCREENWIDTH<<16) / 320)) >> 16;
+  const int top = ((y - sp->topoffset) * ((SCREENHEIGHT<<16) / 200)) >> 16;
+  pixel_t *topleft = (pixel_t*)screens[scrn].data;
+  int r;
+
+  for (r = 0; r < sp->height && top + r < SCREENHEIGHT; r++)
+  {
+    pixel_t *dest = topleft + (top + r) * SURFACE_SHORT_PITCH + left;
+    const scaledspan_t *span = &sp->spans[sp->rows[r]];
+    const scaledspan_t *end = &sp->spans[sp->rows[r+1]];
+
+    for (; span < end; span++)
+    {
+      int x1 = span->x, x2 = span->x + span->length;
+      const uint8_t *source = sp->pixels + span->ofs;
+
+      if (left + x1 < 0)
+      {
+        source += -left - x1;
+        x1 = -left;
+      }
+      if (left + x2 > SCREENWIDTH)
+        x2 = SCREENWIDTH - left;
+      for (; x1 < x2; x1++)
+        dest[x1] = VID_PAL16(*source++, VID_COLORWEIGHTMASK);
+    }
+  }
+}
+
+// Draws the lump from the cache if it can, building the entry on first use
+static dbool V_DrawPreScaledPatch(int x, int y, int scrn, int lump,
+        int cm, enum patch_translation_e flags)
+{
+  const uint8_t *trans = NULL;
+  const int flip = (flags & VPT_FLIP) != 0;
+  const int DX = (SCREENWIDTH<<16) / 320, DY = (SCREENHEIGHT<<16) / 200;
+  scaledpatch_t **bucket = &scaledpatches[lump & (SCALEDPATCH_HASH-1)];
+  scaledpatch_t *sp;
+
+  if (!(flags & VPT_STRETCH) || (SCREENWIDTH==320 && SCREENHEIGHT==200) ||
+      !V_CanPreScalePatches())
+    return FALSE;
+
+  if (flags & VPT_TRANS)
+    trans = cm < CR_LIMIT ? colrngs[cm] : translationtables + 256*((cm-CR_LIMIT)-1);
+
+  if (scaledpatchwidth != SCREENWIDTH || scaledpatchheight != SCREENHEIGHT)
+    V_FlushScaledPatches();
+
+  for (sp = *bucket; sp; sp = sp->next)
+    if (sp->lump == lump && sp->trans == trans && sp->flip == flip &&
+        sp->xphase == (((x - sp->leftoffset) * DX) & 0xffff) &&
+        sp->yphase == (((y - sp->topoffset) * DY) & 0xffff))
+      break;
+
+  if (!sp)
+  {
+    const rpatch_t *patch = R_CachePatchNum(lump);
+
+    // V_DrawMemPatch shifts the source rather than cropping when clipped at
+    // the top, so leave those to it
+    if (y - patch->topoffset < 0)
+    {
+      R_UnlockPatchNum(lump);
+      return FALSE;
+    }
+    if (scaledpatchmemory > SCALEDPATCH_MEMORY)
+      V_FlushScaledPatches();
+    sp = V_BuildScaledPatch(patch, lump, trans, flip,
+        ((x - patch->leftoffset) * DX) & 0xffff,
+        ((y - patch->topoffset) * DY) & 0xffff);
+    sp->next = *bucket;
+    *bucket = sp;
+    R_UnlockPatchNum(lump);
+  }
+  else if (y - sp->topoffset < 0)
+    return FALSE;
+
+  V_DrawScaledPatch(x, y, scrn, sp);
+  return TRUE;
+}
+
 // CPhipps - some simple, useful wrappers for that function, for drawing patches from wads
 
 // CPhipps - GNU C only suppresses generating a copy of a function if it is
@@ -513,14 +810,235 @@ void V_DrawNumPatch(int x, int y, int scrn, int lump,
     return;
   }
     
+  if (V_DrawPreScaledPatch(x, y, scrn, lump, cm, flags))
+    return;
+
   V_DrawMemPatch(x, y, scrn, R_CachePatchNum(lump), cm, flags);
   R_UnlockPatchNum(lump);
 }
 
-uint16_t *V_Palette16 = NULL;
-static uint16_t *Palettes16 = NULL;
+//
+// V_DrawNumBackground
+//
+// Draws a full screen picture to screen 0 the way V_DrawNumPatch does with
+// VPT_STRETCH. The scaled picture is kept in BGCACHE_SCR, so while the same
+// one stays up each frame is a single copy.
+//
+void V_DrawNumBackground(int lump)
+{
+  const screeninfo_t *cache = &screens[BGCACHE_SCR];
+
+  if (!cache->data || cache->height < SCREENHEIGHT || lump < 0)
+  {
+    V_DrawNumPatch(0, 0, 0, lump, CR_DEFAULT, VPT_STRETCH);
+    return;
+  }
+
+  if (lump != bgcachelump || V_Palette16 != bgcachepalette)
+  {
+    memset(cache->data, 0, SURFACE_BYTE_PITCH * SCREENHEIGHT);
+    V_DrawNumPatch(0, 0, BGCACHE_SCR, lump, CR_DEFAULT, VPT_STRETCH);
+    bgcachelump = lump;
+    bgcachepalette = V_Palette16;
+  }
+
+  memcpy(screens[0].data, cache->data, SURFACE_BYTE_PITCH * SCREENHEIGHT);
+}
+
+pixel_t *V_Palette16 = NULL;
+static pixel_t *Palettes16 = NULL;
 static int currentPaletteIndex = 0;
 
+// Fused colormap tables. For every palette and colormap lump there is a
+// table of VID_PAL16(cm[c], VID_COLORWEIGHTMASK) for each entry c of the
+// lump, so the point sampled drawers do one dependent load per pixel
+// instead of two. A palette's tables are built the first time it is
+// selected, and V_Colormaps16 points at the current palette's set.
+//
+// Alongside, for translated sprites (player colours, and monsters given
+// MF_TRANSLATION by DEHACKED), each colormap lump is fused again with
+// each of the MAXTRANS player translations. Built with the palette's
+// plain tables, or when the translations change, and dropped with them.
+static pixel_t **Colormaps16 = NULL;     // [numPals][numcolormaps]
+static pixel_t **TransColormaps16 = NULL; // [numPals][numcolormaps][MAXTRANS]
+static int *Colormaps16Length = NULL;     // entries in each colormap lump
+static int Colormaps16Pals, Colormaps16Maps;
+static pixel_t **V_Colormaps16 = NULL;
+static pixel_t **V_TransColormaps16 = NULL;
+
+static void V_DestroyColormaps16(void)
+{
+  int i;
+
+  if (Colormaps16)
+  {
+    for (i = 0; i < Colormaps16Pals * Colormaps16Maps; i++)
+      free(Colormaps16[i]);
+    free(Colormaps16);
+  }
+  if (TransColormaps16)
+  {
+    for (i = 0; i < Colormaps16Pals * Colormaps16Maps * MAXTRANS; i++)
+      free(TransColormaps16[i]);
+    free(TransColormaps16);
+  }
+  free(Colormaps16Length);
+  Colormaps16 = NULL;
+  TransColormaps16 = NULL;
+  Colormaps16Length = NULL;
+  Colormaps16Pals = Colormaps16Maps = 0;
+  V_Colormaps16 = NULL;
+  V_TransColormaps16 = NULL;
+}
+
+//
+// V_BuildTransColormaps16
+//
+// Fuses the current palette's colormap tables with the player
+// translations, if they have not been since either last changed.
+//
+static void V_BuildTransColormaps16(void)
+{
+  pixel_t **tables;
+  int i, t, c;
+
+  if (!V_Colormaps16 || !translationtables)
+    return;
+
+  tables = TransColormaps16 + currentPaletteIndex * Colormaps16Maps * MAXTRANS;
+  if (!tables[0])
+    for (i = 0; i < Colormaps16Maps; i++)
+      for (t = 0; t < MAXTRANS; t++)
+      {
+        const uint8_t *translation = translationtables + 256*t;
+        const pixel_t *plain = V_Colormaps16[i];
+        pixel_t *fused = malloc(MAX(1, Colormaps16Length[i]) * sizeof(pixel_t));
+
+        for (c = 0; c < (Colormaps16Length[i] & ~255); c++)
+          fused[c] = plain[(c & ~255) + translation[c & 255]];
+        for (; c < Colormaps16Length[i]; c++)
+          fused[c] = plain[c];  // a partial map at the end is never drawn with
+        tables[i*MAXTRANS + t] = fused;
+      }
+
+  V_TransColormaps16 = tables;
+}
+
+void V_TranslationsChanged(void)
+{
+  int i;
+
+  if (!TransColormaps16)
+    return;
+  for (i = 0; i < Colormaps16Pals * Colormaps16Maps * MAXTRANS; i++)
+  {
+    free(TransColormaps16[i]);
+    TransColormaps16[i] = NULL;
+  }
+  V_TransColormaps16 = NULL;
+  V_BuildTransColormaps16();
+}
+
+//
+// V_UpdateColormaps16
+//
+// Points V_Colormaps16 at the fused tables for the current palette,
+// building them if this palette has not been used since the colormaps
+// or gamma last changed. Does nothing before R_InitColormaps.
+//
+static void V_UpdateColormaps16(int numPals)
+{
+  pixel_t **tables;
+  int i, c;
+
+  if (!colormaps || numcolormaps <= 0)
+    return;
+
+  if (Colormaps16Pals != numPals || Colormaps16Maps != numcolormaps)
+  {
+    V_DestroyColormaps16();
+    Colormaps16 = calloc(numPals * numcolormaps, sizeof(*Colormaps16));
+    TransColormaps16 = calloc(numPals * numcolormaps * MAXTRANS, sizeof(*TransColormaps16));
+    Colormaps16Length = malloc(numcolormaps * sizeof(*Colormaps16Length));
+    Colormaps16Pals = numPals;
+    Colormaps16Maps = numcolormaps;
+
+    // killough 4/4/98: colormap 0 is always COLORMAP, the rest sit
+    // between C_START and C_END
+    for (i = 0; i < numcolormaps; i++)
+    {
+      int lump = !i ? W_GetNumForName("COLORMAP") :
+        firstcolormaplump >= 0 ? i + firstcolormaplump : -1;
+      Colormaps16Length[i] = lump >= 0 ? W_LumpLength(lump) : 0;
+    }
+  }
+
+  tables = Colormaps16 + currentPaletteIndex * numcolormaps;
+  if (!tables[0])
+    for (i = 0; i < numcolormaps; i++)
+    {
+      tables[i] = malloc(MAX(1, Colormaps16Length[i]) * sizeof(pixel_t));
+      for (c = 0; c < Colormaps16Length[i]; c++)
+        tables[i][c] = VID_PAL16(colormaps[i][c], VID_COLORWEIGHTMASK);
+    }
+
+  V_Colormaps16 = tables;
+  V_BuildTransColormaps16();
+}
+
+//
+// V_Colormap16
+//
+// Returns the fused table matching a colormap pointer, as handed to the
+// drawers in dcvars/dsvars. Colormaps always point into one of the
+// colormap lumps; anything else falls back to the default colormap.
+//
+const pixel_t *V_Colormap16(const lighttable_t *colormap)
+{
+  int i;
+
+  for (i = 0; i < Colormaps16Maps; i++)
+    if (colormap >= colormaps[i] && colormap < colormaps[i] + Colormaps16Length[i])
+      return V_Colormaps16[i] + (colormap - colormaps[i]);
+  return V_Colormaps16[0];
+}
+
+//
+// V_TranslatedColormap16
+//
+// The fused table for a colormap and translation, as handed to the
+// translated column drawers. The player translations with a light level
+// of a colormap lump come from V_TransColormaps16.
+//
+const pixel_t *V_TranslatedColormap16(const lighttable_t *colormap,
+                                      const uint8_t *translation, pixel_t *scratch)
+{
+  const pixel_t *plain;
+  int i, c;
+
+  if (V_TransColormaps16 && translation >= translationtables &&
+      translation < translationtables + 256*MAXTRANS &&
+      !((translation - translationtables) & 255))
+  {
+    int t = (int)(translation - translationtables) >> 8;
+
+    for (i = 0; i < Colormaps16Maps; i++)
+      if (colormap >= colormaps[i] && colormap < colormaps[i] + Colormaps16Length[i])
+      {
+        int offset = (int)(colormap - colormaps[i]);
+
+        if (!(offset & 255) && offset + 256 <= Colormaps16Length[i])
+          return V_TransColormaps16[i*MAXTRANS + t] + offset;
+        break;
+      }
+  }
+
+  plain = V_Colormap16(colormap);
+  for (c = 0; c < 256; c++)
+    scratch[c] = plain[translation[c]];
+  return scratch;
+}
+
 #define DONT_ROUND_ABOVE 220
 //
 // V_UpdateTrueColorPalette
@@ -543,13 +1061,15 @@ void V_UpdateTrueColorPalette(void) {
   if (usegammaOnLastPaletteGeneration != usegamma) {
     if (Palettes16) free(Palettes16);
     Palettes16 = NULL;
+    bgcachelump = -1;
+    V_DestroyColormaps16();
     usegammaOnLastPaletteGeneration = usegamma;      
   }
   
   if (!Palettes16)
   {
-     // set short palette
-     Palettes16 = malloc(numPals*256*sizeof(uint16_t)*VID_NUMCOLORWEIGHTS);
+     // set true colour palette
+     Palettes16 = malloc(numPals*256*sizeof(pixel_t)*VID_NUMCOLORWEIGHTS);
      for (p=0; p<numPals; p++)
      {
         for (i=0; i<256; i++)
@@ -567,7 +1087,14 @@ void V_UpdateTrueColorPalette(void) {
            for (w=0; w<VID_NUMCOLORWEIGHTS; w++)
            {
               float t = (float)(w)/(float)(VID_NUMCOLORWEIGHTS-1);
-#if defined(ABGR1555)
+#if defined(PRBOOM_32BPP)
+              int nr  = (int)(r*t+roundUpR);
+              int ng  = (int)(g*t+roundUpG);
+              int nb  = (int)(b*t+roundUpB);
+              Palettes16[((p*256+i)*VID_NUMCOLORWEIGHTS)+w] = (
+                    (nr<<16) | (ng<<8) | nb
+                    );
+#elif defined(ABGR1555)
               int nr  = (int)((r>>3)*t+roundUpR);
               int ng  = (int)((g>>3)*t+roundUpG);
               int nb  = (int)((b>>3)*t+roundUpB);
@@ -588,6 +1115,7 @@ void V_UpdateTrueColorPalette(void) {
   }
 
   V_Palette16 = Palettes16 + paletteNum*256*VID_NUMCOLORWEIGHTS;
+  V_UpdateColormaps16(numPals);
    
   W_UnlockLumpNum(pplump);
   W_UnlockLumpNum(gtlump);
@@ -602,6 +1130,7 @@ static void V_DestroyTrueColorPalette(void)
     if (Palettes16) free(Palettes16);
     Palettes16 = NULL;
     V_Palette16 = NULL;
+    V_DestroyColormaps16();
 }
 
 void V_DestroyUnusedTrueColorPalettes(void)
@@ -618,6 +1147,7 @@ void V_DestroyUnusedTrueColorPalettes(void)
 void V_SetPalette(int pal)
 {
 	currentPaletteIndex = pal;
+	screen_dirty = TRUE;
 
 	I_SetPalette(pal);
 	// V_SetPalette can be called as part of the gamma setting before
@@ -632,12 +1162,23 @@ void V_SetPalette(int pal)
 // CPhipps - New function to fill a rectangle with a given colour
 void V_FillRect(int x, int y, int width, int height, uint8_t colour)
 {
-  uint16_t *dest = (uint16_t*)screens[0].data + x + y* SURFACE_SHORT_PITCH;
-  uint16_t c = VID_PAL16(colour, VID_COLORWEIGHTMASK);
-  while (height--)
+  pixel_t *dest = (pixel_t*)screens[0].data + x + y* SURFACE_SHORT_PITCH;
+  const pixel_t *first = dest;
+  pixel_t c = VID_PAL16(colour, VID_COLORWEIGHTMASK);
+  int i;
+
+  if (width <= 0 || height <= 0)
+     return;
+
+  // memset would only get the colour right when all its bytes match,
+  // so build the first row and copy it down
+  for (i = 0; i < width; i++)
+     dest[i] = c;
+
+  while (--height)
   {
-     memset(dest, c, width * sizeof(uint16_t));
      dest += SURFACE_SHORT_PITCH;
+     memcpy(dest, first, width * sizeof(*dest));
   }
 }
 
@@ -688,6 +1229,8 @@ void V_AllocScreens(void) {
 // V_FreeScreen
 //
 void V_FreeScreen(screeninfo_t *scrn) {
+  if (scrn == &screens[BGCACHE_SCR])
+    bgcachelump = -1;
   if (!scrn->not_on_heap) {
     free(scrn->data);
     scrn->data = NULL;
@@ -706,65 +1249,81 @@ void V_FreeScreens(void) {
 
 void V_PlotPixel(int scrn, int x, int y, uint8_t color)
 {
-   ((uint16_t*)screens[scrn].data)[x + SURFACE_SHORT_PITCH *y] = VID_PAL16(color, VID_COLORWEIGHTMASK);
+   ((pixel_t*)screens[scrn].data)[x + SURFACE_SHORT_PITCH *y] = VID_PAL16(color, VID_COLORWEIGHTMASK);
 }
 
 //
-// WRAP_V_DrawLine()
+// V_DrawLines()
 //
-// Draw a line in the frame buffer.
-// Classic Bresenham w/ whatever optimizations needed for speed
+// Draw lines in the frame buffer.
+// Classic Bresenham, stepping a pointer through the 16-bit screen with
+// the colour looked up once for the whole batch.
 //
-// Passed the frame coordinates of line, and the color to be drawn
-// Returns nothing
+// Passed the frame coordinates of the lines, how many, and the color
+// to be drawn. Returns nothing
 //
-void V_DrawLine(fline_t* fl, int color)
+void V_DrawLines(const fline_t* fl, int count, int color)
 {
-  int dx = fl->b.x - fl->a.x;
-  int ax = 2 * (dx<0 ? -dx : dx);
-  int sx = dx<0 ? -1 : 1;
+  pixel_t *screen = (pixel_t *)screens[0].data;
+  const pixel_t pixel = VID_PAL16((uint8_t)color, VID_COLORWEIGHTMASK);
 
-  int dy = fl->b.y - fl->a.y;
-  int ay = 2 * (dy<0 ? -dy : dy);
-  int sy = dy<0 ? -1 : 1;
+  for (; count > 0; count--, fl++)
+  {
+    int dx = fl->b.x - fl->a.x;
+    int ax = 2 * (dx<0 ? -dx : dx);
+    int sx = dx<0 ? -1 : 1;
 
-  int x  = fl->a.x;
-  int y  = fl->a.y;
+    int dy = fl->b.y - fl->a.y;
+    int ay = 2 * (dy<0 ? -dy : dy);
+    int sy = dy<0 ? -SURFACE_SHORT_PITCH : SURFACE_SHORT_PITCH;
 
-  if (ax > ay)
-  {
-    int d = ay - ax/2;
-    while (1)
+    pixel_t *dest = screen + fl->a.y * SURFACE_SHORT_PITCH + fl->a.x;
+    int n;
+
+    if (ax > ay)
     {
-      V_PlotPixel(0, x,y, (uint8_t)color);
-      if (x == fl->b.x) return;
-      if (d>=0)
+      int d = ay - ax/2;
+
+      for (n = ax/2; ; n--)
       {
-        y += sy;
-        d -= ax;
+        *dest = pixel;
+        if (!n)
+          break;
+        if (d>=0)
+        {
+          dest += sy;
+          d -= ax;
+        }
+        dest += sx;
+        d += ay;
       }
-      x += sx;
-      d += ay;
     }
-  }
-  else
-  {
-    int d = ax - ay/2;
-    while (1)
+    else
     {
-      V_PlotPixel(0, x, y, (uint8_t)color);
-      if (y == fl->b.y) return;
-      if (d >= 0)
+      int d = ax - ay/2;
+
+      for (n = ay/2; ; n--)
       {
-        x += sx;
-        d -= ay;
+        *dest = pixel;
+        if (!n)
+          break;
+        if (d >= 0)
+        {
+          dest += sx;
+          d -= ay;
+        }
+        dest += sy;
+        d += ax;
       }
-      y += sy;
-      d += ax;
     }
   }
 }
 
+void V_DrawLine(fline_t* fl, int color)
+{
+  V_DrawLines(fl, 1, color);
+}
+
 // V_DrawBox()
 //
 // Draw a box in the frame buffer, stretched to current resolution.
@@ -62,6 +62,18 @@ typedef struct {
 extern screeninfo_t screens[NUM_SCREENS];
 extern int          usegamma;
 
+// Set by whatever changes screens[0] from the frame last handed to
+// I_FinishUpdate, which clears it; an unchanged frame goes out as a dupe
+extern dbool        screen_dirty;
+
+// What changed on screens[0] since the last I_FinishUpdate when
+// screen_dirty isn't set, as an m_bbox box of screen pixels (BOXBOTTOM is
+// the first row and BOXTOP the last); I_FinishUpdate clears it
+extern int          dirtybox[4];
+
+// Adds a rectangle, in the 320x200 units drawn with VPT_STRETCH, to dirtybox
+void V_MarkRect(int x, int y, int width, int height);
+
 // symbolic indices into color translation table pointer array
 typedef enum
 {
@@ -96,10 +108,30 @@ typedef enum
 // Palettes for converting from 8 bit color to 16 and 32 bit. Also
 // contains the weighted versions of each palette color for filtering
 // operations
-extern uint16_t *V_Palette16;
+extern pixel_t *V_Palette16;
 
 #define VID_PAL16(color, weight) V_Palette16[ (color)*VID_NUMCOLORWEIGHTS + (weight) ]
 
+// Full weight true colour of each entry of a colormap, for the current
+// palette: V_Colormap16(cm)[c] == VID_PAL16(cm[c], VID_COLORWEIGHTMASK)
+const pixel_t *V_Colormap16(const lighttable_t *colormap);
+
+// V_Colormap16 with a translation folded in: the result's [c] is
+// V_Colormap16(colormap)[translation[c]]. Fused ahead of time for the
+// player translations (translationtables); any other translation is
+// fused into scratch, 256 entries, on every call.
+const pixel_t *V_TranslatedColormap16(const lighttable_t *colormap,
+                                      const uint8_t *translation, pixel_t *scratch);
+// Drops the fused translated tables after translationtables change
+void V_TranslationsChanged(void);
+
+// Drops every pre-scaled patch, before the lumps they came from go
+void V_FlushScaledPatches(void);
+
+// Rebuilds V_Palette16 (and the fused colormap tables) for the current
+// palette and gamma
+void V_UpdateTrueColorPalette(void);
+
 extern const char *default_videomode;
 
 void V_InitMode(void);
@@ -133,15 +165,20 @@ extern void V_DrawNumPatch(int x, int y, int scrn,
                                  enum patch_translation_e flags);
 
 // V_DrawNamePatch - Draws the patch from lump "name"
-#define V_DrawNamePatch(x,y,s,n,t,f) V_DrawNumPatch(x,y,s,W_GetNumForName(n),t,f)
+#define V_DrawNamePatch(x,y,s,n,t,f) V_DrawNumPatch(x,y,s,W_CachedNumForName(n),t,f)
+
+// V_DrawNumBackground - Draws a full screen VPT_STRETCH picture to screen 0,
+// scaling it only when it differs from the one drawn last
+void V_DrawNumBackground(int lump);
+#define V_DrawNameBackground(n) V_DrawNumBackground(W_GetNumForName(n))
 
 /* cph -
  * Functions to return width & height of a patch.
  * Doesn't really belong here, but is often used in conjunction with
  * this code.
  */
-#define V_NamePatchWidth(name) R_NumPatchWidth(W_GetNumForName(name))
-#define V_NamePatchHeight(name) R_NumPatchHeight(W_GetNumForName(name))
+#define V_NamePatchWidth(name) R_NumPatchWidth(W_CachedNumForName(name))
+#define V_NamePatchHeight(name) R_NumPatchHeight(W_CachedNumForName(name))
 
 /* cphipps 10/99: function to tile a flat over the screen */
 extern void V_DrawBackground(const char* flatname, int scrn);
@@ -166,6 +203,8 @@ typedef struct
 } fline_t;
 
 void V_DrawLine(fline_t* fl, int color);
+// count lines in one colour, clipped to the screen already
+void V_DrawLines(const fline_t* fl, int count, int color);
 void V_DrawBox(fline_t* fl, int color);
 
 void V_AllocScreen(screeninfo_t *scrn);
@@ -0,0 +1,421 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Ogg Vorbis music player. Decodes with the float libvorbis that is
+ *      built alongside fluidlite, or, with HAVE_LIBTREMOR, with the
+ *      integer-only Tremor decoder for targets without a fast FPU.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#include "config.h"
+
+#include "musicplayer.h"
+
+#if !defined(HAVE_LIBVORBIS) && !defined(HAVE_LIBTREMOR)
+#include <string.h>
+
+static const char *vb_name (void)
+{
+  return "vorbis player (DISABLED)";
+}
+
+
+static int vb_init (int samplerate)
+{
+  return 0;
+}
+
+const music_player_t vb_player =
+{
+  vb_name,
+  vb_init,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL
+};
+
+#else // HAVE_LIBVORBIS || HAVE_LIBTREMOR
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "lprintf.h"
+
+#define OV_EXCLUDE_STATIC_CALLBACKS
+#ifdef HAVE_LIBTREMOR
+#include <tremor/ivorbisfile.h>
+// Tremor always hands out native endian signed 16 bit samples
+#define VB_READ(buf, len) ov_read (&vb_file, (buf), (len), &vb_section)
+#else
+#include <vorbis/vorbisfile.h>
+#ifdef MSB_FIRST
+#define VB_READ(buf, len) ov_read (&vb_file, (buf), (len), 1, 2, 1, &vb_section)
+#else
+#define VB_READ(buf, len) ov_read (&vb_file, (buf), (len), 0, 2, 1, &vb_section)
+#endif
+#endif
+
+#include "i_sound.h"
+
+static OggVorbis_File vb_file;
+static int vb_open = 0;
+static int vb_section;
+static int vb_channels;
+static long vb_rate;
+
+static int vb_looping = 0;
+static int vb_volume = 0; // 0-15
+static int vb_samplerate_target = 0;
+static int vb_paused = 0;
+static int vb_playing = 0;
+
+// the song, read through vb_callbacks
+static const unsigned char *vb_data;
+static size_t vb_len;
+static size_t vb_pos;
+
+
+// Decoded audio is resampled to the output rate into a ring a chunk at a
+// time, and rendering copies from there, the same as the mp3 player
+#define VB_AHEAD_MS 300                 // how far ahead to decode
+#define VB_CHUNK 1024                   // most sample frames decoded at once
+#define VB_MAXCHANNELS 8
+
+static short   *vb_ring;
+static unsigned vb_ringsize;            // in stereo samples
+static unsigned vb_ringread;
+static unsigned vb_ringcount;
+static unsigned vb_ahead;               // top up to this many samples
+static int      vb_eof;                 // nothing more to decode; drain the ring
+
+// resampler state, carried across chunks
+static unsigned vb_step;                // input samples per output, 16.16
+static unsigned vb_frac;
+static short    vb_last[2];             // last input sample of the previous chunk
+
+
+static size_t vb_readfunc (void *ptr, size_t size, size_t nmemb, void *datasource)
+{
+  size_t n = size ? (vb_len - vb_pos) / size : 0;
+
+  if (n > nmemb)
+    n = nmemb;
+  memcpy (ptr, vb_data + vb_pos, n * size);
+  vb_pos += n * size;
+  return n;
+}
+
+static int vb_seekfunc (void *datasource, ogg_int64_t offset, int whence)
+{
+  ogg_int64_t pos;
+
+  switch (whence)
+  {
+    case SEEK_SET: pos = offset; break;
+    case SEEK_CUR: pos = (ogg_int64_t) vb_pos + offset; break;
+    case SEEK_END: pos = (ogg_int64_t) vb_len + offset; break;
+    default: return -1;
+  }
+  if (pos < 0 || pos > (ogg_int64_t) vb_len)
+    return -1;
+  vb_pos = (size_t) pos;
+  return 0;
+}
+
+static long vb_tellfunc (void *datasource)
+{
+  return (long) vb_pos;
+}
+
+static const ov_callbacks vb_callbacks =
+{
+  vb_readfunc,
+  vb_seekfunc,
+  NULL,   // the data isn't ours to close
+  vb_tellfunc
+};
+
+
+static const char *vb_name (void)
+{
+#ifdef HAVE_LIBTREMOR
+  return "tremor vorbis player";
+#else
+  return "vorbis player";
+#endif
+}
+
+
+static int vb_init (int samplerate)
+{
+  vb_samplerate_target = samplerate;
+
+  // room for the lookahead, one chunk upsampled from as low as 8000hz,
+  // and a render call's worth of underrun
+  vb_ahead = samplerate * VB_AHEAD_MS / 1000;
+  vb_ringsize = vb_ahead + VB_CHUNK * samplerate / 8000 + samplerate / 10;
+  vb_ring = malloc (vb_ringsize * 4);
+  return vb_ring != NULL;
+}
+
+static void vb_unregistersong (const void *handle)
+{
+  if (vb_open)
+    ov_clear (&vb_file);
+  vb_open = 0;
+  vb_data = NULL;
+  vb_playing = 0;
+}
+
+static void vb_shutdown (void)
+{
+  vb_unregistersong (NULL);
+  free (vb_ring);
+  vb_ring = NULL;
+}
+
+static const void *vb_registersong (const void *data, unsigned len)
+{
+  vorbis_info *info;
+
+  if (len < 4 || memcmp (data, "OggS", 4) != 0)
+    return NULL;
+
+  vb_unregistersong (NULL);
+  vb_data = data;
+  vb_len = len;
+  vb_pos = 0;
+  if (ov_open_callbacks ((void *) data, &vb_file, NULL, 0, vb_callbacks) != 0)
+  {
+    lprintf (LO_WARN, "vorbis_registersong failed\n");
+    vb_data = NULL;
+    return NULL;
+  }
+  vb_open = 1;
+
+  info = ov_info (&vb_file, -1);
+  if (!info || info->channels < 1 || info->channels > VB_MAXCHANNELS || info->rate < 8000)
+  {
+    lprintf (LO_WARN, "vorbis_registersong: unsupported stream\n");
+    vb_unregistersong (NULL);
+    return NULL;
+  }
+  vb_channels = info->channels;
+  vb_rate = info->rate;
+
+  lprintf (LO_INFO, "vorbis_registersong succeed. channels %d samplerate %ld\n", vb_channels, vb_rate);
+
+  // handle not used
+  return data;
+}
+
+static void vb_setvolume (int v)
+{
+  vb_volume = v;
+}
+
+static void vb_pause (void)
+{
+  vb_paused = 1;
+}
+
+static void vb_resume (void)
+{
+  vb_paused = 0;
+}
+
+static void vb_play (const void *handle, int looping)
+{
+  ov_raw_seek (&vb_file, 0);
+
+  vb_playing = 1;
+  vb_looping = looping;
+  vb_ringread = 0;
+  vb_ringcount = 0;
+  vb_eof = 0;
+  vb_step = ((unsigned) vb_rate << 16) / (unsigned) vb_samplerate_target;
+  vb_frac = 0;
+  vb_last[0] = vb_last[1] = 0; // avoid pop when first starting stream
+}
+
+static void vb_stop (void)
+{
+  vb_playing = 0;
+}
+
+// Decode up to VB_CHUNK sample frames into buf. Returns the number of
+// frames, 0 at the end of the song or on an error it can't get past
+static int vb_decodechunk (short *buf)
+{
+  int want = VB_CHUNK * vb_channels * 2;
+  int got = 0;
+  int rewound = 0;
+
+  while (got == 0)
+  {
+    long n = VB_READ ((char *) buf, want);
+
+    if (n > 0)
+      got = (int) n;
+    else if (n == 0)
+    { // EOF; rewind once, so an empty stream doesn't spin
+      if (!vb_looping || rewound || ov_raw_seek (&vb_file, 0) != 0)
+        return 0;
+      rewound = 1;
+    }
+    else if (n != OV_HOLE)
+    {
+      lprintf (LO_WARN, "vorbis ov_read: error %ld\n", n);
+      return 0;
+    }
+  }
+  return got / (vb_channels * 2);
+}
+
+// Decode a chunk and resample it onto the end of the ring
+static void vb_fillchunk (void)
+{
+  short buf[VB_CHUNK * VB_MAXCHANNELS];
+  short in[2][VB_CHUNK + 1];
+  unsigned length, pos, w;
+  unsigned i;
+  int right = vb_channels > 1;
+
+  length = vb_decodechunk (buf);
+  if (!length)
+  {
+    vb_eof = 1;
+    return;
+  }
+
+  // in[][0] is the previous chunk's last sample, to interpolate across the
+  // seam; mono is duplicated, and channels past the first two dropped
+  in[0][0] = vb_last[0];
+  in[1][0] = vb_last[1];
+  for (i = 0; i < length; i++)
+  {
+    in[0][i + 1] = buf[i * vb_channels];
+    in[1][i + 1] = buf[i * vb_channels + right];
+  }
+  vb_last[0] = in[0][length];
+  vb_last[1] = in[1][length];
+
+  w = (vb_ringread + vb_ringcount) % vb_ringsize;
+  for (pos = vb_frac; (pos >> 16) < length; pos += vb_step)
+  {
+    unsigned j = pos >> 16, f = pos & 0xffff;
+
+    vb_ring[w * 2 + 0] = (in[0][j] * (int) (0x10000 - f) + in[0][j + 1] * (int) f) >> 16;
+    vb_ring[w * 2 + 1] = (in[1][j] * (int) (0x10000 - f) + in[1][j + 1] * (int) f) >> 16;
+    if (++w == vb_ringsize)
+      w = 0;
+    vb_ringcount++;
+  }
+  vb_frac = pos - (length << 16);
+}
+
+static void vb_render (void *dest, unsigned nsamp)
+{
+  short *sout = (short *) dest;
+
+  if (!vb_playing || vb_paused)
+  {
+    memset (dest, 0, nsamp * 4);
+    return;
+  }
+
+  // keep each pass within what the ring holds
+  while (nsamp > vb_ahead)
+  {
+    vb_render (sout, vb_ahead);
+    sout += vb_ahead * 2;
+    nsamp -= vb_ahead;
+  }
+
+  // only decode inline what this call can't do without
+  while (vb_ringcount < nsamp && !vb_eof)
+    vb_fillchunk ();
+
+  while (nsamp > 0 && vb_ringcount > 0)
+  {
+    unsigned n = vb_ringsize - vb_ringread;
+    const short *src = vb_ring + vb_ringread * 2;
+    unsigned i;
+
+    if (n > vb_ringcount)
+      n = vb_ringcount;
+    if (n > nsamp)
+      n = nsamp;
+
+    // apply volume on the way out, so changes aren't held up by the lookahead
+    for (i = 0; i < n * 2; i++)
+      *sout++ = src[i] * vb_volume / 15;
+
+    vb_ringread = (vb_ringread + n) % vb_ringsize;
+    vb_ringcount -= n;
+    nsamp -= n;
+  }
+
+  if (nsamp > 0)
+  { // song is over
+    vb_playing = 0;
+    memset (sout, 0, nsamp * 4);
+    return;
+  }
+
+  // then one more chunk towards the lookahead
+  if (vb_ringcount < vb_ahead && !vb_eof)
+    vb_fillchunk ();
+}
+
+
+const music_player_t vb_player =
+{
+  vb_name,
+  vb_init,
+  vb_shutdown,
+  vb_setvolume,
+  vb_pause,
+  vb_resume,
+  vb_registersong,
+  vb_unregistersong,
+  vb_play,
+  vb_stop,
+  vb_render,
+  NULL
+};
+
+#endif // HAVE_LIBVORBIS || HAVE_LIBTREMOR
@@ -0,0 +1,268 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Identification of wad files kept across runs, keyed by path,
+ *      size and modification time.
+ *
+ *      Anything that has to know which wads are loaded (the patch cache
+ *      is named by an MD5 of them, CheckIWAD scans the IWAD directory for
+ *      its game mode) asks here first. A relaunch with the same files
+ *      then reads one small text file instead of every byte of the wads.
+ *      Each line holds the size, the modification time, the MD5 (or -),
+ *      the game mode (or -1), whether Doom II secret levels exist, and
+ *      the path.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+#include "config.h"
+
+#include <sys/stat.h>
+
+#include "doomstat.h"
+#include "doomtype.h"
+#include "i_system.h"
+#include "lprintf.h"
+#include "md5.h"
+#include "w_wad.h"
+#include "w_ident.h"
+
+#include <streams/file_stream.h>
+
+typedef struct {
+  char *path;
+  long long size, mtime;
+  unsigned char md5[16];
+  dbool hashed;
+  int gamemode;   // -1 until CheckIWAD has looked
+  dbool hassec;
+} wadident_t;
+
+static wadident_t *wadidents;
+static int numwadidents;
+static dbool identsloaded;
+
+static void W_IdentCachePath(char *path, size_t size)
+{
+#ifdef _WIN32
+  char slash = '\\';
+#else
+  char slash = '/';
+#endif
+
+  snprintf(path, size, "%s%cprboom_wads.cache", I_DoomExeDir(), slash);
+}
+
+static void W_LoadWadIdents(void)
+{
+  char path[PATH_MAX+1];
+  void *buf;
+  int64_t len;
+  char *line, *next;
+
+  identsloaded = TRUE;
+  W_IdentCachePath(path, sizeof path);
+  if (!filestream_exists(path) || !filestream_read_file(path, &buf, &len))
+    return;
+
+  // filestream_read_file terminates what it read
+  for (line = buf; *line; line = next)
+  {
+    wadident_t ident;
+    char md5hex[33];
+    int pathstart = 0;
+
+    if ((next = strchr(line, '\n')))
+      *next++ = 0;
+    else
+      next = line + strlen(line);
+
+    memset(&ident, 0, sizeof ident);
+    if (sscanf(line, "%lld %lld %32s %d %d %n", &ident.size, &ident.mtime,
+          md5hex, &ident.gamemode, &ident.hassec, &pathstart) < 5 || !pathstart)
+      continue;
+    if (strlen(md5hex) == 32)
+    {
+      int i;
+
+      for (i = 0; i < 16; i++)
+      {
+        unsigned byte;
+
+        sscanf(md5hex + i*2, "%2x", &byte);
+        ident.md5[i] = byte;
+      }
+      ident.hashed = TRUE;
+    }
+    ident.path = strdup(line + pathstart);
+
+    wadidents = realloc(wadidents, (numwadidents + 1) * sizeof *wadidents);
+    wadidents[numwadidents++] = ident;
+  }
+  free(buf);
+}
+
+static void W_SaveWadIdents(void)
+{
+  char path[PATH_MAX+1];
+  RFILE *f;
+  int i, j;
+
+  W_IdentCachePath(path, sizeof path);
+  f = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+      RETRO_VFS_FILE_ACCESS_HINT_NONE);
+  if (!f)
+  {
+    lprintf(LO_WARN, "W_SaveWadIdents: couldn't write %s\n", path);
+    return;
+  }
+
+  for (i = 0; i < numwadidents; i++)
+  {
+    const wadident_t *ident = &wadidents[i];
+
+    filestream_printf(f, "%lld %lld ", ident->size, ident->mtime);
+    if (ident->hashed)
+      for (j = 0; j < 16; j++)
+        filestream_printf(f, "%02x", ident->md5[j]);
+    else
+      filestream_printf(f, "-");
+    filestream_printf(f, " %d %d %s\n", ident->gamemode, ident->hassec, ident->path);
+  }
+  filestream_close(f);
+}
+
+// The entry for a file as it is now, a fresh one if it is new or has
+// changed since; NULL if the file can't be stat'ed (a VFS-only path).
+static wadident_t *W_FindWadIdent(const char *path)
+{
+  struct stat st;
+  wadident_t *ident;
+  int i;
+
+  if (!identsloaded)
+    W_LoadWadIdents();
+  if (stat(path, &st))
+    return NULL;
+
+  for (i = 0; i < numwadidents; i++)
+    if (!strcmp(wadidents[i].path, path))
+      break;
+  if (i == numwadidents)
+  {
+    wadidents = realloc(wadidents, (numwadidents + 1) * sizeof *wadidents);
+    wadidents[numwadidents].path = strdup(path);
+    wadidents[numwadidents].size = -1;
+    numwadidents++;
+  }
+
+  ident = &wadidents[i];
+  if (ident->size != (long long)st.st_size || ident->mtime != (long long)st.st_mtime)
+  {
+    ident->size = st.st_size;
+    ident->mtime = st.st_mtime;
+    ident->hashed = FALSE;
+    ident->gamemode = -1;
+    ident->hassec = FALSE;
+  }
+  return ident;
+}
+
+static dbool W_HashWad(const wadfile_info_t *wadfile, unsigned char digest[16])
+{
+  struct MD5Context md5;
+
+  MD5Init(&md5);
+#ifndef MEMORY_LOW
+  if (!wadfile->data)
+    return FALSE;
+  MD5Update(&md5, wadfile->data, wadfile->length);
+#else
+  {
+    unsigned char buf[16384];
+    int64_t len;
+
+    if (!wadfile->handle)
+      return FALSE;
+    filestream_seek(wadfile->handle, 0, RETRO_VFS_SEEK_POSITION_START);
+    while ((len = filestream_read(wadfile->handle, buf, sizeof buf)) > 0)
+      MD5Update(&md5, buf, (unsigned)len);
+  }
+#endif
+  MD5Final(digest, &md5);
+  return TRUE;
+}
+
+dbool W_WadDigest(const wadfile_info_t *wadfile, unsigned char digest[16])
+{
+  wadident_t *ident;
+
+#ifndef MEMORY_LOW
+  if (wadfile->builtin)  // no file to key a cached digest by
+    return W_HashWad(wadfile, digest);
+#endif
+  ident = W_FindWadIdent(wadfile->name);
+
+  if (ident && ident->hashed)
+  {
+    memcpy(digest, ident->md5, 16);
+    return TRUE;
+  }
+  if (!W_HashWad(wadfile, digest))
+    return FALSE;
+  if (ident)
+  {
+    memcpy(ident->md5, digest, 16);
+    ident->hashed = TRUE;
+    W_SaveWadIdents();
+  }
+  return TRUE;
+}
+
+dbool W_CachedIWADMode(const char *path, int *gamemode, dbool *hassec)
+{
+  wadident_t *ident = W_FindWadIdent(path);
+
+  if (!ident || ident->gamemode < 0)
+    return FALSE;
+  *gamemode = ident->gamemode;
+  *hassec = ident->hassec;
+  return TRUE;
+}
+
+void W_StoreIWADMode(const char *path, int gamemode, dbool hassec)
+{
+  wadident_t *ident = W_FindWadIdent(path);
+
+  if (!ident || (ident->gamemode == gamemode && ident->hassec == hassec))
+    return;
+  ident->gamemode = gamemode;
+  ident->hassec = hassec;
+  W_SaveWadIdents();
+}
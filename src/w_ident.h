@@ -0,0 +1,49 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Identification of wad files kept across runs, keyed by path,
+ *      size and modification time.
+ *
+ *-----------------------------------------------------------------------------*/
+
+
+#ifndef __W_IDENT__
+#define __W_IDENT__
+
+#include "w_wad.h"
+
+// The MD5 of a whole wad, read and hashed only when the cache has none
+// for the file's path, size and modification time; FALSE if it can't be.
+dbool W_WadDigest(const wadfile_info_t *wadfile, unsigned char digest[16]);
+
+// What CheckIWAD found in an IWAD last time; FALSE if it has to look
+dbool W_CachedIWADMode(const char *path, int *gamemode, dbool *hassec);
+void W_StoreIWADMode(const char *path, int gamemode, dbool hassec);
+
+#endif
@@ -41,12 +41,38 @@
 #include "w_wad.h"
 #include "z_zone.h"
 #include "lprintf.h"
+#include "i_system.h"
+#include "i_thread.h"
 
 static struct {
   void *cache;
   unsigned int locks;
+  const void *image;  // the lump inside the wad image, used in place
 } *cachelump;
 
+#ifndef MEMORY_LOW
+/* W_LumpImage
+ *
+ * With the whole wad in memory (read in or mapped), a lump can be handed
+ * out straight from the image, with no zone copy and no locking, if it
+ * lies inside the file and starts on a 4 byte boundary, the widest field
+ * any lump holds. Byte order is fixed up by the callers as they read
+ * (SHORT/LONG), so nothing needs rewriting in place on either endianness.
+ */
+static const void *W_LumpImage(int lump)
+{
+  const lumpinfo_t *l = &lumpinfo[lump];
+  const wadfile_info_t *wad = l->wadfile;
+
+  if (!wad || !wad->data || l->compressed || l->position < 0 || l->size < 0 ||
+      l->position > wad->length - l->size)
+    return NULL;
+  if ((uintptr_t)(wad->data + l->position) & 3)
+    return NULL;
+  return wad->data + l->position;
+}
+#endif
+
 /* W_InitCache
  *
  * cph 2001/07/07 - split from W_Init
@@ -57,12 +83,43 @@ void W_InitCache(void)
   cachelump = calloc(sizeof *cachelump, numlumps);
   if (!cachelump)
     I_Error ("W_Init: Couldn't allocate lumpcache");
+#ifndef MEMORY_LOW
+  {
+    int i;
+
+    for (i = 0; i < numlumps; i++)
+      cachelump[i].image = W_LumpImage(i);
+  }
+#endif
 }
 
 void W_DoneCache(void)
 {
+   W_StopPrefetch();
    if (cachelump)
+   {
+      int i;
+
+      // free the cached lumps first, their zone blocks point back in here
+      for (i = 0; i < numlumps; i++)
+         Z_Free(cachelump[i].cache);
       free(cachelump);
+   }
+}
+
+size_t W_CacheBytes(void)
+{
+  size_t bytes = 0;
+  int i;
+
+  if (!cachelump)
+    return 0;
+  Z_Lock();
+  for (i = 0; i < numlumps; i++)
+    if (cachelump[i].cache)
+      bytes += W_LumpLength(i);
+  Z_Unlock();
+  return bytes;
 }
 
 /* W_CacheLumpNum
@@ -74,17 +131,29 @@ void W_DoneCache(void)
 const void *W_CacheLumpNum(int lump)
 {
   const int locks = 1;
+  const void *data;
 
+  if (cachelump[lump].image)
+    return cachelump[lump].image;
+
+  Z_Lock();
   if (!cachelump[lump].cache)      // read the lump in
+  {
+    zcachestats.misses++;
     W_ReadLump(lump, Z_Malloc(W_LumpLength(lump), PU_CACHE, &cachelump[lump].cache));
+  }
+  else
+    zcachestats.hits++;
 
   /* cph - if wasn't locked but now is, tell z_zone to hold it */
   if (!cachelump[lump].locks && locks) {
-    Z_ChangeTag(cachelump[lump].cache,PU_STATIC);
+    Z_Hold(cachelump[lump].cache);
   }
   cachelump[lump].locks += locks;
+  data = cachelump[lump].cache;
+  Z_Unlock();
 
-  return cachelump[lump].cache;
+  return data;
 }
 
 const void *W_LockLumpNum(int lump)
@@ -105,11 +174,153 @@ void W_UnlockLumpNum(int lump)
   // invalid lump, ignore unlock
   if (lump < 0) return;
 
+  // used in place, never locked
+  if (cachelump[lump].image) return;
+
+  Z_Lock();
   cachelump[lump].locks -= unlocks;
   /* cph - Note: must only tell z_zone to make purgeable if currently locked,
    * else it might already have been purged
    */
   if (unlocks && !cachelump[lump].locks)
-    Z_ChangeTag(cachelump[lump].cache, PU_CACHE);
+    Z_Release(cachelump[lump].cache);
+  Z_Unlock();
+}
+
+
+/* W_StartPrefetch, W_PrefetchStep, W_StopPrefetch
+ *
+ * Reads a set of lumps ahead of need (the next map's, while the
+ * intermission is up), in wad file and offset order so the storage sees
+ * one forward sweep. Lumps of a mapped wad are faulted in by touching a
+ * byte a page on a background thread; with MEMORY_LOW they are read into
+ * the lump cache a slice each frame from W_PrefetchStep. Lumps of a wad
+ * already read whole into memory need nothing.
+ */
+
+#define PREFETCH_PAGE 4096
+
+// without a usable clock, this many lumps a frame
+#define PREFETCH_UNTIMED_LUMPS 8
+
+static int *prefetchlumps;
+static int numprefetchlumps, prefetchdone;
+
+#ifndef MEMORY_LOW
+static i_thread_t *prefetchthread;
+static volatile int prefetchstop;
+
+static void W_PrefetchThread(void *arg)
+{
+  volatile unsigned char sink = 0;
+  int i;
+
+  for (i = 0; i < numprefetchlumps && !prefetchstop; i++)
+  {
+    const lumpinfo_t *l = &lumpinfo[prefetchlumps[i]];
+    const unsigned char *p = l->wadfile->data + l->position;
+    const unsigned char *end = p + l->size;
+
+    for (; p < end && !prefetchstop; p += PREFETCH_PAGE)
+      sink += *p;
+  }
+}
+#endif
+
+static int W_ComparePrefetchLumps(const void *a, const void *b)
+{
+  const lumpinfo_t *la = &lumpinfo[*(const int *)a];
+  const lumpinfo_t *lb = &lumpinfo[*(const int *)b];
+
+  if (la->wadfile != lb->wadfile)
+    return la->wadfile < lb->wadfile ? -1 : 1;
+  return la->position - lb->position;
+}
+
+void W_StartPrefetch(const int *lumps, int count)
+{
+  int i;
+
+  W_StopPrefetch();
+
+  prefetchlumps = malloc(count * sizeof *prefetchlumps);
+  for (i = 0; i < count; i++)
+  {
+    const lumpinfo_t *l = &lumpinfo[lumps[i]];
+
+    if (!l->wadfile || l->size <= 0)
+      continue;
+#ifndef MEMORY_LOW
+    // only a mapped image has anything left to read
+    if (!l->wadfile->mapped || !cachelump[lumps[i]].image)
+      continue;
+#endif
+    prefetchlumps[numprefetchlumps++] = lumps[i];
+  }
+  if (!numprefetchlumps)
+  {
+    W_StopPrefetch();
+    return;
+  }
+  qsort(prefetchlumps, numprefetchlumps, sizeof *prefetchlumps,
+      W_ComparePrefetchLumps);
+
+#ifndef MEMORY_LOW
+  prefetchstop = 0;
+  prefetchthread = I_ThreadCreate(W_PrefetchThread, NULL);
+  // without a thread, W_PrefetchStep touches the pages instead
+#endif
+}
+
+void W_PrefetchStep(int budget)
+{
+  int64_t start;
+  int i;
+
+  if (prefetchdone >= numprefetchlumps)
+    return;
+#ifndef MEMORY_LOW
+  if (prefetchthread)
+    return;
+#endif
+
+  start = I_GetTimeUS();
+  for (i = 0; prefetchdone < numprefetchlumps; i++)
+  {
+    int lump = prefetchlumps[prefetchdone++];
+
+#ifdef MEMORY_LOW
+    W_CacheLumpNum(lump);
+    W_UnlockLumpNum(lump);
+#else
+    {
+      const lumpinfo_t *l = &lumpinfo[lump];
+      const unsigned char *p = l->wadfile->data + l->position;
+      const unsigned char *end = p + l->size;
+      volatile unsigned char sink = 0;
+
+      for (; p < end; p += PREFETCH_PAGE)
+        sink += *p;
+    }
+#endif
+
+    if (start ? I_GetTimeUS() - start >= budget :
+        i+1 >= PREFETCH_UNTIMED_LUMPS)
+      break;
+  }
 }
 
+void W_StopPrefetch(void)
+{
+#ifndef MEMORY_LOW
+  if (prefetchthread)
+  {
+    prefetchstop = 1;
+    I_ThreadJoin(prefetchthread);
+    prefetchthread = NULL;
+  }
+#endif
+  free(prefetchlumps);
+  prefetchlumps = NULL;
+  numprefetchlumps = prefetchdone = 0;
+}
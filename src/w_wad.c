@@ -45,12 +45,23 @@
 #include "i_system.h"
 
 #include "w_wad.h"
+#include "w_zip.h"
 #include "lprintf.h"
+#include "i_jobs.h"
+#include "md5.h"
 
 #include <sys/stat.h>
 
 #include <streams/file_stream.h>
 
+#ifndef MEMORY_LOW
+#include <memmap.h>
+#if defined(HAVE_MMAN) && !defined(_WIN32)
+#include <unistd.h>
+#define W_MMAP
+#endif
+#endif
+
 /* Don't include file_stream_transforms.h but instead
 just forward declare the prototype */
 int64_t rfread(void* buffer,
@@ -111,6 +122,83 @@ char *AddDefaultExtension(char *path, const char *ext)
 // LUMP BASED ROUTINES.
 //
 
+#ifndef MEMORY_LOW
+// Map the whole wad read-only where the OS can, so only the lumps that are
+// touched become resident and the page cache is shared across restarts;
+// otherwise (no mmap, or a path only the VFS understands) read it all in.
+static void W_LoadWadData(wadfile_info_t *wadfile)
+{
+   wadfile->length = filestream_get_size(wadfile->handle);
+   wadfile->mapped = FALSE;
+
+#ifdef W_MMAP
+   if (wadfile->length > 0)
+   {
+      int fd = open(wadfile->name, O_RDONLY);
+
+      if (fd >= 0)
+      {
+         void *data = mmap(NULL, wadfile->length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+         close(fd);  // the mapping keeps the file
+         if (data != MAP_FAILED)
+         {
+            wadfile->data = data;
+            wadfile->mapped = TRUE;
+            return;
+         }
+      }
+   }
+#endif
+
+   wadfile->data = malloc(wadfile->length);
+   if ( rfread(wadfile->data, wadfile->length, 1, wadfile->handle) != 1)
+   {
+      // reported by W_AddFile, which runs on the main thread
+      free(wadfile->data);
+      wadfile->data = NULL;
+   }
+}
+
+static void W_FreeWadData(wadfile_info_t *wadfile)
+{
+#ifdef W_MMAP
+   if (wadfile->mapped)
+      munmap(wadfile->data, wadfile->length);
+   else
+#endif
+      free(wadfile->data);
+   wadfile->data = NULL;
+   wadfile->mapped = FALSE;
+}
+
+// Opens wadfiles[i] and reads or maps its data. W_Init runs this for all
+// the files at once on the job pool, so a failure is only left behind
+// (no handle, or no data) for W_AddFile to report in order.
+static void W_OpenWadFile(void *arg, int i)
+{
+   wadfile_info_t *wadfile = &wadfiles[i];
+
+   // a built-in wad comes with its data and length set, and there is
+   // no file to open
+   if (wadfile->builtin)
+      return;
+
+   wadfile->handle = filestream_open(wadfile->name,
+         RETRO_VFS_FILE_ACCESS_READ,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   if (!wadfile->handle)
+      return;
+
+   // precache into memory instead of reading from disk; a demo is read
+   // from the file as it plays instead (see G_ReadDemoTiccmd)
+   if (wadfile->src == source_lmp)
+      wadfile->length = filestream_get_size(wadfile->handle);
+   else
+      W_LoadWadData(wadfile);
+}
+#endif
+
 //
 // W_AddFile
 // All files are optional, but at least one file must be
@@ -137,35 +225,46 @@ static void W_AddFile(wadfile_info_t *wadfile)
    filelump_t *fileinfo2free=NULL; //killough
    filelump_t singleinfo;
 
-   // open the file and add to directory
-   wadfile->handle = filestream_open(wadfile->name,
-         RETRO_VFS_FILE_ACCESS_READ,
-         RETRO_VFS_FILE_ACCESS_HINT_NONE);
-
    wadfile_name_len = strlen(wadfile->name);
 
-   if (!wadfile->handle)
+#ifndef MEMORY_LOW
+   // already opened and read by W_OpenWadFile
+   if (!wadfile->builtin)
+#endif
    {
-      if (  wadfile_name_len <= 4 ||      // add error check -- killough
-            (strcasecmp(wadfile->name + wadfile_name_len - 4, ".lmp" ) &&
-             strcasecmp(wadfile->name + wadfile_name_len - 4, ".gwa" ) )
-         )
-         I_Error("W_AddFile: couldn't open %s",wadfile->name);
-      return;
-   }
+#ifdef MEMORY_LOW
+      // open the file and add to directory
+      wadfile->handle = filestream_open(wadfile->name,
+            RETRO_VFS_FILE_ACCESS_READ,
+            RETRO_VFS_FILE_ACCESS_HINT_NONE);
+#endif
+
+      if (!wadfile->handle)
+      {
+         if (  wadfile_name_len <= 4 ||      // add error check -- killough
+               (strcasecmp(wadfile->name + wadfile_name_len - 4, ".lmp" ) &&
+                strcasecmp(wadfile->name + wadfile_name_len - 4, ".gwa" ) )
+            )
+            I_Error("W_AddFile: couldn't open %s",wadfile->name);
+         return;
+      }
 
 #ifndef MEMORY_LOW
-   // precache into memory instead of reading from disk
-   wadfile->length = filestream_get_size(wadfile->handle);
-   wadfile->data = malloc(wadfile->length);
-   if ( rfread(wadfile->data, wadfile->length, 1, wadfile->handle) != 1)
-      I_Error("W_AddFile: couldn't read wad data");
+      if (wadfile->src != source_lmp && !wadfile->data)
+         I_Error("W_AddFile: couldn't read wad data");
 #endif
+   }
 
    //jff 8/3/98 use logical output routine
    lprintf (LO_INFO," adding %s\n",wadfile->name);
    startlump = numlumps;
 
+   if (W_IsZipFile(wadfile->name))
+   {
+      W_AddZipFile(wadfile);
+      return;
+   }
+
    if (  wadfile_name_len <=4 ||
          (
           strcasecmp(wadfile->name + wadfile_name_len - 4,".wad") &&
@@ -220,6 +319,7 @@ static void W_AddFile(wadfile_info_t *wadfile)
       lump_p->wadfile = wadfile;                    //  killough 4/25/98
       lump_p->position = LONG(fileinfo->filepos);
       lump_p->size = LONG(fileinfo->size);
+      lump_p->compressed = 0;
       lump_p->li_namespace = ns_global;              // killough 4/17/98
       strncpy (lump_p->name, fileinfo->name, 8);
       lump_p->source = wadfile->src;                    // Ty 08/29/98
@@ -261,6 +361,7 @@ static void W_CoalesceMarkedResource(const char *start_marker,
           {
             strncpy(marked->name, start_marker, 8);
             marked->size = 0;  // killough 3/20/98: force size to be 0
+            marked->compressed = 0;
             marked->li_namespace = ns_global;        // killough 4/17/98
             marked->wadfile = NULL;
             num_marked = 1;
@@ -292,6 +393,7 @@ static void W_CoalesceMarkedResource(const char *start_marker,
   if (mark_end)                                   // add end marker
     {
       lumpinfo[numlumps].size = 0;  // killough 3/20/98: force size to be 0
+      lumpinfo[numlumps].compressed = 0;
       lumpinfo[numlumps].wadfile = NULL;
       lumpinfo[numlumps].li_namespace = ns_global;   // killough 4/17/98
       strncpy(lumpinfo[numlumps++].name, end_marker, 8);
@@ -319,6 +421,20 @@ unsigned W_LumpNameHash(const char *s)
   return hash;
 }
 
+// W_LumpNameKey
+// The up to 8 characters of a name, upper-cased and packed into one
+// integer, so names compare as strncasecmp(a, b, 8) would in one test.
+
+uint64_t W_LumpNameKey(const char *s)
+{
+  uint64_t key = 0;
+  int i;
+
+  for (i = 0; i < 8 && s[i]; i++)
+    key |= (uint64_t)(unsigned char)toupper((unsigned char)s[i]) << (i*8);
+  return key;
+}
+
 //
 // W_CheckNumForName
 // Returns -1 if name not found.
@@ -329,47 +445,101 @@ unsigned W_LumpNameHash(const char *s)
 // lump name lookup is used so often, and the original Doom used a sequential
 // search. For large wads with > 1000 lumps this meant an average of over
 // 500 were probed during every search. Now the average is under 2 probes per
-// search. There is no significant benefit to packing the names into longwords
-// with this new hashing algorithm, because the work to do the packing is
-// just as much work as simply doing the string comparisons with the new
-// algorithm, which minimizes the expected number of comparisons to under 2.
+// search.
 //
 // killough 4/17/98: add namespace parameter to prevent collisions
 // between different resources such as flats, sprites, colormaps
 //
+// The names are packed into 64-bit keys once, by W_HashLumps, so the work
+// of a lookup is packing the name asked for, then one key and namespace
+// test a probe of an open-addressed table. Each slot holds the latest lump
+// of its name and namespace; the older ones hang off it through next.
+
+static int *lumphash;             // lump numbers, -1 for an empty slot
+static unsigned lumphashbits;
+
+static unsigned W_LumpSlot(uint64_t key, lumpinfo_namespace_t li_namespace)
+{
+  unsigned mask = (1u << lumphashbits) - 1;
+  unsigned slot = (unsigned)(((key ^ li_namespace) * LONGLONG(0x9e3779b97f4a7c15))
+                             >> (64 - lumphashbits));
+  int i;
+
+  while ((i = lumphash[slot]) >= 0 &&
+         (lumpinfo[i].key != key || lumpinfo[i].li_namespace != li_namespace))
+    slot = (slot + 1) & mask;
+  return slot;
+}
 
 // W_FindNumFromName, an iterative version of W_CheckNumForName
 // returns list of lump numbers for a given name (latest first)
 //
 int (W_FindNumFromName)(const char *name, lumpinfo_namespace_t li_namespace, int i)
 {
-  // Hash function maps the name to one of possibly numlump chains.
-  // It has been tuned so that the average chain length never exceeds 2.
-
   // proff 2001/09/07 - check numlumps==0, this happens when called before WAD loaded
-  if (numlumps == 0)
-    i = -1;
-  else
-  {
-    if (i < 0)
-      i = lumpinfo[W_LumpNameHash(name) % (unsigned) numlumps].index;
-    else
-      i = lumpinfo[i].next;
+  if (numlumps == 0 || !lumphash)
+    return -1;
+
+  // the chain of a lump only holds lumps of its name and namespace
+  if (i >= 0)
+    return lumpinfo[i].next;
+
+  return lumphash[W_LumpSlot(W_LumpNameKey(name), li_namespace)];
+}
+
+/* W_CachedNumForName
+ *
+ * W_GetNumForName for the names of patches drawn every frame by the
+ * menu, intermission, finale and status bar (V_DrawNamePatch and
+ * friends). Each name resolves once into a small table keyed on the
+ * address of the name, its first 8 characters kept to catch a buffer
+ * rewritten in place; W_HashLumps empties the table when the wads
+ * change. The lookups that still miss are counted a frame at a time
+ * (W_NameCacheFrame) for W_ReportNameCache.
+ */
+
+#define NAMECACHE_SIZE 256
+
+static struct {
+  const char *name;
+  char copy[8];
+  int lump;
+} namecache[NAMECACHE_SIZE];
 
-  // We search along the chain until end, looking for case-insensitive
-  // matches which also match a namespace tag. Separate hash tables are
-  // not used for each namespace, because the performance benefit is not
-  // worth the overhead, considering namespace collisions are rare in
-  // Doom wads.
+static unsigned namehits, namemisses, framemisses, framemisspeak;
 
-  while (i >= 0 && (strncasecmp(lumpinfo[i].name, name, 8) ||
-                    lumpinfo[i].li_namespace != li_namespace))
-    i = lumpinfo[i].next;
+int W_CachedNumForName(const char *name)
+{
+  unsigned slot = (unsigned)(((uintptr_t)name >> 2) % NAMECACHE_SIZE);
+
+  if (namecache[slot].name == name && !strncmp(namecache[slot].copy, name, 8))
+  {
+    namehits++;
+    return namecache[slot].lump;
   }
+  namemisses++;
+  framemisses++;
+  namecache[slot].lump = W_GetNumForName(name);
+  namecache[slot].name = name;
+  strncpy(namecache[slot].copy, name, 8);
+  return namecache[slot].lump;
+}
 
-  // Return the matching lump, or -1 if none found.
+void W_NameCacheFrame(void)
+{
+  if (framemisses > framemisspeak)
+    framemisspeak = framemisses;
+  framemisses = 0;
+}
 
-  return i;
+void W_ReportNameCache(void)
+{
+  unsigned lookups = namehits + namemisses;
+
+  if (lookups)
+    lprintf(LO_INFO, "W_ReportNameCache: %u%% of %u patch name lookups hit, at most %u resolved in a frame\n",
+          (unsigned)(namehits * 100.0 / lookups), lookups, framemisspeak);
+  namehits = namemisses = framemisspeak = 0;
 }
 
 //
@@ -378,20 +548,31 @@ int (W_FindNumFromName)(const char *name, lumpinfo_namespace_t li_namespace, int
 
 void W_HashLumps(void)
 {
+  unsigned size;
   int i;
 
-  for (i=0; i<numlumps; i++)
-    lumpinfo[i].index = -1;                     // mark slots empty
+  // at most half full, so probe runs stay short
+  for (lumphashbits = 1; (1u << lumphashbits) < 2u * numlumps; lumphashbits++)
+    ;
+  size = 1u << lumphashbits;
+
+  free(lumphash);
+  lumphash = malloc(size * sizeof(*lumphash));
+  memset(namecache, 0, sizeof(namecache)); // lump numbers may have moved
+  memset(lumphash, -1, size * sizeof(*lumphash)); // mark slots empty
 
-  // Insert nodes to the beginning of each chain, in first-to-last
-  // lump order, so that the last lump of a given name appears first
-  // in any chain, observing pwad ordering rules. killough
+  // Insert each lump at the head of its chain, in first-to-last lump
+  // order, so that the last lump of a given name appears first in any
+  // chain, observing pwad ordering rules. killough
 
   for (i=0; i<numlumps; i++)
-    {                                           // hash function:
-      int j = W_LumpNameHash(lumpinfo[i].name) % (unsigned) numlumps;
-      lumpinfo[i].next = lumpinfo[j].index;     // Prepend to list
-      lumpinfo[j].index = i;
+    {
+      unsigned slot;
+
+      lumpinfo[i].key = W_LumpNameKey(lumpinfo[i].name);
+      slot = W_LumpSlot(lumpinfo[i].key, lumpinfo[i].li_namespace);
+      lumpinfo[i].next = lumphash[slot];
+      lumphash[slot] = i;
     }
 }
 
@@ -433,6 +614,203 @@ int W_ListNumFromName(const char *name, int lump)
 }
 
 
+int wad_dir_cache;
+
+#ifndef MEMORY_LOW
+//
+// Lump directory cache
+//
+// The lumpinfo table as W_Init leaves it, markers coalesced and hash
+// chains linked, together with the hash slots, so that a later start with
+// the same files in the same order reads it back in one go instead of
+// parsing and reordering every directory. It is keyed by an MD5 of each
+// file's path, source, size and modification time (or, for a built-in
+// image, its bytes); a file that can't be stat'ed leaves it unused.
+//
+
+#define LUMPCACHE_MAGIC   "PRBLUMP"
+#define LUMPCACHE_VERSION 1
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t entrysize;  // sizeof(lumpcache_entry_t) of the build that wrote it
+  unsigned char md5[16];
+  int32_t numlumps;
+  uint32_t hashbits;
+} lumpcache_header_t;
+
+typedef struct {
+  uint64_t key;
+  char name[8];
+  int32_t size;
+  int32_t next;
+  int32_t li_namespace;
+  int32_t wadfile;     // index into wadfiles, -1 for a coalesced marker
+  int32_t position;
+  int32_t compressed;
+  int32_t source;
+} lumpcache_entry_t;
+
+static void W_LumpCachePath(char *path, size_t size)
+{
+#ifdef _WIN32
+  char slash = '\\';
+#else
+  char slash = '/';
+#endif
+
+  snprintf(path, size, "%s%cprboom_lumps.cache", I_DoomExeDir(), slash);
+}
+
+// FALSE if some file can't be keyed, so the directory is built as usual
+static dbool W_LumpCacheKey(unsigned char digest[16])
+{
+  struct MD5Context md5;
+  size_t i;
+
+  MD5Init(&md5);
+  for (i = 0; i < numwadfiles; i++)
+  {
+    const wadfile_info_t *wadfile = &wadfiles[i];
+    int32_t src = wadfile->src;
+
+    MD5Update(&md5, (const md5byte *)wadfile->name, strlen(wadfile->name) + 1);
+    MD5Update(&md5, (const md5byte *)&src, sizeof src);
+    if (wadfile->builtin)
+      MD5Update(&md5, wadfile->data, wadfile->length);
+    else
+    {
+      struct stat st;
+      long long stamp[2];
+
+      if (stat(wadfile->name, &st))
+        return FALSE;
+      stamp[0] = st.st_size;
+      stamp[1] = st.st_mtime;
+      MD5Update(&md5, (const md5byte *)stamp, sizeof stamp);
+    }
+  }
+  MD5Final(digest, &md5);
+  return TRUE;
+}
+
+static dbool W_LoadLumpCache(const unsigned char digest[16])
+{
+  char path[PATH_MAX+1];
+  const lumpcache_header_t *header;
+  const lumpcache_entry_t *entry;
+  void *buf;
+  int64_t len;
+  size_t i;
+  int n;
+
+  // the files W_AddFile would complain about are left to it
+  for (i = 0; i < numwadfiles; i++)
+    if (!wadfiles[i].builtin && (!wadfiles[i].handle ||
+          (wadfiles[i].src != source_lmp && !wadfiles[i].data)))
+      return FALSE;
+
+  W_LumpCachePath(path, sizeof path);
+  if (!filestream_exists(path) || !filestream_read_file(path, &buf, &len))
+    return FALSE;
+
+  header = buf;
+  if (len < (int64_t)sizeof *header ||
+      memcmp(header->magic, LUMPCACHE_MAGIC, sizeof LUMPCACHE_MAGIC) ||
+      header->version != LUMPCACHE_VERSION ||
+      header->entrysize != sizeof *entry ||
+      memcmp(header->md5, digest, 16) ||
+      header->numlumps <= 0 || header->hashbits >= 31 ||
+      len != (int64_t)(sizeof *header + header->numlumps * sizeof *entry +
+        (sizeof *lumphash << header->hashbits)))
+  {
+    free(buf);
+    return FALSE;
+  }
+
+  numlumps = header->numlumps;
+  lumpinfo = malloc(numlumps * sizeof *lumpinfo);
+  entry = (const lumpcache_entry_t *)(header + 1);
+  for (n = 0; n < numlumps; n++, entry++)
+  {
+    lumpinfo_t *lump = &lumpinfo[n];
+
+    memcpy(lump->name, entry->name, 8);
+    lump->name[8] = 0;
+    lump->size = entry->size;
+    lump->key = entry->key;
+    lump->next = entry->next;
+    lump->li_namespace = entry->li_namespace;
+    lump->wadfile = entry->wadfile >= 0 && entry->wadfile < (int)numwadfiles ?
+      &wadfiles[entry->wadfile] : NULL;
+    lump->position = entry->position;
+    lump->compressed = entry->compressed;
+    lump->source = entry->source;
+  }
+
+  lumphashbits = header->hashbits;
+  free(lumphash);
+  lumphash = malloc(sizeof *lumphash << lumphashbits);
+  memcpy(lumphash, entry, sizeof *lumphash << lumphashbits);
+  memset(namecache, 0, sizeof(namecache));
+
+  free(buf);
+  for (i = 0; i < numwadfiles; i++)
+    lprintf(LO_INFO," adding %s\n",wadfiles[i].name);
+  lprintf(LO_INFO, "W_Init: lump directory read from %s\n", path);
+  return TRUE;
+}
+
+static void W_StoreLumpCache(const unsigned char digest[16])
+{
+  char path[PATH_MAX+1];
+  lumpcache_header_t header;
+  lumpcache_entry_t *entries;
+  RFILE *f;
+  int n;
+
+  memset(&header, 0, sizeof header);
+  memcpy(header.magic, LUMPCACHE_MAGIC, sizeof LUMPCACHE_MAGIC);
+  header.version = LUMPCACHE_VERSION;
+  header.entrysize = sizeof *entries;
+  memcpy(header.md5, digest, 16);
+  header.numlumps = numlumps;
+  header.hashbits = lumphashbits;
+
+  entries = calloc(numlumps, sizeof *entries);
+  for (n = 0; n < numlumps; n++)
+  {
+    const lumpinfo_t *lump = &lumpinfo[n];
+    lumpcache_entry_t *entry = &entries[n];
+
+    memcpy(entry->name, lump->name, 8);
+    entry->size = lump->size;
+    entry->key = lump->key;
+    entry->next = lump->next;
+    entry->li_namespace = lump->li_namespace;
+    entry->wadfile = lump->wadfile ? (int32_t)(lump->wadfile - wadfiles) : -1;
+    entry->position = lump->position;
+    entry->compressed = lump->compressed;
+    entry->source = lump->source;
+  }
+
+  W_LumpCachePath(path, sizeof path);
+  f = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+      RETRO_VFS_FILE_ACCESS_HINT_NONE);
+  if (!f)
+    lprintf(LO_WARN, "W_StoreLumpCache: couldn't write %s\n", path);
+  else
+  {
+    filestream_write(f, &header, sizeof header);
+    filestream_write(f, entries, numlumps * sizeof *entries);
+    filestream_write(f, lumphash, sizeof *lumphash << lumphashbits);
+    filestream_close(f);
+  }
+  free(entries);
+}
+#endif
+
 // W_Init
 // Loads each of the files in the wadfiles array.
 // All files are optional, but at least one file
@@ -453,8 +831,25 @@ size_t numwadfiles = 0; // CPhipps - size of the wadfiles array (dynamic, no lim
 
 void W_Init(void)
 {
-  // CPhipps - start with nothing
+#ifndef MEMORY_LOW
+  unsigned char cachekey[16];
+  dbool cachekeyed;
+
+  // the files are opened and read all at once on the job pool; their
+  // directories are then added in order, so the lump order is the same
+  I_JobParallelFor(numwadfiles, W_OpenWadFile, NULL);
+
+  // the same files as last time need none of what follows
+  cachekeyed = wad_dir_cache && W_LumpCacheKey(cachekey);
+  if (cachekeyed && W_LoadLumpCache(cachekey))
+  {
+    lprintf(LO_INFO,"W_InitCache\n");
+    W_InitCache();
+    return;
+  }
+#endif
 
+  // CPhipps - start with nothing
   numlumps = 0; lumpinfo = NULL;
 
   { // CPhipps - new wadfiles array used
@@ -481,6 +876,11 @@ void W_Init(void)
   // killough 1/31/98: initialize lump hash table
   W_HashLumps();
 
+#ifndef MEMORY_LOW
+  if (cachekeyed)
+    W_StoreLumpCache(cachekey);
+#endif
+
   /* cph 2001/07/07 - separated cache setup */
   lprintf(LO_INFO,"W_InitCache\n");
   W_InitCache();
@@ -489,14 +889,15 @@ void W_Init(void)
 void W_Exit(void)
 {
    unsigned i;
+
+   W_StopPrefetch();   // before the images it reads go
    for (i = 0; i < numwadfiles; i++)
    {
       if (wadfiles[i].handle)
       {
          filestream_close(wadfiles[i].handle);
 #ifndef MEMORY_LOW
-         free(wadfiles[i].data);
-         wadfiles[i].data = NULL;
+         W_FreeWadData(&wadfiles[i]);
 #endif
          wadfiles[i].handle = NULL;
       }
@@ -514,8 +915,7 @@ void W_ReleaseAllWads(void)
       {
          filestream_close(wadfiles[i].handle);
 #ifndef MEMORY_LOW
-         free(wadfiles[i].data);
-         wadfiles[i].data = NULL;
+         W_FreeWadData(&wadfiles[i]);
 #endif
          wadfiles[i].handle = NULL;
       }
@@ -527,6 +927,8 @@ void W_ReleaseAllWads(void)
    numlumps = 0;
    free(lumpinfo);
    lumpinfo = NULL;
+   free(lumphash);
+   lumphash = NULL;
 }
 
 //
@@ -552,7 +954,18 @@ void W_ReadLump(int lump, void *dest)
 
    if (l->wadfile)
    {
-#ifdef MEMORY_LOW
+      if (l->compressed)
+      {
+         W_ReadZipLump(l, dest);
+         return;
+      }
+#ifndef MEMORY_LOW
+      if (l->wadfile->data)
+      {
+         memcpy(dest, &l->wadfile->data[l->position], l->size);
+         return;
+      }
+#endif
       if (l->size > 0)
       {
          rfseek(l->wadfile->handle, l->position, SEEK_SET);
@@ -561,8 +974,35 @@ void W_ReadLump(int lump, void *dest)
       }
       else
          I_Error("W_ReadLump: attempt to read lump of zero size");
-#else
-      memcpy(dest, &l->wadfile->data[l->position], l->size);
-#endif
    }
 }
+
+dbool W_ReadLumpRange(int lump, void *dest, int offset, int size)
+{
+  const lumpinfo_t *l = lumpinfo + lump;
+
+  if (!l->wadfile || l->compressed)
+    return FALSE;
+  if (offset < 0 || size < 0 || offset > l->size - size)
+  {
+    I_Error("W_ReadLumpRange: %d bytes at %d past the end of %.8s",
+            size, offset, l->name);
+    return FALSE;
+  }
+  if (size == 0)
+    return TRUE;
+#ifndef MEMORY_LOW
+  if (l->wadfile->data)
+  {
+    memcpy(dest, &l->wadfile->data[l->position + offset], size);
+    return TRUE;
+  }
+#endif
+  rfseek(l->wadfile->handle, l->position + offset, SEEK_SET);
+  if (rfread(dest, size, 1, l->wadfile->handle) <= 0)
+  {
+    I_Error("W_ReadLumpRange: read failed");
+    return FALSE;
+  }
+  return TRUE;
+}
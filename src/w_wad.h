@@ -35,8 +35,11 @@
 #ifndef __W_WAD__
 #define __W_WAD__
 
+#include <stdint.h>
 #include <streams/file_stream.h>
 
+#include "doomtype.h"
+
 //
 // TYPES
 //
@@ -92,6 +95,8 @@ typedef struct {
   unsigned char *data;
   int position;
   int length;
+  dbool mapped;   // data is a read-only file mapping, not malloced
+  dbool builtin;  // data is an image linked into the binary, no file behind it
 #endif
 } wadfile_info_t;
 
@@ -104,6 +109,12 @@ void W_ReleaseAllWads(void); // Proff - Added for iwad switching
 void W_InitCache(void);
 void W_DoneCache(void);
 
+// Read a set of lumps ahead of need, in file order (the next map's, during
+// the intermission); W_PrefetchStep spends budget microseconds a frame
+void W_StartPrefetch(const int *lumps, int count);
+void W_PrefetchStep(int budget);
+void W_StopPrefetch(void);
+
 typedef struct
 {
   // WARNING: order of some fields important (see info.c).
@@ -112,19 +123,26 @@ typedef struct
   int   size;
 
   // killough 1/31/98: hash table fields, used for ultra-fast hash table lookup
-  int index, next;
+  // key is the name upper-cased and packed, next the previous lump with the
+  // same key and namespace
+  uint64_t key;
+  int next;
 
   // haleyjd 05/21/02: renamed from "namespace"
   lumpinfo_namespace_t li_namespace;
 
   wadfile_info_t *wadfile;
   int position;
+  int compressed;  // deflated size in a zip container, 0 if stored whole
   wad_source_t source;
 } lumpinfo_t;
 
 extern lumpinfo_t *lumpinfo;
 extern int        numlumps;
 
+// Config: keep the coalesced and hashed lump directory between runs
+extern int wad_dir_cache;
+
 // killough 4/17/98: if W_CheckNumForName() called with only
 // one argument, pass ns_global as the default namespace
 
@@ -136,12 +154,21 @@ static INLINE int     (W_CheckNumForName)(const char *name, lumpinfo_namespace_t
         { return (W_FindNumFromName)(name, ns, -1); }
 int     W_GetNumForName (const char* name);
 char*   W_GetNameForNum (const int lump);
+// W_GetNumForName memoized by the name's address, for names drawn each frame
+int     W_CachedNumForName(const char *name);
+void    W_NameCacheFrame(void);
+void    W_ReportNameCache(void);
 int     W_LumpLength (int lump);
 void    W_ReadLump (int lump, void *dest);
+// Read size bytes of a lump from offset on; FALSE for a compressed lump,
+// which can only be read whole
+dbool   W_ReadLumpRange(int lump, void *dest, int offset, int size);
 // CPhipps - modified for 'new' lump locking
 const void* W_CacheLumpNum (int lump);
 const void* W_LockLumpNum(int lump);
 void    W_UnlockLumpNum(int lump);
+// Bytes of lumps read into the zone and still there
+size_t  W_CacheBytes(void);
 
 // CPhipps - convenience macros
 //#define W_CacheLumpNum(num) (W_CacheLumpNum)((num),1)
@@ -153,6 +180,7 @@ void    W_UnlockLumpNum(int lump);
 char *AddDefaultExtension(char *, const char *);  // killough 1/18/98
 void ExtractFileBase(const char *, char *);       // killough
 unsigned W_LumpNameHash(const char *s);           // killough 1/31/98
+uint64_t W_LumpNameKey(const char *s);
 void W_HashLumps(void);                           // cph 2001/07/07 - made public
 
 void W_Exit(void);
@@ -0,0 +1,617 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      PK3/ZIP containers read as wads: the central directory becomes
+ *      lumps, and deflated entries are inflated as they are read.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+#include "config.h"
+
+#include <limits.h>
+
+#include "doomstat.h"
+#include "doomtype.h"
+#include "i_system.h"
+
+#include "w_wad.h"
+#include "w_zip.h"
+#include "lprintf.h"
+
+#include <streams/file_stream.h>
+
+/* Don't include file_stream_transforms.h but instead
+just forward declare the prototype */
+int64_t rfread(void* buffer,
+   size_t elem_size, size_t elem_count, RFILE* stream);
+int64_t rfseek(RFILE* stream, int64_t offset, int origin);
+
+// Zip fields are little endian and unaligned
+#define ZIP16(p) ((p)[0] | (p)[1] << 8)
+#define ZIP32(p) ((unsigned)ZIP16(p) | (unsigned)ZIP16((p)+2) << 16)
+
+#define ZIP_LOCAL_SIZE   30
+#define ZIP_CENTRAL_SIZE 46
+#define ZIP_END_SIZE     22
+
+#define ZIP_STORED   0
+#define ZIP_DEFLATED 8
+
+//
+// INFLATE
+//
+// A plain RFC 1951 decoder: canonical Huffman codes are decoded a bit at
+// a time, which is slower than a table driven inflate but needs no setup
+// a block. The whole lump is inflated at once into a buffer of the size
+// the directory gave, so there is no sliding window to keep.
+//
+
+#define MAXBITS   15
+#define MAXLCODES 286
+#define MAXDCODES 30
+#define FIXLCODES 288
+
+typedef struct {
+  const byte *in;
+  size_t inlen, inpos;
+  byte *out;
+  size_t outlen, outpos;
+  unsigned bitbuf;
+  int bitcnt;
+  dbool error;   // ran out of input, or the stream is not valid
+} inflate_t;
+
+typedef struct {
+  short count[MAXBITS+1];  // codes of each length
+  short *symbol;           // symbols in canonical order
+} huffman_t;
+
+static int W_InflateBits(inflate_t *s, int need)
+{
+  unsigned val = s->bitbuf;
+
+  while (s->bitcnt < need)
+  {
+    if (s->inpos == s->inlen)
+    {
+      s->error = TRUE;
+      return 0;
+    }
+    val |= (unsigned)s->in[s->inpos++] << s->bitcnt;
+    s->bitcnt += 8;
+  }
+  s->bitbuf = val >> need;
+  s->bitcnt -= need;
+  return val & ((1u << need) - 1);
+}
+
+static int W_InflateDecode(inflate_t *s, const huffman_t *h)
+{
+  int code = 0, first = 0, index = 0, len;
+
+  for (len = 1; len <= MAXBITS; len++)
+  {
+    int count = h->count[len];
+
+    code |= W_InflateBits(s, 1);
+    if (code - count < first)
+      return h->symbol[index + (code - first)];
+    index += count;
+    first = (first + count) << 1;
+    code <<= 1;
+  }
+  return -1;  // an unused code, or out of input
+}
+
+// Builds a code from its lengths; FALSE if it is over-subscribed.
+// Incomplete codes are allowed, decoding an unused code is the error.
+static dbool W_InflateBuild(huffman_t *h, const short *length, int n)
+{
+  short offs[MAXBITS+1];
+  int left = 1, len, symbol;
+
+  memset(h->count, 0, sizeof(h->count));
+  for (symbol = 0; symbol < n; symbol++)
+    h->count[length[symbol]]++;
+
+  for (len = 1; len <= MAXBITS; len++)
+  {
+    left = (left << 1) - h->count[len];
+    if (left < 0)
+      return FALSE;
+  }
+
+  offs[1] = 0;
+  for (len = 1; len < MAXBITS; len++)
+    offs[len+1] = offs[len] + h->count[len];
+  for (symbol = 0; symbol < n; symbol++)
+    if (length[symbol])
+      h->symbol[offs[length[symbol]]++] = symbol;
+  return TRUE;
+}
+
+static void W_InflateStored(inflate_t *s)
+{
+  unsigned len;
+
+  s->bitbuf = 0;  // to the byte boundary
+  s->bitcnt = 0;
+
+  if (s->inlen - s->inpos < 4)
+  {
+    s->error = TRUE;
+    return;
+  }
+  len = ZIP16(s->in + s->inpos);
+  if ((unsigned)(ZIP16(s->in + s->inpos + 2) ^ 0xffff) != len ||
+      s->inlen - s->inpos - 4 < len || s->outlen - s->outpos < len)
+  {
+    s->error = TRUE;
+    return;
+  }
+  memcpy(s->out + s->outpos, s->in + s->inpos + 4, len);
+  s->inpos += 4 + len;
+  s->outpos += len;
+}
+
+static void W_InflateCodes(inflate_t *s, const huffman_t *lencode, const huffman_t *distcode)
+{
+  static const short lbase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+  static const byte lext[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+  static const unsigned short dbase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577};
+  static const byte dext[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+  while (!s->error)
+  {
+    int symbol = W_InflateDecode(s, lencode);
+    size_t len, dist;
+
+    if (symbol < 256)
+    {
+      if (symbol < 0 || s->outpos == s->outlen)
+        break;
+      s->out[s->outpos++] = symbol;
+      continue;
+    }
+    if (symbol == 256)  // end of block
+      return;
+
+    symbol -= 257;
+    if (symbol >= 29)
+      break;
+    len = lbase[symbol] + W_InflateBits(s, lext[symbol]);
+
+    symbol = W_InflateDecode(s, distcode);
+    if (symbol < 0 || symbol >= 30)
+      break;
+    dist = dbase[symbol] + W_InflateBits(s, dext[symbol]);
+    if (dist > s->outpos || len > s->outlen - s->outpos)
+      break;
+
+    // byte by byte, the copy may overlap what it writes
+    for (; len; len--, s->outpos++)
+      s->out[s->outpos] = s->out[s->outpos - dist];
+  }
+  s->error = TRUE;
+}
+
+static void W_InflateFixed(inflate_t *s)
+{
+  static short lensym[FIXLCODES], distsym[MAXDCODES];
+  static huffman_t lencode = {{0}, lensym}, distcode = {{0}, distsym};
+  static dbool built;
+
+  if (!built)
+  {
+    short lengths[FIXLCODES];
+    int symbol;
+
+    for (symbol = 0; symbol < 144; symbol++)
+      lengths[symbol] = 8;
+    for (; symbol < 256; symbol++)
+      lengths[symbol] = 9;
+    for (; symbol < 280; symbol++)
+      lengths[symbol] = 7;
+    for (; symbol < FIXLCODES; symbol++)
+      lengths[symbol] = 8;
+    W_InflateBuild(&lencode, lengths, FIXLCODES);
+
+    for (symbol = 0; symbol < MAXDCODES; symbol++)
+      lengths[symbol] = 5;
+    W_InflateBuild(&distcode, lengths, MAXDCODES);
+    built = TRUE;
+  }
+  W_InflateCodes(s, &lencode, &distcode);
+}
+
+static void W_InflateDynamic(inflate_t *s)
+{
+  static const byte order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+  short lengths[MAXLCODES+MAXDCODES];
+  short lensym[MAXLCODES], distsym[MAXDCODES];
+  huffman_t lencode = {{0}, lensym}, distcode = {{0}, distsym};
+  int nlen, ndist, ncode, index;
+
+  nlen = W_InflateBits(s, 5) + 257;
+  ndist = W_InflateBits(s, 5) + 1;
+  ncode = W_InflateBits(s, 4) + 4;
+  if (s->error || nlen > MAXLCODES || ndist > MAXDCODES)
+  {
+    s->error = TRUE;
+    return;
+  }
+
+  // the code lengths code, which codes the other two codes' lengths
+  for (index = 0; index < ncode; index++)
+    lengths[order[index]] = W_InflateBits(s, 3);
+  for (; index < 19; index++)
+    lengths[order[index]] = 0;
+  if (!W_InflateBuild(&lencode, lengths, 19))
+  {
+    s->error = TRUE;
+    return;
+  }
+
+  for (index = 0; index < nlen + ndist && !s->error; )
+  {
+    int symbol = W_InflateDecode(s, &lencode);
+    int len = 0, repeat;
+
+    if (symbol < 0)
+      break;
+    if (symbol < 16)
+    {
+      lengths[index++] = symbol;
+      continue;
+    }
+    if (symbol == 16)
+    {
+      if (!index)
+        break;
+      len = lengths[index - 1];
+      repeat = 3 + W_InflateBits(s, 2);
+    }
+    else if (symbol == 17)
+      repeat = 3 + W_InflateBits(s, 3);
+    else
+      repeat = 11 + W_InflateBits(s, 7);
+    if (index + repeat > nlen + ndist)
+      break;
+    while (repeat--)
+      lengths[index++] = len;
+  }
+
+  // a code must be complete enough to hold its end of block
+  if (index < nlen + ndist || s->error || !lengths[256] ||
+      !W_InflateBuild(&lencode, lengths, nlen) ||
+      !W_InflateBuild(&distcode, lengths + nlen, ndist))
+  {
+    s->error = TRUE;
+    return;
+  }
+  W_InflateCodes(s, &lencode, &distcode);
+}
+
+// Inflates a raw deflate stream into exactly outlen bytes
+static dbool W_Inflate(byte *out, size_t outlen, const byte *in, size_t inlen)
+{
+  inflate_t s;
+  int last;
+
+  memset(&s, 0, sizeof(s));
+  s.in = in;
+  s.inlen = inlen;
+  s.out = out;
+  s.outlen = outlen;
+
+  do
+  {
+    last = W_InflateBits(&s, 1);
+    switch (W_InflateBits(&s, 2))
+    {
+      case 0: W_InflateStored(&s); break;
+      case 1: W_InflateFixed(&s); break;
+      case 2: W_InflateDynamic(&s); break;
+      default: s.error = TRUE;
+    }
+  } while (!last && !s.error);
+
+  return !s.error && s.outpos == s.outlen;
+}
+
+//
+// DIRECTORY
+//
+
+static int W_ZipLength(const wadfile_info_t *wadfile)
+{
+#ifdef MEMORY_LOW
+  return filestream_get_size(wadfile->handle);
+#else
+  return wadfile->length;
+#endif
+}
+
+// Reads length bytes at offset; FALSE if they are not all in the file
+static dbool W_ZipRead(const wadfile_info_t *wadfile, unsigned offset, void *dest, unsigned length)
+{
+  unsigned size = W_ZipLength(wadfile);
+
+  if (offset > size || length > size - offset)
+    return FALSE;
+#ifdef MEMORY_LOW
+  if (!length)
+    return TRUE;
+  rfseek(wadfile->handle, offset, SEEK_SET);
+  return rfread(dest, length, 1, wadfile->handle) == 1;
+#else
+  memcpy(dest, wadfile->data + offset, length);
+  return TRUE;
+#endif
+}
+
+typedef enum {
+  zg_global,
+  zg_sprites,
+  zg_flats,
+  zg_colormaps,
+  zg_hires,
+  NUMZIPGROUPS
+} zipgroup_e;
+
+static const struct {
+  const char *dir;
+  zipgroup_e group;
+} zipdirs[] = {
+  {"flats",     zg_flats},
+  {"sprites",   zg_sprites},
+  {"colormaps", zg_colormaps},
+  {"hires",     zg_hires},
+  {"patches",   zg_global},
+  {"graphics",  zg_global},
+  {"sounds",    zg_global},
+  {"music",     zg_global},
+};
+
+// the markers W_CoalesceMarkedResource gathers each group by
+static const char *const zipmarkers[NUMZIPGROUPS][2] = {
+  {NULL, NULL},
+  {"S_START", "S_END"},
+  {"F_START", "F_END"},
+  {"C_START", "C_END"},
+  {"HI_START", "HI_END"},
+};
+
+typedef struct {
+  char name[8];
+  int group;
+  int position, size, compressed;
+} zipentry_t;
+
+dbool W_IsZipFile(const char *name)
+{
+  size_t len = strlen(name);
+
+  return len > 4 && (!strcasecmp(name + len - 4, ".pk3") ||
+                     !strcasecmp(name + len - 4, ".zip"));
+}
+
+// The group of an entry by its top level directory, -1 to skip it
+static int W_ZipGroup(const char *path, int pathlen)
+{
+  const char *slash = memchr(path, '/', pathlen);
+  size_t i;
+
+  if (!slash)
+    return zg_global;
+  for (i = 0; i < sizeof(zipdirs)/sizeof(zipdirs[0]); i++)
+    if (strlen(zipdirs[i].dir) == (size_t)(slash - path) &&
+        !strncasecmp(path, zipdirs[i].dir, slash - path))
+      return zipdirs[i].group;
+  return -1;
+}
+
+// The lump name of an entry: its file name, up to the extension
+static void W_ZipLumpName(char *dest, const char *path, int pathlen)
+{
+  const char *base = path + pathlen;
+  int i;
+
+  while (base > path && base[-1] != '/')
+    base--;
+  memset(dest, 0, 8);
+  for (i = 0; i < 8 && base + i < path + pathlen && base[i] != '.'; i++)
+    // a file name can't hold the \ some sprite names use, ^ stands for it
+    dest[i] = base[i] == '^' ? '\\' : toupper((unsigned char)base[i]);
+}
+
+static void W_AddZipLump(const char *name, const wadfile_info_t *wadfile,
+                         int position, int size, int compressed)
+{
+  lumpinfo_t *lump_p = &lumpinfo[numlumps++];
+
+  lump_p->wadfile = (wadfile_info_t *)wadfile;
+  lump_p->position = position;
+  lump_p->size = size;
+  lump_p->compressed = compressed;
+  lump_p->li_namespace = ns_global;  // W_CoalesceMarkedResource sets it
+  strncpy(lump_p->name, name, 8);
+  lump_p->name[8] = 0;
+  lump_p->source = wadfile->src;
+}
+
+void W_AddZipFile(wadfile_info_t *wadfile)
+{
+  byte *tail, *dir, *p, *end;
+  unsigned taillen, dirsize, diroffset, entries, i;
+  int size = W_ZipLength(wadfile);
+  int group, numentries = 0, skipped = 0;
+  zipentry_t *zipentries;
+
+  // the end of central directory record, behind at most a 64K comment
+  taillen = size < ZIP_END_SIZE + 0xffff ? size : ZIP_END_SIZE + 0xffff;
+  tail = malloc(taillen + 1);
+  p = NULL;
+  if (taillen >= ZIP_END_SIZE && W_ZipRead(wadfile, size - taillen, tail, taillen))
+    for (p = tail + taillen - ZIP_END_SIZE; p >= tail; p--)
+      if (ZIP32(p) == 0x06054b50)
+        break;
+  if (!p || p < tail)
+  {
+    free(tail);
+    I_Error("W_AddZipFile: %s is not a zip file", wadfile->name);
+    return;
+  }
+  entries = ZIP16(p + 10);
+  dirsize = ZIP32(p + 12);
+  diroffset = ZIP32(p + 16);
+  free(tail);
+  if (entries == 0xffff || diroffset == 0xffffffff)
+  {
+    I_Error("W_AddZipFile: %s is a zip64 file, which isn't supported", wadfile->name);
+    return;
+  }
+
+  dir = diroffset <= (unsigned)size && dirsize <= size - diroffset ? malloc(dirsize + 1) : NULL;
+  if (!dir || !W_ZipRead(wadfile, diroffset, dir, dirsize))
+  {
+    free(dir);
+    I_Error("W_AddZipFile: %s has a bad central directory", wadfile->name);
+    return;
+  }
+
+  zipentries = malloc(entries * sizeof(*zipentries));
+  for (p = dir, end = dir + dirsize, i = 0; i < entries; i++)
+  {
+    byte local[ZIP_LOCAL_SIZE];
+    const char *path;
+    unsigned method, pathlen, usize, csize, offset;
+    zipentry_t *entry;
+
+    if (end - p < ZIP_CENTRAL_SIZE || ZIP32(p) != 0x02014b50 ||
+        end - p < ZIP_CENTRAL_SIZE + ZIP16(p + 28) + ZIP16(p + 30) + ZIP16(p + 32))
+    {
+      free(zipentries);
+      free(dir);
+      I_Error("W_AddZipFile: %s has a bad central directory", wadfile->name);
+      return;
+    }
+    method = ZIP16(p + 10);
+    csize = ZIP32(p + 20);
+    usize = ZIP32(p + 24);
+    pathlen = ZIP16(p + 28);
+    offset = ZIP32(p + 42);
+    path = (const char *)p + ZIP_CENTRAL_SIZE;
+    group = pathlen ? W_ZipGroup(path, pathlen) : -1;
+    if (!(ZIP16(p + 8) & 1) && pathlen && path[pathlen - 1] != '/' && group >= 0)
+    {
+      entry = &zipentries[numentries];
+      W_ZipLumpName(entry->name, path, pathlen);
+
+      if (!entry->name[0] || usize > INT_MAX ||
+          (method != ZIP_DEFLATED && (method != ZIP_STORED || csize != usize)) ||
+          !W_ZipRead(wadfile, offset, local, ZIP_LOCAL_SIZE) ||
+          ZIP32(local) != 0x04034b50)
+        skipped++;
+      else
+      {
+        entry->group = group;
+        entry->position = offset + ZIP_LOCAL_SIZE + ZIP16(local + 26) + ZIP16(local + 28);
+        entry->size = usize;
+        entry->compressed = method == ZIP_DEFLATED ? (int)csize : 0;
+        if (entry->position > size || csize > (unsigned)(size - entry->position))
+          skipped++;
+        else
+          numentries++;
+      }
+    }
+    else if (pathlen && path[pathlen - 1] != '/')
+      skipped++;
+    p += ZIP_CENTRAL_SIZE + pathlen + ZIP16(p + 30) + ZIP16(p + 32);
+  }
+  free(dir);
+
+  if (skipped)
+    lprintf(LO_WARN, "W_AddZipFile: skipped %d entries of %s that can't be used as lumps\n",
+        skipped, wadfile->name);
+
+  // the global lumps as they come, then each group inside its markers
+  lumpinfo = realloc(lumpinfo, (numlumps + numentries + 2*NUMZIPGROUPS) * sizeof(lumpinfo_t));
+  for (group = 0; group < NUMZIPGROUPS; group++)
+  {
+    int count = 0;
+
+    for (i = 0; i < (unsigned)numentries; i++)
+      if (zipentries[i].group == group)
+      {
+        if (!count++ && zipmarkers[group][0])
+          W_AddZipLump(zipmarkers[group][0], wadfile, 0, 0, 0);
+        W_AddZipLump(zipentries[i].name, wadfile, zipentries[i].position,
+            zipentries[i].size, zipentries[i].compressed);
+      }
+    if (count && zipmarkers[group][1])
+      W_AddZipLump(zipmarkers[group][1], wadfile, 0, 0, 0);
+  }
+  free(zipentries);
+}
+
+void W_ReadZipLump(const lumpinfo_t *l, void *dest)
+{
+  const byte *src;
+  dbool ok;
+
+#ifdef MEMORY_LOW
+  byte *buffer = malloc(l->compressed);
+
+  ok = W_ZipRead(l->wadfile, l->position, buffer, l->compressed);
+  src = buffer;
+#else
+  ok = TRUE;  // W_AddZipFile checked it lies inside the file
+  src = l->wadfile->data + l->position;
+#endif
+
+  if (ok)
+    ok = W_Inflate(dest, l->size, src, l->compressed);
+#ifdef MEMORY_LOW
+  free(buffer);
+#endif
+  if (!ok)
+    I_Error("W_ReadLump: couldn't inflate %.8s from %s", l->name, l->wadfile->name);
+}
@@ -0,0 +1,53 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      PK3/ZIP containers read as wads: the central directory becomes
+ *      lumps, and deflated entries are inflated as they are read.
+ *
+ *-----------------------------------------------------------------------------*/
+
+
+#ifndef __W_ZIP__
+#define __W_ZIP__
+
+#include "w_wad.h"
+
+// Whether a file's name marks it as a zip container (.pk3 or .zip)
+dbool W_IsZipFile(const char *name);
+
+// Adds the lumps of an opened zip container to lumpinfo. The top level
+// directories give the namespace: flats/, sprites/, colormaps/ and hires/
+// are wrapped in their markers, patches/, graphics/, sounds/ and music/
+// join the global lumps with those at the root. Other entries are skipped.
+void W_AddZipFile(wadfile_info_t *wadfile);
+
+// Reads a lump stored deflated (lumpinfo_t.compressed != 0) into dest
+void W_ReadZipLump(const lumpinfo_t *l, void *dest);
+
+#endif
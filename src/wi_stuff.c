@@ -448,7 +448,7 @@ static void WI_slamBackground(void)
       strcpy(name, "INTERPIC");
   }
   // background
-  V_DrawNamePatch(0, 0, FB, name, CR_DEFAULT, VPT_STRETCH);
+  V_DrawNameBackground(name);
 }
 
 
@@ -2034,6 +2034,15 @@ void WI_loadData(void)
 //
 void WI_Drawer (void)
 {
+  static int oldbcnt = -1;
+
+  // the counts and animations move on every WI_Ticker
+  if (bcnt != oldbcnt)
+  {
+    oldbcnt = bcnt;
+    screen_dirty = TRUE;
+  }
+
   switch (state)
   {
     case StatCount:
@@ -33,83 +33,141 @@
 
 #include "config.h"
 
+#include <stddef.h>
+
 #include "doomtype.h"
 #include "z_zone.h"
 #include "z_bmalloc.h"
 #include "lprintf.h"
 
+// Each block is preceded by a pointer to its pool, so Z_BFree finds the
+// pool straight away. A free block holds the next free block of its pool
+// in its first word. Pools with a free block are kept on a list of their
+// own, so Z_BMalloc takes the first block of the first of them.
+
+typedef union {
+  struct bmalpool_s *pool;
+  int64_t            align;     // keep the blocks aligned for anything
+  double             dalign;
+} bmalhead_t;
+
 typedef struct bmalpool_s {
-  struct bmalpool_s *nextpool;
-  size_t             blocks;
-  uint8_t            used[0];
+  struct bmalpool_s  *nextpool, **prevpool;   // all the zone's pools
+  struct bmalpool_s  *nextfree, **prevfree;   // those with a free block
+  const struct block_memory_alloc_s *zone;
+  void               *freeblock;
+  size_t              blocks, used;
+  bmalhead_t          data[1];
 } bmalpool_t;
 
-static INLINE void* getelem(bmalpool_t *p, size_t size, size_t n)
+// Bytes from one block's header to the next
+static INLINE size_t blockstride(size_t size)
 {
-  return (((uint8_t*)p) + sizeof(bmalpool_t) + sizeof(uint8_t)*(p->blocks) + size*n);
+  return sizeof(bmalhead_t) +
+    (size + sizeof(bmalhead_t) - 1) / sizeof(bmalhead_t) * sizeof(bmalhead_t);
 }
 
-static INLINE int iselem(const bmalpool_t *pool, size_t size, const void* p)
+static INLINE void unlinkfree(bmalpool_t *pool)
 {
-  // CPhipps - need portable # of bytes between pointers
-  int dif = (const char*)p - (const char*)pool;
-
-  dif -= sizeof(bmalpool_t);
-  dif -= pool->blocks;
-  if (dif<0) return -1;
-  dif /= size;
-  return (((size_t)dif >= pool->blocks) ? -1 : dif);
+  if ((*pool->prevfree = pool->nextfree))
+    pool->nextfree->prevfree = pool->prevfree;
+  pool->prevfree = NULL;
 }
 
-enum { unused_block = 0, used_block = 1};
+static INLINE void linkfree(struct block_memory_alloc_s *pzone, bmalpool_t *pool)
+{
+  bmalpool_t **head = (bmalpool_t **)&pzone->freepools;
+
+  if ((pool->nextfree = *head))
+    pool->nextfree->prevfree = &pool->nextfree;
+  pool->prevfree = head;
+  *head = pool;
+}
 
 void* Z_BMalloc(struct block_memory_alloc_s *pzone)
 {
-   register bmalpool_t **pool = (bmalpool_t **)&(pzone->firstpool);
-   while (*pool != NULL)
-   {
-      uint8_t *p = memchr((*pool)->used, unused_block, (*pool)->blocks); // Scan for unused marker
-      if (p) {
-         int n = p - (*pool)->used;
-         (*pool)->used[n] = used_block;
-         return getelem(*pool, pzone->size, n);
-      } else
-         pool = &((*pool)->nextpool);
-   }
-
-   {
+  bmalpool_t *pool = pzone->freepools;
+  void **block;
+
+  if (!pool)
+    {
       // Nothing available, must allocate a new pool
-      bmalpool_t *newpool;
+      bmalpool_t **head = (bmalpool_t **)&pzone->firstpool;
+      size_t stride = blockstride(pzone->size);
+      uint8_t *p;
+      size_t i;
 
       // CPhipps: Allocate new memory, initialised to 0
+      pool = Z_Calloc(offsetof(bmalpool_t, data) + stride * pzone->perpool,
+                      1, pzone->tag, NULL);
+      pool->zone = pzone;
+      pool->blocks = pzone->perpool;
+
+      // chain the blocks in address order, the first to be taken first
+      p = (uint8_t *)pool->data + stride * pool->blocks;
+      for (i = pool->blocks; i--; )
+        {
+          p -= stride;
+          ((bmalhead_t *)p)->pool = pool;
+          *(void **)(p + sizeof(bmalhead_t)) = pool->freeblock;
+          pool->freeblock = p + sizeof(bmalhead_t);
+        }
 
-      *pool = newpool = Z_Calloc(sizeof(*newpool) + (sizeof(uint8_t) + pzone->size)*(pzone->perpool),
-            1,  pzone->tag, NULL);
-      newpool->nextpool = NULL; // NULL = (void*)0 so this is redundant
+      if ((pool->nextpool = *head))
+        pool->nextpool->prevpool = &pool->nextpool;
+      pool->prevpool = head;
+      *head = pool;
+      linkfree(pzone, pool);
+    }
 
-      // Return element 0 from this pool to satisfy the request
-      newpool->used[0] = used_block;
-      newpool->blocks = pzone->perpool;
-      return getelem(newpool, pzone->size, 0);
-   }
+  block = pool->freeblock;
+  pool->freeblock = *block;
+  *block = NULL;        // as a block from a fresh pool always read
+  if (!pool->freeblock)
+    unlinkfree(pool);
+  pool->used++;
+  return block;
 }
 
 void Z_BFree(struct block_memory_alloc_s *pzone, void* p)
 {
-  register bmalpool_t **pool = (bmalpool_t**)&(pzone->firstpool);
-
-  while (*pool != NULL) {
-    int n = iselem(*pool, pzone->size, p);
-    if (n >= 0) {
-      (*pool)->used[n] = unused_block;
-      if (memchr(((*pool)->used), used_block, (*pool)->blocks) == NULL) {
-  // Block is all unused, can be freed
-  bmalpool_t *oldpool = *pool;
-  *pool = (*pool)->nextpool;
-  Z_Free(oldpool);
-      }
+  bmalpool_t *pool = ((bmalhead_t *)p - 1)->pool;
+
+  // p has to have come from some pool; this only catches the wrong zone
+  if (pool->zone != pzone)
+    I_Error("Z_BFree: Free not in zone %s", pzone->desc);
+
+  if (!--pool->used)
+    {
+      // Block is all unused, can be freed
+      if (pool->prevfree)
+        unlinkfree(pool);
+      if ((*pool->prevpool = pool->nextpool))
+        pool->nextpool->prevpool = pool->prevpool;
+      Z_Free(pool);
       return;
-    } else pool = &((*pool)->nextpool);
-  }
-  I_Error("Z_BFree: Free not in zone %s", pzone->desc);
+    }
+
+  *(void **)p = pool->freeblock;
+  if (!pool->freeblock)
+    linkfree(pzone, pool);
+  pool->freeblock = p;
+}
+
+dbool Z_BOwns(const struct block_memory_alloc_s *pzone, const void* p)
+{
+  const bmalpool_t *pool;
+  size_t stride = blockstride(pzone->size);
+
+  // CPhipps - need portable # of bytes between pointers
+  // Pointers from anywhere can be asked about, so the difference
+  // mustn't be truncated
+  for (pool = pzone->firstpool; pool; pool = pool->nextpool)
+    {
+      ptrdiff_t dif = (const char*)p - (const char*)pool->data;
+
+      if (dif >= 0 && (size_t)dif < stride * pool->blocks)
+        return TRUE;
+    }
+  return FALSE;
 }
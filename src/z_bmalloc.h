@@ -40,12 +40,13 @@ struct block_memory_alloc_s {
   size_t perpool;
   int    tag;
   const char *desc;
+  void  *freepools;     // the pools with a block free, for Z_BMalloc
 };
 
 #define DECLARE_BLOCK_MEMORY_ALLOC_ZONE(name) extern struct block_memory_alloc_s name
 #define IMPLEMENT_BLOCK_MEMORY_ALLOC_ZONE(name, size, tag, num, desc) \
-struct block_memory_alloc_s name = { NULL, size, num, tag, desc}
-#define NULL_BLOCK_MEMORY_ALLOC_ZONE(name) name.firstpool = NULL
+struct block_memory_alloc_s name = { NULL, size, num, tag, desc, NULL}
+#define NULL_BLOCK_MEMORY_ALLOC_ZONE(name) (name.firstpool = name.freepools = NULL)
 
 void* Z_BMalloc(struct block_memory_alloc_s *pzone);
 
@@ -54,4 +55,7 @@ static INLINE void* Z_BCalloc(struct block_memory_alloc_s *pzone)
 
 void Z_BFree(struct block_memory_alloc_s *pzone, void* p);
 
+// Whether p lies in one of the pools of pzone
+dbool Z_BOwns(const struct block_memory_alloc_s *pzone, const void* p);
+
 #endif
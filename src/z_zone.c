@@ -51,6 +51,7 @@
 #include "v_video.h"
 #include "g_game.h"
 #include "lprintf.h"
+#include "i_thread.h"
 
 // Tunables
 
@@ -79,8 +80,12 @@
 
 typedef struct memblock {
   struct memblock *next,*prev;
-  size_t size;
+  void **user;
+  unsigned int size;  // keeps the header within CHUNK_SIZE on 64bit
   unsigned char tag;
+  unsigned char arena;  // carved from its tag's arena, not on a list
+  unsigned char held;   // PU_CACHE block its owner has locked (Z_Hold)
+  unsigned char recent; // released since the purge last passed it
 
 } memblock_t;
 
@@ -91,6 +96,38 @@ static const size_t HEADER_SIZE = (sizeof(memblock_t)+CHUNK_SIZE-1) & ~(CHUNK_SI
 
 static memblock_t *blockbytag[PU_MAX];
 
+/* Level arenas
+ *
+ * PU_LEVEL and PU_LEVSPEC blocks are carved from large chunks by bumping
+ * a pointer, and go all at once when Z_FreeTags releases their tag at the
+ * end of the level, instead of one free() a block. They keep their
+ * header, so Z_Free and Z_Realloc still take them: the space comes back
+ * at once if the block was the last one carved, and otherwise goes on a
+ * free list for its size, which the next block of that size is taken
+ * from. The block pools of z_bmalloc.c come and go all level as mobjs
+ * and sector nodes do, so without the lists a level would keep carving.
+ * Blocks too big for a list wait for the arena.
+ */
+
+#define ARENA_CHUNK (256*1024)
+
+typedef struct arenachunk {
+  struct arenachunk *next;
+  size_t used, size;  // used counts from the chunk's own start
+} arenachunk_t;
+
+static const size_t ARENA_HEADER_SIZE = (sizeof(arenachunk_t)+CHUNK_SIZE-1) & ~(CHUNK_SIZE-1);
+
+static arenachunk_t *arenas[PU_MAX];
+
+// free lists by size in CHUNK_SIZE steps, for blocks up to 64K
+#define ARENA_FREECLASSES 2048
+#define Z_ArenaFreeList(tag) arenafree[(tag) - PU_LEVEL]
+
+static memblock_t *arenafree[2][ARENA_FREECLASSES];
+
+#define Z_IsArenaTag(tag) ((tag) == PU_LEVEL || (tag) == PU_LEVSPEC)
+
 // 0 means unlimited, any other value is a hard limit
 #ifdef MEMORY_LOW
 /* Set a default limit of 16 MB; smaller values
@@ -104,6 +141,44 @@ static int memory_size = 0;
 #endif
 static int free_memory = 0;
 
+zcachestats_t zcachestats;
+
+// Z_Realloc outcomes since the last Z_ReportZoneStats
+static struct {
+  unsigned inplace;     // resized without a fresh block
+  unsigned moved;       // of those, moved by the system realloc
+  unsigned copies;      // reallocated by copying into a fresh block
+  size_t copiedbytes;
+} zreallocstats;
+
+static ztagstats_t tagstats[PU_MAX];
+static zframestats_t framestats, lastframestats;
+static size_t system_bytes;  // blocks, headers and arena chunks from malloc
+
+static const char *const tagnames[PU_MAX] = {
+   "free", "static", "sound", "music", "level", "levspec", "cache"
+};
+
+#ifdef PRBOOM_THREADS
+/* The zone, and the lump and patch caches built on it, may be used by
+ * the renderer worker threads. Every entry point takes this lock; the
+ * per-thread depth lets zone functions (and the caches) nest freely. */
+static i_mutex_t *zone_mutex;
+static THREAD_LOCAL int zone_lock_depth;
+
+void Z_Lock(void)
+{
+   if (zone_lock_depth++ == 0 && zone_mutex)
+      I_MutexLock(zone_mutex);
+}
+
+void Z_Unlock(void)
+{
+   if (--zone_lock_depth == 0 && zone_mutex)
+      I_MutexUnlock(zone_mutex);
+}
+#endif
+
 
 void Z_Close(void)
 {
@@ -111,6 +186,8 @@ void Z_Close(void)
     * close content if we free memory
     * here while running on Windows... */
 #if !defined(_WIN32)
+   // purgeable blocks first, while the owners they clear are still there
+   Z_FreeTags(PU_CACHE, PU_CACHE);
    Z_FreeTags(PU_FREE, PU_MAX);
 #endif
    memory_size = 0;
@@ -123,6 +200,11 @@ bool Z_Init(void)
    for (i = 0; i < PU_MAX; i++)
       blockbytag[i] = NULL;
 
+#ifdef PRBOOM_THREADS
+   if (!zone_mutex)
+      zone_mutex = I_MutexCreate();
+#endif
+
    return true;
 }
 
@@ -136,66 +218,251 @@ bool Z_Init(void)
  * This has been changed now; we still do the round-robin first-fit, 
  * but we only free the blocks we actually end up using; we don't 
  * free all the stuff we just pass on the way.
+ *
+ * PU_CACHE blocks stay on their list while locked: the caches mark them
+ * with Z_Hold and Z_Release, which only flip bits in the header, so a
+ * patch locked and unlocked every frame costs no relinking. Purging
+ * sweeps the list like a clock hand, passing held blocks, giving a
+ * block released since the last sweep a second chance, and freeing the
+ * rest; the hand is left where the sweep stopped. A purged block's user
+ * pointer is cleared, so the owning cache sees the miss instead of a
+ * dangling pointer.
  */
 
-void *Z_Malloc(size_t size, int tag, void **user)
+/* Z_PurgeCache
+ * Sweeps the PU_CACHE list as above until the purge limit leaves room
+ * for size bytes, or, with size 0, frees every block not held. Returns
+ * whether anything was freed.
+ */
+static bool Z_PurgeCache(size_t size)
 {
-   memblock_t *block = NULL;
-
-   if (!size)
-      return user ? *user = NULL : NULL;           // malloc(0) returns NULL
+   memblock_t *block = blockbytag[PU_CACHE], *next;
+   unsigned steps = 2 * tagstats[PU_CACHE].blocks;  // round twice at most
+   bool freed = false;
 
-   size = (size+CHUNK_SIZE-1) & ~(CHUNK_SIZE-1);  // round to chunk size
-
-   if (memory_size > 0 && ((free_memory + memory_size) < (int)(size + HEADER_SIZE)))
+   if (!block)
+      return false;
+   for (; steps; steps--, block = next)
    {
-      memblock_t *end_block;
-      block = blockbytag[PU_CACHE];
-      if (block)
+      next = block->next;
+      if (block->held)
+         continue;
+      if (block->recent && size)
       {
-         end_block = block->prev;
-         while (1)
-         {
-            memblock_t *next = block->next;
-            (Z_Free)((uint8_t*) block + HEADER_SIZE);
-            if (((free_memory + memory_size) >= (int)(size + HEADER_SIZE)) || (block == end_block))
-               break;
-            block = next;               // Advance to next block
-         }
+         block->recent = 0;
+         continue;
+      }
+      zcachestats.evictions++;
+      zcachestats.evictedbytes += block->size;
+      tagstats[PU_CACHE].purges++;
+      freed = true;
+      (Z_Free)((uint8_t*) block + HEADER_SIZE);
+      if (!blockbytag[PU_CACHE])
+         return true;
+      if (size && (free_memory + memory_size) >= (int)size)
+      {
+         block = next;
+         break;
       }
-      block = NULL;
    }
+   blockbytag[PU_CACHE] = block;
+   return freed;
+}
 
-   while (!(block = (malloc)(size + HEADER_SIZE))) {
-      if (!blockbytag[PU_CACHE])
+/* Z_SysMalloc
+ * System memory for a block or an arena chunk, first purging PU_CACHE
+ * blocks to keep under any purge limit and again while malloc fails.
+ */
+static void *Z_SysMalloc(size_t size)
+{
+   void *p;
+
+   if (memory_size > 0 && ((free_memory + memory_size) < (int)size))
+      Z_PurgeCache(size);
+
+   while (!(p = (malloc)(size))) {
+      if (!Z_PurgeCache(0))
          I_Error ("Z_Malloc: Failure trying to allocate %lu bytes"
                ,(unsigned long) size
                );
-      Z_FreeTags(PU_CACHE,PU_CACHE);
    }
+   return p;
+}
 
-   if (!blockbytag[tag])
+/* Z_ArenaMalloc
+ * Carves a block, header included, from the tag's current arena chunk,
+ * starting a new chunk when it doesn't fit.
+ */
+static memblock_t *Z_ArenaMalloc(size_t size, int tag)
+{
+   arenachunk_t *chunk = arenas[tag];
+   memblock_t *block;
+
+   if (size / CHUNK_SIZE < ARENA_FREECLASSES &&
+         (block = Z_ArenaFreeList(tag)[size / CHUNK_SIZE]))
    {
-      blockbytag[tag] = block;
-      block->next = block->prev = block;
+      Z_ArenaFreeList(tag)[size / CHUNK_SIZE] = block->next;
+      block->next = block->prev = NULL;
+      return block;
    }
+
+   if (!chunk || chunk->used + HEADER_SIZE + size > chunk->size)
+   {
+      size_t chunksize = ARENA_HEADER_SIZE + HEADER_SIZE + size;
+
+      if (chunksize < ARENA_CHUNK)
+         chunksize = ARENA_CHUNK;
+      chunk = Z_SysMalloc(chunksize);
+      chunk->next = arenas[tag];
+      chunk->used = ARENA_HEADER_SIZE;
+      chunk->size = chunksize;
+      arenas[tag] = chunk;
+      free_memory -= chunksize;
+      system_bytes += chunksize;
+   }
+
+   block = (memblock_t *)((uint8_t*) chunk + chunk->used);
+   chunk->used += HEADER_SIZE + size;
+   block->next = block->prev = NULL;
+   block->arena = 1;
+   return block;
+}
+
+/* Z_FreeArena
+ * Releases every chunk of a tag's arena, and so every block in it.
+ */
+static void Z_FreeArena(int tag)
+{
+   if (arenas[tag])
+      tagstats[tag].bytes = tagstats[tag].blocks = 0;
+   if (Z_IsArenaTag(tag))
+      memset(Z_ArenaFreeList(tag), 0, sizeof(arenafree[0]));
+   while (arenas[tag])
+   {
+      arenachunk_t *next = arenas[tag]->next;
+      free_memory += arenas[tag]->size;
+      system_bytes -= arenas[tag]->size;
+      (free)(arenas[tag]);
+      arenas[tag] = next;
+   }
+}
+
+/* Z_CountAlloc, Z_CountFree
+ * Keep the per-tag statistics as blocks come and go.
+ */
+static void Z_CountAlloc(int tag, size_t size)
+{
+   ztagstats_t *stats = &tagstats[tag];
+
+   stats->blocks++;
+   if ((stats->bytes += size) > stats->peak)
+      stats->peak = stats->bytes;
+   if (size > stats->largest)
+      stats->largest = size;
+}
+
+static void Z_CountFree(int tag, size_t size)
+{
+   tagstats[tag].blocks--;
+   tagstats[tag].bytes -= size;
+}
+
+#ifdef ZONE_PROFILE
+/* The steady-state audit
+ *
+ * Once a level has warmed up, frames should run on what the level and
+ * its caches already hold. Every allocation after that is logged with
+ * the call site the Z_Malloc family of macros left for it, each site
+ * once until play stops being steady, so a per-frame allocation shows up
+ * as one line rather than a flood.
+ */
+
+#define MAXAUDITSITES 64
+
+typedef struct {
+   const char *file;
+   int line;
+} allocsite_t;
+
+static THREAD_LOCAL allocsite_t allocsite;
+static allocsite_t auditsites[MAXAUDITSITES];
+static int numauditsites;
+static bool steadystate;
+
+void Z_SetAllocSite(const char *file, int line)
+{
+   allocsite.file = file;
+   allocsite.line = line;
+}
+
+static void Z_AuditAlloc(size_t size, int tag)
+{
+   allocsite_t site = allocsite;
+   int i;
+
+   for (i = 0; i < numauditsites; i++)
+      if (auditsites[i].file == site.file && auditsites[i].line == site.line)
+         return;
+   if (numauditsites < MAXAUDITSITES)
+      auditsites[numauditsites++] = site;
+   lprintf(LO_WARN, "Z_Malloc: %u bytes (%s) at %s:%d during steady play\n",
+         (unsigned)size, tagnames[tag], site.file ? site.file : "?", site.line);
+}
+#endif
+
+void *(Z_Malloc)(size_t size, int tag, void **user)
+{
+   memblock_t *block = NULL;
+
+   if (!size)
+      return user ? *user = NULL : NULL;           // malloc(0) returns NULL
+
+   size = (size+CHUNK_SIZE-1) & ~(CHUNK_SIZE-1);  // round to chunk size
+
+   Z_Lock();
+
+   if (Z_IsArenaTag(tag))
+      block = Z_ArenaMalloc(size, tag);
    else
    {
-      blockbytag[tag]->prev->next = block;
-      block->prev = blockbytag[tag]->prev;
-      block->next = blockbytag[tag];
-      blockbytag[tag]->prev = block;
+      block = Z_SysMalloc(size + HEADER_SIZE);
+      block->arena = 0;
+
+      if (!blockbytag[tag])
+      {
+         blockbytag[tag] = block;
+         block->next = block->prev = block;
+      }
+      else
+      {
+         blockbytag[tag]->prev->next = block;
+         block->prev = blockbytag[tag]->prev;
+         block->next = blockbytag[tag];
+         blockbytag[tag]->prev = block;
+      }
+
+      free_memory -= size;
+      system_bytes += size + HEADER_SIZE;
    }
 
+   Z_CountAlloc(tag, size);
+   framestats.allocs++;
+   framestats.bytes += size;
+#ifdef ZONE_PROFILE
+   if (steadystate)
+      Z_AuditAlloc(size, tag);
+   allocsite.file = NULL;
+#endif
    block->size = size;
-
-   free_memory -= block->size;
+   block->user = user;
+   block->held = block->recent = 0;
 
    block->tag = tag;           // tag
    block = (memblock_t *)((uint8_t*) block + HEADER_SIZE);
    if (user)                   // if there is a user
       *user = block;            // set user to point to new block
 
+   Z_Unlock();
    return block;
 }
 
@@ -206,6 +473,27 @@ void Z_Free(void *p)
    if (!p || !block)
       return;
 
+   Z_Lock();
+   Z_CountFree(block->tag, block->size);
+   if (block->arena)
+   {
+      // the space comes back now if carved last, else to its free list
+      arenachunk_t *chunk = arenas[block->tag];
+
+      if (chunk && (uint8_t*) block + HEADER_SIZE + block->size ==
+            (uint8_t*) chunk + chunk->used)
+         chunk->used -= HEADER_SIZE + block->size;
+      else if (block->size / CHUNK_SIZE < ARENA_FREECLASSES)
+      {
+         block->next = Z_ArenaFreeList(block->tag)[block->size / CHUNK_SIZE];
+         Z_ArenaFreeList(block->tag)[block->size / CHUNK_SIZE] = block;
+      }
+      Z_Unlock();
+      return;
+   }
+   // a purgeable block may go behind its owner's back; tell the owner
+   if (block->tag >= PU_PURGELEVEL && block->user)
+      *block->user = NULL;
    if (block == block->next)
       blockbytag[block->tag] = NULL;
    else
@@ -215,8 +503,10 @@ void Z_Free(void *p)
    block->next->prev = block->prev;
 
    free_memory += block->size;
+   system_bytes -= block->size + HEADER_SIZE;
 
    (free)(block);
+   Z_Unlock();
 }
 
 void Z_FreeTags(int lowtag, int hightag)
@@ -228,9 +518,11 @@ void Z_FreeTags(int lowtag, int hightag)
    if (hightag > PU_CACHE)
       hightag = PU_CACHE;
 
+   Z_Lock();
    for (;lowtag <= hightag; lowtag++)
    {
       memblock_t *block, *end_block;
+      Z_FreeArena(lowtag);
       block = blockbytag[lowtag];
       if (!block)
          continue;
@@ -244,6 +536,7 @@ void Z_FreeTags(int lowtag, int hightag)
          block = next;               // Advance to next block
       }
    }
+   Z_Unlock();
 }
 
 /*
@@ -254,6 +547,32 @@ void Z_FreeTags(int lowtag, int hightag)
 ========================
 */
 
+/* Z_Hold, Z_Release
+ * A cache's first lock on a PU_CACHE block and its last unlock. The block
+ * keeps its tag and its place; the purge passes it while held.
+ */
+void Z_Hold(void *ptr)
+{
+   if (ptr)
+      ((memblock_t *)((uint8_t*) ptr - HEADER_SIZE))->held = 1;
+}
+
+void Z_Release(void *ptr)
+{
+   if (ptr)
+   {
+      memblock_t *block = (memblock_t *)((uint8_t*) ptr - HEADER_SIZE);
+
+      block->held = 0;
+      block->recent = 1;
+   }
+}
+
+size_t Z_BlockSize(const void *ptr)
+{
+   return ptr ? ((const memblock_t *)((const uint8_t*) ptr - HEADER_SIZE))->size : 0;
+}
+
 void Z_ChangeTag(void *ptr, int tag)
 {
    memblock_t *block = (memblock_t *)((uint8_t*) ptr - HEADER_SIZE);
@@ -266,6 +585,14 @@ void Z_ChangeTag(void *ptr, int tag)
    if (tag == block->tag)
       return;
 
+   // arena blocks live and die with their arena
+   if (block->arena || Z_IsArenaTag(tag))
+   {
+      I_Error("Z_ChangeTag: can't move a block into or out of a level arena");
+      return;
+   }
+
+   Z_Lock();
    if (block == block->next)
       blockbytag[block->tag] = NULL;
    else
@@ -287,12 +614,106 @@ void Z_ChangeTag(void *ptr, int tag)
       blockbytag[tag]->prev = block;
    }
 
+   Z_CountFree(block->tag, block->size);
+   Z_CountAlloc(tag, block->size);
    block->tag = tag;
+   Z_Unlock();
+}
+
+/* Z_ResizeInPlace
+ * Resizes a block without moving its contents: an arena block when it
+ * was the last one carved from its chunk and the chunk has the room, any
+ * other block through the system realloc, which only copies when it has
+ * to move the block. Returns the block's (possibly new) header, or NULL
+ * when the caller must allocate and copy.
+ */
+static memblock_t *Z_ResizeInPlace(memblock_t *block, size_t size)
+{
+   if (block->arena)
+   {
+      arenachunk_t *chunk = arenas[block->tag];
+
+      if (size <= block->size)
+      {
+         // a shrink leaves the tail to the arena, or returns it if carved last
+         if (chunk && (uint8_t*) block + HEADER_SIZE + block->size ==
+               (uint8_t*) chunk + chunk->used)
+            chunk->used -= block->size - size;
+         return block;
+      }
+      if (!chunk || (uint8_t*) block + HEADER_SIZE + block->size !=
+            (uint8_t*) chunk + chunk->used ||
+            chunk->used + size - block->size > chunk->size)
+         return NULL;
+      chunk->used += size - block->size;
+      return block;
+   }
+   else
+   {
+      int tag = block->tag;
+      memblock_t *prev = block->prev, *next = block->next, *moved;
+
+      // growth that would break the purge limit goes through Z_SysMalloc
+      if (size > block->size && memory_size > 0 &&
+            free_memory + memory_size < (int)(size - block->size))
+         return NULL;
+      if (!(moved = (realloc)(block, HEADER_SIZE + size)))
+         return NULL;
+      if (moved != block)
+      {
+         if (next == block)
+            moved->next = moved->prev = moved;
+         else
+         {
+            prev->next = moved;
+            next->prev = moved;
+         }
+         if (blockbytag[tag] == block)
+            blockbytag[tag] = moved;
+         zreallocstats.moved++;
+      }
+      free_memory -= (int)size - (int)moved->size;
+      system_bytes += size - moved->size;
+      return moved;
+   }
 }
 
-void *Z_Realloc(void *ptr, size_t n, int tag, void **user)
+/* Z_Realloc
+ * Grows or shrinks a block in place where Z_ResizeInPlace can, keeping
+ * its tag and handing it to the new user. Otherwise, or when the tag
+ * changes, the contents are copied to a fresh block; the bytes copied
+ * are counted for Z_ReportZoneStats. Growth is zero-filled either way.
+ */
+void *(Z_Realloc)(void *ptr, size_t n, int tag, void **user)
 {
-   void *p = (Z_Malloc)(n, tag, user);
+   void *p;
+
+   if (ptr && n && tag == ((memblock_t *)((uint8_t*) ptr - HEADER_SIZE))->tag)
+   {
+      memblock_t *block = (memblock_t *)((uint8_t*) ptr - HEADER_SIZE);
+      size_t size = (n+CHUNK_SIZE-1) & ~(CHUNK_SIZE-1);
+      size_t oldsize = block->size;
+
+      Z_Lock();
+      if ((block = Z_ResizeInPlace(block, size)))
+      {
+         Z_CountFree(tag, oldsize);
+         Z_CountAlloc(tag, size);
+         block->size = size;
+         block->user = user;
+         p = (uint8_t*) block + HEADER_SIZE;
+         if (n > oldsize)
+            memset((char*)p+oldsize, 0, n - oldsize);
+         if (user)
+            *user = p;
+         zreallocstats.inplace++;
+         Z_Unlock();
+         return p;
+      }
+      Z_Unlock();
+   }
+
+   p = (Z_Malloc)(n, tag, user);
    if (ptr)
    {
       memblock_t *block = (memblock_t *)((uint8_t*) ptr - HEADER_SIZE);
@@ -304,6 +725,8 @@ void *Z_Realloc(void *ptr, size_t n, int tag, void **user)
         memcpy(p, ptr, block->size);
         memset((char*)p+block->size, 0, n - block->size);
       }
+      zreallocstats.copies++;
+      zreallocstats.copiedbytes += n <= block->size ? n : block->size;
 
       (Z_Free)(ptr);
       if (user) // in case Z_Free nullified same user
@@ -312,14 +735,14 @@ void *Z_Realloc(void *ptr, size_t n, int tag, void **user)
    return p;
 }
 
-void *Z_Calloc(size_t n1, size_t n2, int tag, void **user)
+void *(Z_Calloc)(size_t n1, size_t n2, int tag, void **user)
 {
    if (n1 *= n2)
       return memset((Z_Malloc)(n1, tag, user), 0, n1);
    return NULL;
 }
 
-char *Z_Strdup(const char *s, int tag, void **user)
+char *(Z_Strdup)(const char *s, int tag, void **user)
 {
    return strcpy((Z_Malloc)(strlen(s)+1, tag, user), s);
 }
@@ -340,3 +763,84 @@ void Z_SetPurgeLimit(int size)
    memory_size = size;
 #endif
 }
+
+/* Z_ReportCacheStats
+ *
+ * Hits, misses and LRU evictions of the lump and patch caches since the
+ * last report, to size prboom-purge_limit for a device. Only reported
+ * while a purge limit is in force.
+ */
+void Z_ReportCacheStats(void)
+{
+   unsigned lookups = zcachestats.hits + zcachestats.misses;
+
+   if (memory_size > 0 && lookups)
+      lprintf(LO_INFO, "Z_ReportCacheStats: %u%% of %u lookups hit, %u evictions (%u KB) under a %d MB limit\n",
+            (unsigned)(zcachestats.hits * 100.0 / lookups), lookups,
+            zcachestats.evictions, (unsigned)(zcachestats.evictedbytes >> 10),
+            memory_size >> 20);
+   memset(&zcachestats, 0, sizeof zcachestats);
+}
+
+const ztagstats_t *Z_GetTagStats(int tag)
+{
+   return &tagstats[tag];
+}
+
+size_t Z_GetSystemBytes(void)
+{
+   return system_bytes;
+}
+
+void Z_EndFrame(bool steady)
+{
+   Z_Lock();
+   lastframestats = framestats;
+   memset(&framestats, 0, sizeof framestats);
+#ifdef ZONE_PROFILE
+   if (!steady)
+      numauditsites = 0;  // report the sites afresh next time
+   steadystate = steady;
+#endif
+   Z_Unlock();
+}
+
+const zframestats_t *Z_GetFrameStats(void)
+{
+   return &lastframestats;
+}
+
+/* Z_ReportZoneStats
+ *
+ * What each tag holds, and its high-water mark since the last report.
+ * Called once a level's tags are freed, whatever stays under PU_STATIC
+ * (or anything under PU_LEVEL) is carried into the next level, so a
+ * figure that grows from one report to the next is a leak.
+ */
+void Z_ReportZoneStats(void)
+{
+   int tag;
+
+   Z_Lock();
+   lprintf(LO_INFO, "Z_ReportZoneStats: %u KB from the system\n",
+         (unsigned)(system_bytes >> 10));
+   if (zreallocstats.inplace || zreallocstats.copies)
+      lprintf(LO_INFO, " realloc %u in place (%u moved by the system), %u copied (%u KB)\n",
+            zreallocstats.inplace, zreallocstats.moved, zreallocstats.copies,
+            (unsigned)(zreallocstats.copiedbytes >> 10));
+   memset(&zreallocstats, 0, sizeof zreallocstats);
+   for (tag = PU_STATIC; tag < PU_MAX; tag++)
+   {
+      ztagstats_t *stats = &tagstats[tag];
+
+      if (stats->peak)
+         lprintf(LO_INFO, " %-7s %6u KB in %5u blocks, peak %6u KB, largest %5u KB, %u purged\n",
+               tagnames[tag], (unsigned)(stats->bytes >> 10), stats->blocks,
+               (unsigned)(stats->peak >> 10), (unsigned)(stats->largest >> 10),
+               stats->purges);
+      stats->peak = stats->bytes;
+      stats->largest = 0;
+      stats->purges = 0;
+   }
+   Z_Unlock();
+}
@@ -64,6 +64,9 @@ void *(Z_Malloc)(size_t size, int tag, void **ptr);
 void (Z_Free)(void *ptr);
 void (Z_FreeTags)(int lowtag, int hightag);
 void (Z_ChangeTag)(void *ptr, int tag);
+// Keep a locked PU_CACHE block from the purge, and hand it back
+void Z_Hold(void *ptr);
+void Z_Release(void *ptr);
 bool (Z_Init)(void);
 void Z_Close(void);
 void *(Z_Calloc)(size_t n, size_t n2, int tag, void **user);
@@ -71,6 +74,52 @@ void *(Z_Realloc)(void *p, size_t n, int tag, void **user);
 char *(Z_Strdup)(const char *s, int tag, void **user);
 void Z_SetPurgeLimit(int size);
 
+// Lump and patch cache activity, reported and reset by Z_ReportCacheStats
+typedef struct {
+  unsigned hits, misses;  // lookups that found the block or had to build it
+  unsigned evictions;     // PU_CACHE blocks purged to stay under the limit
+  size_t evictedbytes;
+} zcachestats_t;
+
+extern zcachestats_t zcachestats;
+
+void Z_ReportCacheStats(void);
+
+// Zone use under one purge tag, from Z_GetTagStats
+typedef struct {
+  size_t bytes, peak;  // live block bytes, and their most since the last report
+  size_t largest;      // largest block allocated since the last report
+  unsigned blocks;     // live blocks
+  unsigned purges;     // PU_CACHE blocks purged since the last report
+} ztagstats_t;
+
+const ztagstats_t *Z_GetTagStats(int tag);
+size_t Z_GetSystemBytes(void);
+// Bytes asked for when the block was allocated
+size_t Z_BlockSize(const void *ptr);
+void Z_ReportZoneStats(void);
+
+// Blocks Z_Malloc handed out during the last frame, from Z_EndFrame
+typedef struct {
+  unsigned allocs;
+  size_t bytes;
+} zframestats_t;
+
+// Closes the frame's allocation count. Once steady is passed (play past
+// its warm-up), ZONE_PROFILE builds log where each allocation came from,
+// every call site once, as none should be left by then.
+void Z_EndFrame(bool steady);
+const zframestats_t *Z_GetFrameStats(void);
+
+// Serialises the zone and the caches kept in it between threads
+#ifdef PRBOOM_THREADS
+void Z_Lock(void);
+void Z_Unlock(void);
+#else
+#define Z_Lock()
+#define Z_Unlock()
+#endif
+
 // Remove all definitions before including system definitions
 
 #undef malloc
@@ -85,6 +134,16 @@ void Z_SetPurgeLimit(int size);
 #define calloc(n1,n2)      Z_Calloc(n1,n2,PU_STATIC,0)
 #define strdup(s)          Z_Strdup(s,PU_STATIC,0)
 
+#ifdef ZONE_PROFILE
+// The call site of this thread's next allocation, for Z_EndFrame's log
+void Z_SetAllocSite(const char *file, int line);
+
+#define Z_Malloc(n,t,u)    (Z_SetAllocSite(__FILE__,__LINE__), (Z_Malloc)(n,t,u))
+#define Z_Realloc(p,n,t,u) (Z_SetAllocSite(__FILE__,__LINE__), (Z_Realloc)(p,n,t,u))
+#define Z_Calloc(a,b,t,u)  (Z_SetAllocSite(__FILE__,__LINE__), (Z_Calloc)(a,b,t,u))
+#define Z_Strdup(s,t,u)    (Z_SetAllocSite(__FILE__,__LINE__), (Z_Strdup)(s,t,u))
+#endif
+
 
 void Z_ZoneHistory(char *);
 